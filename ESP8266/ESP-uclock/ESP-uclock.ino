@@ -59,6 +59,7 @@
 #include "wifi.h"
 #include "http.h"
 #include "udpsrv.h"
+#include "animsync.h"
 #include "ntp.h"
 #include "weather.h"
 #include "vars.h"
@@ -310,7 +311,9 @@ loop()
     wifi_check_if_started ();
     http_server_loop ();
     udp_server_loop ();
+    animsync_loop ();
     ntp_poll_time ();                                                       // poll NTP
+    weather_loop ();                                                        // refresh weather cache
 
     while (Serial.available())
     {
@@ -1031,6 +1034,18 @@ loop()
                 Serial.println ("");
                 Serial.flush ();
             }
+            else if (! strcmp (cmd_buffer, "sync-armed"))                  // STM32 has parsed "CMD Y"
+            {
+                animsync_armed ();
+            }
+            else if (! strncmp (cmd_buffer, "sync-late \"", 11))           // STM32 started synchronized animation late
+            {
+                animsync_late (strtoul (cmd_buffer + 11, NULL, 10));
+            }
+            else if (! strcmp (cmd_buffer, "sync-missed"))                 // STM32 had no animation to start at start time
+            {
+                animsync_missed ();
+            }
             else
             {
                 Serial.println ("ERROR invalid command");
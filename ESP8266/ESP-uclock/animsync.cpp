@@ -0,0 +1,701 @@
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * animsync.cpp - synchronized animations of several clocks via UDP multicast
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "animsync.h"
+#include "wifi.h"
+#include "vars.h"
+#include "eepromdata.h"
+#include "base.h"
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * protocol, all values big endian:
+ *
+ * header:      'W' 'C' 'S' version type id[4]
+ * BEACON:      skew[4]                         multicast every second, skew bound of sender in usec
+ * REQUEST:     t1[4]                           follower -> leader: send time of follower
+ * RESPONSE:    t1[4] t2[4] t3[4]               leader -> follower: t1 of request, receive and send time of leader
+ * START:       start[4] mode seed[2]           leader -> all: start animation at leader time start, sent ANIMSYNC_START_REPEATS
+ *                                              times, so a lost packet does not desynchronize a follower
+ *
+ * The clock with the lowest chip id is leader, its micros() is the common time base. Every follower measures its offset to the
+ * leader like NTP: offset = ((t2 - t1) + (t3 - t4)) / 2. Of the last samples not older than ANIMSYNC_MAX_SAMPLE_AGE_MSEC, the one
+ * with the shortest round trip time is used, the error of its offset is at most half of its round trip time.
+ *
+ * The leader announces the animation of the next minute ANIMSYNC_ANNOUNCE_USEC before it starts ANIMSYNC_START_DELAY_USEC after
+ * the minute change of its STM32. Every clock converts the start time into its own time base and arms its STM32 with
+ * "CMD Y" (mode, seed, delay in msec), so that the minute animation of all clocks starts at the same time.
+ *
+ * The skew bound of a clock is the sum of
+ *   - the offset error: half of the round trip time, 0 for the leader
+ *   - the drift of the crystals of follower and leader since the sample was taken: up to ANIMSYNC_MAX_SAMPLE_AGE_MSEC plus
+ *     ANIMSYNC_ANNOUNCE_USEC until the start, 0 for the leader
+ *   - the drift of the STM32 timer against the ESP8266 during the delay of up to ANIMSYNC_ANNOUNCE_USEC
+ *   - the rounding of the delay to msec
+ *   - the time from sending "CMD Y" until the STM32 has parsed it: the STM32 answers "sync-armed", the round trip of "CMD Y"
+ *     and "sync-armed" less the transfer time of "CMD Y", which is already subtracted from the delay
+ *   - the latency of the start on the STM32: it reports the timer ticks the animation started late as "sync-late usec"
+ * The STM32 latencies of the last start are used, they are 0 until the first synchronized start.
+ *
+ * If the STM32 has no minute animation to start at the start time, e.g. its minute changed too late, it answers "sync-missed".
+ * Such a start and a start which cannot be armed are counted as missed, the skew bound is unknown until the next start succeeds.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define ANIMSYNC_PORT               2425
+#define ANIMSYNC_VERSION            1
+#define ANIMSYNC_HEADER_LEN         9
+#define ANIMSYNC_MAX_PACKET_LEN     (ANIMSYNC_HEADER_LEN + 12)
+
+#define ANIMSYNC_BEACON             'B'
+#define ANIMSYNC_REQUEST            'Q'
+#define ANIMSYNC_RESPONSE           'R'
+#define ANIMSYNC_START              'S'
+
+#define ANIMSYNC_MAX_NODES          8
+#define ANIMSYNC_SAMPLES            8
+#define ANIMSYNC_BEACON_MSEC        1000
+#define ANIMSYNC_REQUEST_MSEC       1000
+#define ANIMSYNC_NODE_TIMEOUT_MSEC  3500                                // node is gone after 3 missing beacons
+#define ANIMSYNC_MAX_RTT_USEC       100000                              // ignore samples with longer round trip time
+#define ANIMSYNC_ROUNDING_USEC      1000                                // delay is sent in msec to STM32
+#define ANIMSYNC_UNKNOWN_SKEW       0xFFFFFFFF
+#define ANIMSYNC_START_DELAY_USEC   500000UL                            // start 0.5 sec after minute change of leader
+#define ANIMSYNC_ANNOUNCE_USEC      1500000UL                           // announce start 1.5 sec before
+#define ANIMSYNC_START_REPEATS      3                                   // START is sent 3 times ...
+#define ANIMSYNC_START_REPEAT_MSEC  100                                 // ... every 100 msec
+#define ANIMSYNC_MAX_DELAY_MSEC     5000                                // see SYNC_ANIMATION_MAX_DELAY of STM32
+#define ANIMSYNC_CMD_USEC           (17 * 10 * 1000000UL / 115200)     // transfer time of "CMD Yaassssdddd\r\n" at 115200 Bd
+#define ANIMSYNC_MAX_SAMPLE_AGE_MSEC 10000                              // older offset samples are not used
+#define ANIMSYNC_MAX_PPM            50                                  // max. frequency error of a crystal, ESP8266 or STM32
+#define ANIMSYNC_DRIFT_USEC(usec)   ((uint32_t) ((uint64_t) (usec) * 2 * ANIMSYNC_MAX_PPM / 1000000))    // drift of two crystals
+
+typedef struct
+{
+    uint32_t        id;                                                 // chip id, 0 = unused
+    uint32_t        skew;                                               // skew bound in usec
+    unsigned long   last_seen;                                          // millis() of last beacon
+    IPAddress       ip;
+} ANIMSYNC_NODE;
+
+static WiFiUDP          animsync_udp;
+static IPAddress        animsync_group (239, 255, 24, 25);
+static bool             animsync_active;
+static uint32_t         animsync_id;
+static ANIMSYNC_NODE    animsync_nodes[ANIMSYNC_MAX_NODES];
+static uint32_t         animsync_leader_id;
+static IPAddress        animsync_leader_ip;
+static unsigned long    animsync_last_beacon;
+static unsigned long    animsync_last_request;
+
+static uint32_t         animsync_sample_offset[ANIMSYNC_SAMPLES];
+static uint32_t         animsync_sample_rtt[ANIMSYNC_SAMPLES];
+static unsigned long    animsync_sample_millis[ANIMSYNC_SAMPLES];       // millis() when sample was taken
+static uint_fast8_t     animsync_n_samples;
+static uint_fast8_t     animsync_sample_idx;
+static uint32_t         animsync_offset;                                // leader time - own time in usec (modulo 2^32)
+static uint32_t         animsync_rtt;                                   // round trip time of best sample in usec
+static bool             animsync_offset_valid;
+
+static unsigned long    animsync_last_tm_micros;
+static uint32_t         animsync_next_start;                            // leader time of next start
+static bool             animsync_start_pending;
+static uint8_t          animsync_start_payload[7];                      // START packet of leader
+static uint_fast8_t     animsync_start_repeats;                         // repetitions of START still to send
+static unsigned long    animsync_start_millis;                          // millis() of last START sent
+static uint32_t         animsync_last_start;                            // leader time of last START received
+static unsigned long    animsync_starts;                                // number of armed starts
+static unsigned long    animsync_misses;                                // number of missed starts
+static bool             animsync_last_missed;                           // last start missed, skew bound unknown
+
+static uint32_t         animsync_arm_micros;                            // micros() when "CMD Y" was sent
+static bool             animsync_arm_pending;                           // waiting for "sync-armed" of STM32
+static uint32_t         animsync_cmd_usec;                              // transfer and parse time of last "CMD Y"
+static uint32_t         animsync_late_usec;                             // STM32 start latency of last synchronized start
+
+static void
+animsync_put32 (uint8_t * p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static uint32_t
+animsync_get32 (const uint8_t * p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static bool
+animsync_is_leader (void)
+{
+    return animsync_leader_id == animsync_id;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * skew bound of own start in usec relative to the start time of the leader, see above
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+animsync_skew (void)
+{
+    uint32_t    skew = ANIMSYNC_ROUNDING_USEC + animsync_cmd_usec + animsync_late_usec + ANIMSYNC_DRIFT_USEC (ANIMSYNC_ANNOUNCE_USEC);
+
+    if (animsync_last_missed)
+    {
+        return ANIMSYNC_UNKNOWN_SKEW;
+    }
+
+    if (! animsync_is_leader ())
+    {
+        if (! animsync_offset_valid)
+        {
+            return ANIMSYNC_UNKNOWN_SKEW;
+        }
+
+        skew += animsync_rtt / 2 + ANIMSYNC_DRIFT_USEC (ANIMSYNC_MAX_SAMPLE_AGE_MSEC * 1000UL + ANIMSYNC_ANNOUNCE_USEC);
+    }
+
+    return skew;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * send packet, ip == animsync_group: multicast
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_send (IPAddress ip, uint_fast8_t type, const uint8_t * payload, uint_fast8_t len)
+{
+    uint8_t buf[ANIMSYNC_MAX_PACKET_LEN];
+
+    buf[0] = 'W';
+    buf[1] = 'C';
+    buf[2] = 'S';
+    buf[3] = ANIMSYNC_VERSION;
+    buf[4] = type;
+    animsync_put32 (buf + 5, animsync_id);
+    memcpy (buf + ANIMSYNC_HEADER_LEN, payload, len);
+
+    if (ip == animsync_group)
+    {
+        animsync_udp.beginPacketMulticast (animsync_group, ANIMSYNC_PORT, WiFi.localIP ());
+    }
+    else
+    {
+        animsync_udp.beginPacket (ip, ANIMSYNC_PORT);
+    }
+
+    animsync_udp.write (buf, ANIMSYNC_HEADER_LEN + len);
+    animsync_udp.endPacket ();
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * forget all offset samples, e.g. after change of leader
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_reset_samples (void)
+{
+    animsync_n_samples      = 0;
+    animsync_sample_idx     = 0;
+    animsync_offset_valid   = false;
+    animsync_start_pending  = false;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * elect leader: lowest chip id of all clocks seen within ANIMSYNC_NODE_TIMEOUT_MSEC
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_update_leader (void)
+{
+    unsigned long   now         = millis ();
+    uint32_t        leader_id   = animsync_id;
+    IPAddress       leader_ip   = WiFi.localIP ();
+    uint_fast8_t    idx;
+
+    for (idx = 0; idx < ANIMSYNC_MAX_NODES; idx++)
+    {
+        if (animsync_nodes[idx].id && now - animsync_nodes[idx].last_seen >= ANIMSYNC_NODE_TIMEOUT_MSEC)
+        {
+            debugmsg ("animsync: node gone", animsync_nodes[idx].ip.toString ().c_str ());
+            animsync_nodes[idx].id = 0;
+        }
+
+        if (animsync_nodes[idx].id && animsync_nodes[idx].id < leader_id)
+        {
+            leader_id = animsync_nodes[idx].id;
+            leader_ip = animsync_nodes[idx].ip;
+        }
+    }
+
+    if (leader_id != animsync_leader_id)
+    {
+        animsync_leader_id = leader_id;
+        animsync_leader_ip = leader_ip;
+        animsync_reset_samples ();
+        debugmsg ("animsync: new leader", leader_ip.toString ().c_str ());
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * remember clock which sent a beacon
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_node_seen (uint32_t id, uint32_t skew, IPAddress ip)
+{
+    uint_fast8_t    free_idx = ANIMSYNC_MAX_NODES;
+    uint_fast8_t    idx;
+
+    for (idx = 0; idx < ANIMSYNC_MAX_NODES; idx++)
+    {
+        if (animsync_nodes[idx].id == id)
+        {
+            break;
+        }
+
+        if (! animsync_nodes[idx].id && free_idx == ANIMSYNC_MAX_NODES)
+        {
+            free_idx = idx;
+        }
+    }
+
+    if (idx == ANIMSYNC_MAX_NODES)
+    {
+        if (free_idx == ANIMSYNC_MAX_NODES)
+        {
+            return;                                                     // table full, ignore clock
+        }
+
+        idx = free_idx;
+        animsync_nodes[idx].id = id;
+        debugmsg ("animsync: new node", ip.toString ().c_str ());
+    }
+
+    animsync_nodes[idx].skew        = skew;
+    animsync_nodes[idx].last_seen   = millis ();
+    animsync_nodes[idx].ip          = ip;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * use sample with shortest round trip time of the samples not older than ANIMSYNC_MAX_SAMPLE_AGE_MSEC
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_select_sample (void)
+{
+    unsigned long   now     = millis ();
+    uint_fast8_t    best    = ANIMSYNC_SAMPLES;
+    uint_fast8_t    idx;
+
+    for (idx = 0; idx < animsync_n_samples; idx++)
+    {
+        if (now - animsync_sample_millis[idx] <= ANIMSYNC_MAX_SAMPLE_AGE_MSEC &&
+            (best == ANIMSYNC_SAMPLES || animsync_sample_rtt[idx] < animsync_sample_rtt[best]))
+        {
+            best = idx;
+        }
+    }
+
+    if (best < ANIMSYNC_SAMPLES)
+    {
+        animsync_offset         = animsync_sample_offset[best];
+        animsync_rtt            = animsync_sample_rtt[best];
+        animsync_offset_valid   = true;
+    }
+    else
+    {
+        animsync_offset_valid   = false;
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * add offset sample
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_add_sample (uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4)
+{
+    uint32_t        rtt = (t4 - t1) - (t3 - t2);
+
+    if (rtt > ANIMSYNC_MAX_RTT_USEC)
+    {
+        return;
+    }
+
+    animsync_sample_offset[animsync_sample_idx] = (t2 - t1) + ((int32_t) ((t3 - t4) - (t2 - t1)) / 2);
+    animsync_sample_rtt[animsync_sample_idx]    = rtt;
+    animsync_sample_millis[animsync_sample_idx] = millis ();
+    animsync_sample_idx = (animsync_sample_idx + 1) % ANIMSYNC_SAMPLES;
+
+    if (animsync_n_samples < ANIMSYNC_SAMPLES)
+    {
+        animsync_n_samples++;
+    }
+
+    animsync_select_sample ();
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * arm STM32: start animation at own time start
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_arm (uint32_t start, uint_fast8_t mode, uint_fast16_t seed)
+{
+    uint32_t    now         = micros ();
+    int32_t     delay_usec  = (int32_t) (start - now) - ANIMSYNC_CMD_USEC;
+    int32_t     delay_msec  = (delay_usec + 500) / 1000;
+
+    if (delay_msec > 0 && delay_msec <= ANIMSYNC_MAX_DELAY_MSEC)
+    {
+        Serial.printf ("CMD Y%02x%04x%04x\r\n", mode, seed, (unsigned int) delay_msec);
+        Serial.flush ();
+        animsync_arm_micros     = now;
+        animsync_arm_pending    = true;
+        animsync_starts++;
+    }
+    else
+    {
+        animsync_misses++;
+        animsync_last_missed = true;
+        debugmsg ("animsync: start missed", "");
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * STM32 has parsed "CMD Y": measure transfer and parse time of the command
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+animsync_armed (void)
+{
+    uint32_t    usec;
+
+    if (animsync_arm_pending)
+    {
+        animsync_arm_pending = false;
+        usec = micros () - animsync_arm_micros;
+        animsync_cmd_usec = (usec > ANIMSYNC_CMD_USEC) ? usec - ANIMSYNC_CMD_USEC : 0;
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * STM32 has started the synchronized animation usec after the start time
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+animsync_late (uint32_t usec)
+{
+    animsync_late_usec      = usec;
+    animsync_last_missed    = false;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * STM32 had no animation to start at the start time, the clock is not synchronized
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+animsync_missed (void)
+{
+    animsync_misses++;
+    animsync_last_missed = true;
+    debugmsg ("animsync: start missed by STM32", "");
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * handle received packets
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_receive (void)
+{
+    uint8_t     buf[ANIMSYNC_MAX_PACKET_LEN];
+    uint8_t     payload[12];
+    uint32_t    now;
+    uint32_t    id;
+    int         len;
+
+    while ((len = animsync_udp.parsePacket ()) > 0)
+    {
+        now = micros ();
+
+        if (len < ANIMSYNC_HEADER_LEN || len > ANIMSYNC_MAX_PACKET_LEN)
+        {
+            continue;                                                   // next parsePacket() skips rest of packet
+        }
+
+        animsync_udp.read (buf, len);
+
+        if (buf[0] != 'W' || buf[1] != 'C' || buf[2] != 'S' || buf[3] != ANIMSYNC_VERSION)
+        {
+            continue;
+        }
+
+        id = animsync_get32 (buf + 5);
+
+        if (id == animsync_id)
+        {
+            continue;                                                   // own multicast packet
+        }
+
+        len -= ANIMSYNC_HEADER_LEN;
+
+        switch (buf[4])
+        {
+            case ANIMSYNC_BEACON:
+            {
+                if (len >= 4)
+                {
+                    animsync_node_seen (id, animsync_get32 (buf + ANIMSYNC_HEADER_LEN), animsync_udp.remoteIP ());
+                }
+                break;
+            }
+
+            case ANIMSYNC_REQUEST:
+            {
+                if (len >= 4 && animsync_is_leader ())
+                {
+                    memcpy (payload, buf + ANIMSYNC_HEADER_LEN, 4);
+                    animsync_put32 (payload + 4, now);
+                    animsync_put32 (payload + 8, micros ());
+                    animsync_send (animsync_udp.remoteIP (), ANIMSYNC_RESPONSE, payload, 12);
+                }
+                break;
+            }
+
+            case ANIMSYNC_RESPONSE:
+            {
+                if (len >= 12 && id == animsync_leader_id)
+                {
+                    animsync_add_sample (animsync_get32 (buf + ANIMSYNC_HEADER_LEN), animsync_get32 (buf + ANIMSYNC_HEADER_LEN + 4),
+                                         animsync_get32 (buf + ANIMSYNC_HEADER_LEN + 8), now);
+                }
+                break;
+            }
+
+            case ANIMSYNC_START:
+            {
+                uint8_t * p = buf + ANIMSYNC_HEADER_LEN;
+
+                if (len >= 7 && id == animsync_leader_id && animsync_get32 (p) != animsync_last_start)     // ignore repetitions
+                {
+                    animsync_last_start = animsync_get32 (p);
+
+                    if (animsync_offset_valid)
+                    {
+                        animsync_arm (animsync_last_start - animsync_offset, p[4], (p[5] << 8) | p[6]);
+                    }
+                    else                                                // no valid offset: cannot follow
+                    {
+                        animsync_misses++;
+                        animsync_last_missed = true;
+                    }
+                }
+                break;
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * leader: announce start of next minute animation
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animsync_schedule (void)
+{
+    uint8_t *       payload = animsync_start_payload;
+    uint_fast8_t    mode;
+    uint_fast16_t   seed;
+
+    if (current_tm_micros != animsync_last_tm_micros)                   // STM32 sent time, happens at minute change
+    {
+        animsync_last_tm_micros = current_tm_micros;
+
+        if (get_tm_var (CURRENT_TM_VAR)->tm_sec == 0)
+        {
+            animsync_next_start     = current_tm_micros + 60000000UL + ANIMSYNC_START_DELAY_USEC;
+            animsync_start_pending  = true;
+        }
+    }
+
+    if (animsync_start_pending && (int32_t) (micros () - (animsync_next_start - ANIMSYNC_ANNOUNCE_USEC)) >= 0)
+    {
+        animsync_start_pending = false;
+
+        mode = get_numvar (ANIMATION_MODE_NUM_VAR);
+        seed = ESP.random () & 0xFFFF;
+
+        animsync_put32 (payload, animsync_next_start);
+        payload[4] = mode;
+        payload[5] = seed >> 8;
+        payload[6] = seed;
+        animsync_send (animsync_group, ANIMSYNC_START, payload, 7);
+        animsync_arm (animsync_next_start, mode, seed);
+
+        animsync_start_repeats  = ANIMSYNC_START_REPEATS - 1;
+        animsync_start_millis   = millis ();
+    }
+    else if (animsync_start_repeats > 0 && millis () - animsync_start_millis >= ANIMSYNC_START_REPEAT_MSEC)
+    {
+        animsync_start_repeats--;
+        animsync_start_millis = millis ();
+        animsync_send (animsync_group, ANIMSYNC_START, payload, 7);
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * animation sync loop, called from main loop
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+animsync_loop (void)
+{
+    bool            enabled;
+    unsigned long   now;
+    uint8_t         payload[4];
+    uint_fast8_t    idx;
+
+    enabled = (eeprom_flags & EEPROM_FLAG_SYNC_ANIMATIONS) && ! wifi_ap_mode && WiFi.status () == WL_CONNECTED;
+
+    if (enabled != animsync_active)
+    {
+        if (enabled)
+        {
+            animsync_id             = ESP.getChipId ();
+            animsync_leader_id      = animsync_id;
+            animsync_leader_ip      = WiFi.localIP ();
+            animsync_last_tm_micros = current_tm_micros;
+
+            for (idx = 0; idx < ANIMSYNC_MAX_NODES; idx++)
+            {
+                animsync_nodes[idx].id = 0;
+            }
+
+            animsync_reset_samples ();
+            animsync_udp.beginMulticast (WiFi.localIP (), animsync_group, ANIMSYNC_PORT);
+            debugmsg ("animsync: started", "");
+        }
+        else
+        {
+            animsync_udp.stop ();
+            debugmsg ("animsync: stopped", "");
+        }
+
+        animsync_active = enabled;
+    }
+
+    if (! animsync_active)
+    {
+        return;
+    }
+
+    if (animsync_n_samples > 0)
+    {
+        animsync_select_sample ();                                      // drop samples which became too old
+    }
+
+    animsync_receive ();
+    animsync_update_leader ();
+
+    now = millis ();
+
+    if (now - animsync_last_beacon >= ANIMSYNC_BEACON_MSEC)
+    {
+        animsync_last_beacon = now;
+
+        animsync_put32 (payload, animsync_skew ());
+        animsync_send (animsync_group, ANIMSYNC_BEACON, payload, 4);
+    }
+
+    if (animsync_is_leader ())
+    {
+        animsync_schedule ();
+    }
+    else if (now - animsync_last_request >= ANIMSYNC_REQUEST_MSEC)
+    {
+        animsync_last_request = now;
+        animsync_put32 (payload, micros ());
+        animsync_send (animsync_leader_ip, ANIMSYNC_REQUEST, payload, 4);
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * state of animation sync for web interface, buf must hold ANIMSYNC_INFO_SIZE bytes
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+animsync_info (char * buf)
+{
+    uint32_t        skew1   = animsync_skew ();                         // largest skew bound of all clocks
+    uint32_t        skew2   = 0;                                        // second largest skew bound
+    uint32_t        skew;
+    uint_fast8_t    n_nodes = 0;
+    uint_fast8_t    idx;
+
+    if (! animsync_active)
+    {
+        strcpy (buf, "off");
+    }
+    else if (animsync_is_leader ())
+    {
+        for (idx = 0; idx < ANIMSYNC_MAX_NODES; idx++)
+        {
+            if (animsync_nodes[idx].id)
+            {
+                n_nodes++;
+                skew = animsync_nodes[idx].skew;
+
+                if (skew > skew1)
+                {
+                    skew2 = skew1;
+                    skew1 = skew;
+                }
+                else if (skew > skew2)
+                {
+                    skew2 = skew;
+                }
+            }
+        }
+
+        if (skew1 == ANIMSYNC_UNKNOWN_SKEW)
+        {
+            sprintf (buf, "leader, %u followers, skew unknown, %lu starts, %lu missed", (unsigned int) n_nodes, animsync_starts,
+                     animsync_misses);
+        }
+        else                                                            // skew of two clocks: sum of their skew bounds
+        {
+            snprintf (buf, ANIMSYNC_INFO_SIZE, "leader, %u followers, skew < %lu usec (STM32 %lu usec), %lu starts, %lu missed",
+                      (unsigned int) n_nodes, (unsigned long) (skew1 + skew2), (unsigned long) (animsync_cmd_usec + animsync_late_usec),
+                      animsync_starts, animsync_misses);
+        }
+    }
+    else if (animsync_offset_valid && animsync_last_missed)
+    {
+        sprintf (buf, "follower of %s, skew unknown, %lu starts, %lu missed", animsync_leader_ip.toString ().c_str (), animsync_starts,
+                 animsync_misses);
+    }
+    else if (animsync_offset_valid)
+    {
+        snprintf (buf, ANIMSYNC_INFO_SIZE, "follower of %s, offset %ld usec, rtt %lu usec, skew < %lu usec (STM32 %lu usec), %lu starts, "
+                  "%lu missed", animsync_leader_ip.toString ().c_str (), (long) (int32_t) animsync_offset, (unsigned long) animsync_rtt,
+                  (unsigned long) animsync_skew (), (unsigned long) (animsync_cmd_usec + animsync_late_usec), animsync_starts,
+                  animsync_misses);
+    }
+    else
+    {
+        sprintf (buf, "follower of %s, measuring offset", animsync_leader_ip.toString ().c_str ());
+    }
+}
@@ -0,0 +1,23 @@
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * animsync.h - synchronized animations of several clocks via UDP multicast
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef ANIMSYNC_H
+#define ANIMSYNC_H
+
+#define ANIMSYNC_INFO_SIZE          160
+
+extern void     animsync_loop (void);
+extern void     animsync_armed (void);
+extern void     animsync_late (uint32_t);
+extern void     animsync_missed (void);
+extern void     animsync_info (char *);
+
+#endif
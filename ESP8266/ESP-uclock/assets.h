@@ -0,0 +1,111 @@
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * assets.h - precompressed static web assets
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ *
+ * Generated from style.css, regenerate after changing style.css:
+ *
+ *      gzip -9 -n -c style.css | xxd -i            -> style_css_gz[]
+ *      xxd -i style.css                            -> style_css[]         for clients without gzip
+ *      crc32 style.css                             -> STYLE_CSS_VERSION
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#define STYLE_CSS_VERSION               "15f9d6e3"                              // CRC32 of style.css, used as ETag and in URL
+
+static const uint8_t style_css_gz[] PROGMEM =
+{
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8d, 0x53, 0x4d, 0x6b, 0xdb, 0x40,
+    0x10, 0xbd, 0x1b, 0xfc, 0x1f, 0x86, 0x94, 0x5e, 0x8a, 0x64, 0x64, 0xb7, 0x94, 0xa0, 0xd0, 0x43,
+    0xdc, 0x3a, 0x28, 0xe0, 0xc4, 0x87, 0xa8, 0x81, 0xb4, 0xf4, 0xb0, 0xda, 0x1d, 0xc9, 0x83, 0x37,
+    0xbb, 0x62, 0x77, 0x65, 0x9c, 0x8a, 0xfe, 0xf7, 0xee, 0xae, 0x1c, 0x37, 0x8e, 0xa1, 0xed, 0x9c,
+    0xc4, 0x7b, 0x6f, 0xe7, 0xe3, 0xcd, 0xe8, 0x1d, 0xf4, 0xd0, 0x32, 0x21, 0x48, 0x35, 0x39, 0x64,
+    0x17, 0xf0, 0xc8, 0x4c, 0x43, 0x2a, 0x7e, 0x5e, 0xad, 0x6e, 0xcb, 0xf4, 0xea, 0xf2, 0xe6, 0x7a,
+    0xf9, 0x90, 0xc3, 0x3d, 0x1a, 0xc1, 0x14, 0x4b, 0x0a, 0x94, 0x5b, 0x74, 0xc4, 0x59, 0x62, 0x99,
+    0xb2, 0xa9, 0x45, 0x43, 0xf5, 0x5e, 0x7a, 0x77, 0xfd, 0x6d, 0x91, 0xc3, 0xf4, 0x43, 0xbb, 0xfb,
+    0x35, 0x1e, 0xcd, 0x57, 0x5f, 0x1e, 0x12, 0x28, 0xca, 0x9b, 0x25, 0xf4, 0x6b, 0xa4, 0x66, 0xed,
+    0x3c, 0x95, 0x65, 0x6f, 0x3d, 0x55, 0x4c, 0xa1, 0x7f, 0xf1, 0x60, 0x36, 0x3c, 0x28, 0x66, 0x47,
+    0xe8, 0xf4, 0x7c, 0x40, 0xdf, 0x1f, 0xa3, 0x1f, 0x23, 0x5a, 0x16, 0xd0, 0x73, 0x2d, 0xb5, 0xc9,
+    0x41, 0x30, 0xb3, 0xa9, 0x64, 0x87, 0x1e, 0xbd, 0x84, 0xde, 0xe1, 0xce, 0xa5, 0x02, 0xb9, 0x36,
+    0xcc, 0x91, 0xf6, 0x63, 0x28, 0xad, 0x22, 0x95, 0x4b, 0x52, 0x1b, 0xe8, 0x2b, 0xc6, 0x37, 0x8d,
+    0xd1, 0x9d, 0x12, 0x03, 0x75, 0x01, 0xfb, 0x34, 0x6f, 0xd0, 0x47, 0x96, 0x45, 0xe9, 0x96, 0x2c,
+    0x39, 0x14, 0xff, 0xa9, 0x5e, 0xeb, 0x2d, 0x9a, 0xbf, 0x69, 0xeb, 0x18, 0x51, 0xcb, 0xb8, 0xa3,
+    0x2d, 0xfe, 0x4b, 0x1c, 0x13, 0xdf, 0x2d, 0x96, 0x8b, 0xcf, 0x65, 0x32, 0xff, 0x5a, 0x96, 0xab,
+    0xdb, 0x64, 0x52, 0x75, 0xce, 0x69, 0x95, 0x4c, 0x78, 0x67, 0x9d, 0x7e, 0x4c, 0x6b, 0x92, 0x98,
+    0x76, 0xad, 0xd4, 0x4c, 0x8c, 0x47, 0xfd, 0x78, 0x04, 0x27, 0x19, 0x03, 0xa6, 0x8d, 0x40, 0x9f,
+    0x74, 0xda, 0xee, 0xc0, 0x6a, 0x49, 0xe2, 0x0f, 0x98, 0x3e, 0xd7, 0xcb, 0x7c, 0xd4, 0x75, 0x20,
+    0x4e, 0x91, 0xc3, 0x59, 0xf8, 0x05, 0x81, 0x5f, 0x47, 0xc0, 0xa2, 0xc1, 0x4c, 0x52, 0xe3, 0xbd,
+    0xe5, 0xa8, 0x1c, 0x9a, 0x03, 0xfa, 0xda, 0xf6, 0x40, 0x08, 0xb2, 0xad, 0x64, 0x4f, 0x39, 0x90,
+    0xf2, 0x0b, 0xc0, 0xb4, 0x92, 0x9a, 0x6f, 0x02, 0x51, 0x6b, 0xe5, 0x52, 0x4b, 0x3f, 0xd1, 0xb7,
+    0x37, 0x1b, 0x52, 0x3f, 0x5f, 0x5e, 0xa8, 0xb6, 0x87, 0x78, 0x67, 0x6c, 0x68, 0xaa, 0xd5, 0xb4,
+    0x2f, 0x15, 0x2e, 0x2b, 0x5a, 0x32, 0xf8, 0xfe, 0x7a, 0xf8, 0xa3, 0xb9, 0xe6, 0xd9, 0xcb, 0xb9,
+    0x06, 0x67, 0x87, 0x14, 0xa4, 0xda, 0xce, 0x7d, 0x77, 0x4f, 0x2d, 0x7e, 0x3a, 0x0b, 0x56, 0x9e,
+    0xfd, 0xf0, 0x7f, 0xc1, 0xa1, 0xd7, 0x61, 0x23, 0x5e, 0x36, 0xa9, 0xa8, 0x71, 0xac, 0x92, 0x78,
+    0x72, 0xc2, 0xbf, 0x01, 0xe3, 0xd6, 0xf9, 0x15, 0x36, 0x03, 0x00, 0x00
+};
+
+static const uint8_t style_css[] PROGMEM =
+{
+    0x2a, 0x20, 0x7b, 0x20, 0x70, 0x61, 0x64, 0x64, 0x69, 0x6e, 0x67, 0x3a, 0x20, 0x30, 0x3b, 0x20,
+    0x6d, 0x61, 0x72, 0x67, 0x69, 0x6e, 0x3a, 0x20, 0x30, 0x3b, 0x20, 0x46, 0x4f, 0x4e, 0x54, 0x2d,
+    0x46, 0x41, 0x4d, 0x49, 0x4c, 0x59, 0x3a, 0x20, 0x56, 0x65, 0x72, 0x64, 0x61, 0x6e, 0x61, 0x2c,
+    0x48, 0x65, 0x6c, 0x76, 0x65, 0x74, 0x69, 0x63, 0x61, 0x2c, 0x73, 0x61, 0x6e, 0x73, 0x2d, 0x73,
+    0x65, 0x72, 0x69, 0x66, 0x3b, 0x20, 0x46, 0x4f, 0x4e, 0x54, 0x2d, 0x53, 0x49, 0x5a, 0x45, 0x3a,
+    0x20, 0x31, 0x34, 0x70, 0x78, 0x7d, 0x0d, 0x0a, 0x42, 0x4f, 0x44, 0x59, 0x2c, 0x20, 0x48, 0x54,
+    0x4d, 0x4c, 0x20, 0x7b, 0x68, 0x65, 0x69, 0x67, 0x68, 0x74, 0x3a, 0x20, 0x31, 0x30, 0x30, 0x25,
+    0x7d, 0x0d, 0x0a, 0x48, 0x31, 0x20, 0x7b, 0x46, 0x4f, 0x4e, 0x54, 0x2d, 0x53, 0x49, 0x5a, 0x45,
+    0x3a, 0x20, 0x32, 0x34, 0x70, 0x78, 0x7d, 0x0d, 0x0a, 0x48, 0x32, 0x20, 0x7b, 0x46, 0x4f, 0x4e,
+    0x54, 0x2d, 0x53, 0x49, 0x5a, 0x45, 0x3a, 0x20, 0x31, 0x38, 0x70, 0x78, 0x7d, 0x0d, 0x0a, 0x48,
+    0x33, 0x20, 0x7b, 0x46, 0x4f, 0x4e, 0x54, 0x2d, 0x53, 0x49, 0x5a, 0x45, 0x3a, 0x20, 0x31, 0x36,
+    0x70, 0x78, 0x7d, 0x0d, 0x0a, 0x54, 0x48, 0x20, 0x7b, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20,
+    0x64, 0x61, 0x72, 0x6b, 0x62, 0x6c, 0x75, 0x65, 0x7d, 0x0d, 0x0a, 0x41, 0x20, 0x7b, 0x74, 0x65,
+    0x78, 0x74, 0x2d, 0x64, 0x65, 0x63, 0x6f, 0x72, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x3a, 0x20, 0x6e,
+    0x6f, 0x6e, 0x65, 0x7d, 0x0d, 0x0a, 0x41, 0x3a, 0x6c, 0x69, 0x6e, 0x6b, 0x20, 0x7b, 0x62, 0x61,
+    0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64, 0x3a, 0x20, 0x6e, 0x6f, 0x6e, 0x65, 0x3b, 0x20,
+    0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x65, 0x65, 0x65, 0x65, 0x30, 0x30, 0x7d, 0x0d,
+    0x0a, 0x41, 0x3a, 0x76, 0x69, 0x73, 0x69, 0x74, 0x65, 0x64, 0x20, 0x7b, 0x62, 0x61, 0x63, 0x6b,
+    0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64, 0x3a, 0x20, 0x6e, 0x6f, 0x6e, 0x65, 0x3b, 0x20, 0x63, 0x6f,
+    0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x65, 0x65, 0x65, 0x65, 0x30, 0x30, 0x7d, 0x0d, 0x0a, 0x41,
+    0x3a, 0x68, 0x6f, 0x76, 0x65, 0x72, 0x20, 0x7b, 0x62, 0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75,
+    0x6e, 0x64, 0x3a, 0x20, 0x6e, 0x6f, 0x6e, 0x65, 0x3b, 0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a,
+    0x20, 0x23, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x7d, 0x0d, 0x0a, 0x41, 0x3a, 0x61, 0x63, 0x74,
+    0x69, 0x76, 0x65, 0x20, 0x7b, 0x62, 0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64, 0x3a,
+    0x20, 0x6e, 0x6f, 0x6e, 0x65, 0x3b, 0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x66,
+    0x66, 0x66, 0x66, 0x30, 0x30, 0x7d, 0x0d, 0x0a, 0x53, 0x45, 0x4c, 0x45, 0x43, 0x54, 0x2c, 0x42,
+    0x55, 0x54, 0x54, 0x4f, 0x4e, 0x2c, 0x2e, 0x62, 0x75, 0x74, 0x74, 0x6f, 0x6e, 0x2c, 0x2e, 0x63,
+    0x75, 0x73, 0x74, 0x6f, 0x6d, 0x2d, 0x66, 0x69, 0x6c, 0x65, 0x2d, 0x75, 0x70, 0x6c, 0x6f, 0x61,
+    0x64, 0x0d, 0x0a, 0x7b, 0x0d, 0x0a, 0x20, 0x62, 0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e,
+    0x64, 0x3a, 0x20, 0x6e, 0x6f, 0x6e, 0x65, 0x3b, 0x0d, 0x0a, 0x20, 0x62, 0x6f, 0x72, 0x64, 0x65,
+    0x72, 0x3a, 0x20, 0x31, 0x70, 0x78, 0x20, 0x73, 0x6f, 0x6c, 0x69, 0x64, 0x3b, 0x0d, 0x0a, 0x20,
+    0x62, 0x6f, 0x72, 0x64, 0x65, 0x72, 0x2d, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x30,
+    0x30, 0x30, 0x30, 0x66, 0x66, 0x3b, 0x0d, 0x0a, 0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20,
+    0x23, 0x30, 0x30, 0x30, 0x30, 0x66, 0x66, 0x3b, 0x0d, 0x0a, 0x20, 0x70, 0x61, 0x64, 0x64, 0x69,
+    0x6e, 0x67, 0x3a, 0x20, 0x34, 0x70, 0x78, 0x20, 0x38, 0x70, 0x78, 0x3b, 0x0d, 0x0a, 0x20, 0x74,
+    0x65, 0x78, 0x74, 0x2d, 0x61, 0x6c, 0x69, 0x67, 0x6e, 0x3a, 0x20, 0x63, 0x65, 0x6e, 0x74, 0x65,
+    0x72, 0x3b, 0x0d, 0x0a, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2d, 0x64, 0x65, 0x63, 0x6f, 0x72, 0x61,
+    0x74, 0x69, 0x6f, 0x6e, 0x3a, 0x20, 0x6e, 0x6f, 0x6e, 0x65, 0x3b, 0x0d, 0x0a, 0x20, 0x64, 0x69,
+    0x73, 0x70, 0x6c, 0x61, 0x79, 0x3a, 0x20, 0x69, 0x6e, 0x6c, 0x69, 0x6e, 0x65, 0x2d, 0x62, 0x6c,
+    0x6f, 0x63, 0x6b, 0x3b, 0x0d, 0x0a, 0x20, 0x66, 0x6f, 0x6e, 0x74, 0x2d, 0x73, 0x69, 0x7a, 0x65,
+    0x3a, 0x20, 0x31, 0x32, 0x70, 0x78, 0x3b, 0x0d, 0x0a, 0x20, 0x6d, 0x61, 0x72, 0x67, 0x69, 0x6e,
+    0x3a, 0x20, 0x34, 0x70, 0x78, 0x20, 0x32, 0x70, 0x78, 0x3b, 0x0d, 0x0a, 0x20, 0x63, 0x75, 0x72,
+    0x73, 0x6f, 0x72, 0x3a, 0x20, 0x70, 0x6f, 0x69, 0x6e, 0x74, 0x65, 0x72, 0x3b, 0x0d, 0x0a, 0x7d,
+    0x0d, 0x0a, 0x42, 0x55, 0x54, 0x54, 0x4f, 0x4e, 0x3a, 0x68, 0x6f, 0x76, 0x65, 0x72, 0x0d, 0x0a,
+    0x7b, 0x0d, 0x0a, 0x20, 0x62, 0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64, 0x2d, 0x63,
+    0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x30, 0x30, 0x30, 0x30, 0x42, 0x30, 0x3b, 0x0d, 0x0a,
+    0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x20, 0x23, 0x66, 0x66, 0x66, 0x66, 0x30, 0x30, 0x3b,
+    0x0d, 0x0a, 0x7d, 0x0d, 0x0a, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x5b, 0x74, 0x79, 0x70, 0x65, 0x3d,
+    0x22, 0x66, 0x69, 0x6c, 0x65, 0x22, 0x5d, 0x20, 0x7b, 0x20, 0x64, 0x69, 0x73, 0x70, 0x6c, 0x61,
+    0x79, 0x3a, 0x20, 0x6e, 0x6f, 0x6e, 0x65, 0x3b, 0x20, 0x7d, 0x0d, 0x0a, 0x2e, 0x62, 0x69, 0x67,
+    0x74, 0x61, 0x62, 0x6c, 0x65, 0x20, 0x7b, 0x68, 0x65, 0x69, 0x67, 0x68, 0x74, 0x3a, 0x20, 0x31,
+    0x30, 0x30, 0x25, 0x7d, 0x0d, 0x0a
+};
+
+#endif
@@ -39,6 +39,7 @@
  *----------------------------------------------------------------------------------------------------------------------------------------
  */
 #define EEPROM_FLAG_BOOT_AS_AP      0x01
+#define EEPROM_FLAG_SYNC_ANIMATIONS 0x02                                // synchronize animations with other clocks
 
 /*----------------------------------------------------------------------------------------------------------------------------------------
  * Lengths of EEPROM values
@@ -20,9 +20,13 @@
 #include "version.h"
 #include "http.h"
 #include "httpclient.h"
+#include "weather.h"
 #include "stm32flash.h"
+#include "udpsrv.h"
+#include "animsync.h"
 #include "tables.h"
 #include "eepromdata.h"
+#include "assets.h"
 
 #define WCLOCK24H   1
 
@@ -59,10 +63,13 @@ static uint_fast16_t        hardware_configuration = 0xFFFF;
 #define MAX_PATH_LEN                                20                              // max. length of path
 #define MAX_HTTP_PARAMS                             16                              // max. number of http parameters
 
+#define HTTP_PARAM_INDEX_SIZE                       32                              // size of hash index, power of 2, > MAX_HTTP_PARAMS
+
 typedef struct
 {
-    char *  name;
-    char *  value;
+    char *      name;
+    char *      value;
+    uint32_t    hash;                                                                   // hash of name
 } HTTP_PARAMETERS;
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
@@ -70,6 +77,8 @@ typedef struct
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static HTTP_PARAMETERS                              http_parameters[MAX_HTTP_PARAMS];
+static int                                          http_n_parameters;
+static int8_t                                       http_param_index[HTTP_PARAM_INDEX_SIZE];        // index into http_parameters, -1: empty
 static int                                          bgcolor_cnt;
 
 #define MAX_KEY_LEN                                 64
@@ -83,7 +92,6 @@ static int                                          bgcolor_cnt;
 #define MAX_MINUTE_INTERVAL_LEN                     2
 #define MAX_TICKER_DECELERATION_LEN                 3
 #define MAX_RAINBOW_DECELERATION_LEN                3
-#define MAX_RAW_VALUE_LEN                           5
 #define MAX_ANIMATION_DECELERATION_LEN              2
 #define MAX_COLOR_ANIMATION_DECELERATION_LEN        2
 #define MAX_AMBILIGHT_MODE_DECELERATION_LEN         2
@@ -107,10 +115,6 @@ static int                                          bgcolor_cnt;
 #define DFPLAYER_HEADER_COLS                        3
 #define DFPLAYER_SILENCE_COLS                       4
 
-#define MAX_HTTP_RESPONSE_LEN                       1024
-static char     http_response[MAX_HTTP_RESPONSE_LEN + 1];
-static int      http_response_len = 0;
-
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * display flags:
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -143,834 +147,1432 @@ static int      http_response_len = 0;
  */
 #define MAX_UPDATE_FILENAME_LEN                     64
 
+#define MAX_HTTP_RESPONSE_LEN                       1024
+static char     http_response[MAX_HTTP_RESPONSE_LEN + 1];
+static int      http_response_len = 0;
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * flush output buffer
+ * http connections:
+ *
+ * The server handles up to HTTP_MAX_CONNECTIONS clients. Requests are read without waiting, a page is rendered in one go into
+ * output blocks of a small pool and sent in the following calls of http_server_loop() as far as the TCP window of the client
+ * allows, so a slow browser does not stall the main loop. Pages which run long operations or read the request themselves
+ * (POST, update, network, ...) are still written directly to the client.
+ *
+ * If the output pool is exhausted, generation of the page is suspended: the rest of the page is discarded and the page is generated
+ * again when the queued output has been sent, skipping the part already sent. A hash of this part detects a page which has changed
+ * in the meantime, such a response is aborted. The page is generated again without parameters, so a request with parameters, which
+ * may change settings, waits until the complete pool is free. Meanwhile no other page is started or resumed, so it waits at most
+ * until the other responses are sent or their clients are dropped. An HTTP/1.1 response with suspended generation is sent with
+ * chunked transfer encoding, other responses are closed after the output.
+ *
+ * The page builders are not streamed straight into the client: WiFiClient::write() blocks while the TCP window of a slow client
+ * is full and lwIP copies the data anyway. One copy into the pool keeps the main loop running and needs only a few KB of the
+ * ESP8266's RAM. Chunked encoding is therefore used only for pages which do not fit into the pool, all others need no framing:
+ * they are sent with Content-Length or closed after the output.
+ *
+ * Static assets (style.css) are sent directly from flash with long cache time and ETag, gzip-precompressed to clients accepting
+ * gzip, else uncompressed.
+ *
+ * Clients of /api/events (server-sent events) keep their connection: each change of the variables is sent as event with the
+ * changed variables only. While an event is still queued, further changes are collected into the next event, a client which
+ * does not take any data for HTTP_SEND_TIMEOUT is dropped.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-void
-http_flush (void)
+#define HTTP_MAX_CONNECTIONS                        4
+#define HTTP_MAX_REQUEST_LEN                        (ESP8266_MAX_HTTP_GET_PARAM_SIZE + 64)  // max length of request line
+#define HTTP_MAX_HEADER_LINE_LEN                    63                                      // only start of header lines is needed
+#define HTTP_MAX_RESPONSE_HEADER_LEN                255
+#define HTTP_MAX_ETAG_LEN                           15
+#define HTTP_MAX_EVENT_CLIENTS                      2                                       // leave connections for pages
+#define HTTP_EVENT_MIN_FREE_BLOCKS                  4                                       // output blocks needed to render an event
+#define HTTP_EVENT_HEARTBEAT                        15000                                   // send comment if idle, msec
+#define HTTP_OUTPUT_BLOCK_SIZE                      1024
+#define HTTP_MAX_OUTPUT_BLOCKS                      16                                      // output blocks of all connections
+#define HTTP_KEEP_OUTPUT_BLOCKS                     4                                       // free blocks kept for next responses
+#define HTTP_RESUME_MIN_FREE_BLOCKS                 2                                       // output blocks needed to resume a page
+#define HTTP_REQUEST_TIMEOUT                        2000                                    // msec for complete request header
+#define HTTP_KEEPALIVE_TIMEOUT                      5000                                    // msec idle time of kept-alive connection
+#define HTTP_SEND_TIMEOUT                           5000                                    // msec without any send progress
+
+#define HTTP_CONN_FREE                              0                                       // slot is free
+#define HTTP_CONN_REQUEST                           1                                       // reading request line and header
+#define HTTP_CONN_WAIT                              2                                       // request complete, waiting for output pool
+#define HTTP_CONN_SEND                              3                                       // sending response
+#define HTTP_CONN_EVENTS                            4                                       // waiting for changes to send as event
+
+#define HTTP_HASH_INIT                              2166136261U                             // FNV-1a
+
+typedef struct HTTP_BLOCK
 {
-    if (http_response_len > 0)
-    {
-        http_client.print (http_response);
-        http_client.flush ();
-        http_response[0] = '\0';
-        http_response_len = 0;
-    }
-}
+    struct HTTP_BLOCK *     next;
+    int                     len;
+    char                    data[HTTP_OUTPUT_BLOCK_SIZE];
+} HTTP_BLOCK;
 
-static void
-http_concat_response (const char * s, int len)
+typedef struct
 {
-    strncpy (http_response + http_response_len, s, len);
-    http_response_len += len;
-    http_response[http_response_len] = '\0';
-}
+    WiFiClient              client;
+    uint8_t                 state;                                                          // HTTP_CONN_xxx
+    uint8_t                 in_header;                                                      // request line read, reading header lines
+    uint8_t                 http11;                                                         // client uses HTTP/1.1
+    uint8_t                 keep_alive;                                                     // keep connection after response
+    uint8_t                 direct;                                                         // response is written directly
+    uint8_t                 chunked;                                                        // response uses chunked transfer encoding
+    uint8_t                 accept_gzip;                                                    // client accepts gzip encoding
+    uint8_t                 events;                                                         // connection is an event stream
+    uint8_t                 suspended;                                                      // page generation suspended, pool exhausted
+    uint8_t                 resume_failed;                                                  // page has changed while suspended
+    uint8_t                 chunk_open;                                                     // chunk sent, CRLF needed before next one
+    uint8_t                 chunk_framed;                                                   // size line of out_head queued
+    uint8_t                 chunk_done;                                                     // last chunk queued
+    uint16_t                request_len;
+    char                    request[HTTP_MAX_REQUEST_LEN + 1];                              // request line
+    uint8_t                 line_len;
+    char                    line[HTTP_MAX_HEADER_LINE_LEN + 1];                             // start of current header line
+    char                    if_none_match[HTTP_MAX_ETAG_LEN + 1];                           // ETag sent by client
+    const char *            status;                                                         // set by http_send_status()
+    const char *            content_type;                                                   // optional header fields of response
+    const char *            content_encoding;
+    const char *            vary;
+    const char *            cache_control;
+    char                    etag[HTTP_MAX_ETAG_LEN + 1];
+    char                    header[HTTP_MAX_RESPONSE_HEADER_LEN + 1];                       // response header
+    uint16_t                header_len;
+    uint16_t                header_pos;                                                     // bytes of header already sent
+    char                    frame[12];                                                      // chunk size line or end of chunked body
+    uint8_t                 frame_len;
+    uint8_t                 frame_pos;
+    const char *            page;                                                           // path of buffered page, for resume
+    uint32_t                body_hash;                                                      // hash of queued body
+    int                     skip;                                                           // resume: bytes still to skip
+    uint32_t                skip_hash;                                                      // resume: hash of skipped bytes
+    const uint8_t *         body_P;                                                         // static body in flash, sent after blocks
+    int                     body_P_len;
+    int                     body_P_pos;
+    HTTP_BLOCK *            out_head;                                                       // queued response body
+    HTTP_BLOCK *            out_tail;
+    int                     out_pos;                                                        // bytes of out_head already sent
+    int                     body_len;                                                       // bytes of body queued
+    uint32_t                event_gen;                                                      // generation of last event sent
+    uint32_t                last_event_id;                                                  // Last-Event-ID of reconnecting client
+    unsigned long           start;                                                          // millis() of first byte of request
+    unsigned long           last_activity;                                                  // millis() of last progress
+} HTTP_CONNECTION;
+
+static HTTP_CONNECTION      http_connections[HTTP_MAX_CONNECTIONS];
+static HTTP_CONNECTION *    http_conn;                                                      // connection of current buffered response
+static HTTP_BLOCK *         http_free_blocks;
+static int                  http_n_free_blocks;
+static int                  http_n_blocks;                                                  // allocated blocks
+static bool                 http_exclusive_wait;                                            // request with parameters waits for pool
+
+HTTP_STATS                  http_stats;
+
+static const unsigned long  http_latency_limits[HTTP_LATENCY_BUCKETS - 1] = { 5, 10, 20, 50, 100, 200, 500, 1000 };
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * send string
+ * allocate output block, up to HTTP_KEEP_OUTPUT_BLOCKS blocks are kept in a free list to avoid heap fragmentation
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-void
-http_send (const char * s)
+static HTTP_BLOCK *
+http_alloc_block (void)
 {
-    int len = strlen (s);
+    HTTP_BLOCK * b = http_free_blocks;
 
-    while (http_response_len + len > MAX_HTTP_RESPONSE_LEN)
+    if (b)
     {
-        int rest = MAX_HTTP_RESPONSE_LEN - http_response_len;
-
-        http_concat_response (s, rest);
-        http_flush ();
+        http_free_blocks = b->next;
+        http_n_free_blocks--;
+    }
+    else if (http_n_blocks < HTTP_MAX_OUTPUT_BLOCKS)
+    {
+        b = (HTTP_BLOCK *) malloc (sizeof (HTTP_BLOCK));
 
-        len -= rest;
-        s += rest;
+        if (b)
+        {
+            http_n_blocks++;
+        }
     }
 
-    http_concat_response (s, len);
-}
+    if (b)
+    {
+        b->next = (HTTP_BLOCK *) NULL;
+        b->len  = 0;
+    }
 
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * send string
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
-void
-http_send (String s)
-{
-    http_send (s.c_str());
+    return b;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * normalize http parameters
+ * release output block. If the free list is full, the block with the highest address is freed: the kept blocks move to the start
+ * of the heap and do not split the large free area.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-normalize_http_parameters (char * p)
+http_release_block (HTTP_BLOCK * b)
 {
-    while (*p)
+    if (http_n_free_blocks < HTTP_KEEP_OUTPUT_BLOCKS)
     {
-        if (*p == '%')
-        {
-            char * pp;
-
-            *p = htoi (p + 1, 2);
-
-            for (pp = p + 1; *(pp + 2); pp++)
-            {
-                *pp = *(pp + 2);
-            }
-            *pp = '\0';
-        }
-        p++;
+        b->next = http_free_blocks;
+        http_free_blocks = b;
+        http_n_free_blocks++;
     }
-}
-
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * set parameters from list
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
-static void
-http_set_params (char * paramlist)
-{
-    char *  p;                                              // ap=access&pw=secret&action=saveap
-    int     idx = 0;
-    int     i;
-
-    if (paramlist && *paramlist)
+    else
     {
-        http_parameters[idx].name = paramlist;
+        HTTP_BLOCK **   highest = &http_free_blocks;
+        HTTP_BLOCK **   bp;
 
-        for (p = paramlist; idx < MAX_HTTP_PARAMS - 1 && *p; p++)
+        for (bp = &http_free_blocks; *bp; bp = &(*bp)->next)
         {
-            if (*p == '=')
-            {
-                *p = '\0';
-                http_parameters[idx].value = p + 1;
-            }
-            else if (*p == '&')
+            if (*bp > *highest)
             {
-                *p = '\0';
-                idx++;
-                http_parameters[idx].name = p + 1;
+                highest = bp;
             }
         }
-        idx++;
-    }
 
-    for (i = 0; i < idx; i++)
-    {
-        normalize_http_parameters (http_parameters[i].value);
-    }
+        if (*highest > b)                                                   // keep b instead of the block with highest address
+        {
+            HTTP_BLOCK * h = *highest;
 
-    while (idx < MAX_HTTP_PARAMS)
-    {
-        http_parameters[idx].name = (char *) 0;
-        idx++;
+            *highest            = h->next;
+            b->next             = http_free_blocks;
+            http_free_blocks    = b;
+            b                   = h;
+        }
+
+        free (b);
+        http_n_blocks--;
     }
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * get a parameter
+ * free all queued output blocks of a connection
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static char *
-http_get_param (const char * name)
+static void
+http_free_blocks_of (HTTP_CONNECTION * conn)
 {
-    static char empty[] = "";
-    int     idx;
+    HTTP_BLOCK * b;
 
-    for (idx = 0; idx < MAX_HTTP_PARAMS && http_parameters[idx].name != (char *) 0; idx++)
+    while ((b = conn->out_head) != (HTTP_BLOCK *) NULL)
     {
-        if (! strcmp (http_parameters[idx].name, name))
-        {
-            return http_parameters[idx].value;
-        }
+        conn->out_head = b->next;
+        http_release_block (b);
     }
 
-    return empty;
+    conn->out_tail  = (HTTP_BLOCK *) NULL;
+    conn->out_pos   = 0;
+    conn->body_len  = 0;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * get a parameter by index
+ * build response header of buffered response
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static char *
-http_get_param_by_idx (const char * name, int idx)
+static void
+http_build_header (HTTP_CONNECTION * conn)
 {
-    char    name_buf[16];
-    char *  rtc;
+    char *  p   = conn->header;
+    int     len = HTTP_MAX_RESPONSE_HEADER_LEN + 1;
+    int     n;
 
-    sprintf (name_buf, "%s%d", name, idx);
-    rtc = http_get_param (name_buf);
+    conn->header_len = 0;
+    conn->header_pos = 0;
 
-    return rtc;
-}
+    if (! conn->status)
+    {
+        conn->keep_alive = false;                                                           // page sent no status: raw output
+        return;
+    }
 
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * get a checkbox parameter
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
-static int
-http_get_checkbox_param (const char * name)
-{
-    char *  value = http_get_param (name);
-    int     rtc;
+    n = snprintf (p, len, "%s %s\r\n", conn->http11 ? "HTTP/1.1" : "HTTP/1.0", conn->status);
+    p += n; len -= n;
 
-    if (! strcmp (value, "active"))
+    if (conn->content_type)
     {
-        rtc = 1;
+        n = snprintf (p, len, "Content-Type: %s\r\n", conn->content_type);
+        p += n; len -= n;
     }
-    else
+
+    if (conn->content_encoding)
     {
-        rtc = 0;
+        n = snprintf (p, len, "Content-Encoding: %s\r\n", conn->content_encoding);
+        p += n; len -= n;
     }
 
-    return rtc;
-}
+    if (conn->vary)
+    {
+        n = snprintf (p, len, "Vary: %s\r\n", conn->vary);
+        p += n; len -= n;
+    }
 
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * get a checkbox parameter by index
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
-static int
-http_get_checkbox_param_by_idx (const char * name, int idx)
-{
-    char *  value = http_get_param_by_idx (name, idx);
-    int     rtc;
+    if (conn->cache_control)
+    {
+        n = snprintf (p, len, "Cache-Control: %s\r\n", conn->cache_control);
+        p += n; len -= n;
+    }
 
-    if (! strcmp (value, "active"))
+    if (conn->etag[0])
     {
-        rtc = 1;
+        n = snprintf (p, len, "ETag: \"%s\"\r\n", conn->etag);
+        p += n; len -= n;
+    }
+
+    if (conn->chunked)
+    {
+        n = snprintf (p, len, "Transfer-Encoding: chunked\r\nConnection: keep-alive\r\n\r\n");
+    }
+    else if (conn->keep_alive)
+    {
+        n = snprintf (p, len, "Content-Length: %d\r\nConnection: keep-alive\r\n\r\n", conn->body_len + conn->body_P_len);
     }
     else
     {
-        rtc = 0;
+        n = snprintf (p, len, "Connection: close\r\n\r\n");
     }
 
-    return rtc;
+    conn->header_len = (p + n) - conn->header;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * send http style
+ * continue FNV-1a hash with data in RAM or flash
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-http_style (void)
+static uint32_t
+http_hash (uint32_t hash, const char * s, int len, bool progmem)
 {
-    http_send_FS ("<style>\r\n");
-    http_send_FS ("* { padding: 0; margin: 0; FONT-FAMILY: Verdana,Helvetica,sans-serif; FONT-SIZE: 14px}\r\n");
-    http_send_FS ("BODY, HTML {height: 100%}\r\n");
-    http_send_FS ("H1 {FONT-SIZE: 24px}\r\n");
-    http_send_FS ("H2 {FONT-SIZE: 18px}\r\n");
-    http_send_FS ("H3 {FONT-SIZE: 16px}\r\n");
-    http_send_FS ("TH {color: darkblue}\r\n");
-    http_send_FS ("A {text-decoration: none}\r\n");
-    http_send_FS ("A:link {background: none; color: #eeee00}\r\n");
-    http_send_FS ("A:visited {background: none; color: #eeee00}\r\n");
-    http_send_FS ("A:hover {background: none; color: #ffffff}\r\n");
-    http_send_FS ("A:active {background: none; color: #ffff00}\r\n");
-    http_send_FS ("SELECT,BUTTON,.button,.custom-file-upload\r\n");
-    http_send_FS ("{\r\n");
-    http_send_FS (" background: none;\r\n");
-    http_send_FS (" border: 1px solid;\r\n");
-    http_send_FS (" border-color: #0000ff;\r\n");
-    http_send_FS (" color: #0000ff;\r\n");
-    http_send_FS (" padding: 4px 8px;\r\n");
-    http_send_FS (" text-align: center;\r\n");
-    http_send_FS (" text-decoration: none;\r\n");
-    http_send_FS (" display: inline-block;\r\n");
-    http_send_FS (" font-size: 12px;\r\n");
-    http_send_FS (" margin: 4px 2px;\r\n");
-    http_send_FS (" cursor: pointer;\r\n");
-    http_send_FS ("}\r\n");
-    http_send_FS ("BUTTON:hover\r\n");
-    http_send_FS ("{\r\n");
-    http_send_FS (" background-color: #0000B0;\r\n");
-    http_send_FS (" color: #ffff00;\r\n");
-    http_send_FS ("}\r\n");
-    http_send_FS ("input[type=\"file\"] { display: none; }");
-    http_send_FS (".bigtable {height: 100%}\r\n");
-    http_send_FS ("</style>\r\n");
+    while (len-- > 0)
+    {
+        hash = (hash ^ (progmem ? pgm_read_byte (s) : (uint8_t) *s)) * 16777619U;
+        s++;
+    }
+
+    return hash;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * send http and html header
+ * output pool exhausted: suspend page generation, the rest of the page is generated again by http_resume()
+ *
+ * An event must fit into the pool: its client is dropped.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-http_header (const char * title, const char * refresh, const char * url)
+http_suspend (HTTP_CONNECTION * conn)
 {
-    http_send_FS ("HTTP/1.0 200 OK\r\n\r\n<!DOCTYPE html>\r\n<html><head><title>");
-
-    http_send (pgm_name);
+    conn->suspended = true;                                                                 // discard rest of output
 
-    if (title && *title)
+    if (conn->events)
     {
-        http_send (" ");
-        http_send (title);
+        http_free_blocks_of (conn);
+        conn->events        = false;
+        conn->keep_alive    = false;
+        http_stats.event_drops++;
+        return;
     }
 
-    http_send_FS ("</title>");
+    http_stats.overflows++;
 
-    if (refresh)
+    if (conn->http11 && conn->keep_alive && conn->status)
     {
-        http_send_FS ("<meta http-equiv=\"refresh\" content=\"");
-        http_send (refresh);
-        http_send_FS ("; URL=");
-        http_send (url);
-        http_send_FS ("\">");
+        conn->chunked = true;                                                               // length of response is unknown
+    }
+    else
+    {
+        conn->keep_alive = false;                                                           // end of response is end of connection
     }
-
-    http_style ();
-    http_send_FS ("</head><body>\r\n");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * send html trailer
+ * append data to buffered response
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-http_trailer (void)
+http_queue (HTTP_CONNECTION * conn, const char * s, int len, bool progmem)
 {
-    http_send_FS ("</body></html>\r\n");
-}
+    if (conn->suspended)                                                                    // rest is generated on resume
+    {
+        return;
+    }
 
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * send table header columns
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
-static void
-table_header (const char ** columns, int cols)
-{
-    int i;
+    if (conn->skip > 0)                                                                     // resume: skip part already sent
+    {
+        int n = (len < conn->skip) ? len : conn->skip;
 
-    http_send_FS ("<table border=0>");
+        conn->skip_hash = http_hash (conn->skip_hash, s, n, progmem);
+        conn->skip     -= n;
+        s              += n;
+        len            -= n;
 
-    if (columns && cols)
+        if (conn->skip == 0 && conn->skip_hash != conn->body_hash)
+        {
+            conn->resume_failed = true;
+            conn->suspended     = true;
+            return;
+        }
+    }
+
+    while (len > 0)
     {
-        http_send_FS ("<tr>");
+        HTTP_BLOCK *    b = conn->out_tail;
+        int             n;
 
-        for (i = 0; i < cols; i++)
+        if (! b || b->len == HTTP_OUTPUT_BLOCK_SIZE)
         {
-            http_send_FS ("<th style='textalign:left'><font color=darkblue>");
-            http_send (columns[i]);
-            http_send_FS ("</font></th>");
+            b = http_alloc_block ();
+
+            if (! b)
+            {
+                http_suspend (conn);
+                return;
+            }
+
+            if (conn->out_tail)
+            {
+                conn->out_tail->next = b;
+            }
+            else
+            {
+                conn->out_head = b;
+            }
+
+            conn->out_tail = b;
         }
 
-        http_send_FS ("</tr>\r\n");
+        n = HTTP_OUTPUT_BLOCK_SIZE - b->len;
+
+        if (n > len)
+        {
+            n = len;
+        }
+
+        if (progmem)
+        {
+            memcpy_P (b->data + b->len, s, n);
+        }
+        else
+        {
+            memcpy (b->data + b->len, s, n);
+        }
+
+        conn->body_hash  = http_hash (conn->body_hash, b->data + b->len, n, false);
+        b->len          += n;
+        conn->body_len  += n;
+        s               += n;
+        len             -= n;
     }
-    bgcolor_cnt = 0;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * begin form
+ * flush output buffer
+ *
+ * Only used for direct output, a buffered response is sent by http_server_loop().
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 void
-begin_form (const char * page)
+http_flush (void)
 {
-    http_send_FS ("<form method=\"GET\" action=\"/");
-    http_send (page);
-    http_send_FS ("\">\r\n");
+    if (http_response_len > 0)
+    {
+        http_client.write ((const uint8_t *) http_response, http_response_len);
+        http_client.flush ();
+        http_response[0] = '\0';
+        http_response_len = 0;
+    }
 }
 
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * end form
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
-void
-end_form (void)
+static void
+http_concat_response (const char * s, int len)
 {
-    http_send_FS ("</form>\r\n");
+    strncpy (http_response + http_response_len, s, len);
+    http_response_len += len;
+    http_response[http_response_len] = '\0';
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * begin table row
+ * send string
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-begin_table_row (int show_bgcolor = 1)
+void
+http_send (const char * s)
 {
-    bgcolor_cnt++;
+    int len = strlen (s);
 
-    if (show_bgcolor && bgcolor_cnt & 0x01)
+    if (http_conn)
     {
-        http_send_FS ("<tr bgcolor=#f0f0f0>\r\n");
+        http_queue (http_conn, s, len, false);
+        return;
     }
-    else
+
+    while (http_response_len + len > MAX_HTTP_RESPONSE_LEN)
     {
-        http_send_FS ("<tr>\r\n");
+        int rest = MAX_HTTP_RESPONSE_LEN - http_response_len;
+
+        http_concat_response (s, rest);
+        http_flush ();
+
+        len -= rest;
+        s += rest;
     }
+
+    http_concat_response (s, len);
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * begin table row as form
+ * send string constant stored in flash - no String on heap
+ *
+ * Buffered output: copied from flash directly into the output block. Direct output: copied in pieces via stack.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-begin_table_row_form (const char * page, int show_bgcolor = 1)
+void
+http_send_P (const char * s)
 {
-    begin_table_row (show_bgcolor);
-    begin_form (page);
+    char    buf[64];
+    size_t  len = strlen_P (s);
+
+    if (http_conn)
+    {
+        http_queue (http_conn, s, len, true);
+        return;
+    }
+
+    while (len > 0)
+    {
+        size_t n = (len < sizeof (buf) - 1) ? len : sizeof (buf) - 1;
+
+        memcpy_P (buf, s, n);
+        buf[n] = '\0';
+        http_send (buf);
+
+        s   += n;
+        len -= n;
+    }
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * end table row
+ * send http status, e.g. "200 OK"
+ *
+ * Direct output: status line is sent immediately. Buffered output: header incl. Content-Length is built when the page is complete.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-end_table_row (void)
+http_send_status (const char * status)
 {
-    http_send_FS ("</tr>\r\n");
+    if (http_conn)
+    {
+        http_conn->status = status;
+    }
+    else
+    {
+        http_send_FS ("HTTP/1.0 ");
+        http_send (status);
+        http_send_FS ("\r\n\r\n");
+    }
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * end table row as form
+ * send string
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-end_table_row_form (void)
+void
+http_send (String s)
 {
-    end_form ();
-    end_table_row ();
+    http_send (s.c_str());
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * checkbox field
+ * enter parameter into hash index, first one wins if a name occurs twice
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-checkbox_field (const char * id, const char * desc, int checked)
+http_index_param (int idx)
 {
-    http_send (desc);
-    http_send_FS ("&nbsp;<input type=\"checkbox\" name=\"");
-    http_send (id);
-    http_send_FS ("\" value=\"active\" ");
+    uint32_t        hash = http_hash (HTTP_HASH_INIT, http_parameters[idx].name, strlen (http_parameters[idx].name), false);
+    uint_fast8_t    slot = hash & (HTTP_PARAM_INDEX_SIZE - 1);
 
-    if (checked)
+    http_parameters[idx].hash = hash;
+
+    while (http_param_index[slot] >= 0)
     {
-        http_send_FS ("checked");
+        HTTP_PARAMETERS * hp = http_parameters + http_param_index[slot];
+
+        if (hp->hash == hash && ! strcmp (hp->name, http_parameters[idx].name))
+        {
+            return;
+        }
+
+        slot = (slot + 1) & (HTTP_PARAM_INDEX_SIZE - 1);
     }
 
-    http_send_FS (">");
+    http_param_index[slot] = idx;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * begin column
+ * set parameters from list
+ *
+ * Decodes the list in one pass into buf ('+' -> ' ', %XX -> character), splits it into name/value pairs and builds the hash index.
+ * All names and values point into buf, a list longer than bufsize - 1 is truncated.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-begin_column (void)
+http_set_params (char * buf, int bufsize, const char * paramlist)
 {
-    http_send_FS ("<td>");
-}
+    const char *    r = paramlist;                                  // ap=access&pw=secret&action=saveap
+    char *          w = buf;
+    char *          wend = buf + bufsize - 1;
+    int             idx;
 
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * end column
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
-static void
-end_column (void)
-{
-    http_send_FS ("</td>");
+    http_n_parameters = 0;
+
+    for (idx = 0; idx < HTTP_PARAM_INDEX_SIZE; idx++)
+    {
+        http_param_index[idx] = -1;
+    }
+
+    if (! r || ! *r)
+    {
+        return;
+    }
+
+    http_parameters[0].name     = w;
+    http_parameters[0].value    = (char *) NULL;
+
+    while (*r && w < wend)
+    {
+        char ch = *r++;
+
+        if (ch == '&')
+        {
+            *w++ = '\0';
+
+            if (http_n_parameters == MAX_HTTP_PARAMS - 1)
+            {
+                break;
+            }
+
+            http_n_parameters++;
+            http_parameters[http_n_parameters].name     = w;
+            http_parameters[http_n_parameters].value    = (char *) NULL;
+            continue;
+        }
+
+        if (ch == '=' && ! http_parameters[http_n_parameters].value)
+        {
+            *w++ = '\0';
+            http_parameters[http_n_parameters].value = w;
+            continue;
+        }
+
+        if (ch == '+')                                              // plus must be mapped to space if GET method
+        {
+            ch = ' ';
+        }
+        else if (ch == '%' && isxdigit (r[0]) && isxdigit (r[1]))
+        {
+            ch = htoi ((char *) r, 2);
+            r += 2;
+        }
+
+        *w++ = ch;
+    }
+
+    *w = '\0';
+    http_n_parameters++;
+
+    for (idx = 0; idx < http_n_parameters; idx++)
+    {
+        if (! http_parameters[idx].value)
+        {
+            http_parameters[idx].value = w;                         // parameter without value: empty string
+        }
+
+        http_index_param (idx);
+    }
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * checkbox column
+ * get a parameter
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-checkbox_column (const char * id, const char * desc, int checked)
+static char *
+http_get_param (const char * name)
 {
-    begin_column ();
-    checkbox_field (id, desc, checked);
-    end_column ();
+    static char     empty[] = "";
+    uint32_t        hash = http_hash (HTTP_HASH_INIT, name, strlen (name), false);
+    uint_fast8_t    slot = hash & (HTTP_PARAM_INDEX_SIZE - 1);
+
+    while (http_param_index[slot] >= 0)
+    {
+        HTTP_PARAMETERS * hp = http_parameters + http_param_index[slot];
+
+        if (hp->hash == hash && ! strcmp (hp->name, name))
+        {
+            return hp->value;
+        }
+
+        slot = (slot + 1) & (HTTP_PARAM_INDEX_SIZE - 1);
+    }
+
+    return empty;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * text column
+ * get a parameter by index
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-text_column (const char * text)
+static char *
+http_get_param_by_idx (const char * name, int idx)
 {
-    begin_column ();
-    http_send (text);
-    end_column ();
+    char    name_buf[16];
+    char *  rtc;
+
+    sprintf (name_buf, "%s%d", name, idx);
+    rtc = http_get_param (name_buf);
+
+    return rtc;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * text column (align right)
+ * get a checkbox parameter
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-text_rcolumn (const char * text)
+static int
+http_get_checkbox_param (const char * name)
 {
-    http_send_FS ("<td align=\"right\">");
-    http_send (text);
-    end_column ();
+    char *  value = http_get_param (name);
+    int     rtc;
+
+    if (! strcmp (value, "active"))
+    {
+        rtc = 1;
+    }
+    else
+    {
+        rtc = 0;
+    }
+
+    return rtc;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * input field
+ * get a checkbox parameter by index
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-input_field (const char * id, const char * desc, const char * value, int maxlength, int maxsize)
+static int
+http_get_checkbox_param_by_idx (const char * name, int idx)
 {
-    char maxlength_buf[8];
-    char maxsize_buf[8];
-
-    sprintf (maxlength_buf, "%d", maxlength);
-    sprintf (maxsize_buf, "%d", maxsize);
+    char *  value = http_get_param_by_idx (name, idx);
+    int     rtc;
 
-    if (desc && *desc)
+    if (! strcmp (value, "active"))
     {
-        http_send (desc);
-        http_send_FS ("&nbsp;");
+        rtc = 1;
+    }
+    else
+    {
+        rtc = 0;
     }
 
-    http_send_FS ("<input type=\"text\" id=\"");
-    http_send (id);
-    http_send_FS ("\" name=\"");
-    http_send (id);
-    http_send_FS ("\" value=\"");
-    http_send (value);
-    http_send_FS ("\" maxlength=\"");
-    http_send (maxlength_buf);
-    http_send_FS ("\" size=\"");
-    http_send (maxsize_buf);
-    http_send_FS ("\">");
+    return rtc;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * input column
+ * send http style
+ *
+ * style.css is cached by the browser, see http_asset()
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-input_column (const char * id, const char * desc, const char * value, int maxlength, int maxsize)
-{
-    begin_column ();
-    input_field (id, desc, value, maxlength, maxsize);
-    end_column ();
-}
-
-static void
-input_column (const char * id, const char * desc, int value, int maxlength, int maxsize)
+http_style (void)
 {
-    char buf[32];
-
-    sprintf (buf, "%d", value);
-    input_column (id, desc, buf, maxlength, maxsize);
+    http_send_FS ("<link rel=\"stylesheet\" href=\"/style.css?v=" STYLE_CSS_VERSION "\">\r\n");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * select field
+ * send value of numeric variable which is updated by /api/events while the page is open, see http_live_script()
+ *
+ * texts: values as comma separated list, e.g. "off,on", NULL: value as number
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
+static bool         http_live_used;                                         // page contains live values
+
 static void
-select_field (const char * id, const char ** text, int selected_value, int min_value, int max_value, int autosubmit)
+http_live_value (NUM_VARIABLE var, const char * texts)
 {
-    char    buf[16];
-    int     i;
+    char            buf[48];
+    unsigned int    value = get_numvar (var);
+    const char *    p;
+    int             n;
 
-    http_send_FS ("<select id=\"");
-    http_send (id);
-    http_send_FS ("\" name=\"");
-    http_send (id);
+    sprintf (buf, "<span data-n=\"%d\"", (int) var);
+    http_send (buf);
 
-    if (autosubmit)
-    {
-         http_send_FS ("\" onchange='this.form.submit()'>");
-    }
-    else
+    if (texts)
     {
+        http_send_FS (" data-t=\"");
+        http_send (texts);
         http_send_FS ("\">");
-    }
 
-    for (i = min_value; i < max_value; i++)
-    {
-        sprintf (buf, "%d", i);
-        http_send_FS ("<option value=\"");
-        http_send (buf);
-        http_send_FS ("\"");
+        for (p = texts; value > 0 && *p; p++)                               // select n-th text of list
+        {
+            if (*p == ',')
+            {
+                value--;
+            }
+        }
 
-        if (i == selected_value)
+        for (n = 0; *p && *p != ',' && n < (int) sizeof (buf) - 1; n++)
         {
-            http_send_FS (" selected");
+            buf[n] = *p++;
         }
 
-        http_send_FS (">");
-        http_send ((char *) text[i]);
-        http_send_FS ("</option>");
+        buf[n] = '\0';
+        http_send (buf);
+    }
+    else
+    {
+        sprintf (buf, ">%u", value);
+        http_send (buf);
     }
 
-    http_send_FS ("</select>\r\n");
+    http_send_FS ("</span>");
+    http_live_used = true;
 }
 
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * select column
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
 static void
-select_column (const char * id, const char ** text, int selected_value, int min_value, int max_value, int autosubmit)
+http_live_script (void)
 {
-    begin_column ();
-    select_field (id, text, selected_value, min_value, max_value, autosubmit);
-    end_column ();
+    char    buf[64];
+
+    if (http_live_used)
+    {
+        http_live_used = false;
+        sprintf (buf, "<script>var es=new EventSource('/api/events?since=%lu');", (unsigned long) vars_generation);
+        http_send (buf);
+        http_send_FS ("es.onmessage=function(e){var n=JSON.parse(e.data).num||{};for(var k in n){"
+                      "document.querySelectorAll('[data-n=\"'+k+'\"]').forEach(function(el){var t=el.dataset.t;"
+                      "el.textContent=t?(t.split(',')[n[k]]||n[k]):n[k];});}};</script>\r\n");
+    }
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * slider field
+ * send http and html header
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-slider_field (const char * id, const char * text, const char * value, const char * min, const char * max, const char * pixelwidth)
+http_header (const char * title, const char * refresh, const char * url)
 {
-    if (text && *text)
+    http_send_status ("200 OK");
+    http_send_FS ("<!DOCTYPE html>\r\n<html><head><title>");
+
+    http_send (pgm_name);
+
+    if (title && *title)
     {
-        http_send (text);
-        http_send_FS ("&nbsp;");
+        http_send (" ");
+        http_send (title);
     }
 
-    http_send_FS ("<input type=\"range\" id=\"");
-    http_send (id);
-    http_send_FS ("\" name=\"");
-    http_send (id);
-    http_send_FS ("\" value=\"");
-    http_send (value);
-    http_send_FS ("\" min=\"");
-    http_send (min);
-    http_send_FS ("\" max=\"");
-    http_send (max);
+    http_send_FS ("</title>");
 
-    if (pixelwidth && *pixelwidth)
+    if (refresh)
     {
-        http_send_FS ("\" style=\"width:");
-        http_send (pixelwidth);
-        http_send_FS ("px;");
+        http_send_FS ("<meta http-equiv=\"refresh\" content=\"");
+        http_send (refresh);
+        http_send_FS ("; URL=");
+        http_send (url);
+        http_send_FS ("\">");
     }
 
-    http_send_FS ("\" oninput=\"");
-    http_send (id);
-    http_send_FS ("_output.value=");
-    http_send (id);
-    http_send_FS (".value\">");
-    http_send_FS ("<output name=\"");
-    http_send (id);
-    http_send_FS ("_output\">");
-    http_send (value);
-    http_send_FS ("</output>");
+    http_style ();
+    http_send_FS ("</head><body>\r\n");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * slider column
+ * send html trailer
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-slider_column (const char * id, const char * value, const char * min, const char * max)
+http_trailer (void)
 {
-    http_send_FS ("<td>");
-    slider_field (id, "", value, min, max, "");
-    http_send_FS ("</td>\r\n");
+    http_live_script ();
+    http_send_FS ("</body></html>\r\n");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * submit button field
+ * send table header columns
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-button_field (const char * id, const char * text, const char * style = NULL)
+table_header (const char ** columns, int cols)
 {
-    http_send_FS ("<button type=\"submit\" name=\"action\" ");
+    int i;
 
-    if (style)
+    http_send_FS ("<table border=0>");
+
+    if (columns && cols)
     {
-        http_send (style);
-    }
+        http_send_FS ("<tr>");
 
-    http_send_FS (" value=\"");
-    http_send (id);
-    http_send_FS ("\">");
-    http_send (text);
-    http_send_FS ("</button>&nbsp;");
-}
+        for (i = 0; i < cols; i++)
+        {
+            http_send_FS ("<th style='textalign:left'><font color=darkblue>");
+            http_send (columns[i]);
+            http_send_FS ("</font></th>");
+        }
 
-/*-------------------------------------------------------------------------------------------------------------------------------------------
- * submit column field
- *-------------------------------------------------------------------------------------------------------------------------------------------
- */
-static void
-button_column (const char * id, const char * text, const char * style = NULL)
-{
-    begin_column ();
-    button_field (id, text, style);
-    end_column ();
+        http_send_FS ("</tr>\r\n");
+    }
+    bgcolor_cnt = 0;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * save column
+ * begin form
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-save_column (const char * id)
+void
+begin_form (const char * page)
 {
-    http_send_FS ("<td><button type=\"submit\" name=\"action\" value=\"save");
-    http_send (id);
-    http_send_FS ("\">Save</button></td>\r\n");
+    http_send_FS ("<form method=\"GET\" action=\"/");
+    http_send (page);
+    http_send_FS ("\">\r\n");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * table row
+ * end form
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-table_row (const char * col1, const char * col2, const char * col3)
+void
+end_form (void)
 {
-    begin_table_row ();
-    text_column (col1);
-    text_column (col2);
-    text_column (col3);
-    end_table_row ();
+    http_send_FS ("</form>\r\n");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * table row with input
+ * begin table row
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-table_row_input (const char * page, int cols, const char * text, const char * id, const char * value, int maxlength, int show_bgcolor = 1)
+begin_table_row (int show_bgcolor = 1)
 {
-    int cols_used = 1;
-    int maxsize = maxlength;
+    bgcolor_cnt++;
 
-    if (maxsize > 32)
+    if (show_bgcolor && bgcolor_cnt & 0x01)
     {
-        maxsize = 32;
+        http_send_FS ("<tr bgcolor=#f0f0f0>\r\n");
     }
-
-    begin_table_row_form (page, show_bgcolor);
-    text_column (text);
-    cols_used++;
-    input_column (id, "", value, maxlength, maxsize);
-    cols_used++;
-
-    while (cols_used < cols)
+    else
     {
-        http_send_FS ("<td></td>");
-        cols_used++;
+        http_send_FS ("<tr>\r\n");
     }
-
-    save_column (id);
-    end_table_row_form ();
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * begin table row as form
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
 static void
-table_row_input (const char * page, int cols, const char * text, const char * id, int value, int maxlength)
+begin_table_row_form (const char * page, int show_bgcolor = 1)
 {
-    char buf[32];
-    sprintf (buf, "%d", value);
-    table_row_input (page, cols, text, id, buf, maxlength);
+    begin_table_row (show_bgcolor);
+    begin_form (page);
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * table row with input and additional button
+ * end table row
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-#if 0
 static void
-table_row_input_with_button (const char * page, int cols, const char * text, const char * id, const char * value, int maxlength, const char * buttonid, const char * buttontext)
+end_table_row (void)
 {
-    int cols_used = 1;
-
-    begin_table_row_form (page);
-    text_column (text);
-    cols_used++;
-    input_column (id, "", value, maxlength, maxlength);
-    cols_used++;
-    button_column (buttonid, buttontext);
-    cols_used++;
-
-    while (cols_used < cols)
-    {
-        http_send_FS ("<td></td>");
-        cols_used++;
-    }
-
-    save_column (id);
-    end_table_row_form ();
+    http_send_FS ("</tr>\r\n");
 }
-#endif
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * table row with multiple inputs
+ * end table row as form
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-table_row_inputs (const char * page, const char * id, int n, const char ** ids, const char ** desc, const char ** value, int * maxlength, int * maxsize)
+end_table_row_form (void)
 {
-    int     i;
+    end_form ();
+    end_table_row ();
+}
 
-    begin_table_row_form (page);
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * checkbox field
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+checkbox_field (const char * id, const char * desc, int checked)
+{
+    http_send (desc);
+    http_send_FS ("&nbsp;<input type=\"checkbox\" name=\"");
+    http_send (id);
+    http_send_FS ("\" value=\"active\" ");
 
-    for (i = 0; i < n; i++)
+    if (checked)
     {
-        http_send_FS ("<td>");
-        input_field (ids[i], desc[i], value[i], maxlength[i], maxsize[i]);
-        http_send_FS ("</td>");
+        http_send_FS ("checked");
     }
 
-    save_column (id);
-    end_table_row_form ();
+    http_send_FS (">");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * table row with checkbox
+ * begin column
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-table_row_checkbox (const char * page, const char * text, const char * id, const char * desc, int checked)
+begin_column (void)
 {
-    begin_table_row_form (page);
-    text_column (text);
-    checkbox_column (id, desc, checked);
-    save_column (id);
-    end_table_row_form ();
+    http_send_FS ("<td>");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * table row with selection
+ * end column
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-table_row_select (const char * page, const char * text1, const char * id, const char ** text2, int selected_value, int min_value, int max_value, int autosubmit)
+end_column (void)
 {
-    begin_table_row_form (page);
-    text_column (text1);
-    select_column (id, text2, selected_value, min_value, max_value, autosubmit);
-    save_column (id);
-    end_table_row_form ();
+    http_send_FS ("</td>");
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * table row with slider
+ * checkbox column
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-table_row_slider (const char * page, const char * text1, const char * id, const char * text2, const char * min, const char * max)
+checkbox_column (const char * id, const char * desc, int checked)
 {
-    begin_table_row_form (page);
-    text_column (text1);
-    slider_column (id, text2, min, max);
-    save_column (id);
-    end_table_row_form ();
+    begin_column ();
+    checkbox_field (id, desc, checked);
+    end_column ();
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * table row with n sliders
+ * text column
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-table_row_sliders (const char * page, const char * text1, const char * id, int n, const char ** ids, const char ** desc, const char * const * text2, const char ** min, const char ** max)
+text_column (const char * text)
+{
+    begin_column ();
+    http_send (text);
+    end_column ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * text column (align right)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+text_rcolumn (const char * text)
+{
+    http_send_FS ("<td align=\"right\">");
+    http_send (text);
+    end_column ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * input field
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+input_field (const char * id, const char * desc, const char * value, int maxlength, int maxsize)
+{
+    char maxlength_buf[8];
+    char maxsize_buf[8];
+
+    sprintf (maxlength_buf, "%d", maxlength);
+    sprintf (maxsize_buf, "%d", maxsize);
+
+    if (desc && *desc)
+    {
+        http_send (desc);
+        http_send_FS ("&nbsp;");
+    }
+
+    http_send_FS ("<input type=\"text\" id=\"");
+    http_send (id);
+    http_send_FS ("\" name=\"");
+    http_send (id);
+    http_send_FS ("\" value=\"");
+    http_send (value);
+    http_send_FS ("\" maxlength=\"");
+    http_send (maxlength_buf);
+    http_send_FS ("\" size=\"");
+    http_send (maxsize_buf);
+    http_send_FS ("\">");
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * input column
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+input_column (const char * id, const char * desc, const char * value, int maxlength, int maxsize)
+{
+    begin_column ();
+    input_field (id, desc, value, maxlength, maxsize);
+    end_column ();
+}
+
+static void
+input_column (const char * id, const char * desc, int value, int maxlength, int maxsize)
+{
+    char buf[32];
+
+    sprintf (buf, "%d", value);
+    input_column (id, desc, buf, maxlength, maxsize);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * select field
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+select_field (const char * id, const char ** text, int selected_value, int min_value, int max_value, int autosubmit)
+{
+    char    buf[16];
+    int     i;
+
+    http_send_FS ("<select id=\"");
+    http_send (id);
+    http_send_FS ("\" name=\"");
+    http_send (id);
+
+    if (autosubmit)
+    {
+         http_send_FS ("\" onchange='this.form.submit()'>");
+    }
+    else
+    {
+        http_send_FS ("\">");
+    }
+
+    for (i = min_value; i < max_value; i++)
+    {
+        sprintf (buf, "%d", i);
+        http_send_FS ("<option value=\"");
+        http_send (buf);
+        http_send_FS ("\"");
+
+        if (i == selected_value)
+        {
+            http_send_FS (" selected");
+        }
+
+        http_send_FS (">");
+        http_send ((char *) text[i]);
+        http_send_FS ("</option>");
+    }
+
+    http_send_FS ("</select>\r\n");
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * select column
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+select_column (const char * id, const char ** text, int selected_value, int min_value, int max_value, int autosubmit)
+{
+    begin_column ();
+    select_field (id, text, selected_value, min_value, max_value, autosubmit);
+    end_column ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * slider field
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+slider_field (const char * id, const char * text, const char * value, const char * min, const char * max, const char * pixelwidth)
+{
+    if (text && *text)
+    {
+        http_send (text);
+        http_send_FS ("&nbsp;");
+    }
+
+    http_send_FS ("<input type=\"range\" id=\"");
+    http_send (id);
+    http_send_FS ("\" name=\"");
+    http_send (id);
+    http_send_FS ("\" value=\"");
+    http_send (value);
+    http_send_FS ("\" min=\"");
+    http_send (min);
+    http_send_FS ("\" max=\"");
+    http_send (max);
+
+    if (pixelwidth && *pixelwidth)
+    {
+        http_send_FS ("\" style=\"width:");
+        http_send (pixelwidth);
+        http_send_FS ("px;");
+    }
+
+    http_send_FS ("\" oninput=\"");
+    http_send (id);
+    http_send_FS ("_output.value=");
+    http_send (id);
+    http_send_FS (".value\">");
+    http_send_FS ("<output name=\"");
+    http_send (id);
+    http_send_FS ("_output\">");
+    http_send (value);
+    http_send_FS ("</output>");
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * slider column
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+slider_column (const char * id, const char * value, const char * min, const char * max)
+{
+    http_send_FS ("<td>");
+    slider_field (id, "", value, min, max, "");
+    http_send_FS ("</td>\r\n");
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * submit button field
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+button_field (const char * id, const char * text, const char * style = NULL)
+{
+    http_send_FS ("<button type=\"submit\" name=\"action\" ");
+
+    if (style)
+    {
+        http_send (style);
+    }
+
+    http_send_FS (" value=\"");
+    http_send (id);
+    http_send_FS ("\">");
+    http_send (text);
+    http_send_FS ("</button>&nbsp;");
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * submit column field
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+button_column (const char * id, const char * text, const char * style = NULL)
+{
+    begin_column ();
+    button_field (id, text, style);
+    end_column ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * save column
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+save_column (const char * id)
+{
+    http_send_FS ("<td><button type=\"submit\" name=\"action\" value=\"save");
+    http_send (id);
+    http_send_FS ("\">Save</button></td>\r\n");
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+table_row (const char * col1, const char * col2, const char * col3)
+{
+    begin_table_row ();
+    text_column (col1);
+    text_column (col2);
+    text_column (col3);
+    end_table_row ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row of statistics: name and value (align right)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_stat_text_row (const char * name, const char * text)
+{
+    begin_table_row ();
+    text_column (name);
+    text_rcolumn (text);
+    end_table_row ();
+}
+
+static void
+http_stat_row (const char * name, unsigned long value)
+{
+    char    buf[16];
+
+    sprintf (buf, "%lu", value);
+    http_stat_text_row (name, buf);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row with value of numeric variable, updated while the page is open
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_live_row (const char * name, NUM_VARIABLE var, const char * texts = (const char *) NULL)
+{
+    begin_table_row ();
+    text_column (name);
+    begin_column ();
+    http_live_value (var, texts);
+    end_column ();
+    text_column ("");
+    end_table_row ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row with input
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+table_row_input (const char * page, int cols, const char * text, const char * id, const char * value, int maxlength, int show_bgcolor = 1)
+{
+    int cols_used = 1;
+    int maxsize = maxlength;
+
+    if (maxsize > 32)
+    {
+        maxsize = 32;
+    }
+
+    begin_table_row_form (page, show_bgcolor);
+    text_column (text);
+    cols_used++;
+    input_column (id, "", value, maxlength, maxsize);
+    cols_used++;
+
+    while (cols_used < cols)
+    {
+        http_send_FS ("<td></td>");
+        cols_used++;
+    }
+
+    save_column (id);
+    end_table_row_form ();
+}
+
+static void
+table_row_input (const char * page, int cols, const char * text, const char * id, int value, int maxlength)
+{
+    char buf[32];
+    sprintf (buf, "%d", value);
+    table_row_input (page, cols, text, id, buf, maxlength);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row with input and additional button
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#if 0
+static void
+table_row_input_with_button (const char * page, int cols, const char * text, const char * id, const char * value, int maxlength, const char * buttonid, const char * buttontext)
+{
+    int cols_used = 1;
+
+    begin_table_row_form (page);
+    text_column (text);
+    cols_used++;
+    input_column (id, "", value, maxlength, maxlength);
+    cols_used++;
+    button_column (buttonid, buttontext);
+    cols_used++;
+
+    while (cols_used < cols)
+    {
+        http_send_FS ("<td></td>");
+        cols_used++;
+    }
+
+    save_column (id);
+    end_table_row_form ();
+}
+#endif
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row with multiple inputs
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+table_row_inputs (const char * page, const char * id, int n, const char ** ids, const char ** desc, const char ** value, int * maxlength, int * maxsize)
+{
+    int     i;
+
+    begin_table_row_form (page);
+
+    for (i = 0; i < n; i++)
+    {
+        http_send_FS ("<td>");
+        input_field (ids[i], desc[i], value[i], maxlength[i], maxsize[i]);
+        http_send_FS ("</td>");
+    }
+
+    save_column (id);
+    end_table_row_form ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row with checkbox
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+table_row_checkbox (const char * page, const char * text, const char * id, const char * desc, int checked)
+{
+    begin_table_row_form (page);
+    text_column (text);
+    checkbox_column (id, desc, checked);
+    save_column (id);
+    end_table_row_form ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row with selection
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+table_row_select (const char * page, const char * text1, const char * id, const char ** text2, int selected_value, int min_value, int max_value, int autosubmit)
+{
+    begin_table_row_form (page);
+    text_column (text1);
+    select_column (id, text2, selected_value, min_value, max_value, autosubmit);
+    save_column (id);
+    end_table_row_form ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row with slider
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+table_row_slider (const char * page, const char * text1, const char * id, const char * text2, const char * min, const char * max)
+{
+    begin_table_row_form (page);
+    text_column (text1);
+    slider_column (id, text2, min, max);
+    save_column (id);
+    end_table_row_form ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * table row with n sliders
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+table_row_sliders (const char * page, const char * text1, const char * id, int n, const char ** ids, const char ** desc, const char * const * text2, const char ** min, const char ** max)
 {
     int i;
 
@@ -1045,6 +1647,7 @@ begin_box (const char * title)
         menu_entry ("tft", "TFT");
     }
 
+    menu_entry ("profile", "Profile");
     menu_entry ("fs", "Files");
     menu_entry ("update", "Update");
     menu_entry ("flash_stm32_local", "Local Update");
@@ -1157,6 +1760,7 @@ http_main (void)
     uint_fast16_t   dfplayer_version;
     uint_fast8_t    do_reset = 0;
     uint_fast8_t    do_reset_eeprom = 0;
+    char            realtime_info_buf[UDP_REALTIME_INFO_SIZE];
 
     sv              = get_strvar (VERSION_STR_VAR);
     version         = sv->str;
@@ -1374,7 +1978,9 @@ http_main (void)
             table_row ("DFPlayer Version", dfplayer_version_buf, "");
         }
 
-        table_row ("Display power", get_numvar (DISPLAY_POWER_NUM_VAR) ? "on" : "off", "");
+        http_live_row ("Display power", DISPLAY_POWER_NUM_VAR, "off,on");
+        udp_realtime_info (realtime_info_buf);
+        table_row ("Realtime (DDP)", realtime_info_buf, "");
         table_trailer ();
         http_send_FS ("</td></tr></table><BR>\r\n");
 
@@ -1451,6 +2057,7 @@ http_network (void)
     uint_fast8_t                observe_summertime;
     STR_VAR *                   sv;
     uint_fast8_t                rtc             = 0;
+    char                        animsync_info_buf[ANIMSYNC_INFO_SIZE];
 
     esp_firmware_version        = ESP_VERSION;
 
@@ -1604,6 +2211,28 @@ http_network (void)
             set_numvar (TIMEZONE_NUM_VAR, utz);
             message = "Summertime observation successfully changed.";
         }
+        else if (! strcmp (action, "savetzrule"))
+        {
+            char * newrule = http_get_param ("tzrule");
+
+            set_strvar (TIMEZONE_RULE_STR_VAR, newrule);
+            message = "Timezone rule successfully changed.";
+        }
+        else if (! strcmp (action, "savesync_animations"))
+        {
+            if (http_get_checkbox_param ("sync_animations"))
+            {
+                eeprom_flags |= EEPROM_FLAG_SYNC_ANIMATIONS;
+            }
+            else
+            {
+                eeprom_flags &= ~EEPROM_FLAG_SYNC_ANIMATIONS;
+            }
+
+            eeprom_save_flags ();
+            eeprom_commit ();
+            message = "Animation synchronization successfully changed.";
+        }
         else if (! strcmp (action, "nettime"))
         {
             message = "Getting net time";
@@ -1696,6 +2325,11 @@ http_network (void)
     table_row_input (thispage, 3, "Time server", "timeserver", sv->str, MAX_IP_LEN);
     table_row_input (thispage, 3, "Time zone (GMT +/-)", "timezone", timezone_str, MAX_TIMEZONE_LEN);
     table_row_checkbox (thispage, "Summertime", "observe_summertime", "Observe summertime", observe_summertime);
+    sv = get_strvar (TIMEZONE_RULE_STR_VAR);
+    table_row_input (thispage, 3, "Time zone rule (POSIX TZ, overrides time zone)", "tzrule", sv->str, MAX_TIMEZONE_RULE_LEN);
+    table_row_checkbox (thispage, "Animations", "sync_animations", "Synchronize with other clocks", (eeprom_flags & EEPROM_FLAG_SYNC_ANIMATIONS) ? 1 : 0);
+    animsync_info (animsync_info_buf);
+    table_row ("Animation sync", animsync_info_buf, "");
     table_trailer ();
 
     begin_form (thispage);
@@ -1959,6 +2593,35 @@ http_weather (void)
     button_field ("getweatherfc", "Get weather forecast");
     end_form ();
 
+    const char *    cache_header_cols[MAIN_HEADER_COLS]         = { "Cache", "Value" };
+    char            buf[32];
+    long            age;
+    int             idx;
+
+    table_header (cache_header_cols, MAIN_HEADER_COLS);
+
+    for (idx = 0; idx < 2; idx++)
+    {
+        age = weather_cache_age (idx);
+
+        if (age >= 0)
+        {
+            sprintf (buf, "%ld sec", age);
+        }
+        else
+        {
+            strcpy (buf, "-");
+        }
+
+        http_stat_text_row (idx ? "Age forecast" : "Age weather", buf);
+    }
+
+    http_stat_row ("Hits", weather_cache_stats.hits);
+    http_stat_row ("Misses", weather_cache_stats.misses);
+    http_stat_row ("Refreshes", weather_cache_stats.refreshes);
+    http_stat_row ("Errors", weather_cache_stats.errors);
+    table_trailer ();
+
     if (alert_message)
     {
         http_send_FS ("<P><font color=red><B>");
@@ -1991,13 +2654,7 @@ http_ldr (void)
     char *          action;
     const char *    message                                     = (char *) 0;
     uint_fast8_t    rtc                                         = 0;
-    uint16_t        raw_value;
-    uint16_t        min_value;
-    uint16_t        max_value;
     uint_fast8_t    auto_brightness_active;
-    char            raw_buf[MAX_RAW_VALUE_LEN + 1];
-    char            min_buf[MAX_RAW_VALUE_LEN + 1];
-    char            max_buf[MAX_RAW_VALUE_LEN + 1];
 
     auto_brightness_active  = get_numvar (DISPLAY_AUTOMATIC_BRIGHTNESS_ACTIVE_NUM_VAR);
 
@@ -2037,17 +2694,9 @@ http_ldr (void)
 
     if (auto_brightness_active)
     {
-        raw_value = get_numvar (LDR_RAW_VALUE_NUM_VAR);
-        min_value = get_numvar (LDR_MIN_VALUE_NUM_VAR);
-        max_value = get_numvar (LDR_MAX_VALUE_NUM_VAR);
-
-        sprintf (raw_buf, "%u", raw_value);
-        sprintf (min_buf, "%u", min_value);
-        sprintf (max_buf, "%u", max_value);
-
-        table_row ("LDR", raw_buf, "");
-        table_row ("Min", min_buf, "");
-        table_row ("Max", max_buf, "");
+        http_live_row ("LDR", LDR_RAW_VALUE_NUM_VAR);
+        http_live_row ("Min", LDR_MIN_VALUE_NUM_VAR);
+        http_live_row ("Max", LDR_MAX_VALUE_NUM_VAR);
     }
 
     table_row_checkbox (thispage, "LDR", "auto", "Automatic brightness", auto_brightness_active);
@@ -3870,45 +4519,150 @@ http_tft (void)
     return rtc;
 }
 
-bool
-download_file (const char * host, const char * path, const char * filename)
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * profile page: CPU cycles of hot code sections of STM32
+ *
+ * The STM32 sends its profile table asynchronously, so this page shows the table received on the previous request
+ * and refreshes itself every 5 seconds.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define PROFILE_HEADER_COLS                     6
+
+static uint_fast8_t
+http_profile (void)
 {
-    unsigned char   buf[1024];
-    int             len;                                                // content len
-    bool            rtc = false;
+    const char *    thispage = "profile";
+    const char *    profile_header_cols[PROFILE_HEADER_COLS]   = { "Name", "Calls", "Min", "Avg", "Max", "Max (&micro;s)" };
+    const char *    http_header_cols[MAIN_HEADER_COLS]          = { "Name", "Value" };
+    char            name[24];
+    char            buf[16];
+    char *          action;
+    uint_fast8_t    idx;
+    uint_fast8_t    rtc = 0;
 
-    len = httpclient (host, path, filename);
+    action = http_get_param ("action");
 
-    if (len > 0)
+    if (action)
     {
-        int ch;
-        int idx = 0;
+        if (! strcmp (action, "reset"))
+        {
+            rpc (RESET_PROFILE_RPC_VAR);
+            rpc (RESET_STATS_RPC_VAR);
+            http_reset_stats ();
+        }
+        else if (! strcmp (action, "logstats"))
+        {
+            rpc (LOG_STATS_RPC_VAR);
+        }
+    }
 
-        File f = LittleFS.open(filename, "w");
+    rpc (GET_PROFILE_RPC_VAR);
+
+    http_header ("Profile", "5", "/profile");
+    begin_box ("Profile");
+
+    if (n_profile_entries == 0)
+    {
+        http_send_FS ("No profile data received. Profiling must be enabled in STM32 firmware (PROFILE=1).<P>\r\n");
+    }
+    else
+    {
+        table_header (profile_header_cols, PROFILE_HEADER_COLS);
 
-        while (len > 0)
+        for (idx = 0; idx < n_profile_entries; idx++)
         {
-            ch = httpclient_read (&len);
-            buf[idx++] = ch;
-            if (idx == 1024)
+            if (profile_entries[idx].name[0])
             {
-               f.write (buf, idx);
-               idx = 0;
+                begin_table_row ();
+                text_column (profile_entries[idx].name);
+                sprintf (buf, "%u", profile_entries[idx].calls);
+                text_rcolumn (buf);
+                sprintf (buf, "%u", profile_entries[idx].min_cycles);
+                text_rcolumn (buf);
+                sprintf (buf, "%u", profile_entries[idx].avg_cycles);
+                text_rcolumn (buf);
+                sprintf (buf, "%u", profile_entries[idx].max_cycles);
+                text_rcolumn (buf);
+
+                if (profile_core_clock >= 1000000)
+                {
+                    sprintf (buf, "%u", profile_entries[idx].max_cycles / (profile_core_clock / 1000000));
+                }
+                else
+                {
+                    strcpy (buf, "-");
+                }
+
+                text_rcolumn (buf);
+                end_table_row ();
             }
         }
 
-        if (idx > 0)
+        table_trailer ();
+    }
+
+    http_send_FS ("<P><B>HTTP server (ESP8266)</B><P>\r\n");
+    table_header (http_header_cols, MAIN_HEADER_COLS);
+
+    for (idx = 0; idx < HTTP_LATENCY_BUCKETS; idx++)
+    {
+        if (idx < HTTP_LATENCY_BUCKETS - 1)
+        {
+            sprintf (name, "&lt; %lu ms", http_latency_limits[idx]);
+        }
+        else
         {
-           f.write (buf, idx);
+            sprintf (name, "&ge; %lu ms", http_latency_limits[idx - 1]);
         }
 
-        f.close ();
-        httpclient_stop ();
-        rtc = true;
+        http_stat_row (name, http_stats.latency[idx]);
     }
+
+    http_stat_row ("Max latency (ms)",          http_stats.max_latency);
+    http_stat_row ("Requests",                  http_stats.requests);
+    http_stat_row ("Keep-alive requests",       http_stats.keepalive);
+    http_stat_row ("Dropped connections",       http_stats.timeouts);
+    http_stat_row ("Suspended pages",           http_stats.overflows);
+    http_stat_row ("Pages changed on resume",   http_stats.resume_errors);
+    http_stat_row ("Free heap",                 ESP.getFreeHeap ());
+    http_stat_row ("Min free heap",             http_stats.min_free_heap);
+    http_stat_row ("Max free block",            ESP.getMaxFreeBlockSize ());
+    http_stat_row ("Heap fragm. (%)",           ESP.getHeapFragmentation ());
+    http_stat_row ("Max heap fragm. (%)",       http_stats.max_heap_fragmentation);
+    http_stat_row ("Events sent",               http_stats.events);
+    http_stat_row ("Dropped event clients",     http_stats.event_drops);
+
+    table_trailer ();
+
+    begin_form (thispage);
+    button_field ("reset", "Reset");
+    end_form ();
+
+    http_send_FS ("<P>Statistics of STM32 modules (latencies, counters) are written to its log UART:<P>\r\n");
+    begin_form (thispage);
+    button_field ("logstats", "Log statistics");
+    end_form ();
+
+    end_box ();
+    http_trailer ();
+    http_flush ();
+
     return rtc;
 }
 
+static char    download_info[HTTPCLIENT_INFO_SIZE];                   // result of last download_file()
+
+bool
+download_file (const char * host, const char * path, const char * filename)
+{
+    HTTPCLIENT_DOWNLOAD dl;
+    int                 rtc;
+
+    rtc = httpclient_download (host, path, filename, filename, &dl);
+    httpclient_download_info (download_info, rtc, &dl);
+    return rtc == HTTPCLIENT_OK;
+}
+
 #define READ_LINE_TIMEOUT   2000  // 2000 msec
 
 static bool
@@ -4199,11 +4953,15 @@ http_fs (int post = POST_ICON_NONE)
 
     if (download_rtc == 0)
     {
-        http_send_FS ("download failed<BR>");
+        http_send_FS ("download failed: ");
+        http_send (download_info);
+        http_send_FS ("<BR>");
     }
     else if (download_rtc == 1)
     {
-        http_send_FS ("download successful<BR>");
+        http_send_FS ("download successful: ");
+        http_send (download_info);
+        http_send_FS ("<BR>");
     }
 
     sv = get_strvar (UPDATE_HOST_VAR);
@@ -4916,29 +5674,343 @@ http_update (void)
     return rtc;
 }
 
-String
-sanitize_xml_string(const String& str)
+String
+sanitize_xml_string(const String& str)
+{
+    String result;
+    for (unsigned int i = 0; i < str.length(); i++)
+    {
+        switch (str[i])
+        {
+        case '&':
+            result += "&amp;";
+            break;
+        case '<':
+            result += "&lt;";
+            break;
+        case '>':
+            result += "&gt;";
+            break;
+        default:
+            result += str[i];
+            break;
+        }
+    }
+    return result;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * JSON state api: /api/state[?since=generation]
+ *
+ * Sends the variables mirrored from the STM32 as compact JSON, e.g. {"gen":1234,"full":1,"num":{"0":1,...},"str":{...},...}
+ * Groups are objects with the variable index as key. With since=<generation> only the variables changed after this generation
+ * are sent. If since is unknown (e.g. from an earlier boot) the complete state is sent and "full" is set.
+ * The generation is used as ETag, If-None-Match with the current generation is answered with 304 and without body.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t     api_members;                                        // members of current group already sent
+
+static void
+http_send_json_string (const char * s)
+{
+    char    buf[64];
+    int     len = 0;
+
+    buf[len++] = '"';
+
+    while (*s)
+    {
+        unsigned char ch = *s++;
+
+        if (len > (int) sizeof (buf) - 8)
+        {
+            buf[len] = '\0';
+            http_send (buf);
+            len = 0;
+        }
+
+        if (ch == '"' || ch == '\\')
+        {
+            buf[len++] = '\\';
+            buf[len++] = ch;
+        }
+        else if (ch < 0x20 || ch >= 0x80)                                   // control characters, ISO-8859-1 characters
+        {
+            len += sprintf (buf + len, "\\u%04x", ch);
+        }
+        else
+        {
+            buf[len++] = ch;
+        }
+    }
+
+    buf[len++] = '"';
+    buf[len] = '\0';
+    http_send (buf);
+}
+
+static bool
+http_api_member (const char * group, uint_fast16_t gen_idx, uint32_t since, int idx)
+{
+    char    buf[24];
+
+    if (vars_gen[gen_idx] <= since)
+    {
+        return false;
+    }
+
+    if (api_members == 0)
+    {
+        sprintf (buf, ",\"%s\":{\"%d\":", group, idx);
+    }
+    else
+    {
+        sprintf (buf, ",\"%d\":", idx);
+    }
+
+    http_send (buf);
+    api_members++;
+    return true;
+}
+
+static void
+http_api_end_group (void)
+{
+    if (api_members)
+    {
+        http_send_FS ("}");
+        api_members = 0;
+    }
+}
+
+static void
+http_api_night_times (const char * group, NIGHT_TIME * tbl, uint_fast16_t gen_idx, uint32_t since)
+{
+    char    buf[24];
+    int     i;
+
+    for (i = 0; i < MAX_NIGHT_TIME_VARIABLES; i++)
+    {
+        if (http_api_member (group, gen_idx + i, since, i))
+        {
+            sprintf (buf, "[%u,%u]", tbl[i].minutes, tbl[i].flags);
+            http_send (buf);
+        }
+    }
+
+    http_api_end_group ();
+}
+
+static uint32_t
+http_api_since (uint32_t since, uint_fast8_t * fullp)
+{
+    if (since < vars_boot_generation || since > vars_generation)             // unknown generation: send complete state
+    {
+        *fullp = true;
+        return vars_boot_generation - 1;
+    }
+
+    *fullp = false;
+    return since;
+}
+
+static void
+http_api_send_state (uint32_t since, uint_fast8_t full)
+{
+    char                buf[64];
+    int                 n_overlays;
+    int                 i;
+
+    sprintf (buf, "{\"gen\":%lu,\"full\":%d", (unsigned long) vars_generation, full);
+    http_send (buf);
+
+    for (i = 0; i < MAX_NUM_VARIABLES; i++)
+    {
+        if (http_api_member ("num", VAR_GEN_NUM + i, since, i))
+        {
+            sprintf (buf, "%u", numvars[i]);
+            http_send (buf);
+        }
+    }
+    http_api_end_group ();
+
+    for (i = 0; i < MAX_STR_VARIABLES; i++)
+    {
+        if (i != WEATHER_APPID_STR_VAR && http_api_member ("str", VAR_GEN_STR + i, since, i))          // do not publish api key
+        {
+            http_send_json_string (strvars[i].str);
+        }
+    }
+    http_api_end_group ();
+
+    for (i = 0; i < MAX_DSP_COLOR_VARIABLES; i++)
+    {
+        if (http_api_member ("col", VAR_GEN_DSP_COLOR + i, since, i))
+        {
+            sprintf (buf, "[%u,%u,%u,%u]", dspcolorvars[i].red, dspcolorvars[i].green, dspcolorvars[i].blue, dspcolorvars[i].white);
+            http_send (buf);
+        }
+    }
+    http_api_end_group ();
+
+    for (i = 0; i < max_display_animation_variables; i++)
+    {
+        if (http_api_member ("anim", VAR_GEN_DISPLAY_ANIMATION + i, since, i))
+        {
+            http_send_FS ("[");
+            http_send_json_string (displayanimationvars[i].name);
+            sprintf (buf, ",%u,%u,%u]", displayanimationvars[i].deceleration, displayanimationvars[i].default_deceleration, displayanimationvars[i].flags);
+            http_send (buf);
+        }
+    }
+    http_api_end_group ();
+
+    for (i = 0; i < MAX_COLOR_ANIMATION_VARIABLES; i++)
+    {
+        if (http_api_member ("canim", VAR_GEN_COLOR_ANIMATION + i, since, i))
+        {
+            http_send_FS ("[");
+            http_send_json_string (coloranimationvars[i].name);
+            sprintf (buf, ",%u,%u,%u]", coloranimationvars[i].deceleration, coloranimationvars[i].default_deceleration, coloranimationvars[i].flags);
+            http_send (buf);
+        }
+    }
+    http_api_end_group ();
+
+    for (i = 0; i < MAX_AMBILIGHT_MODE_VARIABLES; i++)
+    {
+        if (http_api_member ("amb", VAR_GEN_AMBILIGHT_MODE + i, since, i))
+        {
+            http_send_FS ("[");
+            http_send_json_string (ambilightmodevars[i].name);
+            sprintf (buf, ",%u,%u,%u]", ambilightmodevars[i].deceleration, ambilightmodevars[i].default_deceleration, ambilightmodevars[i].flags);
+            http_send (buf);
+        }
+    }
+    http_api_end_group ();
+
+    n_overlays = get_numvar (OVERLAY_N_OVERLAYS_NUM_VAR);
+
+    if (n_overlays > MAX_OVERLAYS)
+    {
+        n_overlays = MAX_OVERLAYS;
+    }
+
+    for (i = 0; i < n_overlays; i++)
+    {
+        if (http_api_member ("ovl", VAR_GEN_OVERLAY + i, since, i))
+        {
+            sprintf (buf, "[%u,%u,%u,%u,%u,%u,", overlays[i].type, overlays[i].interval, overlays[i].duration,
+                     overlays[i].date_code, overlays[i].date_start, overlays[i].days);
+            http_send (buf);
+            http_send_json_string (overlays[i].text);
+            sprintf (buf, ",%u]", overlays[i].flags);
+            http_send (buf);
+        }
+    }
+    http_api_end_group ();
+
+    http_api_night_times ("night", nighttimevars, VAR_GEN_NIGHT_TIME, since);
+    http_api_night_times ("anight", ambilightnighttimevars, VAR_GEN_AMBILIGHT_NIGHT_TIME, since);
+
+    for (i = 0; i < MAX_ALARM_TIME_VARIABLES; i++)
+    {
+        if (http_api_member ("alarm", VAR_GEN_ALARM_TIME + i, since, i))
+        {
+            sprintf (buf, "[%u,%u]", alarmtimevars[i].minutes, alarmtimevars[i].flags);
+            http_send (buf);
+        }
+    }
+    http_api_end_group ();
+
+    http_send_FS ("}");
+}
+
+static int
+http_api_state (void)
+{
+    HTTP_CONNECTION *   conn = http_conn;
+    uint32_t            since;
+    uint_fast8_t        full;
+
+    since = http_api_since (strtoul (http_get_param ("since"), NULL, 10), &full);   // missing parameter: 0
+
+    if (conn)
+    {
+        sprintf (conn->etag, "%lu", (unsigned long) vars_generation);
+        conn->content_type  = "application/json";
+        conn->cache_control = "no-cache";
+
+        if (! strcmp (conn->if_none_match, conn->etag))
+        {
+            http_send_status ("304 Not Modified");
+            return 0;
+        }
+    }
+
+    http_send_status ("200 OK");
+    http_api_send_state (since, full);
+    http_flush ();
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * server-sent events: /api/events[?since=generation]
+ *
+ * Each event carries the generation as id and the changed variables in the format of /api/state as data. The first event
+ * contains the changes since the given generation or Last-Event-ID, the complete state if the generation is unknown.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_api_event (HTTP_CONNECTION * conn)
+{
+    char            buf[32];
+    uint32_t        since;
+    uint_fast8_t    full;
+
+    since = http_api_since (conn->event_gen, &full);
+    conn->event_gen = vars_generation;
+
+    sprintf (buf, "id: %lu\ndata: ", (unsigned long) vars_generation);
+    http_send (buf);
+    http_api_send_state (since, full);
+    http_send_FS ("\n\n");
+    http_stats.events++;
+}
+
+static int
+http_api_events (void)
 {
-    String result;
-    for (unsigned int i = 0; i < str.length(); i++)
+    HTTP_CONNECTION *   conn = http_conn;
+    int                 n_clients = 0;
+    int                 idx;
+
+    for (idx = 0; idx < HTTP_MAX_CONNECTIONS; idx++)
     {
-        switch (str[i])
+        if (http_connections[idx].events)
         {
-        case '&':
-            result += "&amp;";
-            break;
-        case '<':
-            result += "&lt;";
-            break;
-        case '>':
-            result += "&gt;";
-            break;
-        default:
-            result += str[i];
-            break;
+            n_clients++;
         }
     }
-    return result;
+
+    if (! conn || n_clients >= HTTP_MAX_EVENT_CLIENTS)
+    {
+        http_send_status ("503 Service Unavailable");
+        http_send_FS ("Too many event clients\r\n");
+        http_flush ();
+        return 0;
+    }
+
+    conn->events        = true;
+    conn->keep_alive    = false;                                            // stream ends with connection
+    conn->content_type  = "text/event-stream";
+    conn->cache_control = "no-cache";
+    conn->event_gen     = conn->last_event_id ? conn->last_event_id : strtoul (http_get_param ("since"), NULL, 10);
+
+    http_send_status ("200 OK");
+    http_send_FS ("retry: 3000\n");
+    http_api_event (conn);
+    return 0;
 }
 
 static int
@@ -4948,7 +6020,7 @@ http_get_settings()
     int           i;
     uint_fast8_t  ui;
 
-    http_send(FS("HTTP/1.0 200 OK\r\n\r\n"));
+    http_send_status ("200 OK");
     http_send(FS("<settings>"));
 
     // num vars
@@ -5190,34 +6262,12 @@ flash_stm32_local (bool post = false)
 uint_fast8_t
 http (const char * path, const char * const_param)
 {
-    char param[256];
-
-    strncpy (param, const_param, 255);
-    param[255] = '\0';
-
-    char *          p;
+    char            param[ESP8266_MAX_HTTP_GET_PARAM_SIZE];
     int             rtc = 0;
 
     // log_printf ("http path: '%s'\r\n", path);
 
-    for (p = param; *p; p++)
-    {
-        if (*p == '+')                                      // plus must be mapped to space if GET method
-        {
-            *p = ' ';
-        }
-    }
-
-    // log_printf ("http parameters: '%s'\r\n", param);
-
-    if (param[0])
-    {
-        http_set_params (param);
-    }
-    else
-    {
-        http_set_params ((char *) NULL);
-    }
+    http_set_params (param, ESP8266_MAX_HTTP_GET_PARAM_SIZE, const_param);
 
     if (hardware_configuration == 0xFFFF)
     {
@@ -5264,196 +6314,842 @@ http (const char * path, const char * const_param)
     {
         rtc = http_display_brightness ();
     }
-    else if (! strcmp (path, "/ambibright"))
+    else if (! strcmp (path, "/ambibright"))
+    {
+        rtc = http_ambilight_brightness ();
+    }
+    else if (! strcmp (path, "/display"))
+    {
+        rtc = http_display ();
+    }
+    else if (! strcmp (path, "/animations"))
+    {
+        rtc = http_animations ();
+    }
+    else if (! strcmp (path, "/overlays"))
+    {
+        rtc = http_overlays ();
+    }
+    else if (! strcmp (path, "/ambilight"))
+    {
+        rtc = http_ambilight ();
+    }
+    else if (! strcmp (path, "/timers"))
+    {
+        rtc = http_timers (0);
+    }
+    else if (! strcmp (path, "/atimers"))
+    {
+        rtc = http_timers (1);
+    }
+    else if (! strcmp (path, "/dfplayer"))
+    {
+        rtc = http_dfplayer ();
+    }
+    else if (! strcmp (path, "/tft"))
+    {
+        rtc = http_tft ();
+    }
+    else if (! strcmp (path, "/profile"))
+    {
+        rtc = http_profile ();
+    }
+    else if (! strcmp (path, "/fs"))
+    {
+        rtc = http_fs ();
+    }
+    else if (! strcmp (path, "/update"))
+    {
+        rtc = http_update ();
+    }
+    else if (! strcmp (path, "/flash_stm32_local"))
+    {
+        rtc = flash_stm32_local ();
+    }
+    else if (! strcmp (path, "/get_settings"))
+    {
+        rtc = http_get_settings ();
+    }
+    else if (! strcmp (path, "/api/state"))
+    {
+        rtc = http_api_state ();
+    }
+    else if (! strcmp (path, "/api/events"))
+    {
+        rtc = http_api_events ();
+    }
+    else
+    {
+        http_send_status ("404 Not Found");
+        http_send_FS ("404 Not Found\r\n");
+        http_flush ();
+    }
+
+    return rtc;
+}
+
+void
+http_post (const char * path)
+{
+    if (! strcmp (path, "/flash_stm32_local"))
+    {
+        flash_stm32_local (true);
+    }
+    else if (! strcmp (path, "/fs-icon"))
+    {
+        http_fs (POST_ICON_FILE);
+    }
+    else if (! strcmp (path, "/fs-icon-weather"))
+    {
+        http_fs (POST_ICON_WEATHER_FILE);
+    }
+    else if (! strcmp (path, "/fs-tables"))
+    {
+        http_fs (POST_TABLES_FILE);
+    }
+    else if (! strcmp (path, "/fs-display"))
+    {
+        http_fs (POST_DISPLAY_FILE);
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * record latency of a request: from first byte of request until response is handed over to TCP
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_record_latency (HTTP_CONNECTION * conn)
+{
+    unsigned long   latency = millis () - conn->start;
+    uint_fast8_t    idx;
+
+    for (idx = 0; idx < HTTP_LATENCY_BUCKETS - 1; idx++)
+    {
+        if (latency < http_latency_limits[idx])
+        {
+            break;
+        }
+    }
+
+    http_stats.latency[idx]++;
+
+    if (http_stats.max_latency < latency)
+    {
+        http_stats.max_latency = latency;
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * reset connection for next request
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_reset_request (HTTP_CONNECTION * conn)
+{
+    conn->state         = HTTP_CONN_REQUEST;
+    conn->in_header     = false;
+    conn->direct        = false;
+    conn->chunked       = false;
+    conn->accept_gzip   = false;
+    conn->events        = false;
+    conn->suspended     = false;
+    conn->resume_failed = false;
+    conn->chunk_open    = false;
+    conn->chunk_framed  = false;
+    conn->chunk_done    = false;
+    conn->last_event_id = 0;
+    conn->request_len   = 0;
+    conn->line_len      = 0;
+    conn->if_none_match[0] = '\0';
+    conn->status        = (const char *) NULL;
+    conn->content_type  = (const char *) NULL;
+    conn->content_encoding = (const char *) NULL;
+    conn->vary          = (const char *) NULL;
+    conn->cache_control = (const char *) NULL;
+    conn->etag[0]       = '\0';
+    conn->body_P        = (const uint8_t *) NULL;
+    conn->body_P_len    = 0;
+    conn->body_P_pos    = 0;
+    conn->body_len      = 0;
+    conn->body_hash     = HTTP_HASH_INIT;
+    conn->skip          = 0;
+    conn->header_len    = 0;
+    conn->header_pos    = 0;
+    conn->frame_len     = 0;
+    conn->frame_pos     = 0;
+    conn->start         = 0;
+    conn->last_activity = millis ();
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * close connection
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_close (HTTP_CONNECTION * conn)
+{
+    http_free_blocks_of (conn);
+
+    while (conn->client.available())                                        // firefox claims about connection reset, if we do not read all characters
+    {
+        conn->client.read();
+    }
+
+    conn->client.stop ();
+    conn->client = WiFiClient ();
+    conn->state = HTTP_CONN_FREE;
+    conn->events = false;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * check if page must be written directly: POST requests and pages which run long operations or close the connection
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static bool
+http_is_direct_path (const char * path)
+{
+    return (! strcmp (path, "/network") || ! strcmp (path, "/fs") || ! strcmp (path, "/update") || ! strcmp (path, "/flash_stm32_local"));
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * set size line of next chunk, len 0: end of chunked body
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_set_frame (HTTP_CONNECTION * conn, int len)
+{
+    conn->frame_len     = sprintf (conn->frame, "%s%x\r\n%s", conn->chunk_open ? "\r\n" : "", len, len ? "" : "\r\n");
+    conn->frame_pos     = 0;
+    conn->chunk_open    = (len != 0);
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * send as much of the queued response as the TCP window allows, with chunked encoding each output block is one chunk
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_send_pending (HTTP_CONNECTION * conn)
+{
+    size_t  room = conn->client.availableForWrite ();
+
+    while (room > 0)
+    {
+        const char *    data;
+        size_t          len;
+        size_t          n;
+
+        if (conn->header_pos < conn->header_len)
+        {
+            data = conn->header + conn->header_pos;
+            len  = conn->header_len - conn->header_pos;
+        }
+        else if (conn->frame_pos < conn->frame_len)
+        {
+            data = conn->frame + conn->frame_pos;
+            len  = conn->frame_len - conn->frame_pos;
+        }
+        else if (conn->out_head)
+        {
+            if (conn->chunked && ! conn->chunk_framed)
+            {
+                http_set_frame (conn, conn->out_head->len);
+                conn->chunk_framed = true;
+                continue;
+            }
+
+            data = conn->out_head->data + conn->out_pos;
+            len  = conn->out_head->len - conn->out_pos;
+        }
+        else if (conn->body_P_pos < conn->body_P_len)                       // static body from flash
+        {
+            len = conn->body_P_len - conn->body_P_pos;
+
+            if (len > room)
+            {
+                len = room;
+            }
+
+            n = conn->client.write_P ((PGM_P) conn->body_P + conn->body_P_pos, len);
+
+            if (n == 0)
+            {
+                break;
+            }
+
+            conn->body_P_pos += n;
+            room -= n;
+            conn->last_activity = millis ();
+            continue;
+        }
+        else if (conn->chunked && ! conn->suspended && ! conn->chunk_done)
+        {
+            http_set_frame (conn, 0);
+            conn->chunk_done = true;
+            continue;
+        }
+        else
+        {
+            break;
+        }
+
+        if (len > room)
+        {
+            len = room;
+        }
+
+        n = conn->client.write ((const uint8_t *) data, len);
+
+        if (n == 0)
+        {
+            break;
+        }
+
+        if (conn->header_pos < conn->header_len)
+        {
+            conn->header_pos += n;
+        }
+        else if (conn->frame_pos < conn->frame_len)
+        {
+            conn->frame_pos += n;
+        }
+        else
+        {
+            conn->out_pos += n;
+
+            if (conn->out_pos == conn->out_head->len)
+            {
+                HTTP_BLOCK * b = conn->out_head;
+
+                conn->out_head = b->next;
+
+                if (! conn->out_head)
+                {
+                    conn->out_tail = (HTTP_BLOCK *) NULL;
+                }
+
+                http_release_block (b);
+                conn->out_pos = 0;
+                conn->chunk_framed = false;
+            }
+        }
+
+        room -= n;
+        conn->last_activity = millis ();
+    }
+
+    if (conn->header_pos == conn->header_len && conn->frame_pos == conn->frame_len && ! conn->out_head &&
+        conn->body_P_pos == conn->body_P_len && ! conn->suspended && (! conn->chunked || conn->chunk_done))       // response complete
+    {
+        if (conn->events)                                                   // event sent, wait for next change
+        {
+            if (conn->start)
+            {
+                http_record_latency (conn);
+                conn->start = 0;
+            }
+
+            conn->state = HTTP_CONN_EVENTS;
+            return;
+        }
+
+        http_record_latency (conn);
+
+        if (conn->keep_alive)
+        {
+            conn->body_len = 0;
+            http_reset_request (conn);
+        }
+        else
+        {
+            http_close (conn);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * serve static asset from flash, precompressed if the client accepts gzip, answer 304 if the client already has this version.
+ * Both encodings have their own ETag, Vary tells caches that the response depends on Accept-Encoding.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static bool
+http_asset (HTTP_CONNECTION * conn, const char * path)
+{
+    if (strcmp (path, "/style.css"))
     {
-        rtc = http_ambilight_brightness ();
+        return false;
     }
-    else if (! strcmp (path, "/display"))
+
+    strcpy (conn->etag, conn->accept_gzip ? STYLE_CSS_VERSION "-gz" : STYLE_CSS_VERSION);
+    conn->cache_control = "public, max-age=31536000, immutable";
+    conn->vary          = "Accept-Encoding";
+
+    if (! strcmp (conn->if_none_match, conn->etag))
     {
-        rtc = http_display ();
+        conn->status            = "304 Not Modified";
     }
-    else if (! strcmp (path, "/animations"))
+    else
     {
-        rtc = http_animations ();
+        conn->status            = "200 OK";
+        conn->content_type      = "text/css";
+
+        if (conn->accept_gzip)
+        {
+            conn->content_encoding  = "gzip";
+            conn->body_P            = style_css_gz;
+            conn->body_P_len        = sizeof (style_css_gz);
+        }
+        else
+        {
+            conn->body_P            = style_css;
+            conn->body_P_len        = sizeof (style_css);
+        }
     }
-    else if (! strcmp (path, "/overlays"))
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * handle complete request
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_dispatch (HTTP_CONNECTION * conn)
+{
+    char *  path    = conn->request;
+    char *  param   = (char *) "";
+    char *  p;
+    bool    is_post = false;
+
+    http_stats.requests++;
+
+    if (! strncmp (path, "POST ", 5))
     {
-        rtc = http_overlays ();
+        is_post = true;
+        path += 5;
     }
-    else if (! strcmp (path, "/ambilight"))
+    else if (! strncmp (path, "GET ", 4))
     {
-        rtc = http_ambilight ();
+        path += 4;
     }
-    else if (! strcmp (path, "/timers"))
+    else
     {
-        rtc = http_timers (0);
+        path += conn->request_len;                                          // unknown method: empty path, 404
     }
-    else if (! strcmp (path, "/atimers"))
+
+    p = strchr (path, ' ');
+
+    if (p)
     {
-        rtc = http_timers (1);
+        *p = '\0';
     }
-    else if (! strcmp (path, "/dfplayer"))
+
+    p = strchr (path, '?');
+
+    if (p)
     {
-        rtc = http_dfplayer ();
+        *p = '\0';
+        param = p + 1;
     }
-    else if (! strcmp (path, "/tft"))
+
+    http_client         = conn->client;
+    conn->page          = path;
+
+    if (is_post || http_is_direct_path (path))
     {
-        rtc = http_tft ();
+        conn->direct = true;
     }
-    else if (! strcmp (path, "/fs"))
+    else
     {
-        rtc = http_fs ();
+        http_conn = conn;
     }
-    else if (! strcmp (path, "/update"))
+
+    if (is_post)
     {
-        rtc = http_update ();
+        http_post (path);
     }
-    else if (! strcmp (path, "/flash_stm32_local"))
+    else if (! http_asset (conn, path))
     {
-        rtc = flash_stm32_local ();
+        http (path, param);
     }
-    else if (! strcmp (path, "/get_settings"))
+
+    http_conn = (HTTP_CONNECTION *) NULL;
+
+    if (conn->direct)
     {
-        rtc = http_get_settings ();
+        http_flush ();
+        http_client.flush ();
+        http_record_latency (conn);
+        http_close (conn);
     }
     else
     {
-        const char * p = "HTTP/1.0 404 Not Found";
-        http_send (p);
-        http_send_FS ("\r\n\r\n404 Not Found\r\n");
-        http_flush ();
+        http_build_header (conn);
+        conn->state = HTTP_CONN_SEND;
+        conn->last_activity = millis ();
+        http_send_pending (conn);
     }
 
-    return rtc;
-}
+    http_client = WiFiClient ();
 
-void
-http_post(const String& sPath)
-{
-    if (sPath == "/flash_stm32_local")
-    {
-        flash_stm32_local (true);
-    }
-    else if (sPath == "/fs-icon")
-    {
-        http_fs (POST_ICON_FILE);
-    }
-    else if (sPath == "/fs-icon-weather")
-    {
-        http_fs (POST_ICON_WEATHER_FILE);
-    }
-    else if (sPath == "/fs-tables")
+    unsigned long   free_heap       = ESP.getFreeHeap ();
+    unsigned long   fragmentation   = ESP.getHeapFragmentation ();
+
+    if (http_stats.min_free_heap == 0 || http_stats.min_free_heap > free_heap)
     {
-        http_fs (POST_TABLES_FILE);
+        http_stats.min_free_heap = free_heap;
     }
-    else if (sPath == "/fs-display")
+
+    if (http_stats.max_heap_fragmentation < fragmentation)
     {
-        http_fs (POST_DISPLAY_FILE);
+        http_stats.max_heap_fragmentation = fragmentation;
     }
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------
- * http server
+ * generate suspended page again without parameters, skip the part already sent and queue the rest as far as the pool allows
  *----------------------------------------------------------------------------------------------------------------------------------------
  */
-void
-http_server_loop (void)
+static void
+http_resume (HTTP_CONNECTION * conn)
 {
-    String  sPath       = "";
-    String  sParam      = "";
-    String  sCmd        = "";
-    String  sGetstart   = "GET ";
-    String  sPoststart  = "POST ";
-    String  sResponse   = "";
-    int     start_position;
-    int     end_position_space;
-    int     end_position_question;
+    conn->suspended     = false;
+    conn->skip          = conn->body_len;
+    conn->skip_hash     = HTTP_HASH_INIT;
 
-    http_client = http_server.accept();                                     // check if a client has connected
+    http_client         = conn->client;
+    http_conn           = conn;
+    http (conn->page, "");
+    http_conn           = (HTTP_CONNECTION *) NULL;
+    http_client         = WiFiClient ();
 
-    if (!http_client)                                                       // wait until the client sends some data
+    if (conn->skip > 0)                                                     // page has become shorter
     {
-        return;
+        conn->resume_failed = true;
     }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * number of output blocks which can be allocated
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+http_available_blocks (void)
+{
+    return http_n_free_blocks + HTTP_MAX_OUTPUT_BLOCKS - http_n_blocks;
+}
 
-    Serial.println("- new client");
-    Serial.flush ();
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * check if request line has parameters
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static bool
+http_has_params (HTTP_CONNECTION * conn)
+{
+    char *  p = strchr (conn->request, '?');
 
-    unsigned long ultimeout = millis() + 250;
+    return (p && p[1] != ' ' && p[1] != '\0');
+}
 
-    while (! http_client.available() && (millis() < ultimeout) )
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * check if a complete request can be handled: a request with parameters is generated in one go, see above
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static bool
+http_can_dispatch (HTTP_CONNECTION * conn)
+{
+    if (http_has_params (conn))
     {
-        delay(1);
+        return (http_available_blocks () == HTTP_MAX_OUTPUT_BLOCKS);
     }
 
-    if (millis() > ultimeout)
+    return (! http_exclusive_wait && http_available_blocks () >= HTTP_RESUME_MIN_FREE_BLOCKS);
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * read available characters of request, dispatch request if complete
+ *
+ * POST requests are dispatched after the request line, because the handlers read header and body themselves.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+http_read_request (HTTP_CONNECTION * conn)
+{
+    int     ch;
+
+    while (conn->state == HTTP_CONN_REQUEST && conn->client.available())
     {
-        Serial.println ("- client connection time-out!");
-        Serial.flush ();
-        return;
+        ch = conn->client.read ();
+
+        if (ch < 0)
+        {
+            break;
+        }
+
+        if (conn->start == 0)
+        {
+            conn->start = millis ();
+
+            if (conn->start == 0)
+            {
+                conn->start = 1;
+            }
+        }
+
+        conn->last_activity = millis ();
+
+        if (! conn->in_header)
+        {
+            if (ch == '\n')
+            {
+                conn->request[conn->request_len] = '\0';
+
+                if (conn->request_len == 0)                                 // empty line before request, e.g. after previous body
+                {
+                    continue;
+                }
+
+                conn->http11        = (strstr (conn->request, " HTTP/1.1") != (char *) NULL);
+                conn->keep_alive    = conn->http11;
+                conn->in_header     = true;
+
+                if (! strncmp (conn->request, "POST ", 5))
+                {
+                    http_dispatch (conn);
+                }
+            }
+            else if (ch != '\r' && conn->request_len < HTTP_MAX_REQUEST_LEN)
+            {
+                conn->request[conn->request_len++] = ch;
+            }
+        }
+        else
+        {
+            if (ch == '\n')
+            {
+                if (conn->line_len == 0)                                    // end of header
+                {
+                    conn->state = HTTP_CONN_WAIT;
+                }
+                else
+                {
+                    conn->line[conn->line_len] = '\0';
+
+                    if (! mystrnicmp (conn->line, "Connection:", 11))
+                    {
+                        char * p = conn->line + 11;
+
+                        while (*p == ' ')
+                        {
+                            p++;
+                        }
+
+                        if (! mystrnicmp (p, "close", 5))
+                        {
+                            conn->keep_alive = false;
+                        }
+                        else if (! mystrnicmp (p, "keep-alive", 10))
+                        {
+                            conn->keep_alive = true;
+                        }
+                    }
+                    else if (! mystrnicmp (conn->line, "Accept-Encoding:", 16))
+                    {
+                        conn->accept_gzip = (strstr (conn->line + 16, "gzip") != (char *) NULL);
+                    }
+                    else if (! mystrnicmp (conn->line, "Last-Event-ID:", 14))
+                    {
+                        conn->last_event_id = strtoul (conn->line + 14, NULL, 10);
+                    }
+                    else if (! mystrnicmp (conn->line, "If-None-Match:", 14))
+                    {
+                        char *  p = strchr (conn->line + 14, '"');
+                        char *  e;
+
+                        if (p && (e = strchr (p + 1, '"')) != (char *) NULL && e - p - 1 <= HTTP_MAX_ETAG_LEN)
+                        {
+                            *e = '\0';
+                            strcpy (conn->if_none_match, p + 1);
+                        }
+                    }
+
+                    conn->line_len = 0;
+                }
+            }
+            else if (ch != '\r' && conn->line_len < HTTP_MAX_HEADER_LINE_LEN)
+            {
+                conn->line[conn->line_len++] = ch;
+            }
+        }
     }
-    http_client.setNoDelay(1);
+}
 
-    String sRequest = http_client.readStringUntil ('\r');                   // read the first line of the request
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * http server: accept new clients, read requests and send pending responses of all connections without waiting
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+http_server_loop (void)
+{
+    HTTP_CONNECTION *   conn;
+    uint_fast8_t        idx;
 
-    if (sRequest == "")                                                     // stop client, if request is empty
+    for (idx = 0; idx < HTTP_MAX_CONNECTIONS; idx++)
     {
-        Serial.println ("- empty http request");
-        Serial.flush ();
-        while (http_client.available())                                     // firefox claims about connection reset, if we do not read all characters
+        conn = http_connections + idx;
+
+        if (conn->state == HTTP_CONN_FREE)
         {
-            http_client.read();
+            if (! http_server.hasClient())
+            {
+                break;
+            }
+
+            conn->client = http_server.accept();                            // check if a client has connected
+
+            if (! conn->client)
+            {
+                break;
+            }
+
+            Serial.println("- new client");
+            Serial.flush ();
+
+            conn->client.setNoDelay(1);
+            conn->keep_alive = false;
+            http_reset_request (conn);
         }
-        http_client.stop();
-        return;
     }
 
-    // POST
-    start_position = sRequest.indexOf(sPoststart);
+    http_exclusive_wait = false;
 
-    if (start_position == 0)
+    for (idx = 0; idx < HTTP_MAX_CONNECTIONS; idx++)
     {
-        start_position += sPoststart.length ();
-        end_position_space = sRequest.indexOf (" ", start_position);
-
-        sPath  = sRequest.substring(start_position, end_position_space);
-        http_post (sPath);
+        if (http_connections[idx].state == HTTP_CONN_WAIT && http_has_params (http_connections + idx))
+        {
+            http_exclusive_wait = true;
+        }
     }
-    else // GET
+
+    for (idx = 0; idx < HTTP_MAX_CONNECTIONS; idx++)
     {
-        start_position = sRequest.indexOf(sGetstart);
+        conn = http_connections + idx;
 
-        if (start_position >= 0)
+        if (conn->state == HTTP_CONN_REQUEST)
         {
-            start_position += sGetstart.length ();
-            end_position_space = sRequest.indexOf (" ", start_position);
-            end_position_question = sRequest.indexOf ("?", start_position);
-
-            if (end_position_space > 0)                                         // parameters?
+            if (conn->client.available())
             {
-                if (end_position_question > 0)
-                {                                                               // yes
-                    sPath  = sRequest.substring(start_position, end_position_question);
-                    sParam = sRequest.substring(end_position_question + 1, end_position_space);
+                if (conn->start == 0 && conn->keep_alive)
+                {
+                    http_stats.keepalive++;                                 // next request on kept-alive connection
                 }
-                else
-                {                                                               // no
-                    sPath  = sRequest.substring(start_position, end_position_space);
+
+                http_read_request (conn);
+            }
+            else if (! conn->client.connected())
+            {
+                http_close (conn);
+            }
+            else if (millis () - conn->last_activity > (conn->start ? HTTP_REQUEST_TIMEOUT : HTTP_KEEPALIVE_TIMEOUT))
+            {
+                if (conn->start)
+                {
+                    http_stats.timeouts++;
                 }
+                http_close (conn);
             }
         }
 
-        http (sPath.c_str(), sParam.c_str());
-    }
+        if (conn->state == HTTP_CONN_WAIT)
+        {
+            if (http_can_dispatch (conn))
+            {
+                http_dispatch (conn);
+            }
+        }
+        else if (conn->state == HTTP_CONN_SEND)
+        {
+            if (! conn->client.connected())
+            {
+                http_stats.timeouts++;
+                http_close (conn);
+            }
+            else
+            {
+                http_send_pending (conn);
+
+                if (conn->state == HTTP_CONN_SEND && conn->suspended && ! conn->out_head && ! http_exclusive_wait &&
+                    http_available_blocks () >= HTTP_RESUME_MIN_FREE_BLOCKS)
+                {
+                    http_resume (conn);
 
-    http_client.flush();
+                    if (conn->resume_failed)
+                    {
+                        http_stats.resume_errors++;
+                        http_close (conn);
+                        continue;
+                    }
 
-    while (http_client.available())                                         // firefox claims about connection reset, if we do not read all characters
-    {
-        http_client.read();
+                    http_send_pending (conn);
+                }
+
+                if (conn->state == HTTP_CONN_SEND && millis () - conn->last_activity > HTTP_SEND_TIMEOUT)
+                {
+                    if (conn->events)
+                    {
+                        http_stats.event_drops++;
+                    }
+
+                    http_stats.timeouts++;                                  // slow client, drop it
+                    http_close (conn);
+                }
+            }
+        }
+        else if (conn->state == HTTP_CONN_EVENTS)
+        {
+            while (conn->client.available())                                // nothing expected from client
+            {
+                conn->client.read ();
+            }
+
+            if (! conn->client.connected())
+            {
+                http_close (conn);
+            }
+            else if (! http_exclusive_wait && http_available_blocks () >= HTTP_EVENT_MIN_FREE_BLOCKS)
+            {                                                               // else wait until other responses are sent
+                if (conn->event_gen != vars_generation)
+                {
+                    http_conn = conn;
+                    http_api_event (conn);
+                    http_conn = (HTTP_CONNECTION *) NULL;
+                }
+                else if (millis () - conn->last_activity > HTTP_EVENT_HEARTBEAT)
+                {
+                    http_queue (conn, ":\n\n", 3, false);                   // comment: keeps connection and detects dead clients
+                }
+
+                if (! conn->events)                                         // event did not fit into output pool
+                {
+                    http_close (conn);
+                }
+                else if (conn->out_head)
+                {
+                    conn->state = HTTP_CONN_SEND;
+                    http_send_pending (conn);
+                }
+            }
+        }
     }
+}
 
-    http_client.stop();                                                     // stop client
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * reset http statistics
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+http_reset_stats (void)
+{
+    memset (&http_stats, 0, sizeof (HTTP_STATS));
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------
@@ -12,12 +12,33 @@
 #ifndef HTTP_H
 #define HTTP_H
 
-#define http_send_FS(x)     http_send(FS(x))                                         // leave string constants in flash memory
+#define http_send_FS(x)     http_send_P(PSTR(x))                                     // leave string constants in flash memory
+
+#define HTTP_LATENCY_BUCKETS        9                                                   // < 5, 10, 20, 50, 100, 200, 500, 1000, >= 1000 msec
+
+typedef struct
+{
+    unsigned long           requests;
+    unsigned long           keepalive;                                                  // requests on kept-alive connections
+    unsigned long           timeouts;                                                   // connections dropped: timeout or closed by client
+    unsigned long           overflows;                                                  // responses which exceeded the output pool
+    unsigned long           resume_errors;                                              // responses aborted: page changed while suspended
+    unsigned long           latency[HTTP_LATENCY_BUCKETS];                              // histogram of request latency
+    unsigned long           max_latency;                                                // msec
+    unsigned long           min_free_heap;                                              // after request, 0: no request yet
+    unsigned long           max_heap_fragmentation;                                     // after request, percent
+    unsigned long           events;                                                     // events sent to /api/events clients
+    unsigned long           event_drops;                                                // /api/events clients dropped: too slow
+} HTTP_STATS;
+
+extern HTTP_STATS           http_stats;
 
 extern uint_fast8_t         http (const char *, const char *);
 extern void                 http_send (const char *);
+extern void                 http_send_P (const char *);
 extern void                 http_flush (void);
 extern void                 http_server_loop (void);
 extern void                 http_server_begin (void);
+extern void                 http_reset_stats (void);
 
 #endif
@@ -10,10 +10,40 @@
  *----------------------------------------------------------------------------------------------------------------------------------------
  */
 #include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include <bearssl/bearssl_hash.h>
 #include <strings.h>
 #include "base.h"
+#include "httpclient.h"
+
+#define HTTPCLIENT_TIMEOUT              5000                            // msec without data: connection is stalled
 
 static WiFiClient      client;
+static bool            chunked;                                         // Transfer-Encoding: chunked
+static int             chunk_len;                                       // remaining bytes of current chunk
+static long            range_start;                                     // Content-Range: first byte of partial content
+static long            range_total;                                     // Content-Range: size of complete file, -1: unknown
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * httpclient_getc () - wait for next character, return -1 if connection has been closed or stalled
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+httpclient_getc (void)
+{
+    unsigned long   start = millis ();
+
+    while (! client.available())
+    {
+        if (! client.connected() || millis () - start >= HTTPCLIENT_TIMEOUT)
+        {
+            return -1;
+        }
+        yield ();
+    }
+
+    return client.read();
+}
 
 int
 httpclient_read_header (int * lenp)
@@ -22,13 +52,14 @@ httpclient_read_header (int * lenp)
     char *  p;
     int     cnt = 0;
     int     ch;
-    int     len = 0;
+    int     len = HTTPCLIENT_UNKNOWN_LEN;                           // without Content-Length: content ends with connection
     int     errorcode = 0;
 
-    while (client.available())                           // skip http header
-    {
-        ch = client.read();
+    range_start = 0;
+    range_total = -1;
 
+    while ((ch = httpclient_getc ()) >= 0)                              // skip http header
+    {
         if (ch == '\n')
         {
             if (cnt == 0)
@@ -65,6 +96,20 @@ httpclient_read_header (int * lenp)
                     len = atoi (p);
                 }
             }
+            else if (! mystrnicmp (linebuf, "Transfer-Encoding: chunked", 26))
+            {
+                chunked = true;
+            }
+            else if (! mystrnicmp (linebuf, "Content-Range: bytes ", 21))   // e.g. "bytes 1000-4999/5000"
+            {
+                range_start = atol (linebuf + 21);
+                p = strchr (linebuf, '/');
+
+                if (p && p[1] != '*')
+                {
+                    range_total = atol (p + 1);
+                }
+            }
 
             cnt = 0;
         }
@@ -77,23 +122,48 @@ httpclient_read_header (int * lenp)
         }
     }
 
+    if (chunked)
+    {
+        len = HTTPCLIENT_UNKNOWN_LEN;                                   // httpclient_read() sets len to 0 after last chunk
+    }
+
     *lenp = len;
     return errorcode;
 }
 
-int
-httpclient (const char * host, const char * path, const char * file)
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * httpclient_get () - send GET request and read http header
+ *
+ * Returns length of content or -1 if connection failed. The http status is returned in *errorcodep, the content can be
+ * read with httpclient_read() even if status is not 200, e.g. JSON error messages.
+ *
+ * httpclient_get_range() requests the content from byte offset on, the server answers with status 206 or ignores the
+ * range and sends the complete content with status 200.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+httpclient_get_range (const char * host, const char * url, uint32_t offset, int * errorcodep)
 {
     const int       port = 80;
-    int             errorcode;
     int             len;
 
+    chunked     = false;
+    chunk_len   = 0;
+
     if (! client.connect(host, port))
     {
         return -1;
     }
 
-    client.print (String("GET ") + "/" + path + "/" + file + " HTTP/1.1\r\n" + "Host: " + host + "\r\n" + "Connection: close\r\n\r\n");
+    if (offset > 0)
+    {
+        client.print (String("GET ") + url + " HTTP/1.1\r\n" + "Host: " + host + "\r\n" + "Range: bytes=" + offset + "-\r\n" +
+                      "Connection: close\r\n\r\n");
+    }
+    else
+    {
+        client.print (String("GET ") + url + " HTTP/1.1\r\n" + "Host: " + host + "\r\n" + "Connection: close\r\n\r\n");
+    }
 
     unsigned long timeout = millis();
 
@@ -106,7 +176,28 @@ httpclient (const char * host, const char * path, const char * file)
         }
     }
 
-    errorcode = httpclient_read_header (&len);
+    *errorcodep = httpclient_read_header (&len);
+    return len;
+}
+
+int
+httpclient_get (const char * host, const char * url, int * errorcodep)
+{
+    return httpclient_get_range (host, url, 0, errorcodep);
+}
+
+int
+httpclient (const char * host, const char * path, const char * file)
+{
+    int             errorcode;
+    int             len;
+
+    len = httpclient_get (host, ((String) "/" + path + "/" + file).c_str(), &errorcode);
+
+    if (len < 0)
+    {
+        return -1;
+    }
 
     if (errorcode != 200)                                                               // webserver errorcode != 200 (OK)
     {
@@ -117,6 +208,55 @@ httpclient (const char * host, const char * path, const char * file)
     return len;                                                                         // length of content to be read
 }
 
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * httpclient_read_chunk_len () - read length line of next chunk
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+httpclient_read_chunk_len (void)
+{
+    int     len         = 0;
+    int     digits      = 0;
+    bool    extension   = false;
+    int     ch;
+
+    while ((ch = httpclient_getc ()) >= 0)
+    {
+        if (ch == '\n')
+        {
+            if (digits > 0)
+            {
+                return len;
+            }
+            continue;                                                   // CR LF after data of previous chunk
+        }
+
+        if (! extension)
+        {
+            if (ch >= '0' && ch <= '9')
+            {
+                len = (len << 4) | (ch - '0');
+                digits++;
+            }
+            else if (ch >= 'A' && ch <= 'F')
+            {
+                len = (len << 4) | (ch - 'A' + 10);
+                digits++;
+            }
+            else if (ch >= 'a' && ch <= 'f')
+            {
+                len = (len << 4) | (ch - 'a' + 10);
+                digits++;
+            }
+            else if (ch != '\r')
+            {
+                extension = true;                                       // chunk extension, e.g. ";name=value": ignore rest of line
+            }
+        }
+    }
+    return -1;
+}
+
 int
 httpclient_read (int * lenp)
 {
@@ -125,13 +265,33 @@ httpclient_read (int * lenp)
 
     if (len > 0)
     {
-        while (! client.available())
+        if (chunked)
         {
-            ;
+            if (chunk_len == 0)
+            {
+                chunk_len = httpclient_read_chunk_len ();
+
+                if (chunk_len <= 0)                                     // last chunk or error
+                {
+                    *lenp = 0;
+                    return -1;
+                }
+            }
+
+            chunk_len--;
+        }
+        else
+        {
+            len--;
+        }
+
+        ch = httpclient_getc ();
+
+        if (ch < 0)
+        {
+            len = 0;
         }
 
-        ch = client.read();
-        len--;
         *lenp = len;
     }
     return ch;
@@ -177,3 +337,638 @@ httpclient_stop (void)
 {
     client.stop ();
 }
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * non-blocking decoding of a response
+ *
+ * The caller owns the connection and passes the received bytes one by one to httpclient_response_feed(), e.g. as many as
+ * client.available() reports in one pass of the main loop. The decoder reads status line and header and removes chunked
+ * transfer encoding. Return values:
+ *
+ *  >= 0                        byte of content
+ *  HTTPCLIENT_RESPONSE_MORE    byte of header or chunk framing consumed
+ *  HTTPCLIENT_RESPONSE_END     content is complete, further bytes are ignored
+ *  HTTPCLIENT_RESPONSE_ERROR   malformed response
+ *
+ * Without Content-Length and chunked encoding the content ends when the server closes the connection.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define HTTPCLIENT_RESPONSE_HEADER      0                               // reading status line and header
+#define HTTPCLIENT_RESPONSE_BODY        1                               // reading content
+#define HTTPCLIENT_RESPONSE_CHUNK_LEN   2                               // reading length line of chunk
+#define HTTPCLIENT_RESPONSE_CHUNK_EXT   3                               // skipping chunk extension
+#define HTTPCLIENT_RESPONSE_CHUNK_DATA  4                               // reading data of chunk
+#define HTTPCLIENT_RESPONSE_DONE        5
+#define HTTPCLIENT_RESPONSE_FAILED      6
+
+void
+httpclient_response_init (HTTPCLIENT_RESPONSE * r)
+{
+    r->state    = HTTPCLIENT_RESPONSE_HEADER;
+    r->chunked  = false;
+    r->line_len = 0;
+    r->status   = 0;
+    r->len      = -1;
+}
+
+static int
+httpclient_response_header_line (HTTPCLIENT_RESPONSE * r)
+{
+    char *  p;
+
+    if (r->line_len == 0)                                               // empty line: end of header
+    {
+        if (r->status == 0)
+        {
+            r->state = HTTPCLIENT_RESPONSE_FAILED;
+            return HTTPCLIENT_RESPONSE_ERROR;
+        }
+
+        if (r->chunked)
+        {
+            r->len      = 0;
+            r->state    = HTTPCLIENT_RESPONSE_CHUNK_LEN;
+        }
+        else if (r->len == 0)
+        {
+            r->state = HTTPCLIENT_RESPONSE_DONE;
+            return HTTPCLIENT_RESPONSE_END;
+        }
+        else
+        {
+            r->state = HTTPCLIENT_RESPONSE_BODY;
+        }
+        return HTTPCLIENT_RESPONSE_MORE;
+    }
+
+    r->line[r->line_len] = '\0';
+    r->line_len = 0;
+
+    if (r->status == 0)
+    {
+        p = strchr (r->line, ' ');
+
+        if (mystrnicmp (r->line, "HTTP", 4) || ! p || (r->status = atoi (p + 1)) <= 0)
+        {
+            r->state = HTTPCLIENT_RESPONSE_FAILED;
+            return HTTPCLIENT_RESPONSE_ERROR;
+        }
+    }
+    else if (! mystrnicmp (r->line, "Content-Length: ", 16))
+    {
+        r->len = atol (r->line + 16);
+    }
+    else if (! mystrnicmp (r->line, "Transfer-Encoding: chunked", 26))
+    {
+        r->chunked = true;
+    }
+    return HTTPCLIENT_RESPONSE_MORE;
+}
+
+static int
+httpclient_response_chunk_line (HTTPCLIENT_RESPONSE * r)
+{
+    if (r->line_len == 0)                                               // CR LF after data of previous chunk
+    {
+        r->state = HTTPCLIENT_RESPONSE_CHUNK_LEN;
+        return HTTPCLIENT_RESPONSE_MORE;
+    }
+
+    r->line_len = 0;
+
+    if (r->len == 0)                                                    // last chunk, trailer is ignored
+    {
+        r->state = HTTPCLIENT_RESPONSE_DONE;
+        return HTTPCLIENT_RESPONSE_END;
+    }
+
+    r->state = HTTPCLIENT_RESPONSE_CHUNK_DATA;
+    return HTTPCLIENT_RESPONSE_MORE;
+}
+
+int
+httpclient_response_feed (HTTPCLIENT_RESPONSE * r, int ch)
+{
+    switch (r->state)
+    {
+        case HTTPCLIENT_RESPONSE_HEADER:
+        {
+            if (ch == '\n')
+            {
+                return httpclient_response_header_line (r);
+            }
+
+            if (ch != '\r' && r->line_len < sizeof (r->line) - 1)
+            {
+                r->line[r->line_len++] = ch;
+            }
+            return HTTPCLIENT_RESPONSE_MORE;
+        }
+
+        case HTTPCLIENT_RESPONSE_BODY:
+        {
+            if (r->len > 0 && --r->len == 0)
+            {
+                r->state = HTTPCLIENT_RESPONSE_DONE;
+            }
+            return ch;
+        }
+
+        case HTTPCLIENT_RESPONSE_CHUNK_LEN:
+        {
+            int digit = -1;
+
+            if (ch >= '0' && ch <= '9')
+            {
+                digit = ch - '0';
+            }
+            else if (ch >= 'A' && ch <= 'F')
+            {
+                digit = ch - 'A' + 10;
+            }
+            else if (ch >= 'a' && ch <= 'f')
+            {
+                digit = ch - 'a' + 10;
+            }
+
+            if (digit >= 0)
+            {
+                if (r->len >= 0x1000000)                                // more than 256 MB: garbage
+                {
+                    r->state = HTTPCLIENT_RESPONSE_FAILED;
+                    return HTTPCLIENT_RESPONSE_ERROR;
+                }
+
+                r->len = (r->len << 4) | digit;
+                r->line_len++;
+            }
+            else if (ch == '\n')
+            {
+                return httpclient_response_chunk_line (r);
+            }
+            else if (ch != '\r')
+            {
+                r->state = HTTPCLIENT_RESPONSE_CHUNK_EXT;               // chunk extension, e.g. ";name=value": ignore rest of line
+            }
+            return HTTPCLIENT_RESPONSE_MORE;
+        }
+
+        case HTTPCLIENT_RESPONSE_CHUNK_EXT:
+        {
+            if (ch == '\n')
+            {
+                return httpclient_response_chunk_line (r);
+            }
+            return HTTPCLIENT_RESPONSE_MORE;
+        }
+
+        case HTTPCLIENT_RESPONSE_CHUNK_DATA:
+        {
+            if (--r->len == 0)
+            {
+                r->state = HTTPCLIENT_RESPONSE_CHUNK_LEN;
+            }
+            return ch;
+        }
+
+        case HTTPCLIENT_RESPONSE_DONE:
+        {
+            return HTTPCLIENT_RESPONSE_END;
+        }
+
+        default:                                                        // HTTPCLIENT_RESPONSE_FAILED
+        {
+            return HTTPCLIENT_RESPONSE_ERROR;
+        }
+    }
+}
+
+bool
+httpclient_response_complete (HTTPCLIENT_RESPONSE * r)
+{
+    return r->state == HTTPCLIENT_RESPONSE_DONE;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * httpclient_read_block () - read up to size bytes of content
+ *
+ * Returns number of bytes read, 0 at end of content, -1 if connection has been closed or stalled
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+httpclient_read_block (uint8_t * buf, int size, int * lenp)
+{
+    unsigned long   start;
+    int             len = *lenp;
+    int             n;
+
+    if (len <= 0)
+    {
+        return 0;
+    }
+
+    if (chunked)
+    {
+        if (chunk_len == 0)
+        {
+            chunk_len = httpclient_read_chunk_len ();
+
+            if (chunk_len <= 0)                                         // last chunk or error
+            {
+                *lenp = 0;
+                return chunk_len;
+            }
+        }
+
+        if (size > chunk_len)
+        {
+            size = chunk_len;
+        }
+    }
+    else if (size > len)
+    {
+        size = len;
+    }
+
+    start = millis ();
+
+    while ((n = client.available()) == 0)
+    {
+        if (! client.connected() || millis () - start >= HTTPCLIENT_TIMEOUT)
+        {
+            *lenp = 0;
+
+            if (! chunked && len == HTTPCLIENT_UNKNOWN_LEN && ! client.connected())
+            {
+                return 0;                                               // no Content-Length: end of connection is end of content
+            }
+            return -1;
+        }
+        yield ();
+    }
+
+    if (n > size)
+    {
+        n = size;
+    }
+
+    n = client.read (buf, n);
+
+    if (n <= 0)
+    {
+        *lenp = 0;
+        return -1;
+    }
+
+    if (chunked)
+    {
+        chunk_len -= n;
+    }
+    else
+    {
+        *lenp = len - n;
+    }
+
+    return n;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * download with resume and integrity check
+ *
+ * The file is downloaded into a temporary file which is renamed to the target after the checksum has been verified. If the
+ * connection breaks, the download is resumed with a Range request. Checksums are read from the optional file HTTPCLIENT_MANIFEST
+ * in the same path, format as produced by sha256sum or crc32:
+ *
+ *   <64 hex digits SHA-256 or 8 hex digits CRC32>  <filename>
+ *
+ * Files not listed in the manifest are stored without check.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define HTTPCLIENT_BUFSIZE              2048                            // multiple of LittleFS program size
+#define HTTPCLIENT_MAX_RESUMES          5
+#define HTTPCLIENT_TMPFILE              "download.tmp"
+#define HTTPCLIENT_SHA256_SIZE          32
+
+typedef struct
+{
+    uint8_t             buf[HTTPCLIENT_BUFSIZE];
+    br_sha256_context   sha256;
+    uint32_t            crc32;
+    uint8_t             expected[HTTPCLIENT_SHA256_SIZE];               // SHA-256 or CRC32 (big endian) from manifest
+} HTTPCLIENT_DOWNLOAD_STATE;
+
+static uint32_t
+httpclient_crc32 (uint32_t crc, const uint8_t * p, int len)
+{
+    int     i;
+
+    while (len--)
+    {
+        crc ^= *p++;
+
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * httpclient_manifest_lookup () - get checksum of file from manifest
+ *
+ * Returns HTTPCLIENT_CHECK_NONE if there is no manifest or the file is not listed
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+httpclient_manifest_lookup (const char * host, const char * path, const char * filename, uint8_t * digest)
+{
+    char            linebuf[128];
+    char *          p;
+    uint_fast8_t    rtc = HTTPCLIENT_CHECK_NONE;
+    int             len;
+    int             cnt = 0;
+    int             ndigits;
+    int             ch;
+    int             i;
+
+    len = httpclient (host, path, HTTPCLIENT_MANIFEST);
+
+    if (len < 0)
+    {
+        return HTTPCLIENT_CHECK_NONE;
+    }
+
+    while (rtc == HTTPCLIENT_CHECK_NONE && len > 0)
+    {
+        ch = httpclient_read (&len);
+
+        if (ch >= 0 && ch != '\n')
+        {
+            if (ch != '\r' && cnt < (int) sizeof (linebuf) - 1)
+            {
+                linebuf[cnt++] = ch;
+            }
+            continue;
+        }
+
+        linebuf[cnt] = '\0';
+        cnt = 0;
+
+        for (ndigits = 0; isxdigit (linebuf[ndigits]); ndigits++)
+        {
+            ;
+        }
+
+        p = linebuf + ndigits;
+
+        if ((ndigits != 2 * HTTPCLIENT_SHA256_SIZE && ndigits != 8) || (*p != ' ' && *p != '\t'))
+        {
+            continue;
+        }
+
+        while (*p == ' ' || *p == '\t' || *p == '*')                   // '*': binary mode flag of sha256sum
+        {
+            p++;
+        }
+
+        if (! strcmp (p, filename))
+        {
+            for (i = 0; i < ndigits / 2; i++)
+            {
+                digest[i] = hex2toi (linebuf + 2 * i);
+            }
+
+            rtc = (ndigits == 8) ? HTTPCLIENT_CHECK_CRC32 : HTTPCLIENT_CHECK_SHA256;
+        }
+    }
+
+    client.stop ();
+    return rtc;
+}
+
+static bool
+httpclient_store (HTTPCLIENT_DOWNLOAD_STATE * st, File & f, int n)
+{
+    if ((int) f.write (st->buf, n) != n)
+    {
+        return false;
+    }
+
+    br_sha256_update (&st->sha256, st->buf, n);
+    st->crc32 = httpclient_crc32 (st->crc32, st->buf, n);
+    return true;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * httpclient_download () - download file from host/path/filename into LittleFS file target
+ *
+ * Returns HTTPCLIENT_OK or HTTPCLIENT_ERR_xxx, statistics are stored in *dl
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+int
+httpclient_download (const char * host, const char * path, const char * filename, const char * target, HTTPCLIENT_DOWNLOAD * dl)
+{
+    HTTPCLIENT_DOWNLOAD_STATE * st;
+    String                      url     = (String) "/" + path + "/" + filename;
+    FSInfo                      fsinfo;
+    File                        f;
+    unsigned long               start   = millis ();
+    uint32_t                    offset  = 0;                            // bytes stored in temporary file
+    uint8_t                     crcbuf[4];
+    long                        total;
+    int                         status;
+    int                         len;
+    int                         fill;
+    int                         n;
+    int                         rtc     = HTTPCLIENT_ERR_CONNECT;
+
+    memset (dl, 0, sizeof (HTTPCLIENT_DOWNLOAD));
+    st = (HTTPCLIENT_DOWNLOAD_STATE *) malloc (sizeof (HTTPCLIENT_DOWNLOAD_STATE));
+
+    if (! st)
+    {
+        return HTTPCLIENT_ERR_FILE;
+    }
+
+    dl->check = httpclient_manifest_lookup (host, path, filename, st->expected);
+    LittleFS.remove (HTTPCLIENT_TMPFILE);
+
+    for (;;)
+    {
+        len = httpclient_get_range (host, url.c_str(), offset, &status);
+
+        if (len >= 0 && status == 206 && (offset == 0 || range_start != (long) offset))
+        {                                                               // unexpected range: request complete content again
+            client.stop ();
+            offset = 0;
+            len = -1;
+        }
+        else if (len >= 0 && status != 200 && status != 206)            // http error, e.g. 404: don't retry
+        {
+            client.stop ();
+            break;
+        }
+
+        if (len >= 0)
+        {
+            if (status == 206)
+            {
+                total = range_total;
+                f = LittleFS.open (HTTPCLIENT_TMPFILE, "a");
+            }
+            else                                                        // complete content: first request or range ignored
+            {
+                offset = 0;
+                total = (len == HTTPCLIENT_UNKNOWN_LEN) ? -1 : len;
+                br_sha256_init (&st->sha256);
+                st->crc32 = 0xFFFFFFFF;
+                f = LittleFS.open (HTTPCLIENT_TMPFILE, "w");
+            }
+
+            if (! f)
+            {
+                client.stop ();
+                rtc = HTTPCLIENT_ERR_FILE;
+                break;
+            }
+
+            if (total >= 0 && LittleFS.info (fsinfo) && (size_t) (total - offset) > fsinfo.totalBytes - fsinfo.usedBytes)
+            {
+                f.close ();
+                client.stop ();
+                rtc = HTTPCLIENT_ERR_SPACE;
+                break;
+            }
+
+            fill = 0;
+
+            while ((n = httpclient_read_block (st->buf + fill, HTTPCLIENT_BUFSIZE - fill, &len)) > 0)
+            {
+                fill += n;
+
+                if (fill == HTTPCLIENT_BUFSIZE)
+                {
+                    if (! httpclient_store (st, f, fill))
+                    {
+                        break;
+                    }
+                    offset += fill;
+                    fill = 0;
+                }
+            }
+
+            if (fill > 0)
+            {
+                if (httpclient_store (st, f, fill))
+                {
+                    offset += fill;
+                    fill = 0;
+                }
+            }
+
+            f.close ();
+            client.stop ();
+
+            if (fill > 0)                                               // write error
+            {
+                rtc = HTTPCLIENT_ERR_SPACE;
+                break;
+            }
+
+            if (n == 0 && (total < 0 || (long) offset == total))
+            {
+                rtc = HTTPCLIENT_OK;
+                break;
+            }
+        }
+
+        if (dl->resumes >= HTTPCLIENT_MAX_RESUMES)
+        {
+            break;
+        }
+
+        dl->resumes++;
+        delay (500);
+    }
+
+    if (rtc == HTTPCLIENT_OK)
+    {
+        if (dl->check == HTTPCLIENT_CHECK_SHA256)
+        {
+            br_sha256_out (&st->sha256, st->buf);
+
+            if (memcmp (st->buf, st->expected, HTTPCLIENT_SHA256_SIZE))
+            {
+                rtc = HTTPCLIENT_ERR_CHECKSUM;
+            }
+        }
+        else if (dl->check == HTTPCLIENT_CHECK_CRC32)
+        {
+            st->crc32 = ~st->crc32;
+            crcbuf[0] = st->crc32 >> 24;
+            crcbuf[1] = st->crc32 >> 16;
+            crcbuf[2] = st->crc32 >> 8;
+            crcbuf[3] = st->crc32;
+
+            if (memcmp (crcbuf, st->expected, 4))
+            {
+                rtc = HTTPCLIENT_ERR_CHECKSUM;
+            }
+        }
+    }
+
+    if (rtc == HTTPCLIENT_OK)
+    {
+        if (! LittleFS.rename (HTTPCLIENT_TMPFILE, target))               // LittleFS replaces an existing target atomically
+        {
+            LittleFS.remove (target);
+
+            if (! LittleFS.rename (HTTPCLIENT_TMPFILE, target))
+            {
+                rtc = HTTPCLIENT_ERR_FILE;
+            }
+        }
+    }
+
+    if (rtc != HTTPCLIENT_OK)
+    {
+        LittleFS.remove (HTTPCLIENT_TMPFILE);
+    }
+
+    dl->bytes   = offset;
+    dl->msec    = millis () - start;
+    free (st);
+    return rtc;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * httpclient_download_info () - describe result of httpclient_download() in buf, e.g. for a web page
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+httpclient_download_info (char * buf, int rtc, HTTPCLIENT_DOWNLOAD * dl)
+{
+    const char *    check;
+
+    switch (rtc)
+    {
+        case HTTPCLIENT_OK:
+        {
+            switch (dl->check)
+            {
+                case HTTPCLIENT_CHECK_SHA256:   check = ", SHA-256 ok";     break;
+                case HTTPCLIENT_CHECK_CRC32:    check = ", CRC32 ok";       break;
+                default:                        check = ", not checked";    break;
+            }
+
+            sprintf (buf, "%lu bytes in %lu msec (%lu bytes/sec)%s, %u resume(s)", (unsigned long) dl->bytes, dl->msec,
+                     dl->msec ? (unsigned long) ((uint64_t) dl->bytes * 1000 / dl->msec) : 0UL, check, (unsigned int) dl->resumes);
+            break;
+        }
+        case HTTPCLIENT_ERR_SPACE:      strcpy (buf, "not enough space on filesystem");     break;
+        case HTTPCLIENT_ERR_FILE:       strcpy (buf, "cannot write file");                  break;
+        case HTTPCLIENT_ERR_CHECKSUM:   strcpy (buf, "checksum mismatch");                  break;
+        default:                        strcpy (buf, "host connection failed");             break;
+    }
+}
@@ -12,9 +12,52 @@
 #ifndef HTTPCLIENT_H
 #define HTTPCLIENT_H
 
+#define HTTPCLIENT_UNKNOWN_LEN      0x7FFFFFFF                          // chunked transfer: length unknown
+#define HTTPCLIENT_MANIFEST         "manifest.txt"                      // checksums of files on update server
+
+#define HTTPCLIENT_CHECK_NONE       0                                   // file not listed in manifest
+#define HTTPCLIENT_CHECK_CRC32      1
+#define HTTPCLIENT_CHECK_SHA256     2
+
+#define HTTPCLIENT_OK               0
+#define HTTPCLIENT_ERR_CONNECT      (-1)                                // connection failed or http error
+#define HTTPCLIENT_ERR_SPACE        (-2)                                // not enough space on filesystem
+#define HTTPCLIENT_ERR_FILE         (-3)                                // cannot write file
+#define HTTPCLIENT_ERR_CHECKSUM     (-4)                                // checksum mismatch
+
+#define HTTPCLIENT_INFO_SIZE        128                                 // size of buffer for httpclient_download_info()
+
+#define HTTPCLIENT_RESPONSE_MORE    (-1)                                // httpclient_response_feed(): byte consumed, no content
+#define HTTPCLIENT_RESPONSE_END     (-2)                                // content complete
+#define HTTPCLIENT_RESPONSE_ERROR   (-3)                                // malformed response
+
+typedef struct
+{
+    uint8_t                 state;
+    uint8_t                 chunked;                                    // Transfer-Encoding: chunked
+    uint8_t                 line_len;                                   // length of header line or digits of chunk length
+    int                     status;                                     // http status, 0 until status line is read
+    long                    len;                                        // remaining bytes of content or chunk, -1: until close
+    char                    line[64];                                   // start of current header line
+} HTTPCLIENT_RESPONSE;
+
+typedef struct
+{
+    uint32_t                bytes;                                      // size of file
+    unsigned long           msec;                                       // duration of download
+    uint_fast8_t            resumes;                                    // number of resumed transfers
+    uint_fast8_t            check;                                      // HTTPCLIENT_CHECK_xxx
+} HTTPCLIENT_DOWNLOAD;
+
 extern int    httpclient (const char *, const char *, const char *);
+extern int    httpclient_get (const char *, const char *, int *);
 extern int    httpclient_read (int *);
 extern int    httpclient_read_line (unsigned char *, int, int *);
 extern void   httpclient_stop (void);
+extern void   httpclient_response_init (HTTPCLIENT_RESPONSE *);
+extern int    httpclient_response_feed (HTTPCLIENT_RESPONSE *, int);
+extern bool   httpclient_response_complete (HTTPCLIENT_RESPONSE *);
+extern int    httpclient_download (const char *, const char *, const char *, const char *, HTTPCLIENT_DOWNLOAD *);
+extern void   httpclient_download_info (char *, int, HTTPCLIENT_DOWNLOAD *);
 
 #endif
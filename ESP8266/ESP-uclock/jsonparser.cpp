@@ -0,0 +1,618 @@
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * jsonparser.cpp - incremental (streaming) JSON tokenizer
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ *
+ * The tokenizer is fed character by character, e.g. directly from httpclient_read(), and needs neither the whole document
+ * in RAM nor a second pass. For each scalar value (string, number, true/false/null) the callback is called. Within the
+ * callback, json_match() compares the path of the current value with a pattern like
+ *
+ *      "cod"
+ *      "weather[0].description"
+ *      "list[8].main.temp"
+ *      "list[*].dt"
+ *
+ * Memory is bounded: only the keys and array indexes of the first JSON_MAX_DEPTH levels are stored, longer keys and
+ * values are truncated.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <string.h>
+#include "jsonparser.h"
+
+#define JSON_STATE_VALUE                0                                   // expecting a value
+#define JSON_STATE_VALUE_OR_END         1                                   // after '[': expecting a value or ']'
+#define JSON_STATE_KEY_OR_END           2                                   // after '{': expecting a key or '}'
+#define JSON_STATE_KEY                  3                                   // after ',' in object: expecting a key
+#define JSON_STATE_COLON                4                                   // after key: expecting ':'
+#define JSON_STATE_AFTER_VALUE          5                                   // expecting ',', '}' or ']'
+#define JSON_STATE_STRING               6                                   // within string
+#define JSON_STATE_ESCAPE               7                                   // after '\' within string
+#define JSON_STATE_UNICODE              8                                   // within \uXXXX
+#define JSON_STATE_LITERAL              9                                   // within number or literal
+#define JSON_STATE_DONE                 10                                  // root value complete
+#define JSON_STATE_ERROR                11                                  // syntax error
+
+#define IS_ARRAY(p,level)               ((p)->arrays & (1UL << (level)))
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_putc () - append character to current key or value, truncate if too long
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+json_putc (JSON_PARSER * p, char ch)
+{
+    if (p->is_key)
+    {
+        uint_fast8_t level = p->depth - 1;
+
+        if (level < JSON_MAX_DEPTH && p->value_len < JSON_MAX_KEY_LEN)
+        {
+            p->key[level][p->value_len] = ch;
+        }
+    }
+    else
+    {
+        if (p->value_len < JSON_MAX_VALUE_LEN)
+        {
+            p->value[p->value_len] = ch;
+        }
+    }
+
+    if (p->value_len < 0xFFFF)
+    {
+        p->value_len++;
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_flush_surrogate () - high surrogate not followed by a low surrogate: replace it by '?'
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+json_flush_surrogate (JSON_PARSER * p)
+{
+    if (p->surrogate)
+    {
+        json_putc (p, '?');
+        p->surrogate = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_put_unicode () - append \uXXXX as UTF-8
+ *
+ * A surrogate pair \uD800..\uDBFF \uDC00..\uDFFF is combined to one code point U+10000..U+10FFFF (4 bytes UTF-8).
+ * A lone high or low surrogate is no character, it is replaced by '?'.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+json_put_unicode (JSON_PARSER * p, uint16_t u)
+{
+    if (u >= 0xDC00 && u <= 0xDFFF && p->surrogate)
+    {
+        uint32_t cp = 0x10000 + ((uint32_t) (p->surrogate - 0xD800) << 10) + (u - 0xDC00);
+
+        p->surrogate = 0;
+        json_putc (p, 0xF0 | (cp >> 18));
+        json_putc (p, 0x80 | ((cp >> 12) & 0x3F));
+        json_putc (p, 0x80 | ((cp >> 6) & 0x3F));
+        json_putc (p, 0x80 | (cp & 0x3F));
+        return;
+    }
+
+    json_flush_surrogate (p);
+
+    if (u >= 0xD800 && u <= 0xDBFF)
+    {
+        p->surrogate = u;                                                   // wait for low surrogate
+    }
+    else if (u < 0x80)
+    {
+        json_putc (p, u);
+    }
+    else if (u < 0x800)
+    {
+        json_putc (p, 0xC0 | (u >> 6));
+        json_putc (p, 0x80 | (u & 0x3F));
+    }
+    else if (u >= 0xD800 && u <= 0xDFFF)
+    {
+        json_putc (p, '?');
+    }
+    else
+    {
+        json_putc (p, 0xE0 | (u >> 12));
+        json_putc (p, 0x80 | ((u >> 6) & 0x3F));
+        json_putc (p, 0x80 | (u & 0x3F));
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_end_value () - a scalar value or container is complete
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+json_end_value (JSON_PARSER * p)
+{
+    if (p->depth == 0)
+    {
+        p->state = JSON_STATE_DONE;
+        return JSON_DONE;
+    }
+
+    p->state = JSON_STATE_AFTER_VALUE;
+    return JSON_CONTINUE;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_end_string () - string complete: terminate key or call callback for value
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+json_end_string (JSON_PARSER * p)
+{
+    if (p->is_key)
+    {
+        uint_fast8_t level = p->depth - 1;
+
+        if (level < JSON_MAX_DEPTH)
+        {
+            if (p->value_len > JSON_MAX_KEY_LEN)
+            {
+                p->key[level][0] = '\0';                                    // truncated key can never match
+            }
+            else
+            {
+                p->key[level][p->value_len] = '\0';
+            }
+        }
+
+        p->is_key = 0;
+        p->state = JSON_STATE_COLON;
+        return JSON_CONTINUE;
+    }
+
+    p->value[p->value_len < JSON_MAX_VALUE_LEN ? p->value_len : JSON_MAX_VALUE_LEN] = '\0';
+
+    if (p->callback)
+    {
+        (*p->callback) (p, p->value, JSON_TYPE_STRING);
+    }
+
+    return json_end_value (p);
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_end_literal () - number or literal complete: check it and call callback
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+json_end_literal (JSON_PARSER * p)
+{
+    uint_fast8_t    type;
+
+    p->value[p->value_len < JSON_MAX_VALUE_LEN ? p->value_len : JSON_MAX_VALUE_LEN] = '\0';
+
+    if (p->value[0] == '-' || (p->value[0] >= '0' && p->value[0] <= '9'))
+    {
+        type = JSON_TYPE_NUMBER;
+    }
+    else if (! strcmp (p->value, "true") || ! strcmp (p->value, "false") || ! strcmp (p->value, "null"))
+    {
+        type = JSON_TYPE_LITERAL;
+    }
+    else
+    {
+        p->state = JSON_STATE_ERROR;
+        return JSON_ERROR;
+    }
+
+    if (p->callback)
+    {
+        (*p->callback) (p, p->value, type);
+    }
+
+    return json_end_value (p);
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_push () - open object or array
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+json_push (JSON_PARSER * p, uint_fast8_t is_array)
+{
+    if (p->depth >= JSON_MAX_NESTING)
+    {
+        p->state = JSON_STATE_ERROR;
+        return JSON_ERROR;
+    }
+
+    if (is_array)
+    {
+        p->arrays |= (1UL << p->depth);
+        p->state = JSON_STATE_VALUE_OR_END;
+    }
+    else
+    {
+        p->arrays &= ~(1UL << p->depth);
+        p->state = JSON_STATE_KEY_OR_END;
+    }
+
+    if (p->depth < JSON_MAX_DEPTH)
+    {
+        p->idx[p->depth]    = 0;
+        p->key[p->depth][0] = '\0';
+    }
+
+    p->depth++;
+    return JSON_CONTINUE;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_pop () - close object or array
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+json_pop (JSON_PARSER * p, uint_fast8_t is_array)
+{
+    if (p->depth == 0 || (IS_ARRAY(p, p->depth - 1) ? 1 : 0) != is_array)
+    {
+        p->state = JSON_STATE_ERROR;
+        return JSON_ERROR;
+    }
+
+    p->depth--;
+    return json_end_value (p);
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_start_value () - start of a value
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+json_start_value (JSON_PARSER * p, int ch)
+{
+    if (ch == '{')
+    {
+        return json_push (p, 0);
+    }
+    else if (ch == '[')
+    {
+        return json_push (p, 1);
+    }
+    else if (ch == '"')
+    {
+        p->is_key       = 0;
+        p->value_len    = 0;
+        p->state        = JSON_STATE_STRING;
+    }
+    else if (ch == '-' || (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z'))
+    {
+        p->value_len    = 0;
+        p->state        = JSON_STATE_LITERAL;
+        json_putc (p, ch);
+    }
+    else
+    {
+        p->state = JSON_STATE_ERROR;
+        return JSON_ERROR;
+    }
+
+    return JSON_CONTINUE;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_init () - initialize tokenizer
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+json_init (JSON_PARSER * p, JSON_CALLBACK callback, void * data)
+{
+    memset (p, 0, sizeof (JSON_PARSER));
+    p->callback = callback;
+    p->data     = data;
+    p->state    = JSON_STATE_VALUE;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_feed () - feed one character into tokenizer
+ *
+ * Return values:
+ *  JSON_CONTINUE   need more characters
+ *  JSON_DONE       root value complete, further characters are ignored
+ *  JSON_ERROR      syntax error, further characters are ignored
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+int
+json_feed (JSON_PARSER * p, int ch)
+{
+    uint_fast8_t    is_space = (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n');
+
+    switch (p->state)
+    {
+        case JSON_STATE_VALUE:
+        {
+            if (is_space)
+            {
+                return JSON_CONTINUE;
+            }
+            return json_start_value (p, ch);
+        }
+
+        case JSON_STATE_VALUE_OR_END:
+        {
+            if (is_space)
+            {
+                return JSON_CONTINUE;
+            }
+
+            if (ch == ']')
+            {
+                return json_pop (p, 1);
+            }
+            return json_start_value (p, ch);
+        }
+
+        case JSON_STATE_KEY_OR_END:
+        case JSON_STATE_KEY:
+        {
+            if (is_space)
+            {
+                return JSON_CONTINUE;
+            }
+
+            if (ch == '"')
+            {
+                p->is_key       = 1;
+                p->value_len    = 0;
+                p->state        = JSON_STATE_STRING;
+                return JSON_CONTINUE;
+            }
+
+            if (ch == '}' && p->state == JSON_STATE_KEY_OR_END)
+            {
+                return json_pop (p, 0);
+            }
+            break;
+        }
+
+        case JSON_STATE_COLON:
+        {
+            if (is_space)
+            {
+                return JSON_CONTINUE;
+            }
+
+            if (ch == ':')
+            {
+                p->state = JSON_STATE_VALUE;
+                return JSON_CONTINUE;
+            }
+            break;
+        }
+
+        case JSON_STATE_AFTER_VALUE:
+        {
+            if (is_space)
+            {
+                return JSON_CONTINUE;
+            }
+
+            if (ch == ',')
+            {
+                uint_fast8_t level = p->depth - 1;
+
+                if (IS_ARRAY(p, level))
+                {
+                    if (level < JSON_MAX_DEPTH && p->idx[level] < 0x7FFF)
+                    {
+                        p->idx[level]++;
+                    }
+                    p->state = JSON_STATE_VALUE;
+                }
+                else
+                {
+                    p->state = JSON_STATE_KEY;
+                }
+                return JSON_CONTINUE;
+            }
+            else if (ch == '}')
+            {
+                return json_pop (p, 0);
+            }
+            else if (ch == ']')
+            {
+                return json_pop (p, 1);
+            }
+            break;
+        }
+
+        case JSON_STATE_STRING:
+        {
+            if (ch == '\\')
+            {
+                p->state = JSON_STATE_ESCAPE;
+                return JSON_CONTINUE;
+            }
+
+            json_flush_surrogate (p);
+
+            if (ch == '"')
+            {
+                return json_end_string (p);
+            }
+
+            json_putc (p, ch);
+            return JSON_CONTINUE;
+        }
+
+        case JSON_STATE_ESCAPE:
+        {
+            p->state = JSON_STATE_STRING;
+
+            if (ch != 'u')
+            {
+                json_flush_surrogate (p);
+            }
+
+            switch (ch)
+            {
+                case 'b':   json_putc (p, '\b');    break;
+                case 'f':   json_putc (p, '\f');    break;
+                case 'n':   json_putc (p, '\n');    break;
+                case 'r':   json_putc (p, '\r');    break;
+                case 't':   json_putc (p, '\t');    break;
+                case 'u':
+                {
+                    p->unicode      = 0;
+                    p->unicode_cnt  = 0;
+                    p->state        = JSON_STATE_UNICODE;
+                    break;
+                }
+                default:    json_putc (p, ch);      break;                  // '"', '\\', '/'
+            }
+            return JSON_CONTINUE;
+        }
+
+        case JSON_STATE_UNICODE:
+        {
+            if (ch >= '0' && ch <= '9')
+            {
+                p->unicode = (p->unicode << 4) | (ch - '0');
+            }
+            else if (ch >= 'A' && ch <= 'F')
+            {
+                p->unicode = (p->unicode << 4) | (ch - 'A' + 10);
+            }
+            else if (ch >= 'a' && ch <= 'f')
+            {
+                p->unicode = (p->unicode << 4) | (ch - 'a' + 10);
+            }
+            else
+            {
+                break;
+            }
+
+            p->unicode_cnt++;
+
+            if (p->unicode_cnt == 4)
+            {
+                json_put_unicode (p, p->unicode);
+                p->state = JSON_STATE_STRING;
+            }
+            return JSON_CONTINUE;
+        }
+
+        case JSON_STATE_LITERAL:
+        {
+            if ((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || ch == '-' || ch == '+' || ch == '.' || ch == 'E')
+            {
+                json_putc (p, ch);
+                return JSON_CONTINUE;
+            }
+
+            int rtc = json_end_literal (p);
+
+            if (rtc != JSON_CONTINUE)
+            {
+                return rtc;
+            }
+            return json_feed (p, ch);                                       // delimiter: handle in state JSON_STATE_AFTER_VALUE
+        }
+
+        case JSON_STATE_DONE:
+        {
+            return JSON_DONE;
+        }
+
+        default:                                                            // JSON_STATE_ERROR
+        {
+            return JSON_ERROR;
+        }
+    }
+
+    p->state = JSON_STATE_ERROR;
+    return JSON_ERROR;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * json_match () - check if path of current value matches pattern
+ *
+ * Pattern: keys separated by '.', array indexes in brackets, '*' matches any index, e.g. "list[*].weather[0].icon"
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+bool
+json_match (JSON_PARSER * p, const char * pattern)
+{
+    uint_fast8_t    level;
+
+    if (p->depth > JSON_MAX_DEPTH)
+    {
+        return false;
+    }
+
+    for (level = 0; level < p->depth; level++)
+    {
+        if (IS_ARRAY(p, level))
+        {
+            if (*pattern++ != '[')
+            {
+                return false;
+            }
+
+            if (*pattern == '*')
+            {
+                pattern++;
+            }
+            else
+            {
+                int n = 0;
+
+                if (*pattern < '0' || *pattern > '9')
+                {
+                    return false;
+                }
+
+                while (*pattern >= '0' && *pattern <= '9')
+                {
+                    n = 10 * n + (*pattern++ - '0');
+                }
+
+                if (n != p->idx[level])
+                {
+                    return false;
+                }
+            }
+
+            if (*pattern++ != ']')
+            {
+                return false;
+            }
+        }
+        else
+        {
+            int len = strlen (p->key[level]);
+
+            if (level > 0 && *pattern++ != '.')
+            {
+                return false;
+            }
+
+            if (len == 0 || strncmp (pattern, p->key[level], len))
+            {
+                return false;
+            }
+
+            pattern += len;
+        }
+    }
+
+    return *pattern == '\0';
+}
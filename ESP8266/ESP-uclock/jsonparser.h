@@ -0,0 +1,54 @@
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * jsonparser.h - incremental (streaming) JSON tokenizer
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef JSONPARSER_H
+#define JSONPARSER_H
+
+#include <stdint.h>
+
+#define JSON_MAX_NESTING                32                                  // max nesting of objects/arrays (bits of container mask)
+#define JSON_MAX_DEPTH                  6                                   // max depth of paths which can be matched
+#define JSON_MAX_KEY_LEN                15                                  // max length of a key without '\0'
+#define JSON_MAX_VALUE_LEN              63                                  // max length of a scalar value without '\0'
+
+#define JSON_TYPE_STRING                0                                   // "..."
+#define JSON_TYPE_NUMBER                1                                   // -12.5e3
+#define JSON_TYPE_LITERAL               2                                   // true, false, null
+
+#define JSON_CONTINUE                   0                                   // feed more characters
+#define JSON_DONE                       1                                   // root value complete
+#define JSON_ERROR                      (-1)                                // syntax error
+
+typedef struct JSON_PARSER JSON_PARSER;
+typedef void (*JSON_CALLBACK) (JSON_PARSER *, const char *, uint_fast8_t);
+
+struct JSON_PARSER
+{
+    JSON_CALLBACK   callback;                                               // called for every scalar value
+    void *          data;                                                   // user data for callback
+    uint32_t        arrays;                                                 // bit n set: container at level n is an array
+    uint8_t         state;
+    uint8_t         depth;                                                  // current nesting level
+    uint8_t         is_key;                                                 // current string is a key
+    uint8_t         unicode_cnt;                                            // hex digits of \uXXXX read so far
+    uint16_t        unicode;                                                // value of \uXXXX
+    uint16_t        surrogate;                                              // pending high surrogate \uD800..\uDBFF, 0 if none
+    uint16_t        value_len;
+    int16_t         idx[JSON_MAX_DEPTH];                                    // index of current element in array at level n
+    char            key[JSON_MAX_DEPTH][JSON_MAX_KEY_LEN + 1];              // key of current member in object at level n
+    char            value[JSON_MAX_VALUE_LEN + 1];
+};
+
+extern void     json_init (JSON_PARSER *, JSON_CALLBACK, void *);
+extern int      json_feed (JSON_PARSER *, int);
+extern bool     json_match (JSON_PARSER *, const char *);
+
+#endif
@@ -67,8 +67,7 @@ static uint8_t                              bootloader_info[STM32_INFO_SIZE];
 #define STM32_ID_BYTE2                      1       // production id byte 2
 #define STM32_ID_SIZE                       2       // number of bytes in ID array
 
-// yet not used
-// static uint8_t                              bootloader_id[STM32_ID_SIZE];
+static uint8_t                              bootloader_id[STM32_ID_SIZE];
 
 #define STM32_BUFLEN                        256
 static uint8_t                              stm32_buf[STM32_BUFLEN + 1];                        // one more byte for checksum
@@ -256,7 +255,6 @@ stm32_get_version (uint8_t * buf, int maxlen)
  * STM32 bootloader command: GET ID
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-#if 0 // yet not used
 static int
 stm32_get_id (uint8_t * buf, int maxlen)
 {
@@ -302,7 +300,6 @@ stm32_get_id (uint8_t * buf, int maxlen)
     }
     return n_bytes;
 }
-#endif // 0
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * STM32 bootloader command: READ MEMORY
@@ -407,10 +404,13 @@ stm32_go (uint32_t address)
  * STM32 bootloader command: WRITE MEMORY
  *
  * len must be a multiple of 4!
+ *
+ * stm32_write_memory_start() sends command, address and data, but does not wait for the final ACK: the STM32 programs
+ * the flash while the caller prepares the next block. stm32_write_memory_finish() then waits for the ACK.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static int
-stm32_write_memory (uint8_t * image, uint32_t address, unsigned int len)
+stm32_write_memory_start (uint8_t * image, uint32_t address, unsigned int len)
 {
     uint8_t       sum;
     unsigned int  i;
@@ -449,23 +449,26 @@ stm32_write_memory (uint8_t * image, uint32_t address, unsigned int len)
 
     stm32_buf[0] = len - 1;
     sum = stm32_buf[0];
-    Serial.write (stm32_buf, 1);
-    Serial.flush ();
 
     for (i = 0; i < len; i++)
     {
         sum ^= image[i];
     }
 
+    Serial.write (stm32_buf, 1);
     Serial.write (image, len);
     stm32_buf[0] = sum;
-    Serial.write (stm32_buf, 1);
-    Serial.flush ();
+    Serial.write (stm32_buf, 1);                                        // no flush here, UART drains while caller continues
+    return 0;
+}
 
+static int
+stm32_write_memory_finish (uint32_t address)
+{
     if (wait_for_ack (1000, 1) < 0)
     {
         char logbuf[64];
-        sprintf (logbuf, "%02x %02x %02x %02x", stm32_buf[0], stm32_buf[1], stm32_buf[2], stm32_buf[3]);
+        sprintf (logbuf, "%08X ", address);
         http_send_FS ("WRITE MEMORY: data at address ");
         http_send (logbuf);
         http_send_FS ("failed<BR>\r\n");
@@ -632,477 +635,871 @@ stm32_ext_erase (uint16_t * pagenumbers, uint16_t n_pages)
     return 0;
 }
 
-#define PAGESIZE        256
-static uint32_t         start_address   = 0x00000000;                   // address of program start
-
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * stm32_flash_image (do_flash) - check or flash image
+ * flash layout
+ *
+ * Only the pages (STM32F1) or sectors (STM32F4) covered by the image are erased. The layout is derived from the product id,
+ * unknown devices are mass erased.
  *
- * do_flash == false: only check file
- * do_flash == true: check and flash file
+ * Differential update: the check pass reads back the current flash contents and compares them with the image. Only pages
+ * which differ are erased and programmed. The ROM bootloader has no CRC command, so the blocks are compared directly.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-#define LINE_BUFSIZE    256
-static int
-stm32_flash_image (bool do_flash)
-{
-    char            linebuf[LINE_BUFSIZE];
-    char            logbuf[128];
-    uint32_t        i;
-    int             len;
-    int             line;
-    uint8_t         pagebuf[PAGESIZE];
-    uint32_t        pageaddr        = 0xffffffff;
-    uint32_t        pageidx         = 0;
-    unsigned char   datalen;
-    uint32_t        address_min     = 0xffffffff;               // minimum address (incl.)
-    uint32_t        address_max     = 0x00000000;               // maximum address (incl.)
-#if 0
-    uint32_t        last_address    = 0x00000000;
-#endif
-    uint32_t        drlo;                                       // DATA Record Load Offset (current address, 2 bytes)
-    uint32_t        ulba            = 0x00000000;               // Upper Linear Base Address (address offset, 4 bytes)
-    unsigned char   dri;                                        // Data Record Index
-    uint32_t        bytes_written;
-    uint32_t        bytes_read;
-    uint32_t        pages_written;
-    int             eof_record_found = 0;
-    int             idx;
-    int             ch;
-    int             errors = 0;
-    int             rtc = 0;
+#define STM32_FLASH_BASE                    0x08000000                  // start of internal flash, load address of binary images
+#define STM32_WRITE_BLOCKSIZE               256                         // max. data length of WRITE MEMORY command
+#define STM32_MAX_PAGES                     512                         // max. number of pages/sectors tracked for erase
+#define STM32_ERASE_BATCH                   64                          // max. number of pages erased by one ERASE command
+
+#define STM32_LAYOUT_UNKNOWN                0                           // unknown device: mass erase
+#define STM32_LAYOUT_PAGES                  1                           // STM32F1: pages of equal size
+#define STM32_LAYOUT_SECTORS                2                           // STM32F4: 4 x 16K, 1 x 64K, n x 128K
+
+static uint_fast8_t                         stm32_layout;
+static uint32_t                             stm32_page_size;
+static uint8_t                              stm32_pages[STM32_MAX_PAGES / 8];                   // bit set: page has to be flashed
+static uint_fast8_t                         stm32_pages_unknown;                                // image covers unknown page
+static uint_fast8_t                         stm32_mass_erase;                                   // flash all blocks after mass erase
+static uint32_t                             stm32_bytes_flashed;
+static uint32_t                             start_address   = 0x00000000;                       // address of program start
 
-    if (do_flash)
+static void
+stm32_set_layout (uint16_t pid)
+{
+    switch (pid)
     {
-        http_send_FS ("Flashing STM32...<br/>");
+        case 0x410:                                                     // STM32F10x medium density
+        case 0x412:                                                     // STM32F10x low density
+        case 0x420:                                                     // STM32F100 low/medium density value line
+            stm32_layout    = STM32_LAYOUT_PAGES;
+            stm32_page_size = 1024;
+            break;
+        case 0x414:                                                     // STM32F10x high density
+        case 0x418:                                                     // STM32F105/107 connectivity line
+        case 0x428:                                                     // STM32F100 high density value line
+        case 0x430:                                                     // STM32F10x XL density
+            stm32_layout    = STM32_LAYOUT_PAGES;
+            stm32_page_size = 2048;
+            break;
+        case 0x413:                                                     // STM32F405/407/415/417
+        case 0x419:                                                     // STM32F42x/43x
+        case 0x421:                                                     // STM32F446
+        case 0x423:                                                     // STM32F401xB/C
+        case 0x431:                                                     // STM32F411
+        case 0x433:                                                     // STM32F401xD/E
+        case 0x434:                                                     // STM32F469/479
+        case 0x441:                                                     // STM32F412
+        case 0x458:                                                     // STM32F410
+        case 0x463:                                                     // STM32F413/423
+            stm32_layout    = STM32_LAYOUT_SECTORS;
+            stm32_page_size = 0;
+            break;
+        default:
+            stm32_layout    = STM32_LAYOUT_UNKNOWN;
+            stm32_page_size = 0;
+            break;
     }
-    else
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get page or sector number of flash address, returns -1 if unknown
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+stm32_page (uint32_t address)
+{
+    uint32_t    offset;
+    int         page;
+
+    if (address < STM32_FLASH_BASE)
     {
-        http_send_FS ("Checking HEX file...<br/>");
+        return -1;
     }
 
-    http_flush ();
-
-    File f = LittleFS.open("stm32.hex", "r");
+    offset = address - STM32_FLASH_BASE;
 
-    if (f)
+    if (stm32_layout == STM32_LAYOUT_PAGES)
     {
-        line            = 0;
-        bytes_read      = 0;
-        bytes_written   = 0;
-        pages_written   = 0;
-
-        while(f.available())
+        page = offset / stm32_page_size;
+    }
+    else if (stm32_layout == STM32_LAYOUT_SECTORS && offset < 0x100000)   // 2nd bank of STM32F42x/43x not supported
+    {
+        if (offset < 0x10000)
         {
-            idx = 0;
-
-            while ((ch = f.read ()) != EOF)
-            {
-                if (ch != '\r')
-                {
-                    if (ch == '\n')
-                    {
-                        linebuf[idx] = '\0';
-                        break;
-                    }
-                    else if (idx < LINE_BUFSIZE - 1)
-                    {
-                        linebuf[idx] = ch;
-                        idx++;
-                    }
-                }
-            }
-
-            if (idx == 0)
-            {
-                break;
-            }
-
-            line++;
-            bytes_read += idx;
-
-            len = idx;
-    
-            if (linebuf[0] == ':' && len >= 11)
-            {
-                unsigned char   addrh;
-                unsigned char   addrl;
-                unsigned char   rectype;
-                char *          dataptr;
-                unsigned char   chcksum;
-                int             sum = 0;
-                unsigned char   ch;
-    
-                datalen = hex2toi (linebuf +  1);
-                addrh   = hex2toi (linebuf +  3);
-                addrl   = hex2toi (linebuf +  5);
-                drlo    = (addrh << 8 | addrl);
-                rectype = hex2toi (linebuf + 7);
-                dataptr = linebuf + 9;
-    
-                sum = datalen + addrh + addrl + rectype;
-    
-                if (len == 9 + 2 * datalen + 2)
-                {
-                    if (rectype == 0)                               // Data Record
-                    {
-                        for (dri = 0; dri < datalen; dri++)
-                        {
-                            ch = hex2toi (dataptr);
-    
-                            pageidx = ulba + drlo + dri;
-    
-                            if (pageidx - pageaddr >= PAGESIZE)
-                            {
-                                if (pageaddr != 0xffffffff)
-                                {
-                                    if (do_flash)
-                                    {
-                                        // flash (pagebuf, pageaddr, pageidx - pageaddr);
-                                        if (stm32_write_memory (pagebuf, pageaddr, pageidx - pageaddr) < 0)
-                                        {
-                                            rtc = -1;
-                                            break;
-                                        }
-        
-                                        yield ();
-        
-                                        if (stm32_read_memory (pageaddr, pageidx - pageaddr) < 0)
-                                        {
-                                            rtc = -1;
-                                            break;
-                                        }
-        
-                                        yield ();
-        
-                                        if (memcmp (pagebuf, stm32_buf, pageidx - pageaddr) != 0)
-                                        {
-                                            errors++;
-                                            char tmpbuf[32];
-                                            http_send_FS ("verify failed at address=\r\n");
-                                            sprintf (tmpbuf, "%08X \r\n", pageaddr);
-                                            http_send (tmpbuf);
-                                            sprintf (tmpbuf, "len=%d<BR>\r\n", pageidx - pageaddr);
-                                            http_send (tmpbuf);
-                                            http_send_FS ("pagebuf:<BR><pre>\r\n");
-        
-                                            for (i = 0; i < pageidx - pageaddr; i++)
-                                            {
-                                                sprintf (tmpbuf, "%02X ", pagebuf[i]);
-                                                http_send (tmpbuf);
-                                                yield ();
-                                            }
-        
-                                            http_send_FS ("</pre><BR>\r\n");
-        
-                                            http_send_FS ("stm32_buf:<BR><pre>\r\n");
-        
-                                            for (i = 0; i < pageidx - pageaddr; i++)
-                                            {
-                                                sprintf (tmpbuf, "%02X ", stm32_buf[i]);
-                                                http_send (tmpbuf);
-                                                yield ();
-                                            }
-        
-                                            http_send_FS ("</pre><BR>\r\n");
-                                            rtc = -1;
-                                            break;
-                                        }
-        
-                                        bytes_written += pageidx - pageaddr;
-                                    }
-
-                                    pages_written++;
-                                    http_send_FS (".");
-
-                                    if (pages_written % 80 == 0)
-                                    {
-                                        http_send_FS ("<br>");
-                                    }
-                                    http_flush ();
-                                }
-    
-                                pageaddr = ulba + drlo + dri;
-                                memset (pagebuf, 0xFF, PAGESIZE);
-                            }
-    
-                            pagebuf[pageidx - pageaddr] = ch;
+            page = offset >> 14;                                        // sectors 0-3: 16K
+        }
+        else if (offset < 0x20000)
+        {
+            page = 4;                                                   // sector 4: 64K
+        }
+        else
+        {
+            page = 4 + (offset >> 17);                                  // sectors 5-11: 128K
+        }
+    }
+    else
+    {
+        return -1;
+    }
 
-                            if (! do_flash) // only check
-                            {
-#if 0
-                                if (last_address && last_address + 1 != ulba + drlo + dri)
-                                {
-                                    sprintf (logbuf, "warning: gap in line %d\r\n", line);
-                                    http_send (logbuf);
-                                }
-                                last_address = ulba + drlo + dri;
-#endif
-                            }
+    if (page >= STM32_MAX_PAGES)
+    {
+        return -1;
+    }
 
-                            if (address_min > ulba + drlo + dri)
-                            {
-                                address_min = ulba + drlo + dri;
-                            }
-    
-                            if (address_max < ulba + drlo + dri)
-                            {
-                                address_max = ulba + drlo + dri;
-                            }
-    
-                            sum += ch;
-                            dataptr +=2;
-                        }
-    
-                        if (rtc == -1)
-                        {
-                            break;
-                        }
-                    }
-                    else if (rectype == 1)                          // End of File Record
-                    {
-                        eof_record_found = 1;
+    return page;
+}
 
-                        for (dri = 0; dri < datalen; dri++)
-                        {
-                            ch = hex2toi (dataptr);
-    
-                            sum += ch;
-                            dataptr +=2;
-                        }
-    
-                        if (pageidx - pageaddr > 0)
-                        {
-                            pageidx++;                              // we have to go behind last byte
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * erase pages covered by image, fall back to mass erase if layout is unknown
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+stm32_erase_image (void)
+{
+    char        logbuf[64];
+    uint16_t    pages[STM32_ERASE_BATCH];
+    uint8_t     pages8[STM32_ERASE_BATCH];
+    uint8_t     erase_cmd   = bootloader_info[STM32_INFO_ERASE_CMD_IDX];
+    int         n_pages     = 0;
+    int         n;
+    int         page;
+    int         rtc         = 0;
+
+    if (erase_cmd != STM32_CMD_ERASE && erase_cmd != STM32_CMD_EXT_ERASE)
+    {
+        http_send_FS ("Unknown erase method<br>");
+        http_flush ();
+        return -1;
+    }
 
-                            if (do_flash)
-                            {
-                                // flash (pagebuf, pageaddr, pageidx - pageaddr);
-                                if (stm32_write_memory (pagebuf, pageaddr, pageidx - pageaddr) < 0)
-                                {
-                                    rtc = -1;
-                                    break;
-                                }
-        
-                                yield ();
-        
-                                if (stm32_read_memory (pageaddr, pageidx - pageaddr) < 0)
-                                {
-                                    rtc = -1;
-                                    break;
-                                }
-        
-                                yield ();
-        
-                                if (memcmp (pagebuf, stm32_buf, pageidx - pageaddr) != 0)
-                                {
-                                    errors++;
-
-                                    char tmpbuf[32];
-
-                                    http_send_FS ("verify failed at address \r\n");
-                                    sprintf (tmpbuf, "%08X<BR>\r\n", pageaddr);
-                                    http_send (tmpbuf);
-                                    http_send_FS ("pagebuf:<BR><pre>\r\n");
-
-                                    for (i = 0; i < pageidx - pageaddr; i++)
-                                    {
-                                        sprintf (tmpbuf, "%02X ", pagebuf[i]);
-                                        http_send (tmpbuf);
-                                        yield ();
-                                    }
-
-                                    http_send_FS ("</pre><BR>\r\n");
-                                    http_send_FS ("stm32_buf:<BR><pre>\r\n");
-        
-                                    for (i = 0; i < pageidx - pageaddr; i++)
-                                    {
-                                        sprintf (tmpbuf, "%02X ", stm32_buf[i]);
-                                        http_send (tmpbuf);
-                                        yield ();
-                                    }
-        
-                                    http_send_FS ("</pre><BR>\r\n");
-                                    rtc = -1;
-                                    break;
-                                }
-        
-                                bytes_written += pageidx - pageaddr;
-                                pageidx = 0;
-                                memset (pagebuf, 0xFF, PAGESIZE);
-                            }
+    stm32_mass_erase = stm32_pages_unknown || stm32_layout == STM32_LAYOUT_UNKNOWN;
 
-                            pages_written++;
-                            http_send_FS (".");
+    for (page = 0; page < STM32_MAX_PAGES; page++)
+    {
+        if (stm32_pages[page >> 3] & (1 << (page & 7)))
+        {
+            n_pages++;
 
-                            if (pages_written % 80 == 0)
-                            {
-                                http_send_FS ("<br>");
-                            }
-                            http_flush ();
-                        }
-                        break;                                      // stop reading here
-                    }
-                    else if (rectype == 4)                          // Extended Linear Address Record
-                    {
-                        if (drlo == 0)
-                        {
-                            ulba = 0;
-    
-                            for (dri = 0; dri < datalen; dri++)
-                            {
-                                ch = hex2toi (dataptr);
-    
-                                ulba <<= 8;
-                                ulba |= ch;
-    
-                                sum += ch;
-                                dataptr +=2;
-                            }
-    
-                            ulba <<= 16;
-                        }
-                        else
-                        {
-                            sprintf (logbuf, "line %d: rectype = %d: address field is 0x%04X\r\n", line, rectype, drlo);
-                            http_send (logbuf);
-                            rtc = -1;
-                            break;
-                        }
-                    }
-                    else if (rectype == 5)                          // Start Linear Address Record
-                    {
-                        if (drlo == 0)
-                        {
-                            start_address = 0;
-    
-                            for (dri = 0; dri < datalen; dri++)
-                            {
-                                ch = hex2toi (dataptr);
-    
-                                start_address <<= 8;
-                                start_address |= ch;
-    
-                                sum += ch;
-                                dataptr +=2;
-                            }
-                        }
-                        else
-                        {
-                            sprintf (logbuf, "line %d: rectype = %d: address field is 0x%04X\r\n", line, rectype, drlo);
-                            http_send (logbuf);
-                            rtc = -1;
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        sprintf (logbuf, "line %d: unsupported record type: %d\r\n", line, rectype);
-                        http_send (logbuf);
-                        rtc = -1;
-                        break;
-                    }
-    
-                    sum = (0x100 - (sum & 0xff)) & 0xff;
-                    chcksum = hex2toi (dataptr);
-    
-                    if (sum != chcksum)
-                    {
-                        sprintf (logbuf, "invalid checksum: sum: 0x%02X chcksum: 0x%02X\r\n", sum, chcksum);
-                        http_send (logbuf);
-                        rtc = -1;
-                        break;
-                    }
-                }
-                else
-                {
-                    sprintf (logbuf, "invalid len: %d, expected %d\r\n", len, 12 + 2 * datalen + 2);
-                    http_send (logbuf);
-                    rtc = -1;
-                    break;
-                }
-            }
-            else
+            if (erase_cmd == STM32_CMD_ERASE && page > 0xFF)            // standard erase: only 1 byte page numbers
             {
-                sprintf (logbuf, "invalid INTEL HEX format, len: %d\r\n", len);
-                http_send (logbuf);
-                rtc = -1;
-                break;
+                stm32_mass_erase = 1;
             }
         }
-    
-        f.close();
+    }
 
-        if (do_flash)
+    if (! stm32_mass_erase && n_pages == 0)
+    {
+        http_send_FS ("Flash contents unchanged, nothing to erase<br>\r\n");
+        http_flush ();
+        return 0;
+    }
+
+    if (stm32_mass_erase)
+    {
+        if (erase_cmd == STM32_CMD_ERASE)
         {
-            sprintf (logbuf, "<BR>Lines read: %d<BR>\r\n", line);
-            http_send (logbuf);
-            sprintf (logbuf, "Pages flashed: %u<BR>\r\n", pages_written);
-            http_send (logbuf);
-            sprintf (logbuf, "Bytes flashed: %u<BR>\r\n", bytes_written);
-            http_send (logbuf);
-            sprintf (logbuf, "Flash write errors: %d<BR>\r\n", errors);
-            http_send (logbuf);
-    
-            if (rtc == 0)
-            {
-                http_send_FS ("Flash successful<BR>\r\n");
-            }
-            else
-            {
-                http_send_FS ("Flash failed<BR>\r\n");
-            }
+            http_send_FS ("Erasing flash (standard method)... ");
+            http_flush ();
+            rtc = stm32_erase (0, 0);
         }
         else
         {
-            if (rtc == 0 && ! eof_record_found)
-            {
-                http_send_FS ("Error: no EOF record found. HEX file may be incomplete.<BR>\r\n");
-                rtc = -1;
-            }
+            http_send_FS ("Erasing flash (extended method)... ");
+            http_flush ();
+            rtc = stm32_ext_erase (0, 0);
+        }
+    }
+    else
+    {
+        sprintf (logbuf, "Erasing %d %s (%s method)... ", n_pages, stm32_layout == STM32_LAYOUT_PAGES ? "pages" : "sectors",
+                 erase_cmd == STM32_CMD_ERASE ? "standard" : "extended");
+        http_send (logbuf);
+        http_flush ();
 
-            if (rtc == 0)
+        n = 0;
+
+        for (page = 0; page < STM32_MAX_PAGES && rtc >= 0; page++)
+        {
+            if (stm32_pages[page >> 3] & (1 << (page & 7)))
             {
-                http_send_FS ("<BR>Check successful<BR>\r\n");
-                sprintf (logbuf, "<BR>File size: %d<BR>\r\n", bytes_read + 2 * line);
-                http_send (logbuf);
+                pages[n]    = page;
+                pages8[n]   = page;
+                n++;
             }
-            else
+
+            if (n == STM32_ERASE_BATCH || (n > 0 && page == STM32_MAX_PAGES - 1))
             {
-                http_send_FS ("Check failed<BR>\r\n");
+                if (erase_cmd == STM32_CMD_ERASE)
+                {
+                    rtc = stm32_erase (pages8, n);
+                }
+                else
+                {
+                    rtc = stm32_ext_erase (pages, n);
+                }
+                n = 0;
             }
         }
     }
-    else
+
+    if (rtc >= 0)
     {
-        http_send_FS ("error: cannot open file<br/>");
-        rtc = -1;
+        http_send_FS ("successful!<br>\r\n");
+        http_flush ();
     }
 
-    http_flush ();
     return rtc;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * start STM32 bootloader
+ * image reader
+ *
+ * Reads "stm32.hex" (Intel HEX) or "stm32.bin" (raw binary, loaded at STM32_FLASH_BASE) through a file buffer and returns
+ * the image as blocks of STM32_WRITE_BLOCKSIZE bytes aligned to STM32_WRITE_BLOCKSIZE. Gaps are filled with 0xFF.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-#define N_RETRIES    5
+#define STM32_IMAGE_HEX                     0
+#define STM32_IMAGE_BIN                     1
 
-static int
-stm32_bootloader (int do_unprotect)
+#define STM32_FILE_BUFSIZE                  512
+#define LINE_BUFSIZE                        256
+
+typedef struct
 {
-    char          buffer[256];
-    int           i;
-    int           ch;
-    unsigned long time1;
-    unsigned long time2;
-    int           rtc = 0;
+    uint32_t        address;                                            // aligned to STM32_WRITE_BLOCKSIZE
+    unsigned int    len;                                                // multiple of 4
+    uint8_t         data[STM32_WRITE_BLOCKSIZE];
+} STM32_BLOCK;
 
-    for (i = 0; i < N_RETRIES; i++)
-    {
-        http_send_FS ("Trying to enter bootloader mode...<br>\r\n");
-        http_flush ();
+typedef struct
+{
+    uint_fast8_t    format;                                             // STM32_IMAGE_HEX or STM32_IMAGE_BIN
+    uint8_t         filebuf[STM32_FILE_BUFSIZE];
+    unsigned int    filebuf_len;
+    unsigned int    filebuf_pos;
+    char            linebuf[LINE_BUFSIZE];                              // current HEX record
+    char *          dataptr;                                            // next data byte in linebuf
+    unsigned int    datalen;                                            // data bytes left in linebuf
+    uint32_t        address;                                            // address of next data byte
+    uint32_t        ulba;                                               // Upper Linear Base Address (address offset, 4 bytes)
+    uint32_t        lines;
+    uint32_t        bytes_read;
+    uint_fast8_t    eof;                                                // EOF record or end of binary file reached
+    uint_fast8_t    eof_record_found;
+    STM32_BLOCK     blocks[2];                                          // one block is programmed while the next one is parsed
+} STM32_IMAGE;
+
+static int
+stm32_image_fill (STM32_IMAGE * img, File & f)
+{
+    if (img->filebuf_pos >= img->filebuf_len)
+    {
+        img->filebuf_len = f.read (img->filebuf, STM32_FILE_BUFSIZE);
+        img->filebuf_pos = 0;
+        img->bytes_read += img->filebuf_len;
+
+        if (img->filebuf_len == 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read next HEX record, process all record types except data records
+ *
+ * Returns 1 if a data record has been read, 0 on end of file, -1 on error
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+stm32_image_read_record (STM32_IMAGE * img, File & f)
+{
+    char            logbuf[128];
+    char *          linebuf = img->linebuf;
+    char *          dataptr;
+    unsigned char   datalen;
+    unsigned char   addrh;
+    unsigned char   addrl;
+    unsigned char   rectype;
+    unsigned char   chcksum;
+    uint32_t        drlo;                                               // DATA Record Load Offset (current address, 2 bytes)
+    int             len;
+    int             sum;
+    int             i;
+    int             ch;
+
+    while (! img->eof)
+    {
+        len = 0;
+
+        while (stm32_image_fill (img, f) == 0)
+        {
+            ch = img->filebuf[img->filebuf_pos++];
+
+            if (ch == '\n')
+            {
+                break;
+            }
+            else if (ch != '\r' && len < LINE_BUFSIZE - 1)
+            {
+                linebuf[len++] = ch;
+            }
+        }
+
+        linebuf[len] = '\0';
+
+        if (len == 0)
+        {
+            if (img->filebuf_len == 0)
+            {
+                img->eof = 1;                                           // end of file
+            }
+            continue;                                                   // ignore empty lines
+        }
+
+        img->lines++;
+
+        if (linebuf[0] != ':' || len < 11)
+        {
+            sprintf (logbuf, "invalid INTEL HEX format, len: %d\r\n", len);
+            http_send (logbuf);
+            return -1;
+        }
+
+        datalen = hex2toi (linebuf +  1);
+        addrh   = hex2toi (linebuf +  3);
+        addrl   = hex2toi (linebuf +  5);
+        drlo    = (addrh << 8 | addrl);
+        rectype = hex2toi (linebuf + 7);
+        dataptr = linebuf + 9;
+
+        if (len != 9 + 2 * datalen + 2)
+        {
+            sprintf (logbuf, "invalid len: %d, expected %d\r\n", len, 9 + 2 * datalen + 2);
+            http_send (logbuf);
+            return -1;
+        }
+
+        sum = datalen + addrh + addrl + rectype;
+
+        for (i = 0; i < datalen; i++)
+        {
+            sum += hex2toi (dataptr + 2 * i);
+        }
+
+        sum = (0x100 - (sum & 0xff)) & 0xff;
+        chcksum = hex2toi (dataptr + 2 * datalen);
+
+        if (sum != chcksum)
+        {
+            sprintf (logbuf, "invalid checksum: sum: 0x%02X chcksum: 0x%02X\r\n", sum, chcksum);
+            http_send (logbuf);
+            return -1;
+        }
+
+        if (rectype == 0)                                               // Data Record
+        {
+            img->dataptr = dataptr;
+            img->datalen = datalen;
+            img->address = img->ulba + drlo;
+            return 1;
+        }
+        else if (rectype == 1)                                          // End of File Record
+        {
+            img->eof = 1;
+            img->eof_record_found = 1;                                  // stop reading here
+        }
+        else if (rectype == 4 || rectype == 5)                          // Extended/Start Linear Address Record
+        {
+            uint32_t    value = 0;
+
+            if (drlo != 0)
+            {
+                sprintf (logbuf, "line %d: rectype = %d: address field is 0x%04X\r\n", img->lines, rectype, drlo);
+                http_send (logbuf);
+                return -1;
+            }
+
+            for (i = 0; i < datalen; i++)
+            {
+                value <<= 8;
+                value |= hex2toi (dataptr + 2 * i);
+            }
+
+            if (rectype == 4)
+            {
+                img->ulba = value << 16;
+            }
+            else
+            {
+                start_address = value;
+            }
+        }
+        else
+        {
+            sprintf (logbuf, "line %d: unsupported record type: %d\r\n", img->lines, rectype);
+            http_send (logbuf);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read next block of image
+ *
+ * Returns 1 if a block has been read, 0 on end of image, -1 on error
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+stm32_image_next_block (STM32_IMAGE * img, File & f, STM32_BLOCK * blk)
+{
+    unsigned int    n;
+    uint32_t        offset;
+    int             rtc;
+
+    memset (blk->data, 0xFF, STM32_WRITE_BLOCKSIZE);
+    blk->len = 0;
+
+    if (img->format == STM32_IMAGE_BIN)
+    {
+        blk->address = img->address;
+
+        while (blk->len < STM32_WRITE_BLOCKSIZE && stm32_image_fill (img, f) == 0)
+        {
+            n = img->filebuf_len - img->filebuf_pos;
+
+            if (n > STM32_WRITE_BLOCKSIZE - blk->len)
+            {
+                n = STM32_WRITE_BLOCKSIZE - blk->len;
+            }
+
+            memcpy (blk->data + blk->len, img->filebuf + img->filebuf_pos, n);
+            img->filebuf_pos += n;
+            blk->len += n;
+        }
+
+        img->address += blk->len;
+    }
+    else
+    {
+        for (;;)
+        {
+            if (img->datalen == 0)
+            {
+                rtc = stm32_image_read_record (img, f);
+
+                if (rtc < 0)
+                {
+                    return -1;
+                }
+                else if (rtc == 0)
+                {
+                    break;
+                }
+                continue;
+            }
+
+            if (blk->len == 0)
+            {
+                blk->address = img->address & ~(STM32_WRITE_BLOCKSIZE - 1);
+            }
+
+            offset = img->address - blk->address;
+
+            if (offset >= STM32_WRITE_BLOCKSIZE)                        // byte belongs to next block
+            {
+                break;
+            }
+
+            blk->data[offset] = hex2toi (img->dataptr);
+
+            if (blk->len < offset + 1)
+            {
+                blk->len = offset + 1;
+            }
+
+            img->dataptr += 2;
+            img->address++;
+            img->datalen--;
+        }
+    }
+
+    blk->len = (blk->len + 3) & ~3;                                     // WRITE MEMORY needs a multiple of 4, padded with 0xFF
+    return blk->len > 0 ? 1 : 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read back and compare block
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+stm32_verify_block (STM32_BLOCK * blk)
+{
+    char            tmpbuf[32];
+    unsigned int    i;
+
+    if (stm32_read_memory (blk->address, blk->len) < 0)
+    {
+        return -1;
+    }
+
+    if (memcmp (blk->data, stm32_buf, blk->len) != 0)
+    {
+        http_send_FS ("verify failed at address \r\n");
+        sprintf (tmpbuf, "%08X \r\n", blk->address);
+        http_send (tmpbuf);
+        sprintf (tmpbuf, "len=%d<BR>\r\n", blk->len);
+        http_send (tmpbuf);
+        http_send_FS ("image:<BR><pre>\r\n");
+
+        for (i = 0; i < blk->len; i++)
+        {
+            sprintf (tmpbuf, "%02X ", blk->data[i]);
+            http_send (tmpbuf);
+            yield ();
+        }
+
+        http_send_FS ("</pre><BR>\r\n");
+        http_send_FS ("stm32_buf:<BR><pre>\r\n");
+
+        for (i = 0; i < blk->len; i++)
+        {
+            sprintf (tmpbuf, "%02X ", stm32_buf[i]);
+            http_send (tmpbuf);
+            yield ();
+        }
+
+        http_send_FS ("</pre><BR>\r\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * block must be flashed?
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static bool
+stm32_block_changed (STM32_BLOCK * blk)
+{
+    int page;
+
+    if (stm32_mass_erase)
+    {
+        return true;
+    }
+
+    page = stm32_page (blk->address);
+    return page >= 0 && (stm32_pages[page >> 3] & (1 << (page & 7)));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * stm32_flash_image (do_flash) - check or flash image
+ *
+ * do_flash == false: only check file, compare with flash contents and collect pages to erase
+ * do_flash == true: check and flash file, skip unchanged pages. Their blocks are compared again: if the flash has changed since
+ * the check pass, the page has not been erased and the flash fails.
+ *
+ * While the STM32 programs a block, the next block is parsed, see stm32_write_memory_start().
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+stm32_flash_image (bool do_flash)
+{
+    STM32_IMAGE *   img;
+    STM32_BLOCK *   blk;
+    STM32_BLOCK *   next_blk;
+    char            logbuf[128];
+    const char *    filename;
+    uint32_t        address_min     = 0xffffffff;                       // minimum address (incl.)
+    uint32_t        address_max     = 0x00000000;                       // maximum address (excl.)
+    uint32_t        bytes_written   = 0;
+    uint32_t        blocks_written  = 0;
+    uint32_t        blocks_skipped  = 0;
+    int             pages_covered   = 0;
+    int             pages_changed   = 0;
+    int             last_page       = -1;
+    bool            compare         = stm32_layout != STM32_LAYOUT_UNKNOWN;
+    bool            started;
+    bool            changed;
+    int             errors          = 0;
+    int             page;
+    int             rtc             = 0;
+    int             next_rtc;
+
+    img = (STM32_IMAGE *) malloc (sizeof (STM32_IMAGE));
+
+    if (! img)
+    {
+        http_send_FS ("error: out of memory<br/>");
+        return -1;
+    }
+
+    memset (img, 0, sizeof (STM32_IMAGE));
+
+    if (LittleFS.exists ("stm32.hex"))
+    {
+        filename    = "stm32.hex";
+        img->format = STM32_IMAGE_HEX;
+    }
+    else
+    {
+        filename        = "stm32.bin";
+        img->format     = STM32_IMAGE_BIN;
+        img->address    = STM32_FLASH_BASE;
+        start_address   = STM32_FLASH_BASE;
+    }
+
+    if (do_flash)
+    {
+        http_send_FS ("Flashing STM32...<br/>");
+    }
+    else
+    {
+        if (img->format == STM32_IMAGE_HEX)
+        {
+            http_send_FS ("Checking HEX file...<br/>");
+        }
+        else
+        {
+            http_send_FS ("Checking BIN file...<br/>");
+        }
+
+        memset (stm32_pages, 0, sizeof (stm32_pages));
+        stm32_pages_unknown = 0;
+    }
+
+    http_flush ();
+
+    File f = LittleFS.open(filename, "r");
+
+    if (f)
+    {
+        blk = &img->blocks[0];
+        next_rtc = stm32_image_next_block (img, f, blk);
+
+        while (next_rtc > 0)
+        {
+            started = false;
+
+            if (do_flash && stm32_block_changed (blk))
+            {
+                if (stm32_write_memory_start (blk->data, blk->address, blk->len) < 0)
+                {
+                    rtc = -1;
+                    break;
+                }
+                started = true;
+            }
+            else
+            {
+                if (blk->address < address_max)
+                {
+                    sprintf (logbuf, "address 0x%08X: records not in ascending order<BR>\r\n", blk->address);
+                    http_send (logbuf);
+                    rtc = -1;
+                    break;
+                }
+
+                if (address_min > blk->address)
+                {
+                    address_min = blk->address;
+                }
+
+                address_max = blk->address + blk->len;
+                page = stm32_page (blk->address);
+
+                if (page < 0)
+                {
+                    stm32_pages_unknown = 1;
+                }
+                else
+                {
+                    if (page != last_page)
+                    {
+                        pages_covered++;
+                        last_page = page;
+                    }
+
+                    if (! (stm32_pages[page >> 3] & (1 << (page & 7))))
+                    {                                                   // page yet unchanged: compare block with flash
+                        changed = true;
+
+                        if (compare)
+                        {
+                            if (stm32_read_memory (blk->address, blk->len) < 0)
+                            {
+                                compare = false;                        // flash not readable: flash all pages
+                            }
+                            else
+                            {
+                                changed = memcmp (blk->data, stm32_buf, blk->len) != 0;
+                            }
+                        }
+
+                        if (changed && do_flash)                        // page has not been erased: flash pass cannot fix it
+                        {
+                            sprintf (logbuf, "address 0x%08X: flash contents changed since check<BR>\r\n", blk->address);
+                            http_send (logbuf);
+                            errors++;
+                            rtc = -1;
+                            break;
+                        }
+
+                        if (changed)
+                        {
+                            stm32_pages[page >> 3] |= 1 << (page & 7);
+                            pages_changed++;
+                        }
+                    }
+                }
+            }
+
+            next_blk = (blk == &img->blocks[0]) ? &img->blocks[1] : &img->blocks[0];
+            next_rtc = stm32_image_next_block (img, f, next_blk);       // parse next block while STM32 is programming
+
+            if (do_flash && ! started)
+            {
+                blocks_skipped++;
+            }
+            else if (do_flash)
+            {
+                yield ();
+
+                if (stm32_write_memory_finish (blk->address) < 0)
+                {
+                    rtc = -1;
+                    break;
+                }
+
+                if (stm32_verify_block (blk) < 0)
+                {
+                    errors++;
+                    rtc = -1;
+                    break;
+                }
+
+                bytes_written += blk->len;
+                blocks_written++;
+                http_send_FS (".");
+
+                if (blocks_written % 80 == 0)
+                {
+                    http_send_FS ("<br>");
+                }
+                http_flush ();
+            }
+
+            blk = next_blk;
+        }
+
+        if (next_rtc < 0)
+        {
+            rtc = -1;
+        }
+
+        f.close();
+
+        if (do_flash)
+        {
+            stm32_bytes_flashed = bytes_written;
+
+            http_send_FS ("<BR>\r\n");
+
+            if (img->format == STM32_IMAGE_HEX)
+            {
+                sprintf (logbuf, "Lines read: %d<BR>\r\n", img->lines);
+                http_send (logbuf);
+            }
+            sprintf (logbuf, "Blocks flashed: %u<BR>\r\n", blocks_written);
+            http_send (logbuf);
+            sprintf (logbuf, "Blocks unchanged: %u<BR>\r\n", blocks_skipped);
+            http_send (logbuf);
+            sprintf (logbuf, "Bytes flashed: %u<BR>\r\n", bytes_written);
+            http_send (logbuf);
+            sprintf (logbuf, "Flash write errors: %d<BR>\r\n", errors);
+            http_send (logbuf);
+    
+            if (rtc == 0)
+            {
+                http_send_FS ("Flash successful<BR>\r\n");
+            }
+            else
+            {
+                http_send_FS ("Flash failed<BR>\r\n");
+            }
+        }
+        else
+        {
+            if (rtc == 0 && img->format == STM32_IMAGE_HEX && ! img->eof_record_found)
+            {
+                http_send_FS ("Error: no EOF record found. HEX file may be incomplete.<BR>\r\n");
+                rtc = -1;
+            }
+
+            if (rtc == 0 && address_max == 0)
+            {
+                http_send_FS ("Error: image is empty.<BR>\r\n");
+                rtc = -1;
+            }
+
+            if (rtc == 0)
+            {
+                http_send_FS ("<BR>Check successful<BR>\r\n");
+                sprintf (logbuf, "<BR>File size: %u<BR>\r\n", img->bytes_read);
+                http_send (logbuf);
+                sprintf (logbuf, "Image: 0x%08X - 0x%08X<BR>\r\n", address_min, address_max - 1);
+                http_send (logbuf);
+
+                if (compare && ! stm32_pages_unknown)
+                {
+                    sprintf (logbuf, "Changed %s: %d of %d<BR>\r\n", stm32_layout == STM32_LAYOUT_PAGES ? "pages" : "sectors",
+                             pages_changed, pages_covered);
+                    http_send (logbuf);
+                }
+            }
+            else
+            {
+                http_send_FS ("Check failed<BR>\r\n");
+            }
+        }
+    }
+    else
+    {
+        http_send_FS ("error: cannot open file<br/>");
+        rtc = -1;
+    }
+
+    free (img);
+    http_flush ();
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start STM32 bootloader
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define N_RETRIES    5
+
+static int
+stm32_bootloader (int do_unprotect)
+{
+    char          buffer[256];
+    int           i;
+    int           ch;
+    unsigned long time1;
+    unsigned long time2;
+    unsigned long time3;
+    int           rtc = 0;
+
+    for (i = 0; i < N_RETRIES; i++)
+    {
+        http_send_FS ("Trying to enter bootloader mode...<br>\r\n");
+        http_flush ();
         Serial.write (STM32_BEGIN);
         ch = stm32_serial_poll (1000, 1);
 
@@ -1129,6 +1526,17 @@ stm32_bootloader (int do_unprotect)
     http_send (buffer);
     http_send_FS ("<BR>\r\n");
 
+    if (stm32_get_id (bootloader_id, STM32_ID_SIZE) >= 0)
+    {
+        stm32_set_layout ((bootloader_id[STM32_ID_BYTE1] << 8) | bootloader_id[STM32_ID_BYTE2]);
+        sprintf (buffer, "Product ID: 0x%02X%02X<BR>\r\n", bootloader_id[STM32_ID_BYTE1], bootloader_id[STM32_ID_BYTE2]);
+        http_send (buffer);
+    }
+    else
+    {
+        stm32_set_layout (0);
+    }
+
 #if 0
     rtc = stm32_get_version (bootloader_version, STM32_VERSION_SIZE);
 
@@ -1193,37 +1601,16 @@ stm32_bootloader (int do_unprotect)
 
     if (rtc >= 0)
     {
-        if (bootloader_info[STM32_INFO_ERASE_CMD_IDX] == STM32_CMD_ERASE)
-        {
-            http_send_FS ("Erasing flash (standard method)... ");
-            http_flush ();
-            rtc = stm32_erase (0, 0);
-        }
-        else if (bootloader_info[STM32_INFO_ERASE_CMD_IDX] == STM32_CMD_EXT_ERASE)
-        {
-            http_send_FS ("Erasing flash (extended method)... ");
-            http_flush ();
-            rtc = stm32_ext_erase (0, 0);
-        }
-        else
-        {
-            http_send_FS ("Unknown erase method<br>");
-            http_flush ();
-            rtc = -1;
-        }
-
-        if (rtc >= 0)
-        {
-            http_send_FS ("successful!<br>\r\n");
-            http_flush ();
-        }
+        time2 = millis ();
+        rtc = stm32_erase_image ();
+        time2 = millis () - time2;
     }
 
     if (rtc >= 0)
     {
-        time2 = millis ();
+        time3 = millis ();
         rtc = stm32_flash_image (true);
-        time2 = millis () - time2;
+        time3 = millis () - time3;
 
         sprintf (buffer, "%lu", time1); 
         http_send_FS ("Check time: ");
@@ -1231,9 +1618,27 @@ stm32_bootloader (int do_unprotect)
         http_send_FS (" msec<BR>");
 
         sprintf (buffer, "%lu", time2); 
+        http_send_FS ("Erase time: ");
+        http_send (buffer);
+        http_send_FS (" msec<BR>");
+
+        sprintf (buffer, "%lu", time3); 
         http_send_FS ("Flash time: ");
         http_send (buffer);
         http_send_FS (" msec<BR>");
+
+        sprintf (buffer, "%lu", time1 + time2 + time3); 
+        http_send_FS ("Total time: ");
+        http_send (buffer);
+        http_send_FS (" msec<BR>");
+
+        if (time3 > 0)
+        {
+            sprintf (buffer, "%lu", (unsigned long) ((uint64_t) stm32_bytes_flashed * 1000 / time3));
+            http_send_FS ("Flash rate: ");
+            http_send (buffer);
+            http_send_FS (" bytes/sec<BR>");
+        }
     }
 
     return rtc;
@@ -1241,65 +1646,50 @@ stm32_bootloader (int do_unprotect)
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * download image
+ *
+ * Files ending with ".bin" are stored as raw binary image "stm32.bin", all others as "stm32.hex".
+ * httpclient_download() replaces the image only after the complete file has been verified, so a failed download keeps
+ * the old image. The image of the other format is removed after success, because stm32_flash_from_local() prefers stm32.hex.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-#define MAX_LINEBUFLEN  255
-
 bool
 stm32_flash_download_image (const char * host, const char * path, const char * filename)
 {
-    unsigned char   linebuf[MAX_LINEBUFLEN + 1];
-    int             len;                                                // content len
-    int             read_len;                                           // bytes read in current line
-    bool            rtc = false;
+    HTTPCLIENT_DOWNLOAD dl;
+    char                info[HTTPCLIENT_INFO_SIZE];
+    int                 fnlen       = strlen (filename);
+    const char *        image_name  = "stm32.hex";
+    int                 rtc;
+
+    if (fnlen > 4 && ! mystrnicmp (filename + fnlen - 4, ".bin", 4))
+    {
+        image_name = "stm32.bin";
+    }
 
     http_send_FS ("Downloading ");
     http_send (filename);
     http_send_FS ("... ");
     http_flush();
 
-    len = httpclient (host, path, filename);
+    rtc = httpclient_download (host, path, filename, image_name, &dl);
+    httpclient_download_info (info, rtc, &dl);
 
-    if (len > 0)
+    if (rtc == HTTPCLIENT_OK)
     {
-        File f = LittleFS.open("stm32.hex", "w");
-    
-        while (len > 0)
-        {
-            read_len = httpclient_read_line (linebuf, MAX_LINEBUFLEN, &len);
-
-            if (read_len > 0)
-            {
-                f.write (linebuf, read_len);
-            }
-            else
-            {
-                break;
-            }
-        }
-    
-        f.close();
-
-        httpclient_stop ();
-
-        if (len > 0)                                                                // data remaining?
-        {
-            http_send_FS ("http read error<br/>");
-        }
-        else
-        {
-            http_send_FS ("done.<br/>");
-            rtc = true;
-        }
-
-        http_flush();
+        LittleFS.remove (strcmp (image_name, "stm32.hex") ? "stm32.hex" : "stm32.bin");
+        http_send_FS ("done: ");
+        http_send (info);
+        http_send_FS ("<br/>");
     }
     else
     {
-        http_send_FS ("<font color='red'>host connection failed.</font><BR>");
-        rtc = false;
+        http_send_FS ("<font color='red'>");
+        http_send (info);
+        http_send_FS (".</font><BR>");
     }
-    return rtc;
+
+    http_flush();
+    return rtc == HTTPCLIENT_OK;
 }
 
 static void
@@ -1362,9 +1752,10 @@ stm32_flash_from_server (const char * host, const char * path, const char * file
     if (stm32_flash_download_image(host, path, filename))
     {
         stm32_flash_from_local ();
+        LittleFS.remove("stm32.hex");
+        LittleFS.remove("stm32.bin");
     }
 
-    LittleFS.remove("stm32.hex");
     LittleFS.end();
 }
 
@@ -45,6 +45,68 @@
 static WiFiUDP         server_udp;
 static unsigned int    server_udp_local_port = 2424;
 
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * realtime LED frames, DDP protocol (Distributed Display Protocol):
+ *
+ * header: flags seq type id offset[4] length[2] (+ timecode[4] if DDP_FLAG_TIMECODE), followed by RGB data, all values big endian
+ * LED numbering: display LEDs row by row from top left, followed by the ambilight LEDs
+ *
+ * The serial line to the STM32 (115200 Bd) cannot carry complete frames at 30 fps, so only the LEDs which changed since the last
+ * forwarded frame are sent as binary records: STX seq flags offset_hi offset_lo n rgb[3*n] xor LF, see esp8266.h of STM32 firmware.
+ * STX, DLE and LF between STX and LF are escaped as DLE (byte ^ 0x20), so the STM32 resynchronizes at the next record after a lost byte.
+ * If several frames are received while the serial line is busy, only the latest frame is forwarded. A small rolling window of
+ * unchanged LEDs is sent with every frame, so LEDs of a record lost on the serial line are repaired within one second.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define DDP_PORT                    4048
+#define DDP_HEADER_LEN              10
+#define DDP_TIMECODE_LEN            4
+
+#define DDP_FLAG_VERSION_MASK       0xC0
+#define DDP_FLAG_VERSION_1          0x40
+#define DDP_FLAG_TIMECODE           0x10
+#define DDP_FLAG_STORAGE            0x08
+#define DDP_FLAG_REPLY              0x04
+#define DDP_FLAG_QUERY              0x02
+#define DDP_FLAG_PUSH               0x01
+
+#define DDP_SEQ_MASK                0x0F                                // sequence number 1...15, 0 = not used
+#define DDP_TYPE_UNDEFINED          0x00
+#define DDP_TYPE_RGB                0x01                                // used by some senders instead of DDP_TYPE_RGB8
+#define DDP_TYPE_RGB8               0x0B                                // RGB, 8 bit per color
+#define DDP_ID_DISPLAY              1
+
+#define REALTIME_MAX_LEDS           (288 + 120)                         // display LEDs of WC24h + ambilight LEDs
+#define REALTIME_MAX_SPAN_LEDS      64                                  // max LEDs per serial record, see ESP8266_FRAME_MAX_LEDS
+#define REALTIME_MERGE_GAP          2                                   // merge spans if gap is not larger than record overhead
+#define REALTIME_REFRESH_LEDS       16                                  // unchanged LEDs resent per frame (rolling window)
+#define REALTIME_RESYNC_MSEC        1000                                // STM32 returns to clock mode after 2-3 seconds
+#define REALTIME_FRAME_START        0x02                                // STX
+#define REALTIME_FRAME_END          0x0A                                // LF
+#define REALTIME_FRAME_ESC          0x10                                // DLE
+#define REALTIME_FRAME_ESC_XOR      0x20
+#define REALTIME_FRAME_HEADER_LEN   5                                   // seq, flags, offset (2 bytes), n
+#define REALTIME_FRAME_FLAG_PUSH    0x01
+
+static WiFiUDP          realtime_udp;
+static uint8_t          realtime_record[2 + 2 * (REALTIME_FRAME_HEADER_LEN + 3 * REALTIME_MAX_SPAN_LEDS + 1)];  // escaped record
+static uint8_t          realtime_frame[3 * REALTIME_MAX_LEDS];          // frame received via UDP
+static uint8_t          realtime_sent[3 * REALTIME_MAX_LEDS];           // frame forwarded to STM32
+static uint_fast16_t    realtime_leds;                                  // number of LEDs used by sender
+static uint_fast8_t     realtime_ddp_seq;                               // last DDP sequence number
+static uint_fast8_t     realtime_link_seq;                              // sequence number of serial records
+static uint_fast16_t    realtime_refresh_idx;                           // start of rolling refresh window
+static bool             realtime_pending;                               // frame complete, but not yet forwarded
+static bool             realtime_sent_valid;                            // STM32 shows realtime_sent
+static unsigned long    realtime_last_forward;
+
+static unsigned long    realtime_packets;                               // DDP packets received
+static unsigned long    realtime_frames;                                // frames forwarded to STM32
+static unsigned long    realtime_skipped;                               // frames superseded by a newer frame
+static unsigned long    realtime_dropped;                               // DDP packets missing in sequence
+static unsigned long    realtime_late;                                  // DDP packets received out of order
+static unsigned long    realtime_bytes;                                 // bytes sent on serial line
+
 /*----------------------------------------------------------------------------------------------------------------------------------------
  * setup udp service
  *----------------------------------------------------------------------------------------------------------------------------------------
@@ -56,9 +118,241 @@ udp_server_setup (void)
     server_udp.begin(server_udp_local_port);
     Serial.print("- local port: ");
     Serial.println(server_udp.localPort());
+    realtime_udp.begin(DDP_PORT);
+    Serial.print("- realtime port: ");
+    Serial.println(realtime_udp.localPort());
     Serial.flush ();
 }
 
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * append byte to escaped record, returns new length
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast16_t
+udp_realtime_put (uint_fast16_t pos, uint8_t ch)
+{
+    if (ch == REALTIME_FRAME_START || ch == REALTIME_FRAME_END || ch == REALTIME_FRAME_ESC)
+    {
+        realtime_record[pos++] = REALTIME_FRAME_ESC;
+        ch ^= REALTIME_FRAME_ESC_XOR;
+    }
+
+    realtime_record[pos++] = ch;
+    return pos;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * send n LEDs starting at offset as binary record to STM32
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+udp_realtime_send_record (uint_fast16_t offset, uint_fast8_t n, uint_fast8_t flags)
+{
+    uint8_t         header[REALTIME_FRAME_HEADER_LEN];
+    uint8_t *       rgb = realtime_frame + 3 * offset;
+    uint_fast16_t   len = 3 * n;
+    uint_fast16_t   pos = 0;
+    uint_fast16_t   i;
+    uint8_t         xor_sum = 0;
+
+    header[0] = ++realtime_link_seq;
+    header[1] = flags;
+    header[2] = offset >> 8;
+    header[3] = offset & 0xFF;
+    header[4] = n;
+
+    realtime_record[pos++] = REALTIME_FRAME_START;
+
+    for (i = 0; i < REALTIME_FRAME_HEADER_LEN; i++)
+    {
+        xor_sum ^= header[i];
+        pos = udp_realtime_put (pos, header[i]);
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        xor_sum ^= rgb[i];
+        pos = udp_realtime_put (pos, rgb[i]);
+    }
+
+    pos = udp_realtime_put (pos, xor_sum);
+    realtime_record[pos++] = REALTIME_FRAME_END;
+
+    Serial.write (realtime_record, pos);
+
+    memcpy (realtime_sent + 3 * offset, rgb, len);
+    realtime_bytes += pos;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * forward changed LEDs of current frame to STM32, last record gets the push flag
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+udp_realtime_forward (void)
+{
+    uint_fast16_t   idx;
+    uint_fast16_t   start   = 0;
+    uint_fast16_t   n       = 0;
+
+    if (millis () - realtime_last_forward > REALTIME_RESYNC_MSEC)       // STM32 may be back in clock mode: send complete frame
+    {
+        realtime_sent_valid = false;
+    }
+
+    if (realtime_refresh_idx >= realtime_leds)
+    {
+        realtime_refresh_idx = 0;
+    }
+
+    for (idx = 0; idx < realtime_leds; idx++)
+    {
+        if (! realtime_sent_valid || memcmp (realtime_frame + 3 * idx, realtime_sent + 3 * idx, 3) ||
+            (idx >= realtime_refresh_idx && idx < realtime_refresh_idx + REALTIME_REFRESH_LEDS))
+        {
+            if (n > 0 && idx - (start + n) <= REALTIME_MERGE_GAP && idx - start < REALTIME_MAX_SPAN_LEDS)
+            {
+                n = idx - start + 1;
+            }
+            else
+            {
+                if (n > 0)
+                {
+                    udp_realtime_send_record (start, n, 0);
+                }
+
+                start   = idx;
+                n       = 1;
+            }
+        }
+    }
+
+    udp_realtime_send_record (start, n, REALTIME_FRAME_FLAG_PUSH);     // n = 0: nothing changed, show frame anyway
+
+    realtime_refresh_idx   += REALTIME_REFRESH_LEDS;
+    realtime_sent_valid     = true;
+    realtime_last_forward   = millis ();
+    realtime_frames++;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * check DDP sequence number, return false if packet is late
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static bool
+udp_realtime_check_seq (uint_fast8_t seq)
+{
+    uint_fast8_t    diff;
+
+    if (seq == 0)                                                       // sender doesn't use sequence numbers
+    {
+        return true;
+    }
+
+    if (realtime_ddp_seq != 0)
+    {
+        diff = (seq - realtime_ddp_seq + 15) % 15;                      // sequence: 1, 2, ..., 15, 1, 2, ...
+
+        if (diff == 0 || diff > 7)                                      // duplicate or older than last packet
+        {
+            realtime_late++;
+            return false;
+        }
+
+        realtime_dropped += diff - 1;
+    }
+
+    realtime_ddp_seq = seq;
+    return true;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * read all pending DDP packets, then forward the latest complete frame
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+udp_realtime_loop (void)
+{
+    uint8_t         header[DDP_HEADER_LEN];
+    uint_fast32_t   offset;
+    uint_fast16_t   len;
+    uint_fast8_t    flags;
+    int             noBytes;
+
+    while ((noBytes = realtime_udp.parsePacket()) > 0)
+    {
+        if (noBytes < DDP_HEADER_LEN || realtime_udp.read (header, DDP_HEADER_LEN) != DDP_HEADER_LEN)
+        {
+            continue;
+        }
+
+        flags   = header[0];
+        offset  = ((uint_fast32_t) header[4] << 24) | ((uint_fast32_t) header[5] << 16) | (header[6] << 8) | header[7];
+        len     = (header[8] << 8) | header[9];
+
+        if ((flags & DDP_FLAG_VERSION_MASK) != DDP_FLAG_VERSION_1 || (flags & (DDP_FLAG_QUERY | DDP_FLAG_REPLY | DDP_FLAG_STORAGE)) ||
+            header[3] != DDP_ID_DISPLAY ||
+            (header[2] != DDP_TYPE_UNDEFINED && header[2] != DDP_TYPE_RGB && header[2] != DDP_TYPE_RGB8))
+        {
+            continue;
+        }
+
+        realtime_packets++;
+
+        if (! udp_realtime_check_seq (header[1] & DDP_SEQ_MASK))
+        {
+            continue;
+        }
+
+        if (flags & DDP_FLAG_TIMECODE)
+        {
+            realtime_udp.read (header, DDP_TIMECODE_LEN);                   // timecode is ignored, frames are shown immediately
+        }
+
+        if (offset < sizeof (realtime_frame))
+        {
+            if (len > sizeof (realtime_frame) - offset)
+            {
+                len = sizeof (realtime_frame) - offset;
+            }
+
+            len = realtime_udp.read (realtime_frame + offset, len);
+
+            if ((offset + len) / 3 > realtime_leds)
+            {
+                realtime_leds = (offset + len) / 3;
+            }
+        }
+
+        if (flags & DDP_FLAG_PUSH)
+        {
+            if (realtime_pending)
+            {
+                realtime_skipped++;
+            }
+
+            realtime_pending = true;
+        }
+    }
+
+    if (realtime_pending)
+    {
+        realtime_pending = false;
+        udp_realtime_forward ();
+    }
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * get realtime statistics, buf must hold UDP_REALTIME_INFO_SIZE bytes
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+udp_realtime_info (char * buf)
+{
+    snprintf (buf, UDP_REALTIME_INFO_SIZE, "%lu packets, %lu frames, %lu skipped, %lu dropped, %lu late, %lu bytes",
+              realtime_packets, realtime_frames, realtime_skipped, realtime_dropped, realtime_late, realtime_bytes);
+}
+
 /*----------------------------------------------------------------------------------------------------------------------------------------
  * check for incoming udp packet
  *----------------------------------------------------------------------------------------------------------------------------------------
@@ -68,6 +362,8 @@ udp_server_loop (void)
 {
     char udp_server_packet_buffer[MAX_UDP_PACKET_SIZE];
 
+    udp_realtime_loop ();
+
     int noBytes = server_udp.parsePacket();
 
     if (noBytes)
@@ -12,7 +12,10 @@
 #ifndef UDPSRV_H
 #define UDPSRV_H
 
+#define UDP_REALTIME_INFO_SIZE          128
+
 extern void     udp_server_setup (void);
 extern void     udp_server_loop (void);
+extern void     udp_realtime_info (char *);
 
 #endif
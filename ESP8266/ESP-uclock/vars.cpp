@@ -55,6 +55,38 @@
 
 #define CMD_CODE_ALARM_TIME_TABLE                       'l'                        // command:   alarm time table
 
+#define CMD_CODE_PROFILE_VAR                            'P'                        // command:   profile variable
+#define PAR_CODE_PROFILE_HEADER                         'H'                        // parameter: number of entries, core clock
+#define PAR_CODE_PROFILE_NAME                           'N'                        // parameter: name of entry
+#define PAR_CODE_PROFILE_VALUES                         'V'                        // parameter: calls, min, avg, max cycles
+
+uint32_t        vars_generation;
+uint32_t        vars_boot_generation;
+uint32_t        vars_gen[MAX_VAR_GENS];
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * variable has changed: store new generation
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+var_changed (uint_fast16_t gen_idx)
+{
+    vars_gen[gen_idx] = ++vars_generation;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * compare variable with copy taken before update, store new generation if changed
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+var_check_changed (const void * old, const void * cur, size_t size, uint_fast16_t gen_idx)
+{
+    if (memcmp (old, cur, size))
+    {
+        var_changed (gen_idx);
+    }
+}
+
 unsigned int
 rpc (RPC_VARIABLE var)
 {
@@ -93,6 +125,7 @@ set_numvar (NUM_VARIABLE var, unsigned int value)
     if (var < MAX_NUM_VARIABLES)
     {
         numvars[var] = value;
+        var_changed (VAR_GEN_NUM + var);
         Serial.printf ("CMD N%02x%02x%02x\r\n", (int) var, value & 0xFF, (value >> 8) & 0xFF);
         Serial.flush ();
         rtc = 1;
@@ -221,6 +254,7 @@ static char weather_lat[MAX_WEATHER_LAT_LEN + 1];
 static char update_host[MAX_UPDATE_HOST_LEN + 1];
 static char update_path[MAX_UPDATE_PATH_LEN + 1];
 static char date_ticker_format[MAX_DATE_TICKER_FORMAT_LEN + 1];
+static char timezone_rule[MAX_TIMEZONE_RULE_LEN + 1];
 
 STR_VAR strvars[MAX_STR_VARIABLES] =
 {
@@ -236,6 +270,7 @@ STR_VAR strvars[MAX_STR_VARIABLES] =
     { update_host,          MAX_UPDATE_HOST_LEN },
     { update_path,          MAX_UPDATE_PATH_LEN },
     { date_ticker_format,   MAX_DATE_TICKER_FORMAT_LEN },
+    { timezone_rule,        MAX_TIMEZONE_RULE_LEN },
 };
 
 
@@ -260,6 +295,7 @@ set_strvar (STR_VARIABLE var, const char * p)
     if (var < MAX_STR_VARIABLES)
     {
         strncpy (strvars[var].str, p, strvars[var].maxlen);
+        var_changed (VAR_GEN_STR + var);
         Serial.printf ("CMD S%02x%s\r\n", (int) var, p);
         Serial.flush ();
         rtc =  1;
@@ -269,6 +305,7 @@ set_strvar (STR_VARIABLE var, const char * p)
 }
 
 TM tmvars[MAX_TM_VARIABLES];
+unsigned long current_tm_micros;
 
 TM *
 get_tm_var (TM_VARIABLE var)
@@ -324,6 +361,7 @@ set_dsp_color_var (DSP_COLOR_VARIABLE var, DSP_COLORS * s, int use_rgbw)
     if (var < MAX_DSP_COLOR_VARIABLES)
     {
         memcpy (&(dspcolorvars[var]), s, sizeof (DSP_COLORS));
+        var_changed (VAR_GEN_DSP_COLOR + var);
 
         if (use_rgbw)
         {
@@ -364,6 +402,7 @@ set_display_animation_name (uint_fast8_t var, char * name)
     if (var < MAX_DISPLAY_ANIMATION_VARIABLES)
     {
         strncpy (displayanimationvars[var].name, name, MAX_DISPLAY_ANIMATION_NAME_LEN);
+        var_changed (VAR_GEN_DISPLAY_ANIMATION + var);
         Serial.printf ("CMD AN%02x%s\r\n", (int) var, name);
         Serial.flush ();
         rtc =  1;
@@ -380,6 +419,7 @@ set_display_animation_deceleration (uint_fast8_t var, uint_fast8_t deceleration)
     if (var < MAX_DISPLAY_ANIMATION_VARIABLES)
     {
         displayanimationvars[var].deceleration = deceleration;
+        var_changed (VAR_GEN_DISPLAY_ANIMATION + var);
         Serial.printf ("CMD AD%02x%02x\r\n", (int) var, deceleration);
         Serial.flush ();
         rtc =  1;
@@ -396,6 +436,7 @@ set_display_animation_default_deceleration (uint_fast8_t var, uint_fast8_t defau
     if (var < MAX_DISPLAY_ANIMATION_VARIABLES)
     {
         displayanimationvars[var].default_deceleration = default_deceleration;
+        var_changed (VAR_GEN_DISPLAY_ANIMATION + var);
         Serial.printf ("CMD AE%02x%02x\r\n", (int) var, default_deceleration);
         Serial.flush ();
         rtc =  1;
@@ -412,6 +453,7 @@ set_display_animation_flags (uint_fast8_t var, uint_fast8_t flags)
     if (var < MAX_DISPLAY_ANIMATION_VARIABLES)
     {
         displayanimationvars[var].flags = flags;
+        var_changed (VAR_GEN_DISPLAY_ANIMATION + var);
         Serial.printf ("CMD AF%02x%02x\r\n", (int) var, flags);
         Serial.flush ();
         rtc =  1;
@@ -443,6 +485,7 @@ set_color_animation_name (COLOR_ANIMATION_VARIABLE var, char * name)
     if (var < MAX_COLOR_ANIMATION_VARIABLES)
     {
         strncpy (coloranimationvars[var].name, name, MAX_COLOR_ANIMATION_NAME_LEN);
+        var_changed (VAR_GEN_COLOR_ANIMATION + var);
         Serial.printf ("CMD CN%02x%s\r\n", (int) var, name);
         Serial.flush ();
         rtc =  1;
@@ -459,6 +502,7 @@ set_color_animation_deceleration (COLOR_ANIMATION_VARIABLE var, uint_fast8_t dec
     if (var < MAX_COLOR_ANIMATION_VARIABLES)
     {
         coloranimationvars[var].deceleration = deceleration;
+        var_changed (VAR_GEN_COLOR_ANIMATION + var);
         Serial.printf ("CMD CD%02x%02x\r\n", (int) var, deceleration);
         Serial.flush ();
         rtc =  1;
@@ -475,6 +519,7 @@ set_color_animation_default_deceleration (COLOR_ANIMATION_VARIABLE var, uint_fas
     if (var < MAX_COLOR_ANIMATION_VARIABLES)
     {
         coloranimationvars[var].default_deceleration = default_deceleration;
+        var_changed (VAR_GEN_COLOR_ANIMATION + var);
         Serial.printf ("CMD CE%02x%02x\r\n", (int) var, default_deceleration);
         Serial.flush ();
         rtc =  1;
@@ -491,6 +536,7 @@ set_color_animation_flags (COLOR_ANIMATION_VARIABLE var, uint_fast8_t flags)
     if (var < MAX_COLOR_ANIMATION_VARIABLES)
     {
         coloranimationvars[var].flags = flags;
+        var_changed (VAR_GEN_COLOR_ANIMATION + var);
         Serial.printf ("CMD CF%02x%02x\r\n", (int) var, flags);
         Serial.flush ();
         rtc =  1;
@@ -522,6 +568,7 @@ set_ambilight_mode_name (AMBILIGHT_MODE_VARIABLE var, char * name)
     if (var < MAX_AMBILIGHT_MODE_VARIABLES)
     {
         strncpy (ambilightmodevars[var].name, name, MAX_AMBILIGHT_MODE_VARIABLES);
+        var_changed (VAR_GEN_AMBILIGHT_MODE + var);
         Serial.printf ("CMD MN%02x%s\r\n", (int) var, name);
         Serial.flush ();
         rtc =  1;
@@ -538,6 +585,7 @@ set_ambilight_mode_deceleration (AMBILIGHT_MODE_VARIABLE var, uint_fast8_t decel
     if (var < MAX_AMBILIGHT_MODE_VARIABLES)
     {
         ambilightmodevars[var].deceleration = deceleration;
+        var_changed (VAR_GEN_AMBILIGHT_MODE + var);
         Serial.printf ("CMD MD%02x%02x\r\n", (int) var, deceleration);
         Serial.flush ();
         rtc =  1;
@@ -554,6 +602,7 @@ set_ambilight_mode_default_deceleration (AMBILIGHT_MODE_VARIABLE var, uint_fast8
     if (var < MAX_AMBILIGHT_MODE_VARIABLES)
     {
         ambilightmodevars[var].default_deceleration = default_deceleration;
+        var_changed (VAR_GEN_AMBILIGHT_MODE + var);
         Serial.printf ("CMD ME%02x%02x\r\n", (int) var, default_deceleration);
         Serial.flush ();
         rtc =  1;
@@ -570,6 +619,7 @@ set_ambilight_mode_flags (AMBILIGHT_MODE_VARIABLE var, uint_fast8_t flags)
     if (var < MAX_AMBILIGHT_MODE_VARIABLES)
     {
         ambilightmodevars[var].flags = flags;
+        var_changed (VAR_GEN_AMBILIGHT_MODE + var);
         Serial.printf ("CMD MF%02x%02x\r\n", (int) var, flags);
         Serial.flush ();
         rtc =  1;
@@ -581,6 +631,8 @@ set_ambilight_mode_flags (AMBILIGHT_MODE_VARIABLE var, uint_fast8_t flags)
 unsigned int
 set_overlay_var (uint_fast8_t idx)
 {
+    var_changed (VAR_GEN_OVERLAY + idx);
+
     Serial.printf ("CMD OT%02x%02x\r\n", idx, overlays[idx].type);
     Serial.printf ("CMD OI%02x%02x\r\n", idx, overlays[idx].interval);
     Serial.printf ("CMD OD%02x%02x\r\n", idx, overlays[idx].duration);
@@ -627,12 +679,14 @@ set_night_time_var (uint_fast8_t is_ambilight, NIGHT_TIME_VARIABLE var, uint_fas
         {
             ambilightnighttimevars[var].minutes = minutes;
             ambilightnighttimevars[var].flags = flags;
+            var_changed (VAR_GEN_AMBILIGHT_NIGHT_TIME + var);
             Serial.printf ("CMD a%02x%02x%02x%02x\r\n", (int) var, minutes & 0xFF, (minutes >> 8) & 0xFF, flags);
         }
         else
         {
             nighttimevars[var].minutes = minutes;
             nighttimevars[var].flags = flags;
+            var_changed (VAR_GEN_NIGHT_TIME + var);
             Serial.printf ("CMD t%02x%02x%02x%02x\r\n", (int) var, minutes & 0xFF, (minutes >> 8) & 0xFF, flags);
         }
         Serial.flush ();
@@ -666,6 +720,7 @@ set_alarm_time_var (ALARM_TIME_VARIABLE var, uint_fast16_t minutes, uint_fast8_t
     {
         alarmtimevars[var].minutes = minutes;
         alarmtimevars[var].flags = flags;
+        var_changed (VAR_GEN_ALARM_TIME + var);
         Serial.printf ("CMD l%02x%02x%02x%02x\r\n", (int) var, minutes & 0xFF, (minutes >> 8) & 0xFF, flags);
         Serial.flush ();
         rtc =  1;
@@ -676,6 +731,20 @@ set_alarm_time_var (ALARM_TIME_VARIABLE var, uint_fast16_t minutes, uint_fast8_t
 
 OVERLAY      overlays[MAX_OVERLAYS];
 
+PROFILE_ENTRY   profile_entries[MAX_PROFILE_ENTRIES];
+uint_fast8_t    n_profile_entries;
+uint32_t        profile_core_clock;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * 8 hex digits to uint32_t
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+htoi32 (char * buf)
+{
+    return ((uint32_t) htoi (buf, 4) << 16) | htoi (buf + 4, 4);
+}
+
 void
 var_set_parameter (char * parameters)
 {
@@ -704,9 +773,10 @@ var_set_parameter (char * parameters)
             parameters += 2;
             val     = (hi << 8) | lo;
 
-            if (var_idx < MAX_NUM_VARIABLES)
+            if (var_idx < MAX_NUM_VARIABLES && numvars[var_idx] != val)
             {
                 numvars[var_idx] = val;
+                var_changed (VAR_GEN_NUM + var_idx);
             }
             break;
         }
@@ -757,9 +827,10 @@ var_set_parameter (char * parameters)
             var_idx = htoi (parameters, 2);
             parameters += 2;
 
-            if (var_idx < MAX_STR_VARIABLES)
+            if (var_idx < MAX_STR_VARIABLES && strncmp (strvars[var_idx].str, parameters, strvars[var_idx].maxlen))
             {
                 strncpy (strvars[var_idx].str, parameters, strvars[var_idx].maxlen);
+                var_changed (VAR_GEN_STR + var_idx);
             }
             break;
         }
@@ -787,6 +858,11 @@ var_set_parameter (char * parameters)
                                              1 * (parameters[13] - '0');
 
                 tmvars[var_idx].tm_wday = dayofweek (tmvars[var_idx].tm_mday, tmvars[var_idx].tm_mon + 1, tmvars[var_idx].tm_year + 1900);
+
+                if (var_idx == CURRENT_TM_VAR)
+                {
+                    current_tm_micros = micros ();
+                }
             }
 
             break;
@@ -806,6 +882,10 @@ var_set_parameter (char * parameters)
 
                     if (var_idx < MAX_DSP_COLOR_VARIABLES)
                     {
+                        DSP_COLORS  old;
+
+                        memcpy (&old, &(dspcolorvars[var_idx]), sizeof (DSP_COLORS));
+
                         dspcolorvars[var_idx].red = htoi (parameters, 2);
                         parameters += 2;
                         dspcolorvars[var_idx].green = htoi (parameters, 2);
@@ -818,6 +898,8 @@ var_set_parameter (char * parameters)
                             dspcolorvars[var_idx].white = htoi (parameters, 2);
                             parameters += 2;
                         }
+
+                        var_check_changed (&old, &(dspcolorvars[var_idx]), sizeof (DSP_COLORS), VAR_GEN_DSP_COLOR + var_idx);
                     }
                     break;
                 }
@@ -833,6 +915,10 @@ var_set_parameter (char * parameters)
 
             if (var_idx < MAX_DISPLAY_ANIMATION_VARIABLES)
             {
+                DISPLAY_ANIMATION   old;
+
+                memcpy (&old, &(displayanimationvars[var_idx]), sizeof (DISPLAY_ANIMATION));
+
                 if (max_display_animation_variables < var_idx + 1)
                 {
                     max_display_animation_variables = var_idx + 1;
@@ -870,16 +956,25 @@ var_set_parameter (char * parameters)
                         break;
                     }
                 }
+
+                var_check_changed (&old, &(displayanimationvars[var_idx]), sizeof (DISPLAY_ANIMATION), VAR_GEN_DISPLAY_ANIMATION + var_idx);
             }
             break;
         }
 
         case CMD_CODE_COLOR_ANIMATION_VAR:                                  // C: Color animation
         {
+            COLOR_ANIMATION  old;
+
             cmd_code = *parameters++;
             var_idx = htoi (parameters, 2);
             parameters += 2;
 
+            if (var_idx < MAX_COLOR_ANIMATION_VARIABLES)
+            {
+                memcpy (&old, &(coloranimationvars[var_idx]), sizeof (COLOR_ANIMATION));
+            }
+
             switch (cmd_code)
             {
                 case PAR_CODE_COLOR_ANIMATION_MODE_NAME:                    // CN: Color animation Name
@@ -924,15 +1019,27 @@ var_set_parameter (char * parameters)
                     break;
                 }
             }
+
+            if (var_idx < MAX_COLOR_ANIMATION_VARIABLES)
+            {
+                var_check_changed (&old, &(coloranimationvars[var_idx]), sizeof (COLOR_ANIMATION), VAR_GEN_COLOR_ANIMATION + var_idx);
+            }
             break;
         }
 
         case CMD_CODE_AMBILIGHT_MODE_VAR:                                   // Ambilight mode
         {
+            AMBILIGHT_MODE   old;
+
             cmd_code = *parameters++;
             var_idx = htoi (parameters, 2);
             parameters += 2;
 
+            if (var_idx < MAX_AMBILIGHT_MODE_VARIABLES)
+            {
+                memcpy (&old, &(ambilightmodevars[var_idx]), sizeof (AMBILIGHT_MODE));
+            }
+
             switch (cmd_code)
             {
                 case PAR_CODE_AMBILIGHT_MODE_NAME:                          // MN: Ambilight mode Name
@@ -977,15 +1084,27 @@ var_set_parameter (char * parameters)
                     break;
                 }
             }
+
+            if (var_idx < MAX_AMBILIGHT_MODE_VARIABLES)
+            {
+                var_check_changed (&old, &(ambilightmodevars[var_idx]), sizeof (AMBILIGHT_MODE), VAR_GEN_AMBILIGHT_MODE + var_idx);
+            }
             break;
         }
 
         case CMD_CODE_OVERLAY_VAR:                                          // O: overlay
         {
+            OVERLAY          old;
+
             cmd_code = *parameters++;
             var_idx = htoi (parameters, 2);
             parameters += 2;
 
+            if (var_idx < MAX_OVERLAYS)
+            {
+                memcpy (&old, &(overlays[var_idx]), sizeof (OVERLAY));
+            }
+
             switch (cmd_code)
             {
                 case PAR_CODE_OVERLAY_TYPE:                                 // OT: overlay type
@@ -1051,6 +1170,11 @@ var_set_parameter (char * parameters)
                     }
                     break;
             }
+
+            if (var_idx < MAX_OVERLAYS)
+            {
+                var_check_changed (&old, &(overlays[var_idx]), sizeof (OVERLAY), VAR_GEN_OVERLAY + var_idx);
+            }
             break;
         }
 
@@ -1071,13 +1195,21 @@ var_set_parameter (char * parameters)
             {
                 if (cmd_code == 't')
                 {
-                    nighttimevars[var_idx].minutes = minutes;
-                    nighttimevars[var_idx].flags = flags;
+                    if (nighttimevars[var_idx].minutes != minutes || nighttimevars[var_idx].flags != flags)
+                    {
+                        nighttimevars[var_idx].minutes = minutes;
+                        nighttimevars[var_idx].flags = flags;
+                        var_changed (VAR_GEN_NIGHT_TIME + var_idx);
+                    }
                 }
                 else
                 {
-                    ambilightnighttimevars[var_idx].minutes = minutes;
-                    ambilightnighttimevars[var_idx].flags = flags;
+                    if (ambilightnighttimevars[var_idx].minutes != minutes || ambilightnighttimevars[var_idx].flags != flags)
+                    {
+                        ambilightnighttimevars[var_idx].minutes = minutes;
+                        ambilightnighttimevars[var_idx].flags = flags;
+                        var_changed (VAR_GEN_AMBILIGHT_NIGHT_TIME + var_idx);
+                    }
                 }
             }
 
@@ -1096,19 +1228,72 @@ var_set_parameter (char * parameters)
             flags = htoi (parameters, 2);
             parameters += 2;
 
-            if (var_idx < MAX_ALARM_TIME_VARIABLES)
+            if (var_idx < MAX_ALARM_TIME_VARIABLES && (alarmtimevars[var_idx].minutes != minutes || alarmtimevars[var_idx].flags != flags))
             {
                 alarmtimevars[var_idx].minutes = minutes;
                 alarmtimevars[var_idx].flags = flags;
+                var_changed (VAR_GEN_ALARM_TIME + var_idx);
             }
 
             break;
         }
+
+        case CMD_CODE_PROFILE_VAR:                                          // P: profile variable
+        {
+            uint_fast8_t par_code = *parameters++;
+
+            var_idx = htoi (parameters, 2);
+            parameters += 2;
+
+            switch (par_code)
+            {
+                case PAR_CODE_PROFILE_HEADER:                               // PHnncccccccc: number of entries, core clock
+                {
+                    uint_fast8_t idx;
+
+                    n_profile_entries = (var_idx < MAX_PROFILE_ENTRIES) ? var_idx : MAX_PROFILE_ENTRIES;
+                    profile_core_clock = htoi32 (parameters);
+
+                    for (idx = 0; idx < MAX_PROFILE_ENTRIES; idx++)
+                    {
+                        profile_entries[idx].name[0] = '\0';
+                    }
+                    break;
+                }
+                case PAR_CODE_PROFILE_NAME:                                 // PNiiname: name of entry
+                    if (var_idx < MAX_PROFILE_ENTRIES)
+                    {
+                        strncpy (profile_entries[var_idx].name, parameters, PROFILE_MAX_NAME_LEN);
+                        profile_entries[var_idx].name[PROFILE_MAX_NAME_LEN] = '\0';
+                    }
+                    break;
+                case PAR_CODE_PROFILE_VALUES:                               // PViicccccccc...: calls, min, avg, max
+                    if (var_idx < MAX_PROFILE_ENTRIES)
+                    {
+                        profile_entries[var_idx].calls      = htoi32 (parameters);
+                        profile_entries[var_idx].min_cycles = htoi32 (parameters + 8);
+                        profile_entries[var_idx].avg_cycles = htoi32 (parameters + 16);
+                        profile_entries[var_idx].max_cycles = htoi32 (parameters + 24);
+                    }
+                    break;
+            }
+            break;
+        }
     }
 }
 
 void
 vars_init (void)
 {
+    uint_fast16_t   idx;
+
     numvars[HARDWARE_CONFIGURATION_NUM_VAR] = 0xFFFF;
+
+    vars_boot_generation = (ESP.random () & 0x3FFFFFFF) + 1;               // leave room for changes until next boot
+    vars_generation = vars_boot_generation;
+
+    for (idx = 0; idx < MAX_VAR_GENS; idx++)                                // state at boot counts as change
+    {
+        vars_gen[idx] = vars_boot_generation;
+    }
 }
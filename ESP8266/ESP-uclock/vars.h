@@ -76,6 +76,10 @@ typedef enum
     DISPLAY_DATE_RPC_VAR,                                               // display current date
     GET_WEATHER_FC_RPC_VAR,                                             // get weather forecast
     RESET_EEPROM_RPC_VAR,                                               // reset EEPROM contents
+    GET_PROFILE_RPC_VAR,                                                // request profile table
+    RESET_PROFILE_RPC_VAR,                                              // reset profile table
+    LOG_STATS_RPC_VAR,                                                  // log statistics of STM32 event queue, timer etc.
+    RESET_STATS_RPC_VAR,                                                // reset statistics of STM32 event queue, timer etc.
     MAX_RPC_VARIABLES,                                                  // must be the last member
 } RPC_VARIABLE;
 
@@ -187,6 +191,7 @@ extern uint_fast8_t         set_num16_array (NUM16_ARRAY, uint32_t, uint_fast16_
 #define MAX_UPDATE_HOST_LEN             (64 - 1)
 #define MAX_UPDATE_PATH_LEN             (64 - 1)
 #define MAX_DATE_TICKER_FORMAT_LEN      (6 - 1)
+#define MAX_TIMEZONE_RULE_LEN           (48 - 1)
 
 typedef struct
 {
@@ -208,6 +213,7 @@ typedef enum
     UPDATE_HOST_VAR,
     UPDATE_PATH_VAR,
     DATE_TICKER_FORMAT_VAR,
+    TIMEZONE_RULE_STR_VAR,
     MAX_STR_VARIABLES                                                   // must be the last member
 } STR_VARIABLE;
 
@@ -228,6 +234,7 @@ typedef enum
 } TM_VARIABLE;
 
 extern TM               tmvars[MAX_TM_VARIABLES];
+extern unsigned long    current_tm_micros;                                  // micros() when STM32 sent CURRENT_TM_VAR
 extern TM *             get_tm_var (TM_VARIABLE);
 extern unsigned int     set_tm_var (TM_VARIABLE, TM *);
 
@@ -494,5 +501,47 @@ extern ALARM_TIME           alarmtimevars[MAX_ALARM_TIME_VARIABLES];
 extern ALARM_TIME *         get_alarm_time_var (ALARM_TIME_VARIABLE);
 extern unsigned int         set_alarm_time_var (ALARM_TIME_VARIABLE, uint_fast16_t, uint_fast8_t);
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * profile table of STM32 (CPU cycles of hot code sections):
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define MAX_PROFILE_ENTRIES         32                                      // maximum number of profile entries
+#define PROFILE_MAX_NAME_LEN        32                                      // maximum length of profile entry name
+
+typedef struct
+{
+    char                name[PROFILE_MAX_NAME_LEN + 1];                     // name of code section, empty: entry not used
+    uint32_t            calls;                                              // number of calls
+    uint32_t            min_cycles;                                         // min. CPU cycles
+    uint32_t            avg_cycles;                                         // average CPU cycles
+    uint32_t            max_cycles;                                         // max. CPU cycles
+} PROFILE_ENTRY;
+
+extern PROFILE_ENTRY        profile_entries[MAX_PROFILE_ENTRIES];
+extern uint_fast8_t         n_profile_entries;                              // 0: STM32 sent no profile table yet
+extern uint32_t             profile_core_clock;                             // STM32 core clock in Hz
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * change tracking: each change of a variable stores the next value of vars_generation for this variable
+ *
+ * The generation starts at a random value at boot, so a client can not confuse generations of different boots.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define VAR_GEN_NUM                     0
+#define VAR_GEN_STR                     (VAR_GEN_NUM                    + MAX_NUM_VARIABLES)
+#define VAR_GEN_DSP_COLOR               (VAR_GEN_STR                    + MAX_STR_VARIABLES)
+#define VAR_GEN_DISPLAY_ANIMATION       (VAR_GEN_DSP_COLOR              + MAX_DSP_COLOR_VARIABLES)
+#define VAR_GEN_COLOR_ANIMATION         (VAR_GEN_DISPLAY_ANIMATION      + MAX_DISPLAY_ANIMATION_VARIABLES)
+#define VAR_GEN_AMBILIGHT_MODE          (VAR_GEN_COLOR_ANIMATION        + MAX_COLOR_ANIMATION_VARIABLES)
+#define VAR_GEN_OVERLAY                 (VAR_GEN_AMBILIGHT_MODE         + MAX_AMBILIGHT_MODE_VARIABLES)
+#define VAR_GEN_NIGHT_TIME              (VAR_GEN_OVERLAY                + MAX_OVERLAYS)
+#define VAR_GEN_AMBILIGHT_NIGHT_TIME    (VAR_GEN_NIGHT_TIME             + MAX_NIGHT_TIME_VARIABLES)
+#define VAR_GEN_ALARM_TIME              (VAR_GEN_AMBILIGHT_NIGHT_TIME   + MAX_NIGHT_TIME_VARIABLES)
+#define MAX_VAR_GENS                    (VAR_GEN_ALARM_TIME             + MAX_ALARM_TIME_VARIABLES)
+
+extern uint32_t             vars_generation;                                // generation of last change
+extern uint32_t             vars_boot_generation;                           // generation of state at boot
+extern uint32_t             vars_gen[MAX_VAR_GENS];                         // generation of last change per variable
+
 extern void                 var_set_parameter (char *);
 #endif
@@ -11,10 +11,10 @@
  */
 #include <ESP8266WiFi.h>
 #include "weather.h"
+#include "httpclient.h"
+#include "jsonparser.h"
 #include "base.h"
 
-WiFiClient openweather_client;
-
 static int
 round_up (char * degree)
 {
@@ -45,110 +45,182 @@ round_up (char * degree)
     return deg;
 }
 
+#define MAX_LEN_COD                 8
+#define MAX_LEN_TEMP                8
+#define MAX_LEN_DESCRIPTION         32
+#define MAX_LEN_ICON                8
+
+#define WEATHER_FC_IDX              8                                       // forecast: record 8 is current weather + 24h
+
+#define WEATHER_FOUND_COD           0x01
+#define WEATHER_FOUND_TEMP          0x02
+#define WEATHER_FOUND_DESCRIPTION   0x04
+#define WEATHER_FOUND_ICON          0x08
+#define WEATHER_FOUND_ALL           0x0F
+
+typedef struct
+{
+    int             fc_idx;                                                 // -1: current weather, else index of forecast record
+    uint8_t         found;                                                  // WEATHER_FOUND_xxx
+    char            cod[MAX_LEN_COD];
+    char            temp[MAX_LEN_TEMP];
+    char            description[MAX_LEN_DESCRIPTION];
+    char            icon[MAX_LEN_ICON];
+} WEATHER_DATA;
+
+#ifndef WEATHER_HOST
+#define WEATHER_HOST                "api.openweathermap.org"                // may be overridden for a local stand-in server
+#endif
+
+#define WEATHER_CACHE_TTL           (10 * 60 * 1000UL)                      // openweathermap updates its data every 10 minutes
+#define WEATHER_CACHE_REFRESH       (8 * 60 * 1000UL)                       // refresh in background if older than 8 minutes
+
+typedef struct
+{
+    WEATHER_DATA    data;
+    String          url;                                                    // query incl. location and appid
+    unsigned long   time;                                                   // millis() of query
+    bool            valid;
+    bool            refresh;                                                // background refresh pending
+} WEATHER_CACHE;
+
+static WEATHER_CACHE        weather_cache[2];                               // 0: current weather, 1: forecast
+WEATHER_CACHE_STATS         weather_cache_stats;
+
 /*----------------------------------------------------------------------------------------------------------------------------------------
- * parse_json - simple json parser
+ * background refresh:
  *
- * ArduinoJson parser is too fat and fails with 9 forecast data lines
+ * weather_loop() runs the refresh as state machine on its own connection, each call parses only the bytes already received.
+ * Only DNS lookup and TCP connect block, each is bounded by WEATHER_REFRESH_CONNECT_TIMEOUT.
  *----------------------------------------------------------------------------------------------------------------------------------------
  */
-static int
-parse_json (const char * str, const char * pattern, int cnt, char * result, int max_len)
-{
-    int     len    = strlen (pattern);
-    int     found  = 0;
-
-    while (*str)
-    {
-        if (*str == '"' && ! strncmp (str + 1, pattern, len) && *(str + len + 1) == '"' && *(str + len + 2) == ':')
-        {
-            if (found == cnt)
-            {
-                int l = 0;
+#define WEATHER_REFRESH_CONNECT_TIMEOUT 1000                                // msec for DNS lookup and for TCP connect
+#define WEATHER_REFRESH_TIMEOUT     10000                                   // msec for complete answer
+#define WEATHER_REFRESH_MAX_BYTES   256                                     // max. bytes parsed per call of weather_loop()
+
+#define WEATHER_REFRESH_IDLE        0
+#define WEATHER_REFRESH_RECEIVE     1                                       // request sent, parsing answer
+
+static WiFiClient           weather_client;                                 // connection of background refresh
+static uint_fast8_t         weather_refresh_state;
+static uint_fast8_t         weather_refresh_idx;                            // cache entry being refreshed
+static String               weather_refresh_url;
+static unsigned long        weather_refresh_start;
+static HTTPCLIENT_RESPONSE  weather_response;
+static JSON_PARSER          weather_parser;
+static WEATHER_DATA         weather_refresh_data;
 
-                str += len + 3;
-
-                if (*str == '"')
-                {
-                    str++;
-
-                    while (*(str + l) && *(str + l) != '"')
-                    {
-                        l++;
-                    }
-                }               
-                else
-                {
-                    while (*(str + l) && ((*(str + l) >= '0' && *(str + l) <= '9') || *(str + l) == '.'))
-                    {
-                        l++;
-                    }
-                }               
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * weather_copy () - copy value, truncate if too long
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+weather_copy (char * result, const char * value, int max_len)
+{
+    strncpy (result, value, max_len - 1);
+    *(result + max_len - 1) = '\0';
+}
 
-                if (l > max_len - 1)
-                {
-                    l = max_len - 1;
-                }
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * weather_json_callback () - called by JSON tokenizer for each value, pick out the needed ones
+ *
+ * current weather:  { "weather":[{ ..., "description":"...", "icon":"..." }], "main":{ "temp":12.3, ... }, ..., "cod":200 }
+ * forecast:         { "cod":"200", ..., "list":[{ ..., "main":{ "temp":12.3, ... }, "weather":[{ ... }], ... }, ...], ... }
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+weather_json_callback (JSON_PARSER * p, const char * value, uint_fast8_t type)
+{
+    WEATHER_DATA * w = (WEATHER_DATA *) p->data;
 
-                strncpy (result, str, l);
-                *(result + l) = '\0';
-                return 1;
-            }
+    (void) type;
 
-            found++;
+    if (json_match (p, "cod"))
+    {
+        weather_copy (w->cod, value, MAX_LEN_COD);
+        w->found |= WEATHER_FOUND_COD;
+    }
+    else if (w->fc_idx < 0)
+    {
+        if (json_match (p, "main.temp"))
+        {
+            weather_copy (w->temp, value, MAX_LEN_TEMP);
+            w->found |= WEATHER_FOUND_TEMP;
+        }
+        else if (json_match (p, "weather[0].description"))
+        {
+            weather_copy (w->description, value, MAX_LEN_DESCRIPTION);
+            w->found |= WEATHER_FOUND_DESCRIPTION;
+        }
+        else if (json_match (p, "weather[0].icon"))
+        {
+            weather_copy (w->icon, value, MAX_LEN_ICON);
+            w->found |= WEATHER_FOUND_ICON;
+        }
+    }
+    else if (p->depth > 1 && p->idx[1] == w->fc_idx)                       // value within list[fc_idx]
+    {
+        if (json_match (p, "list[*].main.temp"))
+        {
+            weather_copy (w->temp, value, MAX_LEN_TEMP);
+            w->found |= WEATHER_FOUND_TEMP;
+        }
+        else if (json_match (p, "list[*].weather[0].description"))
+        {
+            weather_copy (w->description, value, MAX_LEN_DESCRIPTION);
+            w->found |= WEATHER_FOUND_DESCRIPTION;
+        }
+        else if (json_match (p, "list[*].weather[0].icon"))
+        {
+            weather_copy (w->icon, value, MAX_LEN_ICON);
+            w->found |= WEATHER_FOUND_ICON;
         }
-        str++;
     }
-
-    return 0;
 }
 
-#define MAX_LEN_COD             8
-#define MAX_LEN_TEMP            8
-#define MAX_LEN_DESCRIPTION     32
-#define MAX_LEN_ICON            8
-
 /*----------------------------------------------------------------------------------------------------------------------------------------
- * parse_weather () - parse the answer for forecast and store the valuse in weather_fc struct
+ * print_weather () - send weather or forecast to STM32
+ * forecast: we get 9 of max. 36 records:
+ * 0 : current weather
+ * 1 : current weather + 3h
+ * 2 : current weather + 6h
+ * ...
+ * 8 : current weather + 24h
  *----------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-parse_weather (const char * answer, uint_fast8_t do_get_icon)
+print_weather (WEATHER_DATA * w, uint_fast8_t do_get_icon, int fc)
 {
-    char cod[MAX_LEN_COD];
+    const char *    prefix = fc ? "WEATHER_FC Wetter morgen: " : "WEATHER Wetter heute: ";
 
-    if (parse_json (answer, "cod", 0, cod, MAX_LEN_COD) == 1)
+    if (w->found & WEATHER_FOUND_COD)
     {
-        if (atoi (cod) == 200)
+        if (atoi (w->cod) == 200)
         {
             if (do_get_icon)
             {
-                char icon[MAX_LEN_ICON];
-
-                if (parse_json (answer, "icon", 0, icon, MAX_LEN_ICON) == 1)
+                if (w->found & WEATHER_FOUND_ICON)
                 {
-                    Serial.print("WICON ");
-                    Serial.println (icon);
+                    Serial.print(fc ? "WICON_FC " : "WICON ");
+                    Serial.println (w->icon);
                 }
             }
             else
             {
-                char  degree[MAX_LEN_TEMP];
-                char  description[MAX_LEN_DESCRIPTION];
                 int   deg;
 
-                Serial.print ("WEATHER ");
-                Serial.print ("Wetter heute: ");
+                Serial.print (prefix);
 
-                if (parse_json (answer, "temp", 0, degree, MAX_LEN_TEMP) == 1)
+                if (w->found & WEATHER_FOUND_TEMP)
                 {
-                    deg = round_up (degree);
+                    deg = round_up (w->temp);
                     Serial.print (deg);
                     Serial.print (" Grad, ");
                 }
 
-                if (parse_json (answer, "description", 0, description, MAX_LEN_DESCRIPTION) == 1)
+                if (w->found & WEATHER_FOUND_DESCRIPTION)
                 {
-                    char * description_iso8 = (char *) convert_utf8_to_iso8859 ((const unsigned char *) description);
+                    char * description_iso8 = (char *) convert_utf8_to_iso8859 ((const unsigned char *) w->description);
                     Serial.print (description_iso8);
                 }
 
@@ -157,90 +229,95 @@ parse_weather (const char * answer, uint_fast8_t do_get_icon)
         }
         else
         {
-            Serial.print ("WEATHER Wetter heute: Error ");
-            Serial.println (cod);
+            Serial.print (prefix);
+            Serial.print ("Error ");
+            Serial.println (w->cod);
         }
     }
     else
     {
-        Serial.println ("WEATHER Wetter heute: Parse Error");
+        Serial.print (prefix);
+        Serial.println ("Parse Error");
     }
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------
- * parse_weather_fc () - parse the answer for forecast and store the valuse in weather_fc struct
- * we get 9 of max. 36 records:
- * 0 : current weather
- * 1 : current weather + 3h
- * 2 : current weather + 6h
- * ...
- * 8 : current weather + 24h
+ * fetch_weather () - query openweathermap and parse the answer
+ *
+ * Returns false if the connection failed.
  *----------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-parse_weather_fc (const char * answer, uint_fast8_t do_get_icon)
+static bool
+fetch_weather (const char * url, WEATHER_DATA * w, int fc)
 {
-    char cod[MAX_LEN_COD];
+    JSON_PARSER     parser;
+    int             errorcode;
+    int             len;
+    int             ch;
 
-    if (parse_json (answer, "cod", 0, cod, MAX_LEN_COD) == 1)
-    {
-        if (atoi (cod) == 200)
-        {
-            if (do_get_icon)
-            {
-                char icon[MAX_LEN_ICON];
+    memset (w, 0, sizeof (WEATHER_DATA));
+    w->fc_idx = fc ? WEATHER_FC_IDX : -1;
 
-                if (parse_json (answer, "icon", 8, icon, MAX_LEN_ICON) == 1)                           // line index == 8
-                {
-                    Serial.print("WICON_FC ");
-                    Serial.println (icon);
-                }
-            }
-            else
-            {
-                char  degree[MAX_LEN_TEMP];
-                char  description[MAX_LEN_DESCRIPTION];
-                int   deg;
+    len = httpclient_get (WEATHER_HOST, url, &errorcode);
 
-                Serial.print ("WEATHER_FC ");
-                Serial.print ("Wetter morgen: ");
+    if (len < 0)
+    {
+        return false;
+    }
 
-                if (parse_json (answer, "temp", 8, degree, MAX_LEN_TEMP) == 1)                         // line index == 8
-                {
-                    deg = round_up (degree);
-                    Serial.print (deg);
-                    Serial.print (" Grad, ");
-                }
+    debugmsg ("Connected to server");
 
-                if (parse_json (answer, "description", 8, description, MAX_LEN_DESCRIPTION) == 1)      // line index == 8
-                {
-                    char * description_iso8 = (char *) convert_utf8_to_iso8859 ((const unsigned char *) description);
-                    Serial.print (description_iso8);
-                }
+    json_init (&parser, weather_json_callback, w);
 
-                Serial.println ("");
-            }
-        }
-        else
+    while (len > 0 && w->found != WEATHER_FOUND_ALL)                                                        // single pass, stop if all values found
+    {
+        ch = httpclient_read (&len);
+
+        if (ch < 0 || json_feed (&parser, ch) != JSON_CONTINUE)
         {
-            Serial.print ("WEATHER_FC Wetter morgen: Error ");
-            Serial.println (cod);
+            break;
         }
     }
+
+    httpclient_stop ();
+    return true;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * store_weather () - store answer in cache, only valid and complete answers are cached
+ *
+ * The forecast starts with "cod", so an answer cut off after it has status 200 but lacks other values. The JSON parser reports
+ * a value only after its end, so an answer with all values is complete. Else the old entry is kept.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+store_weather (WEATHER_CACHE * wc, const String & url, WEATHER_DATA * w)
+{
+    if (w->found == WEATHER_FOUND_ALL && atoi (w->cod) == 200)
+    {
+        wc->data        = *w;
+        wc->url         = url;
+        wc->time        = millis ();
+        wc->valid       = true;
+        wc->refresh     = false;
+    }
     else
     {
-        Serial.println ("WEATHER_FC Wetter morgen: Parse Error");
+        weather_cache_stats.errors++;
     }
 }
 
 /*----------------------------------------------------------------------------------------------------------------------------------------
  * query_weather () - query weather for a coordinate or city
+ *
+ * The parsed answer is cached for WEATHER_CACHE_TTL, so text and icon overlays share one query. If the cached answer is
+ * older than WEATHER_CACHE_REFRESH, it is still used but weather_loop() refreshes it afterwards.
  *----------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
 query_weather (char * appid, char * lon, char * lat, char * city, int do_get_icon, int fc)
 {
-    const char *    hostname = "api.openweathermap.org";
+    WEATHER_CACHE * wc = &weather_cache[fc ? 1 : 0];
     String          url;
 
     if (fc)
@@ -283,79 +360,150 @@ query_weather (char * appid, char * lon, char * lat, char * city, int do_get_ico
         url += "&cnt=9";                                                                                    // forecast: we need only 9 records of 36 records, limit output
     }
 
-    if (openweather_client.connect(hostname, 80))
+    if (wc->valid && wc->url == url && millis () - wc->time < WEATHER_CACHE_TTL)
     {
-        debugmsg ("Connected to server");
-        openweather_client.print(String("GET ") + url + " HTTP/1.1\r\n" + "Host: " + hostname + "\r\n" + "Connection: close\r\n\r\n");
-        // debugmsg (String("GET ") + url + " HTTP/1.1<CR><LF>" + "Host: " + hostname + "<CR><LF>" + "Connection: close<CR><LF><CR><LF>");
+        weather_cache_stats.hits++;
 
-        delay (200);    // 100 results in timeout sometimes
+        if (millis () - wc->time >= WEATHER_CACHE_REFRESH)
+        {
+            wc->refresh = true;
+        }
 
-        if (openweather_client.available())
+        print_weather (&wc->data, do_get_icon, fc);
+    }
+    else
+    {
+        WEATHER_DATA    w;
+
+        weather_cache_stats.misses++;
+
+        if (fetch_weather (url.c_str(), &w, fc))
+        {
+            store_weather (wc, url, &w);
+            print_weather (&w, do_get_icon, fc);
+        }
+        else
         {
-            String          line;
-            int             cnt = 0;
-            const char *    p;
+            weather_cache_stats.errors++;
+            Serial.println(String ("ERROR connection to ") + WEATHER_HOST + " failed");
+        }
+    }
+}
 
-            do
-            {
-                line = openweather_client.readStringUntil('\n');
-                p = line.c_str();
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * weather_cache_age () - age of cached weather (fc = 0) or forecast (fc = 1) in seconds, -1 if not cached
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+long
+weather_cache_age (int fc)
+{
+    WEATHER_CACHE * wc = &weather_cache[fc ? 1 : 0];
 
-                if (p)
-                {
-                    while (*p == '\r' || *p == '\n')
-                    {
-                        p++;
-                    }
-
-                    // debugmsg ("answer", p);
-
-                    if (! *p)
-                    {
-                        // debugmsg ("empty answer line found");
-                        break;
-                    }
-                    cnt++;
-                }
-                else
-                {
-                    debugmsg ("null");
-                }
-            } while (openweather_client.available() && cnt < 20);
+    if (! wc->valid)
+    {
+        return -1;
+    }
 
-            if (openweather_client.available())
-            {
-                line = openweather_client.readStringUntil('\n');
-                p = line.c_str();
-                // debugmsg ("data0", p);
+    return (millis () - wc->time) / 1000;
+}
 
-                if (p && strlen (p) < 10 && openweather_client.available())       // 1st data line is length of following line in Hex, e.g. "1da"
-                {
-                    line = openweather_client.readStringUntil('\n');            // read next data line
-                    p = line.c_str();
-                    // debugmsg ("data1", p);
-                }
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * weather_refresh_begin () - connect and send request of background refresh
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+weather_refresh_begin (uint_fast8_t idx)
+{
+    IPAddress   ip;
 
-                if (p)
-                {
-                    if (fc)
-                    {
-                        parse_weather_fc (p, do_get_icon);
-                    }
-                    else
-                    {
-                        parse_weather (p, do_get_icon);
-                    }
-                }
+    weather_refresh_idx = idx;
+    weather_refresh_url = weather_cache[idx].url;
+    weather_client.setTimeout (WEATHER_REFRESH_CONNECT_TIMEOUT);
+
+    if (! WiFi.hostByName (WEATHER_HOST, ip, WEATHER_REFRESH_CONNECT_TIMEOUT) || ! weather_client.connect (ip, 80))
+    {
+        weather_cache_stats.errors++;
+        return;
+    }
+
+    weather_client.print (String ("GET ") + weather_refresh_url + " HTTP/1.1\r\nHost: " + WEATHER_HOST + "\r\nConnection: close\r\n\r\n");
+
+    memset (&weather_refresh_data, 0, sizeof (WEATHER_DATA));
+    weather_refresh_data.fc_idx = idx ? WEATHER_FC_IDX : -1;
+    json_init (&weather_parser, weather_json_callback, &weather_refresh_data);
+    httpclient_response_init (&weather_response);
+
+    weather_refresh_start = millis ();
+    weather_refresh_state = WEATHER_REFRESH_RECEIVE;
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * weather_refresh_receive () - parse bytes received so far, returns true if answer is complete
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+static bool
+weather_refresh_receive (void)
+{
+    int     n;
+    int     ch;
+
+    for (n = 0; n < WEATHER_REFRESH_MAX_BYTES && weather_client.available (); n++)
+    {
+        ch = httpclient_response_feed (&weather_response, weather_client.read ());
+
+        if (ch >= 0)
+        {
+            if (json_feed (&weather_parser, ch) != JSON_CONTINUE || weather_refresh_data.found == WEATHER_FOUND_ALL)
+            {
+                return true;
             }
         }
+        else if (ch != HTTPCLIENT_RESPONSE_MORE)
+        {
+            return true;
+        }
+    }
+
+    return httpclient_response_complete (&weather_response) || (! weather_client.available () && ! weather_client.connected ());
+}
+
+/*----------------------------------------------------------------------------------------------------------------------------------------
+ * weather_loop () - refresh nearly stale cache entries in background, one at a time
+ *
+ * Does not wait for the answer: each call parses at most WEATHER_REFRESH_MAX_BYTES already received bytes.
+ *----------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+weather_loop (void)
+{
+    uint_fast8_t    idx;
 
-        openweather_client.stop ();
+    if (weather_refresh_state == WEATHER_REFRESH_RECEIVE)
+    {
+        if (weather_refresh_receive ())
+        {
+            weather_client.stop ();
+            weather_refresh_state = WEATHER_REFRESH_IDLE;
+            store_weather (&weather_cache[weather_refresh_idx], weather_refresh_url, &weather_refresh_data);
+        }
+        else if (millis () - weather_refresh_start >= WEATHER_REFRESH_TIMEOUT)
+        {
+            weather_client.stop ();
+            weather_refresh_state = WEATHER_REFRESH_IDLE;
+            weather_cache_stats.errors++;
+        }
+        return;
     }
-    else
+
+    for (idx = 0; idx < 2; idx++)
     {
-        Serial.println(String ("ERROR connection to ") + hostname + " failed");
+        if (weather_cache[idx].refresh)
+        {
+            weather_cache[idx].refresh = false;
+            weather_cache_stats.refreshes++;
+            weather_refresh_begin (idx);
+            break;
+        }
     }
 }
 
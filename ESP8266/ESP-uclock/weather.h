@@ -12,6 +12,16 @@
 #ifndef WEATHER_H
 #define WEATHER_H
 
+typedef struct
+{
+    unsigned long   hits;                                                   // answered from cache
+    unsigned long   misses;                                                 // queried from openweathermap
+    unsigned long   refreshes;                                              // background refreshes
+    unsigned long   errors;                                                 // failed queries, not cached
+} WEATHER_CACHE_STATS;
+
+extern WEATHER_CACHE_STATS  weather_cache_stats;
+
 extern void get_weather (char *, char *);
 extern void get_weather (char *, char *, char *);
 extern void get_weather_fc (char *, char *);
@@ -20,5 +30,7 @@ extern void get_weather_icon (char *, char *);
 extern void get_weather_icon (char *, char *, char *);
 extern void get_weather_icon_fc (char *, char *);
 extern void get_weather_icon_fc (char *, char *, char *);
+extern long weather_cache_age (int);
+extern void weather_loop (void);
 
 #endif
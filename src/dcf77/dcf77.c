@@ -15,6 +15,7 @@
 #include "log.h"
 #include "board-led.h"
 #include "io.h"
+#include "timer.h"
 
 #if defined (BLACK_BOARD)                                   // STM32F407VE Black Board: DATA=PC2 PON=PC3
 
@@ -68,21 +69,86 @@
 #  error STM32 unknown
 #endif
 
-static uint_fast8_t                     time_is_valid = 0;
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * decoder parameters, durations in msec, the decoder counts in timer2 ticks
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define DCF77_MSEC(ms)                  ((uint32_t) TIMER_MSEC_TO_TICKS(ms))
+#define DCF77_EDGE_RING_LEN             64                  // ring of debounced edges, must be power of 2
+#define DCF77_DEBOUNCE                  5                   // new level of DATA pin must be stable for 5 msec
+#define DCF77_SECOND                    1000
+#define DCF77_MINUTE                    (60 * DCF77_SECOND)
+#define DCF77_SECOND_WINDOW             80                  // edges within +/- 80 msec of predicted start correct the phase
+#define DCF77_ACQUIRE_WINDOW            20                  // edges 1 sec +/- 20 msec apart confirm a phase candidate
+#define DCF77_ACQUIRE_EDGES             3                   // number of confirmed edges to lock the phase
+#define DCF77_N_CANDIDATES              8                   // number of remembered edges during phase acquisition
+#define DCF77_PULSE_WINDOW              250                 // high level is integrated over 250 msec after start of second
+#define DCF77_MIN_PULSE                 50                  // less than 50 msec integrated high level: no pulse
+#define DCF77_MAX_MISSING               3                   // second phase is lost after 3 consecutive seconds without pulse
+#define DCF77_MAX_CONFIDENCE            5                   // max. confidence of a single received bit
+#define DCF77_MAX_SCORE                 40                  // max. accumulated confidence of a bit
+#define DCF77_LOCK_SCORE                8                   // min. accumulated confidence of every time bit to deliver time
+#define DCF77_MAX_ADVANCE               (24 * 60)           // max. number of minutes a consensus can be advanced after sync loss
+#define DCF77_AVG_SHIFT                 3                   // adaptive pulse widths: weight of new width is 1/8
+
+#define DCF77_FIRST_TIME_BIT            17                  // bits 17..58: CEST, CET, leap second, start bit, time & date
+#define DCF77_LEAP_SECOND_BIT           19                  // announcement of leap second, not part of consensus
+#define DCF77_N_BITS                    59
+
+typedef struct
+{
+    uint_fast8_t                        isdst;
+    uint_fast8_t                        minute;
+    uint_fast8_t                        hour;
+    uint_fast8_t                        mday;
+    uint_fast8_t                        wday;               // 1 = Monday ... 7 = Sunday
+    uint_fast8_t                        month;
+    uint_fast8_t                        year;               // 0..99
+} DCF77_TIME;
+
+typedef struct
+{
+    uint32_t                            ticks;              // timer2 tick of edge
+    uint8_t                             level;              // level after edge
+} DCF77_EDGE;
 
-#define STATE_PON                       0xFF                // wait 1 sec, then set PON to GND (only for very old Pollin DCF1 versions)
-#define STATE_UNKNOWN                   0
-#define STATE_WAIT                      1
-#define STATE_0                         2
-#define STATE_1                         3
+DCF77_STATS                             dcf77_stats;
 
-static volatile uint_fast8_t            isdst;
-static volatile uint_fast8_t            minute;
-static volatile uint_fast8_t            hour;
-static volatile uint_fast8_t            wday;
-static volatile uint_fast8_t            mday;
-static volatile uint_fast8_t            month;
-static volatile uint_fast16_t           year;
+static uint_fast8_t                     time_is_valid = 0;
+static uint_fast8_t                     time_complete;      // consensus is strong, deliver time at second 15
+static DCF77_TIME                       dcf77_tm;           // time of current minute
+
+static uint32_t                         cursor;             // decoder time, signal is decoded up to this tick
+static uint_fast8_t                     level;              // level of DATA pin at cursor
+static uint_fast8_t                     phase_locked;       // 1: start of seconds is known
+static uint32_t                         second_start;       // start of current second
+static uint32_t                         next_second;        // predicted start of next second
+static uint_fast8_t                     phase_corrected;    // 1: phase already corrected in current second
+static uint32_t                         candidate_edges[DCF77_N_CANDIDATES];    // phase acquisition: recent rising edges
+static uint8_t                          candidate_cnt[DCF77_N_CANDIDATES];      // number of edges 1 sec apart up to this edge
+static uint_fast8_t                     candidate_idx;
+static uint_fast8_t                     pulse_window;       // 1: integration window of current second is open
+static uint32_t                         pulse_width;        // integrated high level in current window in ticks
+static uint_fast8_t                     missing_seconds;    // consecutive seconds without pulse
+static uint_fast8_t                     second;             // current second, 0xFF: minute mark not yet found
+static uint32_t                         minute_ticks;       // time of last minute mark
+
+static uint_fast16_t                    short_avg = 100 << 4;   // average width of 100 msec pulses in msec, fixed point * 16
+static uint_fast16_t                    long_avg  = 200 << 4;   // average width of 200 msec pulses in msec, fixed point * 16
+
+static int_fast8_t                      score[DCF77_N_BITS];// accumulated confidence per bit, > 0: 1, < 0: 0
+static uint_fast8_t                     lock_found;         // strong consensus found since start of search
+static uint32_t                         search_start;       // start of search in ticks
+
+static TIMER_JOB                        dcf77_job;
+static uint_fast8_t                     pon_active;         // 1: PON still set after boot
+static uint32_t                         pon_ticks;          // time of setting PON
+
+static volatile uint_fast8_t            sampling;           // 1: dcf77_ISR() samples DATA pin
+static volatile uint_fast8_t            data_level;         // debounced level of DATA pin, written only by dcf77_ISR()
+static DCF77_EDGE                       edge_ring[DCF77_EDGE_RING_LEN];
+static volatile uint32_t                edge_head;          // number of edges written, written only by dcf77_ISR()
+static volatile uint32_t                edge_tail;          // number of edges decoded, written only by dcf77_poll()
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * DCF77 get time
@@ -95,13 +161,13 @@ dcf77_time (struct tm * tm)
 
     if (time_is_valid)
     {
-        tm->tm_year     = year + 100;                   // tm_year begins with 1900
-        tm->tm_mon      = month - 1;                    // tm_month begins with 0
-        tm->tm_mday     = mday;
-        tm->tm_wday     = wday == 7 ? 0 : wday;
+        tm->tm_year     = dcf77_tm.year + 100;          // tm_year begins with 1900
+        tm->tm_mon      = dcf77_tm.month - 1;           // tm_month begins with 0
+        tm->tm_mday     = dcf77_tm.mday;
+        tm->tm_wday     = dcf77_tm.wday == 7 ? 0 : dcf77_tm.wday;
         tm->tm_isdst    = 0;
-        tm->tm_hour     = hour;
-        tm->tm_min      = minute;
+        tm->tm_hour     = dcf77_tm.hour;
+        tm->tm_min      = dcf77_tm.minute;
         tm->tm_sec      = 15;
 
         time_is_valid   = 0;
@@ -145,393 +211,754 @@ dcf77_init (void)
     GPIO_SET_PIN_OUT_PP(DCF77_PON_PORT, DCF77_PON_PIN, GPIO_Speed_2MHz);
 
     dcf77_pon_set ();                           // Pollin DCF module: pulse PON
+    pon_active  = 1;
+    pon_ticks   = timer_ticks;
+    dcf77_reset_stats ();
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * DCF77 tick - statemachine, called every 1/100 of a second
+ * classify integrated pulse width, adapt thresholds to the receiver
+ *
+ * Returns the bit, *confp is set to the distance from the threshold in units of 10 msec, 0 if the pulse is ambiguous.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-void
-dcf77_tick (void)
+static uint_fast8_t
+dcf77_classify (uint_fast16_t width, uint_fast8_t * confp)
 {
-    static uint_fast8_t cnt         = 0;
-    static uint_fast8_t state       = STATE_PON;
-    static uint_fast8_t last_pin    = 0;
-    static uint_fast8_t bitno       = 0xff;
-    static uint_fast8_t p1          = 0;
-    static uint_fast8_t p2          = 0;
-    static uint_fast8_t p3          = 0;
-    static uint_fast8_t time_complete= 0;
-    uint_fast16_t       pin;
-    static uint_fast8_t last_h      = 0;
-    static uint_fast8_t last_m      = 0;
-
-    if (state == STATE_PON)                             // pseudo state: wait 1 sec before resetting PON after boot
-    {
-        static uint_fast8_t pon_cnt = 0;
-
-        if (pon_cnt == 100)
+    uint_fast16_t   w           = width << 4;
+    uint_fast16_t   threshold   = (short_avg + long_avg) / 2;
+    uint_fast16_t   conf;
+    uint_fast8_t    bit;
+
+    if (w > threshold)
+    {
+        bit     = 1;
+        conf    = ((w - threshold) >> 4) / 10;
+    }
+    else
+    {
+        bit     = 0;
+        conf    = ((threshold - w) >> 4) / 10;
+    }
+
+    if (conf > DCF77_MAX_CONFIDENCE)
+    {
+        conf = DCF77_MAX_CONFIDENCE;
+    }
+
+    if (conf >= 2)                                      // adapt only to unambiguous pulses
+    {
+        if (bit)
         {
-            dcf77_pon_reset ();
-            state = STATE_UNKNOWN;                      // start state machine now!
+            long_avg = long_avg - (long_avg >> DCF77_AVG_SHIFT) + (w >> DCF77_AVG_SHIFT);
+
+            if (long_avg < (160 << 4))
+            {
+                long_avg = 160 << 4;
+            }
         }
         else
         {
-            pon_cnt++;
+            short_avg = short_avg - (short_avg >> DCF77_AVG_SHIFT) + (w >> DCF77_AVG_SHIFT);
+
+            if (short_avg > (140 << 4))
+            {
+                short_avg = 140 << 4;
+            }
         }
+    }
+
+    *confp = conf;
+    return bit;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * accumulate received bit into per-bit confidence
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_add_bit (uint_fast8_t bitno, uint_fast8_t bit, uint_fast8_t conf)
+{
+    int_fast16_t    s = score[bitno];
 
+    dcf77_stats.bits++;
+
+    if (conf == 0)
+    {
+        dcf77_stats.weak_bits++;
         return;
     }
 
-    if (GPIO_ReadInputDataBit(DCF77_DATA_PORT, DCF77_DATA_PIN) == Bit_RESET)
+    if ((bit && s <= -DCF77_LOCK_SCORE) || (! bit && s >= DCF77_LOCK_SCORE))
     {
-        board_led_off ();
-        pin = 0;
+        dcf77_stats.bit_errors++;
     }
-    else
+
+    s += bit ? conf : -conf;
+
+    if (s > DCF77_MAX_SCORE)
     {
-        board_led_on();
-        pin = 1;
+        s = DCF77_MAX_SCORE;
+    }
+    else if (s < -DCF77_MAX_SCORE)
+    {
+        s = -DCF77_MAX_SCORE;
     }
 
-    switch (state)
+    score[bitno] = s;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get BCD value of consensus, count 1 bits in *parityp
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+dcf77_get_bcd (uint_fast8_t first, uint_fast8_t n, uint_fast8_t * parityp, uint_fast8_t * valuep)
+{
+    uint_fast8_t    raw = 0;
+    uint_fast8_t    i;
+
+    for (i = 0; i < n; i++)
     {
-        case STATE_UNKNOWN:
+        if (score[first + i] > 0)
         {
-            state = STATE_WAIT;
-            last_pin = pin;
-            break;
+            raw |= 1 << i;
+            (*parityp)++;
         }
-        case STATE_WAIT:
+    }
+
+    if ((raw & 0x0F) > 9)
+    {
+        return 0;
+    }
+
+    *valuep = (raw >> 4) * 10 + (raw & 0x0F);
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * decode consensus
+ *
+ * Returns the weakest confidence of all time bits, 0 if the consensus is undecided or inconsistent.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+dcf77_decode (DCF77_TIME * tp)
+{
+    uint_fast8_t    strength = DCF77_MAX_SCORE;
+    uint_fast8_t    p;
+    uint_fast8_t    i;
+
+    for (i = DCF77_FIRST_TIME_BIT; i < DCF77_N_BITS; i++)
+    {
+        if (i != DCF77_LEAP_SECOND_BIT)
         {
-            if (last_pin != pin)
+            uint_fast8_t a = score[i] < 0 ? -score[i] : score[i];
+
+            if (strength > a)
             {
-                state = (pin == 0) ? STATE_0 : STATE_1;
-                last_pin = pin;
-                bitno = 0xff;
-                cnt = 0;
+                strength = a;
             }
-            break;
         }
-        case STATE_0:
+    }
+
+    if (strength == 0 || score[20] < 0 || (score[17] > 0) == (score[18] > 0))   // start bit must be 1, either CEST or CET
+    {
+        return 0;
+    }
+
+    p = 0;
+
+    if (! dcf77_get_bcd (21, 7, &p, &tp->minute) || tp->minute > 59 || ((p + (score[28] > 0)) & 0x01))
+    {
+        return 0;
+    }
+
+    p = 0;
+
+    if (! dcf77_get_bcd (29, 6, &p, &tp->hour) || tp->hour > 23 || ((p + (score[35] > 0)) & 0x01))
+    {
+        return 0;
+    }
+
+    p = 0;
+
+    if (! dcf77_get_bcd (36, 6, &p, &tp->mday)  || tp->mday  < 1 || tp->mday  > 31 ||
+        ! dcf77_get_bcd (42, 3, &p, &tp->wday)  || tp->wday  < 1 ||
+        ! dcf77_get_bcd (45, 5, &p, &tp->month) || tp->month < 1 || tp->month > 12 ||
+        ! dcf77_get_bcd (50, 8, &p, &tp->year)  || ((p + (score[58] > 0)) & 0x01))
+    {
+        return 0;
+    }
+
+    tp->isdst = (score[17] > 0);
+    return strength;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * set BCD value in bit array, count 1 bits in *parityp
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_put_bcd (uint8_t * bits, uint_fast8_t first, uint_fast8_t n, uint_fast8_t value, uint_fast8_t * parityp)
+{
+    uint_fast8_t    raw = ((value / 10) << 4) | (value % 10);
+    uint_fast8_t    i;
+
+    for (i = 0; i < n; i++)
+    {
+        bits[first + i] = (raw >> i) & 0x01;
+        *parityp += bits[first + i];
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * encode time bits 17..58 of a DCF77 frame
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_encode (const DCF77_TIME * tp, uint8_t * bits)
+{
+    uint_fast8_t    p;
+
+    bits[17] = tp->isdst;
+    bits[18] = ! tp->isdst;
+    bits[20] = 1;
+
+    p = 0;
+    dcf77_put_bcd (bits, 21, 7, tp->minute, &p);
+    bits[28] = p & 0x01;
+
+    p = 0;
+    dcf77_put_bcd (bits, 29, 6, tp->hour, &p);
+    bits[35] = p & 0x01;
+
+    p = 0;
+    dcf77_put_bcd (bits, 36, 6, tp->mday, &p);
+    dcf77_put_bcd (bits, 42, 3, tp->wday, &p);
+    dcf77_put_bcd (bits, 45, 5, tp->month, &p);
+    dcf77_put_bcd (bits, 50, 8, tp->year, &p);
+    bits[58] = p & 0x01;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * increment time by one minute, valid for years 2000..2099
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_next_minute (DCF77_TIME * tp)
+{
+    static const uint8_t    days_per_month[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    uint_fast8_t            days;
+
+    if (++tp->minute < 60)
+    {
+        return;
+    }
+
+    tp->minute = 0;
+
+    if (++tp->hour < 24)
+    {
+        return;
+    }
+
+    tp->hour = 0;
+
+    if (++tp->wday > 7)
+    {
+        tp->wday = 1;
+    }
+
+    days = days_per_month[tp->month - 1];
+
+    if (tp->month == 2 && (tp->year % 4) == 0)
+    {
+        days = 29;
+    }
+
+    if (++tp->mday > days)
+    {
+        tp->mday = 1;
+
+        if (++tp->month > 12)
+        {
+            tp->month = 1;
+            tp->year = (tp->year + 1) % 100;
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * advance consensus by n minutes: flip the sign of every bit that changes, keep its confidence
+ *
+ * If the consensus is still undecodable after one minute, only the minute bits are discarded because hour and date rarely change.
+ * DST changes are not predicted, the hour bits recover within a few minutes.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_advance_scores (uint32_t n)
+{
+    DCF77_TIME      tm;
+    uint8_t         bits[DCF77_N_BITS];
+    uint_fast8_t    i;
+
+    if (n > DCF77_MAX_ADVANCE || ! dcf77_decode (&tm))
+    {
+        if (n == 1)
+        {
+            memset (score + 21, 0, 8 * sizeof (score[0]));         // minute bits 21..27, parity P1
+        }
+        else
+        {
+            memset (score, 0, sizeof (score));
+        }
+        return;
+    }
+
+    while (n--)
+    {
+        dcf77_next_minute (&tm);
+    }
+
+    dcf77_encode (&tm, bits);
+
+    for (i = DCF77_FIRST_TIME_BIT; i < DCF77_N_BITS; i++)
+    {
+        if (i != DCF77_LEAP_SECOND_BIT && score[i] != 0 && (score[i] > 0) != bits[i])
+        {
+            score[i] = -score[i];
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * minute mark: evaluate consensus of the frame just received, then predict the next frame
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_minute (void)
+{
+    DCF77_TIME      tm;
+    uint_fast8_t    strength;
+
+    dcf77_stats.minutes++;
+    strength = dcf77_decode (&tm);
+
+    if (strength >= DCF77_LOCK_SCORE)
+    {
+        dcf77_tm        = tm;
+        time_complete   = 1;
+        dcf77_stats.valid_minutes++;
+
+        if (! lock_found)
         {
-            if (pin == last_pin)
+            lock_found = 1;
+            dcf77_stats.lock_time = (cursor - search_start) / TIMER_TICKS_PER_SEC;
+
+            if (dcf77_stats.max_lock_time < dcf77_stats.lock_time)
             {
-                cnt++;
+                dcf77_stats.max_lock_time = dcf77_stats.lock_time;
             }
-            else
+
+            log_printf ("DCF77: lock after %lu sec\r\n", dcf77_stats.lock_time);
+        }
+    }
+    else
+    {
+        time_complete = 0;
+    }
+
+    dcf77_advance_scores (1);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * end of second: width is the integrated high level in msec, 0 if no pulse has been seen at the predicted start of second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_second (uint_fast16_t width)
+{
+    const int32_t   window = DCF77_MSEC(DCF77_SECOND / 2);
+    uint32_t        n;
+    int32_t         diff;
+    uint_fast8_t    bit;
+    uint_fast8_t    conf;
+
+    dcf77_stats.seconds++;
+
+    if (width < DCF77_MIN_PULSE)                                            // no pulse: minute mark or lost pulse
+    {
+        if (second == 0xFF || second == 59)
+        {
+            if (second == 59)
             {
-                state = STATE_1;
-                last_pin = pin;
+                dcf77_minute ();
+            }
+            else                                                            // minute mark (re)gained
+            {
+                n       = (cursor - minute_ticks + DCF77_MSEC(DCF77_MINUTE) / 2) / DCF77_MSEC(DCF77_MINUTE);
+                diff    = (int32_t) (cursor - minute_ticks - n * DCF77_MSEC(DCF77_MINUTE));
 
-                if (cnt > 120)
+                if (diff >= -window && diff <= window)
                 {
-                    bitno = 0;
+                    dcf77_advance_scores (n);
                 }
-                else if (cnt < 75)
+                else                                                        // lost pulse taken as minute mark or after it
                 {
-                    state = STATE_UNKNOWN;
+                    memset (score, 0, sizeof (score));
                 }
-
-                cnt = 0;
             }
+
+            minute_ticks    = cursor;
+            missing_seconds = 0;
+            second          = 0;
+            return;
+        }
+
+        dcf77_stats.missing_pulses++;
+
+        if (++missing_seconds > DCF77_MAX_MISSING)
+        {
+            log_message ("DCF77 Error: signal lost");
+            dcf77_stats.sync_errors++;
+            phase_locked    = 0;
+            second          = 0xFF;
+            return;
+        }
+    }
+    else
+    {
+        missing_seconds = 0;
+        bit = dcf77_classify (width, &conf);
+
+        if (second == 59)                                                   // pulse where the minute mark was expected
+        {
+            log_message ("DCF77 Error: minute mark missing");
+            dcf77_stats.sync_errors++;
+            second = 0xFF;
+            return;
+        }
+
+        if (second != 0xFF && second >= DCF77_FIRST_TIME_BIT && second != DCF77_LEAP_SECOND_BIT)
+        {
+            dcf77_add_bit (second, bit, conf);
+        }
+    }
+
+    if (second != 0xFF)
+    {
+        if (second == 15 && time_complete)                                  // deliver DCF77 time at hh:mm:15 to avoid abrupt minute changes
+        {
+            time_is_valid = 1;
+            time_complete = 0;
+        }
+        else if (second == 16)
+        {
+            time_is_valid = 0;
+        }
+
+        second++;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * phase acquisition: lock to a rising edge which continues a series of edges 1 sec apart
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_acquire (uint32_t edge)
+{
+    uint_fast8_t    cnt = 1;
+    uint_fast8_t    i;
+
+    for (i = 0; i < DCF77_N_CANDIDATES; i++)
+    {
+        uint32_t diff = edge - candidate_edges[i];
+
+        if (candidate_cnt[i] && diff >= DCF77_MSEC(DCF77_SECOND - DCF77_ACQUIRE_WINDOW) &&
+            diff <= DCF77_MSEC(DCF77_SECOND + DCF77_ACQUIRE_WINDOW) && cnt < candidate_cnt[i] + 1)
+        {
+            cnt = candidate_cnt[i] + 1;
+        }
+    }
+
+    if (cnt >= DCF77_ACQUIRE_EDGES)
+    {
+        phase_locked    = 1;
+        missing_seconds = 0;
+        second_start    = edge;
+        next_second     = edge + DCF77_MSEC(DCF77_SECOND);
+        phase_corrected = 1;
+        pulse_width     = 0;
+        pulse_window    = 1;
+        memset (candidate_cnt, 0, sizeof (candidate_cnt));
+    }
+    else
+    {
+        candidate_edges[candidate_idx]  = edge;
+        candidate_cnt[candidate_idx]    = cnt;
+        candidate_idx                   = (candidate_idx + 1) % DCF77_N_CANDIDATES;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * advance decoder time up to tick until, level of DATA pin is constant in between
+ *
+ * The rising edge of the DCF77 pulse marks the start of a second. Once the phase is known, seconds are predicted and edges near the
+ * predicted start only correct the phase, so noise pulses cannot break the second timing. The high level is integrated over a fixed
+ * window after each start of second and classified against an adaptive threshold. Bits are accumulated with their confidence over
+ * consecutive minutes, the time is delivered only if every time bit has a strong consensus.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_advance (uint32_t until)
+{
+    uint32_t    end;
+
+    while ((int32_t) (until - cursor) > 0)
+    {
+        if (! phase_locked)
+        {
+            cursor = until;
             break;
         }
-        default: // STATE_1:
+
+        end = pulse_window ? second_start + DCF77_MSEC(DCF77_PULSE_WINDOW) : next_second;
+
+        if ((int32_t) (until - end) < 0)                                   // end of window or start of next second not reached
         {
-            if (pin == last_pin)
+            if (pulse_window && level)
             {
-                cnt++;
+                pulse_width += until - cursor;
             }
-            else
+
+            cursor = until;
+            break;
+        }
+
+        if ((int32_t) (end - cursor) > 0)
+        {
+            if (pulse_window && level)
             {
-                state = STATE_0;
-                last_pin = pin;
+                pulse_width += end - cursor;
+            }
 
-                if (cnt <= 5 || cnt >= 25)
-                {
-                    if (cnt <= 5)
-                    {
-                        log_message ("DCF77 Error: High pulse <= 5");
-                    }
-                    else
-                    {
-                        log_message ("DCF77 Error: High pulse >= 25");
-                    }
-
-                    state = STATE_UNKNOWN;
-                }
-                else if (cnt > 15)
-                {
-                    switch (bitno)
-                    {
-                        case 17:
-                            isdst   =  1;
-                            break;
-
-                        case 21:
-                            minute +=  1;
-                            p1++;
-                            break;
-                        case 22:
-                            minute +=  2;
-                            p1++;
-                            break;
-                        case 23:
-                            minute +=  4;
-                            p1++;
-                            break;
-                        case 24:
-                            minute +=  8;
-                            p1++;
-                            break;
-                        case 25:
-                            minute += 10;
-                            p1++;
-                            break;
-                        case 26:
-                            minute += 20;
-                            p1++;
-                            break;
-                        case 27:
-                            minute += 40;
-                            p1++;
-                            break;
-
-                        case 28:
-                        {
-                            if (! (p1 & 0x01))
-                            {
-                                log_message ("DCF77 Error: parity P1 incorrect");
-                                state = STATE_UNKNOWN;
-                            }
-                            break;
-                        }
-
-                        case 29:
-                            hour   +=  1;
-                            p2++;
-                            break;
-                        case 30:
-                            hour   +=  2;
-                            p2++;
-                            break;
-                        case 31:
-                            hour   +=  4;
-                            p2++;
-                            break;
-                        case 32:
-                            hour   +=  8;
-                            p2++;
-                            break;
-                        case 33:
-                            hour   += 10;
-                            p2++;
-                            break;
-                        case 34:
-                            hour   += 20;
-                            p2++;
-                            break;
-
-                        case 35:
-                        {
-                            if (! (p2 & 0x01))
-                            {
-                                log_message ("DCF77 Error: parity P2 incorrect");
-                                state = STATE_UNKNOWN;
-                            }
-                            break;
-                        }
-
-                        case 36:
-                            mday   +=  1;
-                            p3++;
-                            break;
-                        case 37:
-                            mday   +=  2;
-                            p3++;
-                            break;
-                        case 38:
-                            mday   +=  4;
-                            p3++;
-                            break;
-                        case 39:
-                            mday   +=  8;
-                            p3++;
-                            break;
-                        case 40:
-                            mday   += 10;
-                            p3++;
-                            break;
-                        case 41:
-                            mday   += 20;
-                            p3++;
-                            break;
-
-                        case 42:
-                            wday   +=  1;
-                            p3++;
-                            break;
-                        case 43:
-                            wday   +=  2;
-                            p3++;
-                            break;
-                        case 44:
-                            wday   +=  4;
-                            p3++;
-                            break;
-
-                        case 45:
-                            month  +=  1;
-                            p3++;
-                            break;
-                        case 46:
-                            month  +=  2;
-                            p3++;
-                            break;
-                        case 47:
-                            month  +=  4;
-                            p3++;
-                            break;
-                        case 48:
-                            month  +=  8;
-                            p3++;
-                            break;
-                        case 49:
-                            month  += 10;
-                            p3++;
-                            break;
-
-                        case 50:
-                            year   +=  1;
-                            p3++;
-                            break;
-                        case 51:
-                            year   +=  2;
-                            p3++;
-                            break;
-                        case 52:
-                            year   +=  4;
-                            p3++;
-                            break;
-                        case 53:
-                            year   +=  8;
-                            p3++;
-                            break;
-                        case 54:
-                            year   += 10;
-                            p3++;
-                            break;
-                        case 55:
-                            year   += 20;
-                            p3++;
-                            break;
-                        case 56:
-                            year   += 40;
-                            p3++;
-                            break;
-                        case 57:
-                            year   += 80;
-                            p3++;
-                            break;
-
-                        case 58:
-                        {
-                            if (! (p3 & 0x01))
-                            {
-                                log_message ("DCF77 Error: parity P3 incorrect");
-                                state = STATE_UNKNOWN;
-                            }
-                            break;
-                        }
-                    }
-                }
-                else
-                {
-                    switch (bitno)
-                    {
-                        case 28:
-                        {
-                            if (p1 & 0x01)
-                            {
-                                log_message ("DCF77 Error: parity P1 incorrect");
-                                state = STATE_UNKNOWN;
-                            }
-                            break;
-                        }
-
-                        case 35:
-                        {
-                            if (p2 & 0x01)
-                            {
-                                log_message ("DCF77 Error: parity P2 incorrect");
-                                state = STATE_UNKNOWN;
-                            }
-                            break;
-                        }
-
-                        case 58:
-                        {
-                            if (p3 & 0x01)
-                            {
-                                log_message ("DCF77 Error: parity P3 incorrect");
-                                state = STATE_UNKNOWN;
-                            }
-                            break;
-                        }
-                    }
+            cursor = end;
+        }
 
-                }
+        if (pulse_window)
+        {
+            pulse_window = 0;
+            dcf77_second ((pulse_width * 1000) / TIMER_TICKS_PER_SEC);
+        }
+        else                                                                // seconds run on prediction, edges only correct the phase
+        {
+            second_start    = next_second;
+            next_second    += DCF77_MSEC(DCF77_SECOND);
+            phase_corrected = 0;
+            pulse_width     = 0;
+            pulse_window    = 1;
+        }
+    }
+}
 
-                if (bitno == 15 && time_complete)                       // deliver DCF77 time at hh:mm:15 to avoid abrupt minute changes
-                {
-                    time_is_valid = 1;
-                    time_complete = 0;
-                }
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * decode debounced edge of DATA pin
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_edge (uint32_t edge, uint_fast8_t new_level)
+{
+    const int32_t   window = DCF77_MSEC(DCF77_SECOND_WINDOW);
+    int32_t         diff;
 
-                if (bitno == 16)
-                {
-                    time_is_valid   = 0;
-                    time_complete   = 0;
-
-                    p1      = 0;
-                    p2      = 0;
-                    p3      = 0;
-
-                    isdst   = 0;
-                    minute  = 0;
-                    hour    = 0;
-                    wday    = 0;
-                    mday    = 0;
-                    month   = 0;
-                    year    = 0;
-                }
+    dcf77_advance (edge);
 
-                if (bitno != 0xff)
-                {
-                    bitno++;
-
-                    if (bitno == 59)
-                    {
-                        if (last_h == hour && last_m + 1 == minute)
-                        {
-                            time_complete = 1;
-                        }
-
-                        last_h = hour;
-                        last_m = minute;
-                    }
-                    else if (bitno >= 60)
-                    {
-                        state = STATE_UNKNOWN;
-                    }
-                }
+    if (new_level == level)                                                 // edges lost by overrun
+    {
+        return;
+    }
+
+    level = new_level;
+
+    if (! level)
+    {
+        board_led_off ();
+        return;
+    }
+
+    board_led_on();
+
+    if (phase_locked)
+    {
+        if (! phase_corrected)
+        {
+            diff = (int32_t) (edge - second_start);
+
+            if (diff < -window || diff > window)
+            {
+                diff = (int32_t) (edge - next_second);
+            }
+
+            if (diff >= -window && diff <= window)
+            {
+                next_second    += (diff + (diff > 0) - (diff < 0)) / 2;     // follow the edge, but damp jitter
+                phase_corrected = 1;
+            }
+        }
+    }
+    else
+    {
+        dcf77_acquire (edge);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * DCF77 ISR - called by timer2 ISR every tick, timestamps debounced edges of DATA pin
+ *
+ * The edges are stamped with timer_ticks, i.e. with the resolution of timer2, and passed to the decoder in the main loop through a
+ * ring buffer, so a stalled main loop delays the decoding but does not change the measured pulse widths. A new level must be stable
+ * for DCF77_DEBOUNCE msec, shorter spikes are counted as glitches. Sampling in the timer2 ISR costs one pin read per tick. An EXTI
+ * interrupt would fire on every spike of a noisy receiver, and on the Nucleo board DATA (PC11) shares EXTI15_10 with the IR input
+ * capture (PC10).
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+dcf77_ISR (void)
+{
+    static uint_fast8_t     changing;                                       // 1: pin differs from debounced level
+    static uint32_t         change_ticks;                                   // tick of first sample with new level
+    uint_fast8_t            pin;
+    uint32_t                head;
 
-                cnt = 0;
+    if (sampling)
+    {
+        pin = (GPIO_ReadInputDataBit(DCF77_DATA_PORT, DCF77_DATA_PIN) != Bit_RESET);
+
+        if (pin == data_level)
+        {
+            if (changing)
+            {
+                changing = 0;
+                dcf77_stats.glitches++;
+            }
+        }
+        else if (! changing)
+        {
+            changing        = 1;
+            change_ticks    = timer_ticks;
+        }
+        else if (timer_ticks - change_ticks >= DCF77_MSEC(DCF77_DEBOUNCE))
+        {
+            changing    = 0;
+            data_level  = pin;
+            head        = edge_head;
+
+            if (head - edge_tail < DCF77_EDGE_RING_LEN)
+            {
+                edge_ring[head & (DCF77_EDGE_RING_LEN - 1)].ticks = change_ticks;
+                edge_ring[head & (DCF77_EDGE_RING_LEN - 1)].level = pin;
+                edge_head = head + 1;
+            }
+            else
+            {
+                dcf77_stats.overruns++;                                     // decoder stalled
             }
         }
-        break;
     }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * decode all edges received since last call, called by timer job in main loop
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+dcf77_poll (void)
+{
+    uint32_t    now     = timer_ticks;
+    uint32_t    head    = edge_head;
+    uint32_t    tail    = edge_tail;
+
+    if (pon_active)                                                         // wait 1 sec before resetting PON after boot
+    {
+        if (now - pon_ticks >= DCF77_MSEC(DCF77_SECOND))
+        {
+            dcf77_pon_reset ();
+            pon_active = 0;
+        }
+
+        edge_tail   = head;
+        cursor      = now;
+        level       = data_level;
+        return;
+    }
+
+    while (tail != head)
+    {
+        dcf77_edge (edge_ring[tail & (DCF77_EDGE_RING_LEN - 1)].ticks, edge_ring[tail & (DCF77_EDGE_RING_LEN - 1)].level);
+        tail++;
+    }
+
+    edge_tail = tail;
+    dcf77_advance (now - DCF77_MSEC(DCF77_DEBOUNCE) - 1);                   // later edges may still be debounced by dcf77_ISR()
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reset DCF77 statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+dcf77_reset_stats (void)
+{
+    memset (&dcf77_stats, 0, sizeof (dcf77_stats));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log DCF77 statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+dcf77_log_stats (void)
+{
+    log_printf ("DCF77: seconds=%lu missing=%lu bits=%lu errors=%lu weak=%lu\r\n", dcf77_stats.seconds, dcf77_stats.missing_pulses,
+                dcf77_stats.bits, dcf77_stats.bit_errors, dcf77_stats.weak_bits);
+    log_printf ("DCF77: minutes=%lu valid=%lu sync errors=%lu lock time=%lu max=%lu sec\r\n", dcf77_stats.minutes,
+                dcf77_stats.valid_minutes, dcf77_stats.sync_errors, dcf77_stats.lock_time, dcf77_stats.max_lock_time);
+    log_printf ("DCF77: pulse width 0=%u 1=%u msec, glitches=%lu edge overruns=%lu\r\n", (unsigned int) (short_avg / 16),
+                (unsigned int) (long_avg / 16), dcf77_stats.glitches, dcf77_stats.overruns);
+}
 
-    return;
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * enable/disable DCF77 sampling, disabled if display power is on
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+dcf77_enable (uint_fast8_t enable)
+{
+    if (enable)
+    {
+        if (! timer_job_is_active (&dcf77_job))
+        {
+            phase_locked    = 0;                        // decoding has stopped, start new search
+            pulse_window    = 0;
+            memset (candidate_cnt, 0, sizeof (candidate_cnt));
+            second          = 0xFF;
+            time_complete   = 0;
+            lock_found      = 0;
+            memset (score, 0, sizeof (score));
+
+            edge_tail       = edge_head;
+            cursor          = timer_ticks;
+            level           = data_level;
+            search_start    = cursor;
+            sampling        = 1;
+            timer_add_job (&dcf77_job, dcf77_poll, TIMER_HZ_TO_TICKS(10), TIMER_HZ_TO_TICKS(10));
+        }
+    }
+    else
+    {
+        sampling = 0;
+        timer_remove_job (&dcf77_job);
+    }
 }
@@ -26,8 +26,29 @@
 
 #include <time.h>
 
-extern void             dcf77_tick (void);
+typedef struct
+{
+    uint32_t            seconds;                    // received seconds
+    uint32_t            missing_pulses;             // seconds without pulse, minute marks not included
+    uint32_t            bits;                       // received time bits
+    uint32_t            bit_errors;                 // received time bits contradicting a strong consensus
+    uint32_t            weak_bits;                  // received time bits too close to the adaptive threshold
+    uint32_t            minutes;                    // received minute marks
+    uint32_t            valid_minutes;              // minutes with strong consensus
+    uint32_t            sync_errors;                // lost second phase or minute mark
+    uint32_t            lock_time;                  // seconds from start of search until first strong consensus
+    uint32_t            max_lock_time;              // max. lock time
+    uint32_t            glitches;                   // spikes of DATA pin shorter than debounce time
+    uint32_t            overruns;                   // edges lost because the decoder was stalled
+} DCF77_STATS;
+
+extern DCF77_STATS      dcf77_stats;
+
+extern void             dcf77_ISR (void);
+extern void             dcf77_enable (uint_fast8_t);
 extern uint_fast8_t     dcf77_time (struct tm *);
+extern void             dcf77_reset_stats (void);
+extern void             dcf77_log_stats (void);
 extern void             dcf77_init (void);
 
 #endif
@@ -99,10 +99,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "log.h"
-#include "delay.h"
 #include "eep.h"
 #include "eeprom-data.h"
 #include "dfplayer.h"
+#include "profile.h"
+#include "task.h"
 
 #undef UART_PREFIX
 #define UART_PREFIX                     dfplayer
@@ -168,7 +169,9 @@ static uint8_t  dfplayer_queue_idx = 0;
 static uint8_t  dfplayer_queue_len = 0;
 static uint8_t  dfplayer_queue[MAX_QUEUE_SIZE];
 
-static void     dfplayer_init2 (void);
+static TASK     dfplayer_init2_task;
+
+static uint_fast8_t dfplayer_init2 (TASK *);
 
 static uint16_t
 calc_checksum (uint8_t * buffer)
@@ -253,6 +256,7 @@ dfplayer_read_message (void)
     uint_fast16_t           chksum;
     uint_fast8_t            idx;
     uint_fast8_t            rtc = 0;
+    PROFILE_START(PROFILE_DFPLAYER_READ_MESSAGE);
 
     if (dfplayer_uart_rsize () >= 10)
     {
@@ -324,6 +328,7 @@ dfplayer_read_message (void)
                         {
                             dfplayer_queue_len = 0;
                         }
+                        PROFILE_STOP(PROFILE_DFPLAYER_READ_MESSAGE);
                         return rtc;
                     }
 
@@ -474,8 +479,8 @@ dfplayer_read_message (void)
 
                     if (! dfplayer.is_up)
                     {
-                        dfplayer.is_up = 1;                        // 1st set up, then call init2
-                        dfplayer_init2 ();
+                        dfplayer.is_up = 1;                        // 1st set up, then start init2
+                        task_start (&dfplayer_init2_task, dfplayer_init2, "dfplayer");
                     }
 
                     rtc = 1;
@@ -499,6 +504,7 @@ dfplayer_read_message (void)
 #endif
     }
 
+    PROFILE_STOP(PROFILE_DFPLAYER_READ_MESSAGE);
     return rtc;
 }
 
@@ -1204,26 +1210,27 @@ dfplayer_init (void)
 }
 
 /*--------------------------------------------------------------------------------------------------------------------------------------
- * dfplayer init step 2
+ * dfplayer init step 2, runs as task: the answers are read by dfplayer_read_message() in main loop
  *--------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-dfplayer_init2 (void)
+static uint_fast8_t
+dfplayer_init2 (TASK * t)
 {
+    TASK_BEGIN(t);
+
     dfplayer_query_software_version ();
-    delay_msec (100);
-    dfplayer_read_message ();
+    TASK_DELAY(t, TIMER_MSEC_TO_TICKS(100));
 
     dfplayer_source_device (DFPLAYER_DEVICE_SD);
-    delay_msec (100);
-    dfplayer_read_message ();
+    TASK_DELAY(t, TIMER_MSEC_TO_TICKS(100));
 
     dfplayer_set_eq (DFPLAYER_EQ_NORMAL);
-    delay_msec (100);
-    dfplayer_read_message ();
+    TASK_DELAY(t, TIMER_MSEC_TO_TICKS(100));
 
     dfplayer_set_volume (dfplayer.volume);
-    delay_msec (100);
-    dfplayer_read_message ();
+    TASK_DELAY(t, TIMER_MSEC_TO_TICKS(100));
+
     log_message ("DFPlayer is up");
+
+    TASK_END(t);
 }
@@ -0,0 +1,694 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * discipline.c - clock discipline: soft clock, DCF77, NTP and RTC with drift compensation
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The soft clock is advanced by clock_timer() in main.c. Its second length is returned by discipline_second(): nominal
+ * TIMER_TICKS_PER_SEC, corrected by the estimated drift of the oscillator and by a slew of at most 5 msec per second.
+ *
+ * Every reference (DCF77, NTP, RTC) yields an offset to the soft clock. Offsets of more than 2 seconds are stepped, all others
+ * are slewed. Independent of steps and slews, the offset of the raw oscillator to the reference is fed into a weighted linear
+ * regression over up to one day, its slope is the drift of the oscillator.
+ *
+ * A source disciplines the soft clock only if no source of higher priority (DCF77, NTP, RTC) delivered a sample within the
+ * last 4 hours, but offsets of more than 2 seconds are stepped by any source. If there was a DCF77 or NTP sample, the
+ * soft clock is the reference of the RTC: the RTC is read with a dithered phase, so the mean of its whole-second readings
+ * resolves the sub-second offset. Timeserver requests are dithered the same way. The drift of the RTC is compensated by the
+ * aging offset register of the DS3231 as soon as it exceeds the uncertainty of the references. The RTC is set only at the
+ * start of a second and only if the clock was stepped or the RTC is more than 200 msec off. In holdover, the RTC only slews the
+ * soft clock, the drift of the oscillator estimated with DCF77 or NTP is kept.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <string.h>
+#include "wclock24h-config.h"
+#include "discipline.h"
+#include "timer.h"
+#include "rtc.h"
+#include "log.h"
+
+#define DISCIPLINE_STEP_TICKS           (2 * TIMER_TICKS_PER_SEC)           // larger offsets are stepped, smaller ones slewed
+#define DISCIPLINE_MAX_SLEW             (TIMER_TICKS_PER_SEC / 200)         // max. slew per second: 5 msec
+#define DISCIPLINE_MAX_DRIFT_PPB        500000L                             // max. accepted drift of oscillator: 500 ppm
+#define DISCIPLINE_HOLDOVER             (4 * 3600L)                         // RTC disciplines soft clock 4h after last DCF77/NTP
+
+#define DISCIPLINE_N_POINTS             48                                  // number of points of drift regression
+#define DISCIPLINE_POINT_INTERVAL       1800                                // samples are averaged into one point per 30 minutes
+#define DISCIPLINE_MIN_SPAN             1800                                // min. span of points to estimate drift: 30 minutes
+#define DISCIPLINE_MAX_SPAN             86400L                              // max. span of points: 1 day
+
+#define DISCIPLINE_RTC_DRIFT_SPAN       (6 * 3600L)                         // min. span of oscillator drift before RTC is estimated
+#define DISCIPLINE_RTC_MIN_SPAN         1440                                // min. span of RTC drift estimation: 1 day in minutes
+#define DISCIPLINE_RTC_MAX_SPAN         (7 * 1440)                          // max. span of RTC drift estimation: 7 days in minutes
+#define DISCIPLINE_RTC_MIN_SAMPLES      360                                 // min. number of RTC readings to adjust aging
+#define DISCIPLINE_RTC_CHECK_SAMPLES    60                                  // min. number of RTC readings to check RTC offset
+#define DISCIPLINE_RTC_MAX_OFFSET       (TIMER_TICKS_PER_SEC / 5)           // RTC is set if it is more than 200 msec off
+#define DISCIPLINE_RTC_MAX_AGING_STEP   20                                  // max. change of aging offset per adjustment: 2 ppm
+#define DISCIPLINE_RTC_PPB_PER_AGING    100                                 // 1 LSB of aging offset = ~0.1 ppm
+
+#define DISCIPLINE_NTP_INTERVAL         3800                                // default timeserver poll interval in seconds
+#define DISCIPLINE_NTP_MIN_INTERVAL     (DISCIPLINE_NTP_INTERVAL / 4)
+#define DISCIPLINE_NTP_MAX_INTERVAL     (DISCIPLINE_NTP_INTERVAL * 2)       // NTP only: enough samples for drift regression
+#define DISCIPLINE_NTP_DCF77_INTERVAL   (DISCIPLINE_NTP_INTERVAL * 4)       // DCF77 is received
+
+typedef struct
+{
+    uint16_t                            phase;                              // position of reference within its second in ticks
+    uint8_t                             weight;                             // weight of sample in drift regression
+    uint8_t                             slew_div;                           // offset / slew_div is slewed
+} DISCIPLINE_SOURCE;
+
+static const DISCIPLINE_SOURCE          discipline_sources[N_DISCIPLINE_SOURCES] =
+{
+    { TIMER_MSEC_TO_TICKS(255), 16, 1 },                                    // DCF77: delivered 250 msec after start of second 15
+    { TIMER_MSEC_TO_TICKS(500),  1, 2 },                                    // NTP: whole seconds, phase unknown
+    { TIMER_MSEC_TO_TICKS(500),  1, 4 },                                    // RTC: whole seconds, read with dithered phase
+};
+
+static const char *                     discipline_source_names[N_DISCIPLINE_SOURCES] = { "dcf77", "ntp", "rtc" };
+
+typedef struct
+{
+    uint32_t                            ticks;                              // timer tick of point
+    int64_t                             y;                                  // offset of reference to raw oscillator in ticks
+    uint32_t                            weight;
+} DISCIPLINE_POINT;
+
+DISCIPLINE_STATS                        discipline_stats;
+
+static uint32_t                         local_sec;                          // soft clock in seconds since 2000-01-01 00:00:00
+static uint32_t                         second_ticks;                       // timer tick of last start of second
+static int64_t                          correction;                         // ticks the soft clock has gained on the oscillator
+static int32_t                          drift_ppb;                          // estimated drift of oscillator, > 0: oscillator slow
+static uint32_t                         drift_span;                         // span of points of last drift estimation in seconds
+static int64_t                          drift_frac;                         // fractional drift correction in 1/1000000000 ticks
+static int32_t                          slew;                               // ticks to slew, > 0: soft clock must gain
+static uint32_t                         last_sample_sec[N_DISCIPLINE_SOURCES];
+static uint_fast8_t                     source_seen;                        // bit mask of sources which delivered a sample
+
+static DISCIPLINE_POINT                 points[DISCIPLINE_N_POINTS];        // ring of points for drift regression
+static uint_fast8_t                     n_points;
+static uint_fast8_t                     point_idx;                          // next point to write
+static uint32_t                         bin_ticks;                          // current point: timer tick of first sample
+static int64_t                          bin_sum_dt;                         // current point: sum of weighted tick offsets
+static int64_t                          bin_sum_y;                          // current point: sum of weighted offsets
+static uint32_t                         bin_weight;                         // current point: sum of weights
+
+static uint32_t                         rtc_read_ticks;                     // timer tick at start of last RTC read
+static uint32_t                         rtc_read_sec;                       // soft clock at start of last RTC read
+static uint32_t                         rtc_read_phase;                     // phase of soft clock at start of last RTC read
+static uint_fast16_t                    dither;                             // dither of RTC read and NTP phase, 1/65536 seconds
+static uint_fast8_t                     rtc_set_pending;                    // 1: set RTC at start of next second
+static int32_t                          rtc_set_shift;                      // offset removed by pending set, 0: restart estimation
+static uint32_t                         rtc_start_sec;                      // RTC drift estimation: start of window
+static int64_t                          rtc_n;                              // RTC drift estimation: number of samples, x in minutes
+static int64_t                          rtc_sx;
+static int64_t                          rtc_sy;
+static int64_t                          rtc_sxx;
+static int64_t                          rtc_sxy;
+
+static uint_fast16_t                    ntp_interval = DISCIPLINE_NTP_INTERVAL;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * convert date/time to seconds since 2000-01-01 00:00:00, valid for years 2000..2099
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+discipline_tm_to_seconds (const struct tm * tmp)
+{
+    static const uint16_t   days_before_month[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+    uint32_t                year = tmp->tm_year - 100;
+    uint32_t                days;
+
+    days = year * 365 + (year + 3) / 4 + days_before_month[tmp->tm_mon] + tmp->tm_mday - 1;
+
+    if (tmp->tm_mon >= 2 && (year % 4) == 0)
+    {
+        days++;
+    }
+
+    return ((days * 24 + tmp->tm_hour) * 60 + tmp->tm_min) * 60 + tmp->tm_sec;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check if a source of higher priority delivered a sample within the holdover time
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+discipline_has_better_source (uint_fast8_t source)
+{
+    uint_fast8_t    s;
+
+    for (s = 0; s < source; s++)
+    {
+        if ((source_seen & (1 << s)) && local_sec - last_sample_sec[s] < DISCIPLINE_HOLDOVER)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * restart RTC drift estimation, called after the RTC has been set or its aging offset has been changed
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+discipline_rtc_restart (void)
+{
+    rtc_start_sec   = local_sec;
+    rtc_n           = 0;
+    rtc_sx          = 0;
+    rtc_sy          = 0;
+    rtc_sxx         = 0;
+    rtc_sxy         = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * estimate drift of oscillator: weighted linear regression over all points, x in seconds, y in ticks
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+discipline_estimate_drift (void)
+{
+    DISCIPLINE_POINT *  newest = &points[(point_idx + DISCIPLINE_N_POINTS - 1) % DISCIPLINE_N_POINTS];
+    DISCIPLINE_POINT *  p;
+    int64_t             sw  = 0;
+    int64_t             sx  = 0;
+    int64_t             sy  = 0;
+    int64_t             sxx = 0;
+    int64_t             sxy = 0;
+    int64_t             num;
+    int64_t             den;
+    int64_t             x;
+    int64_t             y;
+    int32_t             ppb;
+    uint_fast8_t        i;
+
+    while (n_points > 1)                                                    // drop points older than max. span
+    {
+        p = &points[(point_idx + DISCIPLINE_N_POINTS - n_points) % DISCIPLINE_N_POINTS];
+
+        if ((newest->ticks - p->ticks) / TIMER_TICKS_PER_SEC <= DISCIPLINE_MAX_SPAN)
+        {
+            break;
+        }
+        n_points--;
+    }
+
+    p = &points[(point_idx + DISCIPLINE_N_POINTS - n_points) % DISCIPLINE_N_POINTS];
+
+    if (n_points < 3 || (newest->ticks - p->ticks) / TIMER_TICKS_PER_SEC < DISCIPLINE_MIN_SPAN)
+    {
+        return;
+    }
+
+    for (i = 0; i < n_points; i++)
+    {
+        p = &points[(point_idx + DISCIPLINE_N_POINTS - n_points + i) % DISCIPLINE_N_POINTS];
+        x = -(int64_t) ((newest->ticks - p->ticks) / TIMER_TICKS_PER_SEC);
+        y = p->y - newest->y;
+
+        sw  += p->weight;
+        sx  += p->weight * x;
+        sy  += p->weight * y;
+        sxx += p->weight * x * x;
+        sxy += p->weight * x * y;
+    }
+
+    den = sw * sxx - sx * sx;
+
+    if (den > 0)
+    {
+        num = sw * sxy - sx * sy;
+        ppb = (int32_t) (((float) num / (float) den) * (1000000000.0f / TIMER_TICKS_PER_SEC));
+
+        if (ppb > DISCIPLINE_MAX_DRIFT_PPB)
+        {
+            ppb = DISCIPLINE_MAX_DRIFT_PPB;
+        }
+        else if (ppb < -DISCIPLINE_MAX_DRIFT_PPB)
+        {
+            ppb = -DISCIPLINE_MAX_DRIFT_PPB;
+        }
+
+        drift_ppb   = ppb;
+        drift_span  = (newest->ticks - points[(point_idx + DISCIPLINE_N_POINTS - n_points) % DISCIPLINE_N_POINTS].ticks) / TIMER_TICKS_PER_SEC;
+        discipline_stats.drift_ppb = ppb;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * add sample to drift regression, samples within DISCIPLINE_POINT_INTERVAL are averaged into one point
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+discipline_add_drift_sample (uint32_t ticks, int64_t y, uint_fast8_t weight)
+{
+    if (bin_weight && (ticks - bin_ticks) / TIMER_TICKS_PER_SEC >= DISCIPLINE_POINT_INTERVAL)
+    {
+        points[point_idx].ticks     = bin_ticks + (uint32_t) (bin_sum_dt / bin_weight);
+        points[point_idx].y         = bin_sum_y / bin_weight;
+        points[point_idx].weight    = bin_weight;
+        point_idx                   = (point_idx + 1) % DISCIPLINE_N_POINTS;
+
+        if (n_points < DISCIPLINE_N_POINTS)
+        {
+            n_points++;
+        }
+
+        bin_weight = 0;
+        discipline_estimate_drift ();
+    }
+
+    if (! bin_weight)
+    {
+        bin_ticks   = ticks;
+        bin_sum_dt  = 0;
+        bin_sum_y   = 0;
+    }
+
+    bin_sum_dt += (int64_t) (ticks - bin_ticks) * weight;
+    bin_sum_y  += y * weight;
+    bin_weight += weight;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get jitter of best reference in ticks, 0 if there is none
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int32_t
+discipline_reference_jitter (void)
+{
+    uint_fast8_t    source;
+
+    for (source = 0; source < DISCIPLINE_SOURCE_RTC; source++)
+    {
+        if (discipline_stats.sources[source].samples > 1)
+        {
+            return discipline_stats.sources[source].jitter;
+        }
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * estimate drift of RTC and adjust aging offset of DS3231, check if RTC must be set
+ *
+ * The aging offset is only changed if the drift exceeds twice the uncertainty of the references over the span of the estimation.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+discipline_add_rtc_sample (int32_t offset)
+{
+    int64_t         x = (local_sec - rtc_start_sec) / 60;
+    int64_t         den;
+    float           slope;
+    float           theta;
+    int32_t         jitter;
+    int32_t         ppb;
+    int32_t         uncertainty;
+    int_fast8_t     aging;
+    int32_t         delta;
+
+    rtc_n++;
+    rtc_sx  += x;
+    rtc_sy  += offset;
+    rtc_sxx += x * x;
+    rtc_sxy += x * offset;
+
+    if (rtc_n < DISCIPLINE_RTC_CHECK_SAMPLES)
+    {
+        return;
+    }
+
+    den     = rtc_n * rtc_sxx - rtc_sx * rtc_sx;
+    slope   = den > 0 ? (float) (rtc_n * rtc_sxy - rtc_sx * rtc_sy) / (float) den : 0.0f;       // ticks per minute
+    theta   = (float) rtc_sy / rtc_n + slope * ((float) x - (float) rtc_sx / rtc_n);           // current offset of RTC
+
+    if (theta > DISCIPLINE_RTC_MAX_OFFSET || theta < -DISCIPLINE_RTC_MAX_OFFSET)
+    {
+        rtc_set_pending = 1;
+        rtc_set_shift   = (int32_t) theta;                                  // drift estimation continues after the set
+        return;
+    }
+
+    if (drift_span < DISCIPLINE_RTC_DRIFT_SPAN)                             // soft clock not yet drift compensated
+    {
+        discipline_rtc_restart ();
+        return;
+    }
+
+    jitter = discipline_reference_jitter ();
+
+    if (x < DISCIPLINE_RTC_MIN_SPAN || rtc_n < DISCIPLINE_RTC_MIN_SAMPLES || ! jitter)
+    {
+        return;
+    }
+
+    ppb         = (int32_t) (slope * (1000000000.0f / 60 / TIMER_TICKS_PER_SEC));
+    uncertainty = (int32_t) ((float) jitter * (1000000000.0f / 60 / TIMER_TICKS_PER_SEC) / x);
+
+    if (ppb <= 2 * uncertainty && ppb >= -2 * uncertainty)
+    {
+        if (x >= DISCIPLINE_RTC_MAX_SPAN)                                   // RTC is as good as the references
+        {
+            discipline_stats.rtc_drift_ppb = ppb;
+            discipline_rtc_restart ();
+        }
+        return;
+    }
+
+    discipline_stats.rtc_drift_ppb = ppb;
+    delta = ppb / DISCIPLINE_RTC_PPB_PER_AGING;                             // RTC fast: increase aging
+
+    if (delta > DISCIPLINE_RTC_MAX_AGING_STEP)
+    {
+        delta = DISCIPLINE_RTC_MAX_AGING_STEP;
+    }
+    else if (delta < -DISCIPLINE_RTC_MAX_AGING_STEP)
+    {
+        delta = -DISCIPLINE_RTC_MAX_AGING_STEP;
+    }
+
+    if (delta && rtc_get_aging (&aging))
+    {
+        delta += aging;
+
+        if (delta > 127)
+        {
+            delta = 127;
+        }
+        else if (delta < -128)
+        {
+            delta = -128;
+        }
+
+        if (rtc_set_aging (delta))
+        {
+            discipline_stats.rtc_aging = delta;
+            log_printf ("discipline: rtc drift %ld ppb, aging offset %ld\r\n", (long) ppb, (long) delta);
+        }
+    }
+
+    discipline_rtc_restart ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * set soft clock, e.g. manually or from RTC at startup
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+discipline_set_time (const struct tm * tmp, uint_fast8_t set_rtc)
+{
+    uint32_t    sec = discipline_tm_to_seconds (tmp);
+
+    correction     += (int64_t) ((int32_t) (sec - local_sec)) * TIMER_TICKS_PER_SEC;
+    local_sec       = sec;
+    slew            = 0;
+
+    if (set_rtc)
+    {
+        rtc_set_pending = 1;
+        rtc_set_shift   = 0;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * next second of soft clock, called by clock_timer() at start of second
+ *
+ * Returns the length of the next second in ticks
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint32_t
+discipline_second (uint32_t ticks)
+{
+    int32_t     adjust;
+    int32_t     s;
+
+    second_ticks = ticks;
+    local_sec++;
+
+    drift_frac     += (int64_t) drift_ppb * TIMER_TICKS_PER_SEC;
+    adjust          = (int32_t) (drift_frac / 1000000000);
+    drift_frac     -= (int64_t) adjust * 1000000000;
+
+    s = slew;
+
+    if (s > DISCIPLINE_MAX_SLEW)
+    {
+        s = DISCIPLINE_MAX_SLEW;
+    }
+    else if (s < -DISCIPLINE_MAX_SLEW)
+    {
+        s = -DISCIPLINE_MAX_SLEW;
+    }
+
+    slew       -= s;
+    adjust     += s;
+    correction += adjust;
+
+    return TIMER_TICKS_PER_SEC - adjust;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reference time received
+ *
+ * For DISCIPLINE_SOURCE_RTC, the soft clock at the start of the read is taken, see discipline_rtc_read_started().
+ *
+ * Return values:
+ *  0   offset is slewed or the RTC is disciplined
+ *  1   step: caller must set the soft clock to *tmp
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+discipline_reference (uint_fast8_t source, const struct tm * tmp)
+{
+    const DISCIPLINE_SOURCE *   sp = &discipline_sources[source];
+    DISCIPLINE_SOURCE_STATS *   st = &discipline_stats.sources[source];
+    uint32_t                    ref_sec = discipline_tm_to_seconds (tmp);
+    uint32_t                    now = timer_ticks;
+    uint32_t                    sec;
+    uint32_t                    phase;
+    int64_t                     offset;
+    int32_t                     d;
+    uint_fast8_t                better_source;
+    uint_fast8_t                rtc = 0;
+
+    if (source == DISCIPLINE_SOURCE_RTC)
+    {
+        sec     = rtc_read_sec;
+        phase   = rtc_read_phase;
+        now     = rtc_read_ticks;
+    }
+    else
+    {
+        sec     = local_sec;
+        phase   = now - second_ticks;
+    }
+
+    offset          = (int64_t) ((int32_t) (ref_sec - sec)) * TIMER_TICKS_PER_SEC + sp->phase - (int32_t) phase;
+    better_source   = discipline_has_better_source (source);
+
+    if (st->samples)
+    {
+        d = (int32_t) offset - st->offset;
+        st->jitter += ((d < 0 ? -d : d) - st->jitter) / 8;
+    }
+
+    st->offset  = (int32_t) offset;
+    st->samples++;
+
+    if (source == DISCIPLINE_SOURCE_RTC && better_source)                   // soft clock disciplines RTC
+    {
+        if (offset > DISCIPLINE_STEP_TICKS || offset < -DISCIPLINE_STEP_TICKS)
+        {
+            rtc_set_pending = 1;
+            rtc_set_shift   = 0;
+        }
+        else
+        {
+            discipline_add_rtc_sample ((int32_t) offset);
+        }
+        return 0;
+    }
+
+    if (! better_source &&                                                  // NTP is only monitored while DCF77 is received
+        (source != DISCIPLINE_SOURCE_RTC || ! (source_seen & ((1 << DISCIPLINE_SOURCE_RTC) - 1))))     // RTC in holdover: keep drift
+    {
+        discipline_add_drift_sample (now, offset + correction, sp->weight);
+    }
+
+    if (offset > DISCIPLINE_STEP_TICKS || offset < -DISCIPLINE_STEP_TICKS)
+    {
+        correction     += (int64_t) ((int32_t) (ref_sec - sec)) * TIMER_TICKS_PER_SEC;
+        local_sec      += ref_sec - sec;
+        slew            = (int32_t) sp->phase - (int32_t) phase;            // remaining offset within the second
+        discipline_stats.steps++;
+
+        if (source != DISCIPLINE_SOURCE_RTC)
+        {
+            rtc_set_pending = 1;
+            rtc_set_shift   = 0;
+        }
+
+        log_printf ("discipline: %s step %ld msec\r\n", discipline_source_names[source], DISCIPLINE_TICKS_TO_MSEC(offset));
+        rtc = 1;
+    }
+    else if (! better_source)
+    {
+        slew = (int32_t) offset / sp->slew_div;
+    }
+
+    if (source == DISCIPLINE_SOURCE_NTP)
+    {
+        if (rtc || (source_seen & (1 << DISCIPLINE_SOURCE_NTP)) == 0)
+        {
+            ntp_interval = DISCIPLINE_NTP_INTERVAL;
+        }
+        else if (offset > TIMER_TICKS_PER_SEC || offset < -TIMER_TICKS_PER_SEC)
+        {
+            if (ntp_interval > DISCIPLINE_NTP_MIN_INTERVAL)                 // more than quantization error: poll more often
+            {
+                ntp_interval /= 2;
+            }
+        }
+        else if (drift_ppb && ntp_interval < DISCIPLINE_NTP_MAX_INTERVAL)   // stable and drift known: poll less often
+        {
+            ntp_interval *= 2;
+        }
+    }
+    else if (source == DISCIPLINE_SOURCE_DCF77)
+    {
+        ntp_interval = DISCIPLINE_NTP_DCF77_INTERVAL;                       // DCF77 is more precise than NTP
+    }
+
+    discipline_stats.ntp_interval   = ntp_interval;
+    last_sample_sec[source]         = local_sec;
+    source_seen                    |= 1 << source;
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get delay of next RTC read or timeserver request in ticks, the phases of successive calls are spread evenly over the second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint32_t
+discipline_dither_delay (void)
+{
+    dither = (dither + 40503) & 0xFFFF;                                     // 40503 / 65536 = golden ratio - 1
+    return 1 + (((uint32_t) dither * (TIMER_TICKS_PER_SEC - 2)) >> 16);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * remember soft clock at start of RTC read
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+discipline_rtc_read_started (void)
+{
+    rtc_read_ticks  = timer_ticks;
+    rtc_read_sec    = local_sec;
+    rtc_read_phase  = rtc_read_ticks - second_ticks;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check if RTC must be set, called by clock_timer() at start of second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+discipline_rtc_set_due (void)
+{
+    if (rtc_set_pending)
+    {
+        rtc_set_pending = 0;
+        discipline_stats.rtc_sets++;
+
+        if (rtc_set_shift)                                                  // RTC drifted off: shift samples, keep slope
+        {
+            rtc_sy         -= rtc_n * rtc_set_shift;
+            rtc_sxy        -= rtc_sx * rtc_set_shift;
+            rtc_set_shift   = 0;
+        }
+        else                                                                // clock stepped or set
+        {
+            discipline_rtc_restart ();
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get timeserver poll interval in seconds
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast16_t
+discipline_ntp_interval (void)
+{
+    return ntp_interval;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reset statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+discipline_reset_stats (void)
+{
+    memset (discipline_stats.sources, 0, sizeof (discipline_stats.sources));
+    discipline_stats.steps      = 0;
+    discipline_stats.rtc_sets   = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+discipline_log_stats (void)
+{
+    DISCIPLINE_SOURCE_STATS *   st;
+    uint_fast8_t                source;
+
+    log_message ("source  samples  offset(ms)  jitter(ms)");
+
+    for (source = 0; source < N_DISCIPLINE_SOURCES; source++)
+    {
+        st = &discipline_stats.sources[source];
+
+        if (st->samples)
+        {
+            log_printf ("%-6s %8lu %11ld %11ld\r\n", discipline_source_names[source], st->samples,
+                        DISCIPLINE_TICKS_TO_MSEC(st->offset), DISCIPLINE_TICKS_TO_MSEC(st->jitter));
+        }
+    }
+
+    log_printf ("steps=%lu rtc sets=%lu drift=%ld ppb rtc drift=%ld ppb aging=%ld ntp interval=%lu sec\r\n",
+                discipline_stats.steps, discipline_stats.rtc_sets, (long) discipline_stats.drift_ppb,
+                (long) discipline_stats.rtc_drift_ppb, (long) discipline_stats.rtc_aging, discipline_stats.ntp_interval);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * initialize clock discipline, call after rtc_init()
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+discipline_init (void)
+{
+    int_fast8_t     aging;
+
+    discipline_reset_stats ();
+    discipline_stats.ntp_interval = ntp_interval;
+
+    if (rtc_get_aging (&aging))
+    {
+        discipline_stats.rtc_aging = aging;
+    }
+
+    discipline_rtc_restart ();
+}
@@ -0,0 +1,64 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * discipline.h - clock discipline: soft clock, DCF77, NTP and RTC with drift compensation
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef DISCIPLINE_H
+#define DISCIPLINE_H
+
+#include <stdint.h>
+#include <time.h>
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reference sources, ordered by precision
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define DISCIPLINE_SOURCE_DCF77         0                                   // DCF77 time, delivered at hh:mm:15
+#define DISCIPLINE_SOURCE_NTP           1                                   // timeserver via ESP8266, whole seconds
+#define DISCIPLINE_SOURCE_RTC           2                                   // RTC DS3231 or DS1307, whole seconds
+#define N_DISCIPLINE_SOURCES            3
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * offsets are counted in timer_ticks (TIMER_TICKS_PER_SEC)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define DISCIPLINE_TICKS_TO_MSEC(t)     ((long) (((int64_t) (t) * 1000) / TIMER_TICKS_PER_SEC))
+
+typedef struct
+{
+    uint32_t                            samples;                            // number of reference samples
+    int32_t                             offset;                             // last offset in ticks, > 0: reference ahead of soft clock
+    int32_t                             jitter;                             // floating average of offset changes in ticks
+} DISCIPLINE_SOURCE_STATS;
+
+typedef struct
+{
+    DISCIPLINE_SOURCE_STATS             sources[N_DISCIPLINE_SOURCES];
+    uint32_t                            steps;                              // number of steps of soft clock
+    uint32_t                            rtc_sets;                           // number of RTC updates
+    int32_t                             drift_ppb;                          // estimated drift of oscillator in ppb, > 0: oscillator slow
+    int32_t                             rtc_drift_ppb;                      // last estimated drift of RTC in ppb, > 0: RTC fast
+    int32_t                             rtc_aging;                          // current aging offset of DS3231
+    uint32_t                            ntp_interval;                       // current timeserver poll interval in seconds
+} DISCIPLINE_STATS;
+
+extern DISCIPLINE_STATS                 discipline_stats;
+
+extern void                             discipline_set_time (const struct tm *, uint_fast8_t);
+extern uint32_t                         discipline_second (uint32_t);
+extern uint_fast8_t                     discipline_reference (uint_fast8_t, const struct tm *);
+extern uint32_t                         discipline_dither_delay (void);
+extern void                             discipline_rtc_read_started (void);
+extern uint_fast8_t                     discipline_rtc_set_due (void);
+extern uint_fast16_t                    discipline_ntp_interval (void);
+extern void                             discipline_reset_stats (void);
+extern void                             discipline_log_stats (void);
+extern void                             discipline_init (void);
+
+#endif // DISCIPLINE_H
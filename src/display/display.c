@@ -30,6 +30,9 @@
 #include "log.h"
 #include "base.h"
 #include "main.h"
+#include "timer.h"
+#include "event.h"
+#include "profile.h"
 
 /*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 HERE IS A SHORT PROGRAM TO CALCULATE THE PWM TABLE:
@@ -167,8 +170,20 @@ static void     display_animation_drop (void);
 static void     display_animation_squeeze (void);
 static void     display_animation_flicker (void);
 static void     display_animation_matrix (void);
+static void     display_animation_timer (void);
+static uint_fast8_t display_animation_sync_hold (void);
 
 static DISPLAY_ICON                     display_icon_st;
+static TIMER_JOB                        display_animation_job;
+
+static uint_fast8_t                     sync_armed;                     // synchronized animation start is pending
+static uint32_t                         sync_start_ticks;               // timer tick of synchronized animation start
+static uint_fast8_t                     sync_animation_mode;            // animation mode of synchronized start
+static uint_fast16_t                    sync_seed;                      // random seed of synchronized start
+static uint_fast8_t                     sync_late_valid;                // synchronized start happened, sync_late_ticks not yet fetched
+static uint32_t                         sync_late_ticks;                // timer ticks the synchronized start was late
+static uint_fast8_t                     sync_missed;                    // no animation at start time, not yet fetched
+static uint_fast8_t                     animation_mode_override = 0xFF; // animation mode of running synchronized animation
 
 DISPLAY_GLOBALS                         display;
 
@@ -481,7 +496,9 @@ static const char ticker_font[128][TICKER_LINES] =
 static void
 display_refresh_status_led (void)
 {
+    PROFILE_START(PROFILE_LED_REFRESH);
     led_refresh (DSP_STATUS_LEDS);
+    PROFILE_STOP(PROFILE_LED_REFRESH);
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
@@ -492,7 +509,9 @@ display_refresh_status_led (void)
 static void
 display_refresh_minute_leds (void)
 {
+    PROFILE_START(PROFILE_LED_REFRESH);
     led_refresh (DSP_STATUS_LEDS + DSP_MINUTE_LEDS);
+    PROFILE_STOP(PROFILE_LED_REFRESH);
 }
 #endif
 
@@ -503,7 +522,9 @@ display_refresh_minute_leds (void)
 void
 display_refresh_display_leds (void)
 {
+    PROFILE_START(PROFILE_LED_REFRESH);
     led_refresh (DSP_STATUS_LEDS + DSP_MINUTE_LEDS + DSP_DISPLAY_LEDS);
+    PROFILE_STOP(PROFILE_LED_REFRESH);
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
@@ -515,7 +536,9 @@ display_refresh_ambilight_leds (void)
 {
     if (display.ambilight_power_is_on)
     {
+        PROFILE_START(PROFILE_LED_REFRESH);
         led_refresh (DSP_STATUS_LEDS + DSP_MINUTE_LEDS + DSP_DISPLAY_LEDS + DSP_AMBILIGHT_LEDS);
+        PROFILE_STOP(PROFILE_LED_REFRESH);
     }
 }
 
@@ -2816,6 +2839,18 @@ display_animation_flicker (void)
     }
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * call animation function
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+display_call_animation (uint_fast8_t idx)
+{
+    PROFILE_START(PROFILE_ANIMATION);
+    display.animations[idx].func ();
+    PROFILE_STOP_IDX(PROFILE_ANIMATION, idx);
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * random animation
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -2850,7 +2885,7 @@ display_animation_random ()
             x = map_idx[x];
         }
 
-        display.animations[x].func ();
+        display_call_animation (x);
         deceleration_cnt = 0;
     }
     else
@@ -2860,7 +2895,7 @@ display_animation_random ()
         if (deceleration_cnt >= display.animations[x].deceleration)
         {
             deceleration_cnt = 0;
-            display.animations[x].func ();
+            display_call_animation (x);
         }
     }
 }
@@ -5041,7 +5076,13 @@ display_icon (void)
 void
 display_animation (void)
 {
-    if (*ticker_ptr)
+    PROFILE_START(PROFILE_DISPLAY_ANIMATION);
+
+    if (display.realtime_mode)                                  // LEDs are fed by realtime frames
+    {
+        ;
+    }
+    else if (*ticker_ptr)
     {
         static uint_fast8_t cnt;
 
@@ -5057,8 +5098,13 @@ display_animation (void)
     {
         display_icon ();
     }
+    else if (display_animation_sync_hold ())                   // wait for synchronized animation start
+    {
+        ;
+    }
     else
     {
+        uint_fast8_t animation_mode = (animation_mode_override < ANIMATION_MODES) ? animation_mode_override : display.animation_mode;
 #if DSP_MINUTE_LEDS != 0
         uint_fast8_t do_refresh_minute_leds = 0;
 
@@ -5084,18 +5130,18 @@ display_animation (void)
             }
         }
 #endif
-        if (display.animation_mode < ANIMATION_MODES &&
+        if (animation_mode < ANIMATION_MODES &&
             (display.display_power_is_on || display.animation_start_flag || ! display.animation_stop_flag))
         {                                                       // if power is off, display only animation if started or yet not stopped
             if (display.animation_start_flag)
             {
-                display.animations[display.animation_mode].func ();
+                display_call_animation (animation_mode);
             }
             else if (! display.animation_stop_flag)
             {
-                if (display.animation_mode == ANIMATION_MODE_RANDOM)    // random makes its own animation dependant deceleration
+                if (animation_mode == ANIMATION_MODE_RANDOM)            // random makes its own animation dependant deceleration
                 {
-                    display.animations[display.animation_mode].func ();
+                    display_call_animation (animation_mode);
 #if DSP_MINUTE_LEDS != 0
                     do_refresh_minute_leds = 0;                         // animation already refreshed minute leds
 #endif
@@ -5106,10 +5152,10 @@ display_animation (void)
 
                     deceleration_cnt++;
 
-                    if (deceleration_cnt >= display.animations[display.animation_mode].deceleration)
+                    if (deceleration_cnt >= display.animations[animation_mode].deceleration)
                     {
                         deceleration_cnt = 0;
-                        display.animations[display.animation_mode].func ();
+                        display_call_animation (animation_mode);
 #if DSP_MINUTE_LEDS != 0
                         do_refresh_minute_leds = 0;                     // animation already refreshed minute leds
 #endif
@@ -5127,6 +5173,8 @@ display_animation (void)
 
         if (display.animation_stop_flag)                                            // animation stopped
         {
+            animation_mode_override = 0xFF;
+
             if (display.color_animation_mode == COLOR_ANIMATION_MODE_RAINBOW)
             {
                 static uint_fast8_t     display_rainbow_state1 = 0;
@@ -5371,6 +5419,185 @@ display_animation (void)
             }
         }
     }
+
+    PROFILE_STOP(PROFILE_DISPLAY_ANIMATION);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * pre-arm synchronized animation start in delay timer ticks:
+ * the animation timer is re-phased to tick exactly at the start time, an animation started by display_clock()
+ * before is held back until then. mode is the animation mode to use (0xFF: own mode), seed is the random seed,
+ * so that random animations of all synchronized clocks look the same.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+display_sync_animation (uint_fast8_t mode, uint_fast16_t seed, uint32_t delay)
+{
+    if (delay > 0)
+    {
+        sync_animation_mode = mode;
+        sync_seed           = seed;
+        sync_start_ticks    = timer_ticks + delay;
+        sync_armed          = 1;
+
+        timer_add_job (&display_animation_job, display_animation_timer, (delay - 1) % TIMER_HZ_TO_TICKS(64) + 1, TIMER_HZ_TO_TICKS(64));
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check synchronized animation start, return TRUE if a started animation has to be held back
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+display_animation_sync_hold (void)
+{
+    if (sync_armed)
+    {
+        if ((int32_t) (timer_ticks - sync_start_ticks) < 0)
+        {
+            return display.animation_start_flag;
+        }
+
+        sync_armed = 0;
+
+        if (display.animation_start_flag)                               // start time reached: start synchronized animation
+        {
+            my_srand (sync_seed);
+
+            if (sync_animation_mode < ANIMATION_MODES)
+            {
+                animation_mode_override = sync_animation_mode;
+            }
+
+            sync_late_ticks = timer_ticks - sync_start_ticks;
+            sync_late_valid = 1;
+            log_printf ("sync animation: %lu ticks late\r\n", sync_late_ticks);
+        }
+        else                                                            // minute changed too late or before arming
+        {
+            sync_missed = 1;
+            log_message ("sync animation: missed, no animation at start time");
+        }
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get timer ticks the last synchronized animation started after its start time (latency of timer_run() and event dispatch),
+ * returns TRUE only once after each synchronized start
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+display_sync_animation_late (uint32_t * ticksp)
+{
+    if (sync_late_valid)
+    {
+        sync_late_valid = 0;
+        *ticksp = sync_late_ticks;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check if the last synchronized start was missed: no animation was started by display_clock() until the start time,
+ * returns TRUE only once after each missed start
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+display_sync_animation_missed (void)
+{
+    if (sync_missed)
+    {
+        sync_missed = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start realtime mode: stop ticker, icon and animations, LEDs are now fed by display_realtime_leds()
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+display_realtime_start (void)
+{
+    ticker_str[0]                   = '\0';
+    ticker_ptr                      = ticker_str;
+    display.do_display_icon         = 0;
+    display.animation_start_flag    = 0;
+    display.animation_stop_flag     = 1;
+    display.realtime_mode           = 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * set n LEDs of a realtime frame, starting at offset
+ * LED numbering: display LEDs row by row from top left, followed by the ambilight LEDs
+ * rgb values are raw LED values (0...255), not display colors
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+display_realtime_leds (uint_fast16_t offset, const uint8_t * rgb, uint_fast8_t n)
+{
+    LED_RGB         led_rgb;
+    uint_fast16_t   idx;
+
+    RESET_LED_RGB(led_rgb);
+
+    for (idx = offset; idx < offset + n; idx++)
+    {
+        led_rgb.red     = *rgb++;
+        led_rgb.green   = *rgb++;
+        led_rgb.blue    = *rgb++;
+
+        if (idx < DSP_DISPLAY_LEDS)
+        {
+            display_set_display_led (idx, &led_rgb, 0);
+        }
+        else if (idx - DSP_DISPLAY_LEDS < display.ambilight_leds && display.ambilight_power_is_on)
+        {
+            display_set_ambilight_led (idx - DSP_DISPLAY_LEDS, &led_rgb, 0);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * show realtime frame
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+display_realtime_refresh (void)
+{
+    if (display.ambilight_power_is_on)
+    {
+        display_refresh_ambilight_leds ();
+    }
+    else
+    {
+        display_refresh_display_leds ();
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * stop realtime mode: restore ambilight, caller has to update the clock display
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+display_realtime_stop (void)
+{
+    display.realtime_mode = 0;
+
+    if (display.ambilight_mode == AMBILIGHT_MODE_NORMAL)
+    {
+        display_show_ambilight_normal_mode (1);
+    }
+    else
+    {
+        display_show_ambilight_off (1);                                 // other ambilight modes redraw their LEDs
+    }
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
@@ -6207,6 +6434,16 @@ display_temperature_digits (uint_fast8_t temperature_index)
 
 #endif // WCLOCK24H == 1
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: timer job, animate every 1/64 of a second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+display_animation_timer (void)
+{
+    event_post (EVENT_ANIMATION);
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * initialize LED display
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -6326,6 +6563,13 @@ display_init (void)
     display.animations[ANIMATION_MODE_MATRIX].default_deceleration                  = ANIMATION_MATRIX_DEFAULT_DEC;
     display.animations[ANIMATION_MODE_MATRIX].flags                                 = ANIMATION_FLAG_CONFIGURABLE | ANIMATION_FLAG_FAVOURITE;
 
+#if PROFILE == 1
+    for (idx = 0; idx < ANIMATION_MODES && idx < PROFILE_MAX_ANIMATIONS; idx++)
+    {
+        PROFILE_SET_NAME(PROFILE_ANIMATION + idx, display.animations[idx].name);
+    }
+
+#endif
     display.color_animations[COLOR_ANIMATION_MODE_NONE].name                        = "None";
     display.color_animations[COLOR_ANIMATION_MODE_NONE].deceleration                = 1;
     display.color_animations[COLOR_ANIMATION_MODE_NONE].default_deceleration        = 1;
@@ -6394,4 +6638,6 @@ display_init (void)
     strcpy ((char *) display.date_ticker_format, "D.M.Y");
 
     led_init ();
+
+    timer_add_job (&display_animation_job, display_animation_timer, TIMER_HZ_TO_TICKS(64), TIMER_HZ_TO_TICKS(64));  // animate every 1/64 of a second
 }
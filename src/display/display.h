@@ -388,6 +388,7 @@ typedef struct
     uint_fast8_t    display_power_is_on;
     uint_fast8_t    ambilight_power_is_on;
     uint_fast8_t    do_display_icon;
+    uint_fast8_t    realtime_mode;                                              // LEDs are fed by realtime frames, no animations
     uint_fast8_t    n_icons;
     uint_fast8_t    ambilight_led_offset;
     uint_fast8_t    ambilight_leds;
@@ -419,6 +420,13 @@ extern void             display_fireworks (void);
 extern void             display_clock (uint_fast8_t, uint_fast8_t, uint_fast8_t);
 extern void             display_seconds (uint_fast8_t);
 extern void             display_animation (void);
+extern void             display_sync_animation (uint_fast8_t, uint_fast16_t, uint32_t);
+extern uint_fast8_t     display_sync_animation_late (uint32_t *);
+extern uint_fast8_t     display_sync_animation_missed (void);
+extern void             display_realtime_start (void);
+extern void             display_realtime_leds (uint_fast16_t, const uint8_t *, uint_fast8_t);
+extern void             display_realtime_refresh (void);
+extern void             display_realtime_stop (void);
 
 extern void             display_dim_display_dsp_colors (DSP_COLORS *, const DSP_COLORS *, uint_fast8_t, uint_fast8_t);
 extern void             display_dim_ambilight_dsp_colors (DSP_COLORS *, const DSP_COLORS *, uint_fast8_t, uint_fast8_t);
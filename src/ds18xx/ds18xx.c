@@ -157,6 +157,18 @@ ds18xx_start_conversion (uint_fast8_t do_wait)
     return rtc;
 }
 
+/*-----------------------------------------------------------------------------------------------------------------------------------------------
+ * ds18xx_conversion_done () - check if conversion started by ds18xx_start_conversion (0) is done
+ *
+ * The DS18xx answers read time slots with 0 while converting and with 1 when done. One call takes one time slot (~60 us).
+ *-----------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+ds18xx_conversion_done (void)
+{
+    return onewire_read_bit ();
+}
+
 /*-----------------------------------------------------------------------------------------------------------------------------------------------
  * ds18xx_read_raw_temp () - read temperature
  *
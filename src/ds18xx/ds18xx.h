@@ -38,6 +38,7 @@ typedef struct
 extern DS18XX_GLOBALS               ds18xx;
 
 extern uint_fast8_t                 ds18xx_start_conversion (uint_fast8_t);
+extern uint_fast8_t                 ds18xx_conversion_done (void);
 extern uint_fast8_t                 ds18xx_read_raw_temp (uint_fast8_t *, uint_fast8_t *, uint_fast16_t *);
 extern uint_fast8_t                 ds18xx_read_temp (float *);
 extern uint_fast8_t                 ds18xx_get_family_code (void);
@@ -38,7 +38,7 @@
 #define eep_read(a,b,l)         eeprom_read (a, b, l)
 #define eep_write(a,b,l)        eeprom_write (a, b, l)
 #define eep_is_up               eeprom_is_up
-#define eep_flush(x)
+#define eep_flush(x)            eeprom_flush (x)
 
 #endif
 
@@ -18,6 +18,7 @@
 #include "weather.h"
 #include "remote-ir.h"
 #include "overlay.h"
+#include "tz.h"                                                 // need TZ_MAX_RULE_LEN
 
 // Note: All EEPROM versions must have MSB=0x00 and LSB=0x00, only the 2nd and 3rd byte should differ from 0x00
 #define EEPROM_VERSION_0_0          0x00000000                  // version 0.0 (reset to defaults)
@@ -36,7 +37,9 @@
 #define EEPROM_VERSION_2_7          0x00020700                  // version 2.7
 #define EEPROM_VERSION_2_8          0x00020800                  // version 2.8
 #define EEPROM_VERSION_2_9          0x00020900                  // version 2.9
-#define EEPROM_VERSION              EEPROM_VERSION_2_9          // current version
+#define EEPROM_VERSION_3_0          0x00030000                  // version 3.0
+#define EEPROM_VERSION_3_1          0x00030100                  // version 3.1
+#define EEPROM_VERSION              EEPROM_VERSION_3_1          // current version
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * Some packed data to minimize used EEPROM space
@@ -97,8 +100,10 @@
  *      Ambilight marker color white       1 Bytes   (  1 *  1)         1956    1
  *      Date ticker format                 5 Bytes   (  5 *  1)         1957    6
  *      Dimmed ambilight colors           16 Bytes   ( 16 *  1)         1963   16
+ *      IR code commands                  32 Bytes   ( 32 *  1)         1979   32
+ *      Time zone rule                    48 Bytes   ( 48 *  1)         2011   48
  *      =========================================================================
- *      Sum                             1979 Bytes
+ *      Sum                             2059 Bytes
  *
  *  EEPROM size of AT24C32: 32KBit = 4096 Bytes
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -114,6 +119,7 @@
 #define EEPROM_MAX_UPDATE_PATH_LEN                  64                      // max length of update path + '\0'
 #define EEPROM_DATE_TICKER_FORMAT_LEN               DATE_TICKER_FORMAT_LEN  // max length of date ticker path + '\0'
 #define EEPROM_MAX_TIMEZONE_LEN                     2                       // max length of timezone: one byte daylight saving mode, one for +/-, one byte for hour offset
+#define EEPROM_MAX_TIMEZONE_RULE_LEN                (TZ_MAX_RULE_LEN + 1)   // max length of POSIX TZ rule + '\0'
 #define EEPROM_MAX_NIGHT_TIME_LEN                   (MAX_NIGHT_TIMES * 3)   // length of night times: 1 byte flags, 2 bytes minute
 #define EEPROM_MAX_ALARM_TIME_LEN                   (MAX_ALARM_TIMES * 3)   // length of alarm times: 1 byte flags, 2 bytes minute
 #define EEPROM_OVERLAY_ENTRY_SIZE                   (OVERLAY_ENTRY_SIZE)
@@ -170,6 +176,8 @@
 #define EEPROM_DATA_SIZE_AMBI_MARKER_W_COLOR        (1 * sizeof (uint8_t))
 #define EEPROM_DATA_SIZE_DATE_TICKER_FORMAT         (EEPROM_DATE_TICKER_FORMAT_LEN)
 #define EEPROM_DATA_SIZE_DIMMED_AMBILIGHT_COLORS    ((MAX_BRIGHTNESS + 1) * sizeof (uint8_t))
+#define EEPROM_DATA_SIZE_IR_CODE_CMDS               (EEPROM_MAX_IR_CODES * sizeof (uint8_t))
+#define EEPROM_DATA_SIZE_TIMEZONE_RULE              (EEPROM_MAX_TIMEZONE_RULE_LEN)
 
 #define EEPROM_DATA_OFFSET_VERSION                  0
 #define EEPROM_DATA_OFFSET_IRMP_DATA                (EEPROM_DATA_OFFSET_VERSION                 + EEPROM_DATA_SIZE_VERSION)
@@ -221,7 +229,9 @@
 #define EEPROM_DATA_OFFSET_AMBI_MARKER_W_COLOR      (EEPROM_DATA_OFFSET_AMBI_MARKER_COLORS      + EEPROM_DATA_SIZE_AMBI_MARKER_COLORS)
 #define EEPROM_DATA_OFFSET_DATE_TICKER_FORMAT       (EEPROM_DATA_OFFSET_AMBI_MARKER_W_COLOR     + EEPROM_DATA_SIZE_AMBI_MARKER_W_COLOR)
 #define EEPROM_DATA_OFFSET_DIMMED_AMBILIGHT_COLORS  (EEPROM_DATA_OFFSET_DATE_TICKER_FORMAT      + EEPROM_DATA_SIZE_DATE_TICKER_FORMAT)
+#define EEPROM_DATA_OFFSET_IR_CODE_CMDS             (EEPROM_DATA_OFFSET_DIMMED_AMBILIGHT_COLORS + EEPROM_DATA_SIZE_DIMMED_AMBILIGHT_COLORS)
+#define EEPROM_DATA_OFFSET_TIMEZONE_RULE            (EEPROM_DATA_OFFSET_IR_CODE_CMDS            + EEPROM_DATA_SIZE_IR_CODE_CMDS)
 
-#define EEPROM_DATA_END                             (EEPROM_DATA_OFFSET_DIMMED_AMBILIGHT_COLORS + EEPROM_DATA_SIZE_DIMMED_AMBILIGHT_COLORS)
+#define EEPROM_DATA_END                             (EEPROM_DATA_OFFSET_TIMEZONE_RULE           + EEPROM_DATA_SIZE_TIMEZONE_RULE)
 
 #endif
@@ -3,6 +3,14 @@
  *
  * Copyright (c) 2014-2026 Frank Meyer - frank(at)uclock.de
  *
+ * All configuration data (0 .. EEPROM_DATA_END) is held in a RAM shadow. eeprom_read() is served from the shadow,
+ * eeprom_write() only updates the shadow and marks the changed 32 byte blocks as dirty. eeprom_flush(), called
+ * by the main loop, writes the dirty blocks in the background: one asynchronous page write (see i2c_submit()) per call,
+ * the end of the write cycle is detected by ACK polling instead of waiting a fixed time.
+ *
+ * 32 bytes is the smallest page size of all 24Cxx with 16 bit addresses (24C32 .. 24C512), so a block never
+ * crosses a page boundary. Adjacent dirty blocks are merged up to the detected page size.
+ *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 2 of the License, or
@@ -12,51 +20,172 @@
 
 #if ! defined(BLACK_BOARD)                                      // flash only on STM32F407 Black Board, all other: EEPROM
 
+#include <string.h>
 #include "eeprom.h"
+#include "eeprom-data.h"
 #include "i2c.h"
+#include "timer.h"
+#include "log.h"
 
 #define SHOW_SIZES              0
 
-#if SHOW_SIZES == 1
-#include "eeprom-data.h"
-#include "log.h"
-#endif
-
 #define EEPROM_FIRST_ADDR       0xA0                            // I2C address << 1
-#define EEPROM_WAITSTATES       15                              // we have to wait 15ms after each write cycle
+#define EEPROM_WRITE_TIMEOUT    20                              // write cycle takes max. 5..10 ms, give up polling after 20 ms
+
+#define EEPROM_BLOCK_SIZE       32                              // smallest page size of 24C32 .. 24C512
+#define EEPROM_SHADOW_BLOCKS    ((EEPROM_DATA_END + EEPROM_BLOCK_SIZE - 1) / EEPROM_BLOCK_SIZE)
+#define EEPROM_SHADOW_SIZE      (EEPROM_SHADOW_BLOCKS * EEPROM_BLOCK_SIZE)
 
 uint_fast8_t                    eeprom_is_up = 0;
-volatile uint_fast8_t           eeprom_ms_tick;                 // should be set every 1 ms by IRQ, see main.c
 
 static  uint_fast8_t            eeprom_addr;
+static  uint_fast16_t           eeprom_page_size = EEPROM_BLOCK_SIZE;
 
+static  uint8_t                 eeprom_shadow[EEPROM_SHADOW_SIZE];
+static  uint8_t                 eeprom_dirty[EEPROM_SHADOW_BLOCKS];
+static  uint_fast8_t            eeprom_write_busy;              // 1: EEPROM is in internal write cycle
+static  uint32_t                eeprom_write_start;             // timer tick of last page write
+static  I2C_TRANSACTION         eeprom_transaction;             // asynchronous page write
+static  uint_fast16_t           eeprom_async_block;             // first block of asynchronous page write
+static  uint_fast16_t           eeprom_async_n_blocks;          // number of blocks of asynchronous page write, 0: none
 
 /*--------------------------------------------------------------------------------------------------------------------------------------
- * eeprom_waitstates() - wait 15 ms after each write cycle
+ * eeprom_write_done() - check if last write cycle has finished, uses ACK polling
  *--------------------------------------------------------------------------------------------------------------------------------------
  */
-static void
-eeprom_waitstates (void)
+static uint_fast8_t
+eeprom_write_done (void)
 {
-    uint_fast16_t  cnt = 0;
+    uint_fast16_t   idx;
 
-    while (1)
+    if (eeprom_write_busy)
     {
-        if (eeprom_ms_tick)
+        if (eeprom_transaction.status == I2C_PENDING)                  // asynchronous page write still running
         {
-            eeprom_ms_tick = 0;
+            i2c_poll ();                                                // check for timeout
+            return 0;
+        }
+
+        if (eeprom_async_n_blocks > 0)
+        {
+            if (eeprom_transaction.status != I2C_OK)                    // failed: mark blocks dirty again
+            {
+                log_printf ("eeprom: write error at 0x%04x\r\n", eeprom_async_block * EEPROM_BLOCK_SIZE);
+
+                for (idx = 0; idx < eeprom_async_n_blocks; idx++)
+                {
+                    eeprom_dirty[eeprom_async_block + idx] = 1;
+                }
+
+                eeprom_transaction.status   = I2C_OK;
+                eeprom_async_n_blocks       = 0;
+                eeprom_write_busy           = 0;
+                return 1;
+            }
+
+            eeprom_async_n_blocks = 0;
+        }
+
+        if (i2c_ack_poll (eeprom_addr) == I2C_OK)
+        {
+            eeprom_write_busy = 0;
+        }
+        else if (timer_ticks - eeprom_write_start > TIMER_MSEC_TO_TICKS(EEPROM_WRITE_TIMEOUT))
+        {
+            log_message ("eeprom: timeout while ACK polling");
+            eeprom_write_busy = 0;
+        }
+    }
+
+    return ! eeprom_write_busy;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------------------------
+ * eeprom_write_page() - start page write, data must not cross a page boundary
+ *--------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+eeprom_write_page (uint_fast16_t start_addr, uint8_t * buffer, uint_fast16_t cnt)
+{
+    uint_fast8_t    rtc;
+
+    if (i2c_write (eeprom_addr, start_addr, 1, buffer, cnt) == I2C_OK)
+    {
+        eeprom_write_busy   = 1;
+        eeprom_write_start  = timer_ticks;
+        rtc = 1;
+    }
+    else
+    {
+        rtc = 0;
+    }
 
-            cnt++;
+    return rtc;
+}
 
-            if (cnt > EEPROM_WAITSTATES)
+/*--------------------------------------------------------------------------------------------------------------------------------------
+ * eeprom_write_page_async() - start asynchronous page write of shadow blocks, data must not cross a page boundary
+ *--------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+eeprom_write_page_async (uint_fast16_t block, uint_fast16_t n_blocks)
+{
+    eeprom_transaction.slave_addr       = eeprom_addr;
+    eeprom_transaction.is_16_bit_addr   = 1;
+    eeprom_transaction.is_read          = 0;
+    eeprom_transaction.addr             = block * EEPROM_BLOCK_SIZE;
+    eeprom_transaction.data             = eeprom_shadow + block * EEPROM_BLOCK_SIZE;
+    eeprom_transaction.cnt              = n_blocks * EEPROM_BLOCK_SIZE;
+    eeprom_transaction.callback         = 0;
+
+    eeprom_async_block                  = block;
+    eeprom_async_n_blocks               = n_blocks;
+    eeprom_write_busy                   = 1;
+    eeprom_write_start                  = timer_ticks;
+
+    return i2c_submit (&eeprom_transaction);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------------------------
+ * eeprom_detect_page_size() - detect page size by address wrap around
+ *
+ * A 24C32 (4 KB) answers a read of 0x1000 with the contents of 0x0000, a 24C64 a read of 0x2000 and so on.
+ * Capacity 4 KB, 8 KB: page size 32, 16 KB, 32 KB: page size 64, 64 KB: page size 128.
+ * If contents match by chance, the detected page size is too small - which is still safe.
+ *--------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+eeprom_detect_page_size (void)
+{
+    uint8_t         buf0[EEPROM_BLOCK_SIZE];
+    uint8_t         buf1[EEPROM_BLOCK_SIZE];
+    uint32_t        capacity;
+
+    eeprom_page_size = EEPROM_BLOCK_SIZE;
+
+    if (i2c_read (eeprom_addr, 0x0000, 1, buf0, EEPROM_BLOCK_SIZE) == I2C_OK)
+    {
+        for (capacity = 0x1000; capacity < 0x10000; capacity <<= 1)
+        {
+            if (i2c_read (eeprom_addr, capacity, 1, buf1, EEPROM_BLOCK_SIZE) != I2C_OK || memcmp (buf0, buf1, EEPROM_BLOCK_SIZE) == 0)
             {
                 break;
             }
         }
+
+        if (capacity >= 0x10000)
+        {
+            eeprom_page_size = 128;
+        }
+        else if (capacity >= 0x4000)
+        {
+            eeprom_page_size = 64;
+        }
+
+        log_printf ("eeprom: capacity %lu bytes, page size %u\r\n", capacity, eeprom_page_size);
     }
 }
 
-
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * initialize EEPROM functions
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -80,6 +209,22 @@ eeprom_init (uint32_t clockspeed)
         }
     }
 
+    if (eeprom_is_up)
+    {
+        eeprom_write_busy = 0;
+        eeprom_detect_page_size ();
+
+        if (i2c_read (eeprom_addr, 0x0000, 1, eeprom_shadow, EEPROM_SHADOW_SIZE) == I2C_OK)     // load shadow
+        {
+            memset (eeprom_dirty, 0, sizeof (eeprom_dirty));
+        }
+        else
+        {
+            log_message ("eeprom: cannot read data into shadow");
+            eeprom_is_up = 0;
+        }
+    }
+
 #if SHOW_SIZES == 1
     log_printf ("EEPROM_DATA_OFFSET_VERSION                  = %4d %4d\r\n", EEPROM_DATA_OFFSET_VERSION, EEPROM_DATA_SIZE_VERSION);
     log_printf ("EEPROM_DATA_OFFSET_IRMP_DATA                = %4d %4d\r\n", EEPROM_DATA_OFFSET_IRMP_DATA, EEPROM_DATA_SIZE_IRMP_DATA);
@@ -147,7 +292,78 @@ eeprom_get_address (void)
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * read EEPROM
+ * flush dirty blocks of shadow into EEPROM
+ *
+ * force_flush == 0: start at most one asynchronous page write, call this in main loop
+ * force_flush == 1: write all dirty blocks and wait for end of last write cycle
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+eeprom_flush (uint_fast8_t force_flush)
+{
+    uint_fast16_t   block;
+    uint_fast16_t   n_blocks;
+    uint_fast16_t   blocks_per_page;
+    uint_fast16_t   idx;
+
+    if (! eeprom_is_up)
+    {
+        return 0;
+    }
+
+    blocks_per_page = eeprom_page_size / EEPROM_BLOCK_SIZE;
+
+    do
+    {
+        if (! eeprom_write_done ())
+        {
+            continue;                                                   // in case of force_flush: poll again
+        }
+
+        for (block = 0; block < EEPROM_SHADOW_BLOCKS; block++)
+        {
+            if (eeprom_dirty[block])
+            {
+                break;
+            }
+        }
+
+        if (block == EEPROM_SHADOW_BLOCKS)                              // nothing to do
+        {
+            return 1;
+        }
+
+        n_blocks = 1;
+
+        while (block + n_blocks < EEPROM_SHADOW_BLOCKS && eeprom_dirty[block + n_blocks] && (block + n_blocks) % blocks_per_page != 0)
+        {
+            n_blocks++;                                                 // merge adjacent dirty blocks of same page
+        }
+
+        if (force_flush)
+        {
+            if (! eeprom_write_page (block * EEPROM_BLOCK_SIZE, eeprom_shadow + block * EEPROM_BLOCK_SIZE, n_blocks * EEPROM_BLOCK_SIZE))
+            {
+                log_printf ("eeprom: write error at 0x%04x\r\n", block * EEPROM_BLOCK_SIZE);
+                return 0;
+            }
+        }
+        else
+        {
+            eeprom_write_page_async (block, n_blocks);                  // on error blocks are marked dirty again, see eeprom_write_done()
+        }
+
+        for (idx = 0; idx < n_blocks; idx++)
+        {
+            eeprom_dirty[block + idx] = 0;
+        }
+    } while (force_flush);
+
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read EEPROM, data within shadow is read from RAM
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 uint_fast8_t
@@ -157,13 +373,26 @@ eeprom_read (uint_fast16_t start_addr, uint8_t * buffer, uint_fast16_t cnt)
 
     if (eeprom_is_up)
     {
-        if (i2c_read (eeprom_addr, start_addr, 1, buffer, cnt) == I2C_OK)
+        if (start_addr + cnt <= EEPROM_SHADOW_SIZE)
         {
+            memcpy (buffer, eeprom_shadow + start_addr, cnt);
             rtc = 1;
         }
         else
         {
-            rtc = 0;
+            while (! eeprom_write_done ())
+            {
+                ;
+            }
+
+            if (i2c_read (eeprom_addr, start_addr, 1, buffer, cnt) == I2C_OK)
+            {
+                rtc = 1;
+            }
+            else
+            {
+                rtc = 0;
+            }
         }
     }
     else
@@ -175,30 +404,64 @@ eeprom_read (uint_fast16_t start_addr, uint8_t * buffer, uint_fast16_t cnt)
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * write EEPROM
+ *
+ * data within shadow: update shadow and mark changed blocks as dirty, eeprom_flush() writes them later
+ * data beyond shadow: write through page by page
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 uint_fast8_t
 eeprom_write (uint_fast16_t start_addr, uint8_t * buffer, uint_fast16_t cnt)
 {
-    uint_fast8_t rtc;
+    uint_fast16_t   block;
+    uint_fast16_t   end_block;
+    uint_fast16_t   len;
+    uint_fast8_t    rtc;
 
     if (eeprom_is_up)
     {
-        // we must write every single byte, because we have to wait 15ms every cycle
-        while (cnt--)
+        if (start_addr + cnt <= EEPROM_SHADOW_SIZE)
         {
-            if (i2c_write (eeprom_addr, start_addr, 1, buffer, 1) == I2C_OK)
+            if (cnt > 0 && memcmp (eeprom_shadow + start_addr, buffer, cnt) != 0)
             {
-                rtc = 1;
+                memcpy (eeprom_shadow + start_addr, buffer, cnt);
+
+                end_block = (start_addr + cnt - 1) / EEPROM_BLOCK_SIZE;
+
+                for (block = start_addr / EEPROM_BLOCK_SIZE; block <= end_block; block++)
+                {
+                    eeprom_dirty[block] = 1;
+                }
             }
-            else
+            rtc = 1;
+        }
+        else
+        {
+            rtc = 1;
+
+            while (cnt > 0)
             {
-                rtc = 0;
-                break;
+                len = eeprom_page_size - (start_addr % eeprom_page_size);   // don't cross page boundary
+
+                if (len > cnt)
+                {
+                    len = cnt;
+                }
+
+                while (! eeprom_write_done ())
+                {
+                    ;
+                }
+
+                if (! eeprom_write_page (start_addr, buffer, len))
+                {
+                    rtc = 0;
+                    break;
+                }
+
+                start_addr  += len;
+                buffer      += len;
+                cnt         -= len;
             }
-            eeprom_waitstates ();
-            start_addr++;
-            buffer++;
         }
     }
     else
@@ -19,10 +19,10 @@
 #endif
 
 extern uint_fast8_t             eeprom_is_up;
-extern volatile uint_fast8_t    eeprom_ms_tick;
 
 extern uint_fast8_t             eeprom_init (uint32_t);
 extern uint_fast8_t             eeprom_get_address (void);
+extern uint_fast8_t             eeprom_flush (uint_fast8_t);
 extern uint_fast8_t             eeprom_read (uint_fast16_t, uint8_t *, uint_fast16_t);
 extern uint_fast8_t             eeprom_write (uint_fast16_t, uint8_t *, uint_fast16_t);
 
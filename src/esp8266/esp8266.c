@@ -17,6 +17,8 @@
 #include "esp8266.h"
 #include "esp8266-config.h"
 #include "io.h"
+#include "timer.h"
+#include "profile.h"
 
 #undef UART_PREFIX
 #define UART_PREFIX                     esp8266
@@ -30,8 +32,6 @@
  * globals:
  *--------------------------------------------------------------------------------------------------------------------------------------
  */
-volatile uint_fast8_t                   esp8266_ten_ms_tick;            // should be set every 10 msec to 1, see IRQ in main.c
-
 ESP8266_GLOBALS                         esp8266;
 
 #if defined (DISCO_BOARD)                                               // STM32F4 Discovery Board: RST=PC5 CH_PD=PC4 FLASH=PC3
@@ -160,9 +160,9 @@ esp8266_gpio_init (void)
 static uint_fast8_t
 esp8266_poll (uint_fast8_t * chp, uint_fast16_t ten_ms)
 {
-    uint_fast16_t  cnt = 0;
+    uint32_t        start_ticks;
 
-    esp8266_ten_ms_tick = 0;
+    start_ticks = timer_ticks;
 
     while (1)
     {
@@ -171,16 +171,9 @@ esp8266_poll (uint_fast8_t * chp, uint_fast16_t ten_ms)
             return 1;
         }
 
-        if (esp8266_ten_ms_tick)
+        if (timer_ticks - start_ticks >= (uint32_t) ten_ms * TIMER_MSEC_TO_TICKS(10))
         {
-            esp8266_ten_ms_tick = 0;
-
-            cnt++;
-
-            if (cnt >= ten_ms)
-            {
-                break;
-            }
+            break;
         }
     }
     return 0;
@@ -195,8 +188,13 @@ esp8266_get_message (void)
 {
     static char         answer[ESP8266_MAX_ANSWER_LEN + 1];
     static uint_fast8_t answer_pos = 0;
+    static uint_fast8_t frame_pos = 0;                                              // > 0: reading binary frame record
+    static uint_fast8_t frame_esc;
+    static uint_fast8_t frame_xor;
+    uint_fast8_t        frame_len;
     uint_fast8_t        ch;
     uint_fast8_t        rtc = ESP8266_TIMEOUT;
+    PROFILE_START(PROFILE_ESP8266_GET_MESSAGE);
 
     log_flush ();
     esp8266_uart_flush ();
@@ -213,7 +211,59 @@ esp8266_get_message (void)
 
             esp8266.is_up = 1;
 
-            if (ch == '\n')
+            if (ch == ESP8266_FRAME_START)                                              // binary frame record, see esp8266.h
+            {
+                if (frame_pos > 0 || answer_pos > 0)                                    // record or line broken: resync
+                {
+                    esp8266.frame_resyncs++;
+                }
+
+                answer_pos  = 0;
+                frame_pos   = 1;
+                frame_esc   = 0;
+                frame_xor   = 0;
+            }
+            else if (frame_pos > 0)
+            {
+                if (ch == ESP8266_FRAME_END)
+                {
+                    frame_len = frame_pos - 1;                                          // received bytes including xor
+                    frame_pos = 0;
+
+                    if (! frame_esc && frame_len > ESP8266_FRAME_HEADER_LEN && frame_xor == 0 &&
+                        frame_len == ESP8266_FRAME_HEADER_LEN + 3 * esp8266.u.frame[ESP8266_FRAME_HEADER_LEN - 1] + 1)
+                    {
+                        rtc = ESP8266_FRAME;
+                        break;
+                    }
+
+                    esp8266.frame_errors++;                                             // wrong length or checksum: drop record
+                }
+                else if (ch == ESP8266_FRAME_ESC)
+                {
+                    frame_esc = 1;
+                }
+                else
+                {
+                    if (frame_esc)
+                    {
+                        ch ^= ESP8266_FRAME_ESC_XOR;
+                        frame_esc = 0;
+                    }
+
+                    if (frame_pos <= ESP8266_MAX_FRAME_LEN + 1)
+                    {
+                        esp8266.u.frame[frame_pos - 1] = ch;
+                        frame_xor ^= ch;
+                    }
+
+                    if (frame_pos <= ESP8266_MAX_FRAME_LEN + 2)                         // record too long: length check fails at LF
+                    {
+                        frame_pos++;
+                    }
+                }
+            }
+            else if (ch == '\n')
             {
                 answer[answer_pos] = '\0';
 
@@ -430,6 +480,8 @@ esp8266_get_message (void)
     {
         answer[0] = '\0';
     }
+
+    PROFILE_STOP(PROFILE_ESP8266_GET_MESSAGE);
     return rtc;
 }
 
@@ -47,6 +47,7 @@
 #define ESP8266_WEATHER_FC_ICON         22
 #define ESP8266_TABLES                  23
 #define ESP8266_DISP                    24
+#define ESP8266_FRAME                   25                                      // binary realtime LED frame record
 
 #define ESP8266_UNSPECIFIED             0xFF
 
@@ -76,6 +77,22 @@
 #define ESP8266_TABM_LEN                16
 #define ESP8266_DISP_LEN                24
 
+/*--------------------------------------------------------------------------------------------------------------------------------------
+ * binary realtime frame record: STX seq flags offset_hi offset_lo n rgb[3*n] xor LF
+ * xor is calculated over all bytes between STX and xor. Between STX and LF the bytes STX, DLE and LF are sent as DLE (byte ^ 0x20),
+ * so STX always starts a new record and LF always ends it: a record or text line broken by a lost byte is dropped at the next STX,
+ * records with wrong length or checksum are dropped at LF and are never seen by the parser of text lines.
+ *--------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define ESP8266_FRAME_START             0x02                                    // STX
+#define ESP8266_FRAME_END               0x0A                                    // LF
+#define ESP8266_FRAME_ESC               0x10                                    // DLE
+#define ESP8266_FRAME_ESC_XOR           0x20                                    // escaped byte = byte ^ ESP8266_FRAME_ESC_XOR
+#define ESP8266_FRAME_HEADER_LEN        5                                       // seq, flags, offset (2 bytes), n
+#define ESP8266_FRAME_MAX_LEDS          64                                      // max LEDs per record
+#define ESP8266_MAX_FRAME_LEN           (ESP8266_FRAME_HEADER_LEN + 3 * ESP8266_FRAME_MAX_LEDS)
+#define ESP8266_FRAME_FLAG_PUSH         0x01                                    // last record of frame: show LEDs
+
 typedef struct
 {
     uint_fast8_t                        is_up;
@@ -84,6 +101,8 @@ typedef struct
     char                                firmware[ESP8266_MAX_FIRMWARE_LEN + 1];
     char                                accesspoint[ESP8266_MAX_ACCESSPOINT_LEN + 1];
     char                                ipaddress[ESP8266_MAX_IPADDRESS_LEN + 1];
+    uint32_t                            frame_errors;                           // realtime frame records with bad length or checksum
+    uint32_t                            frame_resyncs;                          // records or lines broken off by STX
 
     union
     {
@@ -97,13 +116,12 @@ typedef struct
         char                            tabh[ESP8266_TABH_LEN + 1];
         char                            tabm[ESP8266_TABM_LEN + 1];
         char                            disp[ESP8266_DISP_LEN + 1];
+        uint8_t                         frame[ESP8266_MAX_FRAME_LEN + 1];       // + xor
     } u;
 } ESP8266_GLOBALS;
 
 extern ESP8266_GLOBALS                  esp8266;
 
-extern volatile uint_fast8_t            esp8266_ten_ms_tick;
-
 extern uint_fast8_t                     esp8266_get_message (void);
 extern void                             esp8266_send_cmd (const char *, const char *, uint_fast8_t);
 extern void                             esp8266_send_data (unsigned char *, uint_fast8_t);
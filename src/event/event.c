@@ -0,0 +1,295 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * event.c - event queue: timer jobs & ISRs -> main loop
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * Events are posted by timer jobs (see timer.c) and by the main loop itself, e.g. by RPC commands
+ * of the ESP8266. event_post_from_isr() can be used by an ISR as producer, therefore events posted
+ * from the main loop are inserted with interrupts disabled, see event_post().
+ *
+ * An event id which is already pending is not queued twice - it is coalesced into the pending
+ * one, as the former volatile flags did.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <string.h>
+
+#if defined (STM32F10X)
+#  include "stm32f10x.h"
+#elif defined (STM32F4XX)
+#  include "stm32f4xx.h"
+#endif
+
+#include "irmp.h"
+#include "log.h"
+#include "timer.h"
+#include "event.h"
+
+typedef struct
+{
+    uint8_t                     id;
+    uint32_t                    timestamp;
+} EVENT;
+
+typedef struct
+{
+    EVENT                       events[EVENT_QUEUE_LEN];
+    volatile uint_fast8_t       head;                                   // written only by producer
+    volatile uint_fast8_t       tail;                                   // written only by consumer
+} EVENT_QUEUE;
+
+EVENT_STATS                     event_stats[N_EVENTS];
+
+static EVENT_QUEUE              event_queues[N_EVENT_PRIOS];
+static EVENT_HANDLER            event_handlers[N_EVENTS];
+static uint8_t                  event_prios[N_EVENTS];
+static volatile uint8_t         event_pending_flags[N_EVENTS];
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: insert event into queue of its priority
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+event_enqueue (uint_fast8_t id)
+{
+    EVENT_QUEUE *   q;
+    uint_fast8_t    next;
+
+    if (id >= N_EVENTS)
+    {
+        return 0;
+    }
+
+    if (! event_handlers[id])                                           // no handler registered?
+    {
+        event_stats[id].dropped++;
+        return 0;
+    }
+
+    if (event_pending_flags[id])                                        // already pending?
+    {
+        event_stats[id].coalesced++;                                    // yes, merge it
+        return 1;
+    }
+
+    q       = &event_queues[event_prios[id]];
+    next    = (q->head + 1) & (EVENT_QUEUE_LEN - 1);
+
+    if (next == q->tail)                                                // queue full?
+    {
+        event_stats[id].dropped++;
+        return 0;
+    }
+
+    q->events[q->head].id           = id;
+    q->events[q->head].timestamp    = timer_ticks;
+    event_pending_flags[id]         = 1;
+    __DMB();                                                            // event must be visible before head is moved
+    q->head                         = next;
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * register handler for an event id
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+event_register_handler (uint_fast8_t id, uint_fast8_t prio, EVENT_HANDLER handler)
+{
+    if (id < N_EVENTS && prio < N_EVENT_PRIOS)
+    {
+        event_prios[id]     = prio;
+        event_handlers[id]  = handler;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * post event, call only from ISR
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+event_post_from_isr (uint_fast8_t id)
+{
+    return event_enqueue (id);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * post event, call only from main loop
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+event_post (uint_fast8_t id)
+{
+    uint_fast8_t    rtc;
+
+    __disable_irq();                                                    // ISRs may be producers, too
+    rtc = event_enqueue (id);
+    __enable_irq();
+
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * cancel pending event, the queued entry will be skipped on dispatch
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+event_cancel (uint_fast8_t id)
+{
+    if (id < N_EVENTS)
+    {
+        event_pending_flags[id] = 0;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check if event is pending
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+event_pending (uint_fast8_t id)
+{
+    uint_fast8_t    rtc = 0;
+
+    if (id < N_EVENTS)
+    {
+        rtc = event_pending_flags[id];
+    }
+
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * dispatch all queued events, higher priorities first
+ * returns number of called handlers
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+event_dispatch (void)
+{
+    EVENT_QUEUE *   q;
+    EVENT_STATS *   s;
+    uint_fast8_t    prio;
+    uint_fast8_t    id;
+    uint32_t        latency;
+    uint_fast8_t    cnt = 0;
+
+    for (prio = 0; prio < N_EVENT_PRIOS; prio++)
+    {
+        q = &event_queues[prio];
+
+        while (q->tail != q->head)
+        {
+            __DMB();                                                    // read event after head
+            id      = q->events[q->tail].id;
+            latency = timer_ticks - q->events[q->tail].timestamp;
+            q->tail = (q->tail + 1) & (EVENT_QUEUE_LEN - 1);
+
+            if (event_pending_flags[id])                                // not cancelled?
+            {
+                event_pending_flags[id] = 0;                            // reset before call, handler may post it again
+
+                s = &event_stats[id];
+
+                if (s->dispatched == 0 || latency < s->min_latency)
+                {
+                    s->min_latency = latency;
+                }
+
+                if (latency > s->max_latency)
+                {
+                    s->max_latency = latency;
+                }
+
+                s->sum_latency += latency;
+                s->dispatched++;
+
+                (*event_handlers[id]) ();
+                cnt++;
+            }
+        }
+    }
+
+    return cnt;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * sleep until next interrupt if no event is queued
+ *
+ * WFI is executed with interrupts disabled: a pending interrupt wakes up the CPU anyway,
+ * so an event posted between check and sleep cannot be missed.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+event_idle (void)
+{
+    uint_fast8_t    prio;
+
+    __disable_irq();
+
+    for (prio = 0; prio < N_EVENT_PRIOS; prio++)
+    {
+        if (event_queues[prio].tail != event_queues[prio].head)
+        {
+            break;
+        }
+    }
+
+    if (prio == N_EVENT_PRIOS)                                          // all queues empty?
+    {
+        __WFI();                                                        // yes, sleep
+    }
+
+    __enable_irq();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reset statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+event_reset_stats (void)
+{
+    memset (event_stats, 0, sizeof (event_stats));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log statistics: latencies in usec
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+event_log_stats (void)
+{
+    EVENT_STATS *   s;
+    uint_fast8_t    id;
+
+    log_message ("id prio   dispatched  coalesced    dropped  min(us)  avg(us)  max(us)");
+
+    for (id = 0; id < N_EVENTS; id++)
+    {
+        s = &event_stats[id];
+
+        if (s->dispatched)
+        {
+            log_printf ("%2d    %d %12lu %10lu %10lu %8lu %8lu %8lu\r\n", id, event_prios[id], s->dispatched, s->coalesced, s->dropped,
+                        EVENT_TICKS_TO_USEC (s->min_latency), EVENT_TICKS_TO_USEC (s->sum_latency / s->dispatched),
+                        EVENT_TICKS_TO_USEC (s->max_latency));
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * initialize event queues
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+event_init (void)
+{
+    memset (event_queues, 0, sizeof (event_queues));
+    memset ((void *) event_pending_flags, 0, sizeof (event_pending_flags));
+    event_reset_stats ();
+}
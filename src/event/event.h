@@ -0,0 +1,77 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * event.h - event queue: timer jobs & ISRs -> main loop
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdint.h>
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * event ids
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define EVENT_ANIMATION                 0                                   // animate LEDs, every 1/64 second
+#define EVENT_AMBILIGHT_CLOCK_TICK      1                                   // ambilight modes clock & clock2: next step
+#define EVENT_SHOW_TIME                 2                                   // update time on display, every full minute
+#define EVENT_HALF_MINUTE               3                                   // it is hh:mm:30, check overlays
+#define EVENT_DS3231                    4                                   // read date/time from RTC DS3231
+#define EVENT_NET_TIME                  5                                   // read date/time from time server
+#define EVENT_LDR_CONVERSION            6                                   // start LDR conversion
+#define EVENT_MEASURE_TEMPERATURE       7                                   // start conversion of DS18xx
+#define EVENT_READ_TEMPERATURE          8                                   // read temperature from DS18xx
+#define EVENT_READ_RTC_TEMPERATURE      9                                   // read temperature from RTC
+#define EVENT_RTC_DATE_TIME             10                                  // asynchronous read of RTC date/time finished
+#define EVENT_RTC_TEMPERATURE           11                                  // asynchronous read of RTC temperature finished
+#define N_EVENTS                        12                                  // number of event ids
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * event priorities, events of higher priority are dispatched first
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define EVENT_PRIO_HIGH                 0
+#define EVENT_PRIO_NORMAL               1
+#define EVENT_PRIO_LOW                  2
+#define N_EVENT_PRIOS                   3
+
+#define EVENT_QUEUE_LEN                 16                                  // queue length per priority, must be power of 2
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timestamps are counted in timer_ticks (TIMER_TICKS_PER_SEC)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define EVENT_TICKS_TO_USEC(t)          ((uint32_t) (((uint64_t) (t) * 1000000UL) / TIMER_TICKS_PER_SEC))
+
+typedef void (*EVENT_HANDLER) (void);
+
+typedef struct
+{
+    uint32_t                            dispatched;                         // number of dispatched events
+    uint32_t                            coalesced;                          // posted while still pending, merged into pending event
+    uint32_t                            dropped;                            // queue full or no handler registered
+    uint32_t                            min_latency;                        // min. latency post -> dispatch in ticks
+    uint32_t                            max_latency;                        // max. latency post -> dispatch in ticks
+    uint32_t                            sum_latency;                        // sum of latencies, avg = sum_latency / dispatched
+} EVENT_STATS;
+
+extern EVENT_STATS                      event_stats[N_EVENTS];
+
+extern void                             event_register_handler (uint_fast8_t, uint_fast8_t, EVENT_HANDLER);
+extern uint_fast8_t                     event_post_from_isr (uint_fast8_t);
+extern uint_fast8_t                     event_post (uint_fast8_t);
+extern void                             event_cancel (uint_fast8_t);
+extern uint_fast8_t                     event_pending (uint_fast8_t);
+extern uint_fast8_t                     event_dispatch (void);
+extern void                             event_idle (void);
+extern void                             event_reset_stats (void);
+extern void                             event_log_stats (void);
+extern void                             event_init (void);
+
+#endif // EVENT_H
@@ -5,7 +5,22 @@
  *       512 sectors of 4096 bytes
  *      8192 pages of 256 bytes
  *
- * Here we use only 4 sectors: 16384 bytes
+ * The emulated EEPROM has 16384 bytes and is held completely in RAM. The flash stores a journal of
+ * 64 byte records in a ring of FLASH_LOG_SECTORS sectors:
+ *
+ *   record 0 of a sector:  sector header: magic, sequence number, CRC
+ *   record 1..63:          key (number of 60 byte chunk of EEPROM data), CRC, 60 bytes data
+ *
+ * A changed chunk is appended as new record, the record of the sector with the highest sequence number
+ * wins. If the head sector is full, the next sector (always erased) becomes head sector and the sector
+ * after it - the oldest one - is compacted: its still valid records are copied into the new head sector,
+ * then it is erased. So every sector is erased once per round trip through the ring.
+ *
+ * Power loss: incomplete records and sector headers fail the CRC check and are ignored. An interrupted
+ * compaction is completed by flash_init(). Recovery reads each sector of the ring once.
+ *
+ * Old format: sectors 0..3 held a 1:1 image of the EEPROM data. If no log is found, this image is read
+ * and written into the log.
  *
  * Copyright (c) 2018-2026 Frank Meyer - frank(at)uclock.de
  *
@@ -21,59 +36,372 @@
 #include <stdint.h>
 #include <string.h>
 #include "main.h"
+#include "log.h"
 #include "w25qxx.h"
 #include "flash.h"
 
 #define SECTORSIZE                  4096                    // sector size of flash
 #define PAGESIZE                    256                     // page size of flash
 #define PAGES_PER_SECTOR            16                      // 16 * 256 = 4096
-#define SECTORS                     4                       // hold 4 sectors (4 * 4096 = 16384) in RAM
+#define SECTORS                     4                       // size of emulated EEPROM: 4 sectors (4 * 4096 = 16384)
+#define CACHE_SIZE                  (SECTORS * SECTORSIZE)
+
 #define FLUSH_TIME                  5                       // flush flash 5 seconds after last cache update
 
-static uint8_t                      cache[SECTORS * SECTORSIZE];
-static uint8_t                      sector_is_dirty[SECTORS];
+#ifndef FLASH_LOG_FIRST_SECTOR
+#define FLASH_LOG_FIRST_SECTOR      4                       // first sector of log ring, behind old image format
+#endif
+
+#ifndef FLASH_LOG_SECTORS
+#define FLASH_LOG_SECTORS           16                      // number of sectors in log ring
+#endif
+
+#define RECORD_SIZE                 64                      // size of a record in flash
+#define RECORDS_PER_PAGE            (PAGESIZE / RECORD_SIZE)
+#define RECORDS_PER_SECTOR          (SECTORSIZE / RECORD_SIZE)
+#define CHUNK_SIZE                  (RECORD_SIZE - 4)       // data bytes per record
+#define CHUNKS                      ((CACHE_SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE)
+
+#define LOG_MAGIC                   0x474C4357              // "WCLG"
+#define NO_SECTOR                   0xFF
+
+#if FLASH_LOG_FIRST_SECTOR < SECTORS
+#error FLASH_LOG_FIRST_SECTOR overlaps old image format
+#endif
+
+#if FLASH_LOG_SECTORS >= NO_SECTOR
+#error FLASH_LOG_SECTORS too large
+#endif
+
+#if CHUNKS > (FLASH_LOG_SECTORS - 2) * (RECORDS_PER_SECTOR - 1)
+#error FLASH_LOG_SECTORS too small for compaction
+#endif
+
+typedef struct
+{
+    uint16_t                        key;                    // number of chunk
+    uint16_t                        crc;                    // CRC of key and data
+    uint8_t                         data[CHUNK_SIZE];
+} FLASH_RECORD;
+
+typedef struct
+{
+    uint32_t                        magic;
+    uint32_t                        seq;                    // sequence number, incremented with every new head sector
+    uint16_t                        crc;                    // CRC of magic and seq
+    uint8_t                         unused[RECORD_SIZE - 10];
+} FLASH_SECTOR_HEADER;
+
+static uint8_t                      cache[CACHE_SIZE];
+static uint8_t                      chunk_is_dirty[CHUNKS];
+static uint8_t                      chunk_sector[CHUNKS];   // sector in ring holding newest record of chunk
+static uint8_t                      sector_is_used[FLASH_LOG_SECTORS];
+static uint8_t                      page_buf[PAGESIZE];
+static uint_fast8_t                 head_sector;            // sector in ring where records are appended
+static uint_fast8_t                 head_record;            // next free record in head sector
+static uint32_t                     head_seq;               // sequence number of head sector
 static uint32_t                     last_update;            // timestamp of last update
 
 uint_fast8_t                        flash_is_up             = 0;
 
+static void                         flash_append (uint_fast16_t);
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: CRC16 CCITT
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint16_t
+flash_crc16 (uint16_t crc, const uint8_t * p, uint32_t len)
+{
+    uint_fast8_t    i;
+
+    while (len--)
+    {
+        crc ^= (uint16_t) *p++ << 8;
+
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: CRC of record
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint16_t
+flash_record_crc (FLASH_RECORD * rec)
+{
+    uint16_t    crc;
+
+    crc = flash_crc16 (0xFFFF, (uint8_t *) &rec->key, sizeof (rec->key));
+    crc = flash_crc16 (crc, rec->data, CHUNK_SIZE);
+    return crc;
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: CRC of sector header
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint16_t
+flash_header_crc (FLASH_SECTOR_HEADER * hdr)
+{
+    uint16_t    crc;
+
+    crc = flash_crc16 (0xFFFF, (uint8_t *) &hdr->magic, sizeof (hdr->magic));
+    crc = flash_crc16 (crc, (uint8_t *) &hdr->seq, sizeof (hdr->seq));
+    return crc;
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: check if buffer is erased
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+flash_is_erased (uint8_t * p, uint32_t len)
+{
+    while (len--)
+    {
+        if (*p++ != 0xFF)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: program one record, NOR flash: bytes 0xFF in the page buffer leave the other records untouched
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+flash_program_record (uint_fast8_t sector, uint_fast8_t record, void * data)
+{
+    memset (page_buf, 0xFF, PAGESIZE);
+    memcpy (page_buf + (record % RECORDS_PER_PAGE) * RECORD_SIZE, data, RECORD_SIZE);
+    w25qxx_write_page (page_buf, FLASH_LOG_FIRST_SECTOR + sector, record / RECORDS_PER_PAGE);
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: erase sector of ring
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+flash_erase (uint_fast8_t sector)
+{
+    w25qxx_erase_sector (FLASH_LOG_FIRST_SECTOR + sector);
+    sector_is_used[sector] = 0;
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: compact sector: copy still valid records into head sector, then erase it
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+flash_compact (uint_fast8_t sector)
+{
+    uint_fast16_t   chunk;
+
+    if (sector_is_used[sector])
+    {
+        for (chunk = 0; chunk < CHUNKS; chunk++)
+        {
+            if (chunk_sector[chunk] == sector)
+            {
+                flash_append (chunk);
+            }
+        }
+
+        flash_erase (sector);
+    }
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: switch to next sector, it is always erased. Then compact the oldest sector, so that the following one is erased, too.
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+flash_next_sector (void)
+{
+    FLASH_SECTOR_HEADER hdr;
+
+    head_sector = (head_sector + 1) % FLASH_LOG_SECTORS;
+    head_seq++;
+
+    memset (&hdr, 0xFF, sizeof (hdr));
+    hdr.magic   = LOG_MAGIC;
+    hdr.seq     = head_seq;
+    hdr.crc     = flash_header_crc (&hdr);
+
+    flash_program_record (head_sector, 0, &hdr);
+    sector_is_used[head_sector] = 1;
+    head_record = 1;
+
+    flash_compact ((head_sector + 1) % FLASH_LOG_SECTORS);
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: append chunk of cache as record
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+flash_append (uint_fast16_t chunk)
+{
+    FLASH_RECORD    rec;
+    uint32_t        offset;
+    uint32_t        len;
+
+    if (head_record >= RECORDS_PER_SECTOR)
+    {
+        flash_next_sector ();
+    }
+
+    offset  = chunk * CHUNK_SIZE;
+    len     = (offset + CHUNK_SIZE <= CACHE_SIZE) ? CHUNK_SIZE : CACHE_SIZE - offset;
+
+    memset (rec.data, 0xFF, CHUNK_SIZE);
+    memcpy (rec.data, cache + offset, len);
+    rec.key = chunk;
+    rec.crc = flash_record_crc (&rec);
+
+    flash_program_record (head_sector, head_record, &rec);
+    head_record++;
+    chunk_sector[chunk] = head_sector;
+}
+
 /*------------------------------------------------------------------------------------------------------------------------------------
- * flash_flush () - flush all dirty cache slots
+ * INTERN: replay records of a sector into cache, returns number of first free record
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+flash_replay (uint_fast8_t sector)
+{
+    FLASH_RECORD    rec;
+    uint_fast8_t    page;
+    uint_fast8_t    idx;
+    uint_fast8_t    record;
+    uint_fast8_t    free_record = 1;
+    uint32_t        offset;
+    uint32_t        len;
+
+    for (page = 0; page < PAGES_PER_SECTOR; page++)
+    {
+        w25qxx_read_page (page_buf, FLASH_LOG_FIRST_SECTOR + sector, page);
+
+        for (idx = 0; idx < RECORDS_PER_PAGE; idx++)
+        {
+            record = page * RECORDS_PER_PAGE + idx;
+
+            if (record == 0)                                                                // sector header
+            {
+                continue;
+            }
+
+            memcpy (&rec, page_buf + idx * RECORD_SIZE, RECORD_SIZE);
+
+            if (flash_is_erased ((uint8_t *) &rec, RECORD_SIZE))
+            {
+                continue;
+            }
+
+            free_record = record + 1;                                                       // also skip incomplete records
+
+            if (rec.key < CHUNKS && rec.crc == flash_record_crc (&rec))
+            {
+                offset  = rec.key * CHUNK_SIZE;
+                len     = (offset + CHUNK_SIZE <= CACHE_SIZE) ? CHUNK_SIZE : CACHE_SIZE - offset;
+                memcpy (cache + offset, rec.data, len);
+                chunk_sector[rec.key] = sector;
+            }
+        }
+    }
+
+    return free_record;
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: read chunks without record in log from image of old format into cache, all chunks containing data become dirty
+ *
+ * The old image is never written by the log. A chunk without record has not been converted yet (e.g. power loss during
+ * the first flush) or is unused in the old image, too. So the conversion is completed by the next flush.
+ *------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+flash_read_old_format (void)
+{
+    uint32_t        loaded_page = 0xFFFFFFFF;
+    uint32_t        page;
+    uint32_t        addr;
+    uint32_t        offset;
+    uint32_t        end;
+    uint32_t        n;
+    uint_fast16_t   chunk;
+    uint32_t        len;
+
+    for (chunk = 0; chunk < CHUNKS; chunk++)
+    {
+        if (chunk_sector[chunk] != NO_SECTOR)                                           // chunk already in log
+        {
+            continue;
+        }
+
+        offset  = chunk * CHUNK_SIZE;
+        len     = (offset + CHUNK_SIZE <= CACHE_SIZE) ? CHUNK_SIZE : CACHE_SIZE - offset;
+        end     = offset + len;
+
+        for (addr = offset; addr < end; addr += n)
+        {
+            page = addr / PAGESIZE;
+
+            if (page != loaded_page)
+            {
+                w25qxx_read_page (page_buf, page / PAGES_PER_SECTOR, page % PAGES_PER_SECTOR);
+                loaded_page = page;
+            }
+
+            n = (page + 1) * PAGESIZE - addr;
+
+            if (n > end - addr)
+            {
+                n = end - addr;
+            }
+
+            memcpy (cache + addr, page_buf + addr % PAGESIZE, n);
+        }
+
+        if (! flash_is_erased (cache + offset, len))
+        {
+            chunk_is_dirty[chunk] = 1;
+            last_update = 1;
+        }
+    }
+
+    if (last_update)
+    {
+        log_message ("flash: converting old format into log");
+    }
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------
+ * flash_flush () - append all dirty chunks to log
  *------------------------------------------------------------------------------------------------------------------------------------
  */
 uint_fast8_t
 flash_flush (uint_fast8_t force_flush)
 {
-    uint32_t    sector;
-    uint32_t    page;
-    uint32_t    idx;
+    uint_fast16_t   chunk;
 
     if (force_flush || (last_update > 0 && last_update + FLUSH_TIME < uptime))
     {                                                                                   // flush cache x seconds after last cache update
-        for (sector = 0; sector < SECTORS; sector++)
+        for (chunk = 0; chunk < CHUNKS; chunk++)
         {
-            if (sector_is_dirty[sector])
+            if (chunk_is_dirty[chunk])
             {
-                w25qxx_erase_sector (sector);                                           // set 4096 bytes to 0xFF
-
-                for (page = 0; page < PAGES_PER_SECTOR; page++)
-                {
-                    uint8_t * p = cache + sector * SECTORSIZE + page;                   // find a byte != 0xff within the cache
-
-                    for (idx = 0; idx < PAGESIZE; idx++)
-                    {
-                        if (*p != 0xFF)
-                        {
-                            break;                                                      // found, we must write the page
-                        }
-                        p++;
-                    }
-
-                    if (idx < PAGESIZE)
-                    {
-                        w25qxx_write_page (cache + sector * SECTORSIZE + page * PAGESIZE, sector, page);
-                    }
-                }
-                sector_is_dirty[sector] = 0;
+                flash_append (chunk);
+                chunk_is_dirty[chunk] = 0;
             }
         }
 
@@ -90,11 +418,11 @@ flash_flush (uint_fast8_t force_flush)
 uint_fast8_t
 flash_read (uint32_t start_addr, uint8_t * buffer, uint32_t cnt)
 {
-    if (start_addr < SECTORS * SECTORSIZE)                                                      // start address valid?
+    if (start_addr < CACHE_SIZE)                                                                // start address valid?
     {
-        if (start_addr + cnt > SECTORS * SECTORSIZE)                                            // data behind cache size?
+        if (start_addr + cnt > CACHE_SIZE)                                                      // data behind cache size?
         {
-            cnt = SECTORS * SECTORSIZE - start_addr;
+            cnt = CACHE_SIZE - start_addr;
         }
 
         memcpy (buffer, cache + start_addr, cnt);
@@ -111,28 +439,29 @@ flash_read (uint32_t start_addr, uint8_t * buffer, uint32_t cnt)
 uint_fast8_t
 flash_write (uint32_t start_addr, uint8_t * buffer, uint32_t cnt)
 {
-    uint32_t   start_sector;
-    uint32_t   end_sector;
-    uint32_t   sector;
+    uint32_t   start_chunk;
+    uint32_t   end_chunk;
+    uint32_t   chunk;
 
-    if (start_addr < SECTORS * SECTORSIZE)                                                      // start address valid?
+    if (start_addr < CACHE_SIZE)                                                                // start address valid?
     {
-        if (start_addr + cnt > SECTORS * SECTORSIZE)                                            // data behind cache size?
+        if (start_addr + cnt > CACHE_SIZE)                                                      // data behind cache size?
         {
-            cnt = SECTORS * SECTORSIZE - start_addr;
+            cnt = CACHE_SIZE - start_addr;
         }
 
-        start_sector = start_addr / SECTORSIZE;
-        end_sector   = (start_addr + cnt - 1) / SECTORSIZE;
-
-        if (memcmp (cache + start_addr, buffer, cnt) != 0)
+        if (cnt > 0 && memcmp (cache + start_addr, buffer, cnt) != 0)
         {
+            start_chunk = start_addr / CHUNK_SIZE;
+            end_chunk   = (start_addr + cnt - 1) / CHUNK_SIZE;
+
             memcpy (cache + start_addr, buffer, cnt);
 
-            for (sector = start_sector; sector <= end_sector; sector++)
+            for (chunk = start_chunk; chunk <= end_chunk; chunk++)
             {
-                sector_is_dirty[sector] = 1;
+                chunk_is_dirty[chunk] = 1;
             }
+
             last_update = uptime;
         }
 
@@ -143,27 +472,89 @@ flash_write (uint32_t start_addr, uint8_t * buffer, uint32_t cnt)
 }
 
 /*------------------------------------------------------------------------------------------------------------------------------------
- * flash_init () - initialize flash routines
+ * flash_init () - initialize flash routines, replay log into cache
  *------------------------------------------------------------------------------------------------------------------------------------
  */
 void
 flash_init (void)
 {
-    uint32_t    sector;
-    uint32_t    page;
-    uint32_t    offset = 0;
+    FLASH_SECTOR_HEADER hdr;
+    uint32_t            seqs[FLASH_LOG_SECTORS];
+    uint8_t             order[FLASH_LOG_SECTORS];
+    uint_fast8_t        n_valid = 0;
+    uint_fast8_t        sector;
+    uint_fast8_t        page;
+    uint_fast8_t        idx;
+    uint_fast8_t        erased;
 
     w25qxx_init ();
     flash_is_up = 1;
 
-    for (sector = 0; sector < SECTORS; sector++)                                        // copy sectors into RAM
+    memset (cache, 0xFF, CACHE_SIZE);
+    memset (chunk_is_dirty, 0, CHUNKS);
+    memset (chunk_sector, NO_SECTOR, CHUNKS);
+    last_update = 0;
+
+    for (sector = 0; sector < FLASH_LOG_SECTORS; sector++)                              // classify sectors of ring
+    {
+        w25qxx_read_page (page_buf, FLASH_LOG_FIRST_SECTOR + sector, 0);
+        memcpy (&hdr, page_buf, sizeof (hdr));
+
+        if (hdr.magic == LOG_MAGIC && hdr.crc == flash_header_crc (&hdr))
+        {
+            sector_is_used[sector] = 1;
+            seqs[sector] = hdr.seq;
+
+            for (idx = n_valid; idx > 0 && seqs[order[idx - 1]] > hdr.seq; idx--)       // sort by sequence number
+            {
+                order[idx] = order[idx - 1];
+            }
+
+            order[idx] = sector;
+            n_valid++;
+        }
+        else
+        {
+            erased = flash_is_erased (page_buf, PAGESIZE);
+
+            for (page = 1; erased && page < PAGES_PER_SECTOR; page++)
+            {
+                w25qxx_read_page (page_buf, FLASH_LOG_FIRST_SECTOR + sector, page);
+                erased = flash_is_erased (page_buf, PAGESIZE);
+            }
+
+            if (erased)
+            {
+                sector_is_used[sector] = 0;
+            }
+            else                                                                        // incomplete header or erase
+            {
+                flash_erase (sector);
+            }
+        }
+    }
+
+    if (n_valid > 0)
     {
-        for (page = 0; page < PAGES_PER_SECTOR; page++)
+        for (idx = 0; idx < n_valid; idx++)
         {
-            w25qxx_read_page (cache + offset, sector, page);
-            offset += PAGESIZE;
+            sector      = order[idx];
+            head_record = flash_replay (sector);
         }
+
+        head_sector = order[n_valid - 1];
+        head_seq    = seqs[head_sector];
+
+        flash_compact ((head_sector + 1) % FLASH_LOG_SECTORS);                           // complete interrupted compaction
     }
+    else
+    {
+        head_sector = FLASH_LOG_SECTORS - 1;                                            // empty ring: first append opens sector 0
+        head_record = RECORDS_PER_SECTOR;
+        head_seq    = 0;
+    }
+
+    flash_read_old_format ();
 }
 
 #endif // BLACK_BOARD
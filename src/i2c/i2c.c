@@ -10,6 +10,10 @@
  *  | SDA  | I2C3  PC9        | I2C1  PB9     | I2C1  PB7     |
  *  +------+------------------+---------------+---------------+
  *
+ * i2c_read() and i2c_write() poll the event flags and block. They are used by the init routines.
+ * i2c_submit() queues a transaction which is processed by the I2C event and error interrupts,
+ * i2c_poll() - called in main loop - resets the bus if a transaction hangs.
+ *
  * Copyright (c) 2014-2026 Frank Meyer - frank(at)uclock.de
  *
  * This program is free software; you can redistribute it and/or modify
@@ -22,8 +26,11 @@
 #include "delay.h"
 #include "io.h"
 #include "log.h"
+#include "timer.h"
 
 #define I2C_TIMEOUT         5                                       // timeout: 5 msec
+#define I2C_ACK_POLL_LOOPS  10000                                   // max. loops waiting for ACK/NACK of slave address
+#define I2C_ASYNC_TIMEOUT   20                                      // timeout of async transaction: 20 msec
 
 #if defined (BLACK_BOARD)
 
@@ -39,6 +46,10 @@
 
 #define I2C_CHANNEL         I2C1
 #define RCC_PERIPH_I2C      RCC_APB1Periph_I2C1
+#define I2C_EV_IRQ          I2C1_EV_IRQn
+#define I2C_ER_IRQ          I2C1_ER_IRQn
+#define I2C_EV_IRQ_HANDLER  I2C1_EV_IRQHandler
+#define I2C_ER_IRQ_HANDLER  I2C1_ER_IRQHandler
 #define GPIO_AF_I2C         GPIO_AF_I2C1
 
 #elif defined (NUCLEO_BOARD)
@@ -55,6 +66,10 @@
 
 #define I2C_CHANNEL         I2C3
 #define RCC_PERIPH_I2C      RCC_APB1Periph_I2C3
+#define I2C_EV_IRQ          I2C3_EV_IRQn
+#define I2C_ER_IRQ          I2C3_ER_IRQn
+#define I2C_EV_IRQ_HANDLER  I2C3_EV_IRQHandler
+#define I2C_ER_IRQ_HANDLER  I2C3_ER_IRQHandler
 #define GPIO_AF_I2C         GPIO_AF_I2C3
 
 #elif defined (BLACKPILL_BOARD)
@@ -71,6 +86,10 @@
 
 #define I2C_CHANNEL         I2C1
 #define RCC_PERIPH_I2C      RCC_APB1Periph_I2C1
+#define I2C_EV_IRQ          I2C1_EV_IRQn
+#define I2C_ER_IRQ          I2C1_ER_IRQn
+#define I2C_EV_IRQ_HANDLER  I2C1_EV_IRQHandler
+#define I2C_ER_IRQ_HANDLER  I2C1_ER_IRQHandler
 #define GPIO_AF_I2C         GPIO_AF_I2C1
 
 #elif defined (BLUEPILL_BOARD)
@@ -84,13 +103,32 @@
 
 #define I2C_CHANNEL         I2C1
 #define RCC_PERIPH_I2C      RCC_APB1Periph_I2C1
+#define I2C_EV_IRQ          I2C1_EV_IRQn
+#define I2C_ER_IRQ          I2C1_ER_IRQn
+#define I2C_EV_IRQ_HANDLER  I2C1_EV_IRQHandler
+#define I2C_ER_IRQ_HANDLER  I2C1_ER_IRQHandler
 
 #else
 #error STM32 undefined
 #endif
 
+#define I2C_STATE_IDLE      0                                       // async state machine
+#define I2C_STATE_START     1                                       // START sent, waiting for SB
+#define I2C_STATE_TX        2                                       // sending address & data bytes
+#define I2C_STATE_RESTART   3                                       // repeated START sent, waiting for SB
+#define I2C_STATE_RX        4                                       // receiving data bytes
+#define I2C_STATE_STOP      5                                       // STOP of last transaction pending, i2c_poll() starts next one
+
 static uint32_t             i2c_clockspeed;
 
+static I2C_TRANSACTION *    i2c_queue_head;                         // running transaction
+static I2C_TRANSACTION *    i2c_queue_tail;
+static volatile uint_fast8_t i2c_state;
+static uint_fast8_t         i2c_tx_idx;                             // index of next byte to send: address bytes, then data bytes
+static uint_fast8_t         i2c_n_addr_bytes;
+static uint_fast16_t        i2c_rx_idx;                             // index of next byte to receive
+static uint32_t             i2c_start_ticks;                        // timer tick of transaction start
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * init i2c bus
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -296,21 +334,14 @@ i2c_reset_bus (void)
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * initialize I2C
+ * INTERN: reset bus, initialize GPIOs, I2C and NVIC
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-void
-i2c_init (uint32_t clockspeed)
+static void
+i2c_setup (void)
 {
-    static uint32_t     last_clockspeed;
     GPIO_InitTypeDef    gpio;
-
-    if (last_clockspeed == clockspeed)                              // if already called with same clockspeed, return
-    {
-        return;
-    }
-
-    last_clockspeed = clockspeed;
+    NVIC_InitTypeDef    nvic;
 
     I2C_DeInit(I2C_CHANNEL);
 
@@ -359,8 +390,323 @@ i2c_init (uint32_t clockspeed)
 #error STM32 undefined
 #endif
 
-    i2c_clockspeed = clockspeed;
     i2c_init_i2c ();
+
+    nvic.NVIC_IRQChannelPreemptionPriority  = 0;
+    nvic.NVIC_IRQChannelSubPriority         = 0;
+    nvic.NVIC_IRQChannelCmd                 = ENABLE;
+
+    nvic.NVIC_IRQChannel                    = I2C_EV_IRQ;
+    NVIC_Init(&nvic);
+
+    nvic.NVIC_IRQChannel                    = I2C_ER_IRQ;
+    NVIC_Init(&nvic);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * initialize I2C
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+i2c_init (uint32_t clockspeed)
+{
+    static uint32_t     last_clockspeed;
+
+    if (last_clockspeed == clockspeed)                              // if already called with same clockspeed, return
+    {
+        return;
+    }
+
+    last_clockspeed = clockspeed;
+    i2c_clockspeed  = clockspeed;
+    i2c_setup ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: start next queued transaction, call with I2C interrupts disabled or from ISR
+ *
+ * If the STOP of the last transaction is not sent yet, the ISR does not wait for it: there is no interrupt for
+ * the end of STOP in master mode, so the next transaction is started by i2c_poll() in the main loop.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+i2c_start_next (void)
+{
+    I2C_TRANSACTION *   t = i2c_queue_head;
+
+    if (t)
+    {
+        i2c_start_ticks = timer_ticks;
+
+        if (I2C_CHANNEL->CR1 & I2C_CR1_STOP)                                        // STOP of last transaction not sent yet
+        {
+            i2c_state = I2C_STATE_STOP;
+            return;
+        }
+
+        i2c_n_addr_bytes    = t->is_16_bit_addr ? 2 : 1;
+        i2c_tx_idx          = 0;
+        i2c_rx_idx          = 0;
+        i2c_state           = I2C_STATE_START;
+
+        I2C_AcknowledgeConfig(I2C_CHANNEL, ENABLE);
+        I2C_ITConfig(I2C_CHANNEL, I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR, ENABLE);
+        I2C_GenerateSTART(I2C_CHANNEL, ENABLE);
+    }
+    else
+    {
+        i2c_state = I2C_STATE_IDLE;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: finish running transaction, call callback and start next one
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+i2c_complete (int_fast16_t status)
+{
+    I2C_TRANSACTION *   t = i2c_queue_head;
+
+    I2C_ITConfig(I2C_CHANNEL, I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR, DISABLE);
+    I2C_AcknowledgeConfig(I2C_CHANNEL, ENABLE);
+
+    i2c_queue_head = t->next;
+
+    if (! i2c_queue_head)
+    {
+        i2c_queue_tail = (I2C_TRANSACTION *) 0;
+    }
+
+    t->next     = (I2C_TRANSACTION *) 0;
+    t->status   = status;
+
+    if (t->callback)
+    {
+        (*t->callback) (t);
+    }
+
+    i2c_start_next ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * I2C event interrupt
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void I2C_EV_IRQ_HANDLER (void);
+
+void
+I2C_EV_IRQ_HANDLER (void)
+{
+    I2C_TRANSACTION *   t = i2c_queue_head;
+    uint16_t            sr1;
+    uint8_t             value;
+
+    sr1 = I2C_CHANNEL->SR1;
+
+    if (! t)
+    {
+        I2C_ITConfig(I2C_CHANNEL, I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR, DISABLE);
+        return;
+    }
+
+    if (sr1 & I2C_SR1_SB)                                                           // START sent
+    {
+        if (i2c_state == I2C_STATE_RESTART)
+        {
+            i2c_state = I2C_STATE_RX;
+            I2C_Send7bitAddress(I2C_CHANNEL, t->slave_addr, I2C_Direction_Receiver);
+        }
+        else
+        {
+            i2c_state = I2C_STATE_TX;
+            I2C_Send7bitAddress(I2C_CHANNEL, t->slave_addr, I2C_Direction_Transmitter);
+        }
+    }
+    else if (sr1 & I2C_SR1_ADDR)                                                    // slave address acknowledged
+    {
+        if (i2c_state == I2C_STATE_RX && t->cnt == 1)
+        {
+            I2C_AcknowledgeConfig(I2C_CHANNEL, DISABLE);                            // NACK for the only byte
+            (void) I2C_CHANNEL->SR2;                                                // clear ADDR flag
+            I2C_GenerateSTOP(I2C_CHANNEL, ENABLE);
+        }
+        else
+        {
+            (void) I2C_CHANNEL->SR2;                                                // clear ADDR flag
+        }
+
+        if (i2c_state == I2C_STATE_RX)
+        {
+            I2C_ITConfig(I2C_CHANNEL, I2C_IT_BUF, ENABLE);
+        }
+    }
+    else if (i2c_state == I2C_STATE_RX)
+    {
+        if (sr1 & I2C_SR1_RXNE)
+        {
+            t->data[i2c_rx_idx++] = I2C_ReceiveData(I2C_CHANNEL);
+
+            if (t->cnt - i2c_rx_idx == 1)                                           // last byte follows: NACK and STOP
+            {
+                I2C_AcknowledgeConfig(I2C_CHANNEL, DISABLE);
+                I2C_GenerateSTOP(I2C_CHANNEL, ENABLE);
+            }
+            else if (i2c_rx_idx == t->cnt)
+            {
+                i2c_complete (I2C_OK);
+            }
+        }
+    }
+    else if (i2c_state == I2C_STATE_TX)
+    {
+        if (i2c_tx_idx < i2c_n_addr_bytes + (t->is_read ? 0 : t->cnt))
+        {
+            if (sr1 & I2C_SR1_TXE)
+            {
+                if (i2c_tx_idx < i2c_n_addr_bytes)                                  // address bytes, MSB first
+                {
+                    value = (i2c_n_addr_bytes - i2c_tx_idx == 2) ? (t->addr >> 8) : (t->addr & 0xFF);
+                }
+                else
+                {
+                    value = t->data[i2c_tx_idx - i2c_n_addr_bytes];
+                }
+
+                I2C_SendData(I2C_CHANNEL, value);
+                i2c_tx_idx++;
+
+                if (i2c_tx_idx == i2c_n_addr_bytes + (t->is_read ? 0 : t->cnt))
+                {
+                    I2C_ITConfig(I2C_CHANNEL, I2C_IT_BUF, DISABLE);                 // last byte: wait for BTF only
+                }
+            }
+        }
+        else if (sr1 & I2C_SR1_BTF)                                                 // all bytes sent
+        {
+            if (t->is_read)
+            {
+                i2c_state = I2C_STATE_RESTART;
+                I2C_GenerateSTART(I2C_CHANNEL, ENABLE);                             // repeated START
+            }
+            else
+            {
+                I2C_GenerateSTOP(I2C_CHANNEL, ENABLE);
+                i2c_complete (I2C_OK);
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * I2C error interrupt: bus error, arbitration lost, NACK, overrun
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void I2C_ER_IRQ_HANDLER (void);
+
+void
+I2C_ER_IRQ_HANDLER (void)
+{
+    I2C_CHANNEL->SR1 &= ~(I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT);   // clear error flags
+
+    if (i2c_queue_head)
+    {
+        I2C_GenerateSTOP(I2C_CHANNEL, ENABLE);
+        i2c_complete (I2C_ERROR_BUS);
+    }
+    else
+    {
+        I2C_ITConfig(I2C_CHANNEL, I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR, DISABLE);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * queue transaction, returns 0 if transaction is already queued
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+i2c_submit (I2C_TRANSACTION * t)
+{
+    uint_fast8_t    rtc = 0;
+
+    __disable_irq();
+
+    if (t->status != I2C_PENDING)
+    {
+        t->next     = (I2C_TRANSACTION *) 0;
+        t->status   = I2C_PENDING;
+
+        if (i2c_queue_tail)
+        {
+            i2c_queue_tail->next = t;
+            i2c_queue_tail = t;
+        }
+        else
+        {
+            i2c_queue_head = t;
+            i2c_queue_tail = t;
+            i2c_start_next ();
+        }
+
+        rtc = 1;
+    }
+
+    __enable_irq();
+
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start transaction deferred by pending STOP, check running transaction for timeout, call in main loop.
+ * A hanging bus is reset, see i2c_reset_bus()
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+i2c_poll (void)
+{
+    if (i2c_state == I2C_STATE_STOP && ! (I2C_CHANNEL->CR1 & I2C_CR1_STOP))
+    {
+        __disable_irq();                                                            // same as in i2c_submit()
+
+        if (i2c_state == I2C_STATE_STOP)
+        {
+            i2c_start_next ();
+        }
+
+        __enable_irq();
+    }
+
+    if (i2c_queue_head && timer_ticks - i2c_start_ticks > TIMER_MSEC_TO_TICKS(I2C_ASYNC_TIMEOUT))
+    {
+        NVIC_DisableIRQ (I2C_EV_IRQ);
+        NVIC_DisableIRQ (I2C_ER_IRQ);
+
+        if (i2c_queue_head && timer_ticks - i2c_start_ticks > TIMER_MSEC_TO_TICKS(I2C_ASYNC_TIMEOUT))
+        {
+            log_message ("i2c: timeout, resetting bus");
+            I2C_ITConfig(I2C_CHANNEL, I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR, DISABLE);
+            i2c_setup ();                                                           // reset bus and I2C, enables I2C IRQs again
+            i2c_complete (I2C_ERROR_TIMEOUT);                                       // starts next transaction
+        }
+        else
+        {
+            NVIC_EnableIRQ (I2C_EV_IRQ);
+            NVIC_EnableIRQ (I2C_ER_IRQ);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: wait until all queued transactions are finished, used by the blocking functions
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+i2c_wait_idle (void)
+{
+    while (i2c_queue_head)
+    {
+        i2c_poll ();
+    }
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
@@ -377,6 +723,8 @@ i2c_read (uint_fast8_t slave_addr, uint_fast16_t addr, uint_fast8_t is_16_bit_ad
     uint_fast16_t   n;
     int_fast16_t    rtc;
 
+    i2c_wait_idle ();
+
     if ((rtc = i2c_send_address (slave_addr, addr, is_16_bit_addr, cnt == 1 ? 1 : 0)) != I2C_OK)
     {
         return rtc;
@@ -445,6 +793,8 @@ i2c_write (uint_fast8_t slave_addr, uint_fast16_t addr, uint_fast8_t is_16_bit_a
     uint_fast16_t   n;
     int_fast16_t    rtc;
 
+    i2c_wait_idle ();
+
     if ((rtc = i2c_send_address (slave_addr, addr, is_16_bit_addr, 0)) != I2C_OK)
     {
         return rtc;
@@ -476,3 +826,63 @@ i2c_write (uint_fast8_t slave_addr, uint_fast16_t addr, uint_fast8_t is_16_bit_a
 
     return I2C_OK;
 }
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * ACK polling: check if slave acknowledges its address, e.g. EEPROM has finished its internal write cycle
+ *
+ * return values:
+ * ==  0 I2C_OK, slave sent ACK
+ *  <  0 Error or NACK
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+int_fast16_t
+i2c_ack_poll (uint_fast8_t slave_addr)
+{
+    uint32_t        loops;
+    int_fast16_t    rtc;
+
+    i2c_wait_idle ();
+
+    I2C_GenerateSTART(I2C_CHANNEL, ENABLE);
+
+    if (! i2c_wait_for_flags (I2C_FLAG_SB, 0))
+    {
+        return I2C_ERROR_NO_FLAG_SB;
+    }
+
+    I2C_Send7bitAddress(I2C_CHANNEL, slave_addr, I2C_Direction_Transmitter);        // send slave address (transmitter)
+
+    for (loops = 0; loops < I2C_ACK_POLL_LOOPS; loops++)
+    {
+        if (I2C_GetFlagStatus(I2C_CHANNEL, I2C_FLAG_ADDR) || I2C_GetFlagStatus(I2C_CHANNEL, I2C_FLAG_AF))
+        {
+            break;
+        }
+    }
+
+    if (loops == I2C_ACK_POLL_LOOPS)
+    {
+        i2c_handle_timeout ();
+        return I2C_ERROR_NO_FLAG_ADDR;
+    }
+
+    if (I2C_GetFlagStatus(I2C_CHANNEL, I2C_FLAG_ADDR))                             // ACK
+    {
+        I2C_CHANNEL->SR2;                                                          // clear ADDR flag
+        rtc = I2C_OK;
+    }
+    else                                                                            // NACK: slave busy
+    {
+        I2C_ClearFlag(I2C_CHANNEL, I2C_FLAG_AF);
+        rtc = I2C_ERROR_NO_FLAG_ADDR;
+    }
+
+    I2C_GenerateSTOP(I2C_CHANNEL, ENABLE);                                          // stop sequence
+
+    while (I2C_GetFlagStatus(I2C_CHANNEL, I2C_FLAG_BUSY))
+    {
+        ;
+    }
+
+    return rtc;
+}
@@ -32,9 +32,35 @@
 #define I2C_ERROR_NO_FLAG_SB2   (-5)
 #define I2C_ERROR_NO_FLAG_ADDR2 (-6)
 #define I2C_ERROR_NO_FLAG_RXNE  (-7)
+#define I2C_ERROR_BUS           (-8)                            // async: bus error, arbitration lost, NACK or overrun
+#define I2C_ERROR_TIMEOUT       (-9)                            // async: transaction not finished in time, bus has been reset
+#define I2C_PENDING             (1)                             // async: transaction queued or running
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * asynchronous transaction, processed by I2C event/error interrupts
+ *
+ * The callback is called in interrupt context when the transaction has finished, status is then I2C_OK or an error.
+ * data must stay valid until then.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+typedef struct i2c_transaction
+{
+    struct i2c_transaction *            next;                   // next queued transaction
+    uint8_t                             slave_addr;             // I2C address << 1
+    uint8_t                             is_16_bit_addr;         // 1: send 2 address bytes
+    uint8_t                             is_read;                // 1: read, 0: write
+    uint16_t                            addr;                   // register or memory address
+    uint8_t *                           data;
+    uint16_t                            cnt;
+    volatile int_fast16_t               status;                 // I2C_PENDING, I2C_OK or error
+    void                                (*callback) (struct i2c_transaction *);
+} I2C_TRANSACTION;
 
 void            i2c_init  (uint32_t);
 int_fast16_t    i2c_read  (uint_fast8_t, uint_fast16_t, uint_fast8_t, uint8_t *, uint_fast16_t);
 int_fast16_t    i2c_write (uint_fast8_t, uint_fast16_t, uint_fast8_t, uint8_t *, uint_fast16_t);
+int_fast16_t    i2c_ack_poll (uint_fast8_t);
+uint_fast8_t    i2c_submit (I2C_TRANSACTION *);
+void            i2c_poll (void);
 
 #endif
@@ -0,0 +1,345 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * ircapture.c - IR edge capture front-end for IRMP
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * Instead of sampling the IR pin F_INTERRUPTS times per second, every edge of the IR signal triggers an EXTI interrupt
+ * which stores the count of a free running 1 MHz timer and the new pin level into a ring buffer. A NEC frame causes
+ * 68 interrupts instead of about 1000 timer interrupts, silence costs nothing.
+ *
+ * ircapture_poll() is called by irmp_get_data() in the main loop. It replays the captured pulse widths in units of
+ * 1/F_INTERRUPTS by calling irmp_ISR() with ircapture_level set accordingly, so the IRMP decoders run unchanged.
+ * After IRCAPTURE_MAX_SILENCE_US of idle level no more ticks are fed, IRMP has finished its frame long before.
+ *
+ * None of the IR pins is connected to a timer channel which is free for a real input capture, therefore the
+ * timestamps are taken in the EXTI ISR. It has the highest priority, so the jitter is below 1 usec.
+ *
+ * The ISR stores the time since the previous edge, not the absolute timestamp. The 16 bit counter wraps after 65 msec,
+ * so longer pauses (detected via timer_ticks) are stored as IRCAPTURE_LONG_PAUSE. Thus a stalled main loop does not
+ * invalidate the buffered edges, they are replayed late but complete. The ring holds several frames; if it is full
+ * nevertheless, the edge is dropped and counted in ircapture_overruns, see ircapture_log_stats().
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#if defined (STM32F10X)
+#  include "stm32f10x.h"
+#  include "stm32f10x_gpio.h"
+#  include "stm32f10x_rcc.h"
+#  include "stm32f10x_tim.h"
+#  include "stm32f10x_exti.h"
+#  include "misc.h"
+#elif defined (STM32F4XX)
+#  include "stm32f4xx.h"
+#  include "stm32f4xx_gpio.h"
+#  include "stm32f4xx_rcc.h"
+#  include "stm32f4xx_tim.h"
+#  include "stm32f4xx_exti.h"
+#  include "stm32f4xx_syscfg.h"
+#  include "misc.h"
+#endif
+
+#include "irmp.h"
+#include "profile.h"
+#include "timer.h"
+#include "log.h"
+#include "ircapture.h"
+
+#if IRMP_USE_INPUT_CAPTURE == 1
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timestamp timer (APB1) and EXTI line of IR pin, see irmpconfig.h
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#if defined (NUCLEO_BOARD)                                              // IR pin PC10
+#  if defined (STM32F401RE)
+#    define IRCAPTURE_TIM_CLK           84000000L                       // 84 MHz
+#  elif defined (STM32F411RE)
+#    define IRCAPTURE_TIM_CLK           100000000L                      // 100 MHz
+#  elif defined (STM32F446RE)
+#    define IRCAPTURE_TIM_CLK           90000000L                       // 90 MHz
+#  else
+#    error STM32 unknown
+#  endif
+#  define IRCAPTURE_EXTI_PORTSOURCE     EXTI_PortSourceGPIOC
+#  define IRCAPTURE_EXTI_PINSOURCE      EXTI_PinSource10
+#  define IRCAPTURE_EXTI_LINE           EXTI_Line10
+#  define IRCAPTURE_EXTI_IRQn           EXTI15_10_IRQn
+#  define IRCAPTURE_EXTI_IRQHandler     EXTI15_10_IRQHandler
+
+#elif defined (BLACK_BOARD)                                             // IR pin PC1
+#  define IRCAPTURE_TIM_CLK             84000000L                       // 84 MHz
+#  define IRCAPTURE_EXTI_PORTSOURCE     EXTI_PortSourceGPIOC
+#  define IRCAPTURE_EXTI_PINSOURCE      EXTI_PinSource1
+#  define IRCAPTURE_EXTI_LINE           EXTI_Line1
+#  define IRCAPTURE_EXTI_IRQn           EXTI1_IRQn
+#  define IRCAPTURE_EXTI_IRQHandler     EXTI1_IRQHandler
+
+#elif defined (BLACKPILL_BOARD)                                         // IR pin PB4
+#  if defined (STM32F401CC)
+#    define IRCAPTURE_TIM_CLK           84000000L                       // 84 MHz
+#  elif defined (STM32F411CE)
+#    define IRCAPTURE_TIM_CLK           100000000L                      // 100 MHz
+#  else
+#    error STM32 unknown
+#  endif
+#  define IRCAPTURE_EXTI_PORTSOURCE     EXTI_PortSourceGPIOB
+#  define IRCAPTURE_EXTI_PINSOURCE      EXTI_PinSource4
+#  define IRCAPTURE_EXTI_LINE           EXTI_Line4
+#  define IRCAPTURE_EXTI_IRQn           EXTI4_IRQn
+#  define IRCAPTURE_EXTI_IRQHandler     EXTI4_IRQHandler
+
+#elif defined (BLUEPILL_BOARD)                                          // IR pin PB3
+#  define IRCAPTURE_TIM_CLK             72000000L                       // 72 MHz
+#  define IRCAPTURE_EXTI_PORTSOURCE     GPIO_PortSourceGPIOB
+#  define IRCAPTURE_EXTI_PINSOURCE      GPIO_PinSource3
+#  define IRCAPTURE_EXTI_LINE           EXTI_Line3
+#  define IRCAPTURE_EXTI_IRQn           EXTI3_IRQn
+#  define IRCAPTURE_EXTI_IRQHandler     EXTI3_IRQHandler
+
+#else
+#  error STM32 unknown
+#endif
+
+#if defined (STM32F10X)                                                 // TIM1 WS2812, TIM2 tick, TIM4 beeper
+#  define IRCAPTURE_TIM                 TIM3
+#  define IRCAPTURE_TIM_CLOCK           RCC_APB1Periph_TIM3
+#else                                                                   // TIM5 is unused on all STM32F4 boards
+#  define IRCAPTURE_TIM                 TIM5
+#  define IRCAPTURE_TIM_CLOCK           RCC_APB1Periph_TIM5
+#endif
+
+#if defined (STM32F10X)
+#  define IRCAPTURE_RING_LEN            256                             // must be power of 2, NEC frame: 68 edges
+#else
+#  define IRCAPTURE_RING_LEN            512                             // about 7 NEC frames or 1/2 sec of a stalled main loop
+#endif
+#define IRCAPTURE_MAX_SILENCE_US        200000UL                        // feed max. 200 msec of idle level to IRMP
+#define IRCAPTURE_LONG_PAUSE            0xFFFF                          // pause >= 60 msec, 16 bit counter may have wrapped
+#define IRCAPTURE_LONG_PAUSE_TICKS      TIMER_MSEC_TO_TICKS(60)
+#define IRCAPTURE_USEC_PER_TICK         (1000000UL / TIMER_TICKS_PER_SEC)
+
+typedef struct
+{
+    uint16_t                    usec;                                   // time since previous edge
+    uint8_t                     level;                                  // pin level after edge
+} IRCAPTURE_EDGE;
+
+uint_fast8_t                    ircapture_level = 1;                    // replayed level, read by irmp_ISR() via input()
+uint32_t                        ircapture_overruns;                     // edges dropped because ring was full
+
+static IRCAPTURE_EDGE           ircapture_ring[IRCAPTURE_RING_LEN];
+static volatile uint_fast16_t   ircapture_head;                         // written only by ISR
+static volatile uint_fast16_t   ircapture_tail;                         // written only by ircapture_poll()
+static uint16_t                 ircapture_edge_cnt;                     // counter value of last stored edge, written only by ISR
+static uint32_t                 ircapture_edge_ticks;                   // timer_ticks of last stored edge, written only by ISR
+static uint32_t                 ircapture_fed_us;                       // time fed to IRMP since last replayed edge
+static uint32_t                 ircapture_frac;                         // remainder of usec -> IRMP ticks, in usec * F_INTERRUPTS
+static uint32_t                 ircapture_silence_us;                   // idle level fed since last edge
+
+#define IRCAPTURE_PIN_LEVEL()   ((IRMP_PORT->IDR & IRMP_BIT) ? 1 : 0)
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * EXTI IRQ handler: store timestamp and new level of IR pin
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+extern void IRCAPTURE_EXTI_IRQHandler (void);                           // keep compiler happy
+
+void
+IRCAPTURE_EXTI_IRQHandler (void)
+{
+    uint16_t        cnt = IRCAPTURE_TIM->CNT;                           // read counter first
+    uint_fast16_t   next;
+
+    if (EXTI_GetITStatus (IRCAPTURE_EXTI_LINE) != RESET)
+    {
+        EXTI_ClearITPendingBit (IRCAPTURE_EXTI_LINE);
+
+        next = (ircapture_head + 1) & (IRCAPTURE_RING_LEN - 1);
+
+        if (next != ircapture_tail)
+        {
+            if (timer_ticks - ircapture_edge_ticks >= IRCAPTURE_LONG_PAUSE_TICKS)
+            {
+                ircapture_ring[ircapture_head].usec = IRCAPTURE_LONG_PAUSE;
+            }
+            else
+            {
+                ircapture_ring[ircapture_head].usec = cnt - ircapture_edge_cnt;
+            }
+
+            ircapture_ring[ircapture_head].level = IRCAPTURE_PIN_LEVEL();
+            ircapture_edge_cnt      = cnt;
+            ircapture_edge_ticks    = timer_ticks;
+            __DMB();                                                    // edge must be visible before head is moved
+            ircapture_head = next;
+        }
+        else                                                            // ring full: drop edge, IRMP will drop the frame
+        {
+            ircapture_overruns++;
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: call irmp_ISR() for usec of current level
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+ircapture_feed (uint32_t usec)
+{
+    uint32_t    n;
+
+    if (usec > IRCAPTURE_MAX_SILENCE_US)                                // longer pulses or pauses make no difference to IRMP
+    {
+        usec = IRCAPTURE_MAX_SILENCE_US;
+    }
+
+    if (ircapture_level)                                                // idle level, TSOP output is active low
+    {
+        if (ircapture_silence_us >= IRCAPTURE_MAX_SILENCE_US)           // IRMP has finished long ago
+        {
+            return;
+        }
+
+        ircapture_silence_us += usec;
+    }
+
+    ircapture_frac += usec * F_INTERRUPTS;                              // max. 200000 * 20000 + 999999, fits into 32 bit
+    n = ircapture_frac / 1000000UL;
+    ircapture_frac -= n * 1000000UL;
+
+    while (n--)
+    {
+        PROFILE_START(PROFILE_IRMP_ISR);
+        (void) irmp_ISR ();
+        PROFILE_STOP(PROFILE_IRMP_ISR);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * replay captured edges to IRMP, called by irmp_get_data()
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+ircapture_poll (void)
+{
+    IRCAPTURE_EDGE *    e;
+    uint_fast16_t       head;
+    uint32_t            usec;
+    uint32_t            since_edge;
+
+    __disable_irq();                                                    // consistent snapshot of ISR state
+    head = ircapture_head;
+
+    if (timer_ticks - ircapture_edge_ticks >= IRCAPTURE_LONG_PAUSE_TICKS)
+    {
+        since_edge = (timer_ticks - ircapture_edge_ticks) * IRCAPTURE_USEC_PER_TICK;
+    }
+    else
+    {
+        since_edge = (uint16_t) (IRCAPTURE_TIM->CNT - ircapture_edge_cnt);
+    }
+    __enable_irq();
+
+    __DMB();                                                            // read edges after head
+
+    while (ircapture_tail != head)
+    {
+        e = &ircapture_ring[ircapture_tail];
+
+        usec = (e->usec == IRCAPTURE_LONG_PAUSE) ? IRCAPTURE_MAX_SILENCE_US : e->usec;
+
+        if (usec > ircapture_fed_us)                                    // rest of pulse or pause before this edge
+        {
+            ircapture_feed (usec - ircapture_fed_us);
+        }
+
+        ircapture_fed_us = 0;
+
+        if (ircapture_level != e->level)
+        {
+            ircapture_level         = e->level;
+            ircapture_silence_us    = 0;
+        }
+
+        ircapture_tail = (ircapture_tail + 1) & (IRCAPTURE_RING_LEN - 1);
+    }
+
+    if (since_edge > ircapture_fed_us)                                  // level has not changed since last edge
+    {
+        ircapture_feed (since_edge - ircapture_fed_us);
+        ircapture_fed_us = since_edge;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reset statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+ircapture_reset_stats (void)
+{
+    ircapture_overruns = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+ircapture_log_stats (void)
+{
+    log_printf ("ircapture: %lu edges dropped, ring of %u edges was full\r\n", ircapture_overruns, IRCAPTURE_RING_LEN);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * initialize timestamp timer and EXTI interrupt of IR pin, call after irmp_init()
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+ircapture_init (void)
+{
+    TIM_TimeBaseInitTypeDef     tim;
+    EXTI_InitTypeDef            exti;
+    NVIC_InitTypeDef            nvic;
+
+    TIM_TimeBaseStructInit (&tim);
+    RCC_APB1PeriphClockCmd (IRCAPTURE_TIM_CLOCK, ENABLE);
+
+    tim.TIM_ClockDivision   = TIM_CKD_DIV1;
+    tim.TIM_CounterMode     = TIM_CounterMode_Up;
+    tim.TIM_Period          = 0xFFFF;                                   // free running, 16 bit also on 32 bit TIM5
+    tim.TIM_Prescaler       = IRCAPTURE_TIM_CLK / 1000000L - 1;         // 1 MHz
+    TIM_TimeBaseInit (IRCAPTURE_TIM, &tim);
+    TIM_Cmd(IRCAPTURE_TIM, ENABLE);
+
+    ircapture_edge_cnt      = IRCAPTURE_TIM->CNT;
+    ircapture_edge_ticks    = timer_ticks;
+    ircapture_level         = IRCAPTURE_PIN_LEVEL();
+
+#if defined (STM32F10X)
+    RCC_APB2PeriphClockCmd (RCC_APB2Periph_AFIO, ENABLE);
+    GPIO_EXTILineConfig (IRCAPTURE_EXTI_PORTSOURCE, IRCAPTURE_EXTI_PINSOURCE);
+#elif defined (STM32F4XX)
+    RCC_APB2PeriphClockCmd (RCC_APB2Periph_SYSCFG, ENABLE);
+    SYSCFG_EXTILineConfig (IRCAPTURE_EXTI_PORTSOURCE, IRCAPTURE_EXTI_PINSOURCE);
+#endif
+
+    exti.EXTI_Line                          = IRCAPTURE_EXTI_LINE;
+    exti.EXTI_LineCmd                       = ENABLE;
+    exti.EXTI_Mode                          = EXTI_Mode_Interrupt;
+    exti.EXTI_Trigger                       = EXTI_Trigger_Rising_Falling;
+    EXTI_Init (&exti);
+
+    nvic.NVIC_IRQChannel                    = IRCAPTURE_EXTI_IRQn;
+    nvic.NVIC_IRQChannelPreemptionPriority  = 0x00;                     // short ISR, timestamp must not be delayed
+    nvic.NVIC_IRQChannelSubPriority         = 0x00;
+    nvic.NVIC_IRQChannelCmd                 = ENABLE;
+    NVIC_Init (&nvic);
+}
+
+#endif // IRMP_USE_INPUT_CAPTURE == 1
@@ -0,0 +1,25 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * ircapture.h - IR edge capture front-end for IRMP
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef IRCAPTURE_H
+#define IRCAPTURE_H
+
+#include <stdint.h>
+
+extern uint_fast8_t                     ircapture_level;
+extern uint32_t                         ircapture_overruns;
+
+extern void                             ircapture_poll (void);
+extern void                             ircapture_reset_stats (void);
+extern void                             ircapture_log_stats (void);
+extern void                             ircapture_init (void);
+
+#endif // IRCAPTURE_H
@@ -465,6 +465,7 @@
 #define AUTO_FRAME_REPETITION_LEN               (uint_fast16_t)(F_INTERRUPTS * AUTO_FRAME_REPETITION_TIME + 0.5)       // use uint_fast16_t!
 
 #ifdef ANALYZE
+#  include <time.h>
 #  define ANALYZE_PUTCHAR(a)                    { if (! silent)             { putchar (a);          } }
 #  define ANALYZE_ONLY_NORMAL_PUTCHAR(a)        { if (! silent && !verbose) { putchar (a);          } }
 #  define ANALYZE_PRINTF(...)                   { if (verbose)              { printf (__VA_ARGS__); } }
@@ -1829,6 +1830,10 @@ irmp_get_data (IRMP_DATA * irmp_data_p)
 {
     uint_fast8_t   rtc = FALSE;
 
+#if IRMP_USE_INPUT_CAPTURE == 1
+    ircapture_poll ();                                                  // replay captured IR edges first
+#endif
+
     if (irmp_ir_detected)
     {
         switch (irmp_protocol)
@@ -4749,17 +4754,39 @@ static int         expected_address;
 static int         expected_command;
 static int         do_check_expected_values;
 
+static int         statistics = FALSE;                                      // -t: print statistics at end
+static int         jitter;                                                  // -j: max. shift of each edge in ticks
+static int         noise;                                                   // -n: probability of a flipped sample in 1/1000
+static int         jitter_skip;                                             // samples to drop because edge has been shifted left
+static long        stat_lines;                                              // frames with expected values
+static long        stat_frames;                                             // decoded frames
+static long        stat_checked;                                            // decoded frames with expected values
+static long        stat_wrong;                                              // decoded frames with different values
+static long        stat_missed;                                             // frames with expected values, but not decoded
+static long        stat_isr_calls;                                          // calls of irmp_ISR()
+static double      stat_isr_nsec;                                           // time spent in irmp_ISR()
+
 static void
 next_tick (void)
 {
     if (! analyze && ! list)
     {
+        struct timespec start;
+        struct timespec stop;
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
         (void) irmp_ISR ();
+        clock_gettime (CLOCK_MONOTONIC, &stop);
+
+        stat_isr_nsec += (stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec);
+        stat_isr_calls++;
 
         if (irmp_get_data (&irmp_data))
         {
             uint_fast8_t key;
 
+            stat_frames++;
+
             ANALYZE_ONLY_NORMAL_PUTCHAR (' ');
 
             if (verbose)
@@ -4834,11 +4861,13 @@ next_tick (void)
                     irmp_data.address  != expected_address  ||
                     irmp_data.command  != expected_command)
                 {
+                    stat_wrong++;
                     printf ("\nerror 7: expected values differ: p=%2d (%s), a=0x%04x, c=0x%04x\n",
                             expected_protocol, irmp_protocol_names[expected_protocol], expected_address, expected_command);
                 }
                 else
                 {
+                    stat_checked++;
                     printf (" checked!\n");
                 }
                 do_check_expected_values = FALSE;                           // only check 1st frame in a line!
@@ -4851,6 +4880,112 @@ next_tick (void)
     }
 }
 
+/*---------------------------------------------------------------------------------------------------------------------------------------------------
+ * replay one sample of the scan, optionally with jitter and noise:
+ *
+ * - every edge is shifted by a random number of ticks in the range -jitter ... +jitter
+ * - every sample is inverted with a probability of noise/1000
+ *---------------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+replay_tick (int is_edge)
+{
+    uint_fast8_t    level = IRMP_PIN;
+    int             shift;
+
+    if (is_edge && jitter > 0)
+    {
+        shift       = rand () % (2 * jitter + 1) - jitter;
+        jitter_skip = 0;
+
+        if (shift > 0)                                                      // shift edge right: extend previous level
+        {
+            IRMP_PIN = ~level;
+
+            while (shift--)
+            {
+                next_tick ();
+            }
+
+            IRMP_PIN = level;
+        }
+        else
+        {
+            jitter_skip = -shift;                                           // shift edge left: shorten new level
+        }
+    }
+
+    if (jitter_skip > 0)
+    {
+        jitter_skip--;
+        return;
+    }
+
+    if (noise > 0 && rand () % 1000 < noise)
+    {
+        IRMP_PIN = ~level;
+        next_tick ();
+        IRMP_PIN = level;
+    }
+    else
+    {
+        next_tick ();
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------------------
+ * check if last frame with expected values has been decoded
+ *---------------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+check_missed_frame (void)
+{
+    if (do_check_expected_values)
+    {
+        stat_missed++;
+        do_check_expected_values = FALSE;
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------------------
+ * print statistics, see option -t
+ *---------------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+print_statistics (void)
+{
+    puts ("-------------------------------------------------------------------------------");
+    printf ("F_INTERRUPTS:       %d\n", F_INTERRUPTS);
+    printf ("jitter:             +/- %d ticks\n", jitter);
+    printf ("noise:              %d/1000\n", noise);
+    printf ("expected frames:    %ld\n", stat_lines);
+    printf ("decoded frames:     %ld\n", stat_frames);
+    printf ("checked frames:     %ld (%.1f%%)\n", stat_checked, stat_lines ? (100.0 * stat_checked) / stat_lines : 0.0);
+    printf ("wrong frames:       %ld (%.1f%%)\n", stat_wrong, stat_lines ? (100.0 * stat_wrong) / stat_lines : 0.0);
+    printf ("missed frames:      %ld (%.1f%%)\n", stat_missed, stat_lines ? (100.0 * stat_missed) / stat_lines : 0.0);
+    printf ("irmp_ISR() calls:   %ld, %.1f nsec per call\n", stat_isr_calls, stat_isr_calls ? stat_isr_nsec / stat_isr_calls : 0.0);
+}
+
+/*---------------------------------------------------------------------------------------------------------------------------------------------------
+ * main: read scan from stdin
+ *
+ * options:
+ *  -v          verbose
+ *  -l          list pulses and pauses
+ *  -a          analyze: print spectrum of pulses and pauses
+ *  -s          silent
+ *  -p          print timings of all protocols
+ *  -r          radio mode
+ *  -t          print statistics at end: decoded, wrong and missed frames, time per irmp_ISR() call
+ *  -j ticks    shift every edge by a random number of ticks in the range -ticks ... +ticks
+ *  -n permille invert every sample with a probability of permille/1000
+ *  -S seed     seed for random numbers of -j and -n
+ *
+ * Example:
+ *  cc -O2 -Isrc -Isrc/irmp src/irmp/irmp.c -o irmp
+ *  ./irmp -s -t -j 2 -n 5 < scan.txt
+ *---------------------------------------------------------------------------------------------------------------------------------------------------
+ */
 int
 main (int argc, char ** argv)
 {
@@ -4867,34 +5002,51 @@ main (int argc, char ** argv)
 
     int         first_pulse = TRUE;
     int         first_pause = TRUE;
+    int         is_edge;
 
-    if (argc == 2)
+    for (i = 1; i < argc; i++)
     {
-        if (! strcmp (argv[1], "-v"))
+        if (! strcmp (argv[i], "-v"))
         {
             verbose = TRUE;
         }
-        else if (! strcmp (argv[1], "-l"))
+        else if (! strcmp (argv[i], "-l"))
         {
             list = TRUE;
         }
-        else if (! strcmp (argv[1], "-a"))
+        else if (! strcmp (argv[i], "-a"))
         {
             analyze = TRUE;
         }
-        else if (! strcmp (argv[1], "-s"))
+        else if (! strcmp (argv[i], "-s"))
         {
             silent = TRUE;
         }
-        else if (! strcmp (argv[1], "-p"))
+        else if (! strcmp (argv[i], "-p"))
         {
             print_timings ();
             return (0);
         }
-        else if (! strcmp (argv[1], "-r"))
+        else if (! strcmp (argv[i], "-r"))
         {
             radio = TRUE;
         }
+        else if (! strcmp (argv[i], "-t"))
+        {
+            statistics = TRUE;
+        }
+        else if (! strcmp (argv[i], "-j") && i + 1 < argc)
+        {
+            jitter = atoi (argv[++i]);
+        }
+        else if (! strcmp (argv[i], "-n") && i + 1 < argc)
+        {
+            noise = atoi (argv[++i]);
+        }
+        else if (! strcmp (argv[i], "-S") && i + 1 < argc)
+        {
+            srand ((unsigned int) atoi (argv[++i]));
+        }
     }
 
     for (i = 0; i < 256; i++)
@@ -4909,8 +5061,12 @@ main (int argc, char ** argv)
 
     while ((ch = getchar ()) != EOF)
     {
+        is_edge = FALSE;
+
         if (ch == '_' || ch == '0')
         {
+            is_edge = (last_ch != ch);
+
             if (last_ch != ch)
             {
                 if (pause > 0)
@@ -4946,6 +5102,8 @@ main (int argc, char ** argv)
         }
         else if (ch == 0xaf || ch == '-' || ch == '1')
         {
+            is_edge = (last_ch != ch);
+
             if (last_ch != ch)
             {
                 if (list)
@@ -5015,6 +5173,8 @@ main (int argc, char ** argv)
                 char *          p;
                 int             idx = -1;
 
+                check_missed_frame ();
+
                 puts ("-------------------------------------------------------------------");
                 putchar (ch);
 
@@ -5077,6 +5237,7 @@ main (int argc, char ** argv)
                                         if (do_check_expected_values)
                                         {
                                             // printf ("!%2d %04x %04x!\n", expected_protocol, expected_address, expected_command);
+                                            stat_lines++;
                                         }
                                     }
                                 }
@@ -5096,9 +5257,11 @@ main (int argc, char ** argv)
 
         last_ch = ch;
 
-        next_tick ();
+        replay_tick (is_edge);
     }
 
+    check_missed_frame ();
+
     if (analyze)
     {
         print_spectrum ("START PULSES", start_pulses, TRUE);
@@ -5107,6 +5270,11 @@ main (int argc, char ** argv)
         print_spectrum ("PAUSES", pauses, FALSE);
         puts ("-------------------------------------------------------------------------------");
     }
+
+    if (statistics)
+    {
+        print_statistics ();
+    }
     return 0;
 }
 
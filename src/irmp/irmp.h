@@ -44,7 +44,13 @@
 #  endif
 #  define IRMP_BIT                              CONCAT(GPIO_Pin_, IRMP_BIT_NUMBER)
 #  define IRMP_PIN                              IRMP_PORT   // for use with input(x) below
-#  define input(x)                              (GPIO_ReadInputDataBit(x, IRMP_BIT))
+#  if IRMP_USE_INPUT_CAPTURE == 1
+#    define input(x)                            (ircapture_level)               // level replayed by ircapture_poll()
+extern uint_fast8_t                             ircapture_level;
+extern void                                     ircapture_poll (void);
+#  else
+#    define input(x)                            (GPIO_ReadInputDataBit(x, IRMP_BIT))
+#  endif
 #  ifndef USE_STDPERIPH_DRIVER
 #    warning The STM32 port of IRMP uses the ST standard peripheral drivers which are not enabled in your build configuration.
 #  endif
@@ -160,6 +160,16 @@
 #  error target system not defined.
 #endif
 
+/*---------------------------------------------------------------------------------------------------------------------------------------------------
+ * Set IRMP_USE_INPUT_CAPTURE to 1 if the IR edges should be timestamped in an EXTI interrupt by a free running 1 MHz timer,
+ * see ircapture.c. Then irmp_ISR() is not called by the timer2 interrupt, but by ircapture_poll() which replays the captured
+ * pulse widths in units of 1/F_INTERRUPTS. ircapture_poll() is called by irmp_get_data().
+ *---------------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef IRMP_USE_INPUT_CAPTURE
+#  define IRMP_USE_INPUT_CAPTURE                0       // 1: use timer input capture, 0: sample pin in timer2 ISR. default is 0
+#endif
+
 /*---------------------------------------------------------------------------------------------------------------------------------------------------
  * Set IRMP_LOGGING to 1 if want to log data to UART with 9600Bd
  *---------------------------------------------------------------------------------------------------------------------------------------------------
@@ -15,6 +15,8 @@
 #include "delay.h"
 #include "eep.h"
 #include "eeprom-data.h"
+#include "timer.h"
+#include "event.h"
 
 #define MAX_LDR_BRIGHTNESS                      31                                          // maximal possible brightness value
 
@@ -29,6 +31,18 @@ LDR_GLOBALS      ldr =
     MAX_VALUE,                                                                              // ldr_max_value
 };
 
+static TIMER_JOB            ldr_conversion_job;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: timer job, start LDR conversion every 1/4 second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+ldr_conversion_timer (void)
+{
+    event_post (EVENT_LDR_CONVERSION);
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * start conversion
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -226,4 +240,5 @@ void
 ldr_init (void)
 {
     adc_init ();
+    timer_add_job (&ldr_conversion_job, ldr_conversion_timer, 2 * TIMER_TICKS_PER_SEC, TIMER_TICKS_PER_SEC / 4);   // first conversion after 2 seconds
 }
@@ -309,6 +309,7 @@
  *    | General (IRMP etc.)     | TIM2                                  | TIM2                              |                               |
  *    | WS2812                  | TIM3                                  | TIM1                              |                               |
  *    | Beeper                  | TIM4                                  | TIM4                              |                               |
+ *    | IR edge timestamps      | TIM5                                  | TIM3                              | IRMP_USE_INPUT_CAPTURE only   |
  *    | DS18xx (OneWire)        | Systick (see delay.c)                 | Systick (see delay.c)             |                               |
  *    +-------------------------+---------------------------------------+-----------------------------------+-------------------------------+
  *
@@ -329,12 +330,14 @@
 #include "display.h"
 #include "overlay.h"
 #include "dcf77.h"
+#include "discipline.h"
 #include "timeserver.h"
 #include "esp8266.h"
 #include "esp-spiffs.h"
 #include "board-led.h"
 #include "power.h"
 #include "irmp.h"
+#include "ircapture.h"
 #include "remote-ir.h"
 #include "button.h"
 #include "wpsbutton.h"
@@ -343,6 +346,7 @@
 #include "tempsensor.h"
 #include "ds18xx.h"
 #include "rtc.h"
+#include "i2c.h"
 #include "ldr.h"
 #include "delay.h"
 #include "night.h"
@@ -356,6 +360,10 @@
 #include "log.h"
 #include "ssd1963.h"
 #include "touch.h"
+#include "event.h"
+#include "timer.h"
+#include "profile.h"
+#include "task.h"
 #include "main.h"
 
 #define DEFAULT_UPDATE_HOST         "uclock.de"
@@ -379,20 +387,11 @@ static uint_fast8_t             esp8266_is_online           = 0;
 static uint32_t                 eep_version                 = 0xFFFFFFFF;
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * global private variables, modified by timer ISR
+ * global private variables, modified by timer jobs
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-static volatile uint_fast8_t    animation_flag              = 0;        // flag: animate LEDs
-static volatile uint_fast8_t    seconds_flag                = 0;        // flag: seconds changed
-static volatile uint_fast8_t    ds3231_flag                 = 0;        // flag: read date/time from RTC DS3231
-static volatile uint_fast8_t    net_time_flag               = 0;        // flag: read date/time from time server
-static volatile uint_fast16_t   net_time_countdown          = 3800;     // counter: if it counts to 0, then net_time_flag will be triggered
-static volatile uint_fast8_t    ldr_conversion_flag         = 0;        // flag: read LDR value
-static volatile uint_fast8_t    measure_temperature_flag    = 0;        // flag: measure temperature from DS18XX
-static volatile uint_fast8_t    read_temperature_flag       = 0;        // flag: read temperature from RTC & DS18XX
-static volatile uint_fast8_t    read_rtc_temperature_flag   = 0;        // flag: read temperature from RTC
-static volatile uint_fast8_t    show_time_flag              = 0;        // flag: update time on display, set every full minute
-static volatile uint_fast8_t    half_minute_flag            = 0;        // flag: it is hh:mm:30
+static uint_fast16_t            net_time_countdown          = 3800;     // counter: if it counts to 0, then EVENT_NET_TIME will be posted
+static uint_fast16_t            net_time_interval           = 3800;     // current timeserver poll interval, see discipline_ntp_interval()
 volatile uint32_t               uptime                      = 0;        // uptime in seconds
 #if 0
 static volatile uint_fast8_t    wday                        = 0;        // current weekday, 0=Sunday
@@ -403,115 +402,67 @@ static volatile uint_fast8_t    hour                        = 0;        // curre
 static volatile uint_fast8_t    minute                      = 0;        // current minute
 static volatile uint_fast8_t    second                      = 0;        // current second
 #endif
-static volatile uint_fast8_t    dcf77_enabled               = 0;        // flag: DCF77 enabled (disabled if power is on)
-static volatile uint32_t        ambilight_clock_wait_cycles = 0;        // number of wait cycles before changing ambilight LED in clock/clock2
-static volatile uint32_t        ambilight_clock_wait_cnt    = 0;        // wait counter: counts from 0 to ambilight_clock_wait_cycles
-static volatile uint32_t        ambilight_clock_led_idx     = 0;        // ambilight led index for clock/clock2
-static volatile uint_fast8_t    ambilight_clock_tick        = 0;        // flag: call 20 times per ambilight LED in clock/clock2 mode
+static uint32_t                 ambilight_clock_interval    = 0;        // timer ticks before changing ambilight LED in clock/clock2, 0: off
+static uint_fast8_t             ambilight_clock_tick_cnt    = 0;        // tick counter: counts from 0 to AMBILIGHT_CLOCK_TICK_COUNT_PER_LED
+static uint32_t                 ambilight_clock_led_idx     = 0;        // ambilight led index for clock/clock2
+
+static TIMER_JOB                clock_job;                              // soft clock, every second, length see discipline_second()
+static TIMER_JOB                ds3231_job;                             // read RTC with dithered phase
+static TIMER_JOB                net_time_job;                           // timeserver request with dithered phase
+static TIMER_JOB                ambilight_clock_job;                    // ambilight modes clock & clock2
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * timer definitions:
- *
- *      F_INTERRUPTS    = TIM_CLK / (TIM_PRESCALER + 1) / (TIM_PERIOD + 1)
- * <==> TIM_PRESCALER   = TIM_CLK / F_INTERRUPTS / (TIM_PERIOD + 1) - 1
- *
- * STM32F401:
- *      TIM_PERIOD      =   8 - 1 =   7
- *      TIM_PRESCALER   = 700 - 1 = 699
- *      F_INTERRUPTS    = 84000000 / 700 / 8 = 15000 (0.00% error)
- * STM32F411:
- *      TIM_PERIOD      = 101 - 1 = 100
- *      TIM_PRESCALER   =  66 - 1 =  65
- *      F_INTERRUPTS    = 100000000 / 66 / 101 = 15015 (0.01% error)
- * STM32F446:
- *      TIM_PERIOD      =    6 - 1 =   5
- *      TIM_PRESCALER   = 1000 - 1 = 999
- *      F_INTERRUPTS    = 90000000 / 1000 / 6 = 15000 (0.00% error)
- * STM32F407VE:
- *      TIM_PERIOD      =    8 - 1 =    7
- *      TIM_PRESCALER   =  700 - 1 =  699
- *      F_INTERRUPTS    = 84000000 / 700 / 8 = 15000 (0.00% error)
- * STM32F103:
- *      TIM_PERIOD      =   6 - 1 =   5
- *      TIM_PRESCALER   = 800 - 1 = 799
- *      F_INTERRUPTS    = 72000000 / 800 / 6 = 15000 (0.00% error)
+ * copy soft clock into struct tm
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-#if defined (NUCLEO_BOARD)
-#  if defined (STM32F401RE)                                             // STM32F401 Nucleo Board @84MHz
-#    define TIM_CLK                 84000000L                           // 84 MHz
-#    define TIM_PERIOD              7
-#  elif defined (STM32F411RE)                                           // STM32F411 Nucleo Board @100MHz
-#    define TIM_CLK                 100000000L                          // 100 MHz
-#    define TIM_PERIOD              100
-#  elif defined (STM32F446RE)                                           // STM32F446 Nucleo Board @180MHz
-#    define TIM_CLK                 90000000L                           // APB2 clock: 90 MHz
-#    define TIM_PERIOD              5
-#  else
-#    error STM32 unknown
-#  endif
-
-#elif defined (BLACK_BOARD)
-#  if defined (STM32F407VE)                                             // STM32F407VE Black Board @168MHz
-#    define TIM_CLK                 84000000L                           // APB2 clock: 84 MHz
-#    define TIM_PERIOD              7
-#  else
-#    error STM32 unknown
-#  endif
-
-#elif defined (BLACKPILL_BOARD)
-#  if defined (STM32F401CC)                                             // STM32F401 BlackPill Board @84MHz
-#    define TIM_CLK                 84000000L                           // 84 MHz
-#    define TIM_PERIOD              7
-#  elif defined (STM32F411CE)                                           // STM32F411 BlackPill Board @100MHz
-#    define TIM_CLK                 100000000L                          // 100 MHz
-#    define TIM_PERIOD              100
-#  else
-#    error STM32 unknown
-#  endif
-
-#elif defined (BLUEPILL_BOARD)
-#  if defined (STM32F103)                                               // STM32F103 BLuePill Board @72MHz
-#    define TIM_CLK                 72000000L                           // APB2 clock: 72MHz
-#    define TIM_PERIOD              5
-#  else
-#    error STM32 unknown
-#  endif
-
-#else
-#error STM32 unknown
-#endif
-
-#define TIM_PRESCALER               ((TIM_CLK / F_INTERRUPTS) / (TIM_PERIOD + 1) - 1)
+static void
+soft_clock_to_tm (struct tm * tmp)
+{
+    tmp->tm_year = gmain.year - 1900;
+    tmp->tm_mon  = gmain.month - 1;
+    tmp->tm_mday = gmain.mday;
+    tmp->tm_hour = gmain.hour;
+    tmp->tm_min  = gmain.minute;
+    tmp->tm_sec  = gmain.second;
+    tmp->tm_wday = gmain.wday;
+}
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * initialize timer2
+ * timer job for RTC read, started at hh:mm:45 with a delay of less than one second
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static void
-timer2_init (void)
+ds3231_timer (void)
 {
-    TIM_TimeBaseInitTypeDef     tim;
-    NVIC_InitTypeDef            nvic;
-
-    TIM_TimeBaseStructInit (&tim);
-    RCC_APB1PeriphClockCmd (RCC_APB1Periph_TIM2, ENABLE);
+    event_post (EVENT_DS3231);
+}
 
-    tim.TIM_ClockDivision   = TIM_CKD_DIV1;
-    tim.TIM_CounterMode     = TIM_CounterMode_Up;
-    tim.TIM_Period          = TIM_PERIOD;
-    tim.TIM_Prescaler       = TIM_PRESCALER;
-    TIM_TimeBaseInit (TIM2, &tim);
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer job for timeserver request, started with a delay of less than one second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+net_time_timer (void)
+{
+    event_post (EVENT_NET_TIME);
+}
 
-    TIM_ITConfig(TIM2, TIM_IT_Update, ENABLE);
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer job for ambilight modes clock & clock2
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+ambilight_clock_timer (void)
+{
+    ambilight_clock_tick_cnt++;
 
-    nvic.NVIC_IRQChannel                    = TIM2_IRQn;
-    nvic.NVIC_IRQChannelCmd                 = ENABLE;
-    nvic.NVIC_IRQChannelPreemptionPriority  = 0x0F;
-    nvic.NVIC_IRQChannelSubPriority         = 0x0F;
-    NVIC_Init (&nvic);
+    if (ambilight_clock_tick_cnt == AMBILIGHT_CLOCK_TICK_COUNT_PER_LED)
+    {
+        ambilight_clock_led_idx++;
+        ambilight_clock_tick_cnt = 0;
+    }
 
-    TIM_Cmd(TIM2, ENABLE);
+    event_post (EVENT_AMBILIGHT_CLOCK_TICK);                            // AMBILIGHT_CLOCK_TICK_COUNT_PER_LED times per ambilight LED
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
@@ -523,193 +474,113 @@ main_set_ambilight_clock_wait_cycles (void)
 {
     if (display.ambilight_leds)
     {
-        ambilight_clock_wait_cycles = (60 * F_INTERRUPTS) / ((AMBILIGHT_CLOCK_TICK_COUNT_PER_LED * display.ambilight_leds));
+        ambilight_clock_interval    = (60 * TIMER_TICKS_PER_SEC) / ((AMBILIGHT_CLOCK_TICK_COUNT_PER_LED * display.ambilight_leds));
         ambilight_clock_led_idx     = (gmain.second * display.ambilight_leds) / 60;
+        timer_add_job (&ambilight_clock_job, ambilight_clock_timer, ambilight_clock_interval, ambilight_clock_interval);
     }
     else
     {
-        ambilight_clock_wait_cycles = 0;
+        ambilight_clock_interval    = 0;
         ambilight_clock_led_idx     = 0;
+        timer_remove_job (&ambilight_clock_job);
     }
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * timer2 IRQ handler for IRMP, soft clock, dcf77, animations, several timeouts
+ * timer job for soft clock, called every second
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-extern void TIM2_IRQHandler (void);                                     // keep compiler happy
-
-void
-TIM2_IRQHandler (void)
+static void
+clock_timer (void)
 {
-    static uint_fast8_t     last_minute_of_ds3231_flag = 0xFF;
-    static uint_fast16_t    ldr_cnt;
-    static uint_fast16_t    animation_cnt;
-    static uint_fast16_t    clk_cnt;
-    static uint_fast16_t    dcf77_cnt;
-    static uint_fast16_t    net_time_cnt;
-    static uint_fast8_t     ambi_tick_cnt = 0;
-#ifndef BLACK_BOARD                                                     // eeprom not used on STM32F407VE
-    static uint_fast16_t    eeprom_cnt;
-#endif
-
-    TIM_ClearITPendingBit(TIM2, TIM_IT_Update);
-
-    (void) irmp_ISR ();                                                 // call irmp ISR
-
-    if (uptime > 1)
-    {
-        ldr_cnt++;
-
-        if (ldr_cnt == F_INTERRUPTS / 4)                                // start LDR conversion every 1/4 second
-        {
-            ldr_conversion_flag = 1;
-            ldr_cnt = 0;
-        }
-    }
+    static uint_fast8_t     last_minute_of_ds3231_event = 0xFF;
 
-    animation_cnt++;
-
-    if (animation_cnt == F_INTERRUPTS / 64)                             // set animation_flag every 1/64 of a second
-    {
-        animation_flag = 1;
-        animation_cnt = 0;
-    }
+    clock_job.interval = discipline_second (clock_job.expires);        // length of next second, drift & slew corrected
+    uptime++;
+    gmain.second++;
 
-    if (dcf77_enabled)                                                  // disabled if power is on
+    if (gmain.second == 45)                                             // get rtc time at hh:mm:45, but not twice in same minute
     {
-        dcf77_cnt++;
-
-        if (dcf77_cnt == F_INTERRUPTS / 100)                            // call dcf77_tick every 1/100 of a second
+        if (last_minute_of_ds3231_event != gmain.minute)
         {
-            dcf77_cnt = 0;
-            dcf77_tick ();
+            last_minute_of_ds3231_event = gmain.minute;
+            timer_add_job (&ds3231_job, ds3231_timer, discipline_dither_delay (), 0);
         }
     }
-
-    net_time_cnt++;
-
-    if (net_time_cnt == F_INTERRUPTS / 100)                             // set esp8266_ten_ms_tick every 1/100 of a second
+    else if (gmain.second == 49)
     {
-        esp8266_ten_ms_tick = 1;
-        net_time_cnt = 0;
+        event_post (EVENT_MEASURE_TEMPERATURE);                         // start conversion of DS18xx, EVENT_READ_TEMPERATURE follows when done
     }
-
-#ifndef BLACK_BOARD                                                     // eeprom not used on STM32F407VE
-    eeprom_cnt++;
-
-    if (eeprom_cnt == F_INTERRUPTS / 1000)                              // set eep_ms_tick every 1/1000 of a second
+    else if (gmain.second == 51)
     {
-        eeprom_ms_tick = 1;
-        eeprom_cnt = 0;
+        event_post (EVENT_READ_RTC_TEMPERATURE);                        // read temperature data of RTC
     }
-#endif
-
-    if (ambilight_clock_wait_cycles)                                    // wait cycles for ambilight mode clock & clock2
+    else if (gmain.second == 60)
     {
-        ambilight_clock_wait_cnt++;
+        gmain.second = 0;
+        gmain.minute++;
 
-        if (ambilight_clock_wait_cnt >= ambilight_clock_wait_cycles)
+        if (ambilight_clock_interval)                                   // fix rounding errors by restarting ambilight job every minute
         {
-            ambilight_clock_wait_cnt = 0;
-
-            ambi_tick_cnt++;
-
-            if (ambi_tick_cnt == AMBILIGHT_CLOCK_TICK_COUNT_PER_LED)
-            {
-                ambilight_clock_led_idx++;
-                ambi_tick_cnt = 0;
-            }
-
-            ambilight_clock_tick = 1;                                   // set AMBILIGHT_CLOCK_TICK_COUNT_PER_LED times per ambilight LED
+            timer_add_job (&ambilight_clock_job, ambilight_clock_timer, ambilight_clock_interval, ambilight_clock_interval);
+            ambilight_clock_led_idx = 0;                                // reset led index, too
+            ambilight_clock_tick_cnt = 0;
         }
-    }
-
-    clk_cnt++;
-
-    if (clk_cnt == F_INTERRUPTS)                                        // increment internal clock every second
-    {
-        clk_cnt         = 0;
-        seconds_flag    = 1;
 
-        uptime++;
-        gmain.second++;
+        event_post (EVENT_SHOW_TIME);
 
-        if (gmain.second == 45)                                         // get rtc time at hh:mm:45, but not twice in same minute
-        {
-            if (last_minute_of_ds3231_flag != gmain.minute)
-            {
-                last_minute_of_ds3231_flag = gmain.minute;
-                ds3231_flag = 1;
-            }
-        }
-        else if (gmain.second == 49)
-        {
-            measure_temperature_flag = 1;                               // start ADC conversion of DS18xx
-        }
-        else if (gmain.second == 50)
-        {
-            read_temperature_flag = 1;                                  // read temperature data of DS18xx
-        }
-        else if (gmain.second == 51)
-        {
-            read_rtc_temperature_flag = 1;                              // read temperature data of RTC
-        }
-        else if (gmain.second == 60)
+        if (gmain.minute == 60)
         {
-            gmain.second             = 0;
-            ambilight_clock_wait_cnt = 0;                               // fix rounding errors by resetting wait_cnt every minute
-            ambilight_clock_led_idx  = 0;                               // reset led index, too
-            ambi_tick_cnt            = 0;
-            gmain.minute++;
-
-            show_time_flag = 1;
+            gmain.minute = 0;
+            gmain.hour++;
 
-            if (gmain.minute == 60)
+            if (gmain.hour == 24)
             {
-                gmain.minute = 0;
-                gmain.hour++;
+                gmain.hour = 0;
+                gmain.wday++;
 
-                if (gmain.hour == 24)
+                if (gmain.wday == 7)
                 {
-                    gmain.hour = 0;
-                    gmain.wday++;
+                    gmain.wday = 0;
+                }
 
-                    if (gmain.wday == 7)
-                    {
-                        gmain.wday = 0;
-                    }
+                gmain.mday++;
 
-                    gmain.mday++;
+                if (gmain.mday > days_of_month (gmain.month, gmain.year))
+                {
+                    gmain.mday = 1;
+                    gmain.month++;
 
-                    if (gmain.mday > days_of_month (gmain.month, gmain.year))
+                    if (gmain.month >= 13)
                     {
-                        gmain.mday = 1;
-                        gmain.month++;
-
-                        if (gmain.month >= 13)
-                        {
-                            gmain.month = 1;
-                            gmain.year++;
-                        }
+                        gmain.month = 1;
+                        gmain.year++;
                     }
                 }
             }
         }
-        else if (gmain.second == 30)
+    }
+    else if (gmain.second == 30)
+    {
+        event_post (EVENT_HALF_MINUTE);
+    }
+
+    if (net_time_countdown)
+    {
+        net_time_countdown--;
+
+        if (net_time_countdown == 0)                                    // trigger net time update
         {
-            half_minute_flag = 1;
+            timer_add_job (&net_time_job, net_time_timer, discipline_dither_delay (), 0);
         }
+    }
 
-        if (net_time_countdown)
-        {
-            net_time_countdown--;
+    if (discipline_rtc_set_due () && grtc.rtc_is_up)                    // set RTC at start of second
+    {
+        struct tm   tm;
 
-            if (net_time_countdown == 0)                                // trigger net time update
-            {
-                net_time_flag = 1;
-            }
-        }
+        soft_clock_to_tm (&tm);
+        rtc_set_date_time (&tm);
     }
 }
 
@@ -900,13 +771,13 @@ read_configuration_from_eep (void)
             if (eep_version >= EEPROM_VERSION_1_5)
             {
                 log_message ("reading ir codes");
-                remote_ir_read_codes_from_eep ();
+                remote_ir_read_codes_from_eep (eep_version);
 
                 debug_log_message ("reading display configuration");
                 display_read_config_from_eep (eep_version);
 
                 debug_log_message ("reading timeserver data");
-                timeserver_read_data_from_eep ();
+                timeserver_read_data_from_eep (eep_version);
             }
 
             debug_log_message ("reading overlay configuration");
@@ -1119,11 +990,11 @@ set_display_power (uint_fast8_t new_power_is_on, uint_fast8_t do_sync_ambilight)
 
     if (display.display_power_is_on || display.ambilight_power_is_on)
     {
-        dcf77_enabled = FALSE;
+        dcf77_enable (FALSE);
     }
     else
     {
-        dcf77_enabled = TRUE;
+        dcf77_enable (TRUE);
     }
 
     return display_clock_flag;
@@ -1184,6 +1055,13 @@ static uint_fast8_t     icon_duration               = 0;
 static uint32_t         show_icon_stop_time         = 0;
 static uint32_t         local_uptime                = 0;
 
+#define REALTIME_TIMEOUT    3                                           // back to clock mode if no realtime frame within 2-3 seconds
+
+static uint32_t         realtime_stop_time          = 0;
+static uint_fast8_t     realtime_seq;                                   // sequence number of last realtime frame record
+static uint32_t         realtime_frames;                                // realtime frames shown
+static uint32_t         realtime_lost;                                  // realtime frame records lost on serial line
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * set_overlay_idx () - used by external NIC function wc_display_overlay()
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -1277,7 +1155,7 @@ schedule_esp8266_remote_procedure (char * parameters)
 
         case GET_NET_TIME_RPC_VAR:
         {
-            net_time_flag = 1;
+            event_post (EVENT_NET_TIME);
             debug_log_message ("rpc: start net time request");
             break;
         }
@@ -1325,6 +1203,48 @@ schedule_esp8266_remote_procedure (char * parameters)
             debug_log_message ("rpc: show date");
             break;
         }
+
+#if PROFILE == 1
+        case GET_PROFILE_RPC_VAR:
+        {
+            debug_log_message ("rpc: send profile");
+            var_send_profile ();
+            break;
+        }
+
+        case RESET_PROFILE_RPC_VAR:
+        {
+            debug_log_message ("rpc: reset profile");
+            profile_reset ();
+            break;
+        }
+#endif
+
+        case LOG_STATS_RPC_VAR:
+        {
+            event_log_stats ();
+            timer_log_stats ();
+            task_log_stats ();
+            dcf77_log_stats ();
+            discipline_log_stats ();
+#if IRMP_USE_INPUT_CAPTURE == 1
+            ircapture_log_stats ();
+#endif
+            break;
+        }
+
+        case RESET_STATS_RPC_VAR:
+        {
+            event_reset_stats ();
+            timer_reset_stats ();
+            task_reset_stats ();
+            dcf77_reset_stats ();
+            discipline_reset_stats ();
+#if IRMP_USE_INPUT_CAPTURE == 1
+            ircapture_reset_stats ();
+#endif
+            break;
+        }
     }
 }
 
@@ -1459,7 +1379,7 @@ schedule_esp8266_numeric_variable (char * parameters)
             if (display.animation_mode != val)
             {
                 display_set_animation_mode (val, FALSE);
-                animation_flag = 0;
+                event_cancel (EVENT_ANIMATION);
                 display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
             }
             debug_log_printf ("cmd: set animation_mode = %d\r\n", val);
@@ -1544,6 +1464,7 @@ schedule_esp8266_numeric_variable (char * parameters)
 
             debug_log_printf ("cmd: set timezone = %d\r\n", tz);
             timeserver_set_timezone (tz, do_observe_summertime);
+            var_send_timezone_rule ();                                  // rule has been cleared
             break;
         }
 
@@ -1562,7 +1483,7 @@ schedule_esp8266_numeric_variable (char * parameters)
         case RTC_TEMP_CORRECTION_NUM_VAR:
         {
             rtc_set_temp_correction (val);
-            read_rtc_temperature_flag = 1;
+            event_post (EVENT_READ_RTC_TEMPERATURE);
             debug_log_printf ("cmd: set rtc_temp_correction = %d\r\n", val);
             break;
         }
@@ -1576,8 +1497,7 @@ schedule_esp8266_numeric_variable (char * parameters)
         case DS18XX_TEMP_CORRECTION_NUM_VAR:
         {
             temp_set_temp_correction (val);
-            measure_temperature_flag = 1;                                           // measure & read
-            read_temperature_flag = 1;
+            event_post (EVENT_MEASURE_TEMPERATURE);                                 // measure & read
             debug_log_printf ("cmd: set ds18xx_temp_correction = %d\r\n", val);
             break;
         }
@@ -1818,6 +1738,16 @@ schedule_esp8266_string_variable (char * parameters)
             break;
         }
 
+        case TIMEZONE_RULE_STR_VAR:
+        {
+            if (! timeserver_set_timezone_rule (parameters))
+            {
+                var_send_timezone_rule ();                              // invalid rule: send back current rule
+            }
+            debug_log_printf ("cmd: set timezone rule = '%s'\r\n", parameters);
+            break;
+        }
+
     }
 }
 
@@ -1854,11 +1784,7 @@ schedule_esp8266_time_variable (char * parameters)
                                   1 * (parameters[13] - '0');
 
             gmain.tm.tm_wday = dayofweek (gmain.tm.tm_mday, gmain.tm.tm_mon + 1, gmain.tm.tm_year + 1900);
-
-            if (grtc.rtc_is_up)
-            {
-                rtc_set_date_time (&(gmain.tm));
-            }
+            discipline_set_time (&(gmain.tm), 1);
 
             if (gmain.hour != (uint_fast8_t) gmain.tm.tm_hour || gmain.minute != (uint_fast8_t) gmain.tm.tm_min)
             {
@@ -2285,6 +2211,51 @@ schedule_esp8266_games (char * parameters)
     }
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * schedule_esp8266_sync_animation () - pre-arm synchronized animation start: Yaassssdddd
+ * aa: animation mode (FF: own mode), ssss: random seed, dddd: start in dddd msec
+ * "sync-armed" tells the ESP8266 when the command has been parsed, so it can measure transfer and parse time of the command.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define SYNC_ANIMATION_MAX_DELAY    5000                                // max. delay of synchronized start in msec
+
+static void
+schedule_esp8266_sync_animation (char * parameters)
+{
+    uint_fast8_t    mode;
+    uint_fast16_t   seed;
+    uint32_t        delay;
+
+    mode    = htoi (parameters, 2);
+    seed    = htoi (parameters + 2, 4);
+    delay   = htoi (parameters + 6, 4);
+
+    if (delay > 0 && delay <= SYNC_ANIMATION_MAX_DELAY)
+    {
+        display_sync_animation (mode, seed, TIMER_MSEC_TO_TICKS(delay));
+        esp8266_send_cmd ("sync-armed", (const char *) NULL, 0);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * send_esp8266_sync_late () - report latency of synchronized animation start to ESP8266: "sync-late usec"
+ * one timer tick is added for the resolution of the timer, latencies of more than one second are reported as one second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+send_esp8266_sync_late (uint32_t ticks)
+{
+    char    buf[12];
+
+    if (ticks >= TIMER_TICKS_PER_SEC)
+    {
+        ticks = TIMER_TICKS_PER_SEC - 1;
+    }
+
+    sprintf (buf, "%lu", (unsigned long) ((ticks + 1) * 1000000UL / TIMER_TICKS_PER_SEC));
+    esp8266_send_cmd ("sync-late", buf, 0);
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * schedule_esp8266_cmd () - schedule ESP8266 commands
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -2383,7 +2354,55 @@ schedule_esp8266_cmd (void)
             schedule_esp8266_games (parameters);
             break;
         }
+
+        case 'Y':                                                   // Yaassssdddd synchronized animation start
+        {
+            schedule_esp8266_sync_animation (parameters);
+            break;
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * schedule_esp8266_frame () - show realtime frame record of ESP8266, see esp8266.h
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+schedule_esp8266_frame (void)
+{
+    uint8_t *       frame   = esp8266.u.frame;
+    uint_fast8_t    seq     = frame[0];
+    uint_fast8_t    flags   = frame[1];
+    uint_fast16_t   offset  = (frame[2] << 8) | frame[3];
+    uint_fast8_t    n       = frame[4];
+
+    if (! display.display_power_is_on)
+    {
+        return;
+    }
+
+    if (! display.realtime_mode)
+    {
+        realtime_frames = 0;
+        realtime_lost   = 0;
+        display_realtime_start ();
+        log_message ("realtime mode started");
+    }
+    else if (seq != ((realtime_seq + 1) & 0xFF))
+    {
+        realtime_lost += (seq - realtime_seq - 1) & 0xFF;
+    }
+
+    realtime_seq = seq;
+    display_realtime_leds (offset, frame + ESP8266_FRAME_HEADER_LEN, n);
+
+    if (flags & ESP8266_FRAME_FLAG_PUSH)
+    {
+        display_realtime_refresh ();
+        realtime_frames++;
     }
+
+    realtime_stop_time = local_uptime + REALTIME_TIMEOUT;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
@@ -2404,6 +2423,11 @@ schedule_esp8266_messages (void)
             schedule_esp8266_cmd ();
             break;
         }
+        case ESP8266_FRAME:
+        {
+            schedule_esp8266_frame ();
+            break;
+        }
         case ESP8266_TIME:
         {
             char *          endptr;
@@ -2412,29 +2436,29 @@ schedule_esp8266_messages (void)
             seconds_since_1900  = strtoul (esp8266.u.time, &endptr, 10);
             timeserver_convert_time (&gmain.tm, seconds_since_1900);
 
-            if (grtc.rtc_is_up)
+            if (discipline_reference (DISCIPLINE_SOURCE_NTP, &gmain.tm))         // step, else offset is slewed
             {
-                rtc_set_date_time (&gmain.tm);
-            }
+                if (gmain.hour != (uint_fast8_t) gmain.tm.tm_hour || gmain.minute != (uint_fast8_t) gmain.tm.tm_min)
+                {
+                    var_send_tm ();
+                    display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
+                }
 
-            if (gmain.hour != (uint_fast8_t) gmain.tm.tm_hour || gmain.minute != (uint_fast8_t) gmain.tm.tm_min)
-            {
-                var_send_tm ();
-                display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
-            }
+                gmain.year    = gmain.tm.tm_year + 1900;
+                gmain.month   = gmain.tm.tm_mon  + 1;
+                gmain.mday    = gmain.tm.tm_mday;
+                gmain.wday    = gmain.tm.tm_wday;
+                gmain.hour    = gmain.tm.tm_hour;
+                gmain.minute  = gmain.tm.tm_min;
+                gmain.second  = gmain.tm.tm_sec;
 
-            gmain.year    = gmain.tm.tm_year + 1900;
-            gmain.month   = gmain.tm.tm_mon  + 1;
-            gmain.mday    = gmain.tm.tm_mday;
-            gmain.wday    = gmain.tm.tm_wday;
-            gmain.hour    = gmain.tm.tm_hour;
-            gmain.minute  = gmain.tm.tm_min;
-            gmain.second  = gmain.tm.tm_sec;
+                debug_log_printf ("cmd: set time to %s %4d-%02d-%02d %02d:%02d:%02d\r\n",
+                                    wdays_en[gmain.tm.tm_wday], gmain.tm.tm_year + 1900, gmain.tm.tm_mon + 1, gmain.tm.tm_mday,
+                                    gmain.tm.tm_hour, gmain.tm.tm_min, gmain.tm.tm_sec);
+            }
 
-            debug_log_printf ("cmd: set time to %s %4d-%02d-%02d %02d:%02d:%02d\r\n",
-                                wdays_en[gmain.tm.tm_wday], gmain.tm.tm_year + 1900, gmain.tm.tm_mon + 1, gmain.tm.tm_mday,
-                                gmain.tm.tm_hour, gmain.tm.tm_min, gmain.tm.tm_sec);
-            net_time_countdown = 3600 + 180 + 40 - gmain.second;                // calc next timeserver call 1h3m later at hh:mm:40
+            net_time_interval   = discipline_ntp_interval ();
+            net_time_countdown  = net_time_interval + 40 - gmain.second;        // calc next timeserver call at hh:mm:40
             break;
         }
         case ESP8266_TABLES:                                                    // ESP8266 read layout tables
@@ -2619,42 +2643,355 @@ do_play_dfplayer (uint_fast16_t cur_minute)
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * main function
+ * event handlers, events are posted by timer jobs (timer_run() in main loop) and by ISRs, e.g. of I2C
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
-int
-main (void)
-{
-    static uint_fast16_t    last_ldr_raw_value          = 0xFFFF;
-    uint_fast8_t            esp8266_is_up               = 0;
-    IRMP_DATA               irmp_data;
-    uint32_t                stop_time;
-    uint_fast8_t            cmd;
-    uint_fast8_t            status_led_cnt              = 0;
-    uint_fast8_t            time_changed                = 0;
-    uint_fast16_t           ldr_raw_value;
-    uint_fast8_t            ldr_value;
-    uint32_t                ap_pressed                  = 0;
-    uint32_t                wps_pressed                 = 0;                // timestamp when wps button has been pressed
-    uint32_t                clockspeed                  = 100000;           // default clock speed for i2c bus
-    uint_fast8_t            ds18xx_temperature_index    = 0xFF;
-    uint_fast8_t            rtc_temperature_index       = 0xFF;
+static uint_fast8_t     status_led_cnt              = 0;
+static uint_fast8_t     ds18xx_temperature_index    = 0xFF;
+static uint_fast8_t     rtc_temperature_index       = 0xFF;
 
-    SystemInit ();
-    SystemCoreClockUpdate();                                                // needed for Nucleo board
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * animate LEDs, posted every 1/64 second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+animation_event (void)
+{
+    display_animation ();
+}
 
-#if defined (STM32F103)                                                     // disable JTAG to get back PB3, PB4, PA13, PA14, PA15
-    RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);                    // turn on clock for the alternate function register
-    GPIO_PinRemapConfig(GPIO_Remap_SWJ_JTAGDisable, ENABLE);                // disable the JTAG, enable the SWJ interface
-#endif
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * next step of ambilight modes clock & clock2, posted AMBILIGHT_CLOCK_TICK_COUNT_PER_LED times per ambilight LED
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+ambilight_clock_tick_event (void)
+{
+    if (! display.realtime_mode)
+    {
+        display_seconds (ambilight_clock_led_idx);
+    }
+}
 
-    gmain.hardware_configuration = 0;
-    gmain.hardware_configuration |= HW_STM32_CONFIGURATION;
-    gmain.hardware_configuration |= HW_CLOCK_CONFIGURATION;
-    gmain.hardware_configuration |= HW_DISPLAY_CONFIGURATION;
-    gmain.hardware_configuration |= HW_OSC_CONFIGURATION;
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start reading date/time from RTC DS3231, posted at hh:mm:45
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+ds3231_event (void)
+{
+    if (grtc.rtc_is_up)
+    {
+        discipline_rtc_read_started ();
+        rtc_start_get_date_time ();                                 // EVENT_RTC_DATE_TIME follows
+    }
+}
 
-    strcpy (gmain.update_host, DEFAULT_UPDATE_HOST);
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * date/time of RTC DS3231 has been read
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+rtc_date_time_event (void)
+{
+    if (rtc_get_date_time_result (&gmain.tm) && discipline_reference (DISCIPLINE_SOURCE_RTC, &gmain.tm))
+    {
+        if (gmain.hour != (uint_fast8_t) gmain.tm.tm_hour || gmain.minute != (uint_fast8_t) gmain.tm.tm_min)
+        {
+            display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
+        }
+
+        gmain.year    = gmain.tm.tm_year + 1900;
+        gmain.month   = gmain.tm.tm_mon  + 1;
+        gmain.mday    = gmain.tm.tm_mday;
+        gmain.wday    = gmain.tm.tm_wday;
+        gmain.hour    = gmain.tm.tm_hour;
+        gmain.minute  = gmain.tm.tm_min;
+        gmain.second  = gmain.tm.tm_sec;
+
+        log_printf ("read rtc: %s %4d-%02d-%02d %02d:%02d:%02d\r\n",
+                    wdays_en[gmain.tm.tm_wday], gmain.tm.tm_year + 1900, gmain.tm.tm_mon + 1, gmain.tm.tm_mday,
+                    gmain.tm.tm_hour, gmain.tm.tm_min, gmain.tm.tm_sec);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start LDR conversion, posted every 1/4 second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+ldr_conversion_event (void)
+{
+    if (display.animation_stop_flag && ! display.do_display_icon && display.automatic_brightness)
+    {
+        ldr_start_conversion ();
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start timeserver request
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+net_time_event (void)
+{
+    if (esp8266.is_online)
+    {
+        display_set_status_led (0, 0, 1);                           // light blue status LED
+        status_led_cnt = STATUS_LED_FLASH_TIME;
+        timeserver_start_timeserver_request ();                     // start a timeserver request, answer follows...
+    }
+
+    net_time_interval  = discipline_ntp_interval ();
+    net_time_countdown = net_time_interval;                         // next net time, if timeserver doesn't answer
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * update time on display, posted every full minute
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+show_time_event (void)
+{
+    soft_clock_to_tm (&gmain.tm);
+
+    if (esp8266.is_online)
+    {
+        var_send_tm ();
+    }
+
+    // display_clock_flag = 0;                                      // don't reset flag
+
+    if (night_check_night_times (0, display.display_power_is_on, gmain.wday, gmain.hour * 60 + gmain.minute))
+    {
+        if (display.display_power_is_on)                            // display currently on
+        {                                                           // switch off display AND ambilight
+            display_clock_flag = set_display_power (FALSE, TRUE);
+        }
+        else                                                        // display currently off
+        {                                                           // switch on display, but NOT ambilight
+            display_clock_flag = set_display_power (TRUE, FALSE);
+        }
+
+        log_printf ("Found Timer: %s at %02d:%02d\r\n", display.display_power_is_on ? "on" : "off", gmain.hour, gmain.minute);
+    }
+
+    if (night_check_night_times (1, display.ambilight_power_is_on, gmain.wday, gmain.hour * 60 + gmain.minute))
+    {
+        display_set_ambilight_power (! display.ambilight_power_is_on);
+        log_printf ("Found Timer: ambilight %s at %02d:%02d\r\n", display.ambilight_power_is_on ? "on" : "off", gmain.hour, gmain.minute);
+    }
+
+    if (display_clock_flag == 0)                                    // no night time found
+    {
+#if WCLOCK24H == 1
+        display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
+#else
+        if (gmain.minute % 5)
+        {
+            display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_MINUTES; // only update minute LEDs
+        }
+        else
+        {
+            display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
+        }
+#endif
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check overlays, posted at hh:mm:30
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+half_minute_event (void)
+{
+    if (display.display_power_is_on && ! display.realtime_mode)     // no overlays while realtime frames are shown
+    {
+        if (net_time_countdown > net_time_interval - 30)    // waiting for timeserver response?
+        {                                           // no, else don't communicate with ESP8266 (icon vs. timeserver response)
+            log_printf ("net_time_countdown = %d, don't check overlays\r\n", net_time_countdown);
+        }
+        else
+        {
+            static uint_fast16_t    last_year;
+            uint_fast16_t           mmdd;
+            uint_fast8_t            overlay_idx;
+            uint_fast8_t            overlay_max_interval;
+
+            mmdd                    = (gmain.month << 8) + gmain.mday;
+            overlay_max_interval    = 0;
+
+            if (last_year != gmain.year)
+            {
+                uint_fast8_t    i;
+
+                last_year = gmain.year;
+
+                for (i = 0; i < overlay.n_overlays; i++)
+                {
+                    overlay_calc_dates (i, last_year);
+                }
+            }
+
+            // overlay step 1: find maximum overlay interval which matches current minute
+            // overlays with matching dates have higher priority
+            for (overlay_idx = 0; overlay_idx < overlay.n_overlays; overlay_idx++)
+            {
+                if (overlay.overlays[overlay_idx].flags & OVERLAY_FLAG_ACTIVE)
+                {
+                    if ((gmain.minute % overlay.overlays[overlay_idx].interval) == 0)
+                    {
+                        if (overlay.overlays[overlay_idx].date_start == 0 ||
+                            (mmdd >= overlay.overlays[overlay_idx].date_start && mmdd <= overlay.overlays[overlay_idx].date_end))
+                        {
+                            if (overlay.overlays[overlay_idx].interval > overlay_max_interval)
+                            {
+                                overlay_max_interval = overlay.overlays[overlay_idx].interval;
+                                show_overlay_idx = overlay_idx;
+                            }
+                            else if (overlay.overlays[overlay_idx].interval == overlay_max_interval)
+                            {
+                                if (overlay.overlays[overlay_idx].date_start != 0)
+                                {
+                                    overlay_max_interval = overlay.overlays[overlay_idx].interval;
+                                    show_overlay_idx = overlay_idx;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start conversion of DS18xx, posted at hh:mm:49
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+measure_temperature_event (void)
+{
+    if (ds18xx.is_up)
+    {
+        temp_start_conversion ();                                           // conversion task posts EVENT_READ_TEMPERATURE
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read temperature of DS18xx, posted by conversion task
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+read_temperature_event (void)
+{
+    if (ds18xx.is_up)
+    {
+        ds18xx_temperature_index = temp_read_temp_index ();
+        log_printf ("DS18xxx temperature: %d%s\r\n", ds18xx_temperature_index / 2, (ds18xx_temperature_index % 2) ? ".5" : "");
+
+        if (esp8266.is_online)
+        {
+            var_send_ds18xx_temp_index ();
+        }
+    }
+    else
+    {
+        ds18xx_temperature_index = 0xFF;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read temperature of RTC, posted at hh:mm:51
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+read_rtc_temperature_event (void)
+{
+    if (grtc.rtc_is_up)
+    {
+        rtc_start_get_temperature_index ();                                 // EVENT_RTC_TEMPERATURE follows
+    }
+    else
+    {
+        rtc_temperature_index = 0xFF;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * temperature of RTC has been read
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+rtc_temperature_event (void)
+{
+    rtc_temperature_index = rtc_get_temperature_index_result ();
+    log_printf ("RTC temperature: %d%s\r\n", rtc_temperature_index / 2, (rtc_temperature_index % 2) ? ".5" : "");
+
+    if (esp8266.is_online)
+    {
+        var_send_rtc_temp_index ();
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * register event handlers
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+register_event_handlers (void)
+{
+    event_init ();
+    event_register_handler (EVENT_ANIMATION,               EVENT_PRIO_HIGH,    animation_event);
+    event_register_handler (EVENT_AMBILIGHT_CLOCK_TICK,    EVENT_PRIO_HIGH,    ambilight_clock_tick_event);
+    event_register_handler (EVENT_SHOW_TIME,               EVENT_PRIO_NORMAL,  show_time_event);
+    event_register_handler (EVENT_HALF_MINUTE,             EVENT_PRIO_NORMAL,  half_minute_event);
+    event_register_handler (EVENT_DS3231,                  EVENT_PRIO_NORMAL,  ds3231_event);
+    event_register_handler (EVENT_NET_TIME,                EVENT_PRIO_NORMAL,  net_time_event);
+    event_register_handler (EVENT_LDR_CONVERSION,          EVENT_PRIO_LOW,     ldr_conversion_event);
+    event_register_handler (EVENT_MEASURE_TEMPERATURE,     EVENT_PRIO_LOW,     measure_temperature_event);
+    event_register_handler (EVENT_READ_TEMPERATURE,        EVENT_PRIO_LOW,     read_temperature_event);
+    event_register_handler (EVENT_READ_RTC_TEMPERATURE,    EVENT_PRIO_LOW,     read_rtc_temperature_event);
+    event_register_handler (EVENT_RTC_DATE_TIME,           EVENT_PRIO_NORMAL,  rtc_date_time_event);
+    event_register_handler (EVENT_RTC_TEMPERATURE,         EVENT_PRIO_LOW,     rtc_temperature_event);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * main function
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+int
+main (void)
+{
+    static uint_fast16_t    last_ldr_raw_value          = 0xFFFF;
+    uint_fast8_t            esp8266_is_up               = 0;
+    IRMP_DATA               irmp_data;
+    uint32_t                stop_time;
+    uint32_t                sync_late_ticks;
+    uint_fast8_t            cmd;
+    uint_fast8_t            time_changed                = 0;
+    uint_fast16_t           ldr_raw_value;
+    uint_fast8_t            ldr_value;
+    uint32_t                ap_pressed                  = 0;
+    uint32_t                wps_pressed                 = 0;                // timestamp when wps button has been pressed
+    uint32_t                clockspeed                  = 100000;           // default clock speed for i2c bus
+
+    SystemInit ();
+    SystemCoreClockUpdate();                                                // needed for Nucleo board
+
+#if defined (STM32F103)                                                     // disable JTAG to get back PB3, PB4, PA13, PA14, PA15
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);                    // turn on clock for the alternate function register
+    GPIO_PinRemapConfig(GPIO_Remap_SWJ_JTAGDisable, ENABLE);                // disable the JTAG, enable the SWJ interface
+#endif
+
+    gmain.hardware_configuration = 0;
+    gmain.hardware_configuration |= HW_STM32_CONFIGURATION;
+    gmain.hardware_configuration |= HW_CLOCK_CONFIGURATION;
+    gmain.hardware_configuration |= HW_DISPLAY_CONFIGURATION;
+    gmain.hardware_configuration |= HW_OSC_CONFIGURATION;
+
+    strcpy (gmain.update_host, DEFAULT_UPDATE_HOST);
     strcpy (gmain.update_path, DEFAULT_UPDATE_PATH);
 
     log_init (115200);                                                      // initilize logger on uart
@@ -2665,6 +3002,9 @@ main (void)
     log_message ("irmp_init...");
     log_flush ();
     irmp_init ();                                                           // initialize IRMP
+#if IRMP_USE_INPUT_CAPTURE == 1
+    ircapture_init ();                                                      // initialize IR edge capture
+#endif
     log_message ("power_init...");
     log_flush ();
     power_init ();                                                          // initialize power port pin
@@ -2692,9 +3032,11 @@ main (void)
         esp8266_flash ();
     }
 
-    log_message ("timer2_init...");
+    register_event_handlers ();                                             // must be done before timer jobs post events
+    log_message ("timer_init...");
     log_flush ();
-    timer2_init ();                                                         // initialize timer2 for IRMP, DCF77, EEPROM etc.
+    timer_init ();                                                          // initialize timer2 for IRMP and timer wheel
+    timer_add_job (&clock_job, clock_timer, TIMER_TICKS_PER_SEC, TIMER_TICKS_PER_SEC);     // soft clock
     log_message ("wpsbutton_init...");
     log_flush ();
     wpsbutton_init ();                                                      // initialize GPIO for WPS button
@@ -2850,28 +3192,44 @@ main (void)
 
     ldr_init ();                                                            // initialize LDR (ADC)
     dcf77_init ();                                                          // initialize DCF77
+    discipline_init ();                                                     // initialize clock discipline
     alarm_init ();                                                          // initialize alarm routines
     temp_init ();                                                           // initialize DS18xx
     dfplayer_init ();                                                       // initialize DFPlayer
 
-    ds3231_flag = 1;
+    event_post (EVENT_DS3231);
 
     stop_time = uptime + 3;                                                 // wait 3 seconds for IR signal...
     display_set_status_or_minute_leds (1, 1, 1);                            // show white status or minute LEDs
 
     while (uptime < stop_time)
     {
+        timer_run ();                                                       // run expired timer jobs, increments uptime
+
         if (irmp_get_data (&irmp_data))                                     // got IR signal?
         {
+            uint_fast8_t    learn_additional = remote_ir_is_ok_key (&irmp_data);    // OK key of learned remote?
+
             display_set_status_led (1, 0, 0);                               // yes, show red status LED
             delay_sec (1);                                                  // and wait 1 second
             (void) irmp_get_data (&irmp_data);                              // flush input of IRMP now
             display_set_status_led (0, 0, 0);                               // and switch status LED off
 
-            debug_log_message ("calling IR learn function");
-            if (remote_ir_learn ())                                         // learn IR commands
+            if (learn_additional)
+            {
+                debug_log_message ("calling IR learn function for additional remote");
+                if (remote_ir_learn_additional ())                          // learn IR commands of additional remote
+                {
+                    remote_ir_write_codes_to_eep ();                        // if successful, save them in EEPROM
+                }
+            }
+            else
             {
-                remote_ir_write_codes_to_eep ();                            // if successful, save them in EEPROM
+                debug_log_message ("calling IR learn function");
+                if (remote_ir_learn ())                                     // learn IR commands
+                {
+                    remote_ir_write_codes_to_eep ();                        // if successful, save them in EEPROM
+                }
             }
             break;                                                          // and break the loop
         }
@@ -2893,6 +3251,7 @@ main (void)
 
     if (grtc.rtc_is_up && rtc_get_date_time (&gmain.tm))
     {
+        discipline_set_time (&gmain.tm, 0);
         gmain.year    = gmain.tm.tm_year + 1900;
         gmain.month   = gmain.tm.tm_mon  + 1;
         gmain.mday    = gmain.tm.tm_mday;
@@ -2910,6 +3269,10 @@ main (void)
 
     while (1)
     {
+        timer_run ();                                                                   // run expired timer jobs, they post events
+        task_run ();                                                                    // run cooperative tasks
+        i2c_poll ();                                                                    // start deferred I2C transaction, reset bus if one hangs
+
         local_uptime = uptime;                                                          // cache volatile variable in local variable
 
         if (esp8266_is_up)                                                              // if user pressed user button, set ESP8266 to AP mode
@@ -2950,6 +3313,23 @@ main (void)
 
         schedule_esp8266_messages ();
 
+        if (display.realtime_mode && local_uptime >= realtime_stop_time)                                    // realtime frames timed out
+        {
+            display_realtime_stop ();
+            log_printf ("realtime mode stopped: %lu frames, %lu records lost, %lu checksum errors, %lu resyncs\r\n",
+                        realtime_frames, realtime_lost, esp8266.frame_errors, esp8266.frame_resyncs);
+            display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;                                             // back to clock mode
+        }
+
+        if (display_sync_animation_late (&sync_late_ticks))                                                 // synchronized animation started
+        {
+            send_esp8266_sync_late (sync_late_ticks);
+        }
+        else if (display_sync_animation_missed ())                                                          // synchronized start missed
+        {
+            esp8266_send_cmd ("sync-missed", (const char *) NULL, 0);
+        }
+
         if (display.animation_stop_flag &&                                                                  // no animation running
             show_icon_stop_time == 0 &&                                                                     // no temperature display
             ! display.do_display_icon &&                                                                    // no icon display
@@ -2997,7 +3377,7 @@ main (void)
                 {
                     esp8266_is_online = 1;
                     log_message ("esp8266 now online");
-                    net_time_flag = 1;
+                    event_post (EVENT_NET_TIME);
                 }
             }
         }
@@ -3008,39 +3388,14 @@ main (void)
 
             status_led_cnt = 50;
 
-            if (grtc.rtc_is_up)
-            {
-                rtc_set_date_time (&gmain.tm);
-            }
-
-            if (gmain.hour != (uint_fast8_t) gmain.tm.tm_hour || gmain.minute != (uint_fast8_t) gmain.tm.tm_min)
-            {
-                if (esp8266.is_online)
-                {
-                    var_send_tm ();
-                }
-                display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
-            }
-
-            gmain.year    = gmain.tm.tm_year + 1900;
-            gmain.month   = gmain.tm.tm_mon  + 1;
-            gmain.mday    = gmain.tm.tm_mday;
-            gmain.wday    = gmain.tm.tm_wday;
-            gmain.hour    = gmain.tm.tm_hour;
-            gmain.minute  = gmain.tm.tm_min;
-            gmain.second  = gmain.tm.tm_sec;
-
-            log_printf ("dcf77: %s %4d-%02d-%02d %02d:%02d:%02d\r\n",
-                         wdays_en[gmain.tm.tm_wday], gmain.tm.tm_year + 1900, gmain.tm.tm_mon + 1, gmain.tm.tm_mday,
-                         gmain.tm.tm_hour, gmain.tm.tm_min, gmain.tm.tm_sec);
-        }
-
-        if (ds3231_flag)
-        {
-            if (grtc.rtc_is_up && rtc_get_date_time (&gmain.tm))
+            if (discipline_reference (DISCIPLINE_SOURCE_DCF77, &gmain.tm))   // step, else offset is slewed
             {
                 if (gmain.hour != (uint_fast8_t) gmain.tm.tm_hour || gmain.minute != (uint_fast8_t) gmain.tm.tm_min)
                 {
+                    if (esp8266.is_online)
+                    {
+                        var_send_tm ();
+                    }
                     display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
                 }
 
@@ -3051,203 +3406,14 @@ main (void)
                 gmain.hour    = gmain.tm.tm_hour;
                 gmain.minute  = gmain.tm.tm_min;
                 gmain.second  = gmain.tm.tm_sec;
-
-                log_printf ("read rtc: %s %4d-%02d-%02d %02d:%02d:%02d\r\n",
-                            wdays_en[gmain.tm.tm_wday], gmain.tm.tm_year + 1900, gmain.tm.tm_mon + 1, gmain.tm.tm_mday,
-                            gmain.tm.tm_hour, gmain.tm.tm_min, gmain.tm.tm_sec);
-            }
-
-            ds3231_flag = 0;
-        }
-
-        if (display.animation_stop_flag && ! display.do_display_icon && display.automatic_brightness && ldr_conversion_flag)
-        {
-            ldr_start_conversion ();
-            ldr_conversion_flag = 0;
-        }
-
-        if (net_time_flag)
-        {
-            if (esp8266.is_online)
-            {
-                display_set_status_led (0, 0, 1);                           // light blue status LED
-                status_led_cnt = STATUS_LED_FLASH_TIME;
-                timeserver_start_timeserver_request ();                     // start a timeserver request, answer follows...
-            }
-
-            net_time_flag = 0;
-            net_time_countdown = 3800;                                      // next net time after 3800 sec
-        }
-
-        if (show_time_flag)                                                 // set every full minute
-        {
-            show_time_flag = 0;
-
-            gmain.tm.tm_year = gmain.year - 1900;
-            gmain.tm.tm_mon  = gmain.month - 1;
-            gmain.tm.tm_mday = gmain.mday;
-            gmain.tm.tm_hour = gmain.hour;
-            gmain.tm.tm_min  = gmain.minute;
-            gmain.tm.tm_sec  = gmain.second;
-            gmain.tm.tm_wday = gmain.wday;
-
-            if (esp8266.is_online)
-            {
-                var_send_tm ();
-            }
-
-            // display_clock_flag = 0;                                      // don't reset flag
-
-            if (night_check_night_times (0, display.display_power_is_on, gmain.wday, gmain.hour * 60 + gmain.minute))
-            {
-                if (display.display_power_is_on)                            // display currently on
-                {                                                           // switch off display AND ambilight
-                    display_clock_flag = set_display_power (FALSE, TRUE);
-                }
-                else                                                        // display currently off
-                {                                                           // switch on display, but NOT ambilight
-                    display_clock_flag = set_display_power (TRUE, FALSE);
-                }
-
-                log_printf ("Found Timer: %s at %02d:%02d\r\n", display.display_power_is_on ? "on" : "off", gmain.hour, gmain.minute);
-            }
-
-            if (night_check_night_times (1, display.ambilight_power_is_on, gmain.wday, gmain.hour * 60 + gmain.minute))
-            {
-                display_set_ambilight_power (! display.ambilight_power_is_on);
-                log_printf ("Found Timer: ambilight %s at %02d:%02d\r\n", display.ambilight_power_is_on ? "on" : "off", gmain.hour, gmain.minute);
-            }
-
-            if (display_clock_flag == 0)                                    // no night time found
-            {
-#if WCLOCK24H == 1
-                display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
-#else
-                if (gmain.minute % 5)
-                {
-                    display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_MINUTES; // only update minute LEDs
-                }
-                else
-                {
-                    display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;
-                }
-#endif
-            }
-        }
-
-        if (half_minute_flag)
-        {
-            half_minute_flag = 0;
-
-            if (display.display_power_is_on)
-            {
-                if (net_time_countdown > 3800 - 30)         // waiting for timeserver response?
-                {                                           // no, else don't communicate with ESP8266 (icon vs. timeserver response)
-                    log_printf ("net_time_countdown = %d, don't check overlays\r\n", net_time_countdown);
-                }
-                else
-                {
-                    static uint_fast16_t    last_year;
-                    uint_fast16_t           mmdd;
-                    uint_fast8_t            overlay_idx;
-                    uint_fast8_t            overlay_max_interval;
-
-                    mmdd                    = (gmain.month << 8) + gmain.mday;
-                    overlay_max_interval    = 0;
-
-                    if (last_year != gmain.year)
-                    {
-                        uint_fast8_t    i;
-
-                        last_year = gmain.year;
-
-                        for (i = 0; i < overlay.n_overlays; i++)
-                        {
-                            overlay_calc_dates (i, last_year);
-                        }
-                    }
-
-                    // overlay step 1: find maximum overlay interval which matches current minute
-                    // overlays with matching dates have higher priority
-                    for (overlay_idx = 0; overlay_idx < overlay.n_overlays; overlay_idx++)
-                    {
-                        if (overlay.overlays[overlay_idx].flags & OVERLAY_FLAG_ACTIVE)
-                        {
-                            if ((gmain.minute % overlay.overlays[overlay_idx].interval) == 0)
-                            {
-                                if (overlay.overlays[overlay_idx].date_start == 0 ||
-                                    (mmdd >= overlay.overlays[overlay_idx].date_start && mmdd <= overlay.overlays[overlay_idx].date_end))
-                                {
-                                    if (overlay.overlays[overlay_idx].interval > overlay_max_interval)
-                                    {
-                                        overlay_max_interval = overlay.overlays[overlay_idx].interval;
-                                        show_overlay_idx = overlay_idx;
-                                    }
-                                    else if (overlay.overlays[overlay_idx].interval == overlay_max_interval)
-                                    {
-                                        if (overlay.overlays[overlay_idx].date_start != 0)
-                                        {
-                                            overlay_max_interval = overlay.overlays[overlay_idx].interval;
-                                            show_overlay_idx = overlay_idx;
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
             }
-        }
-
-        if (measure_temperature_flag)
-        {
-            measure_temperature_flag = 0;
-
-            if (ds18xx.is_up)
-            {
-                temp_start_conversion (read_temperature_flag);          // start conversion, wait if read_temperature_flag is also set
-            }
-        }
-
-        if (read_temperature_flag)
-        {
-            read_temperature_flag = 0;
 
-            if (ds18xx.is_up)
-            {
-                ds18xx_temperature_index = temp_read_temp_index ();
-                log_printf ("DS18xxx temperature: %d%s\r\n", ds18xx_temperature_index / 2, (ds18xx_temperature_index % 2) ? ".5" : "");
-
-                if (esp8266.is_online)
-                {
-                    var_send_ds18xx_temp_index ();
-                }
-            }
-            else
-            {
-                ds18xx_temperature_index = 0xFF;
-            }
+            log_printf ("dcf77: %s %4d-%02d-%02d %02d:%02d:%02d\r\n",
+                         wdays_en[gmain.tm.tm_wday], gmain.tm.tm_year + 1900, gmain.tm.tm_mon + 1, gmain.tm.tm_mday,
+                         gmain.tm.tm_hour, gmain.tm.tm_min, gmain.tm.tm_sec);
         }
 
-        if (read_rtc_temperature_flag)
-        {
-            read_rtc_temperature_flag = 0;
-
-            if (grtc.rtc_is_up)
-            {
-                rtc_temperature_index = rtc_get_temperature_index ();
-                log_printf ("RTC temperature: %d%s\r\n", rtc_temperature_index / 2, (rtc_temperature_index % 2) ? ".5" : "");
-
-                if (esp8266.is_online)
-                {
-                    var_send_rtc_temp_index ();
-                }
-            }
-            else
-            {
-                rtc_temperature_index = 0xFF;
-            }
-        }
+        event_dispatch ();                                                              // call handlers of events posted by timer jobs
 
         if (show_overlay_idx < MAX_OVERLAYS)                                                                // overlay to show?
         {
@@ -3431,7 +3597,7 @@ main (void)
             display_clock_flag = DISPLAY_CLOCK_FLAG_UPDATE_ALL;                         // update display after ticker
         }
 
-        if (display_clock_flag)                                                         // refresh display (time/mode changed)
+        if (display_clock_flag && ! display.realtime_mode)                              // refresh display (time/mode changed)
         {
             debug_log_message ("update display");
 
@@ -3471,23 +3637,6 @@ main (void)
             display_clock_flag = DISPLAY_CLOCK_FLAG_NONE;
         }
 
-        if (animation_flag)
-        {
-            animation_flag = 0;
-            display_animation ();
-        }
-
-        if (ambilight_clock_tick)                                                       // set 20 times per ambilight LED in clock mode
-        {
-            ambilight_clock_tick = 0;
-            display_seconds (ambilight_clock_led_idx);
-        }
-
-        if (seconds_flag)                                                               // currently not used
-        {
-            seconds_flag = 0;
-        }
-
         cmd = remote_ir_get_cmd ();                                                     // get IR command
 
         if (cmd != REMOTE_IR_CMD_INVALID)                                               // got IR command, light green LED
@@ -3719,18 +3868,8 @@ main (void)
 
         if (time_changed)
         {
-            if (grtc.rtc_is_up)
-            {
-                gmain.tm.tm_year = gmain.year - 1900;
-                gmain.tm.tm_mon  = gmain.month - 1;
-                gmain.tm.tm_mday = gmain.mday;
-                gmain.tm.tm_hour = gmain.hour;
-                gmain.tm.tm_min  = gmain.minute;
-                gmain.tm.tm_sec  = gmain.second;
-                gmain.tm.tm_wday = gmain.wday;
-                rtc_set_date_time (&gmain.tm);
-            }
-
+            soft_clock_to_tm (&gmain.tm);
+            discipline_set_time (&gmain.tm, 1);
             time_changed = 0;
         }
 
@@ -3857,6 +3996,8 @@ main (void)
                 last_minute = gmain.minute;
             }
         }
+
+        event_idle ();                                                                  // sleep until next interrupt if no event queued
     }
 
     return 0;
@@ -0,0 +1,113 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * profile.c - measure CPU cycles of hot code sections with DWT cycle counter
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The DWT cycle counter is enabled by timer_init(), see timer.c.
+ * Each entry is written either only by an ISR or only by the main loop, so recording needs no locking.
+ * profile_get_entry() copies an entry with interrupts disabled.
+ *
+ * Enable profiling by compiling with -DPROFILE=1, see profile.h.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include "profile.h"
+
+#if PROFILE == 1
+
+PROFILE_ENTRY                   profile_entries[N_PROFILE_IDS] =
+{
+    { "TIM2_IRQHandler", 0, 0, 0, 0 },                                  // PROFILE_TIM2_ISR
+    { "irmp_ISR", 0, 0, 0, 0 },                                         // PROFILE_IRMP_ISR
+    { "display_animation", 0, 0, 0, 0 },                                // PROFILE_DISPLAY_ANIMATION
+    { "led_refresh", 0, 0, 0, 0 },                                      // PROFILE_LED_REFRESH
+    { "esp8266_get_message", 0, 0, 0, 0 },                              // PROFILE_ESP8266_GET_MESSAGE
+    { "dfplayer_read_message", 0, 0, 0, 0 },                            // PROFILE_DFPLAYER_READ_MESSAGE
+};                                                                      // names of animations: see profile_set_name()
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * record cycles of one call
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+profile_record (uint_fast8_t id, uint32_t cycles)
+{
+    PROFILE_ENTRY *     p;
+
+    if (id < N_PROFILE_IDS)
+    {
+        p = &profile_entries[id];
+
+        if (p->calls == 0 || cycles < p->min_cycles)
+        {
+            p->min_cycles = cycles;
+        }
+
+        if (cycles > p->max_cycles)
+        {
+            p->max_cycles = cycles;
+        }
+
+        p->sum_cycles += cycles;
+        p->calls++;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * set name of an entry
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+profile_set_name (uint_fast8_t id, const char * name)
+{
+    if (id < N_PROFILE_IDS)
+    {
+        profile_entries[id].name = name;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get copy of an entry, returns 0 if entry is not used
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+profile_get_entry (uint_fast8_t id, PROFILE_ENTRY * entry)
+{
+    uint_fast8_t    rtc = 0;
+
+    if (id < N_PROFILE_IDS && profile_entries[id].name)
+    {
+        __disable_irq();
+        *entry = profile_entries[id];
+        __enable_irq();
+        rtc = 1;
+    }
+
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reset all counters
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+profile_reset (void)
+{
+    uint_fast8_t    id;
+
+    for (id = 0; id < N_PROFILE_IDS; id++)
+    {
+        __disable_irq();
+        profile_entries[id].calls       = 0;
+        profile_entries[id].min_cycles  = 0;
+        profile_entries[id].max_cycles  = 0;
+        profile_entries[id].sum_cycles  = 0;
+        __enable_irq();
+    }
+}
+
+#endif // PROFILE == 1
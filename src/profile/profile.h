@@ -0,0 +1,81 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * profile.h - measure CPU cycles of hot code sections with DWT cycle counter
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#ifndef PROFILE
+#define PROFILE                         0                                   // 0: profiling off, 1: profiling on
+#endif
+
+#if PROFILE == 1
+
+#include <stdint.h>
+
+#if defined (STM32F10X)
+#  include "stm32f10x.h"
+#elif defined (STM32F4XX)
+#  include "stm32f4xx.h"
+#endif
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * profile ids
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define PROFILE_TIM2_ISR                0                                   // TIM2_IRQHandler()
+#define PROFILE_IRMP_ISR                1                                   // irmp_ISR()
+#define PROFILE_DISPLAY_ANIMATION       2                                   // display_animation()
+#define PROFILE_LED_REFRESH             3                                   // ws2812_refresh(), sk6812_refresh(), apa102_refresh(), tftled_refresh()
+#define PROFILE_ESP8266_GET_MESSAGE     4                                   // esp8266_get_message()
+#define PROFILE_DFPLAYER_READ_MESSAGE   5                                   // dfplayer_read_message()
+#define PROFILE_ANIMATION               6                                   // first animation function, see display.animations[]
+#define PROFILE_MAX_ANIMATIONS          16                                  // max. number of animation functions
+#define N_PROFILE_IDS                   (PROFILE_ANIMATION + PROFILE_MAX_ANIMATIONS)
+
+typedef struct
+{
+    const char *                        name;
+    uint32_t                            calls;
+    uint32_t                            min_cycles;
+    uint32_t                            max_cycles;
+    uint64_t                            sum_cycles;
+} PROFILE_ENTRY;
+
+extern PROFILE_ENTRY                    profile_entries[N_PROFILE_IDS];
+
+extern void                             profile_record (uint_fast8_t, uint32_t);
+extern void                             profile_set_name (uint_fast8_t, const char *);
+extern uint_fast8_t                     profile_get_entry (uint_fast8_t, PROFILE_ENTRY *);
+extern void                             profile_reset (void);
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * PROFILE_START(id) must be placed where a declaration is allowed, PROFILE_STOP(id) in the same block.
+ * PROFILE_STOP_IDX(id, idx) records the cycles for id + idx, e.g. PROFILE_ANIMATION + animation mode.
+ * PROFILE_RECORD(id, cycles) records cycles which have already been measured by the caller.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define PROFILE_START(id)               uint32_t profile_start_##id = DWT->CYCCNT
+#define PROFILE_STOP(id)                profile_record ((id), DWT->CYCCNT - profile_start_##id)
+#define PROFILE_STOP_IDX(id, idx)       profile_record ((id) + (idx), DWT->CYCCNT - profile_start_##id)
+#define PROFILE_RECORD(id, cycles)      profile_record ((id), (cycles))
+#define PROFILE_SET_NAME(id, name)      profile_set_name ((id), (name))
+
+#else // PROFILE == 0
+
+#define PROFILE_START(id)               do { } while (0)
+#define PROFILE_STOP(id)                do { } while (0)
+#define PROFILE_STOP_IDX(id, idx)       do { } while (0)
+#define PROFILE_RECORD(id, cycles)      do { } while (0)
+#define PROFILE_SET_NAME(id, name)      do { } while (0)
+
+#endif // PROFILE == 1
+
+#endif // PROFILE_H
@@ -3,12 +3,20 @@
  *
  * Copyright (c) 2014-2026 Frank Meyer - frank(at)uclock.de
  *
+ * The learned codes are stored in irmp_data_array[]: slot i < N_REMOTE_IR_CMDS holds the code of command i,
+ * the remaining slots up to EEPROM_MAX_IR_CODES hold codes of an additional remote, see remote_ir_learn_additional().
+ * remote_ir_cmds[] maps every slot to its command.
+ *
+ * A received code is looked up in an open addressing hash table which is rebuilt whenever the codes are loaded or
+ * learned. Repetition frames are not looked up at all, they repeat the last command according to remote_ir_repeat_curve[].
+ *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 2 of the License, or
  * (at your option) any later version.
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
+#include <string.h>
 #include "wclock24h-config.h"
 #include "irmp.h"
 #include "remote-ir.h"
@@ -17,10 +25,147 @@
 #include "eeprom-data.h"
 #include "log.h"
 
-static  IRMP_DATA   irmp_data_array[N_REMOTE_IR_CMDS];
+#define REMOTE_IR_MAX_CODES         EEPROM_MAX_IR_CODES                             // learned codes incl. additional remote
+#define REMOTE_IR_HASH_SIZE         64                                              // must be power of 2 and > REMOTE_IR_MAX_CODES
+#define REMOTE_IR_HASH_EMPTY        0xFF
+
+#if REMOTE_IR_HASH_SIZE <= REMOTE_IR_MAX_CODES
+#error value for REMOTE_IR_HASH_SIZE is too low
+#endif
+
+#define REMOTE_IR_CMD_IS_REPEATABLE(c)  ((c) >= REMOTE_IR_CMD_DECREMENT_DISPLAY_MODE && (c) <= REMOTE_IR_CMD_INCREMENT_BRIGHTNESS)
+
+typedef struct
+{
+    uint8_t                 repetitions;                                            // step starts with this repetition frame
+    uint8_t                 divider;                                                // repeat command every n-th frame, 0: never
+} REMOTE_IR_REPEAT_STEP;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * key repeat acceleration, NEC sends a repetition frame every 108 msec:
+ *  frames  1 -  3: ignored                 (delay of about 300 msec)
+ *  frames  4 - 11: every 3rd frame         (about 3 commands per second)
+ *  frames 12 - 23: every 2nd frame         (about 5 commands per second)
+ *  frames 24 -   : every frame             (about 9 commands per second)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static const REMOTE_IR_REPEAT_STEP remote_ir_repeat_curve[] =
+{
+    {  1, 0 },
+    {  4, 3 },
+    { 12, 2 },
+    { 24, 1 },
+};
+
+#define N_REMOTE_IR_REPEAT_STEPS    (sizeof (remote_ir_repeat_curve) / sizeof (REMOTE_IR_REPEAT_STEP))
+
+static  IRMP_DATA   irmp_data_array[REMOTE_IR_MAX_CODES];
+static  uint8_t     remote_ir_cmds[REMOTE_IR_MAX_CODES];                            // command of slot, REMOTE_IR_CMD_INVALID: unused
+static  uint8_t     remote_ir_hash[REMOTE_IR_HASH_SIZE];                            // slot of code, REMOTE_IR_HASH_EMPTY: unused
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: pack IRMP data into PACKED_IRMP_DATA_SIZE bytes, same format as in EEPROM
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+pack_irmp_data (uint8_t * packed_irmp_data, IRMP_DATA * ip)
+{
+    packed_irmp_data[0] = ip->protocol;
+    packed_irmp_data[1] = ip->address & 0xFF;
+    packed_irmp_data[2] = ip->address >> 8;
+    packed_irmp_data[3] = ip->command & 0xFF;
+    packed_irmp_data[4] = ip->command >> 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: hash of packed IRMP data (FNV-1a)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+hash_irmp_data (IRMP_DATA * ip)
+{
+    uint8_t         packed_irmp_data[PACKED_IRMP_DATA_SIZE];
+    uint32_t        h = 2166136261UL;
+    uint_fast8_t    i;
+
+    pack_irmp_data (packed_irmp_data, ip);
+
+    for (i = 0; i < PACKED_IRMP_DATA_SIZE; i++)
+    {
+        h ^= packed_irmp_data[i];
+        h *= 16777619UL;
+    }
+
+    return (h ^ (h >> 16)) & (REMOTE_IR_HASH_SIZE - 1);
+}
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * search for a previously stored IR command
+ * INTERN: compare IRMP data
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+equal_irmp_data (IRMP_DATA * ip1, IRMP_DATA * ip2)
+{
+    return ip1->protocol == ip2->protocol && ip1->address == ip2->address && ip1->command == ip2->command;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: rebuild hash table, first slot wins if a code has been stored twice
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+rebuild_hash (void)
+{
+    uint_fast8_t    i;
+    uint_fast8_t    h;
+
+    memset (remote_ir_hash, REMOTE_IR_HASH_EMPTY, sizeof (remote_ir_hash));
+
+    for (i = 0; i < REMOTE_IR_MAX_CODES; i++)
+    {
+        if (remote_ir_cmds[i] != REMOTE_IR_CMD_INVALID)
+        {
+            h = hash_irmp_data (&irmp_data_array[i]);
+
+            while (remote_ir_hash[h] != REMOTE_IR_HASH_EMPTY && ! equal_irmp_data (&irmp_data_array[remote_ir_hash[h]], &irmp_data_array[i]))
+            {
+                h = (h + 1) & (REMOTE_IR_HASH_SIZE - 1);
+            }
+
+            if (remote_ir_hash[h] == REMOTE_IR_HASH_EMPTY)
+            {
+                remote_ir_hash[h] = i;
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: lookup command of IR code
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+lookup_cmd (IRMP_DATA * ip)
+{
+    uint_fast8_t    h;
+
+    h = hash_irmp_data (ip);
+
+    while (remote_ir_hash[h] != REMOTE_IR_HASH_EMPTY)
+    {
+        if (equal_irmp_data (&irmp_data_array[remote_ir_hash[h]], ip))
+        {
+            return remote_ir_cmds[remote_ir_hash[h]];
+        }
+
+        h = (h + 1) & (REMOTE_IR_HASH_SIZE - 1);
+    }
+
+    return REMOTE_IR_CMD_INVALID;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * search for a previously stored IR command while learning
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 static uint_fast8_t
@@ -31,17 +176,67 @@ search_cmd (IRMP_DATA * ip, uint_fast8_t max_cmds)
 
     for (i = 0; i < max_cmds; i++)
     {
-        if (ip->protocol == irmp_data_array[i].protocol &&
-            ip->address  == irmp_data_array[i].address  &&
-            ip->command  == irmp_data_array[i].command)
+        if (equal_irmp_data (ip, &irmp_data_array[i]))
         {
             rtc = i;
             break;
         }
     }
+
     return rtc;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: set default command mapping, no additional remote
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+set_default_cmds (void)
+{
+    uint_fast8_t    i;
+
+    for (i = 0; i < REMOTE_IR_MAX_CODES; i++)
+    {
+        remote_ir_cmds[i] = (i < N_REMOTE_IR_CMDS) ? i : REMOTE_IR_CMD_INVALID;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: get text of command
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static const char *
+get_cmd_text (uint_fast8_t cmd)
+{
+    const char * t = "";
+
+    switch (cmd)
+    {
+        case REMOTE_IR_CMD_POWER:                         t = "power off/on";                     break;
+        case REMOTE_IR_CMD_OK:                            t = "ok";                               break;
+        case REMOTE_IR_CMD_DECREMENT_DISPLAY_MODE:        t = "decrement display mode";           break;
+        case REMOTE_IR_CMD_INCREMENT_DISPLAY_MODE:        t = "increment display mode";           break;
+        case REMOTE_IR_CMD_DECREMENT_ANIMATION_MODE:      t = "decrement animation mode";         break;
+        case REMOTE_IR_CMD_INCREMENT_ANIMATION_MODE:      t = "increment animation mode";         break;
+        case REMOTE_IR_CMD_DECREMENT_HOUR:                t = "decrement hour";                   break;
+        case REMOTE_IR_CMD_INCREMENT_HOUR:                t = "increment hour";                   break;
+        case REMOTE_IR_CMD_DECREMENT_MINUTE:              t = "decrement minute";                 break;
+        case REMOTE_IR_CMD_INCREMENT_MINUTE:              t = "increment minute";                 break;
+        case REMOTE_IR_CMD_DECREMENT_BRIGHTNESS_RED:      t = "decrement red brightness";         break;
+        case REMOTE_IR_CMD_INCREMENT_BRIGHTNESS_RED:      t = "increment red brightness";         break;
+        case REMOTE_IR_CMD_DECREMENT_BRIGHTNESS_GREEN:    t = "decrement green brightness";       break;
+        case REMOTE_IR_CMD_INCREMENT_BRIGHTNESS_GREEN:    t = "increment green brightness";       break;
+        case REMOTE_IR_CMD_DECREMENT_BRIGHTNESS_BLUE:     t = "decrement blue brightness";        break;
+        case REMOTE_IR_CMD_INCREMENT_BRIGHTNESS_BLUE:     t = "increment blue brightness";        break;
+        case REMOTE_IR_CMD_DECREMENT_BRIGHTNESS:          t = "decrement global brightness";      break;
+        case REMOTE_IR_CMD_INCREMENT_BRIGHTNESS:          t = "increment global brightness";      break;
+        case REMOTE_IR_CMD_AUTO_BRIGHTNESS_CONTROL:       t = "toggle auto brightness";           break;
+        case REMOTE_IR_CMD_GET_TEMPERATURE:               t = "get temperature";                  break;
+    }
+
+    return t;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * read an IR command
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -49,30 +244,51 @@ search_cmd (IRMP_DATA * ip, uint_fast8_t max_cmds)
 uint_fast8_t
 remote_ir_get_cmd (void)
 {
-    static uint_fast16_t    frame;
-    static uint_fast8_t     last_repetition_flag;
+    static uint_fast8_t     last_cmd = REMOTE_IR_CMD_INVALID;
+    static uint_fast8_t     repetitions;
     IRMP_DATA               irmp_data;
+    uint_fast8_t            step;
     uint_fast8_t            rtc = REMOTE_IR_CMD_INVALID;
 
     if (irmp_get_data (&irmp_data))
     {
-        frame++;
+        if (irmp_data.flags & IRMP_FLAG_REPETITION)                                 // key is held
+        {
+            if (repetitions < 0xFF)
+            {
+                repetitions++;
+            }
+
+            if (REMOTE_IR_CMD_IS_REPEATABLE(last_cmd))
+            {
+                for (step = N_REMOTE_IR_REPEAT_STEPS - 1; step > 0; step--)
+                {
+                    if (repetitions >= remote_ir_repeat_curve[step].repetitions)
+                    {
+                        break;
+                    }
+                }
 
-        if (last_repetition_flag == 0 && (irmp_data.flags & IRMP_FLAG_REPETITION))  // ignore first repetition frame
+                if (remote_ir_repeat_curve[step].divider &&
+                    (repetitions - remote_ir_repeat_curve[step].repetitions) % remote_ir_repeat_curve[step].divider == 0)
+                {
+                    rtc = last_cmd;
+                }
+            }
+        }
+        else
         {
-            last_repetition_flag = 1;
-            return rtc;
+            repetitions = 0;
+            last_cmd    = lookup_cmd (&irmp_data);
+            rtc         = last_cmd;
         }
-
-        last_repetition_flag = (irmp_data.flags & IRMP_FLAG_REPETITION) ? 1: 0;
-        rtc = search_cmd (&irmp_data, N_REMOTE_IR_CMDS);
     }
 
     return rtc;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------------------------
- * learn remote IR control
+ * learn remote IR control, removes codes of additional remote
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 uint_fast8_t
@@ -85,29 +301,7 @@ remote_ir_learn (void)
 
     for (i = 0; i < N_REMOTE_IR_CMDS; i++)
     {
-        switch (i)
-        {
-            case REMOTE_IR_CMD_POWER:                         t = "power off/on";                     break;
-            case REMOTE_IR_CMD_OK:                            t = "ok";                               break;
-            case REMOTE_IR_CMD_DECREMENT_DISPLAY_MODE:        t = "decrement display mode";           break;
-            case REMOTE_IR_CMD_INCREMENT_DISPLAY_MODE:        t = "increment display mode";           break;
-            case REMOTE_IR_CMD_DECREMENT_ANIMATION_MODE:      t = "decrement animation mode";         break;
-            case REMOTE_IR_CMD_INCREMENT_ANIMATION_MODE:      t = "increment animation mode";         break;
-            case REMOTE_IR_CMD_DECREMENT_HOUR:                t = "decrement hour";                   break;
-            case REMOTE_IR_CMD_INCREMENT_HOUR:                t = "increment hour";                   break;
-            case REMOTE_IR_CMD_DECREMENT_MINUTE:              t = "decrement minute";                 break;
-            case REMOTE_IR_CMD_INCREMENT_MINUTE:              t = "increment minute";                 break;
-            case REMOTE_IR_CMD_DECREMENT_BRIGHTNESS_RED:      t = "decrement red brightness";         break;
-            case REMOTE_IR_CMD_INCREMENT_BRIGHTNESS_RED:      t = "increment red brightness";         break;
-            case REMOTE_IR_CMD_DECREMENT_BRIGHTNESS_GREEN:    t = "decrement green brightness";       break;
-            case REMOTE_IR_CMD_INCREMENT_BRIGHTNESS_GREEN:    t = "increment green brightness";       break;
-            case REMOTE_IR_CMD_DECREMENT_BRIGHTNESS_BLUE:     t = "decrement blue brightness";        break;
-            case REMOTE_IR_CMD_INCREMENT_BRIGHTNESS_BLUE:     t = "increment blue brightness";        break;
-            case REMOTE_IR_CMD_DECREMENT_BRIGHTNESS:          t = "decrement global brightness";      break;
-            case REMOTE_IR_CMD_INCREMENT_BRIGHTNESS:          t = "increment global brightness";      break;
-            case REMOTE_IR_CMD_AUTO_BRIGHTNESS_CONTROL:       t = "toggle auto brightness";           break;
-            case REMOTE_IR_CMD_GET_TEMPERATURE:               t = "get temperature";                  break;
-        }
+        t = get_cmd_text (i);
 
         display_set_ticker ((const unsigned char *) t, 1);
         log_message (t);
@@ -131,17 +325,102 @@ remote_ir_learn (void)
         }
     }
 
+    set_default_cmds ();
+    rebuild_hash ();
+
     display_set_ticker ((const unsigned char *) "  Thank you!", 1);
 
     return rtc;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * learn additional remote IR control, replaces codes of previously learned additional remote
+ *
+ * The keys of the additional remote are stored in the free slots. A key which is already known is ignored,
+ * the power key skips a command - after it has been learned, also the power key of the additional remote.
+ * If all keys are skipped, the previously learned additional remote is restored, so RAM and EEPROM stay equal.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+remote_ir_learn_additional (void)
+{
+    IRMP_DATA       old_irmp_data_array[REMOTE_IR_MAX_CODES];
+    uint8_t         old_remote_ir_cmds[REMOTE_IR_MAX_CODES];
+    IRMP_DATA       irmp_data;
+    uint_fast8_t    slot = N_REMOTE_IR_CMDS;
+    uint_fast8_t    cmd;
+    uint_fast8_t    i;
+    const char *    t;
+
+    memcpy (old_irmp_data_array, irmp_data_array, sizeof (irmp_data_array));
+    memcpy (old_remote_ir_cmds, remote_ir_cmds, sizeof (remote_ir_cmds));
+
+    for (i = N_REMOTE_IR_CMDS; i < REMOTE_IR_MAX_CODES; i++)
+    {
+        remote_ir_cmds[i] = REMOTE_IR_CMD_INVALID;
+    }
+
+    rebuild_hash ();
+
+    for (i = 0; i < N_REMOTE_IR_CMDS && slot < REMOTE_IR_MAX_CODES; i++)
+    {
+        t = get_cmd_text (i);
+
+        display_set_ticker ((const unsigned char *) t, 1);
+        log_message (t);
+
+        irmp_get_data (&irmp_data);
+
+        while (1)
+        {
+            if (irmp_get_data (&irmp_data) && (irmp_data.flags & IRMP_FLAG_REPETITION) == 0)
+            {
+                cmd = lookup_cmd (&irmp_data);
+
+                if (cmd == REMOTE_IR_CMD_INVALID)                                               // new key: store it
+                {
+                    irmp_data_array[slot]   = irmp_data;
+                    remote_ir_cmds[slot]    = i;
+                    slot++;
+                    rebuild_hash ();
+                    break;
+                }
+                else if (cmd == REMOTE_IR_CMD_POWER)                                            // user wants to skip it
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (slot == N_REMOTE_IR_CMDS)                                                                   // nothing learned: restore old remote
+    {
+        memcpy (irmp_data_array, old_irmp_data_array, sizeof (irmp_data_array));
+        memcpy (remote_ir_cmds, old_remote_ir_cmds, sizeof (remote_ir_cmds));
+        rebuild_hash ();
+    }
+
+    display_set_ticker ((const unsigned char *) "  Thank you!", 1);
+
+    return slot > N_REMOTE_IR_CMDS;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check if code is the OK key, e.g. to start learning of an additional remote control
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+remote_ir_is_ok_key (IRMP_DATA * ip)
+{
+    return lookup_cmd (ip) == REMOTE_IR_CMD_OK;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * read IR codes from EEPROM
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 uint_fast8_t
-remote_ir_read_codes_from_eep (void)
+remote_ir_read_codes_from_eep (uint32_t eep_version)
 {
     uint8_t         packed_irmp_data[PACKED_IRMP_DATA_SIZE];
     uint_fast8_t    rtc = 0;
@@ -151,7 +430,7 @@ remote_ir_read_codes_from_eep (void)
         uint_fast8_t    i;
         uint_fast16_t   start_addr = EEPROM_DATA_OFFSET_IRMP_DATA;
 
-        for (i = 0; i < N_REMOTE_IR_CMDS; i++)
+        for (i = 0; i < REMOTE_IR_MAX_CODES; i++)
         {
             rtc = eep_read (start_addr, (uint8_t *) &packed_irmp_data, PACKED_IRMP_DATA_SIZE);
 
@@ -161,6 +440,24 @@ remote_ir_read_codes_from_eep (void)
 
             start_addr += PACKED_IRMP_DATA_SIZE;
         }
+
+        set_default_cmds ();
+
+        if (eep_version >= EEPROM_VERSION_3_0)
+        {
+            rtc = eep_read (EEPROM_DATA_OFFSET_IR_CODE_CMDS + N_REMOTE_IR_CMDS, remote_ir_cmds + N_REMOTE_IR_CMDS,
+                            REMOTE_IR_MAX_CODES - N_REMOTE_IR_CMDS);
+
+            for (i = N_REMOTE_IR_CMDS; i < REMOTE_IR_MAX_CODES; i++)
+            {
+                if (remote_ir_cmds[i] >= N_REMOTE_IR_CMDS)
+                {
+                    remote_ir_cmds[i] = REMOTE_IR_CMD_INVALID;
+                }
+            }
+        }
+
+        rebuild_hash ();
     }
 
     return rtc;
@@ -181,17 +478,18 @@ remote_ir_write_codes_to_eep (void)
         uint_fast8_t    i;
         uint_fast16_t   start_addr = EEPROM_DATA_OFFSET_IRMP_DATA;
 
-        for (i = 0; i < N_REMOTE_IR_CMDS; i++)
+        for (i = 0; i < REMOTE_IR_MAX_CODES; i++)
         {
-            packed_irmp_data[0]         = irmp_data_array[i].protocol;
-            packed_irmp_data[1]         = irmp_data_array[i].address & 0xFF;
-            packed_irmp_data[2]         = irmp_data_array[i].address >> 8;
-            packed_irmp_data[3]         = irmp_data_array[i].command & 0xFF;
-            packed_irmp_data[4]         = irmp_data_array[i].command >> 8;
+            pack_irmp_data (packed_irmp_data, &irmp_data_array[i]);
 
             rtc = eep_write (start_addr, (uint8_t *) &packed_irmp_data, PACKED_IRMP_DATA_SIZE);
             start_addr += PACKED_IRMP_DATA_SIZE;
         }
+
+        if (rtc)
+        {
+            rtc = eep_write (EEPROM_DATA_OFFSET_IR_CODE_CMDS, remote_ir_cmds, REMOTE_IR_MAX_CODES);
+        }
     }
 
     return rtc;
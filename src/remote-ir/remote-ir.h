@@ -12,6 +12,9 @@
 #ifndef REMOTE_IR_H
 #define REMOTE_IR_H
 
+#include <stdint.h>
+#include "irmp.h"
+
 #define REMOTE_IR_CMD_INVALID                       0xFF
 
 /*-----------------------------------------------------
@@ -70,7 +73,9 @@
 
 extern uint_fast8_t remote_ir_get_cmd (void);
 extern uint_fast8_t remote_ir_learn (void);
-extern uint_fast8_t remote_ir_read_codes_from_eep (void);
+extern uint_fast8_t remote_ir_learn_additional (void);
+extern uint_fast8_t remote_ir_is_ok_key (IRMP_DATA *);
+extern uint_fast8_t remote_ir_read_codes_from_eep (uint32_t);
 extern uint_fast8_t remote_ir_write_codes_to_eep (void);
 
 #endif
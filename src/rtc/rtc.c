@@ -13,6 +13,7 @@
 #include "i2c.h"
 #include "eep.h"
 #include "eeprom-data.h"
+#include "event.h"
 
 #define DS1307_OR_DS3231_ADDR   0xD0                            // I2C address << 1
 #define FIRST_TIME_REG          0x00                            // address of first time register
@@ -47,6 +48,7 @@
 #define DS3231_CTRL_REG         0x0E                            // address of control register
 #define DS3231_CTRL_DEFAULT     0x00                            // default value: all bits reset
 
+#define DS3231_AGING_REG        0x10                            // aging offset, signed, 1 LSB = ~0.1 ppm, positive: slower
 #define DS3231_TEMP_REG_HI      0x11                            // 8 upper bytes: integer part
 #define DS3231_TEMP_REG_LO      0x12                            // 2 lower bytes: fractional part 0x00=0.00, 0x01=0.25, ... 0x03=0.75
 
@@ -63,6 +65,11 @@ RTC_GLOBALS                     grtc =
 
 static uint_fast8_t             is_ds1307;
 
+static I2C_TRANSACTION          rtc_date_time_transaction;
+static uint8_t                  rtc_date_time_buffer[7];
+static I2C_TRANSACTION          rtc_temperature_transaction;
+static uint8_t                  rtc_temperature_buffer[2];
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * INTERN: read data
  *
@@ -211,6 +218,22 @@ rtc_set_date_time (struct tm * tmp)
     return rtc;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: convert BCD registers of date & time into struct tm
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+rtc_buffer_to_tm (uint8_t * buffer, struct tm * tmp)
+{
+    tmp->tm_sec  = BCD_TO_INT(buffer[0]);
+    tmp->tm_min  = BCD_TO_INT(buffer[1]);
+    tmp->tm_hour = BCD_TO_INT(buffer[2]);
+    tmp->tm_wday = buffer[3] - 1;
+    tmp->tm_mday = BCD_TO_INT(buffer[4]);
+    tmp->tm_mon  = BCD_TO_INT(buffer[5]) - 1;
+    tmp->tm_year = BCD_TO_INT(buffer[6]) + 100;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * get date & time
  *
@@ -231,13 +254,7 @@ rtc_get_date_time (struct tm * tmp)
 
         if (rtc)
         {
-            tmp->tm_sec  = BCD_TO_INT(buffer[0]);
-            tmp->tm_min  = BCD_TO_INT(buffer[1]);
-            tmp->tm_hour = BCD_TO_INT(buffer[2]);
-            tmp->tm_wday = buffer[3] - 1;
-            tmp->tm_mday = BCD_TO_INT(buffer[4]);
-            tmp->tm_mon  = BCD_TO_INT(buffer[5]) - 1;
-            tmp->tm_year = BCD_TO_INT(buffer[6]) + 100;
+            rtc_buffer_to_tm (buffer, tmp);
         }
     }
     else
@@ -247,6 +264,68 @@ rtc_get_date_time (struct tm * tmp)
     return rtc;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: callback of asynchronous read of date & time, called in ISR
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+rtc_date_time_done (I2C_TRANSACTION * t)
+{
+    (void) t;
+    event_post_from_isr (EVENT_RTC_DATE_TIME);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start asynchronous read of date & time, EVENT_RTC_DATE_TIME is posted when done
+ *
+ * Return values:
+ *  0   Failed
+ *  1   Successful
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+rtc_start_get_date_time (void)
+{
+    uint_fast8_t    rtc = 0;
+
+    if (grtc.rtc_is_up)
+    {
+        rtc_date_time_transaction.slave_addr      = DS1307_OR_DS3231_ADDR;
+        rtc_date_time_transaction.is_16_bit_addr  = 0;
+        rtc_date_time_transaction.is_read         = 1;
+        rtc_date_time_transaction.addr            = FIRST_TIME_REG;
+        rtc_date_time_transaction.data            = rtc_date_time_buffer;
+        rtc_date_time_transaction.cnt             = 7;
+        rtc_date_time_transaction.callback        = rtc_date_time_done;
+
+        rtc = i2c_submit (&rtc_date_time_transaction);
+    }
+
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get result of asynchronous read of date & time, call after EVENT_RTC_DATE_TIME
+ *
+ * Return values:
+ *  0   Failed
+ *  1   Successful
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+rtc_get_date_time_result (struct tm * tmp)
+{
+    uint_fast8_t    rtc = 0;
+
+    if (rtc_date_time_transaction.status == I2C_OK)
+    {
+        rtc_buffer_to_tm (rtc_date_time_buffer, tmp);
+        rtc = 1;
+    }
+
+    return rtc;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * read configuration from EEPROM
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -325,6 +404,69 @@ rtc_set_temp_correction (uint_fast8_t new_rtc_temp_correction)
     return grtc.rtc_temp_correction;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get aging offset of DS3231
+ *
+ * Return values:
+ *  0   Failed, DS1307 has no aging register
+ *  1   Successful
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+rtc_get_aging (int_fast8_t * agingp)
+{
+    uint8_t         value;
+    uint_fast8_t    rtc = 0;
+
+    if (grtc.rtc_is_up && ! is_ds1307)
+    {
+        rtc = rtc_read (DS3231_AGING_REG, &value, 1);
+
+        if (rtc)
+        {
+            *agingp = (int8_t) value;
+        }
+    }
+
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * set aging offset of DS3231, takes effect with next temperature conversion
+ *
+ * Return values:
+ *  0   Failed, DS1307 has no aging register
+ *  1   Successful
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+rtc_set_aging (int_fast8_t aging)
+{
+    uint8_t         value = (uint8_t) aging;
+    uint_fast8_t    rtc = 0;
+
+    if (grtc.rtc_is_up && ! is_ds1307)
+    {
+        rtc = rtc_write (DS3231_AGING_REG, &value, 1);
+    }
+
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: convert temperature registers into temperature index
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+rtc_buffer_to_temperature_index (uint8_t * buffer)
+{
+    uint_fast8_t    index;
+
+    index = (buffer[0] << 1) | ((buffer[1] & 0x02) >> 1);               // multiply integer part by 2, add 1 if fractional part >= 2
+    index -= grtc.rtc_temp_correction;                                  // correct temperature due to self-heating
+    return index;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * get temperature index
  *
@@ -342,14 +484,74 @@ rtc_get_temperature_index (void)
 
     if (grtc.rtc_is_up)
     {
-        index = rtc_read (DS3231_TEMP_REG_HI, buffer, 2);
-
-        if (index)
+        if (rtc_read (DS3231_TEMP_REG_HI, buffer, 2))
         {
-            index = (buffer[0] << 1) | ((buffer[1] & 0x02) >> 1);     // multiply integer part by 2, add 1 if fractional part >= 2
-            index -= grtc.rtc_temp_correction;                        // correct temperature due to self-heating
+            index = rtc_buffer_to_temperature_index (buffer);
         }
     }
     grtc.rtc_temperature_index = index;
     return index;
 }
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: callback of asynchronous read of temperature, called in ISR
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+rtc_temperature_done (I2C_TRANSACTION * t)
+{
+    (void) t;
+    event_post_from_isr (EVENT_RTC_TEMPERATURE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start asynchronous read of temperature, EVENT_RTC_TEMPERATURE is posted when done
+ *
+ * Return values:
+ *  0   Failed
+ *  1   Successful
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+rtc_start_get_temperature_index (void)
+{
+    uint_fast8_t    rtc = 0;
+
+    if (grtc.rtc_is_up)
+    {
+        rtc_temperature_transaction.slave_addr      = DS1307_OR_DS3231_ADDR;
+        rtc_temperature_transaction.is_16_bit_addr  = 0;
+        rtc_temperature_transaction.is_read         = 1;
+        rtc_temperature_transaction.addr            = DS3231_TEMP_REG_HI;
+        rtc_temperature_transaction.data            = rtc_temperature_buffer;
+        rtc_temperature_transaction.cnt             = 2;
+        rtc_temperature_transaction.callback        = rtc_temperature_done;
+
+        rtc = i2c_submit (&rtc_temperature_transaction);
+    }
+
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get result of asynchronous read of temperature, call after EVENT_RTC_TEMPERATURE
+ *
+ * Return values:
+ *    index =   0 ->   0C
+ *    index = 250 -> 125C
+ *    index = 255 -> Error
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+rtc_get_temperature_index_result (void)
+{
+    uint_fast8_t    index = 0xFF;
+
+    if (rtc_temperature_transaction.status == I2C_OK)
+    {
+        index = rtc_buffer_to_temperature_index (rtc_temperature_buffer);
+    }
+
+    grtc.rtc_temperature_index = index;
+    return index;
+}
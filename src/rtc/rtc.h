@@ -31,10 +31,16 @@ extern RTC_GLOBALS              grtc;
 extern uint_fast8_t rtc_init (uint32_t);
 extern uint_fast8_t rtc_set_date_time (struct tm *);
 extern uint_fast8_t rtc_get_date_time (struct tm *);
+extern uint_fast8_t rtc_start_get_date_time (void);
+extern uint_fast8_t rtc_get_date_time_result (struct tm *);
 extern uint_fast8_t rtc_read_config_from_eep (uint32_t);
 extern uint_fast8_t rtc_write_config_to_eep (void);
 extern uint_fast8_t rtc_get_temp_correction (void);
 extern uint_fast8_t rtc_set_temp_correction (uint_fast8_t);
+extern uint_fast8_t rtc_get_aging (int_fast8_t *);
+extern uint_fast8_t rtc_set_aging (int_fast8_t);
 extern uint_fast8_t rtc_get_temperature_index (void);
+extern uint_fast8_t rtc_start_get_temperature_index (void);
+extern uint_fast8_t rtc_get_temperature_index_result (void);
 
 #endif
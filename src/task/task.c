@@ -0,0 +1,150 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * task.c - cooperative tasks (protothreads) for the main loop
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * task_run() is called by the main loop and calls every running task once. The time a task runs without
+ * yielding is measured with the DWT cycle counter (enabled by timer_init()), the longest run is kept
+ * in task_stats.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <string.h>
+
+#if defined (STM32F10X)
+#  include "stm32f10x.h"
+#elif defined (STM32F4XX)
+#  include "stm32f4xx.h"
+#endif
+
+#include "log.h"
+#include "task.h"
+
+TASK_STATS                      task_stats;
+
+static TASK *                   task_list;                              // list of running tasks
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * start task, a running task is restarted from the beginning
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+task_start (TASK * t, TASK_FUNC func, const char * name)
+{
+    if (! task_is_running (t))
+    {
+        t->next     = task_list;
+        task_list   = t;
+    }
+
+    t->func = func;
+    t->name = name;
+    t->lc   = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * stop task
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+task_stop (TASK * t)
+{
+    TASK **     tp;
+
+    for (tp = &task_list; *tp; tp = &(*tp)->next)
+    {
+        if (*tp == t)
+        {
+            *tp = t->next;
+            break;
+        }
+    }
+
+    t->lc = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check if task is running
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+task_is_running (TASK * t)
+{
+    TASK *  tp;
+
+    for (tp = task_list; tp; tp = tp->next)
+    {
+        if (tp == t)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * call every running task once, call this in main loop
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+task_run (void)
+{
+    TASK *          t;
+    TASK *          next;
+    uint32_t        start_cycles;
+    uint32_t        cycles;
+    uint_fast8_t    rtc;
+
+    for (t = task_list; t; t = next)
+    {
+        next = t->next;                                                 // task may stop itself
+
+        start_cycles = DWT->CYCCNT;
+        rtc = (*t->func) (t);
+        cycles = DWT->CYCCNT - start_cycles;
+
+        task_stats.runs++;
+
+        if (cycles > t->max_cycles)
+        {
+            t->max_cycles = cycles;
+        }
+
+        if (cycles > task_stats.max_cycles)
+        {
+            task_stats.max_cycles   = cycles;
+            task_stats.max_name     = t->name;
+        }
+
+        if (rtc == TASK_EXITED)
+        {
+            task_stop (t);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reset statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+task_reset_stats (void)
+{
+    memset (&task_stats, 0, sizeof (task_stats));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+task_log_stats (void)
+{
+    log_printf ("tasks: %lu runs, longest run without yield: %lu cycles (%s)\r\n", task_stats.runs, task_stats.max_cycles,
+                task_stats.max_name ? task_stats.max_name : "-");
+}
@@ -0,0 +1,72 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * task.h - cooperative tasks (protothreads) for the main loop
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * A task is a function which is called again and again by task_run() until it returns TASK_EXITED.
+ * Between TASK_BEGIN() and TASK_END() the task can wait with TASK_YIELD(), TASK_WAIT_UNTIL() or TASK_DELAY().
+ * Waiting returns to the main loop, the next call resumes after the waiting statement.
+ *
+ * There is no stack per task: local variables are NOT preserved while waiting, use static variables or
+ * members of a struct instead. Do not use switch statements inside a task which contain waiting statements.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef TASK_H
+#define TASK_H
+
+#include <stdint.h>
+#include "timer.h"
+
+#define TASK_WAITING                    0                                   // task is waiting, call it again
+#define TASK_EXITED                     1                                   // task has finished
+
+typedef struct task
+{
+    struct task *                       next;                               // next running task
+    uint_fast8_t                        (*func) (struct task *);            // task function
+    const char *                        name;                               // name of task for statistics
+    uint_fast16_t                       lc;                                 // local continuation: line of last waiting statement
+    uint32_t                            wait_start;                         // timer tick when TASK_DELAY() started
+    uint32_t                            wait_ticks;                         // number of ticks to wait
+    uint32_t                            max_cycles;                         // longest run without yielding in CPU cycles
+} TASK;
+
+typedef uint_fast8_t (*TASK_FUNC) (TASK *);
+
+typedef struct
+{
+    uint32_t                            runs;                               // number of task calls
+    uint32_t                            max_cycles;                         // longest run of any task without yielding in CPU cycles
+    const char *                        max_name;                           // name of task with longest run
+} TASK_STATS;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * task macros
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define TASK_BEGIN(t)                   switch ((t)->lc) { case 0:
+#define TASK_END(t)                     } (t)->lc = 0; return TASK_EXITED
+#define TASK_EXIT(t)                    do { (t)->lc = 0; return TASK_EXITED; } while (0)
+#define TASK_YIELD(t)                   do { (t)->lc = __LINE__; return TASK_WAITING; case __LINE__: ; } while (0)
+#define TASK_WAIT_UNTIL(t, cond)        do { (t)->lc = __LINE__; case __LINE__: if (! (cond)) return TASK_WAITING; } while (0)
+#define TASK_TIMEOUT(t)                 (timer_ticks - (t)->wait_start >= (t)->wait_ticks)
+#define TASK_DELAY(t, ticks)            do { (t)->wait_start = timer_ticks; (t)->wait_ticks = (ticks); TASK_WAIT_UNTIL((t), TASK_TIMEOUT(t)); } while (0)
+#define TASK_WAIT_UNTIL_TIMEOUT(t, cond, ticks)                                                                                              \
+                                        do { (t)->wait_start = timer_ticks; (t)->wait_ticks = (ticks);                                      \
+                                             TASK_WAIT_UNTIL((t), (cond) || TASK_TIMEOUT(t)); } while (0)
+
+extern TASK_STATS                       task_stats;
+
+extern void                             task_start (TASK *, TASK_FUNC, const char *);
+extern void                             task_stop (TASK *);
+extern uint_fast8_t                     task_is_running (TASK *);
+extern void                             task_run (void);
+extern void                             task_reset_stats (void);
+extern void                             task_log_stats (void);
+
+#endif // TASK_H
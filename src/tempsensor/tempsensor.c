@@ -14,6 +14,8 @@
 #include "tempsensor.h"
 #include "eep.h"
 #include "eeprom-data.h"
+#include "event.h"
+#include "task.h"
 
 TEMP_GLOBALS    gtemp =
 {
@@ -22,17 +24,39 @@ TEMP_GLOBALS    gtemp =
 };
 
 /*-----------------------------------------------------------------------------------------------------------------------------------------------
- * temp_start_conversion () - start conversion
+ * temp_conversion_task () - wait for end of conversion without blocking the main loop, then post EVENT_READ_TEMPERATURE
+ *
+ * 9 bit resolution: conversion time ~93 ms, so the DS18xx is not polled before 90 ms.
  *-----------------------------------------------------------------------------------------------------------------------------------------------
  */
-uint_fast8_t
-temp_start_conversion (uint_fast8_t do_wait)
+#define TEMP_CONVERSION_MIN_TICKS       TIMER_MSEC_TO_TICKS(90)
+#define TEMP_CONVERSION_TIMEOUT_TICKS   TIMER_MSEC_TO_TICKS(800)
+
+static TASK                             temp_task;
+
+static uint_fast8_t
+temp_conversion_task (TASK * t)
 {
-    uint_fast8_t    rtc;
+    TASK_BEGIN(t);
+
+    if (ds18xx_start_conversion (0))
+    {
+        TASK_DELAY(t, TEMP_CONVERSION_MIN_TICKS);
+        TASK_WAIT_UNTIL_TIMEOUT(t, ds18xx_conversion_done (), TEMP_CONVERSION_TIMEOUT_TICKS);
+        event_post (EVENT_READ_TEMPERATURE);
+    }
 
-    rtc = ds18xx_start_conversion (do_wait);
+    TASK_END(t);
+}
 
-    return rtc;
+/*-----------------------------------------------------------------------------------------------------------------------------------------------
+ * temp_start_conversion () - start conversion, EVENT_READ_TEMPERATURE is posted when done
+ *-----------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+temp_start_conversion (void)
+{
+    task_start (&temp_task, temp_conversion_task, "ds18xx");
 }
 
 /*-----------------------------------------------------------------------------------------------------------------------------------------------
@@ -30,7 +30,7 @@ extern TEMP_GLOBALS             gtemp;
 extern uint_fast8_t             temp_correction;
 extern uint_fast8_t             temp_index;
 
-extern uint_fast8_t             temp_start_conversion (uint_fast8_t);
+extern void                     temp_start_conversion (void);
 extern uint_fast8_t             temp_read_temp_index (void);
 extern uint_fast8_t             temp_read_config_from_eep (uint32_t);
 extern uint_fast8_t             temp_write_config_to_eep (void);
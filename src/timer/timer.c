@@ -0,0 +1,438 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer.c - timer2 tick and timer wheel for periodic and one-shot jobs
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The timer2 ISR only increments timer_ticks and calls irmp_ISR() and dcf77_ISR(). All other periodic work is done by jobs
+ * which the modules register with timer_add_job(). timer_run() is called by the main loop and expires all jobs
+ * which became due since its last call - in the order of their expiry ticks, so no tick gets lost even if the
+ * main loop has been blocked for a while.
+ *
+ * The jobs are kept in a hierarchical timer wheel with TIMER_LEVELS levels of TIMER_SLOTS slots each:
+ * level 0 holds jobs expiring within the next 64 ticks, level 1 within the next 64 * 64 ticks, and so on.
+ * Jobs of higher levels are cascaded into the lower level when the lower level wraps around. Insert and
+ * remove are O(1).
+ *
+ * If IRMP_USE_INPUT_CAPTURE is 1, IRMP is fed by ircapture_poll() in the main loop. Then the ISR does not call
+ * irmp_ISR() and the tick rate is lowered from F_INTERRUPTS to TIMER_TICKS_PER_SEC = 1600.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <string.h>
+
+#if defined (STM32F10X)
+#  include "stm32f10x.h"
+#  include "stm32f10x_rcc.h"
+#  include "stm32f10x_tim.h"
+#  include "misc.h"
+#elif defined (STM32F4XX)
+#  include "stm32f4xx.h"
+#  include "stm32f4xx_rcc.h"
+#  include "stm32f4xx_tim.h"
+#  include "misc.h"
+#endif
+
+#include "irmp.h"
+#include "dcf77.h"
+#include "log.h"
+#include "profile.h"
+#include "timer.h"
+
+#define TIMER_SLOT_BITS                 6
+#define TIMER_SLOTS                     (1 << TIMER_SLOT_BITS)                  // slots per level
+#define TIMER_SLOT_MASK                 (TIMER_SLOTS - 1)
+#define TIMER_LEVELS                    5
+#define TIMER_MAX_DELAY                 ((1UL << (TIMER_LEVELS * TIMER_SLOT_BITS)) - 1)     // 2^30 ticks, about 19 hours
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer definitions:
+ *
+ *      F_INTERRUPTS    = TIM_CLK / (TIM_PRESCALER + 1) / (TIM_PERIOD + 1)
+ * <==> TIM_PRESCALER   = TIM_CLK / F_INTERRUPTS / (TIM_PERIOD + 1) - 1
+ *
+ * STM32F401:
+ *      TIM_PERIOD      =   8 - 1 =   7
+ *      TIM_PRESCALER   = 700 - 1 = 699
+ *      F_INTERRUPTS    = 84000000 / 700 / 8 = 15000 (0.00% error)
+ * STM32F411:
+ *      TIM_PERIOD      = 101 - 1 = 100
+ *      TIM_PRESCALER   =  66 - 1 =  65
+ *      F_INTERRUPTS    = 100000000 / 66 / 101 = 15015 (0.01% error)
+ * STM32F446:
+ *      TIM_PERIOD      =    6 - 1 =   5
+ *      TIM_PRESCALER   = 1000 - 1 = 999
+ *      F_INTERRUPTS    = 90000000 / 1000 / 6 = 15000 (0.00% error)
+ * STM32F407VE:
+ *      TIM_PERIOD      =    8 - 1 =    7
+ *      TIM_PRESCALER   =  700 - 1 =  699
+ *      F_INTERRUPTS    = 84000000 / 700 / 8 = 15000 (0.00% error)
+ * STM32F103:
+ *      TIM_PERIOD      =   6 - 1 =   5
+ *      TIM_PRESCALER   = 800 - 1 = 799
+ *      F_INTERRUPTS    = 72000000 / 800 / 6 = 15000 (0.00% error)
+ *
+ * IRMP_USE_INPUT_CAPTURE == 1, all STM32:
+ *      TIM_PERIOD      = 10 - 1 = 9
+ *      TIM_PRESCALER   = TIM_CLK / 1600 / 10 - 1, e.g. 5250 - 1 = 5249 for 84 MHz, 5625 - 1 = 5624 for 90 MHz
+ *      ticks/sec       = 84000000 / 5250 / 10 = 1600 (0.00% error)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#if defined (NUCLEO_BOARD)
+#  if defined (STM32F401RE)                                             // STM32F401 Nucleo Board @84MHz
+#    define TIM_CLK                 84000000L                           // 84 MHz
+#    define TIM_PERIOD              7
+#  elif defined (STM32F411RE)                                           // STM32F411 Nucleo Board @100MHz
+#    define TIM_CLK                 100000000L                          // 100 MHz
+#    define TIM_PERIOD              100
+#  elif defined (STM32F446RE)                                           // STM32F446 Nucleo Board @180MHz
+#    define TIM_CLK                 90000000L                           // APB2 clock: 90 MHz
+#    define TIM_PERIOD              5
+#  else
+#    error STM32 unknown
+#  endif
+
+#elif defined (BLACK_BOARD)
+#  if defined (STM32F407VE)                                             // STM32F407VE Black Board @168MHz
+#    define TIM_CLK                 84000000L                           // APB2 clock: 84 MHz
+#    define TIM_PERIOD              7
+#  else
+#    error STM32 unknown
+#  endif
+
+#elif defined (BLACKPILL_BOARD)
+#  if defined (STM32F401CC)                                             // STM32F401 BlackPill Board @84MHz
+#    define TIM_CLK                 84000000L                           // 84 MHz
+#    define TIM_PERIOD              7
+#  elif defined (STM32F411CE)                                           // STM32F411 BlackPill Board @100MHz
+#    define TIM_CLK                 100000000L                          // 100 MHz
+#    define TIM_PERIOD              100
+#  else
+#    error STM32 unknown
+#  endif
+
+#elif defined (BLUEPILL_BOARD)
+#  if defined (STM32F103)                                               // STM32F103 BLuePill Board @72MHz
+#    define TIM_CLK                 72000000L                           // APB2 clock: 72MHz
+#    define TIM_PERIOD              5
+#  else
+#    error STM32 unknown
+#  endif
+
+#else
+#error STM32 unknown
+#endif
+
+#if IRMP_USE_INPUT_CAPTURE == 1
+#  undef  TIM_PERIOD
+#  define TIM_PERIOD                9
+#endif
+
+#define TIM_PRESCALER               ((TIM_CLK / TIMER_TICKS_PER_SEC) / (TIM_PERIOD + 1) - 1)
+
+
+volatile uint32_t               timer_ticks;                            // incremented by timer2 ISR
+TIMER_STATS                     timer_stats;
+
+static TIMER_JOB *              timer_wheel[TIMER_LEVELS][TIMER_SLOTS];
+static uint32_t                 timer_wheel_ticks;                      // next tick to be processed by timer_run()
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: link job into wheel slot
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+timer_link_job (TIMER_JOB * job)
+{
+    TIMER_JOB **    slot;
+    uint32_t        delay;
+    uint_fast8_t    level;
+
+    delay = job->expires - timer_wheel_ticks;
+
+    if ((int32_t) delay < 0)                                            // already due?
+    {                                                                   // yes, expire with next processed tick
+        slot = &timer_wheel[0][timer_wheel_ticks & TIMER_SLOT_MASK];
+    }
+    else
+    {
+        if (delay > TIMER_MAX_DELAY)
+        {
+            delay           = TIMER_MAX_DELAY;
+            job->expires    = timer_wheel_ticks + delay;
+        }
+
+        for (level = 0; level < TIMER_LEVELS - 1; level++)
+        {
+            if (delay < (1UL << ((level + 1) * TIMER_SLOT_BITS)))
+            {
+                break;
+            }
+        }
+
+        slot = &timer_wheel[level][(job->expires >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK];
+    }
+
+    job->next = *slot;
+
+    if (job->next)
+    {
+        job->next->pprev = &job->next;
+    }
+
+    job->pprev  = slot;
+    *slot       = job;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: unlink job from its slot
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+timer_unlink_job (TIMER_JOB * job)
+{
+    *job->pprev = job->next;
+
+    if (job->next)
+    {
+        job->next->pprev = job->pprev;
+    }
+
+    job->next   = (TIMER_JOB *) 0;
+    job->pprev  = (TIMER_JOB **) 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * INTERN: move all jobs of a slot to lower levels
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+timer_cascade (uint_fast8_t level, uint_fast8_t idx)
+{
+    TIMER_JOB *     job;
+
+    while ((job = timer_wheel[level][idx]) != (TIMER_JOB *) 0)
+    {
+        timer_unlink_job (job);
+        timer_link_job (job);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * add job: callback is called after delay ticks and then every interval ticks, interval 0: one-shot job
+ * an already active job is rescheduled
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+timer_add_job (TIMER_JOB * job, TIMER_CALLBACK callback, uint32_t delay, uint32_t interval)
+{
+    if (job->pprev)
+    {
+        timer_unlink_job (job);
+    }
+
+    job->callback   = callback;
+    job->interval   = interval;
+    job->expires    = timer_ticks + delay;
+    timer_link_job (job);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * remove job, a periodic job is stopped even if called from its own callback
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+timer_remove_job (TIMER_JOB * job)
+{
+    if (job->pprev)
+    {
+        timer_unlink_job (job);
+    }
+
+    job->interval = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check if job is active
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+timer_job_is_active (TIMER_JOB * job)
+{
+    return job->pprev ? 1 : 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * expire all jobs which are due, call this in main loop
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+timer_run (void)
+{
+    TIMER_JOB *     work;
+    TIMER_JOB *     job;
+    uint32_t        now;
+    uint32_t        lateness;
+    uint_fast8_t    level;
+    uint_fast8_t    idx;
+
+    now = timer_ticks;
+
+    while ((int32_t) (now - timer_wheel_ticks) >= 0)
+    {
+        idx = timer_wheel_ticks & TIMER_SLOT_MASK;
+
+        if (idx == 0)                                                   // level 0 wrapped around, cascade higher levels
+        {
+            for (level = 1; level < TIMER_LEVELS; level++)
+            {
+                idx = (timer_wheel_ticks >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK;
+                timer_cascade (level, idx);
+
+                if (idx != 0)
+                {
+                    break;
+                }
+            }
+
+            idx = 0;
+        }
+
+        work = timer_wheel[0][idx];                                     // move expired jobs to local work list
+        timer_wheel[0][idx] = (TIMER_JOB *) 0;
+
+        if (work)
+        {
+            work->pprev = &work;
+        }
+
+        timer_wheel_ticks++;
+
+        while ((job = work) != (TIMER_JOB *) 0)
+        {
+            timer_unlink_job (job);
+
+            lateness = now - job->expires;
+
+            if (lateness > timer_stats.max_lateness)
+            {
+                timer_stats.max_lateness = lateness;
+            }
+
+            timer_stats.expired_jobs++;
+
+            (*job->callback) ();
+
+            if (job->interval && ! job->pprev)                          // periodic and not rescheduled by callback?
+            {
+                job->expires += job->interval;                          // no drift, even if called too late
+                timer_link_job (job);
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reset statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+timer_reset_stats (void)
+{
+    memset (&timer_stats, 0, sizeof (timer_stats));
+    timer_stats.isr_min_cycles = 0xFFFFFFFF;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log statistics
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+timer_log_stats (void)
+{
+    log_printf ("timer ISR cycles: min %lu avg %lu max %lu\r\n", timer_stats.isr_min_cycles, timer_stats.isr_avg_cycles, timer_stats.isr_max_cycles);
+    log_printf ("timer jobs: expired %lu, max lateness %lu ticks\r\n", timer_stats.expired_jobs, timer_stats.max_lateness);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer2 IRQ handler: advance tick, call IRMP if not fed by input capture
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+extern void TIM2_IRQHandler (void);                                     // keep compiler happy
+
+void
+TIM2_IRQHandler (void)
+{
+    static uint32_t     avg_cycles_x16;
+    uint32_t            start_cycles;
+    uint32_t            cycles;
+
+    start_cycles = DWT->CYCCNT;
+
+    TIM_ClearITPendingBit(TIM2, TIM_IT_Update);
+
+    timer_ticks++;
+
+#if IRMP_USE_INPUT_CAPTURE == 0
+    PROFILE_START(PROFILE_IRMP_ISR);
+    (void) irmp_ISR ();                                                 // call irmp ISR
+    PROFILE_STOP(PROFILE_IRMP_ISR);
+#endif
+
+    dcf77_ISR ();                                                       // sample DCF77 pin
+
+    cycles = DWT->CYCCNT - start_cycles;
+    PROFILE_RECORD(PROFILE_TIM2_ISR, cycles);
+
+    if (cycles < timer_stats.isr_min_cycles)
+    {
+        timer_stats.isr_min_cycles = cycles;
+    }
+
+    if (cycles > timer_stats.isr_max_cycles)
+    {
+        timer_stats.isr_max_cycles = cycles;
+    }
+
+    avg_cycles_x16 += cycles - (avg_cycles_x16 >> 4);                   // floating average over 16 calls
+    timer_stats.isr_avg_cycles = avg_cycles_x16 >> 4;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * initialize timer2 and DWT cycle counter
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+timer_init (void)
+{
+    TIM_TimeBaseInitTypeDef     tim;
+    NVIC_InitTypeDef            nvic;
+
+    timer_reset_stats ();
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;                     // enable DWT cycle counter
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    TIM_TimeBaseStructInit (&tim);
+    RCC_APB1PeriphClockCmd (RCC_APB1Periph_TIM2, ENABLE);
+
+    tim.TIM_ClockDivision   = TIM_CKD_DIV1;
+    tim.TIM_CounterMode     = TIM_CounterMode_Up;
+    tim.TIM_Period          = TIM_PERIOD;
+    tim.TIM_Prescaler       = TIM_PRESCALER;
+    TIM_TimeBaseInit (TIM2, &tim);
+
+    TIM_ITConfig(TIM2, TIM_IT_Update, ENABLE);
+
+    nvic.NVIC_IRQChannel                    = TIM2_IRQn;
+    nvic.NVIC_IRQChannelCmd                 = ENABLE;
+    nvic.NVIC_IRQChannelPreemptionPriority  = 0x0F;
+    nvic.NVIC_IRQChannelSubPriority         = 0x0F;
+    NVIC_Init (&nvic);
+
+    TIM_Cmd(TIM2, ENABLE);
+}
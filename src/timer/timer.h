@@ -0,0 +1,57 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer.h - timer2 tick and timer wheel for periodic and one-shot jobs
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include "irmp.h"                                                           // F_INTERRUPTS
+
+#if IRMP_USE_INPUT_CAPTURE == 1                                             // IRMP fed by ircapture_poll(), no need for 15 kHz
+#define TIMER_TICKS_PER_SEC             1600                                // timer2 ticks per second, divisible by 64 & 100
+#else
+#define TIMER_TICKS_PER_SEC             F_INTERRUPTS                        // timer2 ticks per second
+#endif
+#define TIMER_MSEC_TO_TICKS(ms)         (((ms) * TIMER_TICKS_PER_SEC) / 1000)
+#define TIMER_HZ_TO_TICKS(hz)           (TIMER_TICKS_PER_SEC / (hz))
+
+typedef void (*TIMER_CALLBACK) (void);
+
+typedef struct timer_job
+{
+    struct timer_job *                  next;                               // next job in same wheel slot
+    struct timer_job **                 pprev;                              // link pointing to this job, NULL: job not active
+    uint32_t                            expires;                            // absolute tick
+    uint32_t                            interval;                           // 0: one-shot job
+    TIMER_CALLBACK                      callback;                           // called from timer_run(), not in ISR context
+} TIMER_JOB;
+
+typedef struct
+{
+    uint32_t                            isr_min_cycles;                     // min. CPU cycles of timer2 ISR
+    uint32_t                            isr_avg_cycles;                     // floating average of CPU cycles of timer2 ISR
+    uint32_t                            isr_max_cycles;                     // max. CPU cycles of timer2 ISR
+    uint32_t                            expired_jobs;                       // number of expired jobs
+    uint32_t                            max_lateness;                       // max. ticks a job has been called too late
+} TIMER_STATS;
+
+extern volatile uint32_t                timer_ticks;
+extern TIMER_STATS                      timer_stats;
+
+extern void                             timer_add_job (TIMER_JOB *, TIMER_CALLBACK, uint32_t, uint32_t);
+extern void                             timer_remove_job (TIMER_JOB *);
+extern uint_fast8_t                     timer_job_is_active (TIMER_JOB *);
+extern void                             timer_run (void);
+extern void                             timer_reset_stats (void);
+extern void                             timer_log_stats (void);
+extern void                             timer_init (void);
+
+#endif // TIMER_H
@@ -41,15 +41,36 @@ TIMESERVER_GLOBALS   timeserver =
 {
     NET_TIME_HOST,                      // timeserver[MAX_IPADDR_LEN + 1]
     NET_TIME_GMT_OFFSET,                // timezone from -12 to +12
-    1                                   // observe summertime
+    1,                                  // observe summertime
+    ""                                  // no timezone rule
 };
 
+static uint_fast8_t     timezone_is_active;                     // flag: timezone has been passed to tz_set_rule()
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * activate timezone: POSIX TZ rule or, if empty, offset in hours with EU summertime
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+timeserver_activate_timezone (void)
+{
+    char    rule[TZ_MAX_RULE_LEN + 1];
+
+    if (! timeserver.timezone_rule[0] || ! tz_set_rule (timeserver.timezone_rule))
+    {
+        tz_legacy_rule (rule, timeserver.timezone, timeserver.observe_summertime);
+        (void) tz_set_rule (rule);
+    }
+
+    timezone_is_active = 1;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * read configuration data from EEPROM
  *-------------------------------------------------------------------------------------------------------------------------------------------
  */
 uint_fast8_t
-timeserver_read_data_from_eep (void)
+timeserver_read_data_from_eep (uint32_t eep_version)
 {
     uint_fast8_t    rtc = 0;
     uint8_t         tz[EEPROM_DATA_SIZE_TIMEZONE];
@@ -88,6 +109,17 @@ timeserver_read_data_from_eep (void)
              }
         }
 
+        if (eep_version >= EEPROM_VERSION_3_1 &&
+            eep_read (EEPROM_DATA_OFFSET_TIMEZONE_RULE, (uint8_t *) timeserver.timezone_rule, EEPROM_DATA_SIZE_TIMEZONE_RULE))
+        {
+            if (*(unsigned char *) timeserver.timezone_rule == 0xFF)
+            {
+                timeserver.timezone_rule[0] = '\0';
+            }
+
+            timeserver.timezone_rule[TZ_MAX_RULE_LEN] = '\0';
+        }
+
         rtc = 1;
     }
     else
@@ -95,8 +127,10 @@ timeserver_read_data_from_eep (void)
         strncpy ((char *) timeserver.timeserver, NET_TIME_HOST, MAX_IPADDR_LEN);
         timeserver.timezone = NET_TIME_GMT_OFFSET;
         timeserver.observe_summertime = 1;
+        timeserver.timezone_rule[0] = '\0';
     }
 
+    timeserver_activate_timezone ();
     return rtc;
 }
 
@@ -153,6 +187,24 @@ timeserver_save_timezone (void)
     return rtc;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * save timezone rule
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast8_t
+timeserver_save_timezone_rule (void)
+{
+    uint_fast8_t    rtc = 0;
+
+    if (eep_is_up &&
+        eep_write (EEPROM_DATA_OFFSET_TIMEZONE_RULE, (uint8_t *) timeserver.timezone_rule, EEPROM_DATA_SIZE_TIMEZONE_RULE))
+    {
+        rtc = 1;
+    }
+
+    return rtc;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * write configuration data to EEPROM
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -163,7 +215,8 @@ timeserver_write_data_to_eep (void)
     uint_fast8_t    rtc = 0;
 
     if (timeserver_save_timeserver () &&
-        timeserver_save_timezone ())
+        timeserver_save_timezone () &&
+        timeserver_save_timezone_rule ())
     {
         rtc = 1;
     }
@@ -172,7 +225,7 @@ timeserver_write_data_to_eep (void)
 }
 
 /*--------------------------------------------------------------------------------------------------------------------------------------
- * set new timezone
+ * set new timezone, a timezone rule is cleared
  *--------------------------------------------------------------------------------------------------------------------------------------
  */
 uint_fast8_t
@@ -192,11 +245,42 @@ timeserver_set_timezone (int_fast16_t newtimezone, uint_fast8_t observe_summerti
             timeserver_save_timezone ();
         }
 
+        if (timeserver.timezone_rule[0])
+        {
+            timeserver.timezone_rule[0] = '\0';
+            timeserver_save_timezone_rule ();
+        }
+
+        timeserver_activate_timezone ();
         rtc = 1;
     }
     return rtc;
 }
 
+/*--------------------------------------------------------------------------------------------------------------------------------------
+ * set new timezone rule (POSIX TZ string), empty rule: use timezone & observe_summertime
+ *--------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+timeserver_set_timezone_rule (char * new_timezone_rule)
+{
+    uint_fast8_t rtc = 0;
+
+    if (strlen (new_timezone_rule) <= TZ_MAX_RULE_LEN && tz_set_rule (new_timezone_rule))
+    {
+        strcpy (timeserver.timezone_rule, new_timezone_rule);
+        timeserver_save_timezone_rule ();
+        timeserver_activate_timezone ();
+        rtc = 1;
+    }
+    else
+    {
+        log_printf ("invalid timezone rule: '%s'\r\n", new_timezone_rule);
+    }
+
+    return rtc;
+}
+
 /*--------------------------------------------------------------------------------------------------------------------------------------
  * set new timeserver
  *--------------------------------------------------------------------------------------------------------------------------------------
@@ -229,79 +313,16 @@ timeserver_start_timeserver_request (void)
 }
 
 /*--------------------------------------------------------------------------------------------------------------------------------------
- * convert time
+ * convert time of timeserver (seconds since 1900) to local time
  *--------------------------------------------------------------------------------------------------------------------------------------
  */
 void
 timeserver_convert_time (struct tm * tmp, uint32_t seconds_since_1900)
 {
-    time_t          curtime;
-    struct tm *     mytm;
-
-    curtime = (time_t) (seconds_since_1900 - 2208988800U);
-    curtime += 3600 * timeserver.timezone;                                  // add seconds for time zone (e.g. MEZ: +3600)
-
-    mytm = my_gmtime (&curtime);                                            // localtime() needs 4K more flash, but does return same as gmtime()
-
-    if (timeserver.observe_summertime)
+    if (! timezone_is_active)                                               // EEPROM not read, use defaults
     {
-        uint_fast8_t    summertime = 0;
-
-        // calculate summer time:
-        if (mytm->tm_mon >= 3 && mytm->tm_mon <= 8)                         // april to september
-        {
-            summertime = 1;
-        }
-        else if (mytm->tm_mon == 2)                                         // march
-        {
-            if (mytm->tm_mday - mytm->tm_wday >= 25)                        // after or equal last sunday in march
-            {
-                if (mytm->tm_wday == 0)                                     // today last sunday?
-                {
-                    if (mytm->tm_hour >= 2)                                 // after 02:00 we have summer time
-                    {
-                        summertime = 1;
-                    }
-                }
-                else
-                {
-                    summertime = 1;
-                }
-            }
-        }
-        else if (mytm->tm_mon == 9)                                         // it's october
-        {
-            summertime = 1;
-
-            if (mytm->tm_mday - mytm->tm_wday >= 25)                        // it's after or equal last sunday in october...
-            {
-                if (mytm->tm_wday == 0)                                     // today last sunday?
-                {
-                    if (mytm->tm_hour >= 3)                                 // after 03:00 we have winter time
-                    {
-                        summertime = 0;
-                    }
-                }
-                else
-                {
-                    summertime = 0;
-                }
-            }
-        }
-
-        if (summertime)
-        {
-            curtime += 3600;                                                // add one hour more for MESZ
-            mytm = my_gmtime (&curtime);                                    // localtime() needs 4K more flash, but does return same as gmtime()
-        }
+        timeserver_activate_timezone ();
     }
 
-    tmp->tm_year    = mytm->tm_year;
-    tmp->tm_mon     = mytm->tm_mon;
-    tmp->tm_mday    = mytm->tm_mday;
-    tmp->tm_wday    = dayofweek (mytm->tm_mday, mytm->tm_mon + 1, mytm->tm_year + 1900);
-    tmp->tm_isdst   = mytm->tm_isdst;
-    tmp->tm_hour    = mytm->tm_hour;
-    tmp->tm_min     = mytm->tm_min;
-    tmp->tm_sec     = mytm->tm_sec;
+    tz_utc_to_tm (tmp, seconds_since_1900 - 2208988800U);                   // seconds since 1970
 }
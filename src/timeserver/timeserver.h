@@ -16,6 +16,7 @@
 #include <stdint.h>
 #include <time.h>
 #include "esp8266.h"
+#include "tz.h"
 
 #define MAX_IPADDR_LEN          16
 #define GMT                      0                              // GMT offset
@@ -25,14 +26,16 @@ typedef struct
     char            timeserver[MAX_IPADDR_LEN + 1];             // timeserver
     int_fast16_t    timezone;                                   // from -12 to +12
     uint_fast8_t    observe_summertime;                         // flag: observe summertime
+    char            timezone_rule[TZ_MAX_RULE_LEN + 1];         // POSIX TZ rule, empty: use timezone & observe_summertime
 } TIMESERVER_GLOBALS;
 
 extern TIMESERVER_GLOBALS   timeserver;
 
-extern uint_fast8_t         timeserver_read_data_from_eep (void);
+extern uint_fast8_t         timeserver_read_data_from_eep (uint32_t);
 extern uint_fast8_t         timeserver_write_data_to_eep (void);
 extern void                 timeserver_cmd (void);
 extern uint_fast8_t         timeserver_set_timezone (int_fast16_t newtimezone, uint_fast8_t observe_summertime);
+extern uint_fast8_t         timeserver_set_timezone_rule (char * new_timezone_rule);
 extern uint_fast8_t         timeserver_set_timeserver (char * new_timeserver);
 extern void                 timeserver_start_timeserver_request (void);
 extern void                 timeserver_convert_time (struct tm * tmp, uint32_t seconds_since_1900);
@@ -0,0 +1,558 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * tz.c - timezone rules (POSIX TZ strings) with precomputed transition table
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * A rule is given as POSIX TZ string, e.g.
+ *
+ *      CET-1CEST,M3.5.0,M10.5.0/3          central europe
+ *      <+0545>-5:45                        nepal, no DST
+ *      AEST-10AEDT,M10.1.0,M4.1.0/3        australia (south), DST around new year
+ *
+ * Offsets may have minutes and seconds, times of transitions may be negative or exceed 24 hours (RFC 8536). The UTC instants of
+ * all transitions of the current and the next year are computed once per year, a conversion is a binary search in this table.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <string.h>
+#include "tz.h"
+
+#define TZ_DATE_JULIAN1                 0                                   // Jn: day 1..365, February 29 is never counted
+#define TZ_DATE_JULIAN0                 1                                   // n: day 0..365, February 29 is counted
+#define TZ_DATE_MONTH                   2                                   // Mm.w.d: day d of week w of month m
+
+#define TZ_DEFAULT_TIME                 (2 * 3600L)                         // default time of transition: 02:00:00
+#define TZ_SECONDS_PER_DAY              86400L
+#define TZ_N_TRANSITIONS                4                                   // transitions of current and next year
+
+#define TZ_IS_LEAP_YEAR(y)              (((y) % 4) == 0 && (((y) % 100) != 0 || ((y) % 400) == 0))
+
+typedef struct
+{
+    uint8_t                             type;                               // TZ_DATE_JULIAN1, TZ_DATE_JULIAN0 or TZ_DATE_MONTH
+    uint8_t                             month;                              // Mm.w.d: month 1..12
+    uint8_t                             week;                               // Mm.w.d: week 1..5, 5: last week
+    uint8_t                             wday;                               // Mm.w.d: day of week 0..6, 0: sunday
+    uint16_t                            day;                                // Jn, n: day of year
+    int32_t                             time;                               // local time of transition in seconds
+} TZ_DATE;
+
+typedef struct
+{
+    int32_t                             std_offset;                         // offset of standard time to UTC in seconds, east positive
+    int32_t                             dst_offset;                         // offset of daylight saving time to UTC in seconds
+    uint_fast8_t                        has_dst;                            // 1: rule has daylight saving time
+    TZ_DATE                             start;                              // start of daylight saving time
+    TZ_DATE                             end;                                // end of daylight saving time
+} TZ_RULE;
+
+typedef struct
+{
+    uint32_t                            utc;                                // UTC of transition, seconds since 1970
+    int32_t                             offset;                             // offset to UTC after transition in seconds
+    uint_fast8_t                        is_dst;                             // 1: daylight saving time after transition
+} TZ_TRANSITION;
+
+static const uint16_t                   days_before_month[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+static TZ_RULE                          tz_rule;                            // default: UTC
+static TZ_TRANSITION                    transitions[TZ_N_TRANSITIONS];
+static uint_fast8_t                     n_transitions;
+static uint_fast8_t                     table_is_valid;
+static uint32_t                         table_start;                        // table is valid from January 1st of its year...
+static uint32_t                         table_end;                          // ... until January 1st of next year
+static TZ_TRANSITION                    before_table;                       // offset before first transition of table
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get days since 1970-01-01, valid for years 1970..2105
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+tz_days (uint_fast16_t year, uint_fast8_t month, uint_fast8_t mday)
+{
+    uint32_t    days;
+
+    days = (year - 1970) * 365L + (year - 1969) / 4 - (year - 1901) / 100 + (year - 1601) / 400 + days_before_month[month - 1] + mday - 1;
+
+    if (month > 2 && TZ_IS_LEAP_YEAR(year))
+    {
+        days++;
+    }
+
+    return days;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get year of day since 1970-01-01
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint_fast16_t
+tz_year (uint32_t days)
+{
+    uint_fast16_t   year = 1970 + (days * 4) / 1461;                        // estimation, at most one year off
+
+    if (tz_days (year, 1, 1) > days)
+    {
+        year--;
+    }
+    else if (tz_days (year + 1, 1, 1) <= days)
+    {
+        year++;
+    }
+
+    return year;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get day of transition in given year, days since 1970-01-01
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+tz_date_to_days (const TZ_DATE * dp, uint_fast16_t year)
+{
+    uint32_t        days;
+    uint_fast8_t    days_in_month;
+    uint_fast8_t    mday;
+
+    if (dp->type == TZ_DATE_JULIAN1)
+    {
+        days = tz_days (year, 1, 1) + dp->day - 1;
+
+        if (dp->day >= 60 && TZ_IS_LEAP_YEAR(year))                         // skip February 29
+        {
+            days++;
+        }
+    }
+    else if (dp->type == TZ_DATE_JULIAN0)
+    {
+        days = tz_days (year, 1, 1) + dp->day;
+    }
+    else
+    {
+        days            = tz_days (year, dp->month, 1);
+        days_in_month   = (dp->month == 12 ? 31 : tz_days (year, dp->month + 1, 1) - days);
+        mday            = (dp->wday + 7 - (days + 4) % 7) % 7 + (dp->week - 1) * 7;   // 1970-01-01 was a thursday
+
+        while (mday >= days_in_month)                                       // week 5: last week of month
+        {
+            mday -= 7;
+        }
+
+        days += mday;
+    }
+
+    return days;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * insert transition into table, sorted by UTC
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+tz_insert_transition (int64_t utc, int32_t offset, uint_fast8_t is_dst)
+{
+    uint_fast8_t    i = n_transitions;
+
+    if (utc < 0 || utc > 0xFFFFFFFFLL)                                      // outside of 1970..2106: cannot be converted
+    {
+        return;
+    }
+
+    while (i > 0 && transitions[i - 1].utc > utc)
+    {
+        transitions[i] = transitions[i - 1];
+        i--;
+    }
+
+    transitions[i].utc      = (uint32_t) utc;
+    transitions[i].offset   = offset;
+    transitions[i].is_dst   = is_dst;
+    n_transitions++;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * compute transitions of given and next year
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+tz_compute_table (uint_fast16_t year)
+{
+    uint_fast16_t   y;
+    int64_t         utc;
+
+    n_transitions = 0;
+
+    for (y = year; y <= year + 1; y++)
+    {
+        utc = (int64_t) tz_date_to_days (&tz_rule.start, y) * TZ_SECONDS_PER_DAY + tz_rule.start.time - tz_rule.std_offset;
+        tz_insert_transition (utc, tz_rule.dst_offset, 1);
+
+        utc = (int64_t) tz_date_to_days (&tz_rule.end, y) * TZ_SECONDS_PER_DAY + tz_rule.end.time - tz_rule.dst_offset;
+        tz_insert_transition (utc, tz_rule.std_offset, 0);
+    }
+
+    before_table.is_dst = ! transitions[0].is_dst;                          // southern hemisphere: DST at start of year
+    before_table.offset = before_table.is_dst ? tz_rule.dst_offset : tz_rule.std_offset;
+
+    table_start     = tz_days (year, 1, 1) * TZ_SECONDS_PER_DAY;
+    table_end       = tz_days (year + 1, 1, 1) * TZ_SECONDS_PER_DAY;
+    table_is_valid  = 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * parse number
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static const char *
+tz_parse_number (const char * p, uint_fast16_t * valuep, uint_fast16_t min, uint_fast16_t max)
+{
+    uint_fast16_t   value = 0;
+    uint_fast8_t    digits = 0;
+
+    while (*p >= '0' && *p <= '9' && digits < 3)
+    {
+        value = 10 * value + (*p - '0');
+        digits++;
+        p++;
+    }
+
+    if (! digits || value < min || value > max)
+    {
+        return (const char *) 0;
+    }
+
+    *valuep = value;
+    return p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * parse name of time zone: at least 3 letters or quoted in <...>
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static const char *
+tz_parse_name (const char * p)
+{
+    const char *    start;
+
+    if (*p == '<')
+    {
+        start = ++p;
+
+        while (*p && *p != '>')
+        {
+            p++;
+        }
+
+        if (*p != '>' || p - start < 3)
+        {
+            return (const char *) 0;
+        }
+
+        return p + 1;
+    }
+
+    start = p;
+
+    while ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))
+    {
+        p++;
+    }
+
+    if (p - start < 3)
+    {
+        return (const char *) 0;
+    }
+
+    return p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * parse time or offset: [+|-]hh[:mm[:ss]]
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static const char *
+tz_parse_time (const char * p, int32_t * secondsp, uint_fast16_t max_hours)
+{
+    uint_fast16_t   hours;
+    uint_fast16_t   minutes = 0;
+    uint_fast16_t   seconds = 0;
+    uint_fast8_t    negative = 0;
+
+    if (*p == '+' || *p == '-')
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    p = tz_parse_number (p, &hours, 0, max_hours);
+
+    if (p && *p == ':')
+    {
+        p = tz_parse_number (p + 1, &minutes, 0, 59);
+
+        if (p && *p == ':')
+        {
+            p = tz_parse_number (p + 1, &seconds, 0, 59);
+        }
+    }
+
+    if (p)
+    {
+        *secondsp = (int32_t) (hours * 3600L + minutes * 60 + seconds);
+
+        if (negative)
+        {
+            *secondsp = -*secondsp;
+        }
+    }
+
+    return p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * parse date of transition: Jn, n or Mm.w.d, optionally followed by /time
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static const char *
+tz_parse_date (const char * p, TZ_DATE * dp)
+{
+    uint_fast16_t   value = 0;
+
+    if (*p == 'M')
+    {
+        dp->type = TZ_DATE_MONTH;
+        p = tz_parse_number (p + 1, &value, 1, 12);
+        dp->month = value;
+
+        if (p && *p == '.')
+        {
+            p = tz_parse_number (p + 1, &value, 1, 5);
+            dp->week = value;
+
+            if (p && *p == '.')
+            {
+                p = tz_parse_number (p + 1, &value, 0, 6);
+                dp->wday = value;
+            }
+            else
+            {
+                p = (const char *) 0;
+            }
+        }
+        else
+        {
+            p = (const char *) 0;
+        }
+    }
+    else if (*p == 'J')
+    {
+        dp->type = TZ_DATE_JULIAN1;
+        p = tz_parse_number (p + 1, &value, 1, 365);
+        dp->day = value;
+    }
+    else
+    {
+        dp->type = TZ_DATE_JULIAN0;
+        p = tz_parse_number (p, &value, 0, 365);
+        dp->day = value;
+    }
+
+    dp->time = TZ_DEFAULT_TIME;
+
+    if (p && *p == '/')
+    {
+        p = tz_parse_time (p + 1, &dp->time, 167);
+    }
+
+    return p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * set rule, empty string: UTC
+ *
+ * Return values:
+ *  0   Failed, syntax error, old rule is kept
+ *  1   Successful
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+tz_set_rule (const char * rule)
+{
+    TZ_RULE         r;
+    const char *    p = rule;
+    int32_t         offset;
+
+    memset (&r, 0, sizeof (TZ_RULE));
+
+    if (*p)
+    {
+        p = tz_parse_name (p);
+
+        if (p)
+        {
+            p = tz_parse_time (p, &offset, 24);
+            r.std_offset = -offset;                                         // POSIX: offset is west positive
+        }
+
+        if (p && *p)
+        {
+            p = tz_parse_name (p);
+            r.has_dst    = 1;
+            r.dst_offset = r.std_offset + 3600;
+
+            if (p && *p && *p != ',')
+            {
+                p = tz_parse_time (p, &offset, 24);
+                r.dst_offset = -offset;
+            }
+
+            if (p && *p == ',')
+            {
+                p = tz_parse_date (p + 1, &r.start);
+
+                if (p && *p == ',')
+                {
+                    p = tz_parse_date (p + 1, &r.end);
+                }
+                else
+                {
+                    p = (const char *) 0;
+                }
+            }
+            else if (p && ! *p)                                             // no rule: use US rule as glibc does
+            {
+                (void) tz_parse_date ("M3.2.0", &r.start);
+                (void) tz_parse_date ("M11.1.0", &r.end);
+            }
+        }
+    }
+
+    if (! p || *p)
+    {
+        return 0;
+    }
+
+    tz_rule         = r;
+    table_is_valid  = 0;
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * build rule from hour offset to UTC and flag for summer time, summer time with EU rule (01:00 UTC)
+ *
+ * buf must hold TZ_MAX_RULE_LEN + 1 characters
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+tz_legacy_rule (char * buf, int_fast16_t hours, uint_fast8_t observe_summertime)
+{
+    if (observe_summertime)
+    {
+        sprintf (buf, "STD%dDST,M3.5.0/%d,M10.5.0/%d", (int) -hours, (int) (1 + hours), (int) (2 + hours));
+    }
+    else
+    {
+        sprintf (buf, "STD%d", (int) -hours);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * get offset of local time to UTC in seconds, utc: seconds since 1970-01-01 00:00:00 UTC
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+int32_t
+tz_get_offset (uint32_t utc, uint_fast8_t * is_dstp)
+{
+    const TZ_TRANSITION *   tp;
+    uint_fast8_t            lo;
+    uint_fast8_t            hi;
+    uint_fast8_t            mid;
+
+    if (! tz_rule.has_dst)
+    {
+        *is_dstp = 0;
+        return tz_rule.std_offset;
+    }
+
+    if (! table_is_valid || utc < table_start || utc >= table_end)          // once per year
+    {
+        tz_compute_table (tz_year (utc / TZ_SECONDS_PER_DAY));
+    }
+
+    lo = 0;
+    hi = n_transitions;
+
+    while (lo < hi)                                                         // find first transition after utc
+    {
+        mid = (lo + hi) / 2;
+
+        if (transitions[mid].utc <= utc)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    tp = lo ? &transitions[lo - 1] : &before_table;
+
+    *is_dstp = tp->is_dst;
+    return tp->offset;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * convert UTC to local time, utc: seconds since 1970-01-01 00:00:00 UTC
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+tz_utc_to_tm (struct tm * tmp, uint32_t utc)
+{
+    uint_fast8_t    is_dst;
+    uint32_t        local;
+    uint32_t        days;
+    uint32_t        seconds;
+    uint_fast16_t   year;
+    uint_fast16_t   yday;
+    uint_fast16_t   first_yday;
+    uint_fast8_t    mon;
+    uint_fast8_t    leap;
+
+    local   = utc + tz_get_offset (utc, &is_dst);
+    days    = local / TZ_SECONDS_PER_DAY;
+    seconds = local % TZ_SECONDS_PER_DAY;
+    year    = tz_year (days);
+    yday    = days - tz_days (year, 1, 1);
+    leap    = TZ_IS_LEAP_YEAR(year) ? 1 : 0;
+
+    for (mon = 11; mon > 0; mon--)
+    {
+        first_yday = days_before_month[mon] + (mon >= 2 ? leap : 0);
+
+        if (yday >= first_yday)
+        {
+            break;
+        }
+    }
+
+    if (mon == 0)
+    {
+        first_yday = 0;
+    }
+
+    tmp->tm_year    = year - 1900;
+    tmp->tm_mon     = mon;
+    tmp->tm_mday    = yday - first_yday + 1;
+    tmp->tm_yday    = yday;
+    tmp->tm_wday    = (days + 4) % 7;                                       // 1970-01-01 was a thursday
+    tmp->tm_hour    = seconds / 3600;
+    tmp->tm_min     = (seconds / 60) % 60;
+    tmp->tm_sec     = seconds % 60;
+    tmp->tm_isdst   = is_dst;
+}
@@ -0,0 +1,25 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * tz.h - timezone rules (POSIX TZ strings) with precomputed transition table
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef TZ_H
+#define TZ_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define TZ_MAX_RULE_LEN                 47                                  // max length of POSIX TZ string without '\0'
+
+extern uint_fast8_t                     tz_set_rule (const char *);
+extern void                             tz_legacy_rule (char *, int_fast16_t, uint_fast8_t);
+extern int32_t                          tz_get_offset (uint32_t, uint_fast8_t *);
+extern void                             tz_utc_to_tm (struct tm *, uint32_t);
+
+#endif // TZ_H
@@ -664,6 +664,12 @@ var_send_timeserver (void)
     var_send_str_variable (TIMESERVER_STR_VAR, timeserver.timeserver);
 }
 
+void
+var_send_timezone_rule (void)
+{
+    var_send_str_variable (TIMEZONE_RULE_STR_VAR, timeserver.timezone_rule);
+}
+
 void
 var_send_weather_appid (void)
 {
@@ -893,6 +899,39 @@ var_send_ssd1963_flags (void)
 }
 #endif
 
+#if PROFILE == 1
+/*--------------------------------------------------------------------------------------------------------------------------------------
+ * send profile table to ESP8266:
+ *   PHnnccccccc        number of entries, core clock in Hz
+ *   PNiiname           name of entry
+ *   PViicccccccc...    calls, min, avg, max cycles of entry
+ *--------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+var_send_profile (void)
+{
+    char            buf[64];
+    PROFILE_ENTRY   entry;
+    uint32_t        avg_cycles;
+    uint_fast8_t    idx;
+
+    sprintf (buf, "PH%02x%08lx", N_PROFILE_IDS, SystemCoreClock);
+    var_send_buf (buf);
+
+    for (idx = 0; idx < N_PROFILE_IDS; idx++)
+    {
+        if (profile_get_entry (idx, &entry))
+        {
+            avg_cycles = entry.calls ? (uint32_t) (entry.sum_cycles / entry.calls) : 0;
+
+            var_send_string ("PN", (uint_fast32_t) idx, entry.name);
+            sprintf (buf, "PV%02x%08lx%08lx%08lx%08lx", idx, entry.calls, entry.min_cycles, avg_cycles, entry.max_cycles);
+            var_send_buf (buf);
+        }
+    }
+}
+#endif
+
 /*--------------------------------------------------------------------------------------------------------------------------------------
  * send all variables to ESP8266
  *--------------------------------------------------------------------------------------------------------------------------------------
@@ -938,6 +977,7 @@ var_send_all_variables (void)
     var_send_update_host ();
     var_send_update_path ();
     var_send_date_ticker_format ();
+    var_send_timezone_rule ();
 
     var_send_tm ();
 
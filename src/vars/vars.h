@@ -13,6 +13,8 @@
 #define VARS_H
 
 #include <stdint.h>
+#include "profile.h"
+
 /*-------------------------------------------------------------------------------------------------------------------------------------------
  * remote procedure calls:
  *-------------------------------------------------------------------------------------------------------------------------------------------
@@ -29,6 +31,10 @@ typedef enum
     DISPLAY_DATE_RPC_VAR,                                                   // display current date
     GET_WEATHER_FC_RPC_VAR,                                                 // get weather forecast
     RESET_EEPROM_RPC_VAR,                                                   // reset EEPROM
+    GET_PROFILE_RPC_VAR,                                                    // send profile table
+    RESET_PROFILE_RPC_VAR,                                                  // reset profile table
+    LOG_STATS_RPC_VAR,                                                      // log statistics of event queue, timer etc.
+    RESET_STATS_RPC_VAR,                                                    // reset statistics of event queue, timer etc.
     MAX_RPC_VARIABLES                                                       // must be the last member
 } RPC_VARIABLE;
 
@@ -129,6 +135,7 @@ typedef enum
     UPDATE_HOST_VAR,
     UPDATE_PATH_VAR,
     DATE_TICKER_FORMAT_VAR,
+    TIMEZONE_RULE_STR_VAR,
     MAX_STR_VARIABLES                                                       // must be the last member
 } STR_VARIABLE;
 
@@ -256,6 +263,7 @@ extern void         var_send_display_power (void);
 extern void         var_send_version (void);
 extern void         var_send_eep_version (void);
 extern void         var_send_timeserver (void);
+extern void         var_send_timezone_rule (void);
 extern void         var_send_weather_appid (void);
 extern void         var_send_weather_city (void);
 extern void         var_send_weather_lon (void);
@@ -274,6 +282,10 @@ extern void         var_send_use_rgbw (void);
 extern void         var_send_ssd1963_flags (void);
 #endif
 
+#if PROFILE == 1
+extern void         var_send_profile (void);
+#endif
+
 extern void         var_send_all_variables (void);
 
 #endif
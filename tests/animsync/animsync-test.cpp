@@ -0,0 +1,584 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * animsync-test.cpp - synchronized animations of ESP8266/ESP-uclock/animsync.cpp on several simulated clocks
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * animsync.cpp is compiled once per clock, so every clock has its own state (see Makefile). The clocks run in simulated time:
+ * micros() and millis() of each ESP8266 run with their own offset and crystal error, UDP packets between the clocks are delayed,
+ * some much longer, and some are lost. The STM32 of each clock is simulated like main.c and display.c: it answers "CMD Y" with
+ * "sync-armed", starts the minute animation at a tick of its own timer and reports "sync-late" or "sync-missed". Its minute
+ * changes with its RTC, which differs a little from the RTCs of the other clocks.
+ *
+ *      sync        every minute animation starts synchronized: the skew of the starts is less than 1/64 sec and not more
+ *                  than the skew bound shown by the leader
+ *      lost        all responses of the leader to one follower are lost: its offset samples become too old and are dropped
+ *      late        the minute of one clock changes after the start time: the start is missed and the skew is unknown until
+ *                  the next start succeeds
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <math.h>
+#include <vector>
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "WiFiUdp.h"
+#include "animsync.h"
+#include "vars.h"
+#include "wifi.h"
+#include "eepromdata.h"
+
+#define N_CLOCKS                    3
+#define LEADER                      1                       // clock with lowest chip id
+#define LOOP_USEC                   200                     // period of main loop of ESP8266
+#define TICKS_PER_SEC               1600                    // TIMER_TICKS_PER_SEC of STM32
+#define CMD_Y_USEC                  (17 * 10 * 1000000.0 / 115200)             // transfer time of "CMD Yaassssdddd\r\n"
+#define ANSWER_USEC                 (14 * 10 * 1000000.0 / 115200)             // transfer time of an answer of the STM32
+#define TIME_USEC                   2000                    // transfer time of the time sent by the STM32 at minute change
+#define MAX_SKEW_USEC               (1000000 / 64)          // one step of the animation timer
+#define FIRST_MINUTE_USEC           10000000.0              // first minute change: time to elect leader and to measure offsets
+#define N_MINUTES                   12
+#define LOST_CLOCK                  2
+#define LOST_MINUTE                 4                       // responses to LOST_CLOCK lost from LOST_START to LOST_END
+#define LOST_START_USEC             5000000.0
+#define LOST_END_USEC               20000000.0
+#define LATE_CLOCK                  0
+#define LATE_MINUTE                 8                       // minute of LATE_CLOCK changes LATE_USEC after minute of leader
+#define LATE_USEC                   800000.0
+#define CHECK_USEC                  5000000.0               // check info of the clocks 5 sec after minute change
+
+#define MINUTE_USEC(m)              (FIRST_MINUTE_USEC + (m) * 60000000.0)
+
+#define EV_CMD                      0                       // STM32 has received "CMD Y"
+#define EV_ARMED                    1                       // ESP8266 has received "sync-armed"
+#define EV_MINUTE                   2                       // minute of RTC changes
+#define EV_TIME                     3                       // ESP8266 has received time
+#define EV_START                    4                       // timer tick of synchronized start
+#define EV_LATE                     5                       // ESP8266 has received "sync-late"
+#define EV_MISSED                   6                       // ESP8266 has received "sync-missed"
+#define N_EVENTS                    7
+
+typedef struct
+{
+    double                          time;                   // arrival time
+    int                             from;                   // index of sending clock
+    int                             len;
+    uint8_t                         data[32];
+} PACKET;
+
+typedef struct
+{
+    void                            (*loop) (void);
+    void                            (*armed) (void);
+    void                            (*late) (uint32_t);
+    void                            (*missed) (void);
+    void                            (*info) (char *);
+} ANIMSYNC_FUNCTIONS;
+
+typedef struct
+{
+    uint32_t                        chip_id;
+    uint32_t                        micros_offset;          // micros() at time 0
+    double                          esp_ppm;                // crystal error of ESP8266
+    double                          stm32_ppm;              // crystal error of STM32
+    double                          tick_phase;             // time of timer tick 0 of STM32
+    double                          minute_offset;          // minute change of RTC relative to leader
+    std::vector<PACKET>             rx;                     // packets on the way to this clock
+    unsigned long                   tm_micros;              // current_tm_micros of ESP8266
+    TM                              tm;
+    double                          events[N_EVENTS];       // time of next event, INFINITY: none
+    uint_fast16_t                   cmd_delay;              // delay of received "CMD Y" in msec
+    uint32_t                        late_usec;              // usec reported by "sync-late"
+    bool                            armed;
+    bool                            animation_start_flag;   // minute changed, animation not yet started
+    int                             minute;
+    double                          start[N_MINUTES + 1];   // start of minute animation
+    bool                            synchronized[N_MINUTES + 1];
+} CLOCK;
+
+#define ANIMSYNC_CLOCK(n)           extern void animsync_loop_##n (void); extern void animsync_armed_##n (void);                \
+                                    extern void animsync_late_##n (uint32_t); extern void animsync_missed_##n (void);           \
+                                    extern void animsync_info_##n (char *);
+#define ANIMSYNC_FUNCS(n)           { animsync_loop_##n, animsync_armed_##n, animsync_late_##n, animsync_missed_##n, animsync_info_##n }
+
+ANIMSYNC_CLOCK(0)
+ANIMSYNC_CLOCK(1)
+ANIMSYNC_CLOCK(2)
+
+static const ANIMSYNC_FUNCTIONS     funcs[N_CLOCKS] = { ANIMSYNC_FUNCS(0), ANIMSYNC_FUNCS(1), ANIMSYNC_FUNCS(2) };
+
+static CLOCK                        clocks[N_CLOCKS];
+static int                          sim_clock;              // clock running now
+static double                       sim_time;               // simulated time in usec
+static uint32_t                     n_errors;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * firmware of the ESP8266: vars.cpp, wifi.cpp, eepromdata.cpp, base.cpp
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+unsigned long                       current_tm_micros;
+uint8_t                             eeprom_flags = EEPROM_FLAG_SYNC_ANIMATIONS;
+int                                 wifi_ap_mode;
+
+TM *
+get_tm_var (TM_VARIABLE var)
+{
+    (void) var;
+    return &clocks[sim_clock].tm;
+}
+
+unsigned int
+get_numvar (NUM_VARIABLE var)
+{
+    (void) var;
+    return 2;
+}
+
+void
+debugmsg (const char * str, const char * msg)
+{
+    (void) str;
+    (void) msg;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * clocks of the ESP8266s: micros() and millis() of animsync.cpp are renamed to sim_micros() and sim_millis()
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint64_t
+local_usec (int k, double t)
+{
+    return clocks[k].micros_offset + (uint64_t) (t * (1 + clocks[k].esp_ppm / 1000000));
+}
+
+unsigned long
+sim_micros (void)
+{
+    return (uint32_t) local_usec (sim_clock, sim_time);
+}
+
+unsigned long
+sim_millis (void)
+{
+    return local_usec (sim_clock, sim_time) / 1000;
+}
+
+static uint32_t                     rand_state = 1;
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * network: WiFiUDP of animsync.cpp is renamed to SimUDP, fd holds the index of the clock. The multicast group is replaced by
+ * 127.0.0.1 (see WiFiUdp.h), clock k has the address 10.0.0.k+1.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+deliver (int from, int to, const uint8_t * data, int len)
+{
+    PACKET      p;
+    uint32_t    r = next_rand () % 100;
+
+    if (r < 2)                                                                  // lost
+    {
+        return;
+    }
+
+    if (to == LOST_CLOCK && from == LEADER && data[4] == 'R' &&
+        sim_time >= MINUTE_USEC (LOST_MINUTE) + LOST_START_USEC && sim_time < MINUTE_USEC (LOST_MINUTE) + LOST_END_USEC)
+    {
+        return;
+    }
+
+    p.time  = sim_time + 300 + next_rand () % 1700 + (r < 7 ? 20000 : 0);      // some packets wait much longer
+    p.from  = from;
+    p.len   = len;
+    memcpy (p.data, data, len);
+    clocks[to].rx.push_back (p);
+}
+
+uint8_t
+SimUDP::begin (uint16_t port)
+{
+    (void) port;
+    fd = sim_clock;
+    rx_len = rx_pos = tx_len = 0;
+    return 1;
+}
+
+void
+SimUDP::stop (void)
+{
+    fd = -1;
+}
+
+int
+SimUDP::parsePacket (void)
+{
+    std::vector<PACKET> &   rx = clocks[fd].rx;
+    size_t                  i;
+
+    rx_len = rx_pos = 0;
+
+    for (i = 0; fd >= 0 && i < rx.size (); i++)
+    {
+        if (rx[i].time <= sim_time)
+        {
+            memcpy (rx_buf, rx[i].data, rx[i].len);
+            rx_len      = rx[i].len;
+            remote_ip   = IPAddress (10, 0, 0, rx[i].from + 1);
+            remote_port = 2425;
+            rx.erase (rx.begin () + i);
+            break;
+        }
+    }
+
+    return rx_len;
+}
+
+int
+SimUDP::read (uint8_t * buf, size_t len)
+{
+    if (len > (size_t) (rx_len - rx_pos))
+    {
+        len = rx_len - rx_pos;
+    }
+
+    memcpy (buf, rx_buf + rx_pos, len);
+    rx_pos += len;
+    return len;
+}
+
+int
+SimUDP::beginPacket (IPAddress ip, uint16_t port)
+{
+    tx_ip   = ip;
+    tx_port = port;
+    tx_len  = 0;
+    return 1;
+}
+
+size_t
+SimUDP::write (const uint8_t * buf, size_t len)
+{
+    if (len > (size_t) (sizeof (tx_buf) - tx_len))
+    {
+        len = sizeof (tx_buf) - tx_len;
+    }
+
+    memcpy (tx_buf + tx_len, buf, len);
+    tx_len += len;
+    return len;
+}
+
+int
+SimUDP::endPacket (void)
+{
+    int     k;
+
+    if (tx_ip == IPAddress (127, 0, 0, 1))                                      // multicast
+    {
+        for (k = 0; k < N_CLOCKS; k++)
+        {
+            if (k != fd)
+            {
+                deliver (fd, k, tx_buf, tx_len);
+            }
+        }
+    }
+    else if (tx_ip[3] >= 1 && tx_ip[3] <= N_CLOCKS)
+    {
+        deliver (fd, tx_ip[3] - 1, tx_buf, tx_len);
+    }
+
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * run ESP8266 of clock k
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+select_clock (int k)
+{
+    sim_clock           = k;
+    stub_chip_id        = clocks[k].chip_id;
+    current_tm_micros   = clocks[k].tm_micros;
+}
+
+static void
+esp8266_loop (int k)
+{
+    CLOCK *     c = &clocks[k];
+    unsigned    mode;
+    unsigned    seed;
+    unsigned    delay;
+    size_t      pos;
+
+    select_clock (k);
+    stub_serial_out.clear ();
+    funcs[k].loop ();
+
+    if ((pos = stub_serial_out.find ("CMD Y")) != std::string::npos &&
+        sscanf (stub_serial_out.c_str () + pos, "CMD Y%2x%4x%4x", &mode, &seed, &delay) == 3)
+    {
+        c->events[EV_CMD]   = sim_time + CMD_Y_USEC + next_rand () % 1000;      // transfer and main loop of STM32
+        c->cmd_delay        = delay;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * run STM32 of clock k: handle all events until sim_time in order of their time
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+stm32_loop (int k)
+{
+    CLOCK *     c           = &clocks[k];
+    double      tick_usec   = 1000000.0 / TICKS_PER_SEC / (1 + c->stm32_ppm / 1000000);
+    double      t;
+    double      latency;
+    double      ticks;
+    int         ev;
+    int         i;
+
+    while (1)
+    {
+        ev = 0;
+
+        for (i = 1; i < N_EVENTS; i++)
+        {
+            if (c->events[i] < c->events[ev])
+            {
+                ev = i;
+            }
+        }
+
+        t = c->events[ev];
+
+        if (t > sim_time)
+        {
+            break;
+        }
+
+        c->events[ev] = INFINITY;
+        select_clock (k);
+
+        switch (ev)
+        {
+            case EV_CMD:                                                        // display_sync_animation()
+            {
+                ticks                   = floor ((t - c->tick_phase) / tick_usec) + (uint32_t) c->cmd_delay * TICKS_PER_SEC / 1000;
+                c->events[EV_START]     = c->tick_phase + ticks * tick_usec;
+                c->events[EV_ARMED]     = t + ANSWER_USEC;
+                c->armed                = true;
+                break;
+            }
+
+            case EV_ARMED:
+            {
+                funcs[k].armed ();
+                break;
+            }
+
+            case EV_MINUTE:                                                     // display_clock() starts animation
+            {
+                c->minute++;
+                c->animation_start_flag = true;
+                c->events[EV_TIME]      = t + TIME_USEC;
+                c->events[EV_MINUTE]    = MINUTE_USEC (c->minute + 1) + c->minute_offset +
+                                          ((k == LATE_CLOCK && c->minute + 1 == LATE_MINUTE) ? LATE_USEC : 0);
+
+                if (! c->armed)                                                 // not held back: starts now
+                {
+                    c->animation_start_flag         = false;
+                    c->start[c->minute]             = t;
+                    c->synchronized[c->minute]      = false;
+                }
+                break;
+            }
+
+            case EV_TIME:
+            {
+                c->tm.tm_sec    = 0;
+                c->tm_micros    = (uint32_t) local_usec (k, t);
+                break;
+            }
+
+            case EV_START:                                                      // display_animation_sync_hold()
+            {
+                c->armed = false;
+
+                if (c->animation_start_flag)
+                {
+                    latency                         = next_rand () % 400;       // timer_run() and event dispatch
+                    c->animation_start_flag         = false;
+                    c->start[c->minute]             = t + latency;
+                    c->synchronized[c->minute]      = true;
+                    c->late_usec                    = (floor (latency / tick_usec) + 1) * 1000000UL / TICKS_PER_SEC;
+                    c->events[EV_LATE]              = t + latency + next_rand () % 1000 + ANSWER_USEC;
+                }
+                else
+                {
+                    c->events[EV_MISSED]            = t + next_rand () % 1000 + ANSWER_USEC;
+                }
+                break;
+            }
+
+            case EV_LATE:
+            {
+                funcs[k].late (c->late_usec);
+                break;
+            }
+
+            case EV_MISSED:
+            {
+                funcs[k].missed ();
+                break;
+            }
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * checks
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+get_info (int k, char * info)
+{
+    select_clock (k);
+    funcs[k].info (info);
+}
+
+static void
+check (bool ok, int minute, const char * what, const char * info)
+{
+    if (! ok)
+    {
+        printf ("animsync-test: minute %d: %s failed, info: \"%s\"\n", minute, what, info);
+        n_errors++;
+    }
+}
+
+static void
+check_minute (int m)
+{
+    char            info[ANIMSYNC_INFO_SIZE];
+    char            clock_info[ANIMSYNC_INFO_SIZE];
+    const char *    p;
+    unsigned long   bound = 0;
+    double          first = INFINITY;
+    double          last = -INFINITY;
+    int             n_synchronized = 0;
+    int             k;
+
+    for (k = 0; k < N_CLOCKS; k++)
+    {
+        if (clocks[k].synchronized[m])
+        {
+            n_synchronized++;
+            first   = fmin (first, clocks[k].start[m]);
+            last    = fmax (last, clocks[k].start[m]);
+        }
+    }
+
+    get_info (LEADER, info);
+
+    if ((p = strstr (info, "skew < ")))
+    {
+        bound = strtoul (p + 7, NULL, 10);
+    }
+
+    if (m == LATE_MINUTE)
+    {
+        get_info (LATE_CLOCK, clock_info);
+        check (n_synchronized == N_CLOCKS - 1 && ! clocks[LATE_CLOCK].synchronized[m], m, "late: start missed", clock_info);
+        check (strstr (clock_info, "skew unknown") && strstr (clock_info, " 1 missed"), m, "late: missed start reported", clock_info);
+        check (strstr (info, "skew unknown") != NULL, m, "late: leader shows skew unknown", info);
+        printf ("animsync-test: minute %2d: skew %5.0f usec, start of clock %d missed\n", m, last - first, LATE_CLOCK);
+    }
+    else
+    {
+        check (n_synchronized == N_CLOCKS, m, "sync: all starts synchronized", info);
+        check (bound > 0, m, "sync: leader shows skew bound", info);
+        printf ("animsync-test: minute %2d: skew %5.0f usec, bound %5lu usec\n", m, last - first, bound);
+    }
+
+    check (last - first < MAX_SKEW_USEC, m, "sync: skew < 1/64 sec", info);
+    check (m == LATE_MINUTE || last - first <= bound, m, "sync: skew within bound", info);
+}
+
+int
+main (void)
+{
+    static const uint32_t   chip_ids[N_CLOCKS]          = { 0x3000, 0x1000, 0x2000 };
+    static const uint32_t   micros_offsets[N_CLOCKS]    = { 0xFFF00000, 0x12345678, 0xF0000000 };   // micros() of 0 and 2 wrap
+    static const double     esp_ppms[N_CLOCKS]          = { 45, -45, 20 };
+    static const double     stm32_ppms[N_CLOCKS]        = { -45, 40, 0 };
+    static const double     minute_offsets[N_CLOCKS]    = { 150000, 0, -200000 };
+    char                    info[ANIMSYNC_INFO_SIZE];
+    double                  check_time = MINUTE_USEC (1) + CHECK_USEC;
+    double                  lost_time = MINUTE_USEC (LOST_MINUTE) + LOST_END_USEC - 2000000;
+    int                     m = 1;
+    int                     k;
+    int                     i;
+
+    for (k = 0; k < N_CLOCKS; k++)
+    {
+        clocks[k].chip_id       = chip_ids[k];
+        clocks[k].micros_offset = micros_offsets[k];
+        clocks[k].esp_ppm       = esp_ppms[k];
+        clocks[k].stm32_ppm     = stm32_ppms[k];
+        clocks[k].tick_phase    = next_rand () % (1000000 / TICKS_PER_SEC);
+        clocks[k].minute_offset = minute_offsets[k];
+        clocks[k].tm.tm_sec     = 30;
+        clocks[k].minute        = -1;
+
+        for (i = 0; i < N_EVENTS; i++)
+        {
+            clocks[k].events[i] = INFINITY;
+        }
+
+        clocks[k].events[EV_MINUTE] = MINUTE_USEC (0) + clocks[k].minute_offset;
+    }
+
+    for (sim_time = 0; m <= N_MINUTES; sim_time += LOOP_USEC)
+    {
+        for (k = 0; k < N_CLOCKS; k++)
+        {
+            stm32_loop (k);
+            esp8266_loop (k);
+        }
+
+        if (sim_time >= lost_time)                                              // responses lost for 15 sec
+        {
+            get_info (LOST_CLOCK, info);
+            check (strstr (info, "measuring offset") != NULL, LOST_MINUTE, "lost: old samples dropped", info);
+            lost_time = INFINITY;
+        }
+
+        if (sim_time >= check_time)
+        {
+            check_minute (m);
+            m++;
+            check_time = MINUTE_USEC (m) + CHECK_USEC;
+        }
+    }
+
+    for (k = 0; k < N_CLOCKS; k++)
+    {
+        get_info (k, info);
+        printf ("animsync-test: clock %d: %s\n", k, info);
+    }
+
+    printf ("animsync-test: %u errors\n", n_errors);
+    return n_errors ? 1 : 0;
+}
@@ -0,0 +1,325 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * dcf77-test.c - time to lock of the DCF77 decoder in src/dcf77/dcf77.c with synthetic noisy signals
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The DATA pin is simulated tick by tick of timer2 and sampled by dcf77_ISR(), the decoder runs as timer job every 100 msec like on
+ * the STM32. Every scenario adds a kind of disturbance of a real receiver to the signal: jitter of the pulse edges, spikes shorter
+ * than the debounce time, noise pulses, lost pulses and stalls of the main loop. Each scenario is run several times with different
+ * start times, the time until the first delivered time is measured. Every delivered time must be the transmitted time.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "timer.h"
+#include "dcf77.h"
+
+#define RUNS                        12                      // runs per scenario
+#define MAX_MINUTES                 40                      // give up search after 40 minutes
+#define CHECK_MINUTES               10                      // check delivered times for 10 minutes after lock
+#define STALL_PERIOD                50                      // main loop stalls every 50 sec in scenario "stall"
+#define TICKS_PER_MSEC(ms)          ((ms) * TIMER_TICKS_PER_SEC / 1000)
+
+typedef struct
+{
+    const char *                    name;
+    uint32_t                        jitter;                 // start of pulse +/- msec
+    uint32_t                        width;                  // width of pulse +/- msec
+    uint32_t                        spikes;                 // spikes of 0.1..3 msec per sec
+    uint32_t                        noise;                  // noise pulses of 10..80 msec per min
+    uint32_t                        lost;                   // lost pulses per 1000
+    uint32_t                        stall;                  // msec main loop stall every STALL_PERIOD sec
+    uint32_t                        max_lock;               // max. accepted time to lock in sec
+} SCENARIO;
+
+static const SCENARIO               scenarios[] =
+{
+    { "clean",      0,  0,  0,  0,  0,    0,  240 },
+    { "jitter",     10, 25, 0,  0,  0,    0,  420 },
+    { "spikes",     10, 25, 20, 0,  0,    0,  420 },
+    { "stall",      10, 25, 20, 0,  0, 5000,  420 },
+    { "noise",      10, 25, 20, 6,  20,   0,  900 },
+    { "heavy",      15, 30, 50, 12, 50,   0, 1800 },
+};
+
+uint_fast8_t                        dcf77_test_pin;
+volatile uint32_t                   timer_ticks = 0xF0000000;               // wraps around during the test
+
+static TIMER_JOB *                  job;
+static uint8_t                      signal[TIMER_TICKS_PER_SEC];            // DATA pin during current second
+static uint8_t                      bits[60];
+static uint32_t                     rand_state = 1;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer jobs, the test runs the only job of dcf77.c
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+timer_add_job (TIMER_JOB * j, TIMER_CALLBACK callback, uint32_t delay, uint32_t interval)
+{
+    j->expires  = timer_ticks + delay;
+    j->interval = interval;
+    j->callback = callback;
+    j->active   = 1;
+    job         = j;
+}
+
+void
+timer_remove_job (TIMER_JOB * j)
+{
+    j->active   = 0;
+    job         = NULL;
+}
+
+uint_fast8_t
+timer_job_is_active (TIMER_JOB * j)
+{
+    return j->active;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * random numbers, own generator for reproducible runs
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static int32_t
+rand_range (uint32_t plus_minus)
+{
+    return (int32_t) (next_rand () % (2 * plus_minus + 1)) - (int32_t) plus_minus;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * DCF77 frame of time t, transmitted during the minute before t
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+put_bcd (uint_fast8_t first, uint_fast8_t n, uint_fast8_t value, uint_fast8_t * parityp)
+{
+    uint_fast8_t    raw = ((value / 10) << 4) | (value % 10);
+    uint_fast8_t    i;
+
+    for (i = 0; i < n; i++)
+    {
+        bits[first + i] = (raw >> i) & 0x01;
+        *parityp += bits[first + i];
+    }
+}
+
+static void
+make_frame (time_t t)
+{
+    struct tm *     tm = gmtime (&t);
+    uint_fast8_t    p;
+    uint_fast8_t    i;
+
+    memset (bits, 0, sizeof (bits));
+
+    for (i = 1; i < 15; i++)                                                // weather data
+    {
+        bits[i] = next_rand () & 0x01;
+    }
+
+    bits[18] = 1;                                                           // CET
+    bits[20] = 1;
+
+    p = 0;
+    put_bcd (21, 7, tm->tm_min, &p);
+    bits[28] = p & 0x01;
+
+    p = 0;
+    put_bcd (29, 6, tm->tm_hour, &p);
+    bits[35] = p & 0x01;
+
+    p = 0;
+    put_bcd (36, 6, tm->tm_mday, &p);
+    put_bcd (42, 3, tm->tm_wday ? tm->tm_wday : 7, &p);
+    put_bcd (45, 5, tm->tm_mon + 1, &p);
+    put_bcd (50, 8, tm->tm_year % 100, &p);
+    bits[58] = p & 0x01;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * DATA pin during second sec of the current frame
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+make_second (const SCENARIO * sc, uint_fast8_t sec)
+{
+    uint32_t    start;
+    uint32_t    len;
+    uint32_t    n;
+    uint32_t    i;
+
+    memset (signal, 0, sizeof (signal));
+
+    if (sec != 59 && next_rand () % 1000 >= sc->lost)
+    {
+        start   = TICKS_PER_MSEC(sc->jitter + rand_range (sc->jitter));       // constant offset of jitter msec
+        len     = TICKS_PER_MSEC((bits[sec] ? 200 : 100) + rand_range (sc->width));
+        memset (signal + start, 1, len);
+    }
+
+    if (sc->noise && next_rand () % 60 < sc->noise)
+    {
+        len     = TICKS_PER_MSEC(10 + next_rand () % 71);
+        start   = next_rand () % (TIMER_TICKS_PER_SEC - len);
+        memset (signal + start, 1, len);
+    }
+
+    for (n = 0; n < sc->spikes; n++)
+    {
+        len     = 1 + next_rand () % TICKS_PER_MSEC(3);
+        start   = next_rand () % (TIMER_TICKS_PER_SEC - len);
+
+        for (i = start; i < start + len; i++)
+        {
+            signal[i] ^= 1;
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * one run: returns seconds until first delivered time, 0 if no lock, *wrongp is incremented for every wrong time
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+run (const SCENARIO * sc, time_t minute, uint32_t * wrongp)
+{
+    struct tm       dcf;
+    struct tm *     tm;
+    uint32_t        stall_until = timer_ticks;
+    uint32_t        lock        = 0;
+    uint32_t        elapsed     = 0;
+    uint32_t        first_tick  = next_rand () % TIMER_TICKS_PER_SEC;
+    uint_fast8_t    sec         = next_rand () % 60;
+    uint32_t        i;
+
+    dcf77_enable (1);
+    make_frame (minute + 60);
+
+    while (elapsed < MAX_MINUTES * 60 && (! lock || elapsed < lock + CHECK_MINUTES * 60))
+    {
+        make_second (sc, sec);
+
+        if (sc->stall && elapsed % STALL_PERIOD == STALL_PERIOD - 1)
+        {
+            stall_until = timer_ticks + TICKS_PER_MSEC(sc->stall);
+        }
+
+        for (i = first_tick; i < TIMER_TICKS_PER_SEC; i++)
+        {
+            timer_ticks++;
+            dcf77_test_pin = signal[i];
+            dcf77_ISR ();
+
+            if (job && (int32_t) (timer_ticks - job->expires) >= 0 && (int32_t) (timer_ticks - stall_until) >= 0)
+            {
+                job->expires = timer_ticks + job->interval;
+                job->callback ();
+
+                if (dcf77_time (&dcf))
+                {
+                    tm = gmtime (&minute);
+
+                    if (dcf.tm_min != tm->tm_min || dcf.tm_hour != tm->tm_hour || dcf.tm_mday != tm->tm_mday ||
+                        dcf.tm_mon != tm->tm_mon || dcf.tm_year != tm->tm_year || dcf.tm_wday != tm->tm_wday)
+                    {
+                        printf ("%s: wrong time %02d:%02d %02d.%02d.%04d, expected %02d:%02d %02d.%02d.%04d\n", sc->name,
+                                dcf.tm_hour, dcf.tm_min, dcf.tm_mday, dcf.tm_mon + 1, dcf.tm_year + 1900,
+                                tm->tm_hour, tm->tm_min, tm->tm_mday, tm->tm_mon + 1, tm->tm_year + 1900);
+                        (*wrongp)++;
+                    }
+                    else if (! lock)
+                    {
+                        lock = elapsed + 1;
+                    }
+                }
+            }
+        }
+
+        first_tick = 0;
+        elapsed++;
+
+        if (++sec == 60)
+        {
+            sec = 0;
+            minute += 60;
+            make_frame (minute + 60);
+        }
+    }
+
+    dcf77_enable (0);
+    return lock;
+}
+
+static int
+compare (const void * a, const void * b)
+{
+    uint32_t    x = *(const uint32_t *) a;
+    uint32_t    y = *(const uint32_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+int
+main (void)
+{
+    uint32_t        locks[RUNS];
+    uint32_t        n_errors = 0;
+    uint32_t        wrong;
+    uint32_t        no_lock;
+    uint32_t        s;
+    uint32_t        r;
+    time_t          minute;
+
+    dcf77_init ();
+
+    for (s = 0; s < sizeof (scenarios) / sizeof (scenarios[0]); s++)
+    {
+        const SCENARIO * sc = scenarios + s;
+
+        wrong       = 0;
+        no_lock     = 0;
+        dcf77_reset_stats ();
+
+        for (r = 0; r < RUNS; r++)
+        {
+            minute      = 1798758000 + (time_t) r * 86400 * 31 + (time_t) (next_rand () % 1440) * 60; // starting 2026-12-31 23:00
+            locks[r]    = run (sc, minute, &wrong);
+
+            if (! locks[r])
+            {
+                locks[r] = 0xFFFFFFFF;
+                no_lock++;
+            }
+        }
+
+        qsort (locks, RUNS, sizeof (locks[0]), compare);
+
+        printf ("dcf77-test: %-6s lock median %4u max %4u sec, no lock %u, wrong %u, bit errors %u/%u, glitches %u, overruns %u\n",
+                sc->name, locks[RUNS / 2], no_lock ? 0 : locks[RUNS - 1], no_lock, wrong, dcf77_stats.bit_errors, dcf77_stats.bits,
+                dcf77_stats.glitches, dcf77_stats.overruns);
+
+        if (wrong || no_lock || locks[RUNS - 1] > sc->max_lock || dcf77_stats.overruns)
+        {
+            printf ("dcf77-test: %s failed, max. lock time %u sec\n", sc->name, sc->max_lock);
+            n_errors++;
+        }
+    }
+
+    return n_errors ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * board-led.h - host test stub
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef BOARD_LED_H
+#define BOARD_LED_H
+
+#define board_led_on()
+#define board_led_off()
+
+#endif
@@ -0,0 +1,27 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * io.h - host test stub, DATA pin is read from dcf77_test_pin
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef IO_H
+#define IO_H
+
+#include <stdint.h>
+
+#define ENABLE                                  1
+#define Bit_RESET                               0
+#define GPIOC                                   0
+#define GPIO_Pin_2                              0x0004
+#define GPIO_Pin_3                              0x0008
+#define GPIO_Speed_2MHz                         0
+#define RCC_AHB1Periph_GPIOC                    0
+
+#define RCC_AHB1PeriphClockCmd(periph, state)
+#define GPIO_SET_PIN_IN_NOPULL(port, pin, speed)
+#define GPIO_SET_PIN_OUT_PP(port, pin, speed)
+#define GPIO_SET_BIT(port, pin)
+#define GPIO_RESET_BIT(port, pin)
+#define GPIO_ReadInputDataBit(port, pin)        dcf77_test_pin
+
+extern uint_fast8_t                             dcf77_test_pin;
+
+#endif
@@ -0,0 +1,30 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer.h - host test stub, jobs are run by dcf77-test.c
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+#define TIMER_TICKS_PER_SEC             F_INTERRUPTS
+#define TIMER_MSEC_TO_TICKS(ms)         (((ms) * TIMER_TICKS_PER_SEC) / 1000)
+#define TIMER_HZ_TO_TICKS(hz)           (TIMER_TICKS_PER_SEC / (hz))
+
+typedef void (*TIMER_CALLBACK) (void);
+
+typedef struct timer_job
+{
+    uint32_t                            expires;
+    uint32_t                            interval;
+    TIMER_CALLBACK                      callback;
+    uint_fast8_t                        active;
+} TIMER_JOB;
+
+extern volatile uint32_t                timer_ticks;
+
+extern void                             timer_add_job (TIMER_JOB *, TIMER_CALLBACK, uint32_t, uint32_t);
+extern void                             timer_remove_job (TIMER_JOB *);
+extern uint_fast8_t                     timer_job_is_active (TIMER_JOB *);
+
+#endif
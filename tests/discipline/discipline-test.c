@@ -0,0 +1,339 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * discipline-test.c - drift and step simulation of the clock discipline in src/discipline/discipline.c
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The test plays the part of main.c: it advances the soft clock by the second lengths of discipline_second(), reads the RTC at
+ * hh:mm:45 with the dithered delay, polls the timeserver in the interval of discipline_ntp_interval() and passes DCF77 times at
+ * hh:mm:15. The oscillator of timer2 and the RTC run with a constant error against the true time, the DCF77 delivery jitters and
+ * the timeserver answers with whole seconds after some latency.
+ *
+ * The simulation is event driven: timer_ticks jumps from event to event, so days of clock time take only milliseconds. Each
+ * scenario runs in its own process to start with the initial state of discipline.c. It checks the estimated drift of the
+ * oscillator, the offset of the soft clock to the true time, the number of steps and, with DCF77, the drift of the RTC after
+ * the adjustment of its aging offset.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "timer.h"
+#include "discipline.h"
+
+#define DAY                         86400.0
+#define T0                          852076800.0             // true time at start: 2027-01-01 00:00:00 in seconds since 2000
+#define SECONDS_1970_2000           946684800
+#define TICK_BASE                   0xFFF00000U             // timer_ticks wraps around shortly after start
+#define NTP_LATENCY                 0.030                   // timeserver answer arrives 30 msec after its timestamp
+#define DCF77_DELAY                 0.255                   // DCF77 time is delivered 255 msec after hh:mm:15
+#define DCF77_JITTER                0.005                   // +/- 5 msec
+#define RTC_PPB_PER_AGING           100                     // see DISCIPLINE_RTC_PPB_PER_AGING
+
+typedef struct
+{
+    const char *                    name;
+    double                          osc_ppm;                // oscillator of timer2 fast by ppm
+    double                          rtc_ppm;                // RTC fast by ppm with aging offset 0
+    double                          start_offset;           // soft clock and RTC ahead of true time at start in sec
+    double                          dcf77_days;             // DCF77 is received during the first days
+    uint_fast8_t                    ntp;                    // 1: timeserver is polled
+    double                          days;                   // length of simulation
+    double                          check_from;             // check offset of soft clock from this day on
+    double                          max_offset;             // max. offset of soft clock in sec
+    double                          max_drift_error;        // max. error of estimated oscillator drift in ppm
+    uint32_t                        max_steps;              // max. number of steps
+    double                          max_rtc_ppm;            // max. drift of RTC at end of DCF77 reception, 0: not checked
+} SCENARIO;
+
+static const SCENARIO               scenarios[] =
+{
+    //  name        osc     rtc     start   dcf77   ntp days  check max.off drift  steps rtc
+    { "ntp",        40.0,   3.0,    0.3,    0,      1,  3,    2,    0.600,  5.0,   0,    0    },       // whole seconds: drift +/- 5 ppm
+    { "ntp-slow",   -80.0,  -5.0,   0.7,    0,      1,  3,    2,    0.600,  5.0,   0,    0    },
+    { "dcf77",      -60.0,  3.0,    0.3,    3,      0,  3,    1,    0.020,  0.2,   0,    0.5  },
+    { "step",       25.0,   3.0,    3600.4, 1,      1,  1,    0.01, 0.020,  1.0,   1,    0    },
+    { "rtc",        40.0,   3.0,    0.3,    9,      0,  10,   2,    0.250,  0.2,   0,    0.5  },       // RTC only during last day
+};
+
+volatile uint32_t                   timer_ticks;
+
+static double                       tick_len;               // true length of a tick in sec
+static uint64_t                     now;                    // current tick
+static uint32_t                     rand_state = 1;
+
+static int_fast8_t                  rtc_aging;
+static double                       rtc_ppm;                // drift of RTC with aging offset 0
+static double                       rtc_base;               // RTC time at tick rtc_base_tick
+static uint64_t                     rtc_base_tick;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * random numbers, own generator for reproducible runs
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static double
+next_rand (void)                                                            // 0.0 .. 1.0
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return (double) (rand_state >> 8) / (double) 0xFFFFFF;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * true time at tick, tick of true time
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static double
+true_time (uint64_t tick)
+{
+    return T0 + (double) tick * tick_len;
+}
+
+static uint64_t
+true_tick (double t)
+{
+    return (uint64_t) ceil ((t - T0) / tick_len);
+}
+
+static void
+sec_to_tm (double t, struct tm * tmp)
+{
+    time_t  tt = (time_t) floor (t) + SECONDS_1970_2000;
+
+    gmtime_r (&tt, tmp);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * simulated RTC, aging offset 1 = 0.1 ppm slower
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static double
+rtc_drift (void)
+{
+    return rtc_ppm - rtc_aging * (RTC_PPB_PER_AGING / 1000.0);
+}
+
+static double
+rtc_time (uint64_t tick)
+{
+    return rtc_base + (true_time (tick) - true_time (rtc_base_tick)) * (1.0 + rtc_drift () * 1e-6);
+}
+
+static void
+rtc_set (double t)
+{
+    rtc_base        = t;
+    rtc_base_tick   = now;
+}
+
+uint_fast8_t
+rtc_get_aging (int_fast8_t * agingp)
+{
+    *agingp = rtc_aging;
+    return 1;
+}
+
+uint_fast8_t
+rtc_set_aging (int_fast8_t aging)
+{
+    rtc_set (rtc_time (now));
+    rtc_aging = aging;
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * run one scenario, returns number of errors
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+run (const SCENARIO * sc)
+{
+    struct tm   tm;
+    double      soft_sec;                                                   // soft clock at start of current second
+    double      offset;
+    double      max_offset  = 0;
+    double      max_rtc_ppm = 0;
+    double      drift_error;
+    double      dcf77_next  = floor (T0 / 60) * 60 + 60 + 15;               // next hh:mm:15
+    double      end         = T0 + sc->days * DAY;
+    uint64_t    second_tick = 0;                                            // tick of next start of second
+    uint64_t    rtc_tick    = 0;                                            // tick of next RTC read, 0: none
+    uint64_t    ntp_tick    = 0;                                            // tick of next timeserver answer, 0: none
+    uint64_t    dcf77_tick;
+    uint32_t    ntp_countdown = 10;
+    uint32_t    interval;
+    uint32_t    errors = 0;
+
+    memset (&discipline_stats, 0, sizeof (discipline_stats));
+    tick_len    = 1.0 / TIMER_TICKS_PER_SEC / (1.0 + sc->osc_ppm * 1e-6);
+    now         = 0;
+    timer_ticks = TICK_BASE;
+    rtc_aging   = 0;
+    rtc_ppm     = sc->rtc_ppm;
+    rtc_set (T0 + sc->start_offset);
+    soft_sec    = floor (T0 + sc->start_offset);
+
+    discipline_init ();
+    sec_to_tm (soft_sec, &tm);
+    discipline_set_time (&tm, 0);
+    second_tick = TIMER_TICKS_PER_SEC;
+    dcf77_tick  = true_tick (dcf77_next + DCF77_DELAY);
+
+    while (true_time (now) < end)
+    {
+        now = second_tick;
+
+        if (rtc_tick && rtc_tick < now)
+        {
+            now = rtc_tick;
+        }
+
+        if (ntp_tick && ntp_tick < now)
+        {
+            now = ntp_tick;
+        }
+
+        if (dcf77_next < T0 + sc->dcf77_days * DAY && dcf77_tick < now)
+        {
+            now = dcf77_tick;
+        }
+
+        timer_ticks = TICK_BASE + (uint32_t) now;
+
+        if (now == second_tick)                                             // clock_timer()
+        {
+            interval     = discipline_second (timer_ticks);
+            second_tick += interval;
+            soft_sec    += 1;
+
+            if ((long) soft_sec % 60 == 45)
+            {
+                rtc_tick = now + discipline_dither_delay ();
+            }
+
+            if (sc->ntp && --ntp_countdown == 0)
+            {
+                ntp_tick = now + discipline_dither_delay ();
+            }
+
+            if (discipline_rtc_set_due ())
+            {
+                rtc_set (soft_sec);
+            }
+
+            offset = soft_sec - true_time (now);
+
+            if (true_time (now) >= T0 + sc->check_from * DAY && fabs (offset) > max_offset)
+            {
+                max_offset = fabs (offset);
+            }
+        }
+        else if (now == rtc_tick)                                           // ds3231_event() and rtc_date_time_event()
+        {
+            rtc_tick = 0;
+            discipline_rtc_read_started ();
+            sec_to_tm (rtc_time (now), &tm);
+
+            if (discipline_reference (DISCIPLINE_SOURCE_RTC, &tm))
+            {
+                soft_sec = floor (rtc_time (now));
+            }
+        }
+        else if (now == ntp_tick)                                           // answer of timeserver
+        {
+            ntp_tick = 0;
+            sec_to_tm (true_time (now) - NTP_LATENCY, &tm);
+
+            if (discipline_reference (DISCIPLINE_SOURCE_NTP, &tm))
+            {
+                soft_sec = floor (true_time (now) - NTP_LATENCY);
+            }
+
+            ntp_countdown = discipline_ntp_interval () + 40 - (long) soft_sec % 60;
+        }
+        else                                                                // DCF77 time at hh:mm:15
+        {
+            sec_to_tm (dcf77_next, &tm);
+
+            if (discipline_reference (DISCIPLINE_SOURCE_DCF77, &tm))
+            {
+                soft_sec = dcf77_next;
+            }
+
+            dcf77_next += 60;
+            dcf77_tick  = true_tick (dcf77_next + DCF77_DELAY + (2 * next_rand () - 1) * DCF77_JITTER);
+
+            if (dcf77_next >= T0 + sc->dcf77_days * DAY)                    // end of DCF77 reception: RTC has been disciplined
+            {
+                max_rtc_ppm = fabs (rtc_drift ());
+            }
+        }
+    }
+
+    drift_error = fabs (discipline_stats.drift_ppb / 1000.0 + sc->osc_ppm);                // drift > 0: oscillator slow
+
+    printf ("discipline-test: %-8s drift %+8.3f ppm (error %.3f), max. offset %4.0f msec, steps %u, rtc sets %u, aging %d, rtc drift %+.2f ppm\n",
+            sc->name, discipline_stats.drift_ppb / 1000.0, drift_error, max_offset * 1000, discipline_stats.steps,
+            discipline_stats.rtc_sets, rtc_aging, rtc_drift ());
+
+    if (max_offset > sc->max_offset)
+    {
+        printf ("discipline-test: %s: offset %.3f sec exceeds %.3f sec\n", sc->name, max_offset, sc->max_offset);
+        errors++;
+    }
+
+    if (drift_error > sc->max_drift_error)
+    {
+        printf ("discipline-test: %s: drift error %.3f ppm exceeds %.3f ppm\n", sc->name, drift_error, sc->max_drift_error);
+        errors++;
+    }
+
+    if (discipline_stats.steps > sc->max_steps)
+    {
+        printf ("discipline-test: %s: %u steps, max. %u\n", sc->name, discipline_stats.steps, sc->max_steps);
+        errors++;
+    }
+
+    if (sc->max_rtc_ppm > 0 && max_rtc_ppm > sc->max_rtc_ppm)
+    {
+        printf ("discipline-test: %s: rtc drift %.2f ppm exceeds %.2f ppm\n", sc->name, max_rtc_ppm, sc->max_rtc_ppm);
+        errors++;
+    }
+
+    return errors;
+}
+
+int
+main (void)
+{
+    uint32_t    errors = 0;
+    uint32_t    s;
+    pid_t       pid;
+    int         status;
+
+    for (s = 0; s < sizeof (scenarios) / sizeof (scenarios[0]); s++)
+    {
+        fflush (stdout);
+        pid = fork ();
+
+        if (pid == 0)
+        {
+            exit (run (scenarios + s) ? 1 : 0);
+        }
+
+        if (pid < 0 || waitpid (pid, &status, 0) != pid || ! WIFEXITED (status) || WEXITSTATUS (status) != 0)
+        {
+            errors++;
+        }
+    }
+
+    return errors ? 1 : 0;
+}
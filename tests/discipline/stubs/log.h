@@ -0,0 +1,13 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log.h - host test stub, messages are compiled but not printed
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+
+#define log_message(s)                  do { if (0) puts (s); } while (0)
+#define log_printf(...)                 do { if (0) printf (__VA_ARGS__); } while (0)
+
+#endif
@@ -0,0 +1,13 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * rtc.h - host test stub, the RTC is simulated by discipline-test.c
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef RTC_H
+#define RTC_H
+
+#include <stdint.h>
+
+extern uint_fast8_t                     rtc_get_aging (int_fast8_t *);
+extern uint_fast8_t                     rtc_set_aging (int_fast8_t);
+
+#endif
@@ -0,0 +1,15 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * timer.h - host test stub
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+#define TIMER_TICKS_PER_SEC             F_INTERRUPTS
+#define TIMER_MSEC_TO_TICKS(ms)         (((ms) * TIMER_TICKS_PER_SEC) / 1000)
+
+extern volatile uint32_t                timer_ticks;
+
+#endif
@@ -0,0 +1,481 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * download-test.cpp - httpclient_download() of ESP8266/ESP-uclock/httpclient.cpp against a local stand-in of the update server
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The stand-in server runs in a child process and serves some files with random content and a manifest.txt with their checksums.
+ * The first component of the path selects how it answers:
+ *
+ *      ok          Content-Length, Range requests are answered with status 206
+ *      drop        like ok, but every connection is dropped after about 9000 bytes
+ *      norange     first connection dropped after half of the file, then the Range header is ignored (status 200)
+ *      badrange    first connection dropped after half of the file, then status 206 with the wrong start in Content-Range
+ *      dead        every connection is dropped after 1000 bytes
+ *
+ * The test downloads into a temporary directory used as LittleFS and checks the result, the number of resumes and the requests
+ * the server got. A download which fails - dead server, checksum mismatch, 404 - must keep the old target and must not leave the
+ * temporary file. stm32_flash_download_image() must keep the old STM32 image in this case, too.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <string>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "LittleFS.h"
+#include <bearssl/bearssl_hash.h>
+#include "httpclient.h"
+
+#define HOST                        "stand-in"
+#define DROP_BYTES                  9000                    // mode drop: bytes per connection
+#define DEAD_BYTES                  1000                    // mode dead: bytes per connection
+
+#define MODE_OK                     0
+#define MODE_DROP                   1
+#define MODE_NORANGE                2
+#define MODE_BADRANGE               3
+#define MODE_DEAD                   4
+#define N_MODES                     5
+
+static const char *                 mode_names[N_MODES] = { "ok", "drop", "norange", "badrange", "dead" };
+
+typedef struct
+{
+    const char *                    name;
+    size_t                          len;
+    std::string                     data;
+} SERVER_FILE;
+
+#define FILE_HEX                    0                       // listed with SHA-256
+#define FILE_BIN                    1                       // listed with CRC32
+#define FILE_BAD                    2                       // listed with wrong SHA-256
+#define FILE_PLAIN                  3                       // not listed
+#define N_FILES                     4
+
+static SERVER_FILE                  files[N_FILES] =
+{
+    { "fw.hex",     40000,  "" },
+    { "fw.bin",     30000,  "" },
+    { "bad.bin",    20000,  "" },
+    { "plain.bin",  5000,   "" },
+};
+
+static std::string                  manifest;
+
+typedef struct
+{
+    uint32_t                        requests[N_MODES];      // requests of files, manifest not counted
+    uint32_t                        ranges[N_MODES];        // requests with Range header
+} SERVER_STATS;
+
+static volatile SERVER_STATS *      stats;                  // shared with server
+static uint32_t                     n_errors;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * output of the flasher: http_send() etc. of http.cpp write into http_log
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static std::string                  http_log;
+
+void
+http_send (const char * s)
+{
+    http_log += s;
+}
+
+void
+http_send_P (const char * s)
+{
+    http_log += s;
+}
+
+void
+http_flush (void)
+{
+}
+
+extern bool                         stm32_flash_download_image (const char *, const char *, const char *);
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * stand-in server
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t                     rand_state = 1;
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static void
+send_all (int fd, const char * buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0 && (n = send (fd, buf, len, MSG_NOSIGNAL)) > 0)
+    {
+        buf += n;
+        len -= n;
+    }
+}
+
+static void
+send_str (int fd, const char * s)
+{
+    send_all (fd, s, strlen (s));
+}
+
+static void
+serve (int fd)
+{
+    char            request[1024];
+    char            header[256];
+    char            name[64];
+    const char *    range;
+    size_t          len = 0;
+    size_t          start = 0;
+    size_t          n;
+    ssize_t         rtc;
+    uint32_t        nreq;
+    int             mode;
+    int             i;
+
+    while (len < sizeof (request) - 1 && (rtc = recv (fd, request + len, sizeof (request) - 1 - len, 0)) > 0)
+    {
+        len += rtc;
+        request[len] = '\0';
+
+        if (strstr (request, "\r\n\r\n"))
+        {
+            break;
+        }
+    }
+
+    request[len] = '\0';
+
+    for (mode = 0; mode < N_MODES; mode++)
+    {
+        n = strlen (mode_names[mode]);
+
+        if (! strncmp (request, "GET /", 5) && ! strncmp (request + 5, mode_names[mode], n) && request[5 + n] == '/')
+        {
+            break;
+        }
+    }
+
+    if (mode == N_MODES || sscanf (request + 6 + strlen (mode_names[mode]), "%63s", name) != 1)
+    {
+        send_str (fd, "HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n");
+        return;
+    }
+
+    if (! strcmp (name, HTTPCLIENT_MANIFEST))
+    {
+        n = snprintf (header, sizeof (header), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", manifest.length ());
+        send_all (fd, header, n);
+        send_all (fd, manifest.c_str (), manifest.length ());
+        return;
+    }
+
+    for (i = 0; i < N_FILES; i++)
+    {
+        if (! strcmp (name, files[i].name))
+        {
+            break;
+        }
+    }
+
+    if (i == N_FILES)
+    {
+        send_str (fd, "HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n");
+        return;
+    }
+
+    nreq = ++stats->requests[mode];
+    len = files[i].len;
+    range = strstr (request, "\r\nRange: bytes=");
+
+    if (range)
+    {
+        stats->ranges[mode]++;
+        start = atol (range + 15);
+    }
+
+    if (range && mode != MODE_NORANGE && start < len)
+    {
+        n = snprintf (header, sizeof (header), "HTTP/1.1 206 Partial Content\r\nContent-Length: %zu\r\nContent-Range: bytes %zu-%zu/%zu\r\n"
+                      "Connection: close\r\n\r\n", len - start, (mode == MODE_BADRANGE) ? start - 100 : start, len - 1, len);
+    }
+    else
+    {
+        start = 0;
+        n = snprintf (header, sizeof (header), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", len);
+    }
+
+    send_all (fd, header, n);
+
+    switch (mode)
+    {
+        case MODE_DROP:     len = std::min (len, start + DROP_BYTES + next_rand () % 1000);     break;
+        case MODE_DEAD:     len = std::min (len, start + DEAD_BYTES);                           break;
+        case MODE_NORANGE:
+        case MODE_BADRANGE: len = (nreq == 1) ? len / 2 : len;                                  break;
+    }
+
+    send_all (fd, files[i].data.c_str () + start, len - start);
+    usleep (10000);                                                             // let the client read all before the reset
+    shutdown (fd, SHUT_RDWR);
+}
+
+static pid_t
+start_server (void)
+{
+    struct sockaddr_in  addr;
+    socklen_t           len = sizeof (addr);
+    pid_t               pid;
+    int                 fd;
+    int                 cfd;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl (INADDR_LOOPBACK);
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+
+    if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen (fd, 8) < 0)
+    {
+        perror ("stand-in server");
+        exit (1);
+    }
+
+    getsockname (fd, (struct sockaddr *) &addr, &len);
+    stub_client_port = ntohs (addr.sin_port);
+
+    pid = fork ();
+
+    if (pid == 0)
+    {
+        signal (SIGCHLD, SIG_IGN);
+
+        while ((cfd = accept (fd, NULL, NULL)) >= 0)
+        {
+            if (fork () == 0)                                                   // one process per connection
+            {
+                rand_state = stats->requests[MODE_DROP] * 7919 + 1;
+                serve (cfd);
+                close (cfd);
+                _exit (0);
+            }
+            close (cfd);
+        }
+        _exit (0);
+    }
+
+    close (fd);
+    return pid;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * files and manifest
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+hex_digits (std::string & s, const uint8_t * p, int n)
+{
+    char    buf[3];
+
+    while (n--)
+    {
+        sprintf (buf, "%02x", *p++);
+        s += buf;
+    }
+}
+
+static void
+make_files (void)
+{
+    br_sha256_context   ctx;
+    uint8_t             digest[32];
+    uint32_t            crc;
+    size_t              i;
+    int                 f;
+    int                 b;
+
+    for (f = 0; f < N_FILES; f++)
+    {
+        for (i = 0; i < files[f].len; i++)
+        {
+            files[f].data += (f == FILE_HEX) ? "0123456789ABCDEF\n"[next_rand () % 17] : (char) next_rand ();
+        }
+    }
+
+    br_sha256_init (&ctx);
+    br_sha256_update (&ctx, files[FILE_HEX].data.c_str (), files[FILE_HEX].len);
+    br_sha256_out (&ctx, digest);
+    hex_digits (manifest, digest, 32);
+    manifest += "  fw.hex\n";
+
+    crc = 0xFFFFFFFF;
+
+    for (i = 0; i < files[FILE_BIN].len; i++)
+    {
+        crc ^= (uint8_t) files[FILE_BIN].data[i];
+
+        for (b = 0; b < 8; b++)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+    }
+
+    crc = ~crc;
+    digest[0] = crc >> 24;
+    digest[1] = crc >> 16;
+    digest[2] = crc >> 8;
+    digest[3] = crc;
+    hex_digits (manifest, digest, 4);
+    manifest += "\tfw.bin\n";
+
+    br_sha256_init (&ctx);                                                      // checksum of other content
+    br_sha256_update (&ctx, files[FILE_BIN].data.c_str (), files[FILE_BAD].len);
+    br_sha256_out (&ctx, digest);
+    hex_digits (manifest, digest, 32);
+    manifest += " *bad.bin\n";
+}
+
+static std::string
+read_file (const char * name)
+{
+    File        f = LittleFS.open (name, "r");
+    std::string s;
+    int         ch;
+
+    while ((ch = f.read ()) >= 0)
+    {
+        s += (char) ch;
+    }
+
+    f.close ();
+    return s;
+}
+
+static void
+write_file (const char * name, const char * content)
+{
+    File        f = LittleFS.open (name, "w");
+
+    f.write ((const uint8_t *) content, strlen (content));
+    f.close ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * checks
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+check (bool ok, const char * what, const char * detail)
+{
+    if (! ok)
+    {
+        printf ("download-test: %s: %s failed\n", what, detail);
+        n_errors++;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * download file from path mode into target, expected: HTTPCLIENT_OK or error, content: new content or old content of target
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+download (const char * what, int mode, const char * filename, int expected, const std::string & content, uint32_t min_resumes,
+          uint32_t max_resumes)
+{
+    HTTPCLIENT_DOWNLOAD dl;
+    char                info[HTTPCLIENT_INFO_SIZE];
+    int                 rtc;
+
+    memset ((void *) stats, 0, sizeof (SERVER_STATS));
+    rtc = httpclient_download (HOST, mode_names[mode], filename, "target", &dl);
+    httpclient_download_info (info, rtc, &dl);
+    printf ("download-test: %-10s %-9s %-9s %s, %u request(s), %u with Range\n", what, mode_names[mode], filename, info,
+            stats->requests[mode], stats->ranges[mode]);
+
+    check (rtc == expected, what, "result");
+    check (read_file ("target") == content, what, "content of target");
+    check (! LittleFS.exists ("download.tmp"), what, "temporary file removed");
+    check (dl.resumes >= min_resumes && dl.resumes <= max_resumes, what, "number of resumes");
+}
+
+int
+main (void)
+{
+    char            fs_root[] = "/tmp/download-test-XXXXXX";
+    std::string     old_content = "old content\n";
+    pid_t           pid;
+
+    make_files ();
+    stats = (volatile SERVER_STATS *) mmap (NULL, sizeof (SERVER_STATS), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    pid = start_server ();
+    stub_fs_root = mkdtemp (fs_root);
+
+    download ("complete", MODE_OK, "fw.hex", HTTPCLIENT_OK, files[FILE_HEX].data, 0, 0);
+    check (stats->requests[MODE_OK] == 1 && stats->ranges[MODE_OK] == 0, "complete", "one request without Range");
+
+    download ("crc32", MODE_OK, "fw.bin", HTTPCLIENT_OK, files[FILE_BIN].data, 0, 0);
+    download ("unlisted", MODE_OK, "plain.bin", HTTPCLIENT_OK, files[FILE_PLAIN].data, 0, 0);
+
+    /*---------------------------------------------------------------------------------------------------------------------------------------
+     * dropped connections: resume with Range request
+     *---------------------------------------------------------------------------------------------------------------------------------------
+     */
+    download ("resume", MODE_DROP, "fw.hex", HTTPCLIENT_OK, files[FILE_HEX].data, 3, 4);
+    check (stats->ranges[MODE_DROP] == stats->requests[MODE_DROP] - 1, "resume", "all requests after the first with Range");
+
+    download ("resume", MODE_DROP, "fw.bin", HTTPCLIENT_OK, files[FILE_BIN].data, 2, 3);
+    download ("norange", MODE_NORANGE, "fw.hex", HTTPCLIENT_OK, files[FILE_HEX].data, 1, 1);
+    download ("badrange", MODE_BADRANGE, "fw.bin", HTTPCLIENT_OK, files[FILE_BIN].data, 2, 2);
+    check (stats->ranges[MODE_BADRANGE] == 1, "badrange", "content requested again without Range");
+
+    /*---------------------------------------------------------------------------------------------------------------------------------------
+     * failed downloads keep the old target
+     *---------------------------------------------------------------------------------------------------------------------------------------
+     */
+    write_file ("target", old_content.c_str ());
+    download ("dead", MODE_DEAD, "fw.hex", HTTPCLIENT_ERR_CONNECT, old_content, 5, 5);
+    download ("checksum", MODE_DROP, "bad.bin", HTTPCLIENT_ERR_CHECKSUM, old_content, 2, 2);
+    download ("404", MODE_OK, "missing.bin", HTTPCLIENT_ERR_CONNECT, old_content, 0, 0);
+
+    /*---------------------------------------------------------------------------------------------------------------------------------------
+     * STM32 image: the old image is kept until the new one is verified, the image of the other format is removed
+     *---------------------------------------------------------------------------------------------------------------------------------------
+     */
+    write_file ("stm32.hex", old_content.c_str ());
+    check (! stm32_flash_download_image (HOST, "ok", "bad.bin"), "stm32 image", "failed download");
+    check (read_file ("stm32.hex") == old_content && ! LittleFS.exists ("stm32.bin"), "stm32 image", "old image kept");
+    check (http_log.find ("checksum mismatch") != std::string::npos, "stm32 image", "error reported");
+
+    check (stm32_flash_download_image (HOST, "drop", "fw.bin"), "stm32 image", "download");
+    check (read_file ("stm32.bin") == files[FILE_BIN].data && ! LittleFS.exists ("stm32.hex"), "stm32 image", "image replaced");
+
+    check (stm32_flash_download_image (HOST, "ok", "fw.hex"), "stm32 image", "download hex");
+    check (read_file ("stm32.hex") == files[FILE_HEX].data && ! LittleFS.exists ("stm32.bin"), "stm32 image", "hex replaces bin");
+
+    LittleFS.format ();
+    rmdir (fs_root);
+    kill (pid, SIGTERM);
+    waitpid (pid, NULL, 0);
+
+    printf ("download-test: %u errors\n", n_errors);
+    return n_errors ? 1 : 0;
+}
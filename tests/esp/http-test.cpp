@@ -0,0 +1,707 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * http-test.cpp - load test of the http server in ESP8266/ESP-uclock/http.cpp
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The server runs like in the main loop of the ESP8266: the test calls http_server_loop() again and again and measures the duration
+ * of each call. The clients run in child processes and use the sockets of the host:
+ *
+ *      keepalive   HTTP/1.1, all requests on one connection, every second time two requests pipelined
+ *      slow        HTTP/1.1 with small receive buffer, reads 256 bytes every 2 msec
+ *      http10      HTTP/1.0, one connection per request
+ *      params      requests with parameters, they wait until the complete output pool is free
+ *
+ * First /style.css is checked: gzip or uncompressed depending on Accept-Encoding, each with its own ETag and with Vary.
+ * Each page is loaded alone first as reference, every response under load must be equal. The slow clients exhaust the output
+ * pool, so page generation is suspended and resumed. In a second phase a client stops reading in the middle of a page: the
+ * other clients must still be served, the stalled client must be dropped after the send timeout, which is advanced with
+ * stub_millis_offset.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "http.h"
+#include "assets.h"
+
+#define MAX_LOOP_MSEC               25                      // max. duration of one http_server_loop() call
+#define MAX_BODY_LEN                32768
+#define REQUESTS_PER_CLIENT         40
+#define SEND_TIMEOUT                5000                    // HTTP_SEND_TIMEOUT of http.cpp
+
+#define CLIENT_KEEPALIVE            0
+#define CLIENT_SLOW                 1
+#define CLIENT_HTTP10               2
+#define CLIENT_PARAMS               3
+#define N_CLIENT_TYPES              4
+
+static const char *                 client_names[N_CLIENT_TYPES] = { "keepalive", "slow", "http10", "params" };
+static const int                    client_counts[N_CLIENT_TYPES] = { 2, 3, 1, 1 };
+
+static const char *                 pages[] = { "/", "/display", "/animations", "/timers", "/atimers", "/dfplayer", "/ambilight",
+                                                "/dispbright", "/ldr", "/temperature" };
+#define N_PAGES                     (sizeof (pages) / sizeof (pages[0]))
+
+typedef struct
+{
+    int                             len;
+    char                            body[MAX_BODY_LEN];
+} REFERENCE;
+
+static REFERENCE *                  refs;                   // shared with clients: [page][gzip]
+static uint32_t                     rand_state = 1;
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * client side: connect, send request, read and check response
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+typedef struct
+{
+    int                             fd;
+    int                             slow;
+    char                            buf[4096];
+    int                             len;
+    int                             pos;
+} CONN;
+
+static int
+client_connect (CONN * c, int slow)
+{
+    struct sockaddr_in  addr;
+    int                 size = 1024;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl (INADDR_LOOPBACK);
+    addr.sin_port           = htons (stub_server_port);
+
+    c->fd   = socket (AF_INET, SOCK_STREAM, 0);
+    c->slow = slow;
+    c->len  = 0;
+    c->pos  = 0;
+
+    if (slow)
+    {
+        setsockopt (c->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof (size));
+    }
+
+    return connect (c->fd, (struct sockaddr *) &addr, sizeof (addr)) == 0;
+}
+
+static int
+client_getc (CONN * c)
+{
+    if (c->pos == c->len)
+    {
+        ssize_t n;
+
+        if (c->slow)
+        {
+            usleep (2000);
+        }
+
+        n = recv (c->fd, c->buf, c->slow ? 256 : sizeof (c->buf), 0);
+
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        c->len = n;
+        c->pos = 0;
+    }
+
+    return (uint8_t) c->buf[c->pos++];
+}
+
+static int
+client_line (CONN * c, char * line, int size)
+{
+    int len = 0;
+    int ch;
+
+    while ((ch = client_getc (c)) >= 0 && ch != '\n')
+    {
+        if (len < size - 1)
+        {
+            line[len++] = ch;
+        }
+    }
+
+    if (len > 0 && line[len - 1] == '\r')
+    {
+        len--;
+    }
+
+    line[len] = '\0';
+    return ch < 0 ? -1 : len;
+}
+
+static void
+client_send (CONN * c, const char * page, const char * param, int http10, int gzip)
+{
+    char    request[256];
+
+    snprintf (request, sizeof (request), "GET %s%s HTTP/1.%d\r\nHost: clock\r\n%s\r\n", page, param, http10 ? 0 : 1,
+              gzip ? "Accept-Encoding: gzip, deflate\r\n" : "");
+    send (c->fd, request, strlen (request), MSG_NOSIGNAL);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read response, returns length of body, -1 on error. *chunkedp is set if the body was chunked, *closep if connection is closed.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+client_response (CONN * c, char * body, int * chunkedp, int * closep)
+{
+    char    line[256];
+    long    content_length = -1;
+    int     chunked = 0;
+    int     close_conn = 0;
+    int     len = 0;
+    int     ch;
+
+    if (client_line (c, line, sizeof (line)) < 0 || strncmp (line + 8, " 200 OK", 7))
+    {
+        printf ("http-test: bad status line '%s'\n", line);
+        return -1;
+    }
+
+    while (client_line (c, line, sizeof (line)) > 0)
+    {
+        if (! strncasecmp (line, "Content-Length:", 15))
+        {
+            content_length = atol (line + 15);
+        }
+        else if (! strcasecmp (line, "Transfer-Encoding: chunked"))
+        {
+            chunked = 1;
+        }
+        else if (! strcasecmp (line, "Connection: close"))
+        {
+            close_conn = 1;
+        }
+    }
+
+    if (chunked)
+    {
+        for (;;)
+        {
+            char *  e;
+            long    n;
+
+            if (client_line (c, line, sizeof (line)) <= 0 || (n = strtol (line, &e, 16)) < 0 || *e)
+            {
+                printf ("http-test: bad chunk size line '%s'\n", line);
+                return -1;
+            }
+
+            if (n == 0)
+            {
+                if (client_line (c, line, sizeof (line)) != 0)
+                {
+                    printf ("http-test: no empty line after last chunk\n");
+                    return -1;
+                }
+                break;
+            }
+
+            while (n-- > 0 && (ch = client_getc (c)) >= 0 && len < MAX_BODY_LEN)
+            {
+                body[len++] = ch;
+            }
+
+            if (client_line (c, line, sizeof (line)) != 0)
+            {
+                printf ("http-test: no CRLF after chunk data\n");
+                return -1;
+            }
+        }
+    }
+    else if (content_length >= 0)
+    {
+        while (len < content_length && (ch = client_getc (c)) >= 0 && len < MAX_BODY_LEN)
+        {
+            body[len++] = ch;
+        }
+
+        if (len != content_length)
+        {
+            printf ("http-test: body too short: %d of %ld bytes\n", len, content_length);
+            return -1;
+        }
+    }
+    else if (close_conn)
+    {
+        while ((ch = client_getc (c)) >= 0 && len < MAX_BODY_LEN)
+        {
+            body[len++] = ch;
+        }
+    }
+    else
+    {
+        printf ("http-test: length of body unknown\n");
+        return -1;
+    }
+
+    *chunkedp   = chunked;
+    *closep     = close_conn;
+    return len;
+}
+
+static int
+check_body (int page, int gzip, const char * body, int len, const char * client)
+{
+    const REFERENCE * ref = refs + 2 * page + gzip;
+
+    if (len != ref->len || memcmp (body, ref->body, len))
+    {
+        printf ("http-test: %s: %s%s differs from reference (%d, %d bytes)\n", client, pages[page], gzip ? " (gzip)" : "", len, ref->len);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * load client, exit status is the number of errors
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+client (int type, int id)
+{
+    static char body[MAX_BODY_LEN];
+    CONN        c;
+    int         errors = 0;
+    int         connected = 0;
+    int         r;
+
+    rand_state = id + 1;
+
+    for (r = 0; r < REQUESTS_PER_CLIENT && errors < 5; r++)
+    {
+        int page    = next_rand () % N_PAGES;
+        int gzip    = next_rand () % 2;
+        int http10  = (type == CLIENT_HTTP10);
+        int pipe2   = (type == CLIENT_KEEPALIVE && r % 2);
+        int page2   = next_rand () % N_PAGES;
+        int chunked;
+        int close_conn;
+        int len;
+
+        if (! connected && ! (connected = client_connect (&c, type == CLIENT_SLOW)))
+        {
+            printf ("http-test: %s: cannot connect\n", client_names[type]);
+            return 1;
+        }
+
+        client_send (&c, pages[page], type == CLIENT_PARAMS ? "?x=1" : "", http10, gzip);
+
+        if (pipe2)
+        {
+            client_send (&c, pages[page2], "", http10, gzip);
+        }
+
+        len = client_response (&c, body, &chunked, &close_conn);
+
+        if (len < 0 || check_body (page, gzip, body, len, client_names[type]))
+        {
+            errors++;
+            close (c.fd);
+            connected = 0;
+            continue;
+        }
+
+        if (pipe2)
+        {
+            len = client_response (&c, body, &chunked, &close_conn);
+
+            if (len < 0 || check_body (page2, gzip, body, len, client_names[type]))
+            {
+                errors++;
+                close (c.fd);
+                connected = 0;
+                continue;
+            }
+        }
+
+        if (close_conn != http10)
+        {
+            printf ("http-test: %s: connection %s\n", client_names[type], close_conn ? "closed" : "kept");
+            errors++;
+        }
+
+        if (close_conn)
+        {
+            close (c.fd);
+            connected = 0;
+        }
+    }
+
+    if (connected)
+    {
+        close (c.fd);
+    }
+
+    return errors;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * static asset: request /style.css with HTTP/1.0, returns status code, copies header and body
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+asset_request (int gzip, const char * etag, char * header, char * body, int * lenp)
+{
+    static char response[MAX_BODY_LEN];
+    char        request[256];
+    CONN        c;
+    char *      p;
+    int         len = 0;
+    int         ch;
+
+    client_connect (&c, 0);
+    snprintf (request, sizeof (request), "GET /style.css?v=" STYLE_CSS_VERSION " HTTP/1.0\r\n%s%s%s%s\r\n",
+              gzip ? "Accept-Encoding: gzip, deflate\r\n" : "", etag ? "If-None-Match: \"" : "", etag ? etag : "", etag ? "\"\r\n" : "");
+    send (c.fd, request, strlen (request), MSG_NOSIGNAL);
+
+    while ((ch = client_getc (&c)) >= 0 && len < MAX_BODY_LEN - 1)
+    {
+        response[len++] = ch;
+    }
+
+    close (c.fd);
+    response[len] = '\0';
+
+    if (! (p = strstr (response, "\r\n\r\n")))
+    {
+        return -1;
+    }
+
+    memcpy (header, response, p + 2 - response);
+    header[p + 2 - response] = '\0';
+    *lenp = len - (p + 4 - response);
+    memcpy (body, p + 4, *lenp);
+    return atoi (response + 9);
+}
+
+static int
+assets (void)
+{
+    static char header[MAX_BODY_LEN];
+    static char body[MAX_BODY_LEN];
+    char        etags[2][32];
+    int         errors = 0;
+    int         gzip;
+    int         len;
+
+    for (gzip = 0; gzip < 2; gzip++)
+    {
+        const uint8_t * ref     = gzip ? style_css_gz : style_css;
+        int             ref_len = gzip ? sizeof (style_css_gz) : sizeof (style_css);
+        char *          p;
+
+        if (asset_request (gzip, NULL, header, body, &len) != 200 || len != ref_len || memcmp (body, ref, len))
+        {
+            printf ("http-test: style.css%s: wrong response\n", gzip ? " (gzip)" : "");
+            errors++;
+        }
+
+        if (! strstr (header, "\r\nVary: Accept-Encoding\r\n") || ! strstr (header, "\r\nContent-Encoding: gzip\r\n") != ! gzip)
+        {
+            printf ("http-test: style.css%s: wrong header:\n%s", gzip ? " (gzip)" : "", header);
+            errors++;
+        }
+
+        etags[gzip][0] = '\0';
+
+        if ((p = strstr (header, "\r\nETag: \"")) != NULL)
+        {
+            sscanf (p + 9, "%31[^\"]", etags[gzip]);
+        }
+    }
+
+    if (! etags[0][0] || ! strcmp (etags[0], etags[1]))
+    {
+        printf ("http-test: style.css: ETags '%s' and '%s' not distinct\n", etags[0], etags[1]);
+        errors++;
+    }
+
+    for (gzip = 0; gzip < 2; gzip++)
+    {
+        if (asset_request (gzip, etags[gzip], header, body, &len) != 304 || len != 0 ||
+            asset_request (gzip, etags[! gzip], header, body, &len) != 200)
+        {
+            printf ("http-test: style.css%s: If-None-Match not answered with ETag of encoding\n", gzip ? " (gzip)" : "");
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reference pages, each page is loaded twice alone: must be equal
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+reference (void)
+{
+    static char body[MAX_BODY_LEN];
+    CONN        c;
+    int         chunked;
+    int         close_conn;
+    int         errors = 0;
+    uint32_t    p;
+    int         gzip;
+
+    for (p = 0; p < N_PAGES; p++)
+    {
+        for (gzip = 0; gzip < 2; gzip++)
+        {
+            REFERENCE * ref = refs + 2 * p + gzip;
+
+            client_connect (&c, 0);
+            client_send (&c, pages[p], "", 0, gzip);
+            ref->len = client_response (&c, ref->body, &chunked, &close_conn);
+            client_send (&c, pages[p], "", 0, gzip);
+
+            if (ref->len <= 0 || chunked || client_response (&c, body, &chunked, &close_conn) != ref->len || memcmp (body, ref->body, ref->len))
+            {
+                printf ("http-test: reference %s%s not stable\n", pages[p], gzip ? " (gzip)" : "");
+                errors++;
+            }
+
+            close (c.fd);
+        }
+    }
+
+    return errors;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * stalled client: requests the largest page and stops reading until *releasep is set, the connection must then be closed
+ * before the complete page has arrived
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+stalled (volatile int * releasep)
+{
+    CONN        c;
+    int         len = 0;
+
+    client_connect (&c, 1);
+    client_send (&c, "/dfplayer", "", 0, 0);
+
+    while (! *releasep)
+    {
+        usleep (1000);
+    }
+
+    c.slow = 0;
+
+    while (client_getc (&c) >= 0)
+    {
+        len++;
+    }
+
+    close (c.fd);
+
+    if (len >= refs[2 * 5].len)
+    {
+        printf ("http-test: stalled client got complete page\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * server: run http_server_loop() until all children have exited, returns number of children with errors
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static unsigned long                max_loop_usec;
+static uint32_t                     loops;
+
+static int
+serve (int n_children, pid_t stall_pid, volatile int * releasep)
+{
+    unsigned long   release_time = 0;
+    int             errors = 0;
+    int             status;
+    pid_t           pid;
+
+    while (n_children > 0)
+    {
+        unsigned long t = micros ();
+
+        http_server_loop ();
+        t = micros () - t;
+        loops++;
+
+        if (max_loop_usec < t)
+        {
+            max_loop_usec = t;
+        }
+
+        while ((pid = waitpid (-1, &status, WNOHANG)) > 0)
+        {
+            n_children--;
+
+            if (! WIFEXITED (status) || WEXITSTATUS (status))
+            {
+                errors++;
+            }
+        }
+
+        if (stall_pid && n_children == 1 && ! release_time)                     // only stalled client left: advance time
+        {
+            stub_millis_offset += SEND_TIMEOUT + 1000;
+            release_time = millis ();
+            *releasep = 1;
+        }
+
+        usleep (50);
+    }
+
+    return errors;
+}
+
+int
+main (void)
+{
+    volatile int *  release;
+    unsigned long   timeouts;
+    uint32_t        n_errors = 0;
+    uint32_t        n_requests = 0;
+    pid_t           pid;
+    int             type;
+    int             i;
+    int             n;
+
+    setvbuf (stdout, NULL, _IONBF, 0);
+    refs    = (REFERENCE *) mmap (NULL, 2 * N_PAGES * sizeof (REFERENCE), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    release = (volatile int *) mmap (NULL, sizeof (int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    stub_server_port = 0;                                                       // ephemeral port
+    http_server_begin ();
+
+    if (fork () == 0)
+    {
+        exit (assets ());
+    }
+
+    if (serve (1, 0, release))
+    {
+        printf ("http-test: style.css failed\n");
+        return 1;
+    }
+
+    if (fork () == 0)
+    {
+        exit (reference ());
+    }
+
+    if (serve (1, 0, release))
+    {
+        printf ("http-test: reference pages failed\n");
+        return 1;
+    }
+
+    http_reset_stats ();
+    max_loop_usec = 0;
+    n = 0;
+
+    for (type = 0; type < N_CLIENT_TYPES; type++)                               // phase 1: load
+    {
+        for (i = 0; i < client_counts[type]; i++)
+        {
+            if (fork () == 0)
+            {
+                exit (client (type, n));
+            }
+
+            n++;
+            n_requests += REQUESTS_PER_CLIENT + (type == CLIENT_KEEPALIVE ? REQUESTS_PER_CLIENT / 2 : 0);
+        }
+    }
+
+    n_errors += serve (n, 0, release);
+
+    printf ("http-test: load: %u requests, %u loops, max loop %lu usec, suspended %lu, changed on resume %lu, keep-alive %lu\n",
+            n_requests, loops, max_loop_usec, http_stats.overflows, http_stats.resume_errors, http_stats.keepalive);
+    printf ("http-test: latency");
+
+    for (i = 0; i < HTTP_LATENCY_BUCKETS; i++)
+    {
+        printf (" %lu", http_stats.latency[i]);
+    }
+
+    printf (", max %lu msec\n", http_stats.max_latency);
+
+    if (http_stats.requests != n_requests)
+    {
+        printf ("http-test: server counted %lu requests\n", http_stats.requests);
+        n_errors++;
+    }
+
+    if (http_stats.overflows == 0 || http_stats.resume_errors != 0)
+    {
+        printf ("http-test: page generation not suspended or resumed page changed\n");
+        n_errors++;
+    }
+
+    timeouts = http_stats.timeouts;
+
+    if ((pid = fork ()) == 0)                                                   // phase 2: stalled client
+    {
+        exit (stalled (release));
+    }
+
+    usleep (100000);
+
+    for (i = 0; i < 2; i++)
+    {
+        if (fork () == 0)
+        {
+            exit (client (CLIENT_KEEPALIVE, 100 + i));
+        }
+    }
+
+    n_errors += serve (3, pid, release);
+
+    printf ("http-test: stall: max loop %lu usec, dropped %lu\n", max_loop_usec, http_stats.timeouts - timeouts);
+
+    if (http_stats.timeouts - timeouts != 1)
+    {
+        printf ("http-test: stalled client not dropped\n");
+        n_errors++;
+    }
+
+    if (max_loop_usec > MAX_LOOP_MSEC * 1000UL)
+    {
+        printf ("http-test: http_server_loop() blocked for %lu msec\n", max_loop_usec / 1000);
+        n_errors++;
+    }
+
+    printf ("http-test: %u errors\n", n_errors);
+    return n_errors ? 1 : 0;
+}
@@ -0,0 +1,776 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * soak-test.cpp - soak test of the server-sent events of ESP8266/ESP-uclock/http.cpp with a check of heap fragmentation
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The server runs like in the main loop of the ESP8266 and changes numeric variables again and again with var_set_parameter(),
+ * like the STM32 does. Meanwhile malloc() and new use the emulated heap of the ESP8266 in stubs/arduino.cpp, so fragmentation
+ * is the same as on the target. The clients run in child processes:
+ *
+ *      events      /api/events, checks that the ids increase and that the values of the events add up to the final values,
+ *                  reconnects with Last-Event-ID after a random number of events
+ *      pages       HTTP/1.1 keep-alive, HTTP/1.0, requests with parameters and /api/state?since=. A suspended page may change
+ *                  because of the variable changes, then the server cuts the chunked response: allowed as often as the server
+ *                  counted a changed page on resume.
+ *      dropper     requests a large page and closes the connection in the middle of the response
+ *
+ * The same workload runs twice: a short warm-up, after which the free heap and the largest free block of the idle server are
+ * taken as baseline, and the long soak run. After the soak run the idle server must have the same free heap (no leak) and a
+ * largest free block not smaller than after the warm-up (no creeping fragmentation), during the run the fragmentation must stay
+ * below MAX_FRAGMENTATION.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "http.h"
+#include "vars.h"
+
+#define WARMUP_CHANGES              100                     // variable changes of warm-up run
+#define SOAK_CHANGES                3000                    // variable changes of soak run
+#define LOOPS_PER_CHANGE            20                      // calls of http_server_loop() between two changes
+#define N_VARS                      4                       // changed numeric variables 0...N_VARS-1
+#define N_EVENT_CLIENTS             2                       // HTTP_MAX_EVENT_CLIENTS of http.cpp
+#define MAX_FRAGMENTATION           30                      // max. heap fragmentation during run, percent
+#define MAX_BODY_LEN                32768
+
+typedef struct
+{
+    volatile uint32_t               final_gen;              // generation after last change, 0 while changes are running
+    volatile unsigned int           final_vals[N_VARS];     // values of variables after last change
+    volatile uint32_t               truncated;              // chunked responses ended by server
+} SHARED;
+
+static SHARED *                     shared;
+static uint32_t                     rand_state = 1;
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * client side: connect, send request, read lines. Reading times out after 200 msec, so event clients can check for the end.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define READ_TIMEOUT                (-2)
+
+typedef struct
+{
+    int                             fd;
+    char                            buf[4096];
+    int                             len;
+    int                             pos;
+} CONN;
+
+static int
+client_connect (CONN * c)
+{
+    struct sockaddr_in  addr;
+    struct timeval      tv = { 0, 200000 };
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl (INADDR_LOOPBACK);
+    addr.sin_port           = htons (stub_server_port);
+
+    c->fd   = socket (AF_INET, SOCK_STREAM, 0);
+    c->len  = 0;
+    c->pos  = 0;
+
+    setsockopt (c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+    return connect (c->fd, (struct sockaddr *) &addr, sizeof (addr)) == 0;
+}
+
+static int
+client_getc (CONN * c)
+{
+    if (c->pos == c->len)
+    {
+        ssize_t n = recv (c->fd, c->buf, sizeof (c->buf), 0);
+
+        if (n < 0 && errno == EAGAIN)
+        {
+            return READ_TIMEOUT;
+        }
+
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        c->len = n;
+        c->pos = 0;
+    }
+
+    return (uint8_t) c->buf[c->pos++];
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read line, returns length or -1 on error. READ_TIMEOUT is only returned if no character of the line has arrived, within a
+ * line the server may pause up to 10 seconds.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+client_line (CONN * c, char * line, int size)
+{
+    int len = 0;
+    int timeouts = 0;
+    int ch;
+
+    while ((ch = client_getc (c)) != '\n')
+    {
+        if (ch == READ_TIMEOUT)
+        {
+            if (len == 0)
+            {
+                return READ_TIMEOUT;
+            }
+
+            if (++timeouts == 50)
+            {
+                return -1;
+            }
+
+            continue;
+        }
+
+        if (ch < 0)
+        {
+            return -1;
+        }
+
+        if (len < size - 1)
+        {
+            line[len++] = ch;
+        }
+    }
+
+    if (len > 0 && line[len - 1] == '\r')
+    {
+        len--;
+    }
+
+    line[len] = '\0';
+    return len;
+}
+
+static int
+client_getc_wait (CONN * c)
+{
+    int ch;
+    int timeouts = 0;
+
+    while ((ch = client_getc (c)) == READ_TIMEOUT && ++timeouts < 50)
+    {
+        ;
+    }
+
+    return ch;
+}
+
+static void
+client_send (CONN * c, const char * path, int http10, uint32_t last_event_id)
+{
+    char    request[256];
+    char    header[64] = "";
+
+    if (last_event_id)
+    {
+        sprintf (header, "Last-Event-ID: %lu\r\n", (unsigned long) last_event_id);
+    }
+
+    snprintf (request, sizeof (request), "GET %s HTTP/1.%d\r\nHost: clock\r\n%s\r\n", path, http10 ? 0 : 1, header);
+    send (c->fd, request, strlen (request), MSG_NOSIGNAL);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read status line and header, returns status code or -1. *lenp is set to Content-Length or -1, *chunkedp and *closep like in
+ * http-test.cpp.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+client_header (CONN * c, long * lenp, int * chunkedp, int * closep)
+{
+    char    line[256];
+    int     status;
+
+    if (client_line (c, line, sizeof (line)) < 9 || strncmp (line, "HTTP/1.", 7))
+    {
+        return -1;
+    }
+
+    status      = atoi (line + 9);
+    *lenp       = -1;
+    *chunkedp   = 0;
+    *closep     = 0;
+
+    while (client_line (c, line, sizeof (line)) > 0)
+    {
+        if (! strncasecmp (line, "Content-Length:", 15))
+        {
+            *lenp = atol (line + 15);
+        }
+        else if (! strcasecmp (line, "Transfer-Encoding: chunked"))
+        {
+            *chunkedp = 1;
+        }
+        else if (! strcasecmp (line, "Connection: close"))
+        {
+            *closep = 1;
+        }
+    }
+
+    return status;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read body of response, returns length or -1
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+client_body (CONN * c, char * body, long content_length, int chunked, int close_conn)
+{
+    char    line[64];
+    int     len = 0;
+    int     ch;
+
+    if (chunked)
+    {
+        long    n;
+
+        while (client_line (c, line, sizeof (line)) > 0 && (n = strtol (line, NULL, 16)) > 0)
+        {
+            while (n-- > 0 && (ch = client_getc_wait (c)) >= 0 && len < MAX_BODY_LEN)
+            {
+                body[len++] = ch;
+            }
+
+            if (client_line (c, line, sizeof (line)) != 0)
+            {
+                return -1;
+            }
+        }
+
+        return client_line (c, line, sizeof (line)) == 0 ? len : -1;
+    }
+
+    if (content_length >= 0)
+    {
+        while (len < content_length && (ch = client_getc_wait (c)) >= 0 && len < MAX_BODY_LEN)
+        {
+            body[len++] = ch;
+        }
+
+        return len == content_length ? len : -1;
+    }
+
+    if (close_conn)
+    {
+        while ((ch = client_getc_wait (c)) >= 0 && len < MAX_BODY_LEN)
+        {
+            body[len++] = ch;
+        }
+
+        return len;
+    }
+
+    return -1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * apply "num" group of event data to vals
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+apply_event (const char * data, unsigned int * vals)
+{
+    const char *    p = strstr (data, "\"num\":{");
+    char *          e;
+
+    if (! p)
+    {
+        return;
+    }
+
+    p += 7;
+
+    while (*p == '"')
+    {
+        long            idx = strtol (p + 1, &e, 10);
+        unsigned long   val = strtoul (e + 2, &e, 10);
+
+        if (idx >= 0 && idx < N_VARS)
+        {
+            vals[idx] = val;
+        }
+
+        p = (*e == ',') ? e + 1 : e;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * event client, exit status is the number of errors
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+event_client (int id)
+{
+    static char     data[8192];
+    char            line[sizeof (data)];
+    unsigned int    vals[N_VARS] = { 0 };
+    uint32_t        last_id = 0;
+    uint32_t        event_id = 0;
+    unsigned long   events = 0;
+    unsigned long   reconnects = 0;
+    unsigned long   busy = 0;
+    int             errors = 0;
+    int             i;
+
+    rand_state = id + 1;
+
+    while (errors < 5 && ! (shared->final_gen && last_id >= shared->final_gen))
+    {
+        CONN    c;
+        long    content_length;
+        int     chunked;
+        int     close_conn;
+        int     status;
+        int     n_events = 5 + next_rand () % 50;                       // reconnect after n_events
+        int     first;                                                  // first event may repeat Last-Event-ID
+        int     len;
+
+        if (! client_connect (&c))
+        {
+            printf ("soak-test: events: cannot connect\n");
+            return 1;
+        }
+
+        client_send (&c, "/api/events?since=0", 0, last_id);
+        status = client_header (&c, &content_length, &chunked, &close_conn);
+
+        if (status == 503)                                              // old connection not yet closed by server
+        {
+            busy++;
+            close (c.fd);
+            usleep (10000);
+            continue;
+        }
+
+        if (status != 200)
+        {
+            printf ("soak-test: events: status %d\n", status);
+            errors++;
+            close (c.fd);
+            continue;
+        }
+
+        data[0]     = '\0';
+        event_id    = 0;
+        first       = 1;
+
+        while (n_events > 0 && ! (shared->final_gen && last_id >= shared->final_gen))
+        {
+            if ((len = client_line (&c, line, sizeof (line))) == READ_TIMEOUT)
+            {
+                continue;
+            }
+
+            if (len < 0)
+            {
+                printf ("soak-test: events: connection lost\n");
+                errors++;
+                break;
+            }
+
+            if (! strncmp (line, "id: ", 4))
+            {
+                event_id = strtoul (line + 4, NULL, 10);
+            }
+            else if (! strncmp (line, "data: ", 6))
+            {
+                strcpy (data, line + 6);
+            }
+            else if (len == 0 && event_id)                              // end of event
+            {
+                char    gen[32];
+
+                sprintf (gen, "{\"gen\":%lu,", (unsigned long) event_id);
+
+                if (event_id < last_id || (event_id == last_id && ! first) ||
+                    strncmp (data, gen, strlen (gen)) || data[strlen (data) - 1] != '}')
+                {
+                    printf ("soak-test: events: bad event %lu after %lu: '%.60s'\n", (unsigned long) event_id, (unsigned long) last_id, data);
+                    errors++;
+                }
+
+                apply_event (data, vals);
+                last_id     = event_id;
+                event_id    = 0;
+                first       = 0;
+                events++;
+                n_events--;
+            }
+        }
+
+        close (c.fd);                                                   // drop connection, reconnect with Last-Event-ID
+        reconnects++;
+    }
+
+    for (i = 0; i < N_VARS; i++)
+    {
+        if (vals[i] != shared->final_vals[i])
+        {
+            printf ("soak-test: events: variable %d is %u, expected %u\n", i, vals[i], shared->final_vals[i]);
+            errors++;
+        }
+    }
+
+    printf ("soak-test: events: %lu events, %lu reconnects, %lu refused\n", events, reconnects, busy);
+    return errors;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * page client, exit status is the number of errors
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+page_client (int id)
+{
+    static char         body[MAX_BODY_LEN + 1];
+    static const char * pages[] = { "/", "/display", "/timers", "/ambilight", "/ldr", "/temperature" };
+    CONN                c;
+    int                 connected = 0;
+    int                 errors = 0;
+
+    rand_state = id + 1;
+
+    while (errors < 5 && ! shared->final_gen)
+    {
+        char    path[64];
+        int     kind = next_rand () % 4;
+        int     http10 = (kind == 1);
+        long    content_length;
+        int     chunked;
+        int     close_conn;
+        int     status;
+        int     len;
+
+        if (kind == 2)
+        {
+            strcpy (path, "/ldr?x=1");
+        }
+        else if (kind == 3)
+        {
+            sprintf (path, "/api/state?since=%u", next_rand () % 1000);
+        }
+        else
+        {
+            strcpy (path, pages[next_rand () % (sizeof (pages) / sizeof (pages[0]))]);
+        }
+
+        if (! connected && ! (connected = client_connect (&c)))
+        {
+            printf ("soak-test: pages: cannot connect\n");
+            return 1;
+        }
+
+        client_send (&c, path, http10, 0);
+
+        if ((status = client_header (&c, &content_length, &chunked, &close_conn)) != 200 ||
+            (len = client_body (&c, body, content_length, chunked, close_conn)) <= 0)
+        {
+            if (status == 200 && chunked)                                   // resumed page has changed, server has closed
+            {
+                __sync_fetch_and_add (&shared->truncated, 1);
+            }
+            else
+            {
+                printf ("soak-test: pages: %s failed, status %d\n", path, status);
+                errors++;
+            }
+
+            close (c.fd);
+            connected = 0;
+            continue;
+        }
+
+        body[len] = '\0';
+
+        if (kind == 3 && strncmp (body, "{\"gen\":", 7))
+        {
+            printf ("soak-test: pages: bad state '%.60s'\n", body);
+            errors++;
+        }
+
+        if (close_conn)
+        {
+            close (c.fd);
+            connected = 0;
+        }
+    }
+
+    if (connected)
+    {
+        close (c.fd);
+    }
+
+    return errors;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * dropper: requests a large page and closes the connection after a random part of the response
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+dropper (int id)
+{
+    rand_state = id + 1;
+
+    while (! shared->final_gen)
+    {
+        CONN    c;
+        int     n = next_rand () % 4000;
+
+        if (! client_connect (&c))
+        {
+            printf ("soak-test: dropper: cannot connect\n");
+            return 1;
+        }
+
+        client_send (&c, "/dfplayer", 0, 0);
+
+        while (n-- > 0 && client_getc_wait (&c) >= 0)
+        {
+            ;
+        }
+
+        close (c.fd);
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * server side: run http_server_loop() on the heap of the ESP8266
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t                     min_free_heap = 0xFFFFFFFF;
+static uint32_t                     min_max_block = 0xFFFFFFFF;
+static uint8_t                      max_fragmentation;
+
+static void
+server_loop (void)
+{
+    uint8_t     frag;
+
+    stub_esp_heap = true;
+    http_server_loop ();
+    stub_esp_heap = false;
+
+    if (min_free_heap > ESP.getFreeHeap ())
+    {
+        min_free_heap = ESP.getFreeHeap ();
+    }
+
+    if (min_max_block > ESP.getMaxFreeBlockSize ())
+    {
+        min_max_block = ESP.getMaxFreeBlockSize ();
+    }
+
+    if (max_fragmentation < (frag = ESP.getHeapFragmentation ()))
+    {
+        max_fragmentation = frag;
+    }
+
+    usleep (50);
+}
+
+static void
+change_variable (uint32_t n)
+{
+    char    param[8];
+    int     idx = n % N_VARS;
+    int     val = next_rand () & 0xFFFF;
+
+    sprintf (param, "N%02x%02x%02x", idx, val & 0xFF, val >> 8);
+
+    stub_esp_heap = true;
+    var_set_parameter (param);
+    stub_esp_heap = false;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * run workload with n_changes variable changes, returns number of clients with errors
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+run (uint32_t n_changes)
+{
+    unsigned long   resume_errors = http_stats.resume_errors;
+    int             n_children = 0;
+    int             errors = 0;
+    int             status;
+    uint32_t        n;
+    int             i;
+
+    shared->final_gen = 0;
+    shared->truncated = 0;
+
+    for (i = 0; i < N_EVENT_CLIENTS; i++)
+    {
+        if (fork () == 0)
+        {
+            exit (event_client (i));
+        }
+
+        n_children++;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        if (fork () == 0)
+        {
+            exit (page_client (10 + i));
+        }
+
+        n_children++;
+    }
+
+    if (fork () == 0)
+    {
+        exit (dropper (20));
+    }
+
+    n_children++;
+
+    for (n = 0; n < n_changes; n++)
+    {
+        change_variable (n);
+
+        for (i = 0; i < LOOPS_PER_CHANGE; i++)
+        {
+            server_loop ();
+        }
+    }
+
+    for (i = 0; i < N_VARS; i++)
+    {
+        shared->final_vals[i] = numvars[i];
+    }
+
+    __sync_synchronize ();
+    shared->final_gen = vars_generation;
+
+    while (n_children > 0)
+    {
+        server_loop ();
+
+        while (waitpid (-1, &status, WNOHANG) > 0)
+        {
+            n_children--;
+
+            if (! WIFEXITED (status) || WEXITSTATUS (status))
+            {
+                errors++;
+            }
+        }
+    }
+
+    for (i = 0; i < 1000; i++)                                                  // let server close the connections
+    {
+        server_loop ();
+    }
+
+    if (shared->truncated > http_stats.resume_errors - resume_errors)          // only a page changed on resume may be cut
+    {
+        printf ("soak-test: %u responses truncated, %lu pages changed on resume\n", shared->truncated,
+                http_stats.resume_errors - resume_errors);
+        errors++;
+    }
+
+    return errors;
+}
+
+int
+main (void)
+{
+    uint32_t        n_errors = 0;
+    uint32_t        base_free_heap;
+    uint32_t        base_max_block;
+    uint32_t        allocs;
+    unsigned long   requests;
+
+    setvbuf (stdout, NULL, _IONBF, 0);
+    shared = (SHARED *) mmap (NULL, sizeof (SHARED), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    stub_server_port = 0;                                                       // ephemeral port
+    stub_esp_heap = true;
+    http_server_begin ();
+    stub_esp_heap = false;
+
+    n_errors += run (WARMUP_CHANGES);
+
+    base_free_heap = ESP.getFreeHeap ();
+    base_max_block = ESP.getMaxFreeBlockSize ();
+    printf ("soak-test: warm-up: free heap %u, max block %u, fragmentation %u%%\n", base_free_heap, base_max_block,
+            ESP.getHeapFragmentation ());
+
+    http_reset_stats ();
+    min_free_heap       = 0xFFFFFFFF;
+    min_max_block       = 0xFFFFFFFF;
+    max_fragmentation   = 0;
+    allocs              = stub_heap_allocs;
+
+    n_errors += run (SOAK_CHANGES);
+
+    requests    = http_stats.requests;
+    allocs      = stub_heap_allocs - allocs;
+
+    printf ("soak-test: soak: %lu requests, %lu events, %u allocations (%.1f per request), changed on resume %lu\n", requests,
+            http_stats.events, allocs, requests ? (double) allocs / requests : 0.0, http_stats.resume_errors);
+    printf ("soak-test: soak: min free heap %u, min max block %u, max fragmentation %u%%\n", min_free_heap, min_max_block,
+            max_fragmentation);
+    printf ("soak-test: idle: free heap %u, max block %u, fragmentation %u%%\n", ESP.getFreeHeap (), ESP.getMaxFreeBlockSize (),
+            ESP.getHeapFragmentation ());
+
+    if (ESP.getFreeHeap () != base_free_heap)
+    {
+        printf ("soak-test: free heap changed from %u to %u bytes\n", base_free_heap, ESP.getFreeHeap ());
+        n_errors++;
+    }
+
+    if (ESP.getMaxFreeBlockSize () < base_max_block)
+    {
+        printf ("soak-test: largest free block shrunk from %u to %u bytes\n", base_max_block, ESP.getMaxFreeBlockSize ());
+        n_errors++;
+    }
+
+    if (max_fragmentation > MAX_FRAGMENTATION)
+    {
+        printf ("soak-test: heap fragmentation %u%% during soak\n", max_fragmentation);
+        n_errors++;
+    }
+
+    if (http_stats.events < SOAK_CHANGES / 10 || http_stats.event_drops)
+    {
+        printf ("soak-test: %lu events sent, %lu event clients dropped\n", http_stats.events, http_stats.event_drops);
+        n_errors++;
+    }
+
+    printf ("soak-test: %u errors\n", n_errors);
+    return n_errors ? 1 : 0;
+}
@@ -0,0 +1,735 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * stm32-test.cpp - STM32 flasher of ESP8266/ESP-uclock/stm32flash.cpp against an emulated STM32 ROM bootloader on a pty
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The emulator runs in a child process on the master side of a pty, the flasher uses the slave side as Serial. The emulator
+ * implements the commands of the USART bootloader (AN3155) for an STM32F103 medium density (product id 0x410, 64 pages of 1K)
+ * and checks the protocol:
+ *
+ *      - complement of command byte and checksums of address, length, data and page list
+ *      - WRITE MEMORY only to erased flash (halfword 0xFFFF before programming) and with a length which is a multiple of 4
+ *      - no byte may arrive while the STM32 programs or erases: the USART of the ROM bootloader has no FIFO, so such a byte
+ *        would be an overrun. The flasher parses the next block while the STM32 programs, but must not send anything.
+ *
+ * The flash is filled with random data before the first run. After each run the flash must contain the image, exactly the
+ * expected pages must have been erased, all other pages must be untouched. The differential update is checked by flashing the
+ * same image again (nothing erased or written), an image with a few changed bytes (only their pages erased) and an image whose
+ * flash is changed by the emulator between check and flash pass in a page judged unchanged: the flash must fail, the next
+ * run must repair the page. The flash contents and the counters are shared with the
+ * parent through an anonymous shared mapping.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <string>
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "stm32flash.h"
+
+#define FLASH_BASE                  0x08000000
+#define PAGE_SIZE                   1024
+#define N_PAGES                     64
+#define FLASH_SIZE                  (N_PAGES * PAGE_SIZE)
+#define WRITE_USEC                  2000                    // programming time of one WRITE MEMORY block
+#define ERASE_USEC                  1000                    // erase time of one page
+
+#define ACK                         0x79
+#define NACK                        0x1F
+
+typedef struct
+{
+    volatile uint8_t                reset;                  // set by test: RESET of STM32 with BOOT0 high
+    volatile long                   corrupt;                // set by test: offset + 1 of byte to invert at first erase
+    uint8_t                         erase_cmd;              // 0x43 ERASE or 0x44 EXT ERASE
+    uint8_t                         flash[FLASH_SIZE];
+    uint32_t                        erased[N_PAGES];        // erase count of each page
+    uint32_t                        written[N_PAGES];       // bytes written into each page
+    uint32_t                        mass_erases;
+    uint32_t                        erase_commands;
+    uint32_t                        write_commands;
+    uint32_t                        read_commands;
+    uint32_t                        overruns;               // bytes received while programming or erasing
+    uint32_t                        protocol_errors;        // bad complement, checksum, address or length
+    uint32_t                        write_errors;           // WRITE MEMORY to flash which is not erased
+} EMULATOR;
+
+static EMULATOR *                   emu;
+static int                          emu_fd;
+static uint32_t                     rand_state = 1;
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * output of the flasher: http_send() etc. of http.cpp write into http_log
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static std::string                  http_log;
+
+void
+http_send (const char * s)
+{
+    http_log += s;
+}
+
+void
+http_send_P (const char * s)
+{
+    http_log += s;
+}
+
+void
+http_flush (void)
+{
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * emulator: receive byte, returns -1 if nothing arrives within 100 msec
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+emu_getc (void)
+{
+    struct pollfd   pfd = { emu_fd, POLLIN, 0 };
+    uint8_t         ch;
+
+    if (poll (&pfd, 1, 100) <= 0 || read (emu_fd, &ch, 1) != 1)
+    {
+        return -1;
+    }
+
+    return ch;
+}
+
+static void
+emu_putc (uint8_t ch)
+{
+    if (write (emu_fd, &ch, 1) != 1)
+    {
+        exit (1);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * emulator: STM32 is busy for usec microseconds, every byte arriving meanwhile is an overrun
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+emu_busy (unsigned long usec)
+{
+    struct pollfd   pfd = { emu_fd, POLLIN, 0 };
+
+    usleep (usec);
+
+    if (poll (&pfd, 1, 0) > 0)
+    {
+        emu->overruns++;
+    }
+}
+
+static int
+emu_nack (void)
+{
+    emu->protocol_errors++;
+    emu_putc (NACK);
+    return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * emulator: receive 4 byte address with checksum, returns offset in flash or -1
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static long
+emu_address (void)
+{
+    uint8_t     buf[5];
+    uint32_t    address;
+    int         i;
+    int         ch;
+
+    for (i = 0; i < 5; i++)
+    {
+        if ((ch = emu_getc ()) < 0)
+        {
+            return -1;
+        }
+        buf[i] = ch;
+    }
+
+    address = (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
+
+    if ((buf[0] ^ buf[1] ^ buf[2] ^ buf[3]) != buf[4] || address < FLASH_BASE || address >= FLASH_BASE + FLASH_SIZE)
+    {
+        return -1;
+    }
+
+    return address - FLASH_BASE;
+}
+
+static void
+emu_erase_page (int page)
+{
+    memset (emu->flash + page * PAGE_SIZE, 0xFF, PAGE_SIZE);
+    emu->erased[page]++;
+    emu_busy (ERASE_USEC);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * emulator: execute one command, returns 0 if the bootloader has to be started again with 0x7F (after WRITE UNPROTECT)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+emu_command (uint8_t cmd)
+{
+    static const uint8_t    get_cmds[] = { 0x00, 0x01, 0x02, 0x11, 0x21, 0x31, 0x00, 0x63, 0x73, 0x82, 0x92 };
+    uint8_t                 data[256];
+    long                    offset;
+    int                     len;
+    int                     sum;
+    int                     ch;
+    int                     i;
+
+    if ((ch = emu_getc ()) < 0 || (ch ^ cmd) != 0xFF)
+    {
+        return emu_nack ();
+    }
+
+    switch (cmd)
+    {
+        case 0x00:                                                          // GET
+            emu_putc (ACK);
+            emu_putc (sizeof (get_cmds));
+            emu_putc (0x22);                                                // bootloader version 2.2
+
+            for (i = 0; i < (int) sizeof (get_cmds); i++)
+            {
+                emu_putc (i == 6 ? emu->erase_cmd : get_cmds[i]);
+            }
+
+            emu_putc (ACK);
+            break;
+
+        case 0x02:                                                          // GET ID
+            emu_putc (ACK);
+            emu_putc (1);
+            emu_putc (0x04);
+            emu_putc (0x10);
+            emu_putc (ACK);
+            break;
+
+        case 0x11:                                                          // READ MEMORY
+            emu_putc (ACK);
+
+            if ((offset = emu_address ()) < 0)
+            {
+                return emu_nack ();
+            }
+
+            emu_putc (ACK);
+
+            if ((len = emu_getc ()) < 0 || (ch = emu_getc ()) < 0 || (len ^ ch) != 0xFF || offset + len + 1 > FLASH_SIZE)
+            {
+                return emu_nack ();
+            }
+
+            emu_putc (ACK);
+
+            for (i = 0; i <= len; i++)
+            {
+                emu_putc (emu->flash[offset + i]);
+            }
+
+            emu->read_commands++;
+            break;
+
+        case 0x31:                                                          // WRITE MEMORY
+            emu_putc (ACK);
+
+            if ((offset = emu_address ()) < 0 || (offset & 3))
+            {
+                return emu_nack ();
+            }
+
+            emu_putc (ACK);
+
+            if ((len = emu_getc ()) < 0)
+            {
+                return emu_nack ();
+            }
+
+            sum = len;
+
+            for (i = 0; i <= len; i++)
+            {
+                if ((ch = emu_getc ()) < 0)
+                {
+                    return emu_nack ();
+                }
+
+                data[i] = ch;
+                sum ^= ch;
+            }
+
+            if ((ch = emu_getc ()) < 0 || ch != sum || ((len + 1) & 3) || offset + len + 1 > FLASH_SIZE)
+            {
+                return emu_nack ();
+            }
+
+            for (i = 0; i <= len; i += 2)                                   // halfword must be erased before programming
+            {
+                if (emu->flash[offset + i] != 0xFF || emu->flash[offset + i + 1] != 0xFF)
+                {
+                    emu->write_errors++;
+                }
+            }
+
+            memcpy (emu->flash + offset, data, len + 1);
+            emu->written[offset / PAGE_SIZE] += len + 1;
+            emu->write_commands++;
+            emu_busy (WRITE_USEC);
+            emu_putc (ACK);
+            break;
+
+        case 0x43:                                                          // ERASE
+        case 0x44:                                                          // EXT ERASE
+        {
+            int n;
+
+            if (cmd != emu->erase_cmd)
+            {
+                return emu_nack ();
+            }
+
+            emu_putc (ACK);
+
+            if (emu->corrupt)                                               // flash changed after check pass
+            {
+                emu->flash[emu->corrupt - 1] ^= 0xFF;
+                emu->corrupt = 0;
+            }
+
+            if (cmd == 0x43)
+            {
+                if ((n = emu_getc ()) < 0)
+                {
+                    return emu_nack ();
+                }
+                sum = n;
+            }
+            else
+            {
+                int lo;
+
+                if ((n = emu_getc ()) < 0 || (lo = emu_getc ()) < 0)
+                {
+                    return emu_nack ();
+                }
+                sum = n ^ lo;
+                n = (n << 8) | lo;
+            }
+
+            if ((cmd == 0x43 && n == 0xFF) || (cmd == 0x44 && n == 0xFFFF))     // mass erase
+            {
+                if ((ch = emu_getc ()) < 0 || ch != 0x00)
+                {
+                    return emu_nack ();
+                }
+
+                for (i = 0; i < N_PAGES; i++)
+                {
+                    emu_erase_page (i);
+                }
+
+                emu->mass_erases++;
+            }
+            else
+            {
+                int pages[256];
+
+                if (n > 255)
+                {
+                    return emu_nack ();
+                }
+
+                for (i = 0; i <= n; i++)
+                {
+                    int hi = 0;
+
+                    if ((cmd == 0x44 && (hi = emu_getc ()) < 0) || (ch = emu_getc ()) < 0)
+                    {
+                        return emu_nack ();
+                    }
+
+                    pages[i] = (hi << 8) | ch;
+                    sum ^= hi ^ ch;
+                }
+
+                if ((ch = emu_getc ()) < 0 || ch != sum)
+                {
+                    return emu_nack ();
+                }
+
+                for (i = 0; i <= n; i++)
+                {
+                    if (pages[i] >= N_PAGES)
+                    {
+                        return emu_nack ();
+                    }
+
+                    emu_erase_page (pages[i]);
+                }
+            }
+
+            emu->erase_commands++;
+            emu_putc (ACK);
+            break;
+        }
+
+        case 0x73:                                                          // WRITE UNPROTECT: system reset afterwards
+            emu_putc (ACK);
+            emu_putc (ACK);
+            return 0;
+
+        default:
+            return emu_nack ();
+    }
+
+    return 1;
+}
+
+static void
+emulator (void)
+{
+    int     started = 0;
+    int     ch;
+
+    for (;;)
+    {
+        if (emu->reset)
+        {
+            emu->reset  = 0;
+            started     = 0;
+        }
+
+        if ((ch = emu_getc ()) < 0)
+        {
+            continue;
+        }
+
+        if (! started)
+        {
+            if (ch == 0x7F)                                                 // autobaud
+            {
+                emu_putc (ACK);
+                started = 1;
+            }
+        }
+        else
+        {
+            started = emu_command (ch);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * images
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+typedef struct
+{
+    uint8_t                         data[FLASH_SIZE];
+    uint8_t                         used[FLASH_SIZE];       // byte belongs to image
+} IMAGE;
+
+static void
+write_hex (const char * filename, const IMAGE * img)
+{
+    FILE *      fp = fopen (filename, "w");
+    uint32_t    ulba = 0xFFFFFFFF;
+    uint32_t    addr;
+    int         i;
+
+    for (addr = 0; addr < FLASH_SIZE; addr += 16)
+    {
+        uint32_t    a = FLASH_BASE + addr;
+        int         start;
+        int         n;
+        int         sum;
+
+        for (start = 0; start < 16 && ! img->used[addr + start]; start++)
+        {
+            ;
+        }
+
+        for (n = 0; start + n < 16 && img->used[addr + start + n]; n++)
+        {
+            ;
+        }
+
+        if (n == 0)
+        {
+            continue;
+        }
+
+        a += start;
+
+        if ((a >> 16) != ulba)
+        {
+            ulba = a >> 16;
+            fprintf (fp, ":02000004%04X%02X\r\n", ulba, (0x100 - ((2 + 4 + (ulba >> 8) + (ulba & 0xFF)) & 0xFF)) & 0xFF);
+        }
+
+        sum = n + ((a >> 8) & 0xFF) + (a & 0xFF);
+        fprintf (fp, ":%02X%04X00", n, a & 0xFFFF);
+
+        for (i = 0; i < n; i++)
+        {
+            fprintf (fp, "%02X", img->data[addr + start + i]);
+            sum += img->data[addr + start + i];
+        }
+
+        fprintf (fp, "%02X\r\n", (0x100 - (sum & 0xFF)) & 0xFF);
+    }
+
+    fprintf (fp, ":00000001FF\r\n");
+    fclose (fp);
+}
+
+static void
+write_bin (const char * filename, const IMAGE * img, int len)
+{
+    FILE * fp = fopen (filename, "w");
+
+    fwrite (img->data, 1, len, fp);
+    fclose (fp);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * run flasher against emulator, returns number of errors
+ *
+ * expect_erased: pages which must have been erased, all others must be untouched
+ * corrupt: offset of flash byte which the emulator inverts between check and flash pass, -1: none
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+run (const char * name, const IMAGE * img, const uint8_t * expect_erased, long corrupt, bool expect_success)
+{
+    static uint8_t  before[FLASH_SIZE];
+    unsigned long   t;
+    int             errors = 0;
+    int             page;
+    int             i;
+
+    memcpy (before, emu->flash, FLASH_SIZE);
+    memset (emu->erased, 0, sizeof (emu->erased));
+    memset (emu->written, 0, sizeof (emu->written));
+    emu->mass_erases = emu->erase_commands = emu->write_commands = emu->read_commands = 0;
+    emu->overruns = emu->protocol_errors = emu->write_errors = 0;
+
+    http_log.clear ();
+    emu->reset      = 1;
+    emu->corrupt    = corrupt + 1;
+    t = millis ();
+    stm32_flash_from_local ();
+    t = millis () - t;
+
+    if ((http_log.find ("Flash successful") != std::string::npos) != expect_success)
+    {
+        printf ("stm32-test: %s: flash %s\n", name, expect_success ? "failed" : "successful");
+        errors++;
+    }
+
+    if (emu->overruns || emu->protocol_errors || emu->write_errors)
+    {
+        printf ("stm32-test: %s: %u overruns, %u protocol errors, %u writes to flash not erased\n", name, emu->overruns,
+                emu->protocol_errors, emu->write_errors);
+        errors++;
+    }
+
+    if (corrupt >= 0)
+    {
+        before[corrupt] ^= 0xFF;
+    }
+
+    for (page = 0; page < N_PAGES; page++)
+    {
+        const uint8_t * f = emu->flash + page * PAGE_SIZE;
+
+        if (emu->erased[page] != expect_erased[page])
+        {
+            printf ("stm32-test: %s: page %d erased %u times, expected %u\n", name, page, emu->erased[page], expect_erased[page]);
+            errors++;
+        }
+
+        if (! expect_erased[page] && memcmp (f, before + page * PAGE_SIZE, PAGE_SIZE))
+        {
+            printf ("stm32-test: %s: page %d changed without erase\n", name, page);
+            errors++;
+        }
+
+        if (! expect_success)
+        {
+            continue;
+        }
+
+        for (i = 0; i < PAGE_SIZE; i++)
+        {
+            int addr = page * PAGE_SIZE + i;
+
+            if (img->used[addr] ? f[i] != img->data[addr] : (expect_erased[page] && f[i] != 0xFF))
+            {
+                printf ("stm32-test: %s: flash at 0x%08X is 0x%02X, expected 0x%02X\n", name, FLASH_BASE + addr, f[i],
+                        img->used[addr] ? img->data[addr] : 0xFF);
+                errors++;
+                break;
+            }
+        }
+    }
+
+    printf ("stm32-test: %-12s %4u msec, %2u erase commands, %3u blocks written, %3u blocks read, %u errors\n", name, (unsigned) t,
+            emu->erase_commands, emu->write_commands, emu->read_commands, errors);
+
+    if (errors)
+    {
+        printf ("%s\n", http_log.c_str ());
+    }
+
+    return errors;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * main
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+int
+main (void)
+{
+    static IMAGE    img;
+    static IMAGE    bin;
+    uint8_t         expect_erased[N_PAGES];
+    char            fs_root[] = "/tmp/stm32-test-XXXXXX";
+    std::string     hex_name;
+    std::string     bin_name;
+    struct termios  tio;
+    pid_t           pid;
+    uint32_t        n_errors = 0;
+    int             master;
+    int             i;
+
+    setvbuf (stdout, NULL, _IONBF, 0);
+    emu = (EMULATOR *) mmap (NULL, sizeof (EMULATOR), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if ((master = posix_openpt (O_RDWR | O_NOCTTY)) < 0 || grantpt (master) < 0 || unlockpt (master) < 0 ||
+        (stub_serial_fd = open (ptsname (master), O_RDWR | O_NOCTTY)) < 0)
+    {
+        perror ("stm32-test: pty");
+        return 1;
+    }
+
+    tcgetattr (stub_serial_fd, &tio);
+    cfmakeraw (&tio);
+    tcsetattr (stub_serial_fd, TCSANOW, &tio);
+    tcgetattr (master, &tio);
+    cfmakeraw (&tio);
+    tcsetattr (master, TCSANOW, &tio);
+
+    if ((pid = fork ()) == 0)
+    {
+        emu_fd = master;
+        emulator ();
+    }
+
+    stub_fs_root    = mkdtemp (fs_root);
+    hex_name        = std::string (fs_root) + "/stm32.hex";
+    bin_name        = std::string (fs_root) + "/stm32.bin";
+
+    for (i = 0; i < FLASH_SIZE; i++)                                            // old firmware
+    {
+        emu->flash[i] = next_rand ();
+    }
+
+    // image with gaps: pages 1-14 except one gap of 3000 bytes, ends within page 14
+    for (i = 0x400; i < 0x3A37; i++)
+    {
+        img.used[i] = ! (i >= 0x1200 && i < 0x1DB8);
+        img.data[i] = img.used[i] ? next_rand () : 0xFF;
+    }
+
+    memset (expect_erased, 0, sizeof (expect_erased));
+
+    for (i = 0; i < FLASH_SIZE; i++)
+    {
+        if (img.used[i])
+        {
+            expect_erased[i / PAGE_SIZE] = 1;
+        }
+    }
+
+    emu->erase_cmd = 0x44;
+    write_hex (hex_name.c_str (), &img);
+    n_errors += run ("hex", &img, expect_erased, -1, true);
+
+    memset (expect_erased, 0, sizeof (expect_erased));                          // same image again: nothing to do
+    n_errors += run ("same", &img, expect_erased, -1, true);
+
+    img.data[0x0A10] ^= 0x01;                                                   // few bytes changed in pages 2 and 13
+    img.data[0x0A11] ^= 0x80;
+    img.data[0x3400] ^= 0x55;
+    expect_erased[2] = expect_erased[13] = 1;
+    write_hex (hex_name.c_str (), &img);
+    n_errors += run ("diff", &img, expect_erased, -1, true);
+
+    img.data[0x1000] ^= 0x01;                                                   // page 4 changed, page 7 changes during flash
+    memset (expect_erased, 0, sizeof (expect_erased));
+    expect_erased[4] = 1;
+    write_hex (hex_name.c_str (), &img);
+    n_errors += run ("changed", &img, expect_erased, 0x1E00, false);
+
+    if (http_log.find ("address 0x08001E00: flash contents changed since check") == std::string::npos)
+    {
+        printf ("stm32-test: changed: change of flash not reported\n");
+        n_errors++;
+    }
+
+    expect_erased[4] = 0;                                                       // next run repairs page 7
+    expect_erased[7] = 1;
+    n_errors += run ("repair", &img, expect_erased, -1, true);
+    unlink (hex_name.c_str ());
+
+    // binary image of 9.5K at start of flash, standard erase
+    memset (expect_erased, 0, sizeof (expect_erased));
+
+    for (i = 0; i < 9 * PAGE_SIZE + 512; i++)
+    {
+        bin.used[i] = 1;
+        bin.data[i] = next_rand ();
+        expect_erased[i / PAGE_SIZE] = 1;
+    }
+
+    emu->erase_cmd = 0x43;
+    write_bin (bin_name.c_str (), &bin, 9 * PAGE_SIZE + 512);
+    n_errors += run ("bin", &bin, expect_erased, -1, true);
+    unlink (bin_name.c_str ());
+
+    kill (pid, SIGTERM);
+    waitpid (pid, NULL, 0);
+    rmdir (fs_root);
+
+    printf ("stm32-test: %u errors\n", n_errors);
+    return n_errors ? 1 : 0;
+}
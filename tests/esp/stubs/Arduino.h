@@ -0,0 +1,122 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * Arduino.h - host test stub: Print, Serial, millis() and flash access of the ESP8266 core
+ *
+ * millis() is the monotonic clock of the host plus stub_millis_offset, so a test can let time pass without waiting.
+ * Serial writes into stub_serial_out, or into file descriptor stub_serial_fd if it is set (e.g. a pty of an emulator).
+ * While stub_esp_heap is set, the heap is an emulation of the heap of the ESP8266, see arduino.cpp.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include "WString.h"
+
+#define PROGMEM
+#define PSTR(s)                     (s)
+#define memcpy_P                    memcpy
+#define strlen_P                    strlen
+#define strcpy_P                    strcpy
+#define strncpy_P                   strncpy
+#define strcmp_P                    strcmp
+#define pgm_read_byte(p)            (*(const uint8_t *) (p))
+#define PGM_P                       const char *
+
+#define LOW                         0
+#define HIGH                        1
+#define INPUT                       0
+#define OUTPUT                      1
+#define SERIAL_8N1                  0x06
+#define SERIAL_8E1                  0x1e
+
+#define DEC                         10
+#define HEX                         16
+
+typedef unsigned long               ulong;
+typedef uint8_t                     byte;
+typedef unsigned int                word;
+
+inline word                         makeWord (uint8_t h, uint8_t l) { return (h << 8) | l; }
+#define word(...)                   makeWord (__VA_ARGS__)
+
+extern long                         stub_millis_offset;
+extern unsigned long                millis (void);
+extern unsigned long                micros (void);
+extern void                         delay (unsigned long);
+extern void                         yield (void);
+extern void                         pinMode (uint8_t pin, uint8_t mode);
+extern void                         digitalWrite (uint8_t pin, uint8_t val);
+extern int                          digitalRead (uint8_t pin);
+
+class Print
+{
+    public:
+        virtual ~Print () { }
+        virtual size_t  write (uint8_t c) = 0;
+        virtual size_t  write (const uint8_t * buf, size_t len)     { size_t n = 0; while (n < len && write (buf[n])) n++; return n; }
+        size_t          write (const char * s)                      { return write ((const uint8_t *) s, strlen (s)); }
+        size_t          write (const char * s, size_t len)          { return write ((const uint8_t *) s, len); }
+        size_t          print (const char * s)                      { return write (s); }
+        size_t          print (const String & s)                    { return write (s.c_str ()); }
+        size_t          print (const __FlashStringHelper * s)       { return write ((const char *) s); }
+        size_t          print (char c)                              { return write ((uint8_t) c); }
+        size_t          print (int n, int base = DEC)               { return print (String (n, base)); }
+        size_t          print (unsigned int n, int base = DEC)      { return print (String (n, base)); }
+        size_t          print (long n, int base = DEC)              { return print (String (n, base)); }
+        size_t          print (unsigned long n, int base = DEC)     { return print (String (n, base)); }
+        size_t          print (double d, int decimals = 2)          { return print (String (d, decimals)); }
+        size_t          println (void)                              { return write ("\r\n"); }
+        template <typename T> size_t println (T v)                  { size_t n = print (v); return n + println (); }
+        template <typename T> size_t println (T v, int base)        { size_t n = print (v, base); return n + println (); }
+        size_t          printf (const char * fmt, ...) __attribute__ ((format (printf, 2, 3)));
+};
+
+class HardwareSerial : public Print
+{
+    public:
+        using Print::write;
+        size_t          write (uint8_t c);
+        size_t          write (const uint8_t * buf, size_t len);
+        int             available (void);
+        int             read (void);
+        int             peek (void);
+        void            flush (void)                                { }
+        void            begin (unsigned long baud, int config = SERIAL_8N1) { (void) baud; (void) config; }
+        void            end (void)                                  { }
+        void            swap (void)                                 { }
+        void            setTimeout (unsigned long t)                { (void) t; }
+        operator bool () const                                      { return true; }
+};
+
+extern HardwareSerial               Serial;
+extern std::string                  stub_serial_out;                // output of Serial if stub_serial_fd < 0
+extern std::string                  stub_serial_in;                 // input of Serial if stub_serial_fd < 0
+extern int                          stub_serial_fd;
+extern uint8_t                      stub_gpio[17];                  // level of GPIO pins
+
+extern uint32_t                     stub_chip_id;                   // chip id of the ESP8266
+
+class EspClass
+{
+    public:
+        uint32_t        getFreeHeap (void);
+        uint32_t        getMaxFreeBlockSize (void);
+        uint8_t         getHeapFragmentation (void);
+        uint32_t        getChipId (void)                            { return stub_chip_id; }
+        uint32_t        getFlashChipRealSize (void)                 { return 4 * 1024 * 1024; }
+        uint32_t        random (void)                               { return ::random (); }
+        void            restart (void)                              { }
+};
+
+extern EspClass                     ESP;
+extern bool                         stub_esp_heap;                  // malloc() and new use the emulated heap of the ESP8266
+extern uint32_t                     stub_heap_allocs;               // allocations on this heap
+
+#endif
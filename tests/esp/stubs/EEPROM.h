@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * EEPROM.h - host test stub, emulated EEPROM of the ESP8266 in RAM
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include "Arduino.h"
+
+#define STUB_EEPROM_SIZE            4096
+
+class EEPROMClass
+{
+    public:
+        void            begin (size_t size)                         { (void) size; }
+        uint8_t         read (int addr)                             { return data[addr % STUB_EEPROM_SIZE]; }
+        void            write (int addr, uint8_t val)               { data[addr % STUB_EEPROM_SIZE] = val; }
+        bool            commit (void)                               { return true; }
+        void            end (void)                                  { }
+    private:
+        uint8_t         data[STUB_EEPROM_SIZE];
+};
+
+extern EEPROMClass                  EEPROM;
+
+#endif
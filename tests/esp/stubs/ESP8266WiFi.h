@@ -0,0 +1,110 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * ESP8266WiFi.h - host test stub, WiFiClient and WiFiServer on TCP sockets of the host
+ *
+ * Connections to port 80 go to 127.0.0.1:stub_client_port, WiFiServer(80) listens on stub_server_port, so tests can run a
+ * stand-in server or load client in a second process. Like on the ESP8266, a TCP connection buffers only STUB_TCP_SND_BUF bytes
+ * which have not been taken by the peer: availableForWrite() reports the rest, write() waits up to the timeout for room.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef ESP8266WIFI_H
+#define ESP8266WIFI_H
+
+#include "Arduino.h"
+
+#define STUB_TCP_SND_BUF            2920                            // TCP_SND_BUF of lwIP in the ESP8266 core: 2 * MSS
+
+#define WL_IDLE_STATUS              0
+#define WL_CONNECTED                3
+#define WL_DISCONNECTED             6
+#define WIFI_STA                    1
+#define WIFI_AP                     2
+#define WIFI_AP_STA                 3
+
+extern uint16_t                     stub_client_port;
+extern uint16_t                     stub_server_port;
+
+class IPAddress
+{
+    public:
+        IPAddress ()                                                { addr = 0; }
+        IPAddress (uint8_t a, uint8_t b, uint8_t c, uint8_t d)      { addr = a | (b << 8) | (c << 16) | ((uint32_t) d << 24); }
+        IPAddress (uint32_t a)                                      { addr = a; }
+        operator uint32_t () const                                  { return addr; }
+        uint8_t         operator[] (int i) const                    { return addr >> (8 * i); }
+        String          toString () const                           { char buf[16]; snprintf (buf, sizeof (buf), "%u.%u.%u.%u", addr & 0xFF, (addr >> 8) & 0xFF, (addr >> 16) & 0xFF, addr >> 24); return String (buf); }
+        bool            isSet () const                              { return addr != 0; }
+    private:
+        uint32_t        addr;
+};
+
+struct STUB_SOCKET;
+
+class WiFiClient : public Print
+{
+    public:
+        WiFiClient ();
+        WiFiClient (int fd);
+        WiFiClient (const WiFiClient &);
+        WiFiClient &    operator= (const WiFiClient &);
+        ~WiFiClient ();
+
+        using Print::write;
+        int             connect (const char * host, uint16_t port);
+        int             connect (IPAddress ip, uint16_t port);
+        size_t          write (uint8_t c)                           { return write (&c, 1); }
+        size_t          write (const uint8_t * buf, size_t len);
+        size_t          write_P (const char * buf, size_t len)      { return write ((const uint8_t *) buf, len); }
+        int             available (void);
+        int             availableForWrite (void);
+        int             read (void);
+        int             read (uint8_t * buf, size_t len);
+        int             peek (void);
+        void            flush (void)                                { }
+        void            stop (void);
+        uint8_t         connected (void);
+        void            setNoDelay (bool) { }
+        void            setTimeout (unsigned long t)                { timeout = t; }
+        IPAddress       remoteIP (void)                             { return IPAddress (127, 0, 0, 1); }
+        operator bool ();
+
+    private:
+        STUB_SOCKET *   sock;
+        unsigned long   timeout;
+};
+
+class WiFiServer
+{
+    public:
+        WiFiServer (uint16_t port)                                  { (void) port; fd = -1; }
+        void            begin (void);
+        void            setNoDelay (bool) { }
+        WiFiClient      available (void);
+        WiFiClient      accept (void)                               { return available (); }
+        bool            hasClient (void);
+    private:
+        int             fd;
+};
+
+class ESP8266WiFiClass
+{
+    public:
+        int             hostByName (const char * host, IPAddress & ip);
+        int             hostByName (const char * host, IPAddress & ip, uint32_t timeout) { (void) timeout; return hostByName (host, ip); }
+        IPAddress       localIP (void)                              { return IPAddress (127, 0, 0, 1); }
+        IPAddress       softAPIP (void)                             { return IPAddress (192, 168, 4, 1); }
+        uint8_t         status (void)                               { return WL_CONNECTED; }
+        String          SSID (void)                                 { return String ("stub"); }
+        String          SSID (int idx)                              { (void) idx; return String (""); }
+        int32_t         RSSI (int idx)                              { (void) idx; return 0; }
+        String          psk (void)                                  { return String (""); }
+        bool            mode (int m)                                { (void) m; return true; }
+        bool            disconnect (bool off = false)               { (void) off; return true; }
+        int             begin (const char * ssid, const char * pw)  { (void) ssid; (void) pw; return WL_CONNECTED; }
+        bool            softAP (const char * ssid, const char * pw = NULL) { (void) ssid; (void) pw; return true; }
+        int8_t          scanNetworks (void)                         { return 0; }
+        bool            beginWPSConfig (void)                       { return false; }
+};
+
+extern ESP8266WiFiClass             WiFi;
+
+#endif
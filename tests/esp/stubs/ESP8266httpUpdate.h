@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * ESP8266httpUpdate.h - host test stub, an update of the ESP8266 firmware always fails
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef ESP8266HTTPUPDATE_H
+#define ESP8266HTTPUPDATE_H
+
+#include "ESP8266WiFi.h"
+
+typedef enum
+{
+    HTTP_UPDATE_FAILED,
+    HTTP_UPDATE_NO_UPDATES,
+    HTTP_UPDATE_OK
+} t_httpUpdate_return;
+
+class ESP8266HTTPUpdate
+{
+    public:
+        t_httpUpdate_return update (WiFiClient & client, const String & host, uint16_t port, const String & uri)
+                                                                    { (void) client; (void) host; (void) port; (void) uri; return HTTP_UPDATE_FAILED; }
+        int             getLastError (void)                         { return -1; }
+        String          getLastErrorString (void)                   { return String ("not available in host test"); }
+};
+
+extern ESP8266HTTPUpdate            ESPhttpUpdate;
+
+#endif
@@ -0,0 +1,5 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * FS.h - host test stub, see LittleFS.h
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include "LittleFS.h"
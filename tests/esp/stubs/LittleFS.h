@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * LittleFS.h - host test stub, the file system is the directory stub_fs_root of the host
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef LITTLEFS_H
+#define LITTLEFS_H
+
+#include <dirent.h>
+#include "Arduino.h"
+
+#define STUB_FS_SIZE                (1024 * 1024)                   // size of LittleFS partition
+
+extern const char *                 stub_fs_root;
+extern uint32_t                     stub_fs_size;                   // total bytes reported by info()
+
+typedef struct
+{
+    size_t                          totalBytes;
+    size_t                          usedBytes;
+    size_t                          blockSize;
+    size_t                          pageSize;
+    size_t                          maxOpenFiles;
+    size_t                          maxPathLength;
+} FSInfo;
+
+class File : public Print
+{
+    public:
+        File ()                                                     { fp = NULL; }
+        File (FILE * f)                                             { fp = f; }
+        File (int null)                                             { (void) null; fp = NULL; }
+
+        using Print::write;
+        size_t          write (uint8_t c)                           { return fp ? fwrite (&c, 1, 1, fp) : 0; }
+        size_t          write (const uint8_t * buf, size_t len)     { return fp ? fwrite (buf, 1, len, fp) : 0; }
+        int             read (void)                                 { return fp ? getc (fp) : -1; }
+        int             read (uint8_t * buf, size_t len)            { return fp ? (int) fread (buf, 1, len, fp) : -1; }
+        int             available (void);
+        size_t          size (void);
+        size_t          position (void)                             { return fp ? ftell (fp) : 0; }
+        bool            seek (uint32_t pos)                         { return fp && ! fseek (fp, pos, SEEK_SET); }
+        void            flush (void)                                { if (fp) fflush (fp); }
+        void            close (void)                                { if (fp) fclose (fp); fp = NULL; }
+        operator bool () const                                      { return fp != NULL; }
+
+    private:
+        FILE *          fp;
+};
+
+class Dir
+{
+    public:
+        Dir ()                                                      { dir = NULL; }
+        Dir (DIR * d)                                               { dir = d; }
+        bool            next (void);
+        String          fileName (void)                             { return name; }
+        File            openFile (const char * mode);
+    private:
+        DIR *           dir;
+        String          name;
+};
+
+class FS
+{
+    public:
+        bool            begin (void)                                { return true; }
+        void            end (void)                                  { }
+        bool            format (void);
+        File            open (const char * name, const char * mode);
+        File            open (const String & name, const char * mode) { return open (name.c_str (), mode); }
+        Dir             openDir (const char * path);
+        bool            exists (const char * name);
+        bool            exists (const String & name)                { return exists (name.c_str ()); }
+        bool            remove (const char * name);
+        bool            remove (const String & name)                { return remove (name.c_str ()); }
+        bool            rename (const char * from, const char * to);
+        bool            info (FSInfo & info);
+};
+
+extern FS                           LittleFS;
+
+#endif
@@ -0,0 +1,89 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * WString.h - host test stub, Arduino String on std::string
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+class __FlashStringHelper;
+#define F(s)                        ((const __FlashStringHelper *) (s))
+
+class String
+{
+    public:
+        String ()                                   { }
+        String (const char * s)                     { if (s) str = s; }
+        String (const String & s)                   { str = s.str; }
+        String (const __FlashStringHelper * s)      { str = (const char *) s; }
+        explicit String (char c)                    { str = std::string (1, c); }
+        String (int n, unsigned char base = 10)     { number (n, base); }
+        String (unsigned int n, unsigned char base = 10) { unumber (n, base); }
+        String (long n, unsigned char base = 10)    { number (n, base); }
+        String (unsigned long n, unsigned char base = 10) { unumber (n, base); }
+        String (double d, unsigned char decimals = 2) { char buf[64]; snprintf (buf, sizeof (buf), "%.*f", decimals, d); str = buf; }
+
+        String &        operator= (const String & s)        { str = s.str; return *this; }
+        String &        operator= (const char * s)          { str = s ? s : ""; return *this; }
+        String &        operator+= (const String & s)       { str += s.str; return *this; }
+        String &        operator+= (const char * s)         { if (s) str += s; return *this; }
+        String &        operator+= (char c)                 { str += c; return *this; }
+        String &        operator+= (int n)                  { return *this += String (n); }
+        String &        operator+= (unsigned int n)         { return *this += String (n); }
+        String &        operator+= (long n)                 { return *this += String (n); }
+        String &        operator+= (unsigned long n)        { return *this += String (n); }
+        bool            concat (const String & s)           { str += s.str; return true; }
+        bool            concat (char c)                     { str += c; return true; }
+
+        bool            operator== (const String & s) const { return str == s.str; }
+        bool            operator== (const char * s) const   { return str == (s ? s : ""); }
+        bool            operator!= (const String & s) const { return str != s.str; }
+        bool            operator!= (const char * s) const   { return str != (s ? s : ""); }
+        bool            operator< (const String & s) const  { return str < s.str; }
+        char            operator[] (unsigned int i) const   { return i < str.size () ? str[i] : '\0'; }
+        char &          operator[] (unsigned int i)         { return str[i]; }
+
+        const char *    c_str () const                      { return str.c_str (); }
+        unsigned int    length () const                     { return str.size (); }
+        bool            isEmpty () const                    { return str.empty (); }
+        bool            reserve (unsigned int n)            { str.reserve (n); return true; }
+        char            charAt (unsigned int i) const       { return (*this)[i]; }
+        bool            equals (const String & s) const     { return str == s.str; }
+        bool            equalsIgnoreCase (const String & s) const { return ! strcasecmp (c_str (), s.c_str ()); }
+        bool            startsWith (const String & s) const { return str.compare (0, s.str.size (), s.str) == 0; }
+        bool            endsWith (const String & s) const   { return str.size () >= s.str.size () && str.compare (str.size () - s.str.size (), s.str.size (), s.str) == 0; }
+        int             indexOf (char c, unsigned int from = 0) const { size_t i = str.find (c, from); return i == std::string::npos ? -1 : (int) i; }
+        int             indexOf (const String & s, unsigned int from = 0) const { size_t i = str.find (s.str, from); return i == std::string::npos ? -1 : (int) i; }
+        int             lastIndexOf (char c) const          { size_t i = str.rfind (c); return i == std::string::npos ? -1 : (int) i; }
+        String          substring (unsigned int from) const { return from < str.size () ? String (str.substr (from).c_str ()) : String (); }
+        String          substring (unsigned int from, unsigned int to) const { return from < to && from < str.size () ? String (str.substr (from, to - from).c_str ()) : String (); }
+        void            toCharArray (char * buf, unsigned int size) const { if (size) { strncpy (buf, c_str (), size - 1); buf[size - 1] = '\0'; } }
+        long            toInt () const                      { return atol (c_str ()); }
+        void            toLowerCase ()                      { for (size_t i = 0; i < str.size (); i++) str[i] = tolower (str[i]); }
+        void            toUpperCase ()                      { for (size_t i = 0; i < str.size (); i++) str[i] = toupper (str[i]); }
+        void            trim ()                             { size_t b = str.find_first_not_of (" \t\r\n"); size_t e = str.find_last_not_of (" \t\r\n"); str = b == std::string::npos ? "" : str.substr (b, e - b + 1); }
+        void            remove (unsigned int from)          { if (from < str.size ()) str.erase (from); }
+        void            remove (unsigned int from, unsigned int n) { if (from < str.size ()) str.erase (from, n); }
+        void            replace (const String & a, const String & b) { size_t i = 0; while (a.str.size () && (i = str.find (a.str, i)) != std::string::npos) { str.replace (i, a.str.size (), b.str); i += b.str.size (); } }
+
+    private:
+        std::string     str;
+
+        void            number (long n, unsigned char base) { if (base == 10) { str = std::to_string (n); } else if (n < 0) { unumber (-n, base); str = "-" + str; } else { unumber (n, base); } }
+        void            unumber (unsigned long n, unsigned char base) { char buf[68]; char * p = buf + sizeof (buf) - 1; *p = '\0'; do { *--p = "0123456789abcdefghijklmnopqrstuvwxyz"[n % base]; n /= base; } while (n); str = p; }
+};
+
+inline String       operator+ (const String & a, const String & b)  { String s (a); s += b; return s; }
+inline String       operator+ (const String & a, const char * b)    { String s (a); s += b; return s; }
+inline String       operator+ (const char * a, const String & b)    { String s (a); s += b; return s; }
+inline String       operator+ (const String & a, char c)            { String s (a); s += c; return s; }
+inline String       operator+ (const String & a, int n)             { String s (a); s += n; return s; }
+inline String       operator+ (const String & a, unsigned int n)    { String s (a); s += n; return s; }
+inline String       operator+ (const String & a, long n)            { String s (a); s += n; return s; }
+inline String       operator+ (const String & a, unsigned long n)   { String s (a); s += n; return s; }
+
+#endif
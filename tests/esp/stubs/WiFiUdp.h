@@ -0,0 +1,53 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * WiFiUdp.h - host test stub, WiFiUDP on UDP sockets of the host bound to 127.0.0.1
+ *
+ * Local ports are shifted by stub_udp_port_offset, so tests do not need privileged ports. A multicast group is replaced by
+ * 127.0.0.1, a test can send packets to the shifted port of the firmware.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef WIFIUDP_H
+#define WIFIUDP_H
+
+#include "ESP8266WiFi.h"
+
+#define STUB_UDP_MAX_PACKET         1500
+
+extern uint16_t                     stub_udp_port_offset;
+
+class WiFiUDP : public Print
+{
+    public:
+        WiFiUDP ()                                                  { fd = -1; rx_len = rx_pos = tx_len = 0; }
+        uint8_t         begin (uint16_t port);
+        uint8_t         beginMulticast (IPAddress ifaddr, IPAddress group, uint16_t port) { (void) ifaddr; (void) group; return begin (port); }
+        void            stop (void);
+        int             parsePacket (void);
+        int             available (void)                            { return rx_len - rx_pos; }
+        int             read (void)                                 { return rx_pos < rx_len ? rx_buf[rx_pos++] : -1; }
+        int             read (uint8_t * buf, size_t len);
+        int             read (char * buf, size_t len)               { return read ((uint8_t *) buf, len); }
+        IPAddress       remoteIP (void)                             { return remote_ip; }
+        uint16_t        remotePort (void)                           { return remote_port; }
+        uint16_t        localPort (void)                            { return local_port; }
+        int             beginPacket (IPAddress ip, uint16_t port);
+        int             beginPacketMulticast (IPAddress group, uint16_t port, IPAddress ifaddr) { (void) group; (void) ifaddr; return beginPacket (IPAddress (127, 0, 0, 1), port + stub_udp_port_offset); }
+        using Print::write;
+        size_t          write (uint8_t c)                           { return write (&c, 1); }
+        size_t          write (const uint8_t * buf, size_t len);
+        int             endPacket (void);
+
+    private:
+        int             fd;
+        uint16_t        local_port;
+        IPAddress       remote_ip;
+        uint16_t        remote_port;
+        IPAddress       tx_ip;
+        uint16_t        tx_port;
+        uint8_t         rx_buf[STUB_UDP_MAX_PACKET];
+        int             rx_len;
+        int             rx_pos;
+        uint8_t         tx_buf[STUB_UDP_MAX_PACKET];
+        int             tx_len;
+};
+
+#endif
@@ -0,0 +1,1093 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * arduino.cpp - host test stub, implementation of the Arduino and ESP8266 core stubs
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <netdb.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <linux/sockios.h>
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "LittleFS.h"
+#include "EEPROM.h"
+#include "WiFiUdp.h"
+#include "ESP8266httpUpdate.h"
+#include "bearssl/bearssl_hash.h"
+
+#define STUB_HEAP_SIZE              80000                           // free heap of ESP8266 after start of firmware
+#define STUB_HEAP_HEADER            16                              // size and size of previous block, payload aligned to 16
+#define STUB_HEAP_USED              1
+
+long                                stub_millis_offset;
+HardwareSerial                      Serial;
+std::string                         stub_serial_out;
+std::string                         stub_serial_in;
+int                                 stub_serial_fd = -1;
+EspClass                            ESP;
+uint32_t                            stub_chip_id = 0x123456;
+uint16_t                            stub_client_port;
+uint16_t                            stub_server_port;
+ESP8266WiFiClass                    WiFi;
+const char *                        stub_fs_root = "fs";
+uint32_t                            stub_fs_size = STUB_FS_SIZE;
+FS                                  LittleFS;
+EEPROMClass                         EEPROM;
+uint16_t                            stub_udp_port_offset = 20000;
+ESP8266HTTPUpdate                   ESPhttpUpdate;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * time
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+unsigned long
+micros (void)
+{
+    static struct timespec  start;
+    struct timespec         now;
+
+    if (! start.tv_sec)
+    {
+        clock_gettime (CLOCK_MONOTONIC, &start);
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1000000UL + now.tv_nsec / 1000 - start.tv_nsec / 1000;
+}
+
+unsigned long
+millis (void)
+{
+    return micros () / 1000 + stub_millis_offset;
+}
+
+void
+delay (unsigned long msec)
+{
+    usleep (msec * 1000);
+}
+
+void
+yield (void)
+{
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * GPIO: stub_gpio holds the level of each pin, e.g. RESET and BOOT0 of the STM32
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint8_t                             stub_gpio[17];
+
+void
+pinMode (uint8_t pin, uint8_t mode)
+{
+    (void) pin;
+    (void) mode;
+}
+
+void
+digitalWrite (uint8_t pin, uint8_t val)
+{
+    stub_gpio[pin % sizeof (stub_gpio)] = val;
+}
+
+int
+digitalRead (uint8_t pin)
+{
+    return stub_gpio[pin % sizeof (stub_gpio)];
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * Print, Serial, ESP
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+size_t
+Print::printf (const char * fmt, ...)
+{
+    char        buf[1024];
+    va_list     ap;
+    int         n;
+
+    va_start (ap, fmt);
+    n = vsnprintf (buf, sizeof (buf), fmt, ap);
+    va_end (ap);
+    return write ((const uint8_t *) buf, n < (int) sizeof (buf) ? n : (int) sizeof (buf) - 1);
+}
+
+size_t
+HardwareSerial::write (uint8_t c)
+{
+    return write (&c, 1);
+}
+
+size_t
+HardwareSerial::write (const uint8_t * buf, size_t len)
+{
+    if (stub_serial_fd >= 0)
+    {
+        size_t  n = 0;
+        ssize_t rtc;
+
+        while (n < len && ((rtc = ::write (stub_serial_fd, buf + n, len - n)) > 0 || (rtc < 0 && errno == EAGAIN)))
+        {
+            n += rtc > 0 ? rtc : 0;
+        }
+        return n;
+    }
+
+    bool esp_heap = stub_esp_heap;                                  // buffer of serial output is not on the heap of the ESP8266
+
+    stub_esp_heap = false;
+    stub_serial_out.append ((const char *) buf, len);
+    stub_esp_heap = esp_heap;
+    return len;
+}
+
+int
+HardwareSerial::available (void)
+{
+    int n = 0;
+
+    if (stub_serial_fd >= 0)
+    {
+        return ioctl (stub_serial_fd, FIONREAD, &n) < 0 ? 0 : n;
+    }
+    return stub_serial_in.size ();
+}
+
+int
+HardwareSerial::read (void)
+{
+    uint8_t ch;
+
+    if (stub_serial_fd >= 0)
+    {
+        return available () > 0 && ::read (stub_serial_fd, &ch, 1) == 1 ? ch : -1;
+    }
+
+    if (stub_serial_in.empty ())
+    {
+        return -1;
+    }
+
+    ch = stub_serial_in[0];
+    stub_serial_in.erase (0, 1);
+    return ch;
+}
+
+int
+HardwareSerial::peek (void)
+{
+    return stub_serial_in.empty () ? -1 : (uint8_t) stub_serial_in[0];
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * heap of the ESP8266: while stub_esp_heap is set, malloc() and new take memory from an arena of STUB_HEAP_SIZE bytes, first fit
+ * with immediate coalescing like umm_malloc, so fragmentation of the heap is the same as on the ESP8266. free() returns the memory
+ * to the arena it came from.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+extern "C" void *                   __libc_malloc (size_t);
+extern "C" void *                   __libc_calloc (size_t, size_t);
+extern "C" void *                   __libc_realloc (void *, size_t);
+extern "C" void                     __libc_free (void *);
+
+bool                                stub_esp_heap;
+uint32_t                            stub_heap_allocs;
+
+static uint8_t                      stub_heap[STUB_HEAP_SIZE] __attribute__ ((aligned (16)));
+
+#define HEAP_SIZE_OF(b)             (*(uint32_t *) (b) & ~STUB_HEAP_USED)
+#define HEAP_USED(b)                (*(uint32_t *) (b) & STUB_HEAP_USED)
+#define HEAP_PREV_SIZE(b)           (*(uint32_t *) ((b) + 4))
+
+static void
+stub_heap_set (uint8_t * b, uint32_t size, uint32_t used)
+{
+    *(uint32_t *) b = size | used;
+
+    if (b + size < stub_heap + STUB_HEAP_SIZE)
+    {
+        HEAP_PREV_SIZE (b + size) = size;
+    }
+}
+
+static bool
+stub_in_heap (void * p)
+{
+    return (uint8_t *) p >= stub_heap && (uint8_t *) p < stub_heap + STUB_HEAP_SIZE;
+}
+
+static void *
+stub_heap_alloc (size_t len)
+{
+    uint32_t    size = (len + STUB_HEAP_HEADER + 15) & ~15;
+    uint8_t *   b;
+
+    if (! HEAP_SIZE_OF (stub_heap))                                 // first call: one free block
+    {
+        stub_heap_set (stub_heap, STUB_HEAP_SIZE, 0);
+        HEAP_PREV_SIZE (stub_heap) = 0;
+    }
+
+    for (b = stub_heap; b < stub_heap + STUB_HEAP_SIZE; b += HEAP_SIZE_OF (b))
+    {
+        if (! HEAP_USED (b) && HEAP_SIZE_OF (b) >= size)
+        {
+            uint32_t rest = HEAP_SIZE_OF (b) - size;
+
+            if (rest >= 2 * STUB_HEAP_HEADER)
+            {
+                stub_heap_set (b + size, rest, 0);
+            }
+            else
+            {
+                size += rest;
+            }
+
+            stub_heap_set (b, size, STUB_HEAP_USED);
+            stub_heap_allocs++;
+            return b + STUB_HEAP_HEADER;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+stub_heap_free (void * p)
+{
+    uint8_t *   b       = (uint8_t *) p - STUB_HEAP_HEADER;
+    uint32_t    size    = HEAP_SIZE_OF (b);
+    uint8_t *   next    = b + size;
+
+    if (next < stub_heap + STUB_HEAP_SIZE && ! HEAP_USED (next))
+    {
+        size += HEAP_SIZE_OF (next);
+    }
+
+    if (b > stub_heap && ! HEAP_USED (b - HEAP_PREV_SIZE (b)))
+    {
+        b       -= HEAP_PREV_SIZE (b);
+        size    += HEAP_SIZE_OF (b);
+    }
+
+    stub_heap_set (b, size, 0);
+}
+
+extern "C" void *
+malloc (size_t len)
+{
+    return stub_esp_heap ? stub_heap_alloc (len) : __libc_malloc (len);
+}
+
+extern "C" void *
+calloc (size_t n, size_t len)
+{
+    void * p;
+
+    if (! stub_esp_heap)
+    {
+        return __libc_calloc (n, len);
+    }
+
+    if ((p = stub_heap_alloc (n * len)) != NULL)
+    {
+        memset (p, 0, n * len);
+    }
+
+    return p;
+}
+
+extern "C" void
+free (void * p)
+{
+    if (stub_in_heap (p))
+    {
+        stub_heap_free (p);
+    }
+    else
+    {
+        __libc_free (p);
+    }
+}
+
+extern "C" void *
+realloc (void * p, size_t len)
+{
+    void *      q;
+    size_t      old;
+
+    if (! stub_in_heap (p))
+    {
+        if (! p || ! stub_esp_heap)
+        {
+            return p || ! stub_esp_heap ? __libc_realloc (p, len) : stub_heap_alloc (len);
+        }
+
+        old = malloc_usable_size (p);
+    }
+    else
+    {
+        old = HEAP_SIZE_OF ((uint8_t *) p - STUB_HEAP_HEADER) - STUB_HEAP_HEADER;
+    }
+
+    if ((q = malloc (len)) != NULL)
+    {
+        memcpy (q, p, old < len ? old : len);
+        free (p);
+    }
+
+    return q;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * free heap, largest free block and fragmentation in percent, computed like in the ESP8266 core
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+stub_heap_stats (uint32_t * freep, uint32_t * maxp, uint8_t * fragp)
+{
+    uint8_t *   b;
+    uint32_t    total   = 0;
+    uint32_t    max     = 0;
+    double      squares = 0;
+
+    if (! HEAP_SIZE_OF (stub_heap))
+    {
+        *freep  = STUB_HEAP_SIZE;
+        *maxp   = STUB_HEAP_SIZE;
+        *fragp  = 0;
+        return;
+    }
+
+    for (b = stub_heap; b < stub_heap + STUB_HEAP_SIZE; b += HEAP_SIZE_OF (b))
+    {
+        if (! HEAP_USED (b))
+        {
+            uint32_t size = HEAP_SIZE_OF (b);
+
+            total   += size;
+            squares += (double) size * size;
+
+            if (max < size)
+            {
+                max = size;
+            }
+        }
+    }
+
+    *freep  = total;
+    *maxp   = max;
+    *fragp  = total ? 100 - (uint8_t) (sqrt (squares) * 100 / total) : 0;
+}
+
+uint32_t
+EspClass::getFreeHeap (void)
+{
+    uint32_t    free_heap;
+    uint32_t    max_block;
+    uint8_t     frag;
+
+    stub_heap_stats (&free_heap, &max_block, &frag);
+    return free_heap;
+}
+
+uint32_t
+EspClass::getMaxFreeBlockSize (void)
+{
+    uint32_t    free_heap;
+    uint32_t    max_block;
+    uint8_t     frag;
+
+    stub_heap_stats (&free_heap, &max_block, &frag);
+    return max_block;
+}
+
+uint8_t
+EspClass::getHeapFragmentation (void)
+{
+    uint32_t    free_heap;
+    uint32_t    max_block;
+    uint8_t     frag;
+
+    stub_heap_stats (&free_heap, &max_block, &frag);
+    return frag;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * TCP: a socket is shared by all copies of a WiFiClient, stop() closes it for all copies like on the ESP8266
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+struct STUB_SOCKET
+{
+    int                             fd;
+    int                             refs;
+};
+
+static STUB_SOCKET *
+stub_socket_new (int fd)
+{
+    STUB_SOCKET * s = new STUB_SOCKET;
+    int           one = 1;
+
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+    setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+    s->fd   = fd;
+    s->refs = 1;
+    return s;
+}
+
+static void
+stub_socket_release (STUB_SOCKET * s)
+{
+    if (s && --s->refs == 0)
+    {
+        if (s->fd >= 0)
+        {
+            close (s->fd);
+        }
+        delete s;
+    }
+}
+
+WiFiClient::WiFiClient ()                           { sock = NULL; timeout = 5000; }
+WiFiClient::WiFiClient (int fd)                     { sock = stub_socket_new (fd); timeout = 5000; }
+WiFiClient::WiFiClient (const WiFiClient & c)       { sock = c.sock; timeout = c.timeout; if (sock) sock->refs++; }
+WiFiClient::~WiFiClient ()                          { stub_socket_release (sock); }
+
+WiFiClient &
+WiFiClient::operator= (const WiFiClient & c)
+{
+    if (c.sock)
+    {
+        c.sock->refs++;
+    }
+
+    stub_socket_release (sock);
+    sock    = c.sock;
+    timeout = c.timeout;
+    return *this;
+}
+
+int
+WiFiClient::connect (IPAddress ip, uint16_t port)
+{
+    struct sockaddr_in  addr;
+    struct pollfd       pfd;
+    int                 fd;
+    int                 err = 0;
+    socklen_t           len = sizeof (err);
+
+    stop ();
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = (uint32_t) ip;
+    addr.sin_port           = htons (port == 80 && stub_client_port ? stub_client_port : port);
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+
+    if (::connect (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0 && errno != EINPROGRESS)
+    {
+        close (fd);
+        return 0;
+    }
+
+    pfd.fd      = fd;
+    pfd.events  = POLLOUT;
+
+    if (poll (&pfd, 1, timeout) != 1 || getsockopt (fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err)
+    {
+        close (fd);
+        return 0;
+    }
+
+    stub_socket_release (sock);
+    sock = stub_socket_new (fd);
+    return 1;
+}
+
+int
+WiFiClient::connect (const char * host, uint16_t port)
+{
+    IPAddress ip;
+
+    if (! WiFi.hostByName (host, ip))
+    {
+        return 0;
+    }
+    return connect (ip, port);
+}
+
+size_t
+WiFiClient::write (const uint8_t * buf, size_t len)
+{
+    unsigned long   start = millis ();
+    size_t          n = 0;
+    int             room;
+    ssize_t         rtc;
+
+    while (n < len && sock && sock->fd >= 0)
+    {
+        room = availableForWrite ();
+
+        if (room > 0)
+        {
+            rtc = send (sock->fd, buf + n, (size_t) room < len - n ? (size_t) room : len - n, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+            if (rtc < 0 && errno != EAGAIN)
+            {
+                break;
+            }
+
+            if (rtc > 0)
+            {
+                n += rtc;
+                start = millis ();
+            }
+        }
+        else if (millis () - start >= timeout)
+        {
+            break;
+        }
+        else
+        {
+            usleep (1000);
+        }
+    }
+    return n;
+}
+
+int
+WiFiClient::availableForWrite (void)
+{
+    int outq = 0;
+
+    if (! sock || sock->fd < 0 || ioctl (sock->fd, SIOCOUTQ, &outq) < 0)
+    {
+        return 0;
+    }
+    return outq < STUB_TCP_SND_BUF ? STUB_TCP_SND_BUF - outq : 0;
+}
+
+int
+WiFiClient::available (void)
+{
+    int n = 0;
+
+    if (! sock || sock->fd < 0 || ioctl (sock->fd, FIONREAD, &n) < 0)
+    {
+        return 0;
+    }
+    return n;
+}
+
+int
+WiFiClient::read (void)
+{
+    uint8_t ch;
+
+    return read (&ch, 1) == 1 ? ch : -1;
+}
+
+int
+WiFiClient::read (uint8_t * buf, size_t len)
+{
+    ssize_t n;
+
+    if (! sock || sock->fd < 0)
+    {
+        return -1;
+    }
+
+    n = recv (sock->fd, buf, len, MSG_DONTWAIT);
+    return n > 0 ? n : -1;
+}
+
+int
+WiFiClient::peek (void)
+{
+    uint8_t ch;
+
+    return sock && sock->fd >= 0 && recv (sock->fd, &ch, 1, MSG_DONTWAIT | MSG_PEEK) == 1 ? ch : -1;
+}
+
+void
+WiFiClient::stop (void)
+{
+    if (sock && sock->fd >= 0)
+    {
+        close (sock->fd);
+        sock->fd = -1;
+    }
+}
+
+uint8_t
+WiFiClient::connected (void)
+{
+    uint8_t ch;
+    ssize_t n;
+
+    if (! sock || sock->fd < 0)
+    {
+        return 0;
+    }
+
+    n = recv (sock->fd, &ch, 1, MSG_DONTWAIT | MSG_PEEK);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+WiFiClient::operator bool ()
+{
+    return sock && sock->fd >= 0;
+}
+
+void
+WiFiServer::begin (void)
+{
+    struct sockaddr_in  addr;
+    socklen_t           len = sizeof (addr);
+    int                 one = 1;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl (INADDR_LOOPBACK);
+    addr.sin_port           = htons (stub_server_port);
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+
+    if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen (fd, 16) < 0)
+    {
+        perror ("WiFiServer::begin");
+        exit (1);
+    }
+
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+    getsockname (fd, (struct sockaddr *) &addr, &len);
+    stub_server_port = ntohs (addr.sin_port);
+}
+
+WiFiClient
+WiFiServer::available (void)
+{
+    int cfd = fd >= 0 ? ::accept (fd, NULL, NULL) : -1;
+
+    return cfd >= 0 ? WiFiClient (cfd) : WiFiClient ();
+}
+
+bool
+WiFiServer::hasClient (void)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    return fd >= 0 && poll (&pfd, 1, 0) == 1;
+}
+
+int
+ESP8266WiFiClass::hostByName (const char * host, IPAddress & ip)
+{
+    struct addrinfo     hints;
+    struct addrinfo *   res;
+
+    if (stub_client_port)                                           // all hosts are the stand-in server
+    {
+        ip = IPAddress (127, 0, 0, 1);
+        return 1;
+    }
+
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_family = AF_INET;
+
+    if (getaddrinfo (host, NULL, &hints, &res))
+    {
+        return 0;
+    }
+
+    ip = IPAddress (((struct sockaddr_in *) res->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo (res);
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * UDP
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint8_t
+WiFiUDP::begin (uint16_t port)
+{
+    struct sockaddr_in  addr;
+    int                 one = 1;
+
+    stop ();
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl (INADDR_LOOPBACK);
+    addr.sin_port           = htons (port + stub_udp_port_offset);
+
+    fd = socket (AF_INET, SOCK_DGRAM, 0);
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+
+    if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0)
+    {
+        perror ("WiFiUDP::begin");
+        close (fd);
+        fd = -1;
+        return 0;
+    }
+
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+    local_port = port;
+    return 1;
+}
+
+void
+WiFiUDP::stop (void)
+{
+    if (fd >= 0)
+    {
+        close (fd);
+        fd = -1;
+    }
+
+    rx_len = rx_pos = tx_len = 0;
+}
+
+int
+WiFiUDP::parsePacket (void)
+{
+    struct sockaddr_in  addr;
+    socklen_t           len = sizeof (addr);
+    ssize_t             n;
+
+    rx_len = rx_pos = 0;
+    n = fd >= 0 ? recvfrom (fd, rx_buf, sizeof (rx_buf), 0, (struct sockaddr *) &addr, &len) : -1;
+
+    if (n <= 0)
+    {
+        return 0;
+    }
+
+    rx_len      = n;
+    remote_ip   = IPAddress ((uint32_t) addr.sin_addr.s_addr);
+    remote_port = ntohs (addr.sin_port);
+    return rx_len;
+}
+
+int
+WiFiUDP::read (uint8_t * buf, size_t len)
+{
+    if (len > (size_t) (rx_len - rx_pos))
+    {
+        len = rx_len - rx_pos;
+    }
+
+    memcpy (buf, rx_buf + rx_pos, len);
+    rx_pos += len;
+    return len;
+}
+
+int
+WiFiUDP::beginPacket (IPAddress ip, uint16_t port)
+{
+    tx_ip   = ip;
+    tx_port = port;
+    tx_len  = 0;
+    return 1;
+}
+
+size_t
+WiFiUDP::write (const uint8_t * buf, size_t len)
+{
+    if (len > (size_t) (STUB_UDP_MAX_PACKET - tx_len))
+    {
+        len = STUB_UDP_MAX_PACKET - tx_len;
+    }
+
+    memcpy (tx_buf + tx_len, buf, len);
+    tx_len += len;
+    return len;
+}
+
+int
+WiFiUDP::endPacket (void)
+{
+    struct sockaddr_in  addr;
+    int                 sfd = fd >= 0 ? fd : socket (AF_INET, SOCK_DGRAM, 0);
+    ssize_t             n;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = (uint32_t) tx_ip;
+    addr.sin_port           = htons (tx_port);
+
+    n = sendto (sfd, tx_buf, tx_len, 0, (struct sockaddr *) &addr, sizeof (addr));
+
+    if (sfd != fd)
+    {
+        close (sfd);
+    }
+
+    tx_len = 0;
+    return n >= 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * LittleFS
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static std::string
+stub_fs_path (const char * name)
+{
+    while (*name == '/')
+    {
+        name++;
+    }
+    return std::string (stub_fs_root) + "/" + name;
+}
+
+int
+File::available (void)
+{
+    return fp ? (int) (size () - position ()) : 0;
+}
+
+size_t
+File::size (void)
+{
+    struct stat st;
+
+    if (! fp)
+    {
+        return 0;
+    }
+
+    fflush (fp);
+    return fstat (fileno (fp), &st) ? 0 : st.st_size;
+}
+
+bool
+Dir::next (void)
+{
+    struct dirent * d;
+    struct stat     st;
+
+    while (dir && (d = readdir (dir)) != NULL)
+    {
+        if (! stat (stub_fs_path (d->d_name).c_str (), &st) && S_ISREG (st.st_mode))
+        {
+            name = d->d_name;
+            return true;
+        }
+    }
+
+    if (dir)
+    {
+        closedir (dir);
+        dir = NULL;
+    }
+    return false;
+}
+
+File
+Dir::openFile (const char * mode)
+{
+    return LittleFS.open (name.c_str (), mode);
+}
+
+File
+FS::open (const char * name, const char * mode)
+{
+    std::string m = mode;
+
+    if (m == "r" || m == "r+" || m == "w" || m == "w+" || m == "a" || m == "a+")
+    {
+        return File (fopen (stub_fs_path (name).c_str (), (m + "b").c_str ()));
+    }
+    return File ();
+}
+
+Dir
+FS::openDir (const char * path)
+{
+    return Dir (opendir (stub_fs_path (path).c_str ()));
+}
+
+bool
+FS::exists (const char * name)
+{
+    return ! access (stub_fs_path (name).c_str (), F_OK);
+}
+
+bool
+FS::remove (const char * name)
+{
+    return ! unlink (stub_fs_path (name).c_str ());
+}
+
+bool
+FS::rename (const char * from, const char * to)
+{
+    return ! ::rename (stub_fs_path (from).c_str (), stub_fs_path (to).c_str ());
+}
+
+bool
+FS::format (void)
+{
+    Dir dir = openDir ("");
+
+    while (dir.next ())
+    {
+        remove (dir.fileName ().c_str ());
+    }
+    return true;
+}
+
+bool
+FS::info (FSInfo & info)
+{
+    Dir         dir = openDir ("");
+    struct stat st;
+
+    memset (&info, 0, sizeof (info));
+
+    while (dir.next ())
+    {
+        if (! stat (stub_fs_path (dir.fileName ().c_str ()).c_str (), &st))
+        {
+            info.usedBytes += (st.st_size + 4095) & ~4095;
+        }
+    }
+
+    info.totalBytes     = stub_fs_size;
+    info.blockSize      = 4096;
+    info.pageSize       = 256;
+    info.maxOpenFiles   = 5;
+    info.maxPathLength  = 32;
+    return true;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * SHA-256 (FIPS 180-4)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static const uint32_t               sha256_k[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x,n)                    (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void
+sha256_block (uint32_t * val, const uint8_t * p)
+{
+    uint32_t    w[64];
+    uint32_t    a[8];
+    uint32_t    t1;
+    uint32_t    t2;
+    int         i;
+
+    for (i = 0; i < 16; i++)
+    {
+        w[i] = ((uint32_t) p[4 * i] << 24) | (p[4 * i + 1] << 16) | (p[4 * i + 2] << 8) | p[4 * i + 3];
+    }
+
+    for (i = 16; i < 64; i++)
+    {
+        w[i] = w[i - 16] + (ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3)) + w[i - 7] +
+               (ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+    }
+
+    memcpy (a, val, sizeof (a));
+
+    for (i = 0; i < 64; i++)
+    {
+        t1 = a[7] + (ROR(a[4], 6) ^ ROR(a[4], 11) ^ ROR(a[4], 25)) + ((a[4] & a[5]) ^ (~a[4] & a[6])) + sha256_k[i] + w[i];
+        t2 = (ROR(a[0], 2) ^ ROR(a[0], 13) ^ ROR(a[0], 22)) + ((a[0] & a[1]) ^ (a[0] & a[2]) ^ (a[1] & a[2]));
+        memmove (a + 1, a, 7 * sizeof (uint32_t));
+        a[4] += t1;
+        a[0] = t1 + t2;
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        val[i] += a[i];
+    }
+}
+
+void
+br_sha256_init (br_sha256_context * ctx)
+{
+    static const uint32_t init[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+    memcpy (ctx->val, init, sizeof (init));
+    ctx->count = 0;
+}
+
+void
+br_sha256_update (br_sha256_context * ctx, const void * data, size_t len)
+{
+    const uint8_t * p = (const uint8_t *) data;
+
+    while (len--)
+    {
+        ctx->buf[ctx->count++ & 63] = *p++;
+
+        if ((ctx->count & 63) == 0)
+        {
+            sha256_block (ctx->val, ctx->buf);
+        }
+    }
+}
+
+void
+br_sha256_out (const br_sha256_context * ctx, void * out)
+{
+    br_sha256_context   c = *ctx;
+    uint64_t            bits = ctx->count * 8;
+    uint8_t *           o = (uint8_t *) out;
+    uint8_t             pad = 0x80;
+    int                 i;
+
+    br_sha256_update (&c, &pad, 1);
+    pad = 0;
+
+    while ((c.count & 63) != 56)
+    {
+        br_sha256_update (&c, &pad, 1);
+    }
+
+    for (i = 7; i >= 0; i--)
+    {
+        pad = bits >> (8 * i);
+        br_sha256_update (&c, &pad, 1);
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        o[4 * i]     = c.val[i] >> 24;
+        o[4 * i + 1] = c.val[i] >> 16;
+        o[4 * i + 2] = c.val[i] >> 8;
+        o[4 * i + 3] = c.val[i];
+    }
+}
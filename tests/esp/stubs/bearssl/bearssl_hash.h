@@ -0,0 +1,24 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * bearssl_hash.h - host test stub, SHA-256 of BearSSL
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef BEARSSL_HASH_H
+#define BEARSSL_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define br_sha256_SIZE              32
+
+typedef struct
+{
+    uint8_t                         buf[64];
+    uint64_t                        count;
+    uint32_t                        val[8];
+} br_sha256_context;
+
+extern void                         br_sha256_init (br_sha256_context *);
+extern void                         br_sha256_update (br_sha256_context *, const void *, size_t);
+extern void                         br_sha256_out (const br_sha256_context *, void *);
+
+#endif
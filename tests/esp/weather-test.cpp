@@ -0,0 +1,467 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * weather-test.cpp - weather cache of ESP8266/ESP-uclock/weather.cpp against a local stand-in of openweathermap
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The stand-in server runs in a child process and answers with the captures of tests/jsonparser. The city of the query selects
+ * how it answers:
+ *
+ *      plain       Content-Length
+ *      chunked     chunked transfer encoding with random chunk sizes and chunk extensions
+ *      close       neither Content-Length nor chunked: content ends with the connection
+ *      trickle     chunked, 16 bytes every 5 msec
+ *      error       status 401 with error message of openweathermap
+ *      stall       first answer plain, then only the header and no content
+ *      garbage     first answer plain, then no HTTP response
+ *      truncate    first answer plain, then the content is cut off after TRUNCATE_BYTES, e.g. behind "cod" of the forecast
+ *
+ * The test queries like the STM32 does and checks the lines sent to the STM32, hits, misses and the number of requests the server
+ * got. Background refreshes are driven by calling weather_loop() like the main loop: every call must return quickly, also if the
+ * server is slow or stalls, and the refreshed answer must replace the cached one. Time is advanced with stub_millis_offset.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "weather.h"
+
+#define CAPTURES                    "../jsonparser/captures/"
+#define MAX_LOOP_MSEC               20                      // max. duration of one weather_loop() call
+#define MINUTES(m)                  ((m) * 60 * 1000L)
+#define TRUNCATE_BYTES              400                     // mode truncate: forecast up to the first record
+
+#define MODE_PLAIN                  0
+#define MODE_CHUNKED                1
+#define MODE_CLOSE                  2
+#define MODE_TRICKLE                3
+#define MODE_ERROR                  4
+#define MODE_STALL                  5
+#define MODE_GARBAGE                6
+#define MODE_TRUNCATE               7
+#define N_MODES                     8
+
+static const char *                 mode_names[N_MODES] = { "plain", "chunked", "close", "trickle", "error", "stall", "garbage", "truncate" };
+
+static volatile uint32_t *          requests;               // shared with server: requests per mode
+static char                         appid[] = "0123456789abcdef";
+static uint32_t                     n_errors;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * stand-in server
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t                     rand_state = 1;
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static void
+send_all (int fd, const char * buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0 && (n = send (fd, buf, len, MSG_NOSIGNAL)) > 0)
+    {
+        buf += n;
+        len -= n;
+    }
+}
+
+static void
+send_str (int fd, const char * s)
+{
+    send_all (fd, s, strlen (s));
+}
+
+static void
+send_chunk (int fd, const char * buf, size_t len, bool extension)
+{
+    char    line[32];
+
+    snprintf (line, sizeof (line), extension ? "%zx;name=value\r\n" : "%zX\r\n", len);
+    send_str (fd, line);
+    send_all (fd, buf, len);
+    send_all (fd, "\r\n", 2);
+}
+
+static void
+serve (int fd)
+{
+    static char     body[65536];
+    char            request[1024];
+    char            header[256];
+    const char *    capture;
+    const char *    status = "200 OK";
+    char *          q;
+    FILE *          fp;
+    size_t          len = 0;
+    size_t          pos;
+    size_t          n;
+    ssize_t         rtc;
+    int             mode;
+
+    while (len < sizeof (request) - 1 && (rtc = recv (fd, request + len, sizeof (request) - 1 - len, 0)) > 0)
+    {
+        len += rtc;
+        request[len] = '\0';
+
+        if (strstr (request, "\r\n\r\n"))
+        {
+            break;
+        }
+    }
+
+    request[len] = '\0';
+    q = strstr (request, "?q=");
+
+    for (mode = 0; q && mode < N_MODES; mode++)
+    {
+        if (! strncmp (q + 3, mode_names[mode], strlen (mode_names[mode])))
+        {
+            break;
+        }
+    }
+
+    if (! q || mode == N_MODES)
+    {
+        send_str (fd, "HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n");
+        return;
+    }
+
+    requests[mode]++;
+    rand_state = requests[mode] * 7919 + mode;
+
+    if (mode == MODE_ERROR)
+    {
+        capture = CAPTURES "error-401.json";
+        status  = "401 Unauthorized";
+    }
+    else
+    {
+        capture = strstr (request, "/forecast") ? CAPTURES "forecast.json" : CAPTURES "current.json";
+    }
+
+    fp = fopen (capture, "rb");
+
+    if (! fp)
+    {
+        perror (capture);
+        return;
+    }
+
+    len = fread (body, 1, sizeof (body), fp);
+    fclose (fp);
+
+    if ((mode == MODE_STALL || mode == MODE_GARBAGE) && requests[mode] > 1)
+    {
+        if (mode == MODE_GARBAGE)
+        {
+            send_str (fd, "XYZ\r\n\r\n{\"cod\":200}");
+        }
+        else
+        {
+            send_str (fd, "HTTP/1.1 200 OK\r\nContent-Length: 443\r\n\r\n");
+        }
+
+        while (recv (fd, request, sizeof (request), 0) > 0)                 // until client gives up
+        {
+            ;
+        }
+        return;
+    }
+
+    if (mode == MODE_CHUNKED || mode == MODE_TRICKLE)
+    {
+        n = snprintf (header, sizeof (header), "HTTP/1.1 %s\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n"
+                      "Connection: close\r\n\r\n", status);
+        send_all (fd, header, n);
+
+        for (pos = 0; pos < len; pos += n)
+        {
+            n = (mode == MODE_TRICKLE) ? 16 : 1 + next_rand () % 300;
+
+            if (n > len - pos)
+            {
+                n = len - pos;
+            }
+
+            send_chunk (fd, body + pos, n, next_rand () % 8 == 0);
+
+            if (mode == MODE_TRICKLE)
+            {
+                usleep (5000);
+            }
+        }
+
+        send_str (fd, "0\r\n\r\n");
+    }
+    else
+    {
+        if (mode == MODE_CLOSE)
+        {
+            n = snprintf (header, sizeof (header), "HTTP/1.1 %s\r\nConnection: close\r\n\r\n", status);
+        }
+        else
+        {
+            n = snprintf (header, sizeof (header), "HTTP/1.1 %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", status, len);
+        }
+
+        send_all (fd, header, n);
+        send_all (fd, body, (mode == MODE_TRUNCATE && requests[mode] > 1) ? TRUNCATE_BYTES : len);
+    }
+}
+
+static pid_t
+start_server (void)
+{
+    struct sockaddr_in  addr;
+    socklen_t           len = sizeof (addr);
+    pid_t               pid;
+    int                 fd;
+    int                 cfd;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl (INADDR_LOOPBACK);
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+
+    if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen (fd, 8) < 0)
+    {
+        perror ("stand-in server");
+        exit (1);
+    }
+
+    getsockname (fd, (struct sockaddr *) &addr, &len);
+    stub_client_port = ntohs (addr.sin_port);
+
+    pid = fork ();
+
+    if (pid == 0)
+    {
+        signal (SIGCHLD, SIG_IGN);
+
+        while ((cfd = accept (fd, NULL, NULL)) >= 0)
+        {
+            if (fork () == 0)                                               // one process per connection
+            {
+                serve (cfd);
+                close (cfd);
+                _exit (0);
+            }
+            close (cfd);
+        }
+        _exit (0);
+    }
+
+    close (fd);
+    return pid;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * checks
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+check (bool ok, const char * what)
+{
+    if (! ok)
+    {
+        printf ("weather-test: %s failed, output to STM32: \"%s\"\n", what, stub_serial_out.c_str ());
+        n_errors++;
+    }
+}
+
+static void
+check_answer (const char * what, const char * expected)
+{
+    check (stub_serial_out.find (expected) != std::string::npos, what);
+    stub_serial_out.clear ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * call weather_loop() until refresh of current weather (fc = 0) or forecast (fc = 1) is stored or failed, returns number of calls
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+run_refresh (const char * what, int fc, long advance_after)
+{
+    unsigned long   refreshes   = weather_cache_stats.refreshes;
+    unsigned long   errors      = weather_cache_stats.errors;
+    unsigned long   start;
+    unsigned long   msec;
+    unsigned long   max_msec    = 0;
+    unsigned long   begin       = millis ();
+    uint32_t        calls       = 0;
+    char            buf[128];
+
+    do
+    {
+        start = micros ();
+        weather_loop ();
+        msec = (micros () - start) / 1000;
+        calls++;
+
+        if (msec > max_msec)
+        {
+            max_msec = msec;
+        }
+
+        if (advance_after && millis () - begin >= (unsigned long) advance_after)
+        {
+            stub_millis_offset += 11000;                                    // let the refresh time out
+            advance_after = 0;
+        }
+
+        usleep (200);
+    } while (millis () - begin < 15000 &&
+             (weather_cache_stats.refreshes == refreshes || (weather_cache_age (fc) > 1 && weather_cache_stats.errors == errors)));
+
+    printf ("weather-test: refresh %-8s %5u calls of weather_loop(), max %lu msec\n", what, calls, max_msec);
+    snprintf (buf, sizeof (buf), "refresh %s: weather_loop() must not block", what);
+    check (max_msec <= MAX_LOOP_MSEC, buf);
+    return calls;
+}
+
+int
+main (void)
+{
+    pid_t           pid;
+    unsigned long   misses;
+    unsigned long   errors;
+    int             fd;
+
+    requests = (volatile uint32_t *) mmap (NULL, N_MODES * sizeof (uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    pid = start_server ();
+
+    get_weather (appid, (char *) "plain");
+    check_answer ("current weather", "WEATHER Wetter heute: 13 Grad, \xfc" "berwiegend bew\xf6lkt\r\n");
+    get_weather_icon (appid, (char *) "plain");
+    check_answer ("icon from cache", "WICON 04d\r\n");
+    check (requests[MODE_PLAIN] == 1 && weather_cache_stats.hits == 1 && weather_cache_stats.misses == 1, "text and icon share one query");
+
+    get_weather_fc (appid, (char *) "chunked");
+    check_answer ("forecast chunked", "WEATHER_FC Wetter morgen: -2 Grad, Leichter Regen 8\r\n");
+    get_weather_icon_fc (appid, (char *) "chunked");
+    check_answer ("forecast icon from cache", "WICON_FC 08n\r\n");
+    check (requests[MODE_CHUNKED] == 1, "forecast text and icon share one query");
+
+    get_weather (appid, (char *) "close");
+    check_answer ("content ends with connection", "WEATHER Wetter heute: 13 Grad");
+    get_weather_icon (appid, (char *) "close");
+    check_answer ("content ends with connection, icon", "WICON 04d\r\n");
+    check (requests[MODE_CLOSE] == 1, "other city is a miss, then a hit");
+
+    misses = weather_cache_stats.misses;
+    get_weather (appid, (char *) "error");
+    check_answer ("error 401", "WEATHER Wetter heute: Error 401\r\n");
+    get_weather (appid, (char *) "error");
+    check_answer ("error 401 again", "WEATHER Wetter heute: Error 401\r\n");
+    check (requests[MODE_ERROR] == 2 && weather_cache_stats.misses == misses + 2, "error answers are not cached");
+
+    /*---------------------------------------------------------------------------------------------------------------------------------------
+     * background refresh of a slow server
+     *---------------------------------------------------------------------------------------------------------------------------------------
+     */
+    get_weather (appid, (char *) "trickle");
+    check_answer ("trickle", "WEATHER Wetter heute: 13 Grad");
+    stub_millis_offset += MINUTES(9);
+    get_weather_icon (appid, (char *) "trickle");
+    check_answer ("stale answer still used", "WICON 04d\r\n");
+    check (requests[MODE_TRICKLE] == 1, "stale answer needs no query");
+
+    errors = weather_cache_stats.errors;
+    check (run_refresh ("trickle", 0, 0) >= 10, "refresh of slow server spans several calls");
+    check (requests[MODE_TRICKLE] == 2 && weather_cache_age (0) < 2 && weather_cache_stats.errors == errors, "refresh replaces cache");
+    get_weather (appid, (char *) "trickle");
+    check_answer ("refreshed answer", "WEATHER Wetter heute: 13 Grad");
+    check (requests[MODE_TRICKLE] == 2, "refreshed answer is a hit");
+
+    /*---------------------------------------------------------------------------------------------------------------------------------------
+     * background refresh fails: cache keeps old answer
+     *---------------------------------------------------------------------------------------------------------------------------------------
+     */
+    get_weather (appid, (char *) "stall");
+    check_answer ("stall: first answer", "WEATHER Wetter heute: 13 Grad");
+    stub_millis_offset += MINUTES(9);
+    get_weather (appid, (char *) "stall");
+    check_answer ("stall: stale answer", "WEATHER Wetter heute: 13 Grad");
+    errors = weather_cache_stats.errors;
+    run_refresh ("stall", 0, 100);
+    check (weather_cache_stats.errors == errors + 1, "stalled refresh times out");
+
+    get_weather_fc (appid, (char *) "truncate");
+    check_answer ("truncate: first answer", "WEATHER_FC Wetter morgen: -2 Grad, Leichter Regen 8\r\n");
+    stub_millis_offset += MINUTES(9);
+    get_weather_icon_fc (appid, (char *) "truncate");
+    check_answer ("truncate: stale answer", "WICON_FC 08n\r\n");
+    errors = weather_cache_stats.errors;
+    run_refresh ("truncate", 1, 0);
+    check (requests[MODE_TRUNCATE] == 2, "truncated refresh is requested");
+    check (weather_cache_stats.errors == errors + 1 && weather_cache_age (1) >= 9 * 60, "truncated refresh keeps old answer");
+    get_weather_icon_fc (appid, (char *) "truncate");
+    check_answer ("truncate: old answer", "WICON_FC 08n\r\n");
+    check (requests[MODE_TRUNCATE] == 2, "old forecast is a hit");
+
+    get_weather (appid, (char *) "garbage");
+    check_answer ("garbage: first answer", "WEATHER Wetter heute: 13 Grad");
+    stub_millis_offset += MINUTES(9);
+    get_weather_icon (appid, (char *) "garbage");
+    check_answer ("garbage: stale answer", "WICON 04d\r\n");
+    errors = weather_cache_stats.errors;
+    run_refresh ("garbage", 0, 0);
+    check (weather_cache_stats.errors == errors + 1 && weather_cache_age (0) >= 9 * 60, "malformed refresh keeps old answer");
+    get_weather_icon (appid, (char *) "garbage");
+    check_answer ("garbage: old answer", "WICON 04d\r\n");
+    check (requests[MODE_GARBAGE] == 2, "old answer is a hit");
+
+    /*---------------------------------------------------------------------------------------------------------------------------------------
+     * TTL and connection failure
+     *---------------------------------------------------------------------------------------------------------------------------------------
+     */
+    stub_millis_offset += MINUTES(11);
+    get_weather (appid, (char *) "plain");
+    check_answer ("expired", "WEATHER Wetter heute: 13 Grad");
+    check (requests[MODE_PLAIN] == 2, "expired answer is a miss");
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);                                  // port of a closed socket: connection refused
+    {
+        struct sockaddr_in  addr;
+        socklen_t           len = sizeof (addr);
+
+        memset (&addr, 0, sizeof (addr));
+        addr.sin_family         = AF_INET;
+        addr.sin_addr.s_addr    = htonl (INADDR_LOOPBACK);
+        bind (fd, (struct sockaddr *) &addr, sizeof (addr));
+        getsockname (fd, (struct sockaddr *) &addr, &len);
+        close (fd);
+        stub_client_port = ntohs (addr.sin_port);
+    }
+
+    errors = weather_cache_stats.errors;
+    get_weather_fc (appid, (char *) "plain");
+    check_answer ("connection refused", "ERROR connection to stand-in failed\r\n");
+    check (weather_cache_stats.errors == errors + 1, "connection failure is counted");
+
+    kill (pid, SIGTERM);
+    waitpid (pid, NULL, 0);
+
+    printf ("weather-test: hits %lu, misses %lu, refreshes %lu, errors %lu, %u errors\n", weather_cache_stats.hits,
+            weather_cache_stats.misses, weather_cache_stats.refreshes, weather_cache_stats.errors, n_errors);
+    return n_errors ? 1 : 0;
+}
@@ -0,0 +1,325 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * flash-test.c - power loss test of the journaled configuration log in src/flash/flash.c
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The W25Qxx is simulated as NOR flash: programming can only clear bits, erasing sets a whole sector to 0xFF.
+ * A workload of random EEPROM writes and flushes is run once to count the flash operations. Then it is run again
+ * for every operation, and the power is cut exactly at that operation: a page program stores only a part of its
+ * bytes, an erase leaves a random part of the sector unerased. Optionally the power is cut a second time during
+ * the recovery of flash_init().
+ *
+ * After every power loss flash_init() must deliver each 60 byte chunk either with its value before or after the
+ * interrupted flush. The workload then continues on the recovered log, and a final reboot must deliver exactly
+ * the data of the last completed flush.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <setjmp.h>
+#include "main.h"
+#include "w25qxx.h"
+#include "flash.h"
+
+#define NOR_SECTORS                 32                      // enough for old image (0..3) and log ring
+#define NOR_SECTOR_SIZE             4096
+#define NOR_PAGE_SIZE               256
+
+#define EEPROM_SIZE                 16384                   // see CACHE_SIZE in flash.c
+#define CHUNK_SIZE                  60                      // see CHUNK_SIZE in flash.c
+#define CHUNKS                      ((EEPROM_SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE)
+
+#define STEPS                       300                     // flushes per workload, several round trips through the ring
+
+volatile uint32_t                   uptime;
+
+static uint8_t                      nor[NOR_SECTORS * NOR_SECTOR_SIZE];
+static uint32_t                     nor_ops;                // number of program and erase operations
+static uint32_t                     nor_fail_at;            // cut power at this operation, 0: never
+static uint32_t                     nor_rand;               // random state of torn operations
+static jmp_buf                      power_loss;
+
+static uint8_t                      committed[EEPROM_SIZE]; // data of last completed flush
+static uint8_t                      pending[EEPROM_SIZE];   // data of running flush
+static uint8_t                      actual[EEPROM_SIZE];
+static uint32_t                     workload_rand;
+
+static uint32_t                     n_runs;
+static uint32_t                     n_errors;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * random numbers, own generator for reproducible runs
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+next_rand (uint32_t * state)
+{
+    *state = *state * 1103515245 + 12345;
+    return *state >> 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * simulated W25Qxx
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+void
+w25qxx_init (void)
+{
+}
+
+void
+w25qxx_read_page (uint8_t * buf, uint32_t sector, uint32_t page)
+{
+    memcpy (buf, nor + sector * NOR_SECTOR_SIZE + page * NOR_PAGE_SIZE, NOR_PAGE_SIZE);
+}
+
+void
+w25qxx_write_page (uint8_t * buf, uint32_t sector, uint32_t page)
+{
+    uint8_t *   p = nor + sector * NOR_SECTOR_SIZE + page * NOR_PAGE_SIZE;
+    uint32_t    len = NOR_PAGE_SIZE;
+    uint32_t    i;
+
+    if (++nor_ops == nor_fail_at)
+    {
+        len = next_rand (&nor_rand) % NOR_PAGE_SIZE;                        // torn write: only a part is programmed
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        p[i] &= buf[i];
+    }
+
+    if (nor_ops == nor_fail_at)
+    {
+        longjmp (power_loss, 1);
+    }
+}
+
+void
+w25qxx_erase_sector (uint32_t sector)
+{
+    uint8_t *   p = nor + sector * NOR_SECTOR_SIZE;
+    uint32_t    i;
+
+    if (++nor_ops == nor_fail_at)
+    {
+        for (i = 0; i < NOR_SECTOR_SIZE; i++)                               // interrupted erase: random bytes erased
+        {
+            if (next_rand (&nor_rand) & 0x01)
+            {
+                p[i] = 0xFF;
+            }
+        }
+
+        longjmp (power_loss, 1);
+    }
+
+    memset (p, 0xFF, NOR_SECTOR_SIZE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * reboot: flash_init(), optionally cut the power again after fail_after operations of the recovery
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+reboot (uint32_t fail_after)
+{
+    nor_fail_at = fail_after ? nor_ops + fail_after : 0;
+
+    if (setjmp (power_loss))
+    {
+        nor_fail_at = 0;                                                    // second power loss during recovery
+    }
+
+    flash_init ();
+    nor_fail_at = 0;
+    flash_read (0, actual, EEPROM_SIZE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check that every chunk holds its old or its new value
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+check_chunks (const char * what, uint32_t fail_at)
+{
+    uint32_t    chunk;
+    uint32_t    offset;
+    uint32_t    len;
+
+    for (chunk = 0; chunk < CHUNKS; chunk++)
+    {
+        offset  = chunk * CHUNK_SIZE;
+        len     = (offset + CHUNK_SIZE <= EEPROM_SIZE) ? CHUNK_SIZE : EEPROM_SIZE - offset;
+
+        if (memcmp (actual + offset, committed + offset, len) != 0 && memcmp (actual + offset, pending + offset, len) != 0)
+        {
+            printf ("%s: power loss at operation %u: chunk %u corrupted\n", what, fail_at, chunk);
+            n_errors++;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * one step of workload: some random writes, then flush
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+workload_step (void)
+{
+    uint8_t     buf[100];
+    uint32_t    n_writes;
+    uint32_t    addr;
+    uint32_t    len;
+    uint32_t    i;
+
+    memcpy (pending, committed, EEPROM_SIZE);
+    n_writes = 1 + next_rand (&workload_rand) % 4;
+
+    while (n_writes--)
+    {
+        len  = 1 + next_rand (&workload_rand) % sizeof (buf);
+        addr = next_rand (&workload_rand) % (EEPROM_SIZE - len);
+
+        for (i = 0; i < len; i++)
+        {
+            buf[i] = next_rand (&workload_rand);
+        }
+
+        memcpy (pending + addr, buf, len);
+        flash_write (addr, buf, len);
+    }
+
+    flash_flush (1);
+    memcpy (committed, pending, EEPROM_SIZE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * run workload on erased flash, cut power at operation fail_at and after recovery_fail operations of the recovery
+ * returns number of operations of a run without power loss
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+run_workload (uint32_t fail_at, uint32_t recovery_fail)
+{
+    volatile uint32_t   step;
+
+    memset (nor, 0xFF, sizeof (nor));
+    memset (committed, 0xFF, EEPROM_SIZE);
+    memset (pending, 0xFF, EEPROM_SIZE);
+    nor_ops         = 0;
+    nor_fail_at     = 0;
+    nor_rand        = fail_at;
+    workload_rand   = 1;
+    n_runs++;
+
+    flash_init ();
+    nor_fail_at = fail_at;
+
+    for (step = 0; step < STEPS; step++)
+    {
+        if (setjmp (power_loss))
+        {
+            reboot (recovery_fail);
+
+            if (! check_chunks ("recovery", fail_at))
+            {
+                return 0;
+            }
+
+            memcpy (committed, actual, EEPROM_SIZE);
+            continue;
+        }
+
+        workload_step ();
+    }
+
+    reboot (0);
+
+    if (memcmp (actual, committed, EEPROM_SIZE) != 0)
+    {
+        printf ("final: power loss at operation %u: data differs\n", fail_at);
+        n_errors++;
+    }
+
+    return nor_ops;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * import of old 1:1 image in sectors 0..3, power loss during the first flush of the log
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+run_import (uint32_t fail_at)
+{
+    uint32_t    i;
+
+    memset (nor, 0xFF, sizeof (nor));
+    workload_rand = 2;
+
+    for (i = 0; i < EEPROM_SIZE; i++)                                       // old image, partly unused
+    {
+        committed[i] = (i % 4096 < 3000) ? next_rand (&workload_rand) : 0xFF;
+    }
+
+    memcpy (nor, committed, EEPROM_SIZE);
+    memcpy (pending, committed, EEPROM_SIZE);
+    nor_ops     = 0;
+    nor_fail_at = 0;
+    nor_rand    = fail_at;
+    n_runs++;
+
+    flash_init ();
+    nor_fail_at = fail_at;
+
+    if (setjmp (power_loss) == 0)
+    {
+        flash_flush (1);
+    }
+
+    reboot (0);
+
+    if (memcmp (actual, committed, EEPROM_SIZE) != 0)
+    {
+        printf ("import: power loss at operation %u: data differs\n", fail_at);
+        n_errors++;
+    }
+}
+
+int
+main (void)
+{
+    uint32_t    total;
+    uint32_t    fail_at;
+
+    total = run_workload (0, 0);
+
+    for (fail_at = 1; fail_at <= total; fail_at++)
+    {
+        run_workload (fail_at, 0);
+        run_workload (fail_at, 1 + fail_at % 5);
+    }
+
+    memset (nor, 0xFF, sizeof (nor));
+    run_import (0);
+    total = nor_ops;
+
+    for (fail_at = 1; fail_at <= total; fail_at++)
+    {
+        run_import (fail_at);
+    }
+
+    printf ("flash-test: %u runs with power loss, %u errors\n", n_runs, n_errors);
+    return n_errors ? 1 : 0;
+}
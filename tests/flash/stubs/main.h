@@ -0,0 +1,12 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * main.h - host test stub
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef MAIN_H
+#define MAIN_H
+
+#include <stdint.h>
+
+extern volatile uint32_t            uptime;
+
+#endif
@@ -0,0 +1,15 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * w25qxx.h - host test stub, implemented by simulated NOR flash in flash-test.c
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef W25QXX_H
+#define W25QXX_H
+
+#include <stdint.h>
+
+extern void             w25qxx_init (void);
+extern void             w25qxx_read_page (uint8_t *, uint32_t, uint32_t);
+extern void             w25qxx_write_page (uint8_t *, uint32_t, uint32_t);
+extern void             w25qxx_erase_sector (uint32_t);
+
+#endif
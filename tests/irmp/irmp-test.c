@@ -0,0 +1,508 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * irmp-test.c - replay IR captures through IRMP and remote-ir
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * src/irmp/irmp.c is included here to drive its fake pin IRMP_PIN of the ANALYZE build. The captures in captures/
+ * (binary LIRC mode2, see make-captures.c) are converted into F_INTERRUPTS ticks, irmp_ISR() is called for
+ * every tick and irmp_get_data() after every decoded frame, as the main loop does.
+ *
+ * Tests:
+ *  - every capture is decoded without missed or wrong frames
+ *  - decode rate with random jitter of every edge and with glitches (short inverted samples) injected
+ *  - false positives: frames decoded from random pulse trains, per hour of simulated time
+ *  - remote-ir: learned codes are read from a simulated EEPROM, remote_ir_get_cmd() must deliver the commands
+ *    of the NEC capture, held keys according to the repeat acceleration curve
+ *  - time per irmp_ISR() call on the host, to compare F_INTERRUPTS and protocol configurations
+ *
+ * Example: make F_INTERRUPTS=10000, the limits of the distorted captures are set for the default of 15000
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define main irmp_analyze_main                                              // main() of ANALYZE build is not used
+#include "irmp.c"
+#undef main
+
+#include <time.h>
+#include "remote-ir.h"
+#include "eep.h"
+#include "eeprom-data.h"
+
+#define LIRC_PULSE                  0x01000000
+#define LIRC_VALUE_MASK             0x00FFFFFF
+#define MAX_FRAMES                  256
+
+#define FALSE_POSITIVE_SECONDS      3600                                    // simulated time of random pulse trains
+#define MAX_FALSE_POSITIVES         10                                      // per hour
+
+typedef struct
+{
+    const char *    name;
+    uint32_t *      words;
+    size_t          n_words;
+    IRMP_DATA       expected[MAX_FRAMES];
+    int             n_expected;
+} CAPTURE;
+
+typedef struct
+{
+    long            expected;
+    long            ok;
+    long            wrong;
+    long            missed;
+} RESULT;
+
+static const char *         capture_names[] =
+{
+    "nec",                                                                  // must be first, see test_remote_ir()
+    "samsung32",
+    "sircs",
+    "kaseikyo",
+};
+
+#define N_CAPTURES          (sizeof (capture_names) / sizeof (capture_names[0]))
+
+static CAPTURE              captures[N_CAPTURES];
+
+static IRMP_DATA            decoded[MAX_FRAMES];
+static int                  n_decoded;
+static uint8_t              decoded_cmds[MAX_FRAMES];
+static int                  n_decoded_cmds;
+static int                  use_remote_ir;                                  // poll remote_ir_get_cmd() instead of irmp_get_data()
+static uint64_t             tick_frac;
+static uint32_t             rand_state = 1;
+static long                 isr_calls;
+static double               isr_nsec;
+static int                  n_errors;
+
+static uint8_t              eeprom[EEPROM_DATA_OFFSET_IR_CODE_CMDS + EEPROM_MAX_IR_CODES];
+uint_fast8_t                eep_is_up = 1;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * stubs of remote-ir.c
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+uint_fast8_t
+eep_read (uint32_t addr, uint8_t * buf, uint32_t cnt)
+{
+    memcpy (buf, eeprom + addr, cnt);
+    return 1;
+}
+
+uint_fast8_t
+eep_write (uint32_t addr, uint8_t * buf, uint32_t cnt)
+{
+    memcpy (eeprom + addr, buf, cnt);
+    return 1;
+}
+
+void
+display_set_ticker (const unsigned char * text, uint_fast8_t do_wait)
+{
+    (void) text;
+    (void) do_wait;
+}
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * load capture and its expected frames
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+load_capture (CAPTURE * c)
+{
+    char        fname[64];
+    char        line[128];
+    uint8_t     buf[4];
+    size_t      size = 0;
+    FILE *      fp;
+    unsigned    protocol;
+    unsigned    address;
+    unsigned    command;
+    unsigned    flags;
+
+    snprintf (fname, sizeof (fname), "captures/%s.bin", c->name);
+
+    if (! (fp = fopen (fname, "rb")))
+    {
+        perror (fname);
+        exit (1);
+    }
+
+    while (fread (buf, 1, 4, fp) == 4)
+    {
+        if (c->n_words == size)
+        {
+            size = size ? 2 * size : 1024;
+            c->words = realloc (c->words, size * sizeof (uint32_t));
+        }
+
+        c->words[c->n_words++] = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t) buf[3] << 24);
+    }
+
+    fclose (fp);
+
+    snprintf (fname, sizeof (fname), "captures/%s.txt", c->name);
+
+    if (! (fp = fopen (fname, "r")))
+    {
+        perror (fname);
+        exit (1);
+    }
+
+    while (fgets (line, sizeof (line), fp) && c->n_expected < MAX_FRAMES)
+    {
+        if (sscanf (line, "%u %x %x %u", &protocol, &address, &command, &flags) == 4)
+        {
+            c->expected[c->n_expected].protocol = protocol;
+            c->expected[c->n_expected].address  = address;
+            c->expected[c->n_expected].command  = command;
+            c->expected[c->n_expected].flags    = flags;
+            c->n_expected++;
+        }
+    }
+
+    fclose (fp);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * fetch decoded frame like the main loop
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+poll_frame (void)
+{
+    IRMP_DATA       irmp_data;
+    uint_fast8_t    cmd;
+
+    if (use_remote_ir)
+    {
+        cmd = remote_ir_get_cmd ();
+
+        if (cmd != REMOTE_IR_CMD_INVALID && n_decoded_cmds < MAX_FRAMES)
+        {
+            decoded_cmds[n_decoded_cmds++] = cmd;
+        }
+    }
+    else if (irmp_get_data (&irmp_data) && n_decoded < MAX_FRAMES)
+    {
+        decoded[n_decoded++] = irmp_data;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * replay a pulse (TSOP output low) or a space (high) of usec
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+replay (uint_fast8_t is_pulse, uint32_t usec)
+{
+    struct timespec start;
+    struct timespec stop;
+    uint32_t        n;
+
+    tick_frac  += (uint64_t) usec * F_INTERRUPTS;
+    n           = tick_frac / 1000000;
+    tick_frac  -= (uint64_t) n * 1000000;
+    IRMP_PIN    = is_pulse ? 0x00 : 0xFF;
+
+    while (n > 0)
+    {
+        clock_gettime (CLOCK_MONOTONIC, &start);
+
+        while (n > 0 && ! irmp_ir_detected)
+        {
+            (void) irmp_ISR ();
+            isr_calls++;
+            n--;
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &stop);
+        isr_nsec += (stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec);
+
+        poll_frame ();
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * replay capture, every edge shifted by up to +/- jitter usec, with a glitch of 20..150 usec in a pulse or space
+ * with a probability of glitch/1000
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+replay_capture (CAPTURE * c, uint32_t jitter, uint32_t glitch)
+{
+    int32_t         shift = 0;
+    int32_t         new_shift;
+    int32_t         duration;
+    uint32_t        usec;
+    uint32_t        pos;
+    uint32_t        len;
+    uint_fast8_t    is_pulse;
+    size_t          i;
+
+    n_decoded       = 0;
+    n_decoded_cmds  = 0;
+
+    for (i = 0; i < c->n_words; i++)
+    {
+        is_pulse    = (c->words[i] & LIRC_PULSE) ? 1 : 0;
+        new_shift   = jitter ? (int32_t) (next_rand () % (2 * jitter + 1)) - (int32_t) jitter : 0;
+        duration    = (int32_t) (c->words[i] & LIRC_VALUE_MASK) - shift + new_shift;  // both edges shifted
+        usec        = duration > 1 ? duration : 1;
+        shift       = new_shift;
+
+        if (glitch && next_rand () % 1000 < glitch && usec > 400)
+        {
+            len = 20 + next_rand () % 131;
+            pos = next_rand () % (usec - len);
+            replay (is_pulse, pos);
+            replay (! is_pulse, len);
+            replay (is_pulse, usec - pos - len);
+        }
+        else
+        {
+            replay (is_pulse, usec);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * compare decoded frames with expected frames in order, a decoded frame which is not expected any more is wrong
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+compare_frames (CAPTURE * c, RESULT * r)
+{
+    IRMP_DATA *     e;
+    IRMP_DATA *     d;
+    int             pos = 0;
+    int             i;
+    int             k;
+
+    r->expected += c->n_expected;
+
+    for (i = 0; i < n_decoded; i++)
+    {
+        d = &decoded[i];
+
+        for (k = pos; k < c->n_expected; k++)                                   // skip missed frames
+        {
+            e = &c->expected[k];
+
+            if (d->protocol == e->protocol && d->address == e->address && d->command == e->command && d->flags == e->flags)
+            {
+                break;
+            }
+        }
+
+        if (k < c->n_expected)
+        {
+            r->missed  += k - pos;
+            r->ok++;
+            pos = k + 1;
+        }
+        else
+        {
+            r->wrong++;
+        }
+    }
+
+    r->missed += c->n_expected - pos;
+}
+
+static void
+print_result (const char * what, RESULT * r)
+{
+    printf ("  %-10s %6ld frames, %5.1f%% ok, %5.1f%% missed, %5.1f%% wrong\n", what, r->expected,
+            100.0 * r->ok / r->expected, 100.0 * r->missed / r->expected, 100.0 * r->wrong / r->expected);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * every capture must be decoded exactly
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+test_clean (void)
+{
+    RESULT          r;
+    size_t          i;
+
+    puts ("clean captures:");
+
+    for (i = 0; i < N_CAPTURES; i++)
+    {
+        memset (&r, 0, sizeof (r));
+        replay_capture (&captures[i], 0, 0);
+        compare_frames (&captures[i], &r);
+        print_result (captures[i].name, &r);
+
+        if (r.ok != r.expected || r.wrong)
+        {
+            n_errors++;
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * decode rate with jitter and glitches, 20 rounds of every capture, limits apply to sum of all captures
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+test_distorted (const char * what, uint32_t jitter, uint32_t glitch, double min_ok_percent, double max_wrong_percent)
+{
+    RESULT          r;
+    RESULT          sum;
+    size_t          i;
+    int             round;
+
+    printf ("%s, 20 rounds:\n", what);
+    memset (&sum, 0, sizeof (sum));
+
+    for (i = 0; i < N_CAPTURES; i++)
+    {
+        memset (&r, 0, sizeof (r));
+
+        for (round = 0; round < 20; round++)
+        {
+            replay_capture (&captures[i], jitter, glitch);
+            compare_frames (&captures[i], &r);
+        }
+
+        print_result (captures[i].name, &r);
+        sum.expected    += r.expected;
+        sum.ok          += r.ok;
+        sum.missed      += r.missed;
+        sum.wrong       += r.wrong;
+    }
+
+    print_result ("all", &sum);
+
+    if (100.0 * sum.ok / sum.expected < min_ok_percent || 100.0 * sum.wrong / sum.expected > max_wrong_percent)
+    {
+        n_errors++;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * false positives: random pulses and spaces of 50 usec ... 30 msec, bursts like fluorescent lamps or sunlight flicker
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+test_false_positives (void)
+{
+    uint64_t        usec = 0;
+    uint32_t        len;
+    uint_fast8_t    is_pulse = 0;
+
+    n_decoded = 0;
+
+    while (usec < (uint64_t) FALSE_POSITIVE_SECONDS * 1000000)
+    {
+        switch (next_rand () % 4)
+        {
+            case 0:  len = 50 + next_rand () % 500;     break;                  // short glitches
+            case 1:  len = 400 + next_rand () % 2000;   break;                  // bit lengths of most protocols
+            case 2:  len = 2000 + next_rand () % 8000;  break;                  // start bit lengths
+            default: len = next_rand () % 30000;        break;                  // pauses
+        }
+
+        replay (is_pulse, len);
+        is_pulse = ! is_pulse;
+        usec += len;
+    }
+
+    printf ("false positives: %d frames in %d sec of random pulse trains\n", n_decoded, FALSE_POSITIVE_SECONDS);
+
+    if (n_decoded * 3600 / FALSE_POSITIVE_SECONDS > MAX_FALSE_POSITIVES)
+    {
+        n_errors++;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * remote-ir: keys 0x40 ... 0x53 of NEC capture are learned as commands 0 ... 19, then key 0x51 (increment brightness) is held
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+test_remote_ir (void)
+{
+    static const uint8_t    repeat_steps[] = { 4, 7, 10, 12, 14, 16, 18, 20, 22, 24, 25, 26, 27, 28, 29, 30 };
+    uint8_t                 expected[MAX_FRAMES];
+    int                     n_expected = 0;
+    uint8_t *               p;
+    int                     i;
+
+    memset (eeprom, 0xFF, sizeof (eeprom));
+
+    for (i = 0; i < N_REMOTE_IR_CMDS; i++)
+    {
+        p    = eeprom + EEPROM_DATA_OFFSET_IRMP_DATA + i * PACKED_IRMP_DATA_SIZE;
+        p[0] = IRMP_NEC_PROTOCOL;
+        p[1] = 0x00;
+        p[2] = 0xFF;
+        p[3] = 0x40 + i;
+        p[4] = 0x00;
+        expected[n_expected++] = i;
+    }
+
+    expected[n_expected++] = 0x51 - 0x40;                                       // first frame of held key
+
+    for (i = 0; i < (int) sizeof (repeat_steps); i++)                           // repetition frames 1 ... 30
+    {
+        expected[n_expected++] = 0x51 - 0x40;
+    }
+
+    remote_ir_read_codes_from_eep (EEPROM_VERSION_3_0);
+
+    use_remote_ir = 1;
+    replay_capture (&captures[0], 0, 0);
+    use_remote_ir = 0;
+
+    printf ("remote-ir: %d commands, %d expected\n", n_decoded_cmds, n_expected);
+
+    if (n_decoded_cmds != n_expected || memcmp (decoded_cmds, expected, n_expected) != 0)
+    {
+        n_errors++;
+    }
+}
+
+int
+main (void)
+{
+    size_t      i;
+
+    silent = TRUE;
+
+    for (i = 0; i < N_CAPTURES; i++)
+    {
+        captures[i].name = capture_names[i];
+        load_capture (&captures[i]);
+    }
+
+    printf ("F_INTERRUPTS: %d\n", F_INTERRUPTS);
+    test_clean ();
+
+    test_distorted ("jitter +/- 25 usec",                  25,  0, 99.0, 0.0);
+    test_distorted ("jitter +/- 50 usec",                  50,  0, 95.0, 0.5);
+    test_distorted ("jitter +/- 100 usec",                100,  0, 80.0, 0.5);
+    test_distorted ("glitches 10/1000",                     0, 10, 45.0, 1.0);
+    test_distorted ("jitter +/- 25 usec, glitches 10/1000", 25, 10, 45.0, 1.0);
+
+    test_false_positives ();
+    test_remote_ir ();
+
+    printf ("irmp_ISR(): %ld calls, %.1f nsec per call\n", isr_calls, isr_calls ? isr_nsec / isr_calls : 0.0);
+    printf ("irmp-test: %d errors\n", n_errors);
+    return n_errors ? 1 : 0;
+}
@@ -0,0 +1,273 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * make-captures.c - write IR captures for irmp-test
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * Writes one capture per enabled protocol in the binary LIRC mode2 format, as read from /dev/lirc0 of a Linux IR receiver:
+ * little endian 32 bit words, bit 24 set for a pulse, clear for a space, duration in usec in bits 0..23.
+ * A second file <name>.txt lists the expected frames: protocol address command flags.
+ *
+ * The captures imitate a TSOP receiver: pulses are stretched by TSOP_STRETCH usec, pauses shortened by the same
+ * time, every duration jitters by up to +/- TSOP_JITTER usec. Real recordings of /dev/lirc0 can be put into
+ * captures/ the same way, together with their expected frames.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LIRC_PULSE                  0x01000000
+#define TSOP_STRETCH                60                      // usec
+#define TSOP_JITTER                 40                      // usec
+#define KEY_GAP                     300000                  // usec between two keys
+
+static FILE *                       bin_fp;
+static FILE *                       txt_fp;
+static uint32_t                     rand_state = 1;
+static uint32_t                     frame_usec;             // duration of current frame
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static void
+put_word (uint32_t w)
+{
+    uint8_t     buf[4];
+
+    buf[0] = w;
+    buf[1] = w >> 8;
+    buf[2] = w >> 16;
+    buf[3] = w >> 24;
+    fwrite (buf, 1, 4, bin_fp);
+}
+
+static void
+pulse (uint32_t usec)
+{
+    frame_usec += usec;
+    put_word (LIRC_PULSE | (usec + TSOP_STRETCH + next_rand () % (2 * TSOP_JITTER + 1) - TSOP_JITTER));
+}
+
+static void
+space (uint32_t usec)
+{
+    frame_usec += usec;
+    put_word (usec - TSOP_STRETCH + next_rand () % (2 * TSOP_JITTER + 1) - TSOP_JITTER);
+}
+
+static void
+expect (int protocol, uint32_t address, uint32_t command, int flags)
+{
+    fprintf (txt_fp, "%d 0x%04x 0x%04x %d\n", protocol, address, command, flags);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * pulse distance coding, LSB first
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+pulse_distance (uint64_t value, int bits, uint32_t bit_pulse, uint32_t pause0, uint32_t pause1)
+{
+    int     i;
+
+    for (i = 0; i < bits; i++)
+    {
+        pulse (bit_pulse);
+        space ((value >> i) & 1 ? pause1 : pause0);
+    }
+}
+
+static void
+start_file (const char * name)
+{
+    char    fname[64];
+
+    snprintf (fname, sizeof (fname), "captures/%s.bin", name);
+    bin_fp = fopen (fname, "wb");
+    snprintf (fname, sizeof (fname), "captures/%s.txt", name);
+    txt_fp = fopen (fname, "w");
+
+    if (! bin_fp || ! txt_fp)
+    {
+        perror (fname);
+        exit (1);
+    }
+
+    fprintf (txt_fp, "# protocol address command flags of %s.bin\n", name);
+    space (KEY_GAP);
+}
+
+static void
+end_file (void)
+{
+    fclose (bin_fp);
+    fclose (txt_fp);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * NEC: 20 keys of a remote with address 0x00, then one key held for 30 repetition frames (every 108 msec)
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+make_nec (void)
+{
+    uint32_t    cmd;
+    int         i;
+
+    start_file ("nec");
+
+    for (cmd = 0x40; cmd < 0x40 + 20; cmd++)
+    {
+        pulse (9000);
+        space (4500);
+        pulse_distance (0x00 | (0xFF << 8) | (cmd << 16) | ((~cmd & 0xFF) << 24), 32, 560, 560, 1690);
+        pulse (560);
+        space (KEY_GAP);
+        expect (2, 0xFF00, cmd, 0);
+    }
+
+    frame_usec = 0;
+    pulse (9000);
+    space (4500);
+    pulse_distance (0x00 | (0xFF << 8) | (0x51 << 16) | (0xAE << 24), 32, 560, 560, 1690);
+    pulse (560);
+    space (108000 - frame_usec);
+    expect (2, 0xFF00, 0x51, 0);
+
+    for (i = 0; i < 30; i++)
+    {
+        frame_usec = 0;
+        pulse (9000);
+        space (2250);
+        pulse (560);
+        space (108000 - frame_usec);
+        expect (2, 0xFF00, 0x51, 1);
+    }
+
+    space (KEY_GAP);
+    end_file ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * Samsung32: 8 keys of custom code 0x0707
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+make_samsung32 (void)
+{
+    uint32_t    cmd;
+
+    start_file ("samsung32");
+
+    for (cmd = 0x02; cmd < 0x02 + 8; cmd++)
+    {
+        pulse (4500);
+        space (4500);
+        pulse_distance (0x0707 | (cmd << 16) | ((~cmd & 0xFF) << 24), 32, 550, 550, 1650);
+        pulse (550);
+        space (KEY_GAP);
+        expect (10, 0x0707, cmd | ((~cmd & 0xFF) << 8), 0);
+    }
+
+    end_file ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * SIRCS 12 bit: 7 bit command, 5 bit address, pulse width coding, every key sends 3 frames in a distance of 45 msec.
+ * IRMP returns all 12 bits as command and skips the 2 automatic repetition frames.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+make_sircs (void)
+{
+    uint32_t    cmd;
+    uint32_t    value;
+    int         frame;
+    int         i;
+
+    start_file ("sircs");
+
+    for (cmd = 0x10; cmd < 0x10 + 8; cmd++)
+    {
+        value = cmd | (0x01 << 7);
+
+        for (frame = 0; frame < 3; frame++)
+        {
+            frame_usec = 0;
+            pulse (2400);
+
+            for (i = 0; i < 12; i++)
+            {
+                space (600);
+                pulse ((value >> i) & 1 ? 1200 : 600);
+            }
+
+            space (frame < 2 ? 45000 - frame_usec : KEY_GAP);
+        }
+
+        expect (1, 0x0000, value, 0);
+    }
+
+    end_file ();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * Kaseikyo (Panasonic): manufacturer 0x2002, parity nibble, genre, 10 bit command and 2 bit id, checksum byte
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+make_kaseikyo (void)
+{
+    uint64_t    value;
+    uint32_t    cmd;
+    uint8_t     b[6];
+    int         i;
+
+    start_file ("kaseikyo");
+
+    for (cmd = 0x20; cmd < 0x20 + 8; cmd++)
+    {
+        b[0] = 0x02;                                                        // manufacturer 0x2002, LSB first
+        b[1] = 0x20;
+        b[2] = ((b[0] ^ b[1]) & 0x0F) ^ ((b[0] ^ b[1]) >> 4);               // parity nibble, genre1 = 0
+        b[3] = (cmd & 0x0F) << 4;                                           // genre2 = 0, command bits 0..3
+        b[4] = cmd >> 4;                                                    // command bits 4..9, id = 0
+        b[5] = b[2] ^ b[3] ^ b[4];
+
+        value = 0;
+
+        for (i = 5; i >= 0; i--)
+        {
+            value = (value << 8) | b[i];
+        }
+
+        pulse (3456);
+        space (1728);
+        pulse_distance (value, 48, 432, 432, 1296);
+        pulse (432);
+        space (KEY_GAP);
+        expect (5, 0x2002, cmd, 0);
+    }
+
+    end_file ();
+}
+
+int
+main (void)
+{
+    make_nec ();
+    make_samsung32 ();
+    make_sircs ();
+    make_kaseikyo ();
+    return 0;
+}
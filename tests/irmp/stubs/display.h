@@ -0,0 +1,12 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * display.h - host test stub, implemented in irmp-test.c
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+
+extern void             display_set_ticker (const unsigned char *, uint_fast8_t);
+
+#endif
@@ -0,0 +1,14 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * eep.h - host test stub, simulated EEPROM in irmp-test.c
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef EEP_H
+#define EEP_H
+
+#include <stdint.h>
+
+extern uint_fast8_t     eep_is_up;
+extern uint_fast8_t     eep_read (uint32_t, uint8_t *, uint32_t);
+extern uint_fast8_t     eep_write (uint32_t, uint8_t *, uint32_t);
+
+#endif
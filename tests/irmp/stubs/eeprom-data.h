@@ -0,0 +1,14 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * eeprom-data.h - host test stub, only IR codes
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef EEPROM_DATA_H
+#define EEPROM_DATA_H
+
+#define EEPROM_VERSION_3_0                          0x00030000
+#define PACKED_IRMP_DATA_SIZE                       5
+#define EEPROM_MAX_IR_CODES                         32
+#define EEPROM_DATA_OFFSET_IRMP_DATA                0
+#define EEPROM_DATA_OFFSET_IR_CODE_CMDS             (EEPROM_MAX_IR_CODES * PACKED_IRMP_DATA_SIZE)
+
+#endif
@@ -0,0 +1,11 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log.h - host test stub
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#define log_message(s)
+#define log_printf(...)
+
+#endif
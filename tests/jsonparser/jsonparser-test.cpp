@@ -0,0 +1,672 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * jsonparser-test.cpp - decoding, fuzzing and benchmark of the JSON tokenizer in ESP8266/ESP-uclock/jsonparser.cpp
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * decode:      single strings with all escapes, \u surrogate pairs, lone surrogates, nesting limit
+ * captures:    the responses in captures/ are parsed with the paths of weather.cpp, the picked values are compared
+ * fuzz:        random valid documents are generated together with the expected values and paths, every callback is checked
+ *              against them. Then the documents are mutated (flipped, deleted, inserted characters, cut) and random bytes are
+ *              fed: the tokenizer must neither crash nor overrun its buffers, and DONE or ERROR must be final.
+ * benchmark:   time per document of the captures, and how far weather.cpp has to read until all values are found
+ *
+ * Build with SANITIZE=-fsanitize=address,undefined to check the fuzz runs for buffer overruns, too.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "jsonparser.h"
+
+#define FUZZ_DOCS                   20000                   // random valid documents
+#define FUZZ_MUTATIONS              10                      // mutated variants per document
+#define FUZZ_RANDOM                 20000                   // documents of random bytes
+#define BENCH_RUNS                  2000                    // parses per capture in benchmark
+#define MAX_DOC                     65536
+#define MAX_EVENTS                  4096
+#define MAX_PATH                    160
+
+#define WEATHER_FC_IDX              8                       // like weather.cpp: forecast record 8 is current weather + 24h
+
+static uint32_t                     rand_state = 1;
+static uint32_t                     n_errors;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * random numbers, own generator for reproducible runs
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static int
+feed_string (JSON_PARSER * p, const char * s, size_t len)
+{
+    int         rtc = JSON_CONTINUE;
+    size_t      i;
+
+    for (i = 0; i < len && rtc == JSON_CONTINUE; i++)
+    {
+        rtc = json_feed (p, (unsigned char) s[i]);
+    }
+    return rtc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * decode: one string or value, compare the decoded bytes
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+typedef struct
+{
+    const char *                    json;
+    int                             rtc;                    // expected return value
+    const char *                    value;                  // expected value of last callback, NULL: don't care
+} DECODE_CASE;
+
+static const DECODE_CASE            decode_cases[] =
+{
+    { "\"abc\"",                                JSON_DONE,  "abc" },
+    { "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"",         JSON_DONE,  "\"\\/\b\f\n\r\t" },
+    { "\"a\\u00fcb\"",                          JSON_DONE,  "a\xc3\xbc" "b" },
+    { "\"\\u0041\\u007F\\u0080\\u07FF\"",       JSON_DONE,  "A\x7f\xc2\x80\xdf\xbf" },
+    { "\"\\u20ac \\uFFFF\"",                    JSON_DONE,  "\xe2\x82\xac \xef\xbf\xbf" },
+    { "\"\\uD83D\\uDE00\"",                     JSON_DONE,  "\xf0\x9f\x98\x80" },               // U+1F600
+    { "\"\\ud800\\udc00\"",                     JSON_DONE,  "\xf0\x90\x80\x80" },               // U+10000
+    { "\"\\uDBFF\\uDFFF\"",                     JSON_DONE,  "\xf4\x8f\xbf\xbf" },               // U+10FFFF
+    { "\"x\\uD83D\\uDE00y\\uD83D\\uDE01\"",     JSON_DONE,  "x\xf0\x9f\x98\x80y\xf0\x9f\x98\x81" },
+    { "\"\\uD83D\"",                            JSON_DONE,  "?" },                              // lone high surrogate
+    { "\"\\uD83Dx\"",                           JSON_DONE,  "?x" },
+    { "\"\\uD83D\\n\"",                         JSON_DONE,  "?\n" },
+    { "\"\\uD83D\\u0041\"",                     JSON_DONE,  "?A" },
+    { "\"\\uD83D\\uD83D\\uDE00\"",              JSON_DONE,  "?\xf0\x9f\x98\x80" },
+    { "\"\\uDE00\"",                            JSON_DONE,  "?" },                              // lone low surrogate
+    { "\"\\uDE00\\uD83D\"",                     JSON_DONE,  "??" },
+    { "{\"k\\uD83D\":1}",                       JSON_DONE,  "1" },                              // surrogate in key
+    { "\"\\u12G4\"",                            JSON_ERROR, NULL },
+    { "-12.5e3 ",                               JSON_DONE,  "-12.5e3" },
+    { "[true,false,null]",                      JSON_DONE,  "null" },
+    { "[tru]",                                  JSON_ERROR, NULL },
+    { "{\"a\" 1}",                              JSON_ERROR, NULL },
+    { "{\"a\":1,}",                             JSON_ERROR, NULL },
+    { "[1}",                                    JSON_ERROR, NULL },
+    { "{\"a\":[1,2]]",                          JSON_ERROR, NULL },
+    { "[1,2 ",                                  JSON_CONTINUE, "2" },
+};
+
+static char                         last_value[JSON_MAX_VALUE_LEN + 1];
+
+static void
+decode_callback (JSON_PARSER * p, const char * value, uint_fast8_t type)
+{
+    (void) p;
+    (void) type;
+    strcpy (last_value, value);
+}
+
+static void
+test_decode (void)
+{
+    JSON_PARSER     p;
+    char            nest[2 * JSON_MAX_NESTING + 4];
+    uint32_t        i;
+    int             rtc;
+
+    for (i = 0; i < sizeof (decode_cases) / sizeof (decode_cases[0]); i++)
+    {
+        const DECODE_CASE * c = decode_cases + i;
+
+        last_value[0] = '\0';
+        json_init (&p, decode_callback, NULL);
+        rtc = feed_string (&p, c->json, strlen (c->json));
+
+        if (rtc != c->rtc || (c->value && strcmp (last_value, c->value)))
+        {
+            printf ("jsonparser-test: decode %s: return %d value \"%s\", expected %d \"%s\"\n", c->json, rtc, last_value,
+                    c->rtc, c->value ? c->value : "");
+            n_errors++;
+        }
+    }
+
+    for (i = JSON_MAX_NESTING; i <= JSON_MAX_NESTING + 1; i++)                     // nesting limit
+    {
+        memset (nest, '[', i);
+        memset (nest + i, ']', i);
+        json_init (&p, NULL, NULL);
+        rtc = feed_string (&p, nest, 2 * i);
+
+        if (rtc != (i <= JSON_MAX_NESTING ? JSON_DONE : JSON_ERROR))
+        {
+            printf ("jsonparser-test: nesting %u: return %d\n", i, rtc);
+            n_errors++;
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * captures: pick the values like weather_json_callback() in weather.cpp
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+typedef struct
+{
+    const char *                    name;
+    int                             fc_idx;                 // -1: current weather
+    const char *                    cod;
+    const char *                    temp;                   // NULL: not in response
+    const char *                    description;
+    const char *                    icon;
+} CAPTURE;
+
+static const CAPTURE                captures[] =
+{
+    { "current.json",           -1,             "200", "12.57", "\xc3\xbc" "berwiegend bew\xc3\xb6lkt", "04d" },
+    { "current-escaped.json",   -1,             "200", "12.57", "\xc3\xbc" "berwiegend bew\xc3\xb6lkt", "04d" },
+    { "forecast.json",          WEATHER_FC_IDX, "200", "-2.18", "Leichter Regen 8",                         "08n" },
+    { "error-401.json",         -1,             "401", NULL,    NULL,                                       NULL },
+};
+
+typedef struct
+{
+    int                             fc_idx;
+    uint8_t                         found;                  // bit 0: cod, 1: temp, 2: description, 3: icon
+    char                            values[4][JSON_MAX_VALUE_LEN + 1];
+} WEATHER;
+
+static void
+weather_callback (JSON_PARSER * p, const char * value, uint_fast8_t type)
+{
+    WEATHER *   w = (WEATHER *) p->data;
+    int         i = -1;
+
+    (void) type;
+
+    if (json_match (p, "cod"))
+    {
+        i = 0;
+    }
+    else if (w->fc_idx < 0)
+    {
+        if (json_match (p, "main.temp"))                        i = 1;
+        else if (json_match (p, "weather[0].description"))      i = 2;
+        else if (json_match (p, "weather[0].icon"))             i = 3;
+    }
+    else if (p->depth > 1 && p->idx[1] == w->fc_idx)
+    {
+        if (json_match (p, "list[*].main.temp"))                i = 1;
+        else if (json_match (p, "list[*].weather[0].description")) i = 2;
+        else if (json_match (p, "list[*].weather[0].icon"))     i = 3;
+    }
+
+    if (i >= 0)
+    {
+        strcpy (w->values[i], value);
+        w->found |= 1 << i;
+    }
+}
+
+static size_t
+read_capture (const char * name, char * buf)
+{
+    char        fname[64];
+    FILE *      fp;
+    size_t      len;
+
+    snprintf (fname, sizeof (fname), "captures/%s", name);
+    fp = fopen (fname, "rb");
+
+    if (! fp)
+    {
+        perror (fname);
+        exit (1);
+    }
+
+    len = fread (buf, 1, MAX_DOC, fp);
+    fclose (fp);
+    return len;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * parse capture like weather.cpp, stop when all values are found, return number of bytes read
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static size_t
+weather_parse (const char * buf, size_t len, int fc_idx, WEATHER * w)
+{
+    JSON_PARSER     p;
+    size_t          i;
+
+    memset (w, 0, sizeof (WEATHER));
+    w->fc_idx = fc_idx;
+    json_init (&p, weather_callback, w);
+
+    for (i = 0; i < len && w->found != 0x0F; i++)
+    {
+        if (json_feed (&p, (unsigned char) buf[i]) != JSON_CONTINUE)
+        {
+            i++;
+            break;
+        }
+    }
+    return i;
+}
+
+static void
+test_captures (void)
+{
+    static char     buf[MAX_DOC];
+    WEATHER         w;
+    JSON_PARSER     p;
+    struct timespec start;
+    struct timespec end;
+    size_t          len;
+    size_t          used;
+    double          usec;
+    uint32_t        i;
+    uint32_t        r;
+    uint32_t        v;
+
+    for (i = 0; i < sizeof (captures) / sizeof (captures[0]); i++)
+    {
+        const CAPTURE * c = captures + i;
+        const char *    expected[4] = { c->cod, c->temp, c->description, c->icon };
+
+        len     = read_capture (c->name, buf);
+        used    = weather_parse (buf, len, c->fc_idx, &w);
+
+        for (v = 0; v < 4; v++)
+        {
+            if (expected[v] ? (! (w.found & (1 << v)) || strcmp (w.values[v], expected[v])) : (w.found & (1 << v)))
+            {
+                printf ("jsonparser-test: %s: value %u is \"%s\", expected \"%s\"\n", c->name, v,
+                        (w.found & (1 << v)) ? w.values[v] : "(none)", expected[v] ? expected[v] : "(none)");
+                n_errors++;
+            }
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+
+        for (r = 0; r < BENCH_RUNS; r++)
+        {
+            json_init (&p, NULL, NULL);
+
+            if (feed_string (&p, buf, len) != JSON_DONE)
+            {
+                printf ("jsonparser-test: %s: not a complete document\n", c->name);
+                n_errors++;
+                break;
+            }
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        usec = ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3) / BENCH_RUNS;
+
+        printf ("jsonparser-test: %-20s %5zu bytes, %7.1f usec/doc, %6.1f MB/s, all values after %5zu bytes\n",
+                c->name, len, usec, len / usec, used);
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * fuzz: random documents with expected values
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+typedef struct
+{
+    char                            path[MAX_PATH];         // pattern for json_match(), "" if not representable
+    char                            value[JSON_MAX_VALUE_LEN + 1];
+    uint8_t                         type;
+} EVENT;
+
+static char                         doc[MAX_DOC];
+static size_t                       doc_len;
+static EVENT                        events[MAX_EVENTS];
+static uint32_t                     n_events;
+static uint32_t                     event_idx;
+static uint32_t                     fuzz_errors;
+
+static void
+put (const char * s)
+{
+    size_t len = strlen (s);
+
+    memcpy (doc + doc_len, s, len);
+    doc_len += len;
+}
+
+static void
+put_space (void)
+{
+    static const char * spaces[] = { "", "", "", " ", "\n", "\t", "\r\n", "  " };
+
+    put (spaces[next_rand () % 8]);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * random string: append JSON text to doc, decoded bytes to decoded
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static size_t
+gen_string (char * decoded, size_t max_decoded)
+{
+    static const struct { const char * json; const char * bytes; } pieces[] =
+    {
+        { "\\\"", "\"" },           { "\\\\", "\\" },       { "\\/", "/" },         { "\\n", "\n" },
+        { "\\t", "\t" },            { "\\u00e9", "\xc3\xa9" },                      { "\\u20AC", "\xe2\x82\xac" },
+        { "\\uD83D\\uDE00", "\xf0\x9f\x98\x80" },           { "\\uDE00", "?" },     { "\\ud83d ", "? " },
+        { "\xc3\xbc", "\xc3\xbc" }, { "x", "x" },
+    };
+    uint32_t    n = next_rand () % 90;
+    size_t      len = 0;
+    uint32_t    i;
+
+    put ("\"");
+
+    for (i = 0; i < n && len + 4 < max_decoded; i++)
+    {
+        uint32_t r = next_rand () % 32;
+
+        if (r < sizeof (pieces) / sizeof (pieces[0]))
+        {
+            put (pieces[r].json);
+            strcpy (decoded + len, pieces[r].bytes);
+            len += strlen (pieces[r].bytes);
+        }
+        else
+        {
+            char ch[2] = { (char) ('a' + next_rand () % 26), '\0' };
+
+            put (ch);
+            decoded[len++] = ch[0];
+        }
+    }
+
+    put ("\"");
+    decoded[len] = '\0';
+    return len;
+}
+
+static void
+add_event (const char * path, const char * value, uint_fast8_t type)
+{
+    if (n_events < MAX_EVENTS)
+    {
+        EVENT * e = events + n_events++;
+
+        strcpy (e->path, path);
+        strncpy (e->value, value, JSON_MAX_VALUE_LEN);                     // tokenizer truncates, too
+        e->value[JSON_MAX_VALUE_LEN] = '\0';
+        e->type = type;
+    }
+}
+
+static void
+gen_value (uint_fast8_t depth, const char * path)
+{
+    static const char * literals[] = { "true", "false", "null", "0", "-1", "12.5", "-0.25e3", "1E+9", "4294967296" };
+    char                decoded[256];
+    char                sub[MAX_PATH];
+    uint32_t            r = next_rand () % 10;
+    uint32_t            n;
+    uint32_t            i;
+
+    if (depth >= 10 || n_events >= MAX_EVENTS - 64 || doc_len > MAX_DOC - 4096)
+    {
+        r = 9;
+    }
+
+    if (r < 2)                                                              // object
+    {
+        n = next_rand () % 6;
+        put ("{");
+
+        for (i = 0; i < n; i++)
+        {
+            char        key[32];
+            uint32_t    key_len = 1 + next_rand () % 18;
+            uint32_t    k;
+
+            for (k = 0; k < key_len; k++)
+            {
+                key[k] = "abcdefghijklmnopqrstuvwxyz_0123456789"[next_rand () % 37];
+            }
+            key[key_len] = '\0';
+
+            if (i > 0)
+            {
+                put (",");
+            }
+
+            put_space ();
+            put ("\"");
+            put (key);
+            put ("\"");
+            put_space ();
+            put (":");
+            put_space ();
+
+            if (! *path && depth > 0)                                       // parent not representable
+            {
+                sub[0] = '\0';
+            }
+            else if (depth >= JSON_MAX_DEPTH || key_len > JSON_MAX_KEY_LEN)
+            {
+                sub[0] = '\0';
+            }
+            else
+            {
+                snprintf (sub, sizeof (sub), "%s%s%s", path, depth ? "." : "", key);
+            }
+
+            gen_value (depth + 1, sub);
+            put_space ();
+        }
+
+        put ("}");
+    }
+    else if (r < 4)                                                         // array
+    {
+        n = next_rand () % 8;
+        put ("[");
+
+        for (i = 0; i < n; i++)
+        {
+            if (i > 0)
+            {
+                put (",");
+            }
+
+            put_space ();
+
+            if ((! *path && depth > 0) || depth >= JSON_MAX_DEPTH)
+            {
+                sub[0] = '\0';
+            }
+            else
+            {
+                snprintf (sub, sizeof (sub), "%s[%u]", path, i);
+            }
+
+            gen_value (depth + 1, sub);
+            put_space ();
+        }
+
+        put ("]");
+    }
+    else if (r < 7)                                                         // string
+    {
+        gen_string (decoded, sizeof (decoded));
+        add_event (path, decoded, JSON_TYPE_STRING);
+    }
+    else                                                                    // number or literal
+    {
+        i = next_rand () % (sizeof (literals) / sizeof (literals[0]));
+        put (literals[i]);
+        add_event (path, literals[i], i < 3 ? JSON_TYPE_LITERAL : JSON_TYPE_NUMBER);
+    }
+}
+
+static void
+fuzz_callback (JSON_PARSER * p, const char * value, uint_fast8_t type)
+{
+    if (strlen (value) > JSON_MAX_VALUE_LEN || p->depth > JSON_MAX_NESTING)
+    {
+        printf ("jsonparser-test: fuzz: value of %zu bytes at depth %u\n", strlen (value), p->depth);
+        fuzz_errors++;
+    }
+
+    if (p->data)                                                            // valid document: compare with expected event
+    {
+        EVENT * e = events + event_idx;
+
+        if (event_idx >= n_events || strcmp (value, e->value) || type != e->type ||
+            (e->path[0] && ! json_match (p, e->path)))
+        {
+            printf ("jsonparser-test: fuzz: event %u: \"%s\" type %u, expected %s = \"%s\" type %u\n", event_idx, value, type,
+                    e->path[0] ? e->path : "(no path)", e->value, e->type);
+            fuzz_errors++;
+        }
+        else if (e->path[0] && (json_match (p, "") || json_match (p, "#")))
+        {
+            printf ("jsonparser-test: fuzz: event %u: %s matches wrong pattern\n", event_idx, e->path);
+            fuzz_errors++;
+        }
+        event_idx++;
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * feed document, DONE and ERROR must be final
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+fuzz_feed (const char * buf, size_t len, void * data)
+{
+    JSON_PARSER     p;
+    int             rtc = JSON_CONTINUE;
+    int             final = JSON_CONTINUE;
+    size_t          i;
+
+    json_init (&p, fuzz_callback, data);
+
+    for (i = 0; i < len; i++)
+    {
+        rtc = json_feed (&p, (unsigned char) buf[i]);
+
+        if (rtc != JSON_CONTINUE && rtc != JSON_DONE && rtc != JSON_ERROR)
+        {
+            printf ("jsonparser-test: fuzz: return value %d\n", rtc);
+            fuzz_errors++;
+        }
+
+        if (final != JSON_CONTINUE && rtc != final)
+        {
+            printf ("jsonparser-test: fuzz: return value %d after %d\n", rtc, final);
+            fuzz_errors++;
+        }
+        final = rtc;
+    }
+    return rtc;
+}
+
+static void
+test_fuzz (void)
+{
+    static char     mutated[MAX_DOC + 16];
+    uint32_t        n_done = 0;
+    uint32_t        n_error = 0;
+    uint32_t        d;
+    uint32_t        m;
+    uint32_t        k;
+    size_t          len;
+    size_t          pos;
+    int             rtc;
+
+    for (d = 0; d < FUZZ_DOCS && fuzz_errors < 10; d++)
+    {
+        doc_len     = 0;
+        n_events    = 0;
+        event_idx   = 0;
+        gen_value (0, "");
+        put ("\n");                                                         // terminates a number at root
+
+        rtc = fuzz_feed (doc, doc_len, (void *) 1);
+
+        if (rtc != JSON_DONE || event_idx != n_events)
+        {
+            printf ("jsonparser-test: fuzz: document %u: return %d, %u of %u values:\n%.*s\n", d, rtc, event_idx, n_events,
+                    (int) doc_len, doc);
+            fuzz_errors++;
+        }
+
+        for (m = 0; m < FUZZ_MUTATIONS; m++)
+        {
+            memcpy (mutated, doc, doc_len);
+            len = doc_len;
+
+            for (k = 1 + next_rand () % 4; k > 0 && len > 0; k--)
+            {
+                pos = next_rand () % len;
+
+                switch (next_rand () % 4)
+                {
+                    case 0:                                                 // flip bits
+                        mutated[pos] ^= 1 << (next_rand () % 8);
+                        break;
+                    case 1:                                                 // delete
+                        memmove (mutated + pos, mutated + pos + 1, len - pos - 1);
+                        len--;
+                        break;
+                    case 2:                                                 // insert syntax character
+                        memmove (mutated + pos + 1, mutated + pos, len - pos);
+                        mutated[pos] = "{}[]\",:\\u0Ee-"[next_rand () % 14];
+                        len++;
+                        break;
+                    default:                                                // cut
+                        len = pos;
+                        break;
+                }
+            }
+
+            rtc = fuzz_feed (mutated, len, NULL);
+            n_done  += (rtc == JSON_DONE);
+            n_error += (rtc == JSON_ERROR);
+        }
+    }
+
+    for (d = 0; d < FUZZ_RANDOM; d++)
+    {
+        len = 1 + next_rand () % 256;
+
+        for (pos = 0; pos < len; pos++)
+        {
+            mutated[pos] = (d & 1) ? "{}[]\",:\\u0a1 tn"[next_rand () % 16] : (char) next_rand ();
+        }
+
+        rtc = fuzz_feed (mutated, len, NULL);
+        n_done  += (rtc == JSON_DONE);
+        n_error += (rtc == JSON_ERROR);
+    }
+
+    printf ("jsonparser-test: fuzz: %u documents, %u mutated and random inputs (%u done, %u error), %u errors\n",
+            FUZZ_DOCS, FUZZ_DOCS * FUZZ_MUTATIONS + FUZZ_RANDOM, n_done, n_error, fuzz_errors);
+    n_errors += fuzz_errors;
+}
+
+int
+main (void)
+{
+    test_decode ();
+    test_captures ();
+    test_fuzz ();
+
+    printf ("jsonparser-test: %u errors\n", n_errors);
+    return n_errors ? 1 : 0;
+}
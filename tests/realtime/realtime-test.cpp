@@ -0,0 +1,308 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * realtime-test.cpp - realtime LED frames from DDP packets over the serial line: ESP8266/ESP-uclock/udpsrv.cpp into the parser of
+ *                     src/esp8266/esp8266.c
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * The test sends DDP frames to the realtime port of udpsrv.cpp, calls udp_server_loop() and feeds the records written to Serial
+ * together with text lines of the ESP8266 ("WEATHER ...") into esp8266_get_message() of the STM32 firmware. The records are applied
+ * to the LEDs like schedule_esp8266_frame() of main.c does. Frames change a few LEDs, every 50th frame all LEDs.
+ *
+ *      clean       all records and lines arrive, the LEDs show every frame
+ *      errors      the serial output of every frame gets one error: a lost, flipped or inserted byte. A record with an error must
+ *                  never be accepted and the text lines must be parsed again after the next STX or LF, only a line directly after
+ *                  a broken record may be lost.
+ *      repair      no errors anymore: the rolling refresh window repairs all LEDs within REPAIR_FRAMES frames
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <string>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Arduino.h"
+#include "WiFiUdp.h"
+#include "udpsrv.h"
+
+extern "C"
+{
+#include "esp8266.h"
+}
+
+#define N_LEDS                      (288 + 120)
+#define DDP_PORT                    4048
+#define DDP_SPLIT                   600                     // first DDP packet: bytes 0...599, second packet: rest with push flag
+#define CLEAN_FRAMES                100
+#define ERROR_FRAMES                300
+#define REPAIR_FRAMES               30                      // N_LEDS / REALTIME_REFRESH_LEDS of udpsrv.cpp + some frames
+
+#define ERROR_DROP                  0
+#define ERROR_FLIP                  1
+#define ERROR_INSERT                2
+#define N_ERROR_TYPES               3
+
+static uint8_t                      frame[3 * N_LEDS];      // frame sent via DDP
+static uint8_t                      leds[3 * N_LEDS];       // LEDs of STM32
+static uint32_t                     n_errors;
+static int                          ddp_fd;
+static struct sockaddr_in           ddp_addr;
+static uint_fast8_t                 ddp_seq;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * UART of STM32: the ESP8266 UART reads from serial_in, the log UART is discarded
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static std::string                  serial_in;
+static size_t                       serial_pos;
+
+extern "C"
+{
+volatile uint32_t                   timer_ticks;
+
+void            esp8266_uart_init (uint32_t baud)           { (void) baud; }
+void            esp8266_uart_putc (uint_fast8_t ch)         { (void) ch; }
+void            esp8266_uart_puts (const char * s)          { (void) s; }
+void            esp8266_uart_flush (void)                   { }
+uint_fast8_t    esp8266_uart_char_available (void)          { return serial_pos < serial_in.length (); }
+
+uint_fast8_t
+esp8266_uart_poll (uint_fast8_t * chp)
+{
+    if (serial_pos < serial_in.length ())
+    {
+        *chp = (uint8_t) serial_in[serial_pos++];
+        return 1;
+    }
+    return 0;
+}
+
+void            log_uart_putc (uint_fast8_t ch)             { (void) ch; }
+void            log_uart_puts (const char * s)              { (void) s; }
+uint_fast8_t    log_uart_poll (uint_fast8_t * chp)          { (void) chp; return 0; }
+}
+
+static uint32_t                     rand_state = 1;
+
+static uint32_t
+next_rand (void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * send frame as two DDP packets
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+ddp_send (uint32_t offset, uint_fast16_t len, bool push)
+{
+    uint8_t     packet[10 + 3 * N_LEDS];
+
+    ddp_seq = (ddp_seq % 15) + 1;
+
+    packet[0] = 0x40 | (push ? 0x01 : 0x00);                                    // version 1, push
+    packet[1] = ddp_seq;
+    packet[2] = 0x0B;                                                           // RGB, 8 bit
+    packet[3] = 1;                                                              // id: display
+    packet[4] = offset >> 24;
+    packet[5] = offset >> 16;
+    packet[6] = offset >> 8;
+    packet[7] = offset;
+    packet[8] = len >> 8;
+    packet[9] = len;
+    memcpy (packet + 10, frame + offset, len);
+
+    sendto (ddp_fd, packet, 10 + len, 0, (struct sockaddr *) &ddp_addr, sizeof (ddp_addr));
+}
+
+static void
+next_frame (uint32_t n)
+{
+    uint_fast16_t   changes = (n % 50 == 0) ? 3 * N_LEDS : next_rand () % 60;
+    uint_fast16_t   i;
+
+    for (i = 0; i < changes; i++)
+    {
+        frame[(changes == 3 * N_LEDS) ? i : next_rand () % (3 * N_LEDS)] = next_rand ();
+    }
+
+    ddp_send (0, DDP_SPLIT, false);
+    ddp_send (DDP_SPLIT, 3 * N_LEDS - DDP_SPLIT, true);
+    usleep (100);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * run one frame through ESP8266 and STM32, returns number of text lines received
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+run_frame (const char * phase, uint32_t n, bool inject_error)
+{
+    std::string     line = "WEATHER frame " + std::to_string (n);
+    std::string     out;
+    uint8_t *       rec = esp8266.u.frame;
+    uint_fast16_t   offset;
+    uint_fast8_t    rtc;
+    uint32_t        lines = 0;
+    size_t          pos;
+
+    next_frame (n);
+    stub_serial_out.clear ();
+    udp_server_loop ();
+    out = stub_serial_out;
+
+    if (out.empty ())
+    {
+        printf ("realtime-test: %s: frame %u not forwarded\n", phase, n);
+        n_errors++;
+    }
+
+    if (inject_error && ! out.empty ())
+    {
+        pos = next_rand () % out.length ();
+
+        switch (next_rand () % N_ERROR_TYPES)
+        {
+            case ERROR_DROP:    out.erase (pos, 1);                                 break;
+            case ERROR_FLIP:    out[pos] ^= 1 << (next_rand () % 8);                break;
+            case ERROR_INSERT:  out.insert (pos, 1, (char) next_rand ());           break;
+        }
+    }
+
+    serial_in   = (n % 2) ? out + line + "\r\n" : line + "\r\n" + out;             // text line after or before the records
+    serial_pos  = 0;
+
+    while ((rtc = esp8266_get_message ()) != ESP8266_TIMEOUT || serial_pos < serial_in.length ())
+    {
+        if (rtc == ESP8266_FRAME)                                               // see schedule_esp8266_frame() of main.c
+        {
+            offset = (rec[2] << 8) | rec[3];
+
+            if (offset + rec[4] > N_LEDS || memcmp (rec + ESP8266_FRAME_HEADER_LEN, frame + 3 * offset, 3 * rec[4]))
+            {
+                printf ("realtime-test: %s: frame %u: record with wrong content accepted\n", phase, n);
+                n_errors++;
+            }
+            else
+            {
+                memcpy (leds + 3 * offset, rec + ESP8266_FRAME_HEADER_LEN, 3 * rec[4]);
+            }
+        }
+        else if (rtc == ESP8266_WEATHER)
+        {
+            if (line.compare (8, std::string::npos, esp8266.u.weather))
+            {
+                printf ("realtime-test: %s: frame %u: wrong text line \"%s\"\n", phase, n, esp8266.u.weather);
+                n_errors++;
+            }
+            lines++;
+        }
+    }
+
+    return lines;
+}
+
+int
+main (void)
+{
+    char            info[UDP_REALTIME_INFO_SIZE];
+    uint32_t        n = 0;
+    uint32_t        lines;
+    uint32_t        lost = 0;
+    uint32_t        wrong = 0;
+    uint32_t        i;
+
+    udp_server_setup ();
+
+    ddp_fd = socket (AF_INET, SOCK_DGRAM, 0);
+    memset (&ddp_addr, 0, sizeof (ddp_addr));
+    ddp_addr.sin_family         = AF_INET;
+    ddp_addr.sin_addr.s_addr    = htonl (INADDR_LOOPBACK);
+    ddp_addr.sin_port           = htons (DDP_PORT + stub_udp_port_offset);
+
+    for (i = 0; i < CLEAN_FRAMES; i++, n++)
+    {
+        if (run_frame ("clean", n, false) != 1)
+        {
+            printf ("realtime-test: clean: frame %u: text line lost\n", n);
+            n_errors++;
+        }
+
+        if (memcmp (leds, frame, sizeof (frame)))
+        {
+            wrong++;
+        }
+    }
+
+    printf ("realtime-test: clean  %u frames, %u wrong, %u checksum errors, %u resyncs\n", CLEAN_FRAMES, wrong,
+            esp8266.frame_errors, esp8266.frame_resyncs);
+
+    if (wrong || esp8266.frame_errors || esp8266.frame_resyncs)
+    {
+        printf ("realtime-test: clean: errors on clean line\n");
+        n_errors++;
+    }
+
+    for (i = 0; i < ERROR_FRAMES; i++, n++)
+    {
+        lines = run_frame ("errors", n, true);
+
+        if (lines > 1)
+        {
+            printf ("realtime-test: errors: frame %u: text line received twice\n", n);
+            n_errors++;
+        }
+
+        lost += 1 - lines;
+    }
+
+    printf ("realtime-test: errors %u frames, %u text lines lost, %u checksum errors, %u resyncs\n", ERROR_FRAMES, lost,
+            esp8266.frame_errors, esp8266.frame_resyncs);
+
+    if (esp8266.frame_errors + esp8266.frame_resyncs < ERROR_FRAMES / 2 || esp8266.frame_resyncs == 0)
+    {
+        printf ("realtime-test: errors: broken records not detected\n");
+        n_errors++;
+    }
+
+    if (lost > ERROR_FRAMES / 10)
+    {
+        printf ("realtime-test: errors: too many text lines lost\n");
+        n_errors++;
+    }
+
+    wrong = 0;
+
+    for (i = 0; i < CLEAN_FRAMES; i++, n++)
+    {
+        if (run_frame ("repair", n, false) != 1)
+        {
+            printf ("realtime-test: repair: frame %u: text line lost\n", n);
+            n_errors++;
+        }
+
+        if (i >= REPAIR_FRAMES && memcmp (leds, frame, sizeof (frame)))
+        {
+            wrong++;
+        }
+    }
+
+    printf ("realtime-test: repair %u frames, %u wrong after %u frames\n", CLEAN_FRAMES, wrong, REPAIR_FRAMES);
+
+    if (wrong)
+    {
+        printf ("realtime-test: repair: LEDs not repaired\n");
+        n_errors++;
+    }
+
+    udp_realtime_info (info);
+    printf ("realtime-test: ESP8266: %s\n", info);
+    printf ("realtime-test: %u errors\n", n_errors);
+    return n_errors ? 1 : 0;
+}
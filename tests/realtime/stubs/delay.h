@@ -0,0 +1,10 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * delay.h - host test stub
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef DELAY_H
+#define DELAY_H
+
+#define delay_msec(ms)
+
+#endif
@@ -0,0 +1,8 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * display.h - host test stub, the realtime LEDs are written by realtime-test.cpp
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#endif
@@ -0,0 +1,21 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * io.h - host test stub, the ESP8266 control pins are not used
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef IO_H
+#define IO_H
+
+#define ENABLE                                  1
+#define GPIOA                                   0
+#define GPIO_Pin_4                              0x0010
+#define GPIO_Pin_5                              0x0020
+#define GPIO_Pin_8                              0x0100
+#define GPIO_Speed_2MHz                         0
+#define RCC_AHB1Periph_GPIOA                    0
+
+#define RCC_AHB1PeriphClockCmd(periph, state)
+#define GPIO_SET_PIN_OUT_PP(port, pin, speed)
+#define GPIO_SET_BIT(port, pin)
+#define GPIO_RESET_BIT(port, pin)
+
+#endif
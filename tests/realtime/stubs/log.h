@@ -0,0 +1,18 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * log.h - host test stub
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#undef UART_PREFIX
+#define UART_PREFIX                 log
+#include "uart.h"
+
+#define log_init(b)
+#define log_putc(c)
+#define log_puts(s)
+#define log_message(s)
+#define log_flush()
+
+#endif
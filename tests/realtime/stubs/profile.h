@@ -0,0 +1,11 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * profile.h - host test stub
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#define PROFILE_START(p)
+#define PROFILE_STOP(p)
+
+#endif
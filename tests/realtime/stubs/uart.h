@@ -0,0 +1,15 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * uart.h - host test stub, UART routines of UART_PREFIX are defined by realtime-test.cpp
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+#define _UART_CONCAT(a,b)                a##b
+#define UART_CONCAT(a,b)                 _UART_CONCAT(a,b)
+
+extern void             UART_CONCAT(UART_PREFIX, _uart_init)            (uint32_t);
+extern void             UART_CONCAT(UART_PREFIX, _uart_putc)            (uint_fast8_t);
+extern void             UART_CONCAT(UART_PREFIX, _uart_puts)            (const char *);
+extern uint_fast8_t     UART_CONCAT(UART_PREFIX, _uart_char_available)  (void);
+extern uint_fast8_t     UART_CONCAT(UART_PREFIX, _uart_poll)            (uint_fast8_t *);
+extern void             UART_CONCAT(UART_PREFIX, _uart_flush)           (void);
@@ -0,0 +1,400 @@
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * tz-test.c - transitions of src/tz/tz.c against the reference zone data of the tz database
+ *
+ * Copyright (c) 2026 Frank Meyer - frank(at)uclock.de
+ *
+ * For every zone, the compiled zone file of the tz database (TZif, RFC 8536) is read from TZDIR. Its POSIX TZ string - the
+ * rule of the zone after the last listed transition - is passed to tz_set_rule(), then
+ *
+ *  - every transition listed in the zone file from 2027 on must be met to the second: the offset and DST flag of
+ *    tz_get_offset() one second before and at the transition must match the zone file,
+ *  - up to 2105, tz_utc_to_tm() must match localtime_r() of the C library for the zone every 6 hours, and every change of the
+ *    offset found by localtime_r() must be met to the second.
+ *
+ * Additionally rules with unusual syntax are compared with localtime_r(), invalid rules must be rejected and all legacy rules
+ * must be accepted.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+#define _DEFAULT_SOURCE                                                     // tm_gmtoff
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "tz.h"
+
+#define START                       1798761600LL            // 2027-01-01 00:00:00 UTC
+#define END                         4291747200LL            // 2106-01-01 00:00:00 UTC, end of uint32_t
+#define STEP                        (6 * 3600)              // transitions are at least 6 hours apart
+#define MAX_TRANSITIONS             4000
+
+static const char *                 zones[] =
+{
+    "Europe/Berlin",                                        // EU rule at 01:00 UTC
+    "Europe/London",
+    "Europe/Dublin",                                        // negative DST: winter time is DST
+    "Europe/Lisbon",
+    "Africa/Cairo",                                         // transition at 24:00 of thursday
+    "Asia/Jerusalem",                                       // transition at 26:00 of thursday
+    "America/New_York",
+    "America/St_Johns",                                     // offset -3:30
+    "America/Santiago",                                     // transition at 24:00 of saturday
+    "America/Nuuk",                                         // transition at -1:00
+    "America/Asuncion",                                     // DST abolished
+    "Australia/Sydney",                                     // DST around new year
+    "Australia/Adelaide",                                   // offset +9:30
+    "Australia/Lord_Howe",                                  // DST of 30 minutes
+    "Pacific/Auckland",
+    "Pacific/Chatham",                                      // offset +12:45, transition at 2:45
+    "Asia/Kathmandu",                                       // offset +5:45, no DST
+    "Asia/Kolkata",
+    "UTC",
+};
+
+static const char *                 rules[] =               // compared with localtime_r()
+{
+    "<+0545>-5:45",
+    "IST-1GMT0,M10.5.0,M3.5.0/1",
+    "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",
+    "XXX3YYY,J60/25,200/-1",                                // Julian days, February 29 counted or not
+    "STD12DST,M3.5.0/-11,M10.5.0/-10",
+    "<-02>2<-01>,M3.5.0/-1,M10.5.0/0",
+    "EST5EDT",                                              // default rule of US
+    "UTC0",
+};
+
+static const char *                 bad_rules[] =           // must be rejected
+{
+    "C-1",
+    "CET",
+    "CET-1CEST,M3.5.0",
+    "CET-1CEST,M13.5.0,M10.5.0",
+    "CET-25",
+    "CET-1CEST,M3.5.0,M10.5.0/168",
+    "<AB>1",
+    "CET-1x",
+};
+
+typedef struct
+{
+    int64_t                         utc;
+    int32_t                         offset;                 // offset after transition
+    uint8_t                         is_dst;
+} TRANSITION;
+
+static TRANSITION                   transitions[MAX_TRANSITIONS];
+static uint32_t                     n_transitions;
+static char                         footer[TZ_MAX_RULE_LEN + 2];
+static uint32_t                     n_checks;
+static uint32_t                     n_errors;
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read big endian numbers
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+get32 (const uint8_t * p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static int64_t
+get64 (const uint8_t * p)
+{
+    return (int64_t) (((uint64_t) get32 (p) << 32) | get32 (p + 4));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * read version 2+ data block and footer of TZif file, returns 0 on error
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static int
+read_zone (const char * dir, const char * zone)
+{
+    static uint8_t  buf[256 * 1024];
+    char            fname[256];
+    FILE *          fp;
+    size_t          len;
+    const uint8_t * p;
+    const uint8_t * times;
+    const uint8_t * idx;
+    const uint8_t * types;
+    const uint8_t * f;
+    uint32_t        isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt;
+    uint32_t        i;
+
+    snprintf (fname, sizeof (fname), "%s/%s", dir, zone);
+
+    if (! (fp = fopen (fname, "rb")))
+    {
+        perror (fname);
+        return 0;
+    }
+
+    len = fread (buf, 1, sizeof (buf), fp);
+    fclose (fp);
+
+    if (len < 44 || memcmp (buf, "TZif", 4) != 0 || buf[4] < '2')
+    {
+        printf ("%s: no TZif file of version 2 or later\n", fname);
+        return 0;
+    }
+
+    p = buf;
+
+    for (i = 0; i < 2; i++)                                                 // skip 32 bit block
+    {
+        isutcnt     = get32 (p + 20);
+        isstdcnt    = get32 (p + 24);
+        leapcnt     = get32 (p + 28);
+        timecnt     = get32 (p + 32);
+        typecnt     = get32 (p + 36);
+        charcnt     = get32 (p + 40);
+
+        if (i == 1)
+        {
+            break;
+        }
+
+        p += 44 + timecnt * 5 + typecnt * 6 + charcnt + leapcnt * 8 + isstdcnt + isutcnt;
+    }
+
+    times   = p + 44;
+    idx     = times + timecnt * 8;
+    types   = idx + timecnt;
+    f       = types + typecnt * 6 + charcnt + leapcnt * 12 + isstdcnt + isutcnt;
+
+    if (f >= buf + len || *f != '\n' || timecnt > MAX_TRANSITIONS)
+    {
+        printf ("%s: invalid TZif file\n", fname);
+        return 0;
+    }
+
+    for (i = 0; i < TZ_MAX_RULE_LEN + 1 && f + 1 + i < buf + len && f[1 + i] != '\n'; i++)
+    {
+        footer[i] = f[1 + i];
+    }
+
+    footer[i] = '\0';
+
+    n_transitions = 0;
+
+    for (i = 0; i < timecnt; i++)
+    {
+        transitions[n_transitions].utc      = get64 (times + 8 * i);
+        transitions[n_transitions].offset   = (int32_t) get32 (types + 6 * idx[i]);
+        transitions[n_transitions].is_dst   = types[6 * idx[i] + 4];
+        n_transitions++;
+    }
+
+    return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check offset of tz_get_offset()
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+check_offset (const char * what, int64_t utc, int32_t offset, uint_fast8_t is_dst)
+{
+    uint_fast8_t    dst;
+    int32_t         o = tz_get_offset ((uint32_t) utc, &dst);
+
+    n_checks++;
+
+    if (o != offset || dst != is_dst)
+    {
+        if (n_errors++ < 20)
+        {
+            printf ("%s: utc %lld: offset %ld dst %u, expected %ld dst %u\n", what, (long long) utc, (long) o, (unsigned) dst,
+                    (long) offset, (unsigned) is_dst);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * check tz_utc_to_tm() against localtime_r() of TZ in environment
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+check_tm (const char * what, int64_t utc)
+{
+    struct tm   a;
+    struct tm   b;
+    time_t      t = (time_t) utc;
+
+    localtime_r (&t, &a);
+    tz_utc_to_tm (&b, (uint32_t) utc);
+    n_checks++;
+
+    if (a.tm_year != b.tm_year || a.tm_mon != b.tm_mon || a.tm_mday != b.tm_mday || a.tm_hour != b.tm_hour ||
+        a.tm_min != b.tm_min || a.tm_sec != b.tm_sec || a.tm_wday != b.tm_wday || a.tm_yday != b.tm_yday ||
+        (a.tm_isdst > 0) != (b.tm_isdst > 0))
+    {
+        if (n_errors++ < 20)
+        {
+            printf ("%s: utc %lld: %04d-%02d-%02d %02d:%02d:%02d dst %d, expected %04d-%02d-%02d %02d:%02d:%02d dst %d\n", what,
+                    (long long) utc, b.tm_year + 1900, b.tm_mon + 1, b.tm_mday, b.tm_hour, b.tm_min, b.tm_sec, b.tm_isdst,
+                    a.tm_year + 1900, a.tm_mon + 1, a.tm_mday, a.tm_hour, a.tm_min, a.tm_sec, a.tm_isdst);
+        }
+    }
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * compare with localtime_r() from START to END, find every change of offset to the second
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static uint32_t
+compare_localtime (const char * what, const char * tz)
+{
+    struct tm   a;
+    time_t      t;
+    time_t      lo;
+    time_t      hi;
+    time_t      mid;
+    long        offset;
+    uint32_t    changes = 0;
+
+    setenv ("TZ", tz, 1);
+    tzset ();
+
+    t = START;
+    localtime_r (&t, &a);
+    offset = a.tm_gmtoff;
+
+    for (t = START; t < END; t += STEP)
+    {
+        check_tm (what, t);
+        localtime_r (&t, &a);
+
+        if (a.tm_gmtoff != offset)                                          // change between t - STEP and t
+        {
+            lo = t - STEP;
+            hi = t;
+
+            while (hi - lo > 1)
+            {
+                mid = lo + (hi - lo) / 2;
+                localtime_r (&mid, &a);
+
+                if (a.tm_gmtoff == offset)
+                {
+                    lo = mid;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+
+            check_tm (what, hi - 1);
+            check_tm (what, hi);
+            localtime_r (&t, &a);
+            offset = a.tm_gmtoff;
+            changes++;
+        }
+    }
+
+    return changes;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------------------------
+ * test zone of tz database
+ *-------------------------------------------------------------------------------------------------------------------------------------------
+ */
+static void
+test_zone (const char * dir, const char * zone)
+{
+    char        tz[300];
+    uint32_t    errors = n_errors;
+    uint32_t    listed = 0;
+    uint32_t    changes;
+    uint32_t    i;
+
+    if (! read_zone (dir, zone))
+    {
+        n_errors++;
+        return;
+    }
+
+    if (! tz_set_rule (footer))
+    {
+        printf ("%s: rule \"%s\" rejected\n", zone, footer);
+        n_errors++;
+        return;
+    }
+
+    for (i = 1; i < n_transitions; i++)
+    {
+        if (transitions[i].utc >= START && transitions[i].utc < END)
+        {
+            check_offset (zone, transitions[i].utc - 1, transitions[i - 1].offset, transitions[i - 1].is_dst);
+            check_offset (zone, transitions[i].utc, transitions[i].offset, transitions[i].is_dst);
+            listed++;
+        }
+    }
+
+    snprintf (tz, sizeof (tz), ":%s/%s", dir, zone);
+    changes = compare_localtime (zone, tz);
+
+    printf ("tz-test: %-20s %-50s %3u listed transitions, %3u changes up to 2105, %s\n", zone, footer, listed, changes,
+            n_errors == errors ? "ok" : "FAILED");
+}
+
+int
+main (int argc, char ** argv)
+{
+    const char *    dir = argc > 1 ? argv[1] : "/usr/share/zoneinfo";
+    char            buf[TZ_MAX_RULE_LEN + 1];
+    uint32_t        i;
+    int             hours;
+    int             summertime;
+
+    for (i = 0; i < sizeof (zones) / sizeof (zones[0]); i++)
+    {
+        test_zone (dir, zones[i]);
+    }
+
+    for (i = 0; i < sizeof (rules) / sizeof (rules[0]); i++)
+    {
+        if (! tz_set_rule (rules[i]))
+        {
+            printf ("tz-test: rule \"%s\" rejected\n", rules[i]);
+            n_errors++;
+            continue;
+        }
+
+        compare_localtime (rules[i], rules[i]);
+    }
+
+    for (i = 0; i < sizeof (bad_rules) / sizeof (bad_rules[0]); i++)
+    {
+        if (tz_set_rule (bad_rules[i]))
+        {
+            printf ("tz-test: invalid rule \"%s\" accepted\n", bad_rules[i]);
+            n_errors++;
+        }
+    }
+
+    for (hours = -12; hours <= 12; hours++)
+    {
+        for (summertime = 0; summertime <= 1; summertime++)
+        {
+            tz_legacy_rule (buf, hours, summertime);
+
+            if (strlen (buf) > TZ_MAX_RULE_LEN || ! tz_set_rule (buf))
+            {
+                printf ("tz-test: legacy rule \"%s\" rejected\n", buf);
+                n_errors++;
+            }
+        }
+    }
+
+    printf ("tz-test: %u checks, %u errors\n", n_checks, n_errors);
+    return n_errors ? 1 : 0;
+}